@@ -87,6 +87,11 @@ struct arguments
   bool userSetPadValue;
   bool useWeighting; 
   double weightingThreshold; 
+  int sampling;
+  double samplingFraction;
+  int samplingSeed;
+  bool resampleEveryIteration;
+  int metricPieces;
   double parameterChangeTolerance; 
   bool useCogInitialisation; 
   bool rotateAboutCog; 
@@ -172,7 +177,12 @@ int DoMain(arguments args)
   typename BuilderType::Pointer builder = BuilderType::New();
   builder->StartCreation((itk::SingleResRegistrationMethodTypeEnum)args.registrationStrategy);
   builder->CreateInterpolator((itk::InterpolationTypeEnum)args.registrationInterpolator);
-  typename SimilarityMeasureType::Pointer metric = builder->CreateMetric((itk::MetricTypeEnum)args.similarityMeasure);
+  typename SimilarityMeasureType::Pointer metric = builder->CreateMetric((itk::MetricTypeEnum)args.similarityMeasure,
+                                                                        (itk::SamplingStrategyEnum)args.sampling,
+                                                                        args.samplingFraction,
+                                                                        args.resampleEveryIteration);
+  metric->SetSamplingSeed(args.samplingSeed);
+  metric->SetNumberOfPartialCostFunctions(args.metricPieces);
   metric->SetSymmetricMetric(args.symmetricMetric);
   metric->SetUseWeighting(args.useWeighting); 
   if (args.useWeighting)
@@ -855,6 +865,31 @@ int main(int argc, char** argv)
     return( EXIT_FAILURE );
   }
 
+  // Voxel sampling
+
+  if(      strSampling == std::string( "Random" ) )
+  {
+    args.sampling = 1;
+  }
+  else if( strSampling == std::string( "Grid" ) )
+  {
+    args.sampling = 2;
+  }
+  else if( strSampling == std::string( "Gradient_Weighted" ) )
+  {
+    args.sampling = 3;
+  }
+  else
+  {
+    args.sampling = 0;
+  }
+
+  args.samplingFraction = samplingFraction;
+  args.samplingSeed = samplingSeed;
+  args.resampleEveryIteration = flgResampleEveryIteration;
+
+  args.metricPieces = metricPieces;
+
   // Weighted similarity measure distance threshold
 
   if ( weightingThreshold != 0. )
@@ -913,6 +948,15 @@ int main(int argc, char** argv)
             << "    Mask maximum threshold: "				<< args.maskMaximumThreshold    << std::endl
             << "    Weighted similarity measure distance threshold: "	<< args.weightingThreshold      << std::endl;
 
+  std::cout << "  Voxel sampling: "					<< std::endl
+            << "    Sampling: "					<< args.sampling << ". " << strSampling << std::endl
+            << "    Sampling fraction: "				<< args.samplingFraction        << std::endl
+            << "    Sampling seed: "					<< args.samplingSeed            << std::endl
+            << "    Resample every iteration? "			<< BooleanToString( args.resampleEveryIteration ) << std::endl;
+
+  std::cout << "  Multi-threading: "					<< std::endl
+            << "    Number of metric pieces: "				<< args.metricPieces            << std::endl;
+
   std::cout << "  Symmetric metric ("					<< args.symmetricMetric << "): " << std::endl
             << "    Symmetric metric? "					<< BooleanToString( flgSymmetricMetric )      << std::endl
             << "    Symmetric midway? "					<< BooleanToString( flgSymmetricMetricMidway )<< std::endl;
@@ -1044,6 +1088,16 @@ int main(int argc, char** argv)
     return -1;
   }
 
+  if(args.sampling != 0 && (args.samplingFraction <= 0 || args.samplingFraction > 1)){
+    std::cerr << argv[0] << "\tThe samplingFraction must be > 0 and <= 1" << std::endl;
+    return -1;
+  }
+
+  if(args.metricPieces < 0){
+    std::cerr << argv[0] << "\tThe number of metric pieces must be >= 0" << std::endl;
+    return -1;
+  }
+
   if(args.dilations < 0){
     std::cerr << argv[0] << "\tThe number of dilations must be >= 0" << std::endl;
     return -1;
@@ -22,6 +22,7 @@
  */
 
 
+#include <niftkBatchProcessor.h>
 #include <niftkFileHelper.h>
 #include <niftkConversionUtils.h>
 #include <itkCommandLineHelper.h>
@@ -39,6 +40,7 @@
 
 #include <boost/filesystem/path.hpp>
 
+#include <stdexcept>
 #include <vector>
 
 #include <niftkAnonymiseDICOMImagesCLP.h>
@@ -79,9 +81,6 @@ struct arguments
 
   bool flgDontAnonPatientsTelephoneNumbers;
   std::string strPatientsTelephoneNumbers;
-
-
-  std::string iterFilename;
 };
 
 
@@ -89,7 +88,7 @@ struct arguments
 // PrintDictionary()
 // -------------------------------------------------------------------------
 
-void PrintDictionary( DictionaryType &dictionary )
+void PrintDictionary( DictionaryType &dictionary, std::ostream &os )
 {
   DictionaryType::ConstIterator tagItr = dictionary.Begin();
   DictionaryType::ConstIterator end = dictionary.End();
@@ -107,7 +106,7 @@ void PrintDictionary( DictionaryType &dictionary )
 
       std::string tagValue = entryvalue->GetMetaDataObjectValue();
 
-      std::cout << tagkey << " " << tagID <<  ": " << tagValue << std::endl;
+      os << tagkey << " " << tagID <<  ": " << tagValue << std::endl;
     }
 
     ++tagItr;
@@ -122,7 +121,8 @@ void PrintDictionary( DictionaryType &dictionary )
 void AnonymiseTag( bool flgDontAnonymise,
 		   DictionaryType &dictionary,
 		   std::string tagID,
-		   std::string newTagValue )
+		   std::string newTagValue,
+		   std::ostream &log )
 {
   if ( flgDontAnonymise )
     return;
@@ -141,9 +141,9 @@ void AnonymiseTag( bool flgDontAnonymise,
     {
       std::string tagValue = entryvalue->GetMetaDataObjectValue();
 
-      std::cout << "Anonymising tag (" << tagID <<  ") "
-		<< " from: " << tagValue
-		<< " to: " << newTagValue << std::endl;
+      log << "Anonymising tag (" << tagID <<  ") "
+	  << " from: " << tagValue
+	  << " to: " << newTagValue << std::endl;
 
       itk::EncapsulateMetaData<std::string>( dictionary, tagID, newTagValue );
     }
@@ -153,15 +153,17 @@ void AnonymiseTag( bool flgDontAnonymise,
 
 
 // -------------------------------------------------------------------------
-// main()
+// DoMain()
 // -------------------------------------------------------------------------
 
 template <class InputPixelType>
-int DoMain(arguments args, InputPixelType min, InputPixelType max)
+int DoMain(const arguments &args, niftk::BatchProcessor::Job &job,
+           InputPixelType min, InputPixelType max)
 {
+  std::ostream &log = job.GetLog();
 
-  // Iterate through each file and anonymise it
-  // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  // Anonymise this file
+  // ~~~~~~~~~~~~~~~~~~~
 
   std::string fileInputFullPath;
   std::string fileInputRelativePath;
@@ -186,16 +188,17 @@ int DoMain(arguments args, InputPixelType min, InputPixelType max)
   // Read the image
 
   reader->SetImageIO( gdcmImageIO );
-  reader->SetFileName( args.iterFilename );
+  reader->SetFileName( job.GetFileName() );
 
   try
   {
+    niftk::BatchProcessor::IOSection io( job );
     reader->UpdateLargestPossibleRegion();
   }
 
   catch (itk::ExceptionObject &ex)
   {
-    std::cout << "Skipping file (not DICOM?): " << args.iterFilename << std::endl;
+    log << "Skipping file (not DICOM?): " << job.GetFileName() << std::endl;
     return EXIT_FAILURE;
   }
 
@@ -204,7 +207,7 @@ int DoMain(arguments args, InputPixelType min, InputPixelType max)
 
   if ( args.flgVerbose )
   {
-    PrintDictionary( dictionary );
+    PrintDictionary( dictionary, log );
   }
 
   image = reader->GetOutput();
@@ -213,18 +216,18 @@ int DoMain(arguments args, InputPixelType min, InputPixelType max)
 
   // Anonymise the DICOM header
 
-  AnonymiseTag( args.flgDontAnonPatientsName,  	    dictionary, "0010|0010", "Anonymous"    ); // Patient's Name
-  AnonymiseTag( args.flgDontAnonPatientsBirthDate,	    dictionary, "0010|0030", "00000000"     ); // Patient's Birth Date
-  AnonymiseTag( args.flgDontAnonOtherPatientNames, 	    dictionary, "0010|1001", "None"         ); // Other Patient Names
-  AnonymiseTag( args.flgDontAnonPatientsBirthName, 	    dictionary, "0010|1005", "Anonymous"    ); // Patient's Birth Name
-  AnonymiseTag( args.flgDontAnonPatientsAddress, 	    dictionary, "0010|1040", "None"         ); // Patient's Address
-  AnonymiseTag( args.flgDontAnonPatientsMothersBirthName, dictionary, "0010|1060", "Anonymous"    ); // Patient's Mother's Birth Name
-  AnonymiseTag( args.flgDontAnonPatientsTelephoneNumbers, dictionary, "0010|2154", "None"         ); // Patient's Telephone Numbers
+  AnonymiseTag( args.flgDontAnonPatientsName,  	    dictionary, "0010|0010", "Anonymous",  log ); // Patient's Name
+  AnonymiseTag( args.flgDontAnonPatientsBirthDate,	    dictionary, "0010|0030", "00000000",   log ); // Patient's Birth Date
+  AnonymiseTag( args.flgDontAnonOtherPatientNames, 	    dictionary, "0010|1001", "None",       log ); // Other Patient Names
+  AnonymiseTag( args.flgDontAnonPatientsBirthName, 	    dictionary, "0010|1005", "Anonymous",  log ); // Patient's Birth Name
+  AnonymiseTag( args.flgDontAnonPatientsAddress, 	    dictionary, "0010|1040", "None",       log ); // Patient's Address
+  AnonymiseTag( args.flgDontAnonPatientsMothersBirthName, dictionary, "0010|1060", "Anonymous",  log ); // Patient's Mother's Birth Name
+  AnonymiseTag( args.flgDontAnonPatientsTelephoneNumbers, dictionary, "0010|2154", "None",       log ); // Patient's Telephone Numbers
 
 
   // Create the output image filename
 
-  fileInputFullPath = args.iterFilename;
+  fileInputFullPath = job.GetFileName();
 
   fileInputRelativePath = fileInputFullPath.substr( args.dcmDirectoryIn.length() );
 
@@ -241,25 +244,23 @@ int DoMain(arguments args, InputPixelType min, InputPixelType max)
     niftk::CreateDirAndParents( dirOutputFullPath );
   }
 
-  std::cout << "Input relative filename: " << fileInputRelativePath << std::endl
-	    << "Output relative filename: " << fileOutputRelativePath << std::endl
-	    << "Output directory: " << dirOutputFullPath << std::endl;
+  log << "Input relative filename: " << fileInputRelativePath << std::endl
+      << "Output relative filename: " << fileOutputRelativePath << std::endl
+      << "Output directory: " << dirOutputFullPath << std::endl;
 
 
   // Write the image to the output file
 
   if ( niftk::FileIsRegular( fileOutputFullPath ) && ( ! args.flgOverwrite ) )
   {
-    std::cerr << std::endl << "ERROR: File " << fileOutputFullPath << " exists"
-	      << std::endl << "       and can't be overwritten. Consider option: 'overwrite'."
-	      << std::endl << std::endl;
-    return EXIT_FAILURE;
+    throw std::runtime_error( "File " + fileOutputFullPath + " exists"
+                              + " and can't be overwritten. Consider option: 'overwrite'." );
   }
   else
   {
     if ( args.flgVerbose )
     {
-      PrintDictionary( dictionary );
+      PrintDictionary( dictionary, log );
     }
 
     typename WriterType::Pointer writer = WriterType::New();
@@ -275,21 +276,119 @@ int DoMain(arguments args, InputPixelType min, InputPixelType max)
 
     writer->UseInputMetaDataDictionaryOff();
 
-    try
-    {
-      std::cout << "Writing image to file: " << fileOutputFullPath << std::endl;
-      writer->Update();
-    }
-    catch (itk::ExceptionObject & e)
+    log << "Writing image to file: " << fileOutputFullPath << std::endl;
+
+    niftk::BatchProcessor::IOSection io( job );
+    writer->Update();
+  }
+
+  log << std::endl;
+
+  return EXIT_SUCCESS;
+}
+
+
+// -------------------------------------------------------------------------
+// ProcessFile()
+// -------------------------------------------------------------------------
+
+void ProcessFile( const arguments &args, niftk::BatchProcessor::Job &job )
+{
+  std::ostream &log = job.GetLog();
+  const std::string &iterFilename = job.GetFileName();
+
+  log << "File: " << iterFilename << std::endl;
+
+  itk::ImageIOBase::IOComponentType componentType;
+
+  {
+    niftk::BatchProcessor::IOSection io( job );
+
+    itk::ImageIOBase::Pointer imageIO;
+    imageIO = itk::ImageIOFactory::CreateImageIO(iterFilename.c_str(),
+						 itk::ImageIOFactory::ReadMode);
+
+    if ( ( ! imageIO ) || ( ! imageIO->CanReadFile( iterFilename.c_str() ) ) )
     {
-      std::cerr << "ERROR: Failed to write image: " << std::endl << e << std::endl;
-      return EXIT_FAILURE;
+      log << "WARNING: Unrecognised image type, skipping file: "
+	  << iterFilename << std::endl << std::endl;
+      return;
     }
+
+    componentType = itk::PeekAtComponentType(iterFilename);
   }
 
-  std::cout << std::endl;
 
-  return EXIT_SUCCESS;
+  int result;
+
+  switch ( componentType )
+  {
+  case itk::ImageIOBase::UCHAR:
+    result = DoMain<unsigned char>( args, job,
+                                    itk::NumericTraits<unsigned char>::ZeroValue(),
+                                    itk::NumericTraits<unsigned char>::max() );
+    break;
+
+  case itk::ImageIOBase::CHAR:
+    result = DoMain<char>( args, job,
+                           itk::NumericTraits<char>::ZeroValue(),
+                           itk::NumericTraits<char>::max() );
+    break;
+
+  case itk::ImageIOBase::USHORT:
+    result = DoMain<unsigned short>( args, job,
+                                     itk::NumericTraits<unsigned short>::ZeroValue(),
+                                     static_cast<unsigned short>( 32767 ) );
+    break;
+
+  case itk::ImageIOBase::SHORT:
+    result = DoMain<short>( args, job,
+                            itk::NumericTraits<short>::ZeroValue(),
+                            static_cast<short>( 32767 ) );
+    break;
+
+  case itk::ImageIOBase::UINT:
+    result = DoMain<unsigned int>( args, job,
+                                   itk::NumericTraits<unsigned int>::ZeroValue(),
+                                   static_cast<unsigned int>( 32767 ) );
+    break;
+
+  case itk::ImageIOBase::INT:
+    result = DoMain<int>( args, job,
+                          itk::NumericTraits<int>::ZeroValue(),
+                          static_cast<int>( 32767 ) );
+    break;
+
+  case itk::ImageIOBase::ULONG:
+    result = DoMain<unsigned long>( args, job,
+                                    itk::NumericTraits<unsigned long>::ZeroValue(),
+                                    static_cast<unsigned long>( 32767 ) );
+    break;
+
+  case itk::ImageIOBase::LONG:
+    result = DoMain<long>( args, job,
+                           itk::NumericTraits<long>::ZeroValue(),
+                           static_cast<long>( 32767 ) );
+    break;
+
+  case itk::ImageIOBase::FLOAT:
+    result = DoMain<float>( args, job,
+                            itk::NumericTraits<float>::ZeroValue(),
+                            static_cast<float>( 32767 ) );
+    break;
+
+  case itk::ImageIOBase::DOUBLE:
+    result = DoMain<double>( args, job,
+                             itk::NumericTraits<double>::ZeroValue(),
+                             static_cast<double>( 32767 ) );
+    break;
+
+  default:
+    log << "WARNING: Unrecognised pixel type, skipping file: "
+	<< iterFilename << std::endl;
+  }
+
+  log << std::endl;
 }
 
 
@@ -301,10 +400,6 @@ int main( int argc, char *argv[] )
 {
   itk::NifTKImageIOFactory::Initialize();
 
-  float progress = 0.;
-  float iFile = 0.;
-  float nFiles;
-
   struct arguments args;
 
   // Validate command line args
@@ -324,6 +419,13 @@ int main( int argc, char *argv[] )
     dcmDirectoryOut = dcmDirectoryIn;
   }
 
+  if ( nThreads < 0 || nIOJobs < 0 || nComputeJobs < 0 )
+  {
+    commandLine.getOutput()->usage(commandLine);
+    std::cerr << "ERROR: The numbers of threads and jobs must not be negative" << std::endl;
+    return EXIT_FAILURE;
+  }
+
   args.dcmDirectoryIn  = dcmDirectoryIn;
   args.dcmDirectoryOut = dcmDirectoryOut;
 
@@ -362,112 +464,40 @@ int main( int argc, char *argv[] )
   // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
   std::vector< std::string > fileNames;
-  std::vector< std::string >::iterator iterFileNames;
 
-  niftk::GetRecursiveFilesInDirectory( dcmDirectoryIn, fileNames );
+  niftk::GetRecursiveFilesInDirectory( dcmDirectoryIn, fileNames, nIOJobs );
 
-  nFiles = fileNames.size();
-
-  for ( iterFileNames = fileNames.begin();
-	iterFileNames < fileNames.end();
-	++iterFileNames, iFile += 1. )
-  {
-    args.iterFilename = *iterFileNames;
-
-    std::cout << "File: " << args.iterFilename << std::endl;
-
-    progress = iFile/nFiles;
-    std::cout << "<filter-progress>" << std::endl
-	      << progress << std::endl
-	      << "</filter-progress>" << std::endl;
-
-
-    itk::ImageIOBase::Pointer imageIO;
-    imageIO = itk::ImageIOFactory::CreateImageIO(args.iterFilename.c_str(),
-						 itk::ImageIOFactory::ReadMode);
 
-    if ( ( ! imageIO ) || ( ! imageIO->CanReadFile( args.iterFilename.c_str() ) ) )
-    {
-      std::cerr << "WARNING: Unrecognised image type, skipping file: "
-		<< args.iterFilename << std::endl;
-      continue;
-    }
+  // Anonymise each file, several at once
+  // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
+  niftk::BatchProcessor processor;
 
-    int result;
+  processor.SetNumberOfThreads( nThreads );
+  processor.SetMaximumNumberOfIOJobs( nIOJobs );
+  processor.SetMaximumNumberOfComputeJobs( nComputeJobs );
+  processor.SetProgressFileName( fileProgress );
+  processor.SetReportProgress( true );
 
-    switch (itk::PeekAtComponentType(args.iterFilename))
-    {
-    case itk::ImageIOBase::UCHAR:
-      result = DoMain<unsigned char>( args,
-                                      itk::NumericTraits<unsigned char>::ZeroValue(),
-                                      itk::NumericTraits<unsigned char>::max() );
-      break;
-
-    case itk::ImageIOBase::CHAR:
-      result = DoMain<char>( args,
-                             itk::NumericTraits<char>::ZeroValue(),
-                             itk::NumericTraits<char>::max() );
-      break;
-
-    case itk::ImageIOBase::USHORT:
-      result = DoMain<unsigned short>( args,
-                                       itk::NumericTraits<unsigned short>::ZeroValue(),
-                                       static_cast<unsigned short>( 32767 ) );
-      break;
-
-    case itk::ImageIOBase::SHORT:
-      result = DoMain<short>( args,
-                              itk::NumericTraits<short>::ZeroValue(),
-                              static_cast<short>( 32767 ) );
-      break;
-
-    case itk::ImageIOBase::UINT:
-      result = DoMain<unsigned int>( args,
-                                     itk::NumericTraits<unsigned int>::ZeroValue(),
-                                     static_cast<unsigned int>( 32767 ) );
-      break;
-
-    case itk::ImageIOBase::INT:
-      result = DoMain<int>( args,
-                            itk::NumericTraits<int>::ZeroValue(),
-                            static_cast<int>( 32767 ) );
-      break;
-
-    case itk::ImageIOBase::ULONG:
-      result = DoMain<unsigned long>( args,
-                                      itk::NumericTraits<unsigned long>::ZeroValue(),
-                                      static_cast<unsigned long>( 32767 ) );
-      break;
-
-    case itk::ImageIOBase::LONG:
-      result = DoMain<long>( args,
-                             itk::NumericTraits<long>::ZeroValue(),
-                             static_cast<long>( 32767 ) );
-      break;
-
-    case itk::ImageIOBase::FLOAT:
-      result = DoMain<float>( args,
-                              itk::NumericTraits<float>::ZeroValue(),
-                              static_cast<float>( 32767 ) );
-      break;
-
-    case itk::ImageIOBase::DOUBLE:
-      result = DoMain<double>( args,
-                               itk::NumericTraits<double>::ZeroValue(),
-                               static_cast<double>( 32767 ) );
-      break;
-
-    default:
-      std::cerr << "WARNING: Unrecognised pixel type, skipping file: "
-		<< args.iterFilename << std::endl;
-    }
+  try
+  {
+    processor.Run( fileNames,
+                   [&args]( niftk::BatchProcessor::Job &job )
+                   {
+                     ProcessFile( args, job );
+                   } );
+  }
+  catch (std::exception &e)
+  {
+    std::cerr << "ERROR: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
 
-    std::cout << std::endl;
+  if ( processor.GetFailedFileNames().size() > 0 )
+  {
+    std::cerr << "WARNING: Failed to anonymise "
+              << processor.GetFailedFileNames().size() << " files" << std::endl;
   }
 
   return EXIT_SUCCESS;
 }
-
-
-
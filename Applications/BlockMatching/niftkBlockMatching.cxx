@@ -139,6 +139,8 @@ void EndUsage()
   std::cout << "    -wt                             Write transformed moving image after each iteration. Filename tmp.moving.<iteration>.nii" << std::endl;
   std::cout << "    -wps                            Write point set. Filename is always tmp.block.points.vtk" << std::endl;
   std::cout << "    -nozero                         Don't include point pairs with zero displacement" << std::endl;
+  std::cout << "    -threads <int>   [all]          Number of threads used to match blocks" << std::endl;
+  std::cout << "    -integral                       For SSD and NCC, score blocks from the image buffers, with integral images for the moving block sums, rather than evaluating the similarity measure" << std::endl;
   std::cout << "    -noaligncentre                  If neither -iitk nor -itxt is specified, this program will set the initial translation to align the centre of the volume. Default is on, this flag turns off this behaviour." << std::endl;
   std::cout << "    -alignaxes                      If neither -iitk nor -itxt is specified, this option will also try to align principal axes, to initialise rotations. Default is off, this flag turns it on." << std::endl;
   
@@ -210,6 +212,8 @@ struct arguments
   bool isRescaleIntensity; 
   bool writePointSet;
   bool noZero;
+  int numberOfThreads;
+  bool useIntegralImages;
   bool userSpecifiedPyramid;
   bool userSetPadValue;
   bool alignCentres;
@@ -446,6 +450,11 @@ int DoMain(arguments args)
     }
   
   blockMatchingMethod->SetNoZero(args.noZero);
+  blockMatchingMethod->SetUseIntegralImages(args.useIntegralImages);
+  if (args.numberOfThreads > 0)
+    {
+      blockMatchingMethod->SetNumberOfThreads(args.numberOfThreads);
+    }
   blockMatchingMethod->SetWritePointSet(args.writePointSet);
   blockMatchingMethod->SetTransformedMovingImageFileName("tmp.moving");
   blockMatchingMethod->SetTransformedMovingImageFileExt("nii");
@@ -842,6 +851,8 @@ int main(int argc, char** argv)
   args.isRescaleIntensity = false; 
   args.writePointSet = false;
   args.noZero = false;
+  args.numberOfThreads = 0;
+  args.useIntegralImages = false;
   args.userSpecifiedPyramid = false;
   args.userSetPadValue = false;
   args.alignCentres = true;
@@ -1032,6 +1043,14 @@ int main(int argc, char** argv)
       args.noZero=true;
       std::cout << "Set -nozero=" << niftk::ConvertToString(args.noZero)<< std::endl;
     }    
+    else if(strcmp(argv[i], "-threads") == 0){
+      args.numberOfThreads=atoi(argv[++i]);
+      std::cout << "Set -threads=" << niftk::ConvertToString(args.numberOfThreads)<< std::endl;
+    }
+    else if(strcmp(argv[i], "-integral") == 0){
+      args.useIntegralImages=true;
+      std::cout << "Set -integral=" << niftk::ConvertToString(args.useIntegralImages)<< std::endl;
+    }
     else if(strcmp(argv[i], "-ln") == 0){
       args.levels=atoi(argv[++i]);
       std::cout << "Set -ln=" << niftk::ConvertToString(args.levels)<< std::endl;
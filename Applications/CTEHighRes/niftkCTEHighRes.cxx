@@ -56,6 +56,7 @@ void Usage(char *name)
   std::cout << "    -high <float> [10000]   High Potential (voltage)" << std::endl;
   std::cout << "    -le   <float> [0.00001] Laplacian relaxation convergence ratio (epsilon)" << std::endl;
   std::cout << "    -li   <int>   [200]     Laplacian relaxation max iterations" << std::endl;
+  std::cout << "    -ls   <string> [gs]     Laplacian solver, one of gs, sor (multi-threaded red-black SOR) or mg (multi-threaded multigrid)" << std::endl;
   std::cout << "    -pe   <float> [0.00001] PDE relaxation convergence ratio (epsilon)" << std::endl;
   std::cout << "    -pi   <int>   [200]     PDE relaxation max iterations" << std::endl;
   std::cout << "    -t    <float> [0.5]     Threshold to iterate ray-casting towards" << std::endl;
@@ -86,6 +87,7 @@ struct arguments
   double laplaceRatio;
   double pdeRatio;
   int laplaceIters;
+  std::string laplaceSolver;
   int pdeIters;
   double segThreshold;
   double rayThreshold;
@@ -172,6 +174,14 @@ int DoMain(arguments args)
   laplaceFilter->SetEpsilonConvergenceThreshold(args.laplaceRatio);
   laplaceFilter->SetLabelThresholds(args.grey, args.white, args.csf); 
   laplaceFilter->SetUseGaussSeidel(true);
+  if (args.laplaceSolver == "sor")
+    {
+      laplaceFilter->SetSolver(LaplaceFilterType::RED_BLACK_SOR);
+    }
+  else if (args.laplaceSolver == "mg")
+    {
+      laplaceFilter->SetSolver(LaplaceFilterType::MULTIGRID);
+    }
   laplaceFilter->SetVoxelMultiplicationFactor(args.voxelMultiplicationFactor);
   if (args.doAcostaCorrection)
     {
@@ -270,6 +280,7 @@ int main(int argc, char** argv)
   args.laplaceRatio = 0.00001;
   args.pdeRatio = 0.00001;
   args.laplaceIters = 200;
+  args.laplaceSolver = "gs";
   args.pdeIters = 200;
   args.segThreshold = 1;
   args.rayThreshold = 0.5;
@@ -384,6 +395,10 @@ int main(int argc, char** argv)
       args.useLagrangianInitialisation = false;
       std::cout << "Set -noLagrangian=" << niftk::ConvertToString(args.useLagrangianInitialisation) << std::endl;
     }
+    else if(strcmp(argv[i], "-ls") == 0){
+      args.laplaceSolver=argv[++i];
+      std::cout << "Set -ls=" << args.laplaceSolver << std::endl;
+    }
     else if(strcmp(argv[i], "-vmf") == 0){
       args.voxelMultiplicationFactor=atoi(argv[++i]);
       std::cout << "Set -vmf=" << niftk::ConvertToString(args.voxelMultiplicationFactor) << std::endl;
@@ -406,6 +421,11 @@ int main(int argc, char** argv)
     return -1;
   }
 
+  if(args.laplaceSolver != "gs" && args.laplaceSolver != "sor" && args.laplaceSolver != "mg"){
+    std::cerr << argv[0] << "\tThe laplaceSolver must be gs, sor or mg" << std::endl;
+    return -1;
+  }
+
   if(args.pdeIters < 1 ){
     std::cerr << argv[0] << "\tThe pdeIters must be >= 1" << std::endl;
     return -1;
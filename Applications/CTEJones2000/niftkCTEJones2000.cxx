@@ -50,7 +50,8 @@ void Usage(char *name)
   std::cout << "    -step  <float> [0.1]     Step size for integration" << std::endl;
   std::cout << "    -sigma <float> [0]       Sigma for smoothing of vector normals. Default 0 (i.e. off)." << std::endl;
   std::cout << "    -max   <float> [10]      Max length for integration (so ray casting doesn't continue forever)." << std::endl;
-  std::cout << "    -noOpt                   Don't use Gauss-Siedel optimisation" << std::endl; 
+  std::cout << "    -noOpt                   Don't use Gauss-Siedel optimisation, same as -solver jacobi" << std::endl; 
+  std::cout << "    -solver <string> [gs]    Laplacian solver, one of jacobi, gs, sor (multi-threaded red-black SOR) or mg (multi-threaded multigrid)" << std::endl;
   std::cout << "    -label                   When integrating, use the label/segmentation images not the laplacian." << std::endl;
   std::cout << "                             So boundaries are defined in terms of GM/WM/CSF labels." << std::endl;
   std::cout << "                             This means that the label value must be WM < GM < CSF, i.e. the CSF is the high potential surface." << std::endl;
@@ -71,6 +72,7 @@ struct arguments
   double sigma;
   int laplaceIters;
   bool dontUseGaussSeidel;
+  std::string solver;
   bool useLabel;
   bool useSmoothing;
 };
@@ -112,6 +114,18 @@ int DoMain(arguments args)
   filter->SetHighVoltage(args.high);
   filter->SetLaplaceEpsionRatio(args.laplaceRatio);
   filter->SetLaplaceMaxIterations(args.laplaceIters);
+  if (args.dontUseGaussSeidel || args.solver == "jacobi")
+    {
+      filter->SetLaplaceSolver(JonesThicknessFilterType::LaplaceFilterType::JACOBI);
+    }
+  else if (args.solver == "sor")
+    {
+      filter->SetLaplaceSolver(JonesThicknessFilterType::LaplaceFilterType::RED_BLACK_SOR);
+    }
+  else if (args.solver == "mg")
+    {
+      filter->SetLaplaceSolver(JonesThicknessFilterType::LaplaceFilterType::MULTIGRID);
+    }
   filter->SetWhiteMatterLabel(args.white);
   filter->SetGreyMatterLabel(args.grey);
   filter->SetCSFMatterLabel(args.csf);
@@ -150,6 +164,7 @@ int main(int argc, char** argv)
   args.csf = 3;
   args.step = 0.1;
   args.dontUseGaussSeidel = false;
+  args.solver = "gs";
   args.maxLength = 10;
   args.sigma = 0;
   args.useLabel = false;
@@ -215,6 +230,10 @@ int main(int argc, char** argv)
       args.dontUseGaussSeidel=true;
       std::cout << "Set -noOpt=" << niftk::ConvertToString(args.dontUseGaussSeidel) << std::endl;
     }
+    else if(strcmp(argv[i], "-solver") == 0){
+      args.solver=argv[++i];
+      std::cout << "Set -solver=" << args.solver << std::endl;
+    }
     else if(strcmp(argv[i], "-label") == 0){
       args.useLabel=true;
       std::cout << "Set -label=" << niftk::ConvertToString(args.useLabel) << std::endl;
@@ -236,6 +255,11 @@ int main(int argc, char** argv)
     return -1;
   }
 
+  if(args.solver != "jacobi" && args.solver != "gs" && args.solver != "sor" && args.solver != "mg"){
+    std::cerr << argv[0] << "\tThe solver must be jacobi, gs, sor or mg" << std::endl;
+    return -1;
+  }
+
   if(args.laplaceRatio < 0 ){
     std::cerr << argv[0] << "\tThe epsilon must be > 0" << std::endl;
     return -1;
@@ -0,0 +1,401 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#include <niftkLogHelper.h>
+#include <niftkConversionUtils.h>
+#include <itkImage.h>
+#include <itkImageFileWriter.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkNifTKImageIOFactory.h>
+#include <itkLaplacianSolverImageFilter.h>
+#include <itkHighResLaplacianSolverImageFilter.h>
+#include <itkTimeProbe.h>
+
+#include <cmath>
+#include <iomanip>
+
+/*!
+ * \file niftkCTELaplacianBenchmark.cxx
+ * \page niftkCTELaplacianBenchmark
+ * \section niftkCTELaplacianBenchmarkSummary Times each Laplacian solver used by the cortical thickness methods on a synthetic cortex phantom.
+ */
+void Usage(char *name)
+{
+  niftk::LogHelper::PrintCommandLineHeader(std::cout);
+  std::cout << "  " << std::endl;
+  std::cout << "  Times each solver of Laplaces equation used by the cortical thickness methods," << std::endl;
+  std::cout << "  (Jacobi, Gauss-Seidel, red-black SOR and multigrid), on a synthetic cortex phantom." << std::endl;
+  std::cout << "  The phantom is a sphere of white matter, with a folded surface, inside a shell of grey matter" << std::endl;
+  std::cout << "  of constant thickness, surrounded by CSF. For each solver, it prints the number of iterations," << std::endl;
+  std::cout << "  the time taken, and the largest difference from the Gauss-Seidel solution." << std::endl;
+  std::cout << "  " << std::endl;
+  std::cout << "  " << name << " [options] " << std::endl;
+  std::cout << "  " << std::endl;
+  std::cout << "*** [options]   ***" << std::endl << std::endl;
+  std::cout << "    -dims  <int>   [3]       Dimension of the phantom, 2 or 3" << std::endl;
+  std::cout << "    -size  <int>   [128]     Number of voxels along each axis" << std::endl;
+  std::cout << "    -sp    <float> [0.5]     Voxel size in mm" << std::endl;
+  std::cout << "    -thick <float> [2.5]     Grey matter thickness in mm" << std::endl;
+  std::cout << "    -fold  <float> [0.15]    Amplitude of the folding of the white matter surface, as a fraction of its radius" << std::endl;
+  std::cout << "    -le    <float> [0.00001] Laplacian relaxation convergence ratio (epsilon)" << std::endl;
+  std::cout << "    -li    <int>   [200]     Laplacian relaxation max iterations" << std::endl;
+  std::cout << "    -omega <float> [1.5]     Over-relaxation factor for red-black SOR" << std::endl;
+  std::cout << "    -threads <int>           Number of threads. Default is the ITK default." << std::endl;
+  std::cout << "    -vmf   <int>   [0]       Also time the high resolution solver, with this Voxel Multiplication Factor" << std::endl;
+  std::cout << "    -noJacobi                Don't time the Jacobi solver, which is slow" << std::endl;
+  std::cout << "    -o     <filename>        Write out the phantom" << std::endl;
+}
+
+struct arguments
+{
+  std::string outputImage;
+  int dims;
+  int size;
+  double spacing;
+  double thickness;
+  double fold;
+  double laplaceRatio;
+  int laplaceIters;
+  double omega;
+  int threads;
+  int voxelMultiplicationFactor;
+  bool doJacobi;
+};
+
+template <class TImageType>
+double GetMaximumDifference(TImageType *a, TImageType *b)
+{
+  itk::ImageRegionConstIterator<TImageType> aIterator(a, a->GetLargestPossibleRegion());
+  itk::ImageRegionConstIterator<TImageType> bIterator(b, b->GetLargestPossibleRegion());
+  double maximumDifference = 0;
+
+  for (aIterator.GoToBegin(), bIterator.GoToBegin(); !aIterator.IsAtEnd(); ++aIterator, ++bIterator)
+    {
+      maximumDifference = std::max(maximumDifference, (double)fabs(aIterator.Get() - bIterator.Get()));
+    }
+  return maximumDifference;
+}
+
+template <int Dimension> 
+int DoMain(arguments args)
+{
+  typedef  float ScalarType;
+
+  typedef typename itk::Image< ScalarType, Dimension >  ImageType; 
+  typedef typename itk::ImageFileWriter< ImageType >    ImageWriterType;
+  typedef typename itk::LaplacianSolverImageFilter<ImageType, ScalarType> LaplaceFilterType;
+  typedef typename itk::HighResLaplacianSolverImageFilter<ImageType, ScalarType> HighResLaplaceFilterType;
+
+  const ScalarType whiteMatterLabel = 1;
+  const ScalarType greyMatterLabel = 2;
+  const ScalarType csfLabel = 3;
+
+  /****************************************************************************
+   * Make the phantom. The white matter radius varies with direction, so the
+   * grey matter shell is folded, like gyri and sulci.
+   ***************************************************************************/
+  typename ImageType::SizeType size;
+  typename ImageType::IndexType index;
+  typename ImageType::SpacingType spacing;
+  typename ImageType::RegionType region;
+
+  size.Fill(args.size);
+  index.Fill(0);
+  spacing.Fill(args.spacing);
+  region.SetSize(size);
+  region.SetIndex(index);
+
+  typename ImageType::Pointer phantom = ImageType::New();
+  phantom->SetRegions(region);
+  phantom->SetSpacing(spacing);
+  phantom->Allocate();
+
+  double halfWidth = args.size * args.spacing / 2.0;
+  double whiteMatterRadius = (halfWidth - args.thickness) * 0.6;
+
+  itk::ImageRegionIteratorWithIndex<ImageType> phantomIterator(phantom, phantom->GetLargestPossibleRegion());
+  for (phantomIterator.GoToBegin(); !phantomIterator.IsAtEnd(); ++phantomIterator)
+    {
+      index = phantomIterator.GetIndex();
+
+      double position[Dimension];
+      double radius = 0;
+      for (int i = 0; i < Dimension; i++)
+        {
+          position[i] = (index[i] + 0.5) * args.spacing - halfWidth;
+          radius += position[i] * position[i];
+        }
+      radius = sqrt(radius);
+
+      double folding = sin(6.0 * atan2(position[1], position[0]));
+      if (Dimension > 2 && radius > 0)
+        {
+          folding *= cos(5.0 * acos(position[Dimension - 1] / radius));
+        }
+      double surfaceRadius = whiteMatterRadius * (1.0 + args.fold * folding);
+
+      if (radius < surfaceRadius)
+        {
+          phantomIterator.Set(whiteMatterLabel);
+        }
+      else if (radius < surfaceRadius + args.thickness)
+        {
+          phantomIterator.Set(greyMatterLabel);
+        }
+      else
+        {
+          phantomIterator.Set(csfLabel);
+        }
+    }
+
+  if (args.outputImage.length() > 0)
+    {
+      typename ImageWriterType::Pointer writer = ImageWriterType::New();
+      writer->SetFileName(args.outputImage);
+      writer->SetInput(phantom);
+      writer->Update();
+    }
+
+  /****************************************************************************
+   * Time each solver.
+   ***************************************************************************/
+  const char *solverNames[4] = { "jacobi", "gs", "sor", "mg" };
+  typename LaplaceFilterType::SolverType solvers[4] = {
+    LaplaceFilterType::JACOBI,
+    LaplaceFilterType::GAUSS_SEIDEL,
+    LaplaceFilterType::RED_BLACK_SOR,
+    LaplaceFilterType::MULTIGRID
+  };
+
+  std::cout << std::setw(8) << "Filter" << std::setw(8) << "Solver" << std::setw(12) << "Iterations" 
+            << std::setw(12) << "Time (s)" << std::setw(16) << "Max diff to gs" << std::endl;
+
+  try
+    {
+      typename ImageType::Pointer gaussSeidelOutput;
+
+      for (int solver = 1; solver < 5; solver++)
+        {
+          // Gauss-Seidel goes first, as it is the reference.
+          int solverIndex = solver % 4;
+          if (solverIndex == 0 && !args.doJacobi)
+            {
+              continue;
+            }
+
+          typename LaplaceFilterType::Pointer filter = LaplaceFilterType::New();
+          filter->SetSegmentedImage(phantom);
+          filter->SetLabelThresholds(greyMatterLabel, whiteMatterLabel, csfLabel);
+          filter->SetMaximumNumberOfIterations(args.laplaceIters);
+          filter->SetEpsilonConvergenceThreshold(args.laplaceRatio);
+          filter->SetSolver(solvers[solverIndex]);
+          filter->SetOverRelaxationFactor(args.omega);
+          if (args.threads > 0)
+            {
+              filter->SetNumberOfThreads(args.threads);
+            }
+
+          itk::TimeProbe timer;
+          timer.Start();
+          filter->Update();
+          timer.Stop();
+
+          typename ImageType::Pointer output = filter->GetOutput();
+          output->DisconnectPipeline();
+          if (solverIndex == 1)
+            {
+              gaussSeidelOutput = output;
+            }
+
+          std::cout << std::setw(8) << "lowres" << std::setw(8) << solverNames[solverIndex] 
+                    << std::setw(12) << filter->GetCurrentIteration() 
+                    << std::setw(12) << timer.GetTotal()
+                    << std::setw(16) << GetMaximumDifference<ImageType>(output, gaussSeidelOutput) << std::endl;
+        }
+
+      if (args.voxelMultiplicationFactor > 0)
+        {
+          for (int solverIndex = 1; solverIndex < 4; solverIndex++)
+            {
+              typename HighResLaplaceFilterType::Pointer filter = HighResLaplaceFilterType::New();
+              filter->SetSegmentedImage(phantom);
+              filter->SetLabelThresholds(greyMatterLabel, whiteMatterLabel, csfLabel);
+              filter->SetMaximumNumberOfIterations(args.laplaceIters);
+              filter->SetEpsilonConvergenceThreshold(args.laplaceRatio);
+              filter->SetVoxelMultiplicationFactor(args.voxelMultiplicationFactor);
+              filter->SetSolver(solvers[solverIndex]);
+              filter->SetOverRelaxationFactor(args.omega);
+              if (args.threads > 0)
+                {
+                  filter->SetNumberOfThreads(args.threads);
+                }
+
+              itk::TimeProbe timer;
+              timer.Start();
+              filter->Update();
+              timer.Stop();
+
+              std::cout << std::setw(8) << "highres" << std::setw(8) << solverNames[solverIndex] 
+                        << std::setw(12) << filter->GetCurrentIteration() 
+                        << std::setw(12) << timer.GetTotal()
+                        << std::setw(16) << GetMaximumDifference<ImageType>(filter->GetOutput(), gaussSeidelOutput) << std::endl;
+            }
+        }
+    }
+  catch( itk::ExceptionObject & err ) 
+    { 
+      std::cerr <<"ExceptionObject caught !";
+      std::cerr << err << std::endl; 
+      return -2;
+    }                
+
+  return 0;
+}
+
+/**
+ * \brief Times the Laplacian solvers on a synthetic cortex phantom.
+ */
+int main(int argc, char** argv)
+{
+  itk::NifTKImageIOFactory::Initialize();
+
+  // To pass around command line args
+  struct arguments args;
+
+  // Set defaults
+  args.dims = 3;
+  args.size = 128;
+  args.spacing = 0.5;
+  args.thickness = 2.5;
+  args.fold = 0.15;
+  args.laplaceRatio = 0.00001;
+  args.laplaceIters = 200;
+  args.omega = 1.5;
+  args.threads = 0;
+  args.voxelMultiplicationFactor = 0;
+  args.doJacobi = true;
+
+  // Parse command line args
+  for(int i=1; i < argc; i++){
+    if(strcmp(argv[i], "-help")==0 || strcmp(argv[i], "-Help")==0 || strcmp(argv[i], "-HELP")==0 || strcmp(argv[i], "-h")==0 || strcmp(argv[i], "--h")==0){
+      Usage(argv[0]);
+      return -1;
+    }
+    else if(strcmp(argv[i], "-o") == 0){
+      args.outputImage=argv[++i];
+      std::cout << "Set -o=" << args.outputImage << std::endl;
+    }
+    else if(strcmp(argv[i], "-dims") == 0){
+      args.dims=atoi(argv[++i]);
+      std::cout << "Set -dims=" << niftk::ConvertToString(args.dims) << std::endl;
+    }
+    else if(strcmp(argv[i], "-size") == 0){
+      args.size=atoi(argv[++i]);
+      std::cout << "Set -size=" << niftk::ConvertToString(args.size) << std::endl;
+    }
+    else if(strcmp(argv[i], "-sp") == 0){
+      args.spacing=atof(argv[++i]);
+      std::cout << "Set -sp=" << niftk::ConvertToString(args.spacing) << std::endl;
+    }
+    else if(strcmp(argv[i], "-thick") == 0){
+      args.thickness=atof(argv[++i]);
+      std::cout << "Set -thick=" << niftk::ConvertToString(args.thickness) << std::endl;
+    }
+    else if(strcmp(argv[i], "-fold") == 0){
+      args.fold=atof(argv[++i]);
+      std::cout << "Set -fold=" << niftk::ConvertToString(args.fold) << std::endl;
+    }
+    else if(strcmp(argv[i], "-le") == 0){
+      args.laplaceRatio=atof(argv[++i]);
+      std::cout << "Set -le=" << niftk::ConvertToString(args.laplaceRatio) << std::endl;
+    }
+    else if(strcmp(argv[i], "-li") == 0){
+      args.laplaceIters=atoi(argv[++i]);
+      std::cout << "Set -li=" << niftk::ConvertToString(args.laplaceIters) << std::endl;
+    }
+    else if(strcmp(argv[i], "-omega") == 0){
+      args.omega=atof(argv[++i]);
+      std::cout << "Set -omega=" << niftk::ConvertToString(args.omega) << std::endl;
+    }
+    else if(strcmp(argv[i], "-threads") == 0){
+      args.threads=atoi(argv[++i]);
+      std::cout << "Set -threads=" << niftk::ConvertToString(args.threads) << std::endl;
+    }
+    else if(strcmp(argv[i], "-vmf") == 0){
+      args.voxelMultiplicationFactor=atoi(argv[++i]);
+      std::cout << "Set -vmf=" << niftk::ConvertToString(args.voxelMultiplicationFactor) << std::endl;
+    }
+    else if(strcmp(argv[i], "-noJacobi") == 0){
+      args.doJacobi=false;
+      std::cout << "Set -noJacobi=" << niftk::ConvertToString(!args.doJacobi) << std::endl;
+    }
+    else {
+      std::cerr << argv[0] << ":\tParameter " << argv[i] << " unknown." << std::endl;
+      return -1;
+    }        
+  }
+
+  // Validate command line args
+  if(args.size < 8 ){
+    std::cerr << argv[0] << "\tThe size must be >= 8" << std::endl;
+    return -1;
+  }
+
+  if(args.spacing <= 0 || args.thickness <= 0 ){
+    std::cerr << argv[0] << "\tThe spacing and thickness must be > 0" << std::endl;
+    return -1;
+  }
+
+  if(args.fold < 0 || args.fold >= 1 ){
+    std::cerr << argv[0] << "\tThe fold must be >= 0 and < 1" << std::endl;
+    return -1;
+  }
+
+  if(args.laplaceIters < 1 ){
+    std::cerr << argv[0] << "\tThe iterations must be >= 1" << std::endl;
+    return -1;
+  }
+
+  if(args.laplaceRatio < 0 ){
+    std::cerr << argv[0] << "\tThe epsilon must be > 0" << std::endl;
+    return -1;
+  }
+
+  if(args.omega < 1 || args.omega >= 2 ){
+    std::cerr << argv[0] << "\tThe omega must be >= 1 and < 2" << std::endl;
+    return -1;
+  }
+
+  if(args.voxelMultiplicationFactor < 0 ){
+    std::cerr << argv[0] << "\tThe voxel multiplication factor must be >= 0" << std::endl;
+    return -1;
+  }
+
+  int result;
+  
+  switch ( args.dims )
+    {
+      case 2:
+        result = DoMain<2>(args);
+        break;
+      case 3:
+        result = DoMain<3>(args);
+      break;
+      default:
+        std::cout << "Unsupported image dimension" << std::endl;
+        exit( EXIT_FAILURE );
+    }
+  return result;
+}
@@ -24,7 +24,9 @@
 
 #include <fstream>
 #include <iomanip>
+#include <sstream>
 
+#include <niftkBatchProcessor.h>
 #include <niftkFileHelper.h>
 #include <niftkConversionUtils.h>
 #include <itkCommandLineHelper.h>
@@ -59,8 +61,6 @@ struct arguments
   std::string fileOutputCSV;  
 
   bool flgVerbose;
-
-  std::string iterFilename;
 };
 
 
@@ -100,19 +100,13 @@ void PrintDictionary( DictionaryType &dictionary )
 
 template < unsigned int InputDimension,
            class OutputPixelType >
-int DoMain(arguments args, 
-           std::vector<std::string> &tagList,
-           std::fstream &foutTagsCSV)
+int DoMain(const arguments &args, 
+           const std::vector<std::string> &tagList,
+           niftk::BatchProcessor::Job &job)
 {
-  itksys_ios::ostringstream value;
-
+  std::ostream &log = job.GetLog();
+  std::ostream &foutTagsCSV = job.GetOutput();
 
-  std::string fileInputFullPath;
-  std::string fileInputRelativePath;
-  std::string fileOutputRelativePath;
-  std::string fileOutputFullPath;
-  std::string dirOutputFullPath;
-    
   typedef float InternalPixelType;
 
   typedef itk::Image< InternalPixelType, InputDimension > InternalImageType; 
@@ -128,22 +122,20 @@ int DoMain(arguments args,
   // Read the image
 
   reader->SetImageIO( gdcmImageIO );
-  reader->SetFileName( args.iterFilename );
+  reader->SetFileName( job.GetFileName() );
     
   try
   {
+    niftk::BatchProcessor::IOSection io( job );
     reader->UpdateLargestPossibleRegion();
   }
 
   catch (itk::ExceptionObject &ex)
   {
-    std::cout << "WARNING: Skipping file (not DICOM?): " << args.iterFilename << std::endl;
+    log << "WARNING: Skipping file (not DICOM?): " << job.GetFileName() << std::endl;
     return EXIT_FAILURE;
   }
 
-  std::cout << "File: " << args.iterFilename << std::endl;
-
-
   image = reader->GetOutput();
   image->DisconnectPipeline();
 
@@ -158,11 +150,11 @@ int DoMain(arguments args,
   std::string tagID;
   std::string tagValue;
 
-  std::vector< std::string >::iterator iterTags;     
+  std::vector< std::string >::const_iterator iterTags;     
 
   MetaDataStringType::ConstPointer entryvalue;
 
-  foutTagsCSV << boost::filesystem::canonical( args.iterFilename );
+  foutTagsCSV << boost::filesystem::canonical( job.GetFileName() );
 
   // Get each tag
 
@@ -186,8 +178,8 @@ int DoMain(arguments args,
 
         if ( args.flgVerbose )
         {
-          std::cout << std::setw(12) << iTag << " Tag (" << *iterTags <<  ") " << tagID
-                    << " is: " << tagValue << std::endl;
+          log << std::setw(12) << iTag << " Tag (" << *iterTags <<  ") " << tagID
+              << " is: " << tagValue << std::endl;
         }
       }
     }
@@ -203,13 +195,173 @@ int DoMain(arguments args,
   }
 
   foutTagsCSV << std::endl;
-  std::cout << std::endl;
 
 
   return EXIT_SUCCESS;
 }
 
 
+// -------------------------------------------------------------------------
+// ProcessFile()
+// -------------------------------------------------------------------------
+
+void ProcessFile( const arguments &args,
+                  const std::vector<std::string> &tagList,
+                  niftk::BatchProcessor::Job &job )
+{
+  std::ostream &log = job.GetLog();
+  const std::string &iterFilename = job.GetFileName();
+
+  log << "File: " << iterFilename << std::endl;
+
+  itk::ImageIOBase::Pointer imageIO;
+  unsigned int dims;
+  itk::ImageIOBase::IOComponentType componentType;
+
+  try
+  {
+    niftk::BatchProcessor::IOSection io( job );
+
+    imageIO = itk::ImageIOFactory::CreateImageIO(iterFilename.c_str(), 
+                                                 itk::ImageIOFactory::ReadMode);
+
+    if ( ( ! imageIO ) || ( ! imageIO->CanReadFile( iterFilename.c_str() ) ) )
+    {
+      log << "WARNING: Failed to read DICOM tags, skipping file: " 
+          << iterFilename << std::endl << std::endl;
+      return;
+    }
+
+    dims = itk::PeekAtImageDimensionFromSizeInVoxels(iterFilename);
+    componentType = itk::PeekAtComponentType(iterFilename);
+  }
+
+  catch (itk::ExceptionObject &ex)
+  {
+    log << "WARNING: Failed to read DICOM tags, skipping file: "
+        << iterFilename << std::endl << std::endl;
+    return;
+  }
+
+
+  int result;
+
+  switch ( dims )
+  {
+  case 2:
+  {
+    switch ( componentType )
+    {
+    case itk::ImageIOBase::UCHAR:
+      result = DoMain<2, unsigned char>(args, tagList, job);  
+      break;
+    
+    case itk::ImageIOBase::CHAR:
+      result = DoMain<2, char>(args, tagList, job);  
+      break;
+
+    case itk::ImageIOBase::USHORT:
+      result = DoMain<2, unsigned short>(args, tagList, job);  
+      break;
+
+    case itk::ImageIOBase::SHORT:
+      result = DoMain<2, short>(args, tagList, job);  
+      break;
+
+    case itk::ImageIOBase::UINT:
+      result = DoMain<2, unsigned int>(args, tagList, job);  
+      break;
+
+    case itk::ImageIOBase::INT:
+      result = DoMain<2, int>(args, tagList, job);  
+      break;
+
+    case itk::ImageIOBase::ULONG:
+      result = DoMain<2, unsigned long>(args, tagList, job);  
+      break;
+
+    case itk::ImageIOBase::LONG:
+      result = DoMain<2, long>(args, tagList, job);  
+      break;
+
+    case itk::ImageIOBase::FLOAT:
+      result = DoMain<2, float>(args, tagList, job);  
+      break;
+
+    case itk::ImageIOBase::DOUBLE:
+      result = DoMain<2, double>(args, tagList, job);  
+      break;
+
+    default:
+      log << "WARNING: Unrecognised pixel type, skipping file: " 
+          << iterFilename << std::endl;
+    }
+
+    break;
+  }
+
+  case 3:
+  {
+    switch ( componentType )
+    {
+    case itk::ImageIOBase::UCHAR:
+      result = DoMain<3, unsigned char>(args, tagList, job);  
+      break;
+    
+    case itk::ImageIOBase::CHAR:
+      result = DoMain<3, char>(args, tagList, job);  
+      break;
+
+    case itk::ImageIOBase::USHORT:
+      result = DoMain<3, unsigned short>(args, tagList, job);  
+      break;
+
+    case itk::ImageIOBase::SHORT:
+      result = DoMain<3, short>(args, tagList, job);  
+      break;
+
+    case itk::ImageIOBase::UINT:
+      result = DoMain<3, unsigned int>(args, tagList, job);  
+      break;
+
+    case itk::ImageIOBase::INT:
+      result = DoMain<3, int>(args, tagList, job);  
+      break;
+
+    case itk::ImageIOBase::ULONG:
+      result = DoMain<3, unsigned long>(args, tagList, job);  
+      break;
+
+    case itk::ImageIOBase::LONG:
+      result = DoMain<3, long>(args, tagList, job);  
+      break;
+
+    case itk::ImageIOBase::FLOAT:
+      result = DoMain<3, float>(args, tagList, job);  
+      break;
+
+    case itk::ImageIOBase::DOUBLE:
+      result = DoMain<3, double>(args, tagList, job);  
+      break;
+
+    default:
+      log << "WARNING: Unrecognised pixel type, skipping file: " 
+          << iterFilename << std::endl;
+    }
+
+    break;
+  }
+
+  default:
+  {
+    log << "WARNING: Unsupported image dimension (" << dims << ") for file: " 
+        << iterFilename << std::endl;
+  }
+  }
+
+  log << std::endl;
+}
+
 
 // -------------------------------------------------------------------------
 // main()
@@ -219,10 +371,6 @@ int main( int argc, char *argv[] )
 {
   itk::NifTKImageIOFactory::Initialize();
 
-  float progress = 0.0f;
-  float iFile = 0.0f;
-  float nFiles;
-
   struct arguments args;
 
   // Validate command line args
@@ -245,6 +393,13 @@ int main( int argc, char *argv[] )
     return EXIT_FAILURE;
   }
 
+  if ( nThreads < 0 || nIOJobs < 0 || nComputeJobs < 0 )
+  {
+    commandLine.getOutput()->usage(commandLine);
+    std::cerr << "ERROR: The numbers of threads and jobs must not be negative" << std::endl;
+    return EXIT_FAILURE;
+  }
+
   args.dcmDirectoryIn   = dcmDirectoryIn;                     
   args.fileInputTagKeys = fileInputTagKeys;                    
   args.fileOutputCSV    = fileOutputCSV;                    
@@ -256,19 +411,33 @@ int main( int argc, char *argv[] )
 	    << args.dcmDirectoryIn << std::endl << std::endl;
 
 
-  // Open the output csv file
-  // ~~~~~~~~~~~~~~~~~~~~~~~~
+  // Open the output csv file, adding to it if an interrupted run is being resumed
+  // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+  bool flgResume = ( fileProgress.length() > 0 )
+    && niftk::FileIsRegular( fileProgress ) && ( ! niftk::FileIsEmpty( fileProgress ) )
+    && niftk::FileIsRegular( fileOutputCSV );
 
   std::fstream foutTagsCSV;
 
-  foutTagsCSV.open( fileOutputCSV.c_str(), std::ios::out );
+  if ( flgResume )
+  {
+    std::cout << "Resuming, adding to: " << fileOutputCSV << std::endl;
+    foutTagsCSV.open( fileOutputCSV.c_str(), std::ios::out | std::ios::app );
+  }
+  else
+  {
+    foutTagsCSV.open( fileOutputCSV.c_str(), std::ios::out );
+  }
 
   if ((! foutTagsCSV) || foutTagsCSV.bad()) {
     std::cerr << "ERROR: Failed to open file: " << fileOutputCSV.c_str() << std::endl;
     return EXIT_FAILURE;   
   }
 
-  foutTagsCSV << "\"File Name\"";
+  std::ostringstream csvHeader;
+
+  csvHeader << "\"File Name\"";
 
 
   // Read the list of tags
@@ -306,7 +475,7 @@ int main( int argc, char *argv[] )
           std::cout << std::setw(12) << nTags << ": " 
                     << tmp << " " << tagID << std::endl;
 
-          foutTagsCSV << ",\"" << tmp << " " << tagID << "\"";
+          csvHeader << ",\"" << tmp << " " << tagID << "\"";
         }
         else 
         {
@@ -317,7 +486,7 @@ int main( int argc, char *argv[] )
     }                                                                                   
   }                                                                                     
 
-  foutTagsCSV << std::endl;
+  csvHeader << std::endl;
 
   if ( nTags == 0 )                      
   {                                                                                       
@@ -328,181 +497,59 @@ int main( int argc, char *argv[] )
 
   finTagKeys.close();
 
+  if ( ! flgResume )
+  {
+    foutTagsCSV << csvHeader.str();
+  }
+
 
   // Get the list of files in the directory
   // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
   std::vector< std::string > fileNames;
-  std::vector< std::string >::iterator iterFileNames;       
 
-  niftk::GetRecursiveFilesInDirectory( dcmDirectoryIn, fileNames );
+  niftk::GetRecursiveFilesInDirectory( dcmDirectoryIn, fileNames, nIOJobs );
 
-  nFiles = fileNames.size();
 
-  for ( iterFileNames = fileNames.begin(); iterFileNames < fileNames.end(); ++iterFileNames, iFile += 1.0f )
-  {
-    args.iterFilename = *iterFileNames;
-    
-    std::cout << "File: " << args.iterFilename << std::endl;
-
-    progress = iFile/nFiles;
-    std::cout << "<filter-progress>" << std::endl
-              << progress << std::endl
-              << "</filter-progress>" << std::endl;
+  // Read the tags of each file, writing the rows in the order of the files
+  // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
-  
-    itk::ImageIOBase::Pointer imageIO;
+  niftk::BatchProcessor processor;
 
-    try
-    {
-      imageIO = itk::ImageIOFactory::CreateImageIO(args.iterFilename.c_str(), 
-                                                   itk::ImageIOFactory::ReadMode);
+  processor.SetNumberOfThreads( nThreads );
+  processor.SetMaximumNumberOfIOJobs( nIOJobs );
+  processor.SetMaximumNumberOfComputeJobs( nComputeJobs );
+  processor.SetOutputStream( &foutTagsCSV );
+  processor.SetProgressFileName( fileProgress );
+  processor.SetReportProgress( true );
 
-      if ( ( ! imageIO ) || ( ! imageIO->CanReadFile( args.iterFilename.c_str() ) ) )
-      {
-        std::cerr << "WARNING: Failed to read DICOM tags, skipping file: " 
-                  << args.iterFilename << std::endl;
-        continue;
-      }
-
-
-      unsigned int dims = itk::PeekAtImageDimensionFromSizeInVoxels(args.iterFilename);
-
-      if (dims != 3 && dims != 2)
-      {
-        std::cout << "WARNING: Unsupported image dimension (" << dims << ") for file: " 
-                  << args.iterFilename << std::endl;
-        continue;
-      }
-
-
-      int result;
-
-      switch ( dims )
-      {
-      case 2:
-      {
-        switch (itk::PeekAtComponentType(args.iterFilename))
-        {
-        case itk::ImageIOBase::UCHAR:
-          result = DoMain<2, unsigned char>(args, tagList, foutTagsCSV);  
-          break;
-    
-        case itk::ImageIOBase::CHAR:
-          result = DoMain<2, char>(args, tagList, foutTagsCSV);  
-          break;
-
-        case itk::ImageIOBase::USHORT:
-          result = DoMain<2, unsigned short>(args, tagList, foutTagsCSV);  
-          break;
-
-        case itk::ImageIOBase::SHORT:
-          result = DoMain<2, short>(args, tagList, foutTagsCSV);  
-          break;
-
-        case itk::ImageIOBase::UINT:
-          result = DoMain<2, unsigned int>(args, tagList, foutTagsCSV);  
-          break;
-
-        case itk::ImageIOBase::INT:
-          result = DoMain<2, int>(args, tagList, foutTagsCSV);  
-          break;
-
-        case itk::ImageIOBase::ULONG:
-          result = DoMain<2, unsigned long>(args, tagList, foutTagsCSV);  
-          break;
-
-        case itk::ImageIOBase::LONG:
-          result = DoMain<2, long>(args, tagList, foutTagsCSV);  
-          break;
-
-        case itk::ImageIOBase::FLOAT:
-          result = DoMain<2, float>(args, tagList, foutTagsCSV);  
-          break;
-
-        case itk::ImageIOBase::DOUBLE:
-          result = DoMain<2, double>(args, tagList, foutTagsCSV);  
-          break;
-
-        default:
-          std::cerr << "WARNING: Unrecognised pixel type, skipping file: " 
-                    << args.iterFilename << std::endl;
-        }
-
-        break;
-      }
-
-      case 3:
-      {
-        switch (itk::PeekAtComponentType(args.iterFilename))
-        {
-        case itk::ImageIOBase::UCHAR:
-          result = DoMain<3, unsigned char>(args, tagList, foutTagsCSV);  
-          break;
-    
-        case itk::ImageIOBase::CHAR:
-          result = DoMain<3, char>(args, tagList, foutTagsCSV);  
-          break;
-
-        case itk::ImageIOBase::USHORT:
-          result = DoMain<3, unsigned short>(args, tagList, foutTagsCSV);  
-          break;
-
-        case itk::ImageIOBase::SHORT:
-          result = DoMain<3, short>(args, tagList, foutTagsCSV);  
-          break;
-
-        case itk::ImageIOBase::UINT:
-          result = DoMain<3, unsigned int>(args, tagList, foutTagsCSV);  
-          break;
-
-        case itk::ImageIOBase::INT:
-          result = DoMain<3, int>(args, tagList, foutTagsCSV);  
-          break;
-
-        case itk::ImageIOBase::ULONG:
-          result = DoMain<3, unsigned long>(args, tagList, foutTagsCSV);  
-          break;
-
-        case itk::ImageIOBase::LONG:
-          result = DoMain<3, long>(args, tagList, foutTagsCSV);  
-          break;
-
-        case itk::ImageIOBase::FLOAT:
-          result = DoMain<3, float>(args, tagList, foutTagsCSV);  
-          break;
-
-        case itk::ImageIOBase::DOUBLE:
-          result = DoMain<3, double>(args, tagList, foutTagsCSV);  
-          break;
-
-        default:
-          std::cerr << "WARNING: Unrecognised pixel type, skipping file: " 
-                    << args.iterFilename << std::endl;
-        }
-
-        break;
-      }
-
-      default:
-      {
-        std::cout << "WARNING: Unsupported image dimension (" << dims << ") for file: " 
-                  << args.iterFilename << std::endl;
-      }
-      }
+  try
+  {
+    processor.Run( fileNames,
+                   [&args, &tagList]( niftk::BatchProcessor::Job &job )
+                   {
+                     ProcessFile( args, tagList, job );
+                   } );
+  }
+  catch (std::exception &e)
+  {
+    std::cerr << "ERROR: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
 
-      std::cout << std::endl;
-    }
+  foutTagsCSV.close();
 
-    catch (itk::ExceptionObject &ex)
-    {
-      std::cerr << "WARNING: Failed to read DICOM tags, skipping file: "
-                << args.iterFilename << std::endl;
-      continue;
-    }
+  if ( processor.GetNumberOfSkippedFiles() > 0 )
+  {
+    std::cout << "Skipped " << processor.GetNumberOfSkippedFiles()
+              << " files already listed in: " << fileProgress << std::endl;
   }
 
-  foutTagsCSV.close();
+  if ( processor.GetFailedFileNames().size() > 0 )
+  {
+    std::cerr << "WARNING: Failed to read DICOM tags of "
+              << processor.GetFailedFileNames().size() << " files" << std::endl;
+  }
 
   return EXIT_SUCCESS;
 }
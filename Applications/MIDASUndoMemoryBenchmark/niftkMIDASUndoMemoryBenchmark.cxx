@@ -0,0 +1,259 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#include <niftkLogHelper.h>
+#include <niftkConversionUtils.h>
+#include <itkImage.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <itkMIDASImageUpdateClearRegionProcessor.h>
+#include <itkMIDASImageUpdatePasteRegionProcessor.h>
+#include <itkMIDASImageUpdateHistory.h>
+#include <itkTimeProbe.h>
+
+#include <iomanip>
+#include <vector>
+
+/*!
+ * \file niftkMIDASUndoMemoryBenchmark.cxx
+ * \page niftkMIDASUndoMemoryBenchmark
+ * \section niftkMIDASUndoMemoryBenchmarkSummary Compares the memory used for undo/redo by the MIDAS image update processors, when keeping copies of the whole region, and when keeping only the changed voxels.
+ */
+void Usage(char *name)
+{
+  niftk::LogHelper::PrintCommandLineHeader(std::cout);
+  std::cout << "  " << std::endl;
+  std::cout << "  Compares the memory used for undo/redo by the MIDAS image update processors, when keeping" << std::endl;
+  std::cout << "  copies of the whole region before and after each operation, and when keeping only the changed voxels." << std::endl;
+  std::cout << "  Simulates an editing session on a binary segmentation, of propagating a growing blob up and down" << std::endl;
+  std::cout << "  from the middle slice, with a wipe of a few slices every third operation." << std::endl;
+  std::cout << "  " << std::endl;
+  std::cout << "  " << name << " [options] " << std::endl;
+  std::cout << "  " << std::endl;
+  std::cout << "*** [options]   ***" << std::endl << std::endl;
+  std::cout << "    -size   <int>   [256]    Number of voxels along the in-plane axes" << std::endl;
+  std::cout << "    -slices <int>   [200]    Number of slices" << std::endl;
+  std::cout << "    -ops    <int>   [20]     Number of operations" << std::endl;
+  std::cout << "    -limit  <int>   [0]      Memory limit for undo data, in MB. Default 0, which means no limit" << std::endl;
+}
+
+struct arguments
+{
+  int size;
+  int slices;
+  int operations;
+  int limit;
+};
+
+typedef itk::Image<unsigned char, 3>                                  ImageType;
+typedef itk::MIDASImageUpdatePasteRegionProcessor<unsigned char, 3>   PasteProcessorType;
+typedef itk::MIDASImageUpdateClearRegionProcessor<unsigned char, 3>   ClearProcessorType;
+typedef itk::MIDASImageUpdateRegionProcessor<unsigned char, 3>        RegionProcessorType;
+
+ImageType::Pointer CreateImage(const arguments& args)
+{
+  ImageType::SizeType size;
+  size[0] = args.size;
+  size[1] = args.size;
+  size[2] = args.slices;
+  ImageType::IndexType index;
+  index.Fill(0);
+  ImageType::RegionType region;
+  region.SetSize(size);
+  region.SetIndex(index);
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(region);
+  image->Allocate();
+  image->FillBuffer(0);
+  return image;
+}
+
+/**
+ * Fills the source image with an ellipsoid blob that grows with the operation number, like the output of region growing.
+ */
+void FillBlob(ImageType* image, const arguments& args, int operation)
+{
+  double radius = args.size * (0.1 + 0.3 * operation / args.operations);
+  double centre = args.size / 2.0;
+  double sliceCentre = args.slices / 2.0;
+
+  itk::ImageRegionIteratorWithIndex<ImageType> iterator(image, image->GetLargestPossibleRegion());
+  for (iterator.GoToBegin(); !iterator.IsAtEnd(); ++iterator)
+  {
+    ImageType::IndexType index = iterator.GetIndex();
+    double x = (index[0] - centre) / radius;
+    double y = (index[1] - centre) / (0.8 * radius);
+    double z = (index[2] - sliceCentre) / (0.4 * args.slices);
+    iterator.Set(x * x + y * y + z * z < 1.0 ? 1 : 0);
+  }
+}
+
+/**
+ * Runs the editing session, keeping the processors as the undo stack would, and returns the total bytes of undo data.
+ */
+std::size_t RunSession(const arguments& args, bool storeDifferencesOnly, std::vector<std::size_t>& bytesPerOperation, double& seconds)
+{
+  ImageType::Pointer segmentation = CreateImage(args);
+  ImageType::Pointer source = CreateImage(args);
+
+  std::vector<RegionProcessorType::Pointer> undoStack;
+  itk::TimeProbe timer;
+
+  for (int operation = 0; operation < args.operations; operation++)
+  {
+    ImageType::RegionType region = segmentation->GetLargestPossibleRegion();
+    ImageType::IndexType regionIndex = region.GetIndex();
+    ImageType::SizeType regionSize = region.GetSize();
+
+    RegionProcessorType::Pointer processor;
+
+    if (operation % 3 == 2)
+    {
+      // Wipe a few slices either side of the middle.
+      regionIndex[2] = args.slices / 2 - 2;
+      regionSize[2] = 5;
+      region.SetIndex(regionIndex);
+      region.SetSize(regionSize);
+
+      ClearProcessorType::Pointer clearProcessor = ClearProcessorType::New();
+      clearProcessor->SetWipeValue(0);
+      processor = clearProcessor;
+    }
+    else
+    {
+      // Propagate up or down, which pastes into half the volume.
+      if (operation % 2 == 0)
+      {
+        regionIndex[2] = args.slices / 2;
+        regionSize[2] = args.slices - args.slices / 2;
+      }
+      else
+      {
+        regionSize[2] = args.slices / 2 + 1;
+      }
+      region.SetIndex(regionIndex);
+      region.SetSize(regionSize);
+
+      FillBlob(source, args, operation);
+
+      PasteProcessorType::Pointer pasteProcessor = PasteProcessorType::New();
+      pasteProcessor->SetSourceImage(source);
+      pasteProcessor->SetSourceRegionOfInterest(region);
+      pasteProcessor->SetCopyBackground(false);
+      processor = pasteProcessor;
+    }
+
+    processor->SetStoreDifferencesOnly(storeDifferencesOnly);
+    processor->SetDestinationImage(segmentation);
+    processor->SetDestinationRegionOfInterest(region);
+
+    timer.Start();
+    processor->Redo();
+    processor->Undo();
+    processor->Redo();
+    timer.Stop();
+
+    segmentation = processor->GetDestinationImage();
+    bytesPerOperation.push_back(processor->GetUndoDataSize());
+    undoStack.push_back(processor);
+  }
+
+  std::size_t totalBytes = 0;
+  for (std::size_t i = 0; i < undoStack.size(); i++)
+  {
+    totalBytes += undoStack[i]->GetUndoDataSize();
+  }
+
+  seconds = timer.GetTotal();
+  return totalBytes;
+}
+
+/**
+ * \brief Benchmarks the memory used for undo/redo by the MIDAS image update processors.
+ */
+int main(int argc, char** argv)
+{
+  // To pass around command line args
+  struct arguments args;
+
+  // Set defaults
+  args.size = 256;
+  args.slices = 200;
+  args.operations = 20;
+  args.limit = 0;
+
+  // Parse command line args
+  for(int i=1; i < argc; i++){
+    if(strcmp(argv[i], "-help")==0 || strcmp(argv[i], "-Help")==0 || strcmp(argv[i], "-HELP")==0 || strcmp(argv[i], "-h")==0 || strcmp(argv[i], "--h")==0){
+      Usage(argv[0]);
+      return -1;
+    }
+    else if(strcmp(argv[i], "-size") == 0){
+      args.size=atoi(argv[++i]);
+      std::cout << "Set -size=" << niftk::ConvertToString(args.size) << std::endl;
+    }
+    else if(strcmp(argv[i], "-slices") == 0){
+      args.slices=atoi(argv[++i]);
+      std::cout << "Set -slices=" << niftk::ConvertToString(args.slices) << std::endl;
+    }
+    else if(strcmp(argv[i], "-ops") == 0){
+      args.operations=atoi(argv[++i]);
+      std::cout << "Set -ops=" << niftk::ConvertToString(args.operations) << std::endl;
+    }
+    else if(strcmp(argv[i], "-limit") == 0){
+      args.limit=atoi(argv[++i]);
+      std::cout << "Set -limit=" << niftk::ConvertToString(args.limit) << std::endl;
+    }
+    else {
+      std::cerr << argv[0] << ":\tParameter " << argv[i] << " unknown." << std::endl;
+      return -1;
+    }
+  }
+
+  // Validate command line args
+  if (args.size < 8 || args.slices < 8 || args.operations < 1 || args.limit < 0)
+  {
+    std::cerr << argv[0] << "\tThe size and slices must be >= 8, the number of operations >= 1, and the limit >= 0" << std::endl;
+    return -1;
+  }
+
+  itk::MIDASImageUpdateHistory::SetMemoryLimit(static_cast<std::size_t>(args.limit) * 1024 * 1024);
+
+  try
+    {
+      std::vector<std::size_t> denseBytes;
+      std::vector<std::size_t> differencesBytes;
+      double denseSeconds = 0;
+      double differencesSeconds = 0;
+
+      std::size_t denseTotal = RunSession(args, false, denseBytes, denseSeconds);
+      std::size_t differencesTotal = RunSession(args, true, differencesBytes, differencesSeconds);
+
+      std::cout << std::setw(10) << "Operation" << std::setw(20) << "Dense (bytes)" << std::setw(20) << "Differences (bytes)" << std::endl;
+      for (std::size_t i = 0; i < denseBytes.size(); i++)
+        {
+          std::cout << std::setw(10) << i << std::setw(20) << denseBytes[i] << std::setw(20) << differencesBytes[i] << std::endl;
+        }
+      std::cout << std::setw(10) << "Total" << std::setw(20) << denseTotal << std::setw(20) << differencesTotal << std::endl;
+      std::cout << std::setw(10) << "Time (s)" << std::setw(20) << denseSeconds << std::setw(20) << differencesSeconds << std::endl;
+    }
+  catch( itk::ExceptionObject & err ) 
+    { 
+      std::cerr <<"ExceptionObject caught !";
+      std::cerr << err << std::endl; 
+      return -2;
+    }                
+
+  return 0;
+}
@@ -53,6 +53,9 @@ struct arguments
   bool flgIgnoreView;
   bool flgSSD;
 
+  int coarseSearchStep;
+  int nSearchCandidates;
+
   std::string inputImage;
   std::string maskImage;
 
@@ -66,6 +69,9 @@ struct arguments
     flgDebug = false;
     flgIgnoreView = false;
     flgSSD = false;
+
+    coarseSearchStep = 1;
+    nSearchCandidates = 8;
   }
 };
 
@@ -275,6 +281,9 @@ int DoMain(arguments args)
   pecFilter->SetDebug( args.flgDebug );
   pecFilter->SetSSD( args.flgSSD );
 
+  pecFilter->SetCoarseSearchStep( args.coarseSearchStep );
+  pecFilter->SetNumberOfSearchCandidates( args.nSearchCandidates );
+
   pecFilter->SetMask( mask );
   
   try
@@ -447,6 +456,9 @@ int main(int argc, char** argv)
   args.flgIgnoreView       = flgIgnoreView;
   args.flgSSD              = flgSSD;
 
+  args.coarseSearchStep    = coarseSearchStep;
+  args.nSearchCandidates   = nSearchCandidates;
+
   args.inputImage     = inputImage;
   args.maskImage      = maskImage;
   args.outputMask     = outputMask;
@@ -468,6 +480,12 @@ int main(int argc, char** argv)
     return EXIT_FAILURE;
   }
 
+  if ( ( args.coarseSearchStep < 1 ) || ( args.nSearchCandidates < 1 ) )
+  {
+    std::cerr << "ERROR: The coarse search step and number of search candidates must be at least 1" << std::endl;
+    return EXIT_FAILURE;
+  }
+
 
   int dims = itk::PeekAtImageDimensionFromSizeInVoxels(args.inputImage);
   if (dims != 2)
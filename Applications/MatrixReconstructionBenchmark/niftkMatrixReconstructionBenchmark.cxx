@@ -0,0 +1,276 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#include <niftkLogHelper.h>
+#include <niftkConversionUtils.h>
+#include <itkEulerAffineTransformMatrixAndItsVariations.h>
+#include <itkCompressedSparseRowMatrix.h>
+#include <itkTimeProbe.h>
+#include <vnl/vnl_sparse_matrix.h>
+#include <vnl/vnl_vector.h>
+#include <vnl/vnl_random.h>
+
+#include <cmath>
+#include <iomanip>
+
+/*!
+ * \file niftkMatrixReconstructionBenchmark.cxx
+ * \page niftkMatrixReconstructionBenchmark
+ * \section niftkMatrixReconstructionBenchmarkSummary Times the affine transformation matrix of the matrix based reconstruction and registration metrics, as a vnl_sparse_matrix and as a compressed sparse row matrix.
+ */
+void Usage(char *name)
+{
+  niftk::LogHelper::PrintCommandLineHeader(std::cout);
+  std::cout << "  " << std::endl;
+  std::cout << "  Times the affine transformation matrix, R, used by the matrix based reconstruction and registration" << std::endl;
+  std::cout << "  metrics, on a synthetic volume. R is built as a vnl_sparse_matrix, then copied to a compressed sparse" << std::endl;
+  std::cout << "  row matrix, as the metrics used to, and built straight into compressed sparse row blocks, as they do now." << std::endl;
+  std::cout << "  Then the products R x and R^T x are timed with each. For each, it prints the time taken, and the" << std::endl;
+  std::cout << "  largest difference from the vnl_sparse_matrix." << std::endl;
+  std::cout << "  " << std::endl;
+  std::cout << "  " << name << " [options] " << std::endl;
+  std::cout << "  " << std::endl;
+  std::cout << "*** [options]   ***" << std::endl << std::endl;
+  std::cout << "    -size    <int>   [48]      Number of voxels along each axis" << std::endl;
+  std::cout << "    -rot     <float> [10]      Rotation about each axis in degrees" << std::endl;
+  std::cout << "    -trans   <float> [1.5]     Translation along each axis in voxels" << std::endl;
+  std::cout << "    -scale   <float> [1.05]    Scale along each axis" << std::endl;
+  std::cout << "    -repeats <int>   [10]      Number of times each product is repeated" << std::endl;
+  std::cout << "    -threads <int>             Number of threads. Default is the ITK default." << std::endl;
+}
+
+struct arguments
+{
+  int size;
+  double rotation;
+  double translation;
+  double scale;
+  int repeats;
+  int threads;
+};
+
+typedef itk::EulerAffineTransformMatrixAndItsVariations<double>  AffineTransformerType;
+typedef AffineTransformerType::SparseMatrixType                  SparseMatrixType;
+typedef AffineTransformerType::CompressedSparseRowMatrixType     CompressedSparseRowMatrixType;
+typedef AffineTransformerType::VectorType                        VectorType;
+
+double GetMaximumDifference(const VectorType &a, const VectorType &b)
+{
+  double maximumDifference = 0;
+
+  for (unsigned int i = 0; i < a.size(); i++)
+    {
+      maximumDifference = std::max(maximumDifference, fabs(a[i] - b[i]));
+    }
+  return maximumDifference;
+}
+
+void PrintRow(const std::string &step, const std::string &matrix, double time, double maximumDifference)
+{
+  std::cout << std::setw(12) << step << std::setw(8) << matrix
+            << std::setw(12) << time
+            << std::setw(16) << maximumDifference << std::endl;
+}
+
+int DoMain(arguments args)
+{
+  AffineTransformerType::VolumeSizeType volumeSize;
+  volumeSize.Fill(args.size);
+
+  const unsigned long int totalSize = volumeSize[0] * volumeSize[1] * volumeSize[2];
+
+  // Translations, rotations in degrees, scales and skews
+  AffineTransformerType::EulerAffineTransformParametersType parameters(12);
+  parameters.Fill(0.);
+  for (unsigned int i = 0; i < 3; i++)
+    {
+      parameters[i] = args.translation;
+      parameters[i + 3] = args.rotation;
+      parameters[i + 6] = args.scale;
+    }
+
+  vnl_random random(1357);
+
+  VectorType x(totalSize);
+  for (unsigned int i = 0; i < x.size(); i++)
+    {
+      x[i] = random.drand64(0, 1);
+    }
+
+  std::cout << std::setw(12) << "Step" << std::setw(8) << "Matrix"
+            << std::setw(12) << "Time (s)" << std::setw(16) << "Max diff to vnl" << std::endl;
+
+  try
+    {
+      AffineTransformerType::Pointer transformer = AffineTransformerType::New();
+      if (args.threads > 0)
+        {
+          transformer->SetNumberOfThreads(args.threads);
+        }
+
+      /**************************************************************************
+       * Build R, as a vnl_sparse_matrix copied to compressed sparse rows, and
+       * straight into compressed sparse row blocks.
+       *************************************************************************/
+      itk::TimeProbe vnlTimer;
+      vnlTimer.Start();
+      SparseMatrixType vnlMatrix(totalSize, totalSize);
+      transformer->GetAffineTransformationSparseMatrix(vnlMatrix, volumeSize, parameters);
+      vnlTimer.Stop();
+
+      itk::TimeProbe copyTimer;
+      copyTimer.Start();
+      CompressedSparseRowMatrixType copiedMatrix;
+      copiedMatrix.SetNumberOfThreads(transformer->GetNumberOfThreads());
+      copiedMatrix.SetSparseMatrix(vnlMatrix);
+      copyTimer.Stop();
+
+      itk::TimeProbe csrTimer;
+      csrTimer.Start();
+      CompressedSparseRowMatrixType csrMatrix;
+      transformer->GetAffineTransformationSparseMatrix(csrMatrix, volumeSize, parameters);
+      csrTimer.Stop();
+
+      PrintRow("build", "vnl", vnlTimer.GetTotal(), 0);
+      PrintRow("build+copy", "csr", vnlTimer.GetTotal() + copyTimer.GetTotal(), 0);
+      PrintRow("build", "csr", csrTimer.GetTotal(), 0);
+
+      if (csrMatrix.GetNumberOfNonZeros() != copiedMatrix.GetNumberOfNonZeros())
+        {
+          std::cerr << "The matrix built into row blocks has " << csrMatrix.GetNumberOfNonZeros()
+                    << " non-zeros, but the vnl one has " << copiedMatrix.GetNumberOfNonZeros() << std::endl;
+          return EXIT_FAILURE;
+        }
+
+      /**************************************************************************
+       * Time R x and R^T x, as the metrics do at each evaluation.
+       *************************************************************************/
+      VectorType vnlRx;
+      VectorType vnlRTx;
+      VectorType csrRx;
+      VectorType csrRTx;
+
+      itk::TimeProbe vnlMultiplyTimer;
+      itk::TimeProbe vnlTransposeTimer;
+      itk::TimeProbe csrMultiplyTimer;
+      itk::TimeProbe csrTransposeTimer;
+
+      for (int i = 0; i < args.repeats; i++)
+        {
+          vnlMultiplyTimer.Start();
+          vnlMatrix.mult(x, vnlRx);
+          vnlMultiplyTimer.Stop();
+
+          // x^T R = (R^T x)^T
+          vnlTransposeTimer.Start();
+          vnlMatrix.pre_mult(x, vnlRTx);
+          vnlTransposeTimer.Stop();
+
+          csrMultiplyTimer.Start();
+          csrMatrix.Multiply(x, csrRx);
+          csrMultiplyTimer.Stop();
+
+          csrTransposeTimer.Start();
+          csrMatrix.TransposeMultiply(x, csrRTx);
+          csrTransposeTimer.Stop();
+        }
+
+      PrintRow("R x", "vnl", vnlMultiplyTimer.GetTotal(), 0);
+      PrintRow("R x", "csr", csrMultiplyTimer.GetTotal(), GetMaximumDifference(vnlRx, csrRx));
+      PrintRow("R^T x", "vnl", vnlTransposeTimer.GetTotal(), 0);
+      PrintRow("R^T x", "csr", csrTransposeTimer.GetTotal(), GetMaximumDifference(vnlRTx, csrRTx));
+
+      std::cout << "Voxels: " << totalSize << ", non-zeros: " << csrMatrix.GetNumberOfNonZeros()
+                << ", threads: " << transformer->GetNumberOfThreads() << ", repeats: " << args.repeats << std::endl;
+    }
+  catch( itk::ExceptionObject & err )
+    {
+      std::cerr <<"ExceptionObject caught !";
+      std::cerr << err << std::endl;
+      return -2;
+    }
+
+  return 0;
+}
+
+/**
+ * \brief Times the affine transformation matrix of the matrix based metrics, as vnl and as compressed sparse rows.
+ */
+int main(int argc, char** argv)
+{
+  // To pass around command line args
+  struct arguments args;
+
+  // Set defaults
+  args.size = 48;
+  args.rotation = 10;
+  args.translation = 1.5;
+  args.scale = 1.05;
+  args.repeats = 10;
+  args.threads = 0;
+
+  // Parse command line args
+  for(int i=1; i < argc; i++){
+    if(strcmp(argv[i], "-help")==0 || strcmp(argv[i], "-Help")==0 || strcmp(argv[i], "-HELP")==0 || strcmp(argv[i], "-h")==0 || strcmp(argv[i], "--h")==0){
+      Usage(argv[0]);
+      return -1;
+    }
+    else if(strcmp(argv[i], "-size") == 0){
+      args.size=atoi(argv[++i]);
+      std::cout << "Set -size=" << niftk::ConvertToString(args.size) << std::endl;
+    }
+    else if(strcmp(argv[i], "-rot") == 0){
+      args.rotation=atof(argv[++i]);
+      std::cout << "Set -rot=" << niftk::ConvertToString(args.rotation) << std::endl;
+    }
+    else if(strcmp(argv[i], "-trans") == 0){
+      args.translation=atof(argv[++i]);
+      std::cout << "Set -trans=" << niftk::ConvertToString(args.translation) << std::endl;
+    }
+    else if(strcmp(argv[i], "-scale") == 0){
+      args.scale=atof(argv[++i]);
+      std::cout << "Set -scale=" << niftk::ConvertToString(args.scale) << std::endl;
+    }
+    else if(strcmp(argv[i], "-repeats") == 0){
+      args.repeats=atoi(argv[++i]);
+      std::cout << "Set -repeats=" << niftk::ConvertToString(args.repeats) << std::endl;
+    }
+    else if(strcmp(argv[i], "-threads") == 0){
+      args.threads=atoi(argv[++i]);
+      std::cout << "Set -threads=" << niftk::ConvertToString(args.threads) << std::endl;
+    }
+    else {
+      std::cerr << argv[0] << ":\tParameter " << argv[i] << " unknown." << std::endl;
+      return -1;
+    }
+  }
+
+  // Validate command line args
+  if(args.size < 2 ){
+    std::cerr << argv[0] << "\tThe size must be >= 2" << std::endl;
+    return -1;
+  }
+
+  if(args.scale <= 0 ){
+    std::cerr << argv[0] << "\tThe scale must be > 0" << std::endl;
+    return -1;
+  }
+
+  if(args.repeats < 1 ){
+    std::cerr << argv[0] << "\tThe repeats must be >= 1" << std::endl;
+    return -1;
+  }
+
+  return DoMain(args);
+}
@@ -22,6 +22,7 @@
  */
 
 
+#include <niftkBatchProcessor.h>
 #include <niftkFileHelper.h>
 #include <niftkConversionUtils.h>
 #include <itkCommandLineHelper.h>
@@ -47,6 +48,7 @@
 
 #include <boost/filesystem/path.hpp>
 
+#include <stdexcept>
 #include <vector>
 
 #include <niftkUnaryImageOperatorsOnDirectoryTreeCLP.h>
@@ -78,7 +80,7 @@ struct arguments
 // PrintDictionary()
 // -------------------------------------------------------------------------
 
-void PrintDictionary( DictionaryType &dictionary )
+void PrintDictionary( DictionaryType &dictionary, std::ostream &os )
 {
   DictionaryType::ConstIterator tagItr = dictionary.Begin();
   DictionaryType::ConstIterator end = dictionary.End();
@@ -96,7 +98,7 @@ void PrintDictionary( DictionaryType &dictionary )
 
       std::string tagValue = entryvalue->GetMetaDataObjectValue();
       
-      std::cout << tagkey << " " << tagID <<  ": " << tagValue << std::endl;
+      os << tagkey << " " << tagID <<  ": " << tagValue << std::endl;
     }
 
     ++tagItr;
@@ -110,18 +112,17 @@ void PrintDictionary( DictionaryType &dictionary )
 
 template < unsigned int InputDimension, 
            class OutputPixelType >
-int DoMain( arguments args, 
-            std::string iterFilename,
+int DoMain( const arguments &args, 
+            niftk::BatchProcessor::Job &job,
             std::string suffix )
 {
+  std::ostream &log = job.GetLog();
 
   std::string fileInputFullPath;
   std::string fileInputRelativePath;
   std::string fileOutputRelativePath;
   std::string fileOutputFullPath;
   std::string dirOutputFullPath;
-    
-  std::vector< std::string >::iterator iterFileNames;       
 
   typedef double InternalPixelType;
 
@@ -142,8 +143,12 @@ int DoMain( arguments args,
 
   // Read the image
 
-  reader->SetFileName( iterFilename );
-  reader->UpdateLargestPossibleRegion();
+  reader->SetFileName( job.GetFileName() );
+
+  {
+    niftk::BatchProcessor::IOSection io( job );
+    reader->UpdateLargestPossibleRegion();
+  }
 
   image = reader->GetOutput();
   image->DisconnectPipeline();
@@ -151,6 +156,10 @@ int DoMain( arguments args,
   DictionaryType dictionary = image->GetMetaDataDictionary();
   
    
+  // Process the image, no more than MaximumNumberOfComputeJobs at once
+
+  niftk::BatchProcessor::ComputeSection compute( job );
+
   // Set the desired output range (i.e. the same as the input)
 
   typename MinimumMaximumImageCalculatorType::Pointer 
@@ -185,7 +194,7 @@ int DoMain( arguments args,
   if ( args.imOperation 
        == std::string( "invert the image intensities" ) )
   {
-    std::cout << "Inverting the image intensities" << std::endl;
+    log << "Inverting the image intensities" << std::endl;
 
     typedef itk::InvertIntensityBetweenMaxAndMinImageFilter<InternalImageType> InvertFilterType;
 
@@ -198,7 +207,7 @@ int DoMain( arguments args,
   else if ( args.imOperation 
             == std::string( "negate the image intensities" ) )
   {
-    std::cout << "Negating the image intensities" << std::endl;
+    log << "Negating the image intensities" << std::endl;
 
     typedef itk::NegateImageFilter<InternalImageType, InternalImageType> NegateFilterType;
 
@@ -211,7 +220,7 @@ int DoMain( arguments args,
   else if ( args.imOperation 
             == std::string( "square the image intensities" ) )
   {
-    std::cout << "Computing the square of the intensities" << std::endl;
+    log << "Computing the square of the intensities" << std::endl;
 
     typedef itk::SquareImageFilter<InternalImageType, InternalImageType> SquareFilterType;
 
@@ -224,7 +233,7 @@ int DoMain( arguments args,
   else if ( args.imOperation 
             == std::string( "square root the image intensities" ) )
   {
-    std::cout << "Computing the square root of intensities" << std::endl;
+    log << "Computing the square root of intensities" << std::endl;
 
     typedef itk::SqrtImageFilter<InternalImageType, InternalImageType> SqrtFilterType;
 
@@ -237,7 +246,7 @@ int DoMain( arguments args,
   else if ( args.imOperation 
             == std::string( "absolute intensity values" ) )
   {
-    std::cout << "Computing the absolute value of intensities" << std::endl;
+    log << "Computing the absolute value of intensities" << std::endl;
 
     typedef itk::AbsImageFilter<InternalImageType, InternalImageType> AbsFilterType;
 
@@ -250,7 +259,7 @@ int DoMain( arguments args,
   else if ( args.imOperation 
             == std::string( "exponential of intensity values" ) )
   {
-    std::cout << "Computing the exponential of the intensities" << std::endl;
+    log << "Computing the exponential of the intensities" << std::endl;
 
     typedef itk::ExpImageFilter<InternalImageType, InternalImageType> ExpFilterType;
 
@@ -263,7 +272,7 @@ int DoMain( arguments args,
   else if ( args.imOperation 
             == std::string( "natural logarithm of intensity values" ) )
   {
-    std::cout << "Computing the natural logarithm of intensities values" << std::endl;
+    log << "Computing the natural logarithm of intensities values" << std::endl;
 
     typedef itk::LogNonZeroIntensitiesImageFilter<InternalImageType, InternalImageType> LogFilterType;
 
@@ -276,7 +285,7 @@ int DoMain( arguments args,
   else if ( args.imOperation 
             == std::string( "log-inverse of intensity values" ) )
   {
-    std::cout << "Computing the log-inverse of intensities" << std::endl;
+    log << "Computing the log-inverse of intensities" << std::endl;
 
     typedef itk::LogNonZeroIntensitiesImageFilter<InternalImageType, InternalImageType> LogFilterType;
 
@@ -297,10 +306,10 @@ int DoMain( arguments args,
   if ( args.rescaleIntensities != std::string( "none" ) )
   {
 
-    std::cout << "Image output range will be: " 
-              << intensityRescaler->GetOutputMinimum()
-              << " to " << intensityRescaler->GetOutputMaximum() 
-              << std::endl;
+    log << "Image output range will be: " 
+        << intensityRescaler->GetOutputMinimum()
+        << " to " << intensityRescaler->GetOutputMaximum() 
+        << std::endl;
 
 
     intensityRescaler->SetInput( image );  
@@ -316,10 +325,12 @@ int DoMain( arguments args,
 
   caster->UpdateLargestPossibleRegion();
 
+  compute.Release();
+
 
   // Create the output image filename
 
-  fileInputFullPath = iterFilename;
+  fileInputFullPath = job.GetFileName();
 
   fileInputRelativePath = fileInputFullPath.substr( args.inDirectory.length() );
      
@@ -337,26 +348,24 @@ int DoMain( arguments args,
     niftk::CreateDirAndParents( dirOutputFullPath );
   }
       
-  std::cout << "Input relative filename: " << fileInputRelativePath << std::endl
-            << "Output relative filename: " << fileOutputRelativePath << std::endl
-            << "Output directory: " << dirOutputFullPath << std::endl;
+  log << "Input relative filename: " << fileInputRelativePath << std::endl
+      << "Output relative filename: " << fileOutputRelativePath << std::endl
+      << "Output directory: " << dirOutputFullPath << std::endl;
 
 
   // Write the image to the output file
 
   if ( niftk::FileIsRegular( fileOutputFullPath ) && ( ! args.flgOverwrite ) )
   {
-    std::cerr << std::endl << "ERROR: File " << fileOutputFullPath << " exists"
-              << std::endl << "       and can't be overwritten. Consider option: 'overwrite'."
-              << std::endl << std::endl;
-    return EXIT_FAILURE;
+    throw std::runtime_error( "File " + fileOutputFullPath + " exists"
+                              + " and can't be overwritten. Consider option: 'overwrite'." );
   }
   else
   {
   
     if ( args.flgVerbose )
     {
-      PrintDictionary( dictionary );
+      PrintDictionary( dictionary, log );
     }
 
     typename WriterType::Pointer writer = WriterType::New();
@@ -377,13 +386,14 @@ int DoMain( arguments args,
     writer->SetImageIO( imageIO );
     writer->UseInputMetaDataDictionaryOff();
 
-    std::cout << "Writing image to file: " 
-              << fileOutputFullPath << std::endl;
+    log << "Writing image to file: " 
+        << fileOutputFullPath << std::endl;
 
+    niftk::BatchProcessor::IOSection io( job );
     writer->Update();
   }
 
-  std::cout << std::endl;
+  log << std::endl;
 
 
   return EXIT_SUCCESS;
@@ -391,6 +401,302 @@ int DoMain( arguments args,
 
 
 
+// -------------------------------------------------------------------------
+// ProcessFile()
+// -------------------------------------------------------------------------
+
+void ProcessFile( const arguments &args, niftk::BatchProcessor::Job &job )
+{
+  std::ostream &log = job.GetLog();
+  const std::string &iterFilename = job.GetFileName();
+
+  log << "File: " << iterFilename << std::endl;
+
+  unsigned int dims;
+  itk::ImageIOBase::IOComponentType inComponentType;
+
+  {
+    niftk::BatchProcessor::IOSection io( job );
+
+    itk::ImageIOBase::Pointer imageIO;
+    imageIO = itk::ImageIOFactory::CreateImageIO(iterFilename.c_str(), 
+                                                 itk::ImageIOFactory::ReadMode);
+
+    if ( ( ! imageIO ) || ( ! imageIO->CanReadFile( iterFilename.c_str() ) ) )
+    {
+      log << "WARNING: Unrecognised image type, skipping file: " 
+          << iterFilename << std::endl << std::endl;
+      return;
+    }
+
+    dims = itk::PeekAtImageDimensionFromSizeInVoxels(iterFilename);
+    inComponentType = itk::PeekAtComponentType(iterFilename);
+  }
+
+  if (dims != 3 && dims != 2)
+  {
+    log << "WARNING: Unsupported image dimension (" << dims << ") for file: " 
+        << iterFilename << std::endl;
+    return;
+  }
+
+
+  // Determine the desired pixel output type
+
+  itk::ImageIOBase::IOComponentType outComponentType;
+
+  if ( args.outPixelType == std::string( "unchanged" ) )
+  {
+    outComponentType = inComponentType;
+  }
+  else if ( args.outPixelType == std::string( "unsigned char" ) )
+  {
+    outComponentType = itk::ImageIOBase::UCHAR;
+  }
+  else if ( args.outPixelType == std::string( "char" ) )
+  {
+    outComponentType = itk::ImageIOBase::CHAR;
+  }
+  else if ( args.outPixelType == std::string( "unsigned short" ) )
+  {
+    outComponentType = itk::ImageIOBase::USHORT;            
+  }
+  else if ( args.outPixelType == std::string( "short" ) )
+  {
+    outComponentType = itk::ImageIOBase::SHORT;
+  }
+  else if ( args.outPixelType == std::string( "unsigned int" ) )
+  {
+    outComponentType = itk::ImageIOBase::UINT;
+  }
+  else if ( args.outPixelType == std::string( "int" ) )
+  {
+    outComponentType = itk::ImageIOBase::INT;
+  }
+  else if ( args.outPixelType == std::string( "unsigned long" ) )
+  {
+    outComponentType = itk::ImageIOBase::ULONG;
+  }
+  else if ( args.outPixelType == std::string( "long" ) )
+  {
+    outComponentType = itk::ImageIOBase::LONG;
+  }
+  else if ( args.outPixelType == std::string( "float" ) )
+  {
+    outComponentType = itk::ImageIOBase::FLOAT;
+  }
+  else if ( args.outPixelType == std::string( "double" ) )
+  {
+    outComponentType = itk::ImageIOBase::DOUBLE;
+  }
+  else
+  {
+    log << "WARNING: Unrecognised pixel type, skipping file: " 
+        << iterFilename << std::endl;
+    return;
+  }
+
+  // Get the desired output image file format suffix
+
+  std::string outSuffix;
+
+  if ( args.outImageFileFormat == std::string( "unchanged" ) )
+  {
+    outSuffix = niftk::ExtractImageFileSuffix( iterFilename );
+  }
+  else if ( args.outImageFileFormat == std::string( "DICOM (.dcm)" ) )
+  {
+    outSuffix = ".dcm";
+  }
+  else if ( args.outImageFileFormat == std::string( "Nifti (.nii)" ) )
+  {
+    outSuffix = ".nii";
+  }
+  else if ( args.outImageFileFormat == std::string( "GIPL (.gipl)" ) )
+  {
+    outSuffix = ".gipl";
+  }
+  else if ( args.outImageFileFormat == std::string( "Bitmap (.bmp)" ) )
+  {
+    outSuffix = ".bmp";
+  }
+  else if ( args.outImageFileFormat == std::string( "JPEG (.jpg)" ) )
+  {
+    outSuffix = ".jpg";
+  }
+  else if ( args.outImageFileFormat == std::string( "TIFF (.tiff)" ) )
+  {
+    outSuffix = ".tiff";
+  }
+  else if ( args.outImageFileFormat == std::string( "PNG (.png)" ) )
+  {
+    outSuffix = ".png";
+  }
+
+
+
+  // Operate on this image
+
+  int result;
+
+  switch ( dims )
+  {
+  case 2:
+  {
+    switch ( outComponentType )
+    {
+    case itk::ImageIOBase::UCHAR:
+      result = DoMain<2, unsigned char>( args,
+                                         job,
+                                         outSuffix );  
+      break;
+
+    case itk::ImageIOBase::CHAR:
+      result = DoMain<2, char>( args,
+                                job,
+                                outSuffix );  
+      break;
+
+    case itk::ImageIOBase::USHORT:
+      result = DoMain<2, unsigned short>( args,
+                                          job,
+                                          outSuffix );
+      break;
+
+    case itk::ImageIOBase::SHORT:
+      result = DoMain<2, short>( args,
+                                 job,
+                                 outSuffix );
+      break;
+
+    case itk::ImageIOBase::UINT:
+      result = DoMain<2, unsigned int>( args,
+                                        job,
+                                        outSuffix );
+      break;
+
+    case itk::ImageIOBase::INT:
+      result = DoMain<2, int>( args,
+                               job,
+                               outSuffix );
+      break;
+
+    case itk::ImageIOBase::ULONG:
+      result = DoMain<2, unsigned long>( args,
+                                         job,
+                                         outSuffix );
+      break;
+
+    case itk::ImageIOBase::LONG:
+      result = DoMain<2, long>( args,
+                                job,
+                                outSuffix );
+      break;
+
+    case itk::ImageIOBase::FLOAT:
+      result = DoMain<2, float>( args,
+                                 job,
+                                 outSuffix );
+      break;
+
+    case itk::ImageIOBase::DOUBLE:
+      result = DoMain<2, double>( args,
+                                  job,
+                                  outSuffix );
+      break;
+
+    default:
+      log << "WARNING: Unrecognised pixel type, skipping file: " 
+          << iterFilename << std::endl;
+    }
+    break;
+  }
+
+  case 3:
+  {
+    switch ( outComponentType )
+    {
+    case itk::ImageIOBase::UCHAR:
+      result = DoMain<3, unsigned char>( args,
+                                         job,
+                                         outSuffix );  
+      break;
+
+    case itk::ImageIOBase::CHAR:
+      result = DoMain<3, char>( args,
+                                job,
+                                outSuffix );  
+      break;
+
+    case itk::ImageIOBase::USHORT:
+      result = DoMain<3, unsigned short>( args,
+                                          job,
+                                          outSuffix );
+      break;
+
+    case itk::ImageIOBase::SHORT:
+      result = DoMain<3, short>( args,
+                                 job,
+                                 outSuffix );
+      break;
+
+    case itk::ImageIOBase::UINT:
+      result = DoMain<3, unsigned int>( args,
+                                        job,
+                                        outSuffix );
+      break;
+
+    case itk::ImageIOBase::INT:
+      result = DoMain<3, int>( args,
+                               job,
+                               outSuffix );
+      break;
+
+    case itk::ImageIOBase::ULONG:
+      result = DoMain<3, unsigned long>( args,
+                                         job,
+                                         outSuffix );
+      break;
+
+    case itk::ImageIOBase::LONG:
+      result = DoMain<3, long>( args,
+                                job,
+                                outSuffix );
+      break;
+
+    case itk::ImageIOBase::FLOAT:
+      result = DoMain<3, float>( args,
+                                 job,
+                                 outSuffix );
+      break;
+
+    case itk::ImageIOBase::DOUBLE:
+      result = DoMain<3, double>( args,
+                                  job,
+                                  outSuffix );
+      break;
+
+    default:
+      log << "WARNING: Unrecognised pixel type, skipping file: " 
+          << iterFilename << std::endl;
+    }
+
+    break;
+  }
+
+  default:
+  {
+    log << "WARNING: Unsupported image dimension (" << dims << ") for file: " 
+        << iterFilename << std::endl;
+  }
+  }
+
+
+  log << std::endl;
+}
+
+
+
 // -------------------------------------------------------------------------
 // main()
 // -------------------------------------------------------------------------
@@ -399,10 +705,6 @@ int main( int argc, char *argv[] )
 {
   itk::NifTKImageIOFactory::Initialize();
 
-  float progress = 0.;
-  float iFile = 0.;
-  float nFiles;
-
   struct arguments args;
 
   // Validate command line args
@@ -422,6 +724,13 @@ int main( int argc, char *argv[] )
     outDirectory = inDirectory;
   }
 
+  if ( nThreads < 0 || nIOJobs < 0 || nComputeJobs < 0 )
+  {
+    commandLine.getOutput()->usage(commandLine);
+    std::cerr << "ERROR: The numbers of threads and jobs must not be negative" << std::endl;
+    return EXIT_FAILURE;
+  }
+
   args.inDirectory  = inDirectory;                     
   args.outDirectory = outDirectory;                    
 
@@ -445,317 +754,41 @@ int main( int argc, char *argv[] )
   // Get the list of files in the directory
   // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
-  std::string iterFilename;
   std::vector< std::string > fileNames;
-  std::vector< std::string >::iterator iterFileNames;       
 
-  niftk::GetRecursiveFilesInDirectory( inDirectory, fileNames );
+  niftk::GetRecursiveFilesInDirectory( inDirectory, fileNames, nIOJobs );
 
-  nFiles = fileNames.size();
-
-  for ( iterFileNames = fileNames.begin(); 
-	iterFileNames < fileNames.end(); 
-	++iterFileNames, iFile += 1. )
-  {
-    iterFilename = *iterFileNames;
-
-    std::cout << "File: " << iterFilename << std::endl;
-
-    progress = iFile/nFiles;
-    std::cout << "<filter-progress>" << std::endl
-	      << progress << std::endl
-	      << "</filter-progress>" << std::endl;
-
-    try
-    {
-  
-      itk::ImageIOBase::Pointer imageIO;
-      imageIO = itk::ImageIOFactory::CreateImageIO(iterFilename.c_str(), 
-                                                   itk::ImageIOFactory::ReadMode);
-
-      if ( ( ! imageIO ) || ( ! imageIO->CanReadFile( iterFilename.c_str() ) ) )
-      {
-        std::cerr << "WARNING: Unrecognised image type, skipping file: " 
-                  << iterFilename << std::endl;
-        continue;
-      }
-
-
-      unsigned int dims = itk::PeekAtImageDimensionFromSizeInVoxels(iterFilename);
-
-      if (dims != 3 && dims != 2)
-      {
-        std::cout << "WARNING: Unsupported image dimension (" << dims << ") for file: " 
-                  << iterFilename << std::endl;
-        continue;
-      }
 
+  // Operate on each image, several at once
+  // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
-      // Determine the desired pixel output type
-    
-      itk::ImageIOBase::IOComponentType outComponentType;
-
-      if ( args.outPixelType == std::string( "unchanged" ) )
-      {
-        outComponentType = itk::PeekAtComponentType(iterFilename);
-      }
-      else if ( args.outPixelType == std::string( "unsigned char" ) )
-      {
-        outComponentType = itk::ImageIOBase::UCHAR;
-      }
-      else if ( args.outPixelType == std::string( "char" ) )
-      {
-        outComponentType = itk::ImageIOBase::CHAR;
-      }
-      else if ( args.outPixelType == std::string( "unsigned short" ) )
-      {
-        outComponentType = itk::ImageIOBase::USHORT;            
-      }
-      else if ( args.outPixelType == std::string( "short" ) )
-      {
-        outComponentType = itk::ImageIOBase::SHORT;
-      }
-      else if ( args.outPixelType == std::string( "unsigned int" ) )
-      {
-        outComponentType = itk::ImageIOBase::UINT;
-      }
-      else if ( args.outPixelType == std::string( "int" ) )
-      {
-        outComponentType = itk::ImageIOBase::INT;
-      }
-      else if ( args.outPixelType == std::string( "unsigned long" ) )
-      {
-        outComponentType = itk::ImageIOBase::ULONG;
-      }
-      else if ( args.outPixelType == std::string( "long" ) )
-      {
-        outComponentType = itk::ImageIOBase::LONG;
-      }
-      else if ( args.outPixelType == std::string( "float" ) )
-      {
-        outComponentType = itk::ImageIOBase::FLOAT;
-      }
-      else if ( args.outPixelType == std::string( "double" ) )
-      {
-        outComponentType = itk::ImageIOBase::DOUBLE;
-      }
-      else
-      {
-        std::cerr << "WARNING: Unrecognised pixel type, skipping file: " 
-                  << iterFilename << std::endl;
-        continue;
-      }
-    
-      // Get the desired output image file format suffix
+  niftk::BatchProcessor processor;
 
-      std::string outSuffix;
-    
-      if ( args.outImageFileFormat == std::string( "unchanged" ) )
-      {
-        outSuffix = niftk::ExtractImageFileSuffix( iterFilename );
-      }
-      else if ( args.outImageFileFormat == std::string( "DICOM (.dcm)" ) )
-      {
-        outSuffix = ".dcm";
-      }
-      else if ( args.outImageFileFormat == std::string( "Nifti (.nii)" ) )
-      {
-        outSuffix = ".nii";
-      }
-      else if ( args.outImageFileFormat == std::string( "GIPL (.gipl)" ) )
-      {
-        outSuffix = ".gipl";
-      }
-      else if ( args.outImageFileFormat == std::string( "Bitmap (.bmp)" ) )
-      {
-        outSuffix = ".bmp";
-      }
-      else if ( args.outImageFileFormat == std::string( "JPEG (.jpg)" ) )
-      {
-        outSuffix = ".jpg";
-      }
-      else if ( args.outImageFileFormat == std::string( "TIFF (.tiff)" ) )
-      {
-        outSuffix = ".tiff";
-      }
-      else if ( args.outImageFileFormat == std::string( "PNG (.png)" ) )
-      {
-        outSuffix = ".png";
-      }
-
-
-
-      // Operate on this image
-
-      int result;
-
-      switch ( dims )
-      {
-      case 2:
-      {
-        switch ( outComponentType )
-        {
-        case itk::ImageIOBase::UCHAR:
-          result = DoMain<2, unsigned char>( args,
-                                             iterFilename,
-                                             outSuffix );  
-          break;
-    
-        case itk::ImageIOBase::CHAR:
-          result = DoMain<2, char>( args,
-                                    iterFilename,
-                                    outSuffix );  
-          break;
-
-        case itk::ImageIOBase::USHORT:
-          result = DoMain<2, unsigned short>( args,
-                                              iterFilename,
-                                              outSuffix );
-          break;
-
-        case itk::ImageIOBase::SHORT:
-          result = DoMain<2, short>( args,
-                                     iterFilename,
-                                     outSuffix );
-          break;
-
-        case itk::ImageIOBase::UINT:
-          result = DoMain<2, unsigned int>( args,
-                                            iterFilename,
-                                            outSuffix );
-          break;
-
-        case itk::ImageIOBase::INT:
-          result = DoMain<2, int>( args,
-                                   iterFilename,
-                                   outSuffix );
-          break;
-
-        case itk::ImageIOBase::ULONG:
-          result = DoMain<2, unsigned long>( args,
-                                             iterFilename,
-                                             outSuffix );
-          break;
-
-        case itk::ImageIOBase::LONG:
-          result = DoMain<2, long>( args,
-                                    iterFilename,
-                                    outSuffix );
-          break;
-
-        case itk::ImageIOBase::FLOAT:
-          result = DoMain<2, float>( args,
-                                     iterFilename,
-                                     outSuffix );
-          break;
-
-        case itk::ImageIOBase::DOUBLE:
-          result = DoMain<2, double>( args,
-                                      iterFilename,
-                                      outSuffix );
-          break;
-
-        default:
-          std::cerr << "WARNING: Unrecognised pixel type, skipping file: " 
-                    << iterFilename << std::endl;
-        }
-        break;
-      }
-
-      case 3:
-      {
-        switch ( outComponentType )
-        {
-        case itk::ImageIOBase::UCHAR:
-          result = DoMain<3, unsigned char>( args,
-                                             iterFilename,
-                                             outSuffix );  
-          break;
-    
-        case itk::ImageIOBase::CHAR:
-          result = DoMain<3, char>( args,
-                                    iterFilename,
-                                    outSuffix );  
-          break;
-
-        case itk::ImageIOBase::USHORT:
-          result = DoMain<3, unsigned short>( args,
-                                              iterFilename,
-                                              outSuffix );
-          break;
-
-        case itk::ImageIOBase::SHORT:
-          result = DoMain<3, short>( args,
-                                     iterFilename,
-                                     outSuffix );
-          break;
-
-        case itk::ImageIOBase::UINT:
-          result = DoMain<3, unsigned int>( args,
-                                            iterFilename,
-                                            outSuffix );
-          break;
-
-        case itk::ImageIOBase::INT:
-          result = DoMain<3, int>( args,
-                                   iterFilename,
-                                   outSuffix );
-          break;
-
-        case itk::ImageIOBase::ULONG:
-          result = DoMain<3, unsigned long>( args,
-                                             iterFilename,
-                                             outSuffix );
-          break;
-
-        case itk::ImageIOBase::LONG:
-          result = DoMain<3, long>( args,
-                                    iterFilename,
-                                    outSuffix );
-          break;
-
-        case itk::ImageIOBase::FLOAT:
-          result = DoMain<3, float>( args,
-                                     iterFilename,
-                                     outSuffix );
-          break;
-
-        case itk::ImageIOBase::DOUBLE:
-          result = DoMain<3, double>( args,
-                                      iterFilename,
-                                      outSuffix );
-          break;
-
-        default:
-          std::cerr << "WARNING: Unrecognised pixel type, skipping file: " 
-                    << iterFilename << std::endl;
-        }
-      }
-    
-      default:
-      {
-        std::cout << "WARNING: Unsupported image dimension (" << dims << ") for file: " 
-                  << iterFilename << std::endl;
-      }
-      }
+  processor.SetNumberOfThreads( nThreads );
+  processor.SetMaximumNumberOfIOJobs( nIOJobs );
+  processor.SetMaximumNumberOfComputeJobs( nComputeJobs );
+  processor.SetProgressFileName( fileProgress );
+  processor.SetReportProgress( true );
 
-    }
-    catch (itk::ExceptionObject & e)
-    {
-      std::cout << "ERROR: Skipping file: " << iterFilename 
-                << std::endl << e << std::endl;
-    }
+  try
+  {
+    processor.Run( fileNames,
+                   [&args]( niftk::BatchProcessor::Job &job )
+                   {
+                     ProcessFile( args, job );
+                   } );
+  }
+  catch (std::exception &e)
+  {
+    std::cerr << "ERROR: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
 
-    std::cout << std::endl;
+  if ( processor.GetFailedFileNames().size() > 0 )
+  {
+    std::cerr << "WARNING: Failed to process "
+              << processor.GetFailedFileNames().size() << " files" << std::endl;
   }
 
-  progress = iFile/nFiles;
-  std::cout << "<filter-progress>" << std::endl
-            << progress << std::endl
-            << "</filter-progress>" << std::endl;
-  
   return EXIT_SUCCESS;
 }
- 
- 
-
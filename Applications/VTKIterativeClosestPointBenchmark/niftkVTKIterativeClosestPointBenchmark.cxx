@@ -0,0 +1,295 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+/*!
+ * \file niftkVTKIterativeClosestPointBenchmark.cxx
+ * \page niftkVTKIterativeClosestPointBenchmark
+ * \section niftkVTKIterativeClosestPointBenchmarkSummary niftkVTKIterativeClosestPointBenchmark compares the time and accuracy of niftk::VTKIterativeClosestPoint and niftk::VTKKdTreeIterativeClosestPoint in recovering a known rigid transformation.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkMultiThreader.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkPolyDataReader.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+#include <vtkTransform.h>
+
+#include <niftkCommandLineParser.h>
+#include <niftkVTKFunctions.h>
+#include <niftkVTKIterativeClosestPoint.h>
+#include <niftkVTKKdTreeIterativeClosestPoint.h>
+
+
+struct niftk::CommandLineArgumentDescription clArgList[] =
+{
+  {OPT_STRING, "i", "filename", "Input VTK polydata surface. If not given, a bumpy sphere is used."},
+  {OPT_INT, "res", "int", "[400] Resolution of the sphere, giving about 0.6 * res * res points."},
+  {OPT_FLOAT, "rot", "float", "[5] Rotation, in degrees, of the known transformation."},
+  {OPT_FLOAT, "trans", "float", "[3] Translation, in millimetres, of the known transformation."},
+  {OPT_INT, "lm", "int", "[8000] Maximum number of landmarks."},
+  {OPT_INT, "iter", "int", "[100] Maximum number of ICP iterations."},
+  {OPT_INT, "trim", "int", "[100] Percentage of closest landmarks used at each iteration of the k-d tree ICP."},
+  {OPT_INT, "nt", "int", "[VTK default] Maximum number of threads. The k-d tree ICP is timed for 1, 2, 4, ... threads up to this number."},
+  {OPT_SWITCH, "noVTK", NULL, "Don't time the VTK ICP, which is slow for large surfaces."},
+  {OPT_DONE, NULL, NULL,
+    "Program to compare the time and accuracy of the VTK and the k-d tree ICP, in recovering a known rigid transformation of a surface.\n"
+  }
+};
+
+
+enum {
+  O_INPUT,
+
+  O_RESOLUTION,
+
+  O_ROTATION,
+
+  O_TRANSLATION,
+
+  O_LANDMARKS,
+
+  O_ITERATIONS,
+
+  O_TRIM,
+
+  O_NUMBER_OF_THREADS,
+
+  O_NO_VTK
+};
+
+
+//-----------------------------------------------------------------------------
+/// Returns a copy of the points of polyData, moved by matrix, without any cells.
+vtkSmartPointer<vtkPolyData> TransformPoints(vtkPolyData& polyData, vtkMatrix4x4& matrix)
+{
+  vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+  points->SetDataTypeToDouble();
+  points->SetNumberOfPoints(polyData.GetNumberOfPoints());
+
+  double point[4];
+  double transformed[4];
+  for (vtkIdType i = 0; i < polyData.GetNumberOfPoints(); i++)
+  {
+    polyData.GetPoint(i, point);
+    point[3] = 1;
+    matrix.MultiplyPoint(point, transformed);
+    points->SetPoint(i, transformed);
+  }
+
+  vtkSmartPointer<vtkPolyData> result = vtkSmartPointer<vtkPolyData>::New();
+  result->SetPoints(points);
+  return result;
+}
+
+
+//-----------------------------------------------------------------------------
+/// Returns the RMS distance between the source points moved by the actual and the expected transformation.
+double GetRMSError(vtkPolyData& source, vtkMatrix4x4& expected, vtkMatrix4x4& actual)
+{
+  double sumOfSquares = 0;
+  double point[4];
+  double a[4];
+  double e[4];
+
+  for (vtkIdType i = 0; i < source.GetNumberOfPoints(); i++)
+  {
+    source.GetPoint(i, point);
+    point[3] = 1;
+    expected.MultiplyPoint(point, e);
+    actual.MultiplyPoint(point, a);
+    sumOfSquares += vtkMath::Distance2BetweenPoints(a, e);
+  }
+  return std::sqrt(sumOfSquares / std::max(static_cast<vtkIdType>(1), source.GetNumberOfPoints()));
+}
+
+
+//-----------------------------------------------------------------------
+// main()
+// -------------------------------------------------------------------------
+
+int main( int argc, char *argv[] )
+{
+  std::string inputFileName;
+  int   resolution = 400;
+  float rotation = 5;
+  float translation = 3;
+  int   landmarks = 8000;
+  int   iterations = 100;
+  int   trim = 100;
+  int   maxNumberOfThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  bool  noVTK = false;
+
+  niftk::CommandLineParser CommandLineOptions(argc, argv, clArgList, false);
+
+  CommandLineOptions.GetArgument(O_INPUT, inputFileName);
+
+  CommandLineOptions.GetArgument(O_RESOLUTION, resolution);
+
+  CommandLineOptions.GetArgument(O_ROTATION, rotation);
+
+  CommandLineOptions.GetArgument(O_TRANSLATION, translation);
+
+  CommandLineOptions.GetArgument(O_LANDMARKS, landmarks);
+
+  CommandLineOptions.GetArgument(O_ITERATIONS, iterations);
+
+  CommandLineOptions.GetArgument(O_TRIM, trim);
+
+  CommandLineOptions.GetArgument(O_NUMBER_OF_THREADS, maxNumberOfThreads);
+
+  CommandLineOptions.GetArgument(O_NO_VTK, noVTK);
+
+  if (resolution < 3 || landmarks < 3 || iterations < 1 || trim < 1 || trim > 100 || maxNumberOfThreads < 1)
+  {
+    std::cerr << "Invalid arguments." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  try
+  {
+    vtkSmartPointer<vtkPolyData> target;
+    if (inputFileName.length() > 0)
+    {
+      vtkSmartPointer<vtkPolyDataReader> reader = vtkSmartPointer<vtkPolyDataReader>::New();
+      reader->SetFileName(inputFileName.c_str());
+      reader->Update();
+      target = reader->GetOutput();
+    }
+    else
+    {
+      target = niftk::CreateBumpySphere(50, resolution);
+    }
+
+    if (target->GetNumberOfPoints() < 3 || target->GetNumberOfCells() == 0)
+    {
+      std::cerr << "The target surface needs at least 3 points and some cells." << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    // The known transformation rotates about an oblique axis through the centre of the target.
+    double bounds[6];
+    target->GetBounds(bounds);
+    vtkSmartPointer<vtkTransform> transform = vtkSmartPointer<vtkTransform>::New();
+    transform->PostMultiply();
+    transform->Translate(-(bounds[0] + bounds[1]) / 2, -(bounds[2] + bounds[3]) / 2, -(bounds[4] + bounds[5]) / 2);
+    transform->RotateWXYZ(rotation, 0.48, 0.6, 0.64);
+    transform->Translate((bounds[0] + bounds[1]) / 2, (bounds[2] + bounds[3]) / 2, (bounds[4] + bounds[5]) / 2);
+    transform->Translate(translation * 0.6, -translation * 0.8, 0);
+
+    vtkSmartPointer<vtkMatrix4x4> expected = vtkSmartPointer<vtkMatrix4x4>::New();
+    expected->DeepCopy(transform->GetMatrix());
+    vtkSmartPointer<vtkMatrix4x4> inverse = vtkSmartPointer<vtkMatrix4x4>::New();
+    vtkMatrix4x4::Invert(expected, inverse);
+
+    vtkSmartPointer<vtkPolyData> source = TransformPoints(*target, *inverse);
+
+    std::cout << "Target has " << target->GetNumberOfPoints() << " points and " << target->GetNumberOfCells() << " cells." << std::endl;
+
+    std::vector<int> threadCounts;
+    for (int t = 1; t < maxNumberOfThreads; t *= 2)
+    {
+      threadCounts.push_back(t);
+    }
+    threadCounts.push_back(maxNumberOfThreads);
+
+    std::vector<std::string> names;
+    std::vector<int> threads;
+    std::vector<double> times;
+    std::vector<double> residuals;
+    std::vector<double> errors;
+    std::vector<unsigned int> iterationsUsed;
+
+    if (!noVTK)
+    {
+      niftk::VTKIterativeClosestPoint icp;
+      icp.SetSource(source);
+      icp.SetTarget(target);
+      icp.SetICPMaxLandmarks(landmarks);
+      icp.SetICPMaxIterations(iterations);
+
+      double start = vtkTimerLog::GetUniversalTime();
+      double residual = icp.Run();
+      double end = vtkTimerLog::GetUniversalTime();
+
+      names.push_back("VTK");
+      threads.push_back(1);
+      times.push_back(end - start);
+      residuals.push_back(residual);
+      errors.push_back(GetRMSError(*source, *expected, *icp.GetTransform()));
+      iterationsUsed.push_back(iterations);
+    }
+
+    for (int pointToPlane = 0; pointToPlane < 2; pointToPlane++)
+    {
+      for (size_t t = 0; t < threadCounts.size(); t++)
+      {
+        niftk::VTKKdTreeIterativeClosestPoint icp;
+        icp.SetSource(source);
+        icp.SetTarget(target);
+        icp.SetICPMaxLandmarks(landmarks);
+        icp.SetICPMaxIterations(iterations);
+        icp.SetTrimmedPercentage(trim);
+        icp.SetPointToPlane(pointToPlane == 1);
+        icp.SetNumberOfThreads(threadCounts[t]);
+
+        // Includes building the k-d tree, and the normals for point to plane.
+        double start = vtkTimerLog::GetUniversalTime();
+        double residual = icp.Run();
+        double end = vtkTimerLog::GetUniversalTime();
+
+        names.push_back(pointToPlane == 1 ? "k-d tree, point to plane" : "k-d tree, point to point");
+        threads.push_back(threadCounts[t]);
+        times.push_back(end - start);
+        residuals.push_back(residual);
+        errors.push_back(GetRMSError(*source, *expected, *icp.GetTransform()));
+        iterationsUsed.push_back(icp.GetNumberOfIterations());
+      }
+    }
+
+    std::cout << std::setw(26) << "Method"
+              << std::setw(10) << "Threads"
+              << std::setw(12) << "Iterations"
+              << std::setw(12) << "Time(s)"
+              << std::setw(14) << "Residual(mm)"
+              << std::setw(16) << "RMS error(mm)" << std::endl;
+
+    for (size_t i = 0; i < names.size(); i++)
+    {
+      std::cout << std::setw(26) << names[i]
+                << std::setw(10) << threads[i]
+                << std::setw(12) << iterationsUsed[i]
+                << std::setw(12) << times[i]
+                << std::setw(14) << residuals[i]
+                << std::setw(16) << errors[i] << std::endl;
+    }
+  }
+  catch (std::exception& e)
+  {
+    std::cerr << "Caught std::exception: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -165,6 +165,7 @@ void Usage(char *exec)
   std::cout << " --min <float> [0.77] Minimum vessel size"<< std::endl;
   std::cout << " --max <float> [3.09] Maximum vessel size"<< std::endl;
   std::cout << " --mod <int> [0] Linear (0) or exponential (1) scale generation" << std::endl;
+  std::cout << " --brick <int> [0] Filter the image in bricks of this size, or 0 for the whole image" << std::endl;
   std::cout << " --aone <float> [0.5] Alpha one parameter" << std::endl;
   std::cout << " --atwo <float> [2.0] Alpha two parameter" << std::endl;
   std::cout << " --bin Binarise output" << std::endl;
@@ -382,6 +383,13 @@ int main(int argc, char *argv[])
     return EXIT_FAILURE;
   }
 
+  if (brickSize < 0)
+  {
+    closeProgress("FAILED", "Brick size must not be negative");
+    Usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
   InternalImageType::Pointer inImage = NULL;
   int dims = itk::PeekAtImageDimension(inputImageName);
 
@@ -742,6 +750,7 @@ int main(int argc, char *argv[])
   vesselnessFilter->SetMinScale(min);
   vesselnessFilter->SetMaxScale(max);
   vesselnessFilter->SetScaleMode(static_cast<VesselnessFilterType::ScaleModeType>(mode));
+  vesselnessFilter->SetBrickSize(brickSize);
   vesselnessFilter->Update();
 
   InternalImageType::Pointer maxImage = vesselnessFilter->GetOutput();
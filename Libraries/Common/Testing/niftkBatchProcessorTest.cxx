@@ -0,0 +1,293 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <niftkBatchProcessor.h>
+#include <niftkFileHelper.h>
+#include <boost/filesystem.hpp>
+
+namespace fs = boost::filesystem;
+
+/**
+ * \file niftkBatchProcessorTest.cxx
+ * \brief Defines unit tests for the batch processor, and the multi-threaded directory listing.
+ */
+
+namespace
+{
+
+/** Counts the jobs in a section, remembering the most there have been. */
+struct SectionCounter
+{
+  std::atomic<int> Count;
+  std::atomic<int> Maximum;
+
+  SectionCounter() : Count(0), Maximum(0) {}
+
+  void Enter()
+  {
+    int count = ++Count;
+    int maximum = Maximum;
+    while (count > maximum && !Maximum.compare_exchange_weak(maximum, count))
+    {
+    }
+  }
+
+  void Leave()
+  {
+    --Count;
+  }
+};
+
+std::vector<std::string> CreateFileNames(unsigned int numberOfFiles)
+{
+  std::vector<std::string> fileNames;
+  for (unsigned int i = 0; i < numberOfFiles; ++i)
+  {
+    std::ostringstream fileName;
+    fileName << "file" << i << ".dcm";
+    fileNames.push_back(fileName.str());
+  }
+  return fileNames;
+}
+
+/** Writes a row per file, taking longer for some files than others, and failing every failEvery'th file. */
+niftk::BatchProcessor::FunctionType CreateFunction(SectionCounter& ioCounter, SectionCounter& computeCounter, unsigned int failEvery)
+{
+  return [&ioCounter, &computeCounter, failEvery](niftk::BatchProcessor::Job& job)
+  {
+    {
+      niftk::BatchProcessor::IOSection io(job);
+      ioCounter.Enter();
+      std::this_thread::sleep_for(std::chrono::microseconds(100 * ((job.GetIndex() * 7) % 5)));
+      ioCounter.Leave();
+    }
+    {
+      niftk::BatchProcessor::ComputeSection compute(job);
+      computeCounter.Enter();
+      std::this_thread::sleep_for(std::chrono::microseconds(100 * ((job.GetIndex() * 3) % 4)));
+      computeCounter.Leave();
+    }
+
+    job.GetLog() << "File: " << job.GetFileName() << std::endl;
+    job.GetOutput() << "\"" << job.GetFileName() << "\"," << job.GetIndex();
+
+    if (failEvery > 0 && job.GetIndex() % failEvery == failEvery - 1)
+    {
+      throw std::runtime_error("Deliberate failure");
+    }
+
+    job.GetOutput() << std::endl;
+  };
+}
+
+std::string ExpectedOutput(const std::vector<std::string>& fileNames, std::size_t begin, std::size_t end, unsigned int failEvery)
+{
+  std::ostringstream output;
+  for (std::size_t i = begin; i < end; ++i)
+  {
+    if (failEvery == 0 || i % failEvery != failEvery - 1)
+    {
+      output << "\"" << fileNames[i] << "\"," << i << std::endl;
+    }
+  }
+  return output.str();
+}
+
+}
+
+//-----------------------------------------------------------------------------
+int TestOrderedOutput()
+{
+  std::vector<std::string> fileNames = CreateFileNames(200);
+
+  SectionCounter ioCounter;
+  SectionCounter computeCounter;
+
+  std::ostringstream output;
+  std::ostringstream log;
+  std::ostringstream errors;
+
+  niftk::BatchProcessor processor;
+  processor.SetNumberOfThreads(6);
+  processor.SetMaximumNumberOfIOJobs(2);
+  processor.SetMaximumNumberOfComputeJobs(3);
+  processor.SetOutputStream(&output);
+  processor.SetLogStream(&log);
+  processor.SetErrorStream(&errors);
+
+  std::size_t numberOfFailures = processor.Run(fileNames, CreateFunction(ioCounter, computeCounter, 7));
+
+  if (output.str() != ExpectedOutput(fileNames, 0, fileNames.size(), 7))
+  {
+    std::cerr << "The output is not in the order of the files:" << std::endl << output.str() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (numberOfFailures != 28 || processor.GetFailedFileNames().size() != 28
+      || processor.GetFailedFileNames()[0] != fileNames[6]
+      || processor.GetNumberOfSucceededFiles() != 172)
+  {
+    std::cerr << "Expected 28 failures, starting with " << fileNames[6] << ", but there were " << numberOfFailures << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::istringstream logLines(log.str());
+  std::string line;
+  for (std::size_t i = 0; i < fileNames.size(); ++i)
+  {
+    if (!std::getline(logLines, line) || line != "File: " + fileNames[i])
+    {
+      std::cerr << "The log is not in the order of the files, at " << fileNames[i] << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (ioCounter.Maximum > 2 || computeCounter.Maximum > 3)
+  {
+    std::cerr << "Up to " << ioCounter.Maximum << " I/O jobs, and " << computeCounter.Maximum
+              << " compute jobs, ran at the same time." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+int TestResume()
+{
+  std::vector<std::string> fileNames = CreateFileNames(100);
+  std::vector<std::string> firstFileNames(fileNames.begin(), fileNames.begin() + 40);
+
+  std::string progressFileName = niftk::CreateUniqueTempFileName("progress", ".txt");
+
+  SectionCounter ioCounter;
+  SectionCounter computeCounter;
+
+  std::ostringstream output;
+  std::ostringstream log;
+  std::ostringstream errors;
+
+  niftk::BatchProcessor processor;
+  processor.SetNumberOfThreads(4);
+  processor.SetOutputStream(&output);
+  processor.SetLogStream(&log);
+  processor.SetErrorStream(&errors);
+  processor.SetProgressFileName(progressFileName);
+
+  // An interrupted run, that only got through the first files, one of which failed.
+  processor.Run(firstFileNames, CreateFunction(ioCounter, computeCounter, 40));
+
+  // The run is resumed, the failed file is tried again, and now succeeds.
+  std::size_t numberOfFailures = processor.Run(fileNames, CreateFunction(ioCounter, computeCounter, 0));
+
+  niftk::FileDelete(progressFileName);
+
+  std::string expected = ExpectedOutput(fileNames, 0, 39, 0)
+      + ExpectedOutput(fileNames, 39, fileNames.size(), 0);
+
+  if (numberOfFailures != 0 || processor.GetNumberOfSkippedFiles() != 39 || processor.GetNumberOfSucceededFiles() != 61)
+  {
+    std::cerr << "Expected 39 files to be skipped and 61 to succeed, but " << processor.GetNumberOfSkippedFiles()
+              << " were skipped and " << processor.GetNumberOfSucceededFiles() << " succeeded." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (output.str() != expected)
+  {
+    std::cerr << "The resumed output is not the output of one run:" << std::endl << output.str() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+int TestRecursiveFilesOnThreads()
+{
+  fs::path directory = fs::temp_directory_path() / fs::unique_path("niftkBatchProcessorTest-%%%%-%%%%");
+
+  for (unsigned int i = 0; i < 5; ++i)
+  {
+    fs::path subDirectory = directory / ("sub" + std::to_string(i));
+    for (unsigned int j = 0; j < i; ++j)
+    {
+      subDirectory /= "nested" + std::to_string(j);
+      fs::create_directories(subDirectory);
+      for (unsigned int k = 0; k < 3; ++k)
+      {
+        std::ofstream((subDirectory / ("image" + std::to_string(k) + ".dcm")).string().c_str()) << k;
+      }
+    }
+  }
+  std::ofstream((directory / "top.dcm").string().c_str()) << 0;
+
+  std::vector<std::string> expected;
+  niftk::GetRecursiveFilesInDirectory(directory.string(), expected);
+  std::sort(expected.begin(), expected.end());
+
+  std::vector<std::string> fileNames;
+  niftk::GetRecursiveFilesInDirectory(directory.string(), fileNames, 4);
+
+  fs::remove_all(directory);
+
+  if (expected.size() != 31 || fileNames != expected)
+  {
+    std::cerr << "Found " << fileNames.size() << " files on 4 threads, and " << expected.size()
+              << " on one, expected 31." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Basic test harness for BatchProcessor.h
+ */
+int niftkBatchProcessorTest(int argc, char * argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Usage   :niftkBatchProcessorTest testNumber" << std::endl;
+    return 1;
+  }
+
+  int testNumber = atoi(argv[1]);
+
+  if (testNumber == 1)
+  {
+    return TestOrderedOutput();
+  }
+  else if (testNumber == 2)
+  {
+    return TestResume();
+  }
+  else if (testNumber == 3)
+  {
+    return TestRecursiveFilesOnThreads();
+  }
+  else
+  {
+    return EXIT_FAILURE;
+  }
+}
@@ -21,6 +21,7 @@
 
 void RegisterTests()
 {
+  REGISTER_TEST(niftkBatchProcessorTest);
   REGISTER_TEST(niftkFileHelperTest);
   REGISTER_TEST(niftkFixedLengthFileReaderTest);
 }
@@ -0,0 +1,360 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#include "niftkBatchProcessor.h"
+#include "Exceptions/niftkIOException.h"
+
+#include <algorithm>
+#include <fstream>
+#include <set>
+#include <system_error>
+#include <thread>
+
+namespace niftk
+{
+
+//-----------------------------------------------------------------------------
+BatchProcessor::Job::Job(BatchProcessor* processor, std::size_t index, const std::string& fileName)
+: m_Processor(processor)
+, m_Index(index)
+, m_FileName(fileName)
+{
+}
+
+
+//-----------------------------------------------------------------------------
+BatchProcessor::IOSection::IOSection(Job& job)
+: m_Processor(job.m_Processor)
+, m_IsHeld(true)
+{
+  m_Processor->m_IOSemaphore.Acquire();
+}
+
+
+//-----------------------------------------------------------------------------
+BatchProcessor::IOSection::~IOSection()
+{
+  this->Release();
+}
+
+
+//-----------------------------------------------------------------------------
+void BatchProcessor::IOSection::Release()
+{
+  if (m_IsHeld)
+  {
+    m_Processor->m_IOSemaphore.Release();
+    m_IsHeld = false;
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+BatchProcessor::ComputeSection::ComputeSection(Job& job)
+: m_Processor(job.m_Processor)
+, m_IsHeld(true)
+{
+  m_Processor->m_ComputeSemaphore.Acquire();
+}
+
+
+//-----------------------------------------------------------------------------
+BatchProcessor::ComputeSection::~ComputeSection()
+{
+  this->Release();
+}
+
+
+//-----------------------------------------------------------------------------
+void BatchProcessor::ComputeSection::Release()
+{
+  if (m_IsHeld)
+  {
+    m_Processor->m_ComputeSemaphore.Release();
+    m_IsHeld = false;
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+void BatchProcessor::Semaphore::Acquire()
+{
+  std::unique_lock<std::mutex> lock(m_Mutex);
+  while (m_Count == 0)
+  {
+    m_Condition.wait(lock);
+  }
+  --m_Count;
+}
+
+
+//-----------------------------------------------------------------------------
+void BatchProcessor::Semaphore::Release()
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  ++m_Count;
+  m_Condition.notify_one();
+}
+
+
+//-----------------------------------------------------------------------------
+BatchProcessor::BatchProcessor()
+: m_NumberOfThreads(0)
+, m_MaximumNumberOfIOJobs(0)
+, m_MaximumNumberOfComputeJobs(0)
+, m_OutputStream(&std::cout)
+, m_LogStream(&std::cout)
+, m_ErrorStream(&std::cerr)
+, m_ReportProgress(false)
+, m_NextJob(0)
+, m_NextResult(0)
+, m_MaximumNumberOfPendingJobs(0)
+, m_ProgressStream(NULL)
+, m_NumberOfFiles(0)
+, m_NumberOfSucceededFiles(0)
+, m_NumberOfSkippedFiles(0)
+{
+}
+
+
+//-----------------------------------------------------------------------------
+BatchProcessor::~BatchProcessor()
+{
+}
+
+
+//-----------------------------------------------------------------------------
+std::size_t BatchProcessor::Run(const std::vector<std::string>& fileNames, const FunctionType& function)
+{
+  unsigned int numberOfCores = std::max(std::thread::hardware_concurrency(), 1u);
+
+  unsigned int numberOfIOJobs = m_MaximumNumberOfIOJobs > 0 ? m_MaximumNumberOfIOJobs : numberOfCores;
+  unsigned int numberOfComputeJobs = m_MaximumNumberOfComputeJobs > 0 ? m_MaximumNumberOfComputeJobs : numberOfCores;
+  unsigned int numberOfThreads = m_NumberOfThreads > 0 ? m_NumberOfThreads : numberOfIOJobs + numberOfComputeJobs;
+
+  m_IOSemaphore.SetCount(numberOfIOJobs);
+  m_ComputeSemaphore.SetCount(numberOfComputeJobs);
+
+  m_NumberOfSucceededFiles = 0;
+  m_NumberOfSkippedFiles = 0;
+  m_FailedFileNames.clear();
+
+  // Skip the files that a previous run has done, and carry on adding to its list.
+
+  std::vector<std::size_t> remainingFiles;
+  std::ofstream progressStream;
+
+  if (!m_ProgressFileName.empty())
+  {
+    std::set<std::string> doneFileNames;
+    std::ifstream fin(m_ProgressFileName.c_str());
+    std::string line;
+    while (std::getline(fin, line))
+    {
+      if (!line.empty())
+      {
+        doneFileNames.insert(line);
+      }
+    }
+
+    for (std::size_t i = 0; i < fileNames.size(); ++i)
+    {
+      if (doneFileNames.count(fileNames[i]) > 0)
+      {
+        ++m_NumberOfSkippedFiles;
+      }
+      else
+      {
+        remainingFiles.push_back(i);
+      }
+    }
+
+    progressStream.open(m_ProgressFileName.c_str(), std::ios::out | std::ios::app);
+    if (!progressStream)
+    {
+      throw niftk::IOException("Failed to open progress file: " + m_ProgressFileName);
+    }
+  }
+  else
+  {
+    for (std::size_t i = 0; i < fileNames.size(); ++i)
+    {
+      remainingFiles.push_back(i);
+    }
+  }
+
+  if (remainingFiles.empty())
+  {
+    return 0;
+  }
+
+  numberOfThreads = static_cast<unsigned int>(std::min<std::size_t>(numberOfThreads, remainingFiles.size()));
+
+  m_NextJob = 0;
+  m_NextResult = 0;
+  m_MaximumNumberOfPendingJobs = 4 * numberOfThreads;
+  m_Results.clear();
+  m_ProgressStream = progressStream.is_open() ? &progressStream : NULL;
+  m_NumberOfFiles = fileNames.size();
+
+  // The calling thread is one of the workers. If no more threads can
+  // be started, the jobs are shared between those that have been.
+
+  std::vector<std::thread> threads;
+  for (unsigned int i = 1; i < numberOfThreads; ++i)
+  {
+    try
+    {
+      threads.push_back(std::thread(&BatchProcessor::ProcessJobs, this, std::cref(fileNames), std::cref(remainingFiles), std::cref(function)));
+    }
+    catch (const std::system_error& e)
+    {
+      if (m_ErrorStream)
+      {
+        *m_ErrorStream << "WARNING: Only started " << i << " of " << numberOfThreads << " threads: " << e.what() << std::endl;
+      }
+      break;
+    }
+  }
+
+  this->ProcessJobs(fileNames, remainingFiles, function);
+
+  for (std::size_t i = 0; i < threads.size(); ++i)
+  {
+    threads[i].join();
+  }
+
+  m_ProgressStream = NULL;
+
+  if (progressStream.is_open() && !progressStream)
+  {
+    throw niftk::IOException("Failed to write progress file: " + m_ProgressFileName);
+  }
+
+  return m_FailedFileNames.size();
+}
+
+
+//-----------------------------------------------------------------------------
+void BatchProcessor::ProcessJobs(const std::vector<std::string>& fileNames,
+                                 const std::vector<std::size_t>& files,
+                                 const FunctionType& function)
+{
+  std::unique_lock<std::mutex> lock(m_Mutex);
+
+  for (;;)
+  {
+    // Don't get too far ahead of the first job that is still running.
+    while (m_NextJob < files.size() && m_NextJob >= m_NextResult + m_MaximumNumberOfPendingJobs)
+    {
+      m_Condition.wait(lock);
+    }
+
+    if (m_NextJob >= files.size())
+    {
+      break;
+    }
+
+    std::size_t position = m_NextJob++;
+    lock.unlock();
+
+    Result result;
+    result.Failed = false;
+    {
+      Job job(this, files[position], fileNames[files[position]]);
+      try
+      {
+        function(job);
+      }
+      catch (const std::exception& e)
+      {
+        result.Failed = true;
+        result.Error = e.what();
+      }
+      catch (...)
+      {
+        result.Failed = true;
+        result.Error = "Unknown exception";
+      }
+
+      result.Log = job.m_Log.str();
+      if (!result.Failed)
+      {
+        result.Output = job.m_Output.str();
+      }
+    }
+
+    lock.lock();
+    m_Results[position] = std::move(result);
+    this->WriteResults(fileNames, files);
+    m_Condition.notify_all();
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+void BatchProcessor::WriteResults(const std::vector<std::string>& fileNames, const std::vector<std::size_t>& files)
+{
+  while (!m_Results.empty() && m_Results.begin()->first == m_NextResult)
+  {
+    const Result& result = m_Results.begin()->second;
+    const std::string& fileName = fileNames[files[m_NextResult]];
+
+    if (m_LogStream)
+    {
+      *m_LogStream << result.Log;
+    }
+
+    if (result.Failed)
+    {
+      m_FailedFileNames.push_back(fileName);
+
+      if (m_ErrorStream)
+      {
+        *m_ErrorStream << "ERROR: Skipping file: " << fileName << std::endl
+                       << result.Error << std::endl;
+      }
+    }
+    else
+    {
+      ++m_NumberOfSucceededFiles;
+
+      // The output is flushed before the file is marked as done, so
+      // that a resumed run never leaves out the file's output.
+      if (m_OutputStream)
+      {
+        *m_OutputStream << result.Output;
+        m_OutputStream->flush();
+      }
+
+      if (m_ProgressStream)
+      {
+        *m_ProgressStream << fileName << std::endl;
+      }
+    }
+
+    m_Results.erase(m_Results.begin());
+    ++m_NextResult;
+
+    if (m_ReportProgress && m_LogStream)
+    {
+      float progress = static_cast<float>(m_NumberOfSkippedFiles + m_NextResult) / m_NumberOfFiles;
+      *m_LogStream << "<filter-progress>" << std::endl
+                   << progress << std::endl
+                   << "</filter-progress>" << std::endl;
+    }
+  }
+}
+
+} // end namespace
@@ -0,0 +1,261 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#ifndef niftkBatchProcessor_h
+#define niftkBatchProcessor_h
+
+#include "niftkCommonWin32ExportHeader.h"
+
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace niftk
+{
+
+/**
+* \class BatchProcessor
+* \brief Calls a function on each of a list of files, on a bounded pool of threads.
+*
+* Each file is given to the function as a BatchProcessor::Job. The function brackets the
+* reading and writing of the file with an IOSection, and the processing of it with a
+* ComputeSection, so that no more than MaximumNumberOfIOJobs files are being read or written,
+* and no more than MaximumNumberOfComputeJobs are being processed, at the same time. Having
+* more threads than either limit lets the reading of some files overlap the processing of others.
+* The sections must not be nested.
+*
+* Whatever the function writes to Job::GetOutput() and Job::GetLog() is written to the output
+* and log streams in the order of the list, not the order the files finish in, so a CSV file
+* has the same rows in the same order whatever the number of threads. At most a few files per
+* thread are started ahead of the first one that has not finished.
+*
+* An exception thrown by the function fails that file only: its output is discarded, the error
+* is written to the error stream, and the rest of the files are processed as usual.
+*
+* If a progress file name is set, the name of each file that succeeded is appended to it, once
+* its output has been written and flushed, and files already listed in it are skipped. An
+* interrupted run, appending to the same output, therefore resumes where it stopped, and files
+* that failed are tried again.
+*
+* Example usage:
+\code{.cpp}
+niftk::BatchProcessor processor;
+processor.SetOutputStream(&foutCSV);
+processor.Run(fileNames, [](niftk::BatchProcessor::Job& job)
+  {
+    {
+      niftk::BatchProcessor::IOSection io(job);
+      // read job.GetFileName()
+    }
+    {
+      niftk::BatchProcessor::ComputeSection compute(job);
+      // process it
+    }
+    job.GetOutput() << job.GetFileName() << "," << result << std::endl;
+  });
+\endcode
+*/
+class NIFTKCOMMON_WINEXPORT BatchProcessor
+{
+public:
+
+  /**
+  * \brief One file, and the output and log text written for it.
+  */
+  class NIFTKCOMMON_WINEXPORT Job
+  {
+  public:
+
+    /** The position of the file in the list given to Run(). */
+    std::size_t GetIndex() const { return m_Index; }
+
+    const std::string& GetFileName() const { return m_FileName; }
+
+    /** Text for the output stream, discarded if the job fails. */
+    std::ostream& GetOutput() { return m_Output; }
+
+    /** Text for the log stream. */
+    std::ostream& GetLog() { return m_Log; }
+
+  private:
+
+    friend class BatchProcessor;
+
+    Job(BatchProcessor* processor, std::size_t index, const std::string& fileName);
+
+    Job(const Job&); // Purposefully not implemented.
+    Job& operator=(const Job&); // Purposefully not implemented.
+
+    BatchProcessor*    m_Processor;
+    std::size_t        m_Index;
+    std::string        m_FileName;
+    std::ostringstream m_Output;
+    std::ostringstream m_Log;
+  };
+
+  typedef std::function<void (Job&)> FunctionType;
+
+  /**
+  * \brief Waits for, and holds for its lifetime, one of the MaximumNumberOfIOJobs slots.
+  */
+  class NIFTKCOMMON_WINEXPORT IOSection
+  {
+  public:
+    IOSection(Job& job);
+    ~IOSection();
+    /** Gives the slot back before the section goes out of scope. */
+    void Release();
+  private:
+    IOSection(const IOSection&); // Purposefully not implemented.
+    IOSection& operator=(const IOSection&); // Purposefully not implemented.
+    BatchProcessor* m_Processor;
+    bool            m_IsHeld;
+  };
+
+  /**
+  * \brief Waits for, and holds for its lifetime, one of the MaximumNumberOfComputeJobs slots.
+  */
+  class NIFTKCOMMON_WINEXPORT ComputeSection
+  {
+  public:
+    ComputeSection(Job& job);
+    ~ComputeSection();
+    /** Gives the slot back before the section goes out of scope. */
+    void Release();
+  private:
+    ComputeSection(const ComputeSection&); // Purposefully not implemented.
+    ComputeSection& operator=(const ComputeSection&); // Purposefully not implemented.
+    BatchProcessor* m_Processor;
+    bool            m_IsHeld;
+  };
+
+  /** Writes to std::cout and std::cerr, with one compute job per core, and twice as many threads. */
+  BatchProcessor();
+  virtual ~BatchProcessor();
+
+  /** The number of worker threads, where 0, the default, means the number of I/O and compute jobs added. */
+  void SetNumberOfThreads(unsigned int numberOfThreads) { m_NumberOfThreads = numberOfThreads; }
+  unsigned int GetNumberOfThreads() const { return m_NumberOfThreads; }
+
+  /** The number of files read or written at the same time, where 0 means the number of cores. */
+  void SetMaximumNumberOfIOJobs(unsigned int maximumNumberOfIOJobs) { m_MaximumNumberOfIOJobs = maximumNumberOfIOJobs; }
+  unsigned int GetMaximumNumberOfIOJobs() const { return m_MaximumNumberOfIOJobs; }
+
+  /** The number of files processed at the same time, where 0 means the number of cores. */
+  void SetMaximumNumberOfComputeJobs(unsigned int maximumNumberOfComputeJobs) { m_MaximumNumberOfComputeJobs = maximumNumberOfComputeJobs; }
+  unsigned int GetMaximumNumberOfComputeJobs() const { return m_MaximumNumberOfComputeJobs; }
+
+  /** Where Job::GetOutput() text is written, or nowhere if NULL. */
+  void SetOutputStream(std::ostream* outputStream) { m_OutputStream = outputStream; }
+
+  /** Where Job::GetLog() text, and progress, is written, or nowhere if NULL. */
+  void SetLogStream(std::ostream* logStream) { m_LogStream = logStream; }
+
+  /** Where the errors of failed jobs are written, or nowhere if NULL. */
+  void SetErrorStream(std::ostream* errorStream) { m_ErrorStream = errorStream; }
+
+  /** The file listing the files that have been processed, or none if empty, the default. */
+  void SetProgressFileName(const std::string& progressFileName) { m_ProgressFileName = progressFileName; }
+  const std::string& GetProgressFileName() const { return m_ProgressFileName; }
+
+  /** Whether to write the fraction of files done to the log stream, as filter-progress XML, after each file. */
+  void SetReportProgress(bool reportProgress) { m_ReportProgress = reportProgress; }
+  bool GetReportProgress() const { return m_ReportProgress; }
+
+  /**
+  * Calls function on each of fileNames that is not listed in the progress file, returning when all are done.
+  * Throws a niftk::IOException if the progress file can't be written.
+  * @return the number of files that failed
+  */
+  std::size_t Run(const std::vector<std::string>& fileNames, const FunctionType& function);
+
+  /** The number of files, in the last Run(), that succeeded. */
+  std::size_t GetNumberOfSucceededFiles() const { return m_NumberOfSucceededFiles; }
+
+  /** The number of files, in the last Run(), that were skipped because they were in the progress file. */
+  std::size_t GetNumberOfSkippedFiles() const { return m_NumberOfSkippedFiles; }
+
+  /** The files, in the last Run(), that failed, in the order of the list. */
+  const std::vector<std::string>& GetFailedFileNames() const { return m_FailedFileNames; }
+
+private:
+
+  BatchProcessor(const BatchProcessor&); // Purposefully not implemented.
+  BatchProcessor& operator=(const BatchProcessor&); // Purposefully not implemented.
+
+  /** A counting semaphore, limiting how many jobs are in a section at once. */
+  class Semaphore
+  {
+  public:
+    Semaphore() : m_Count(0) {}
+    void SetCount(unsigned int count) { m_Count = count; }
+    void Acquire();
+    void Release();
+  private:
+    std::mutex              m_Mutex;
+    std::condition_variable m_Condition;
+    unsigned int            m_Count;
+  };
+
+  /** What a job left to be written. */
+  struct Result
+  {
+    std::string Output;
+    std::string Log;
+    std::string Error;
+    bool        Failed;
+  };
+
+  /** Takes the next of files, the indices of fileNames to process, while there are any, and runs it. */
+  void ProcessJobs(const std::vector<std::string>& fileNames,
+                   const std::vector<std::size_t>& files,
+                   const FunctionType& function);
+
+  /** Writes the finished results that are next in order. Called with m_Mutex locked. */
+  void WriteResults(const std::vector<std::string>& fileNames, const std::vector<std::size_t>& files);
+
+  unsigned int  m_NumberOfThreads;
+  unsigned int  m_MaximumNumberOfIOJobs;
+  unsigned int  m_MaximumNumberOfComputeJobs;
+  std::ostream* m_OutputStream;
+  std::ostream* m_LogStream;
+  std::ostream* m_ErrorStream;
+  std::string   m_ProgressFileName;
+  bool          m_ReportProgress;
+
+  Semaphore     m_IOSemaphore;
+  Semaphore     m_ComputeSemaphore;
+
+  std::mutex                      m_Mutex;
+  std::condition_variable         m_Condition;
+  std::size_t                     m_NextJob;
+  std::size_t                     m_NextResult;
+  std::size_t                     m_MaximumNumberOfPendingJobs;
+  std::map<std::size_t, Result>   m_Results;
+  std::ostream*                   m_ProgressStream;
+  std::size_t                     m_NumberOfFiles;
+
+  std::size_t                     m_NumberOfSucceededFiles;
+  std::size_t                     m_NumberOfSkippedFiles;
+  std::vector<std::string>        m_FailedFileNames;
+};
+
+} // end namespace
+
+#endif // niftkBatchProcessor_h
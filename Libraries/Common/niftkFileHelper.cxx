@@ -20,6 +20,10 @@
 #include <ostream>
 #include <sstream>
 #include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <system_error>
+#include <thread>
 #include "niftkFileHelper.h"
 #include "niftkEnvironmentHelper.h"
 #include <boost/filesystem.hpp>
@@ -244,7 +248,9 @@ bool CreateDirAndParents(const std::string& directoryPath)
   {
     if ( ! fs::exists( *iterDirectoryTree ) )
     {
-      if ( ! fs::create_directory( *iterDirectoryTree ) )
+      // Another thread or process may have just created it.
+      if ( ! fs::create_directory( *iterDirectoryTree )
+           && ! fs::is_directory( *iterDirectoryTree ) )
       {
         return false;
       }
@@ -455,6 +461,124 @@ void GetRecursiveFilesInDirectory(
 }
 
 
+//-----------------------------------------------------------------------------
+void GetRecursiveFilesInDirectory(
+    const std::string &directoryName,
+    std::vector<std::string> &fileNames,
+    unsigned int numberOfThreads)
+{
+  if (!DirectoryExists(directoryName))
+  {
+    throw std::logic_error("Directory does not exist!");
+  }
+
+  if (numberOfThreads == 0)
+  {
+    numberOfThreads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+
+  // Each thread takes a directory from the queue, lists it, and adds its
+  // sub-directories to the queue, until the queue is empty and no thread
+  // is listing a directory that might add to it.
+
+  std::deque<fs::path> directories;
+  directories.push_back( fs::path( directoryName ) );
+
+  std::vector<std::string> foundFileNames;
+  unsigned int numberOfBusyThreads = 0;
+
+  std::mutex mutex;
+  std::condition_variable condition;
+
+  auto listDirectories = [&]()
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    for (;;)
+    {
+      while ( directories.empty() && numberOfBusyThreads > 0 )
+      {
+        condition.wait(lock);
+      }
+
+      if ( directories.empty() )
+      {
+        break;
+      }
+
+      fs::path directory = directories.front();
+      directories.pop_front();
+      ++numberOfBusyThreads;
+      lock.unlock();
+
+      std::vector<fs::path> subDirectories;
+      std::vector<std::string> files;
+
+      try
+      {
+        fs::directory_iterator end_iter;
+
+        for ( fs::directory_iterator dir_itr( directory );
+              dir_itr != end_iter;
+              ++dir_itr )
+        {
+          try
+          {
+            if ( fs::is_directory( dir_itr->status() ) )
+            {
+              subDirectories.push_back( dir_itr->path() );
+            }
+            else if ( fs::is_regular_file( dir_itr->status() ) )
+            {
+              files.push_back( dir_itr->path().string() );
+            }
+          }
+          catch ( const std::exception & ex )
+          {
+            std::lock_guard<std::mutex> errorLock(mutex);
+            std::cerr << dir_itr->path() << " " << ex.what() << std::endl;
+          }
+        }
+      }
+      catch ( const std::exception & ex )
+      {
+        std::lock_guard<std::mutex> errorLock(mutex);
+        std::cerr << directory << " " << ex.what() << std::endl;
+      }
+
+      lock.lock();
+      directories.insert( directories.end(), subDirectories.begin(), subDirectories.end() );
+      foundFileNames.insert( foundFileNames.end(), files.begin(), files.end() );
+      --numberOfBusyThreads;
+      condition.notify_all();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for ( unsigned int i = 1; i < numberOfThreads; ++i )
+  {
+    try
+    {
+      threads.push_back( std::thread( listDirectories ) );
+    }
+    catch ( const std::system_error & )
+    {
+      break;
+    }
+  }
+
+  listDirectories();
+
+  for ( std::size_t i = 0; i < threads.size(); ++i )
+  {
+    threads[i].join();
+  }
+
+  std::sort( foundFileNames.begin(), foundFileNames.end() );
+  fileNames.insert( fileNames.end(), foundFileNames.begin(), foundFileNames.end() );
+}
+
+
 //-----------------------------------------------------------------------------
 bool NumericStringCompare( const std::string &string1, const std::string &string2)
 {
@@ -167,6 +167,18 @@ NIFTKCOMMON_WINEXPORT void GetRecursiveFilesInDirectory(
     const std::string& fullDirectoryName, std::vector<std::string> &fileNames);
 
 
+/**
+* Returns all files in a given directory and recursively in all sub-directories, or empty list if none found,
+* listing the sub-directories on several threads. The files are sorted, so the list is the same every time.
+* @param fullDirectoryName Directory name
+* @param fileNames The list of files found
+* @param numberOfThreads The number of threads, where 0 means the number of cores
+* @throw logic_error if directory name is invalid
+*/
+NIFTKCOMMON_WINEXPORT void GetRecursiveFilesInDirectory(
+    const std::string& fullDirectoryName, std::vector<std::string> &fileNames, unsigned int numberOfThreads);
+
+
 /**
 * A numeric string comparison operator, useful for sorting filenames into numeric order
 * @param string1
@@ -56,6 +56,7 @@ public:
 
 	typedef itk::ForwardAndBackwardProjectionMatrix< double, double > 		MatrixProjectorType;
 	typedef typename MatrixProjectorType::Pointer 												MatrixProjectorPointerType;
+	typedef typename MatrixProjectorType::CompressedSparseRowMatrixType 	CompressedSparseRowMatrixType;
 
   typedef typename MatrixProjectorType::InputImageType    							InputVolumeType;
   typedef typename MatrixProjectorType::InputImagePointer 							InputVolumePointer;
@@ -82,7 +83,7 @@ public:
   typedef typename SingleValuedCostFunction::DerivativeType 						DerivativeType;
 
   /// Set the 3D reconstruction estimate input volume
-  void SetInputVolume( InputVolumePointer inVolume ) { m_inVolume = inVolume; }
+  void SetInputVolume( InputVolumePointer inVolume ) { m_inVolume = inVolume; m_ForwardProjectionMatrixIsValid = false; }
 
   /// Set the 3D reconstruction estimate input volume as a vector form
   void SetInputVolumeVector( VectorType &inVolumeVector ) { m_EstimatedVolumeVector = inVolumeVector; }
@@ -92,26 +93,26 @@ public:
 	{ m_inProjOne = inProjectionOne; m_inProjTwo = inProjectionTwo; }
 
   /// Set the temporary projection image
-  void SetInputTempProjections( InputProjectionPointer tempProjection ) { m_inProjTemp = tempProjection; }
+  void SetInputTempProjections( InputProjectionPointer tempProjection ) { m_inProjTemp = tempProjection; m_ForwardProjectionMatrixIsValid = false; }
 
 	/// Set the total number of the voxels of the volume
-  void SetTotalVoxel( const unsigned long int &totalSize3D ) { m_totalSize3D = totalSize3D; }
+  void SetTotalVoxel( const unsigned long int &totalSize3D ) { m_totalSize3D = totalSize3D; m_ForwardProjectionMatrixIsValid = false; }
 
 	/// Set the total number of the pixels of the projection
-  void SetTotalPixel( const unsigned long int &totalSize2D ) { m_totalSize2D = totalSize2D; }
+  void SetTotalPixel( const unsigned long int &totalSize2D ) { m_totalSize2D = totalSize2D; m_ForwardProjectionMatrixIsValid = false; }
 
 	/// Set the total number of the pixels of the projection
-  void SetTotalProjectionNumber( const unsigned int &projNumber ) { m_ProjectionNumber = projNumber; }
+  void SetTotalProjectionNumber( const unsigned int &projNumber ) { m_ProjectionNumber = projNumber; m_ForwardProjectionMatrixIsValid = false; }
 
 	/// Set the total number of the pixels of the projection
-  void SetTotalProjectionSize( InputProjectionSizeType &projSize ) { m_InProjectionSize = projSize; }
+  void SetTotalProjectionSize( InputProjectionSizeType &projSize ) { m_InProjectionSize = projSize; m_ForwardProjectionMatrixIsValid = false; }
 
 
 	/// Set the projection geometry
-  void SetProjectionGeometry( ProjectionGeometryType::Pointer pGeometry ) { m_Geometry = pGeometry; }
+  void SetProjectionGeometry( ProjectionGeometryType::Pointer pGeometry ) { m_Geometry = pGeometry; m_ForwardProjectionMatrixIsValid = false; }
 
   /// Set the size, resolution and origin of the input volume
-  void SetInputVolumeSize(InputVolumeSizeType &inVolumeSize) {m_InVolumeSize = inVolumeSize;};
+  void SetInputVolumeSize(InputVolumeSizeType &inVolumeSize) {m_InVolumeSize = inVolumeSize; m_ForwardProjectionMatrixIsValid = false;};
   void SetInputVolumeSpacing(InputVolumeSpacingType &inVolumeSpacing) {m_InVolumeSpacing = inVolumeSpacing;};
   void SetInputVolumeOrigin(InputVolumePointType &inVolumeOrigin) {m_InVolumeOrigin = inVolumeOrigin;};
 
@@ -178,6 +179,11 @@ protected:
 
   void PrintSelf(std::ostream& os, Indent indent) const;
 
+  /** Trace the forward projection matrix, unless it already has been. It only
+    * depends on the geometry, not on the volume estimate, so is calculated
+    * once rather than at every evaluation. */
+  void UpdateForwardProjectionMatrix() const;
+
 #if 0
   /** Filename to optionally save the current iteration of the
       reconstruction estimate to */
@@ -207,7 +213,11 @@ protected:
 
 	InputProjectionSizeType                                     m_InProjectionSize;
 
-	ProjectionGeometryType::Pointer 														m_Geometry; 
+	ProjectionGeometryType::Pointer 														m_Geometry;
+
+	/// The forward projection matrix, whose transpose is the backward projection
+	mutable CompressedSparseRowMatrixType 											m_ForwardProjectionMatrix;
+	mutable bool 																								m_ForwardProjectionMatrixIsValid; 
 
 
 private:
@@ -37,6 +37,8 @@ ImageMatrixFormReconTwoDataSetsWithoutRegMetric<IntensityType>
 
   // Allocate the affine transformer
 	m_AffineTransformer = AffineTransformerType::New(); 
+
+  m_ForwardProjectionMatrixIsValid = false;
 }
 
 
@@ -69,6 +71,31 @@ ImageMatrixFormReconTwoDataSetsWithoutRegMetric<IntensityType>
 }
 
 
+/* -----------------------------------------------------------------------
+   UpdateForwardProjectionMatrix()
+   ----------------------------------------------------------------------- */
+
+template< class IntensityType>
+void
+ImageMatrixFormReconTwoDataSetsWithoutRegMetric<IntensityType>
+::UpdateForwardProjectionMatrix( void ) const
+{
+  if ( m_ForwardProjectionMatrixIsValid )
+    return;
+
+	InputVolumeSizeType inVolumeSize 		= m_InVolumeSize;
+	InputProjectionSizeType inProjSize 	= m_InProjectionSize;
+
+	// Set the projection geometry
+	m_MatrixProjector->SetProjectionGeometry( m_Geometry );
+
+  m_MatrixProjector->GetForwardProjectionSparseMatrix(m_ForwardProjectionMatrix, m_inVolume, m_inProjTemp, 
+       inVolumeSize, inProjSize, m_ProjectionNumber);
+
+  m_ForwardProjectionMatrixIsValid = true;
+}
+
+
 /* -----------------------------------------------------------------------
    GetValue() - Get the value of the similarity metric
    ----------------------------------------------------------------------- */
@@ -99,32 +126,19 @@ ImageMatrixFormReconTwoDataSetsWithoutRegMetric<IntensityType>
 
   }
 
-	// Allocate the matrix projector
-	MatrixProjectorPointerType	m_MatrixProjector;
-  if ( m_MatrixProjector.IsNull() )
-    m_MatrixProjector = MatrixProjectorType::New();
-
 	InputVolumeSizeType inVolumeSize 		= m_InVolumeSize;
-	InputProjectionSizeType inProjSize 	= m_InProjectionSize;
-
-	// Create the corresponding forward/backward projection matrix
-  const unsigned long int totalSizeAllProjs = m_ProjectionNumber*m_totalSize2D;
-  static SparseMatrixType forwardProjectionMatrix(totalSizeAllProjs, m_totalSize3D);
 
-	// Set the projection geometry
-	m_MatrixProjector->SetProjectionGeometry( m_Geometry );
-
-  m_MatrixProjector->GetForwardProjectionSparseMatrix(forwardProjectionMatrix, m_inVolume, m_inProjTemp, 
-       inVolumeSize, inProjSize, m_ProjectionNumber);
+	// Create the corresponding forward projection matrix
+	this->UpdateForwardProjectionMatrix();
 
   // Calculate the matrix/vector multiplication in order to get the forward projection (Ax)
   VectorType forwardProjectedVectorOne(m_totalSize3D);
   forwardProjectedVectorOne.fill(0.);
 
-  m_MatrixProjector->CalculteMatrixVectorMultiplication(forwardProjectionMatrix, m_EstimatedVolumeVector, forwardProjectedVectorOne);
+  m_MatrixProjector->CalculteMatrixVectorMultiplication(m_ForwardProjectionMatrix, m_EstimatedVolumeVector, forwardProjectedVectorOne);
 
 	// Create the corresponding transformation matrix
-	static SparseMatrixType affineMatrix(m_totalSize3D, m_totalSize3D);
+	CompressedSparseRowMatrixType affineMatrix;
 
 	EulerAffineTransformType::ParametersType fixedCorrectEulerAffineParameters(12);
 	fixedCorrectEulerAffineParameters.Fill(0.);
@@ -156,14 +170,14 @@ ImageMatrixFormReconTwoDataSetsWithoutRegMetric<IntensityType>
 	VectorType affineTransformedVector(m_totalSize3D);
 	affineTransformedVector.fill(0.);
 
-	m_AffineTransformer->CalculteMatrixVectorMultiplication(affineMatrix, m_EstimatedVolumeVector, affineTransformedVector);
+	affineMatrix.Multiply(m_EstimatedVolumeVector, affineTransformedVector);
 
 	// Calculate the matrix/vector multiplication in order to get the forward projection (ARx)
 	assert (!affineTransformedVector.is_zero());
 	VectorType forwardProjectedVectorTwo(m_totalSize3D);
 	forwardProjectedVectorTwo.fill(0.);
 			
-	m_MatrixProjector->CalculteMatrixVectorMultiplication(forwardProjectionMatrix, affineTransformedVector, forwardProjectedVectorTwo);
+	m_MatrixProjector->CalculteMatrixVectorMultiplication(m_ForwardProjectionMatrix, affineTransformedVector, forwardProjectedVectorTwo);
 
 	// Initialise the current measure
   MeasureType currentMeasure;
@@ -228,36 +242,19 @@ ImageMatrixFormReconTwoDataSetsWithoutRegMetric<IntensityType>
 
   }
 
-	// Allocate the matrix projector
-	MatrixProjectorPointerType	m_MatrixProjector;
-  if ( m_MatrixProjector.IsNull() )
-    m_MatrixProjector = MatrixProjectorType::New();
-
 	InputVolumeSizeType inVolumeSize 		= m_InVolumeSize;
-	InputProjectionSizeType inProjSize 	= m_InProjectionSize;
-
-	// Create the corresponding forward/backward projection matrix
-  const unsigned long int totalSizeAllProjs = m_ProjectionNumber*m_totalSize2D;
-  static SparseMatrixType forwardProjectionMatrix(totalSizeAllProjs, m_totalSize3D);
-  static SparseMatrixType backwardProjectionMatrix(m_totalSize3D, totalSizeAllProjs);
 
-	// Set the projection geometry
-	m_MatrixProjector->SetProjectionGeometry( m_Geometry );
-
-  m_MatrixProjector->GetForwardProjectionSparseMatrix(forwardProjectionMatrix, m_inVolume, m_inProjTemp, 
-       inVolumeSize, inProjSize, m_ProjectionNumber);
-  m_MatrixProjector->GetBackwardProjectionSparseMatrix(forwardProjectionMatrix, backwardProjectionMatrix, 
-       inVolumeSize, inProjSize, m_ProjectionNumber);
+	// Create the corresponding forward projection matrix, whose transpose is the backward projection
+	this->UpdateForwardProjectionMatrix();
 
   // Calculate the matrix/vector multiplication in order to get the forward projection (Ax)
   VectorType forwardProjectedVectorOne(m_totalSize3D);
   forwardProjectedVectorOne.fill(0.);
 
-  m_MatrixProjector->CalculteMatrixVectorMultiplication(forwardProjectionMatrix, m_EstimatedVolumeVector, forwardProjectedVectorOne);
+  m_MatrixProjector->CalculteMatrixVectorMultiplication(m_ForwardProjectionMatrix, m_EstimatedVolumeVector, forwardProjectedVectorOne);
 
-	// Create the corresponding transformation matrix
-	static SparseMatrixType affineMatrix(m_totalSize3D, m_totalSize3D);
-	static SparseMatrixType affineMatrixTranspose(m_totalSize3D, m_totalSize3D);
+	// Create the corresponding transformation matrix, whose transpose is applied with TransposeMultiply()
+	CompressedSparseRowMatrixType affineMatrix;
 
 	EulerAffineTransformType::ParametersType fixedCorrectEulerAffineParameters(12);
 	fixedCorrectEulerAffineParameters.Fill(0.);
@@ -289,15 +286,14 @@ ImageMatrixFormReconTwoDataSetsWithoutRegMetric<IntensityType>
 	VectorType affineTransformedVector(m_totalSize3D);
 	affineTransformedVector.fill(0.);
 
-	m_AffineTransformer->CalculteMatrixVectorMultiplication(affineMatrix, m_EstimatedVolumeVector, affineTransformedVector);
-  m_AffineTransformer->GetAffineTransformationSparseMatrixT(affineMatrix, affineMatrixTranspose, inVolumeSize);
+	affineMatrix.Multiply(m_EstimatedVolumeVector, affineTransformedVector);
 
 	// Calculate the matrix/vector multiplication in order to get the forward projection (ARx)
 	assert (!affineTransformedVector.is_zero());
 	VectorType forwardProjectedVectorTwo(m_totalSize3D);
 	forwardProjectedVectorTwo.fill(0.);
 			
-	m_MatrixProjector->CalculteMatrixVectorMultiplication(forwardProjectionMatrix, affineTransformedVector, forwardProjectedVectorTwo);
+	m_MatrixProjector->CalculteMatrixVectorMultiplication(m_ForwardProjectionMatrix, affineTransformedVector, forwardProjectedVectorTwo);
 
 	// Calculate (Ax - y_1) and (ARx - y_2)
 	VectorType	m_inProjOneSub(m_totalSize3D);
@@ -316,15 +312,15 @@ ImageMatrixFormReconTwoDataSetsWithoutRegMetric<IntensityType>
 	inBackProjOne.fill(0.);
 	inBackProjTwo.fill(0.);
 
-	m_MatrixProjector->CalculteMatrixVectorMultiplication(backwardProjectionMatrix, m_inProjOneSub, inBackProjOne);
-	m_MatrixProjector->CalculteMatrixVectorMultiplication(backwardProjectionMatrix, m_inProjTwoSub, inBackProjTwo);
+	m_MatrixProjector->CalculteTransposeMatrixVectorMultiplication(m_ForwardProjectionMatrix, m_inProjOneSub, inBackProjOne);
+	m_MatrixProjector->CalculteTransposeMatrixVectorMultiplication(m_ForwardProjectionMatrix, m_inProjTwoSub, inBackProjTwo);
 
 	// Obtain the transpose of affine transformation matrix with the backprojection set two (R^T A^T (ARx - y_2))
 	// assert (!inBackProjOne.is_zero() && !inBackProjTwo.is_zero());
 	VectorType	inAffineTransposeBackProjTwo(m_totalSize3D);
 	inAffineTransposeBackProjTwo.fill(0.);
 			
-	m_AffineTransformer->CalculteMatrixVectorMultiplication(affineMatrixTranspose, inBackProjTwo, inAffineTransposeBackProjTwo);
+	affineMatrix.TransposeMultiply(inBackProjTwo, inAffineTransposeBackProjTwo);
 
 	// std::cerr << "The size of the backprojection is: " 	<< inBackProj.size() << std::endl;
 	// std::cerr << "The size of the derivative is: " 			<< derivative.size() << std::endl;
@@ -34,6 +34,8 @@ ImageMatrixFormReconstructionMetric<IntensityType>
 
   // Create the matrix projector
   m_MatrixProjector = MatrixProjectorType::New();
+
+  m_ForwardProjectionMatrixIsValid = false;
   
 }
 
@@ -67,6 +69,31 @@ ImageMatrixFormReconstructionMetric<IntensityType>
 }
 
 
+/* -----------------------------------------------------------------------
+   UpdateForwardProjectionMatrix()
+   ----------------------------------------------------------------------- */
+
+template< class IntensityType>
+void
+ImageMatrixFormReconstructionMetric<IntensityType>
+::UpdateForwardProjectionMatrix( void ) const
+{
+  if ( m_ForwardProjectionMatrixIsValid )
+    return;
+
+	InputVolumeSizeType inVolumeSize 		= m_InVolumeSize;
+	InputProjectionSizeType inProjSize 	= m_InProjectionSize;
+
+	// Set the projection geometry
+	m_MatrixProjector->SetProjectionGeometry( m_Geometry );
+
+  m_MatrixProjector->GetForwardProjectionSparseMatrix(m_ForwardProjectionMatrix, m_inVolume, m_inProjTemp, 
+       inVolumeSize, inProjSize, m_ProjectionNumber);
+
+  m_ForwardProjectionMatrixIsValid = true;
+}
+
+
 /* -----------------------------------------------------------------------
    GetValue() - Get the value of the similarity metric
    ----------------------------------------------------------------------- */
@@ -97,29 +124,14 @@ ImageMatrixFormReconstructionMetric<IntensityType>
 
   }
 
-	// Allocate the matrix projector
-	MatrixProjectorPointerType	m_MatrixProjector;
-  if ( m_MatrixProjector.IsNull() )
-    m_MatrixProjector = MatrixProjectorType::New();
-
-	InputVolumeSizeType inVolumeSize 		= m_InVolumeSize;
-	InputProjectionSizeType inProjSize 	= m_InProjectionSize;
-
-	// Create the corresponding forward/backward projection matrix
-  const unsigned long int totalSizeAllProjs = m_ProjectionNumber*m_totalSize2D;
-  static SparseMatrixType forwardProjectionMatrix(totalSizeAllProjs, m_totalSize3D);
-
-	// Set the projection geometry
-	m_MatrixProjector->SetProjectionGeometry( m_Geometry );
-
-  m_MatrixProjector->GetForwardProjectionSparseMatrix(forwardProjectionMatrix, m_inVolume, m_inProjTemp, 
-       inVolumeSize, inProjSize, m_ProjectionNumber);
+	// Create the corresponding forward projection matrix
+	this->UpdateForwardProjectionMatrix();
 
   // Calculate the matrix/vector multiplication in order to get the forward projection (Ax)
-  VectorType forwardProjectedVector(m_totalSize3D);
+  VectorType forwardProjectedVector(m_ProjectionNumber*m_totalSize2D);
   forwardProjectedVector.fill(0.);
 
-  m_MatrixProjector->CalculteMatrixVectorMultiplication(forwardProjectionMatrix, m_EstimatedVolumeVector, forwardProjectedVector);
+  m_MatrixProjector->CalculteMatrixVectorMultiplication(m_ForwardProjectionMatrix, m_EstimatedVolumeVector, forwardProjectedVector);
 
 	// Initialise the current measure
   MeasureType currentMeasure;
@@ -174,32 +186,14 @@ ImageMatrixFormReconstructionMetric<IntensityType>
 
   }
 
-	// Allocate the matrix projector
-	MatrixProjectorPointerType	m_MatrixProjector;
-  if ( m_MatrixProjector.IsNull() )
-    m_MatrixProjector = MatrixProjectorType::New();
-
-	InputVolumeSizeType inVolumeSize 		= m_InVolumeSize;
-	InputProjectionSizeType inProjSize 	= m_InProjectionSize;
-
-	// Create the corresponding forward/backward projection matrix
-  const unsigned long int totalSizeAllProjs = m_ProjectionNumber*m_totalSize2D;
-  static SparseMatrixType forwardProjectionMatrix(totalSizeAllProjs, m_totalSize3D);
-  static SparseMatrixType backwardProjectionMatrix(m_totalSize3D, totalSizeAllProjs);
-
-	// Set the projection geometry
-	m_MatrixProjector->SetProjectionGeometry( m_Geometry );
-
-  m_MatrixProjector->GetForwardProjectionSparseMatrix(forwardProjectionMatrix, m_inVolume, m_inProjTemp, 
-       inVolumeSize, inProjSize, m_ProjectionNumber);
-  m_MatrixProjector->GetBackwardProjectionSparseMatrix(forwardProjectionMatrix, backwardProjectionMatrix, 
-       inVolumeSize, inProjSize, m_ProjectionNumber);
+	// Create the corresponding forward projection matrix, the backward projection is its transpose
+	this->UpdateForwardProjectionMatrix();
 
   // Calculate the matrix/vector multiplication in order to get the forward projection (Ax)
-  VectorType forwardProjectedVector(m_totalSize3D);
+  VectorType forwardProjectedVector(m_ProjectionNumber*m_totalSize2D);
   forwardProjectedVector.fill(0.);
 
-  m_MatrixProjector->CalculteMatrixVectorMultiplication(forwardProjectionMatrix, m_EstimatedVolumeVector, forwardProjectedVector);
+  m_MatrixProjector->CalculteMatrixVectorMultiplication(m_ForwardProjectionMatrix, m_EstimatedVolumeVector, forwardProjectedVector);
 
 	// Calculate (Ax - y_1)
   VectorType	m_inProjSub(m_totalSize3D);
@@ -212,7 +206,7 @@ ImageMatrixFormReconstructionMetric<IntensityType>
 	VectorType	inBackProj(m_totalSize3D); 
 	inBackProj.fill(0.);
 
-	m_MatrixProjector->CalculteMatrixVectorMultiplication(backwardProjectionMatrix, m_inProjSub, inBackProj);
+	m_MatrixProjector->CalculteTransposeMatrixVectorMultiplication(m_ForwardProjectionMatrix, m_inProjSub, inBackProj);
 
 	// std::cerr << "The size of the backprojection is: " 	<< inBackProj.size() << std::endl;
 	// std::cerr << "The size of the derivative is: " 			<< derivative.size() << std::endl;
@@ -37,6 +37,8 @@ MatrixBasedSimulReconRegnMetric<IntensityType>
 
   // Allocate the affine transformer
 	m_AffineTransformer = AffineTransformerType::New();
+
+  m_ForwardProjectionMatrixIsValid = false;
 }
 
 
@@ -69,6 +71,31 @@ MatrixBasedSimulReconRegnMetric<IntensityType>
 }
 
 
+/* -----------------------------------------------------------------------
+   UpdateForwardProjectionMatrix()
+   ----------------------------------------------------------------------- */
+
+template< class IntensityType>
+void
+MatrixBasedSimulReconRegnMetric<IntensityType>
+::UpdateForwardProjectionMatrix( void ) const
+{
+  if ( m_ForwardProjectionMatrixIsValid )
+    return;
+
+	InputVolumeSizeType inVolumeSize 		= m_InVolumeSize;
+	InputProjectionSizeType inProjSize 	= m_InProjectionSize;
+
+	// Set the projection geometry
+	m_MatrixProjector->SetProjectionGeometry( m_Geometry );
+
+  m_MatrixProjector->GetForwardProjectionSparseMatrix(m_ForwardProjectionMatrix, m_inVolume, m_inProjTemp, 
+       inVolumeSize, inProjSize, m_ProjectionNumber);
+
+  m_ForwardProjectionMatrixIsValid = true;
+}
+
+
 /* -----------------------------------------------------------------------
    GetValue() - Get the value of the similarity metric
    ----------------------------------------------------------------------- */
@@ -113,32 +140,19 @@ MatrixBasedSimulReconRegnMetric<IntensityType>
 
   }
 
-	// Allocate the matrix projector
-	MatrixProjectorPointerType	m_MatrixProjector;
-  if ( m_MatrixProjector.IsNull() )
-    m_MatrixProjector = MatrixProjectorType::New();
-
 	InputVolumeSizeType inVolumeSize 		= m_InVolumeSize;
-	InputProjectionSizeType inProjSize 	= m_InProjectionSize;
-
-	// Create the corresponding forward/backward projection matrix
-  const unsigned long int totalSizeAllProjs = m_ProjectionNumber*m_totalSize2D;
-  static SparseMatrixType forwardProjectionMatrix(totalSizeAllProjs, m_totalSize3D);
 
-	// Set the projection geometry
-	m_MatrixProjector->SetProjectionGeometry( m_Geometry );
-
-  m_MatrixProjector->GetForwardProjectionSparseMatrix(forwardProjectionMatrix, m_inVolume, m_inProjTemp, 
-       inVolumeSize, inProjSize, m_ProjectionNumber);
+	// Create the corresponding forward projection matrix
+	this->UpdateForwardProjectionMatrix();
 
   // Calculate the matrix/vector multiplication in order to get the forward projection (Ax)
   VectorType forwardProjectedVectorOne(m_totalSize3D);
   forwardProjectedVectorOne.fill(0.);
 
-  m_MatrixProjector->CalculteMatrixVectorMultiplication(forwardProjectionMatrix, m_EstimatedVolumeVector, forwardProjectedVectorOne);
+  m_MatrixProjector->CalculteMatrixVectorMultiplication(m_ForwardProjectionMatrix, m_EstimatedVolumeVector, forwardProjectedVectorOne);
 
 	// Create the corresponding transformation matrix
-	static SparseMatrixType affineMatrix(m_totalSize3D, m_totalSize3D);
+	CompressedSparseRowMatrixType affineMatrix;
 
 	EulerAffineTransformType::ParametersType tempEulerAffineParameters(m_paraNumber);
 	tempEulerAffineParameters.Fill(0.);
@@ -166,14 +180,14 @@ MatrixBasedSimulReconRegnMetric<IntensityType>
 	VectorType affineTransformedVector(m_totalSize3D);
 	affineTransformedVector.fill(0.);
 
-	m_AffineTransformer->CalculteMatrixVectorMultiplication(affineMatrix, m_EstimatedVolumeVector, affineTransformedVector);
+	affineMatrix.Multiply(m_EstimatedVolumeVector, affineTransformedVector);
 
 	// Calculate the matrix/vector multiplication in order to get the forward projection (ARx)
 	assert (!affineTransformedVector.is_zero());
 	VectorType forwardProjectedVectorTwo(m_totalSize3D);
 	forwardProjectedVectorTwo.fill(0.);
 			
-	m_MatrixProjector->CalculteMatrixVectorMultiplication(forwardProjectionMatrix, affineTransformedVector, forwardProjectedVectorTwo);
+	m_MatrixProjector->CalculteMatrixVectorMultiplication(m_ForwardProjectionMatrix, affineTransformedVector, forwardProjectedVectorTwo);
 
 	// Initialise the current measure
   MeasureType currentMeasure;
@@ -247,36 +261,19 @@ MatrixBasedSimulReconRegnMetric<IntensityType>
 
   }
 
-	// Allocate the matrix projector
-	MatrixProjectorPointerType	m_MatrixProjector;
-  if ( m_MatrixProjector.IsNull() )
-    m_MatrixProjector = MatrixProjectorType::New();
-
 	InputVolumeSizeType inVolumeSize 		= m_InVolumeSize;
-	InputProjectionSizeType inProjSize 	= m_InProjectionSize;
-
-	// Create the corresponding forward/backward projection matrix
-  const unsigned long int totalSizeAllProjs = m_ProjectionNumber*m_totalSize2D;
-  static SparseMatrixType forwardProjectionMatrix(totalSizeAllProjs, m_totalSize3D);
-  static SparseMatrixType backwardProjectionMatrix(m_totalSize3D, totalSizeAllProjs);
 
-	// Set the projection geometry
-	m_MatrixProjector->SetProjectionGeometry( m_Geometry );
-
-  m_MatrixProjector->GetForwardProjectionSparseMatrix(forwardProjectionMatrix, m_inVolume, m_inProjTemp, 
-       inVolumeSize, inProjSize, m_ProjectionNumber);
-  m_MatrixProjector->GetBackwardProjectionSparseMatrix(forwardProjectionMatrix, backwardProjectionMatrix, 
-       inVolumeSize, inProjSize, m_ProjectionNumber);
+	// Create the corresponding forward projection matrix, the backward projection is its transpose
+	this->UpdateForwardProjectionMatrix();
 
   // Calculate the matrix/vector multiplication in order to get the forward projection (Ax)
   VectorType forwardProjectedVectorOne(m_totalSize3D);
   forwardProjectedVectorOne.fill(0.);
 
-  m_MatrixProjector->CalculteMatrixVectorMultiplication(forwardProjectionMatrix, m_EstimatedVolumeVector, forwardProjectedVectorOne);
+  m_MatrixProjector->CalculteMatrixVectorMultiplication(m_ForwardProjectionMatrix, m_EstimatedVolumeVector, forwardProjectedVectorOne);
 
 	// Create the corresponding transformation matrix
-	static SparseMatrixType affineMatrix(m_totalSize3D, m_totalSize3D);
-	static SparseMatrixType affineMatrixTranspose(m_totalSize3D, m_totalSize3D);
+	CompressedSparseRowMatrixType affineMatrix;
 
 	EulerAffineTransformType::ParametersType tempEulerAffineParameters(m_paraNumber);
 	tempEulerAffineParameters.Fill(0.);
@@ -295,21 +292,21 @@ MatrixBasedSimulReconRegnMetric<IntensityType>
 	for (unsigned int iPara = 0; iPara < m_paraNumber; iPara++)
 		 tempEulerAffineParameters[iPara] = m_TransformationParameterVector[iPara];
 
+	// Compressed, so that R^T can be applied without forming it
 	m_AffineTransformer->GetAffineTransformationSparseMatrix(affineMatrix, inVolumeSize, tempEulerAffineParameters);
-  m_AffineTransformer->GetAffineTransformationSparseMatrixT(affineMatrix, affineMatrixTranspose, inVolumeSize);
 
 	// Calculate the matrix/vector multiplication in order to get the affine transformation (Rx)
 	VectorType affineTransformedVector(m_totalSize3D);
 	affineTransformedVector.fill(0.);
 
-	m_AffineTransformer->CalculteMatrixVectorMultiplication(affineMatrix, m_EstimatedVolumeVector, affineTransformedVector);
+	affineMatrix.Multiply(m_EstimatedVolumeVector, affineTransformedVector);
 
 	// Calculate the matrix/vector multiplication in order to get the forward projection (ARx)
 	assert (!affineTransformedVector.is_zero());
 	VectorType forwardProjectedVectorTwo(m_totalSize3D);
 	forwardProjectedVectorTwo.fill(0.);
 			
-	m_MatrixProjector->CalculteMatrixVectorMultiplication(forwardProjectionMatrix, affineTransformedVector, forwardProjectedVectorTwo);
+	m_MatrixProjector->CalculteMatrixVectorMultiplication(m_ForwardProjectionMatrix, affineTransformedVector, forwardProjectedVectorTwo);
 
 	// Calculate (Ax - y_1) and (ARx - y_2)
 	VectorType	m_inProjOneSub(m_totalSize3D);
@@ -331,15 +328,15 @@ MatrixBasedSimulReconRegnMetric<IntensityType>
 	inBackProjOne.fill(0.);
 	inBackProjTwo.fill(0.);
 
-	m_MatrixProjector->CalculteMatrixVectorMultiplication(backwardProjectionMatrix, m_inProjOneSub, inBackProjOne);
-	m_MatrixProjector->CalculteMatrixVectorMultiplication(backwardProjectionMatrix, m_inProjTwoSub, inBackProjTwo);
+	m_MatrixProjector->CalculteTransposeMatrixVectorMultiplication(m_ForwardProjectionMatrix, m_inProjOneSub, inBackProjOne);
+	m_MatrixProjector->CalculteTransposeMatrixVectorMultiplication(m_ForwardProjectionMatrix, m_inProjTwoSub, inBackProjTwo);
 
 	// Obtain the transpose of affine transformation matrix with the backprojection set two (R^T A^T (ARx - y_2))
 	// assert (!inBackProjOne.is_zero() && !inBackProjTwo.is_zero());
 	VectorType	inAffineTransposeBackProjTwo(m_totalSize3D);
 	inAffineTransposeBackProjTwo.fill(0.);
 			
-	m_AffineTransformer->CalculteMatrixVectorMultiplication(affineMatrixTranspose, inBackProjTwo, inAffineTransposeBackProjTwo);
+	affineMatrix.TransposeMultiply(inBackProjTwo, inAffineTransposeBackProjTwo);
 
 	// Create a derivative vector to store the values of the derivative
 	VectorType  derivativeParameters(m_totalSize3D + m_paraNumber);
@@ -385,9 +382,7 @@ MatrixBasedSimulReconRegnMetric<IntensityType>
   f2PlusSqrt.fill(0.);
 	double f2Plus;
 
-  static SparseMatrixType affineMatrixQ(m_totalSize3D, m_totalSize3D);
-  static SparseMatrixType affineMatrixQPlus(m_totalSize3D, m_totalSize3D);
-  static SparseMatrixType affineMatrixQT(m_totalSize3D, m_totalSize3D);
+  CompressedSparseRowMatrixType affineMatrixQPlus;
 
   EulerAffineTransformType::ParametersType parametersTempPlus(12);
 	parametersTempPlus.Fill(0.);
@@ -399,15 +394,15 @@ MatrixBasedSimulReconRegnMetric<IntensityType>
 		parametersTempPlus = tempEulerAffineParameters;
 		parametersTempPlus[iPara] += m_epsilonVal;
 
-		// Get R'(p)
+		// Get R(p + (epsilon x e))
 		m_AffineTransformer->GetAffineTransformationSparseMatrix(affineMatrixQPlus, inVolumeSize, parametersTempPlus);
-		affineMatrixQPlus.subtract(affineMatrix, affineMatrixQ);
 
-		// Get R'(x,p)
-		m_AffineTransformer->CalculteMatrixVectorMultiplication(affineMatrixQ, m_EstimatedVolumeVector, updatedAffineTransformedImage);
+		// Get R'(x,p), as R(p + (epsilon x e))x - Rx, rather than forming the difference of the matrices
+		affineMatrixQPlus.Multiply(m_EstimatedVolumeVector, updatedAffineTransformedImage);
+		updatedAffineTransformedImage -= affineTransformedVector;
 
 		// Get forward projection for R'(p), which is AR'(x,p)
-		m_MatrixProjector->CalculteMatrixVectorMultiplication(forwardProjectionMatrix, updatedAffineTransformedImage, forwardProjUpdatedAffineTransformedImage);
+		m_MatrixProjector->CalculteMatrixVectorMultiplication(m_ForwardProjectionMatrix, updatedAffineTransformedImage, forwardProjUpdatedAffineTransformedImage);
 
 		// Get ||AR'(x,p) - y_2||^2
 		f2PlusSqrt = forwardProjUpdatedAffineTransformedImage - this->m_inProjTwo;
@@ -430,7 +425,7 @@ MatrixBasedSimulReconRegnMetric<IntensityType>
 		gradientImage = gradientImageTemp;
 
 		// Get forward projection for R'(x,p), which is AR'(x,p)
-		m_MatrixProjector->CalculteMatrixVectorMultiplication(forwardProjectionMatrix, gradientImage, vectorFowardGradientImage);
+		m_MatrixProjector->CalculteMatrixVectorMultiplication(m_ForwardProjectionMatrix, gradientImage, vectorFowardGradientImage);
 
 		// Forward projection of the derivative image (AR'(x,p))^T dot product with difference (AR(x,p)-y_2): m_inProjTwoSub
 		// which is (AR'(x,p))^T (AR(x,p)-y_2)
@@ -30,7 +30,11 @@ namespace itk
     SimultaneousUnconstrainedMatrixReconRegnMetric<TScalarType, IntensityType>
     ::SimultaneousUnconstrainedMatrixReconRegnMetric()
     {
+      // Create the matrix projector and the affine transformer
+      m_MatrixProjector = MatrixProjectorType::New();
+      m_AffineTransformer = AffineTransformerType::New();
 
+      m_ForwardProjectionMatrixIsValid = false;
     }
 
 
@@ -66,6 +70,31 @@ namespace itk
     }
 
 
+  /* -----------------------------------------------------------------------
+     UpdateForwardProjectionMatrix()
+     ----------------------------------------------------------------------- */
+
+  template <class TScalarType, class IntensityType>
+    void
+    SimultaneousUnconstrainedMatrixReconRegnMetric<TScalarType, IntensityType>
+    ::UpdateForwardProjectionMatrix( void ) const
+    {
+      if ( m_ForwardProjectionMatrixIsValid )
+        return;
+
+			InputVolumeSizeType inVolumeSize 		= m_InVolumeSize;
+			InputProjectionSizeType inProjSize 	= m_InProjectionSize;
+
+			// Set the projection geometry
+			m_MatrixProjector->SetProjectionGeometry( m_Geometry );
+
+      m_MatrixProjector->GetForwardProjectionSparseMatrix(m_ForwardProjectionMatrix, m_inVolume, m_inProjTemp, 
+           inVolumeSize, inProjSize, m_ProjectionNumber);
+
+      m_ForwardProjectionMatrixIsValid = true;
+    }
+
+
   /* -----------------------------------------------------------------------
      Initialise()
      ----------------------------------------------------------------------- */
@@ -174,31 +203,10 @@ namespace itk
 
       }
 
-			// Allocate the matrix projector
-			MatrixProjectorPointerType	m_MatrixProjector;
-      if ( m_MatrixProjector.IsNull() )
-        m_MatrixProjector = MatrixProjectorType::New();
-
 			InputVolumeSizeType inVolumeSize 		= m_InVolumeSize;
-			InputProjectionSizeType inProjSize 	= m_InProjectionSize;
-
-			// Create the corresponding forward/backward projection matrix
-      const unsigned long int totalSizeAllProjs = m_ProjectionNumber*m_totalSize2D;
-      static SparseMatrixType forwardProjectionMatrix(totalSizeAllProjs, m_totalSize3D);
-      static SparseMatrixType backwardProjectionMatrix(m_totalSize3D, totalSizeAllProjs);
-
-			// Set the projection geometry
-			m_MatrixProjector->SetProjectionGeometry( m_Geometry );
-
-      m_MatrixProjector->GetForwardProjectionSparseMatrix(forwardProjectionMatrix, m_inVolume, m_inProjTemp, 
-           inVolumeSize, inProjSize, m_ProjectionNumber);
-
-
-      // Allocate the affine transformer
-			AffineTransformerType::Pointer m_AffineTransformer;
-			if ( m_AffineTransformer.IsNull() )
-				m_AffineTransformer = AffineTransformerType::New();
 
+			// Create the corresponding forward projection matrix
+			this->UpdateForwardProjectionMatrix();
 
 /*
 			// Modify the transformation parameters
@@ -251,43 +259,31 @@ namespace itk
 */
 
 			// Create the corresponding transformation matrix
- 	 		static SparseMatrixType affineMatrix(m_totalSize3D, m_totalSize3D);
-  		static SparseMatrixType affineMatrixTranspose(m_totalSize3D, m_totalSize3D);
+			CompressedSparseRowMatrixType affineMatrix;
 
   		m_AffineTransformer->GetAffineTransformationSparseMatrix(affineMatrix, inVolumeSize, tempEulerAffineParameters);
 
 
-/*
-		  // Print out the all the entries of the sparse affine matrix
-			affineMatrix.reset();
-  		std::ofstream sparseAffineFullMatrixFile("sparseAffineFullMatrix.txt");
-
- 			for ( unsigned long int totalEntryIterRow = 0; totalEntryIterRow < affineMatrix.rows(); totalEntryIterRow++ )
-				for ( unsigned long int totalEntryIterCol = 0; totalEntryIterCol < affineMatrix.cols(); totalEntryIterCol++ )
-  				sparseAffineFullMatrixFile << affineMatrix(totalEntryIterRow, totalEntryIterCol) << " ";
-*/
-
-
   		// Calculate the matrix/vector multiplication in order to get the forward projection (Ax)
   		// assert (!m_EstimatedVolumeVector.is_zero());
   		VectorType forwardProjectedVectorOne(m_totalSize3D);
   		forwardProjectedVectorOne.fill(0.);
 
-  		m_MatrixProjector->CalculteMatrixVectorMultiplication(forwardProjectionMatrix, m_EstimatedVolumeVector, forwardProjectedVectorOne);
+  		m_MatrixProjector->CalculteMatrixVectorMultiplication(m_ForwardProjectionMatrix, m_EstimatedVolumeVector, forwardProjectedVectorOne);
 
 
   		// Calculate the matrix/vector multiplication in order to get the affine transformation (Rx)
   		VectorType affineTransformedVector(m_totalSize3D);
   		affineTransformedVector.fill(0.);
 
-		  m_AffineTransformer->CalculteMatrixVectorMultiplication(affineMatrix, m_EstimatedVolumeVector, affineTransformedVector);
+		  affineMatrix.Multiply(m_EstimatedVolumeVector, affineTransformedVector);
 
   		// Calculate the matrix/vector multiplication in order to get the forward projection (ARx)
   		// assert (!affineTransformedVector.is_zero());
   	  VectorType forwardProjectedVectorTwo(m_totalSize3D);
   		forwardProjectedVectorTwo.fill(0.);
 			
-			m_MatrixProjector->CalculteMatrixVectorMultiplication(forwardProjectionMatrix, affineTransformedVector, forwardProjectedVectorTwo);
+			m_MatrixProjector->CalculteMatrixVectorMultiplication(m_ForwardProjectionMatrix, affineTransformedVector, forwardProjectedVectorTwo);
 
 			
 			// Initialise the current measure
@@ -381,32 +377,10 @@ namespace itk
 
       }
 
-			// Allocate the matrix projector
-			MatrixProjectorPointerType	m_MatrixProjector;
-      if ( m_MatrixProjector.IsNull() )
-        m_MatrixProjector = MatrixProjectorType::New();
-
 			InputVolumeSizeType inVolumeSize 		= m_InVolumeSize;
-			InputProjectionSizeType inProjSize 	= m_InProjectionSize;
-
-			// Create the corresponding forward/backward projection matrix
-      const unsigned long int totalSizeAllProjs = m_ProjectionNumber*m_totalSize2D;
-      static SparseMatrixType forwardProjectionMatrix(totalSizeAllProjs, m_totalSize3D);
-      static SparseMatrixType backwardProjectionMatrix(m_totalSize3D, totalSizeAllProjs);
 
-			// Set the projection geometry
-			m_MatrixProjector->SetProjectionGeometry( m_Geometry );
-
-      m_MatrixProjector->GetForwardProjectionSparseMatrix(forwardProjectionMatrix, m_inVolume, m_inProjTemp, 
-           inVolumeSize, inProjSize, m_ProjectionNumber);
-      m_MatrixProjector->GetBackwardProjectionSparseMatrix(forwardProjectionMatrix, backwardProjectionMatrix, 
-         inVolumeSize, inProjSize, m_ProjectionNumber);
-
-
-      // Allocate the affine transformer
-			AffineTransformerType::Pointer m_AffineTransformer;
-			if ( m_AffineTransformer.IsNull() )
-				m_AffineTransformer = AffineTransformerType::New();
+			// Create the corresponding forward projection matrix, whose transpose is the backward projection
+			this->UpdateForwardProjectionMatrix();
 
 /*
 			// Modify the transformation parameters
@@ -460,30 +434,10 @@ namespace itk
 			std::ofstream TransformationParameterVectorFile("TransformationParameterVectorFile.txt", std::ios::out | std::ios::app | std::ios::binary);
     	TransformationParameterVectorFile << m_TransformationParameterVector << " " << std::endl;
 
-			// Create the corresponding transformation matrix
- 	 		static SparseMatrixType affineMatrix(m_totalSize3D, m_totalSize3D);
-  		static SparseMatrixType affineMatrixTranspose(m_totalSize3D, m_totalSize3D);
+			// Create the corresponding transformation matrix, whose transpose is applied with TransposeMultiply()
+			CompressedSparseRowMatrixType affineMatrix;
 
   		m_AffineTransformer->GetAffineTransformationSparseMatrix(affineMatrix, inVolumeSize, tempEulerAffineParameters);
-  		m_AffineTransformer->GetAffineTransformationSparseMatrixT(affineMatrix, affineMatrixTranspose, inVolumeSize);
-
-		  // Print out the all the entries of the sparse affine matrix
-			affineMatrix.reset();
-  		std::ofstream sparseAffineFullMatrixInGetDerivativeFile("sparseAffineFullMatrixInGetDerivative.txt");
-
-
-/*
- 			for ( unsigned long int totalEntryIterRow = 0; totalEntryIterRow < affineMatrix.rows(); totalEntryIterRow++ )
-				for ( unsigned long int totalEntryIterCol = 0; totalEntryIterCol < affineMatrix.cols(); totalEntryIterCol++ )
-  				sparseAffineFullMatrixInGetDerivativeFile << affineMatrix(totalEntryIterRow, totalEntryIterCol) << " ";
-
-			affineMatrixTranspose.reset();
-  		std::ofstream sparseAffineFullMatrixInGetDerivativeTransposeFile("sparseAffineFullMatrixInGetDerivativeTranspose.txt");
-
- 			for ( unsigned long int totalEntryIterRow = 0; totalEntryIterRow < affineMatrixTranspose.rows(); totalEntryIterRow++ )
-				for ( unsigned long int totalEntryIterCol = 0; totalEntryIterCol < affineMatrixTranspose.cols(); totalEntryIterCol++ )
-  				sparseAffineFullMatrixInGetDerivativeTransposeFile << affineMatrixTranspose(totalEntryIterRow, totalEntryIterCol) << " ";
-*/
 
 
   		// Calculate the matrix/vector multiplication in order to get the forward projection (Ax)
@@ -491,21 +445,21 @@ namespace itk
   		VectorType forwardProjectedVectorOne(m_totalSize3D);
   		forwardProjectedVectorOne.fill(0.);
 
-  		m_MatrixProjector->CalculteMatrixVectorMultiplication(forwardProjectionMatrix, m_EstimatedVolumeVector, forwardProjectedVectorOne);
+  		m_MatrixProjector->CalculteMatrixVectorMultiplication(m_ForwardProjectionMatrix, m_EstimatedVolumeVector, forwardProjectedVectorOne);
 
 
   		// Calculate the matrix/vector multiplication in order to get the affine transformation (Rx)
   		VectorType affineTransformedVector(m_totalSize3D);
   		affineTransformedVector.fill(0.);
 
-		  m_AffineTransformer->CalculteMatrixVectorMultiplication(affineMatrix, m_EstimatedVolumeVector, affineTransformedVector);
+		  affineMatrix.Multiply(m_EstimatedVolumeVector, affineTransformedVector);
 
   		// Calculate the matrix/vector multiplication in order to get the forward projection (ARx)
   		// assert (!affineTransformedVector.is_zero());
   		VectorType forwardProjectedVectorTwo(m_totalSize3D);
   		forwardProjectedVectorTwo.fill(0.);
 			
-			m_MatrixProjector->CalculteMatrixVectorMultiplication(forwardProjectionMatrix, affineTransformedVector, forwardProjectedVectorTwo);
+			m_MatrixProjector->CalculteMatrixVectorMultiplication(m_ForwardProjectionMatrix, affineTransformedVector, forwardProjectedVectorTwo);
 
 
 			// Calculate (Ax - y_1) and (ARx - y_2)
@@ -525,15 +479,15 @@ namespace itk
 			inBackProjOne.fill(0.);
 			inBackProjTwo.fill(0.);
 
-			m_MatrixProjector->CalculteMatrixVectorMultiplication(backwardProjectionMatrix, m_inProjOneSub, inBackProjOne);
-			m_MatrixProjector->CalculteMatrixVectorMultiplication(backwardProjectionMatrix, m_inProjTwoSub, inBackProjTwo);
+			m_MatrixProjector->CalculteTransposeMatrixVectorMultiplication(m_ForwardProjectionMatrix, m_inProjOneSub, inBackProjOne);
+			m_MatrixProjector->CalculteTransposeMatrixVectorMultiplication(m_ForwardProjectionMatrix, m_inProjTwoSub, inBackProjTwo);
 
 			// Obtain the transpose of affine transformation matrix with the backprojection set two (R^T A^T (ARx - y_2))
 			// assert (!inBackProjOne.is_zero() && !inBackProjTwo.is_zero());
 			VectorType	inAffineTransposeBackProjTwo(m_totalSize3D);
 			inAffineTransposeBackProjTwo.fill(0.);
 			
-			m_AffineTransformer->CalculteMatrixVectorMultiplication(affineMatrixTranspose, inBackProjTwo, inAffineTransposeBackProjTwo);
+			affineMatrix.TransposeMultiply(inBackProjTwo, inAffineTransposeBackProjTwo);
 
 
 			// Update the derivative with respect to voxel values x by using (A^T (Ax - y_1) + R^T A^T (ARx - y_2))
@@ -636,32 +590,10 @@ namespace itk
 
       }
 
-			// Allocate the matrix projector
-			MatrixProjectorPointerType	m_MatrixProjector;
-      if ( m_MatrixProjector.IsNull() )
-        m_MatrixProjector = MatrixProjectorType::New();
-
 			InputVolumeSizeType inVolumeSize 		= m_InVolumeSize;
-			InputProjectionSizeType inProjSize 	= m_InProjectionSize;
 
-			// Create the corresponding forward/backward projection matrix
-      const unsigned long int totalSizeAllProjs = m_ProjectionNumber*m_totalSize2D;
-      static SparseMatrixType forwardProjectionMatrix(totalSizeAllProjs, m_totalSize3D);
-      static SparseMatrixType backwardProjectionMatrix(m_totalSize3D, totalSizeAllProjs);
-
-			// Set the projection geometry
-			m_MatrixProjector->SetProjectionGeometry( m_Geometry );
-
-      m_MatrixProjector->GetForwardProjectionSparseMatrix(forwardProjectionMatrix, m_inVolume, m_inProjTemp, 
-           inVolumeSize, inProjSize, m_ProjectionNumber);
-      m_MatrixProjector->GetBackwardProjectionSparseMatrix(forwardProjectionMatrix, backwardProjectionMatrix, 
-         inVolumeSize, inProjSize, m_ProjectionNumber);
-
-
-      // Allocate the affine transformer
-			AffineTransformerType::Pointer m_AffineTransformer;
-			if ( m_AffineTransformer.IsNull() )
-				m_AffineTransformer = AffineTransformerType::New();
+			// Create the corresponding forward projection matrix, whose transpose is the backward projection
+			this->UpdateForwardProjectionMatrix();
 
 			// Modify the transformation parameters
 			EulerAffineTransformType::ParametersType pEulerAffineParameters(m_paraNumber);
@@ -676,12 +608,10 @@ namespace itk
 			std::ofstream TransformationParameterVectorFile("TransformationParameterVectorFile.txt", std::ios::out | std::ios::app | std::ios::binary);
     	TransformationParameterVectorFile << m_TransformationParameterVector << " " << std::endl;
 
-			// Create the corresponding transformation matrix
- 	 		static SparseMatrixType affineMatrix(m_totalSize3D, m_totalSize3D);
-  		static SparseMatrixType affineMatrixTranspose(m_totalSize3D, m_totalSize3D);
+			// Create the corresponding transformation matrix, whose transpose is applied with TransposeMultiply()
+			CompressedSparseRowMatrixType affineMatrix;
 
   		m_AffineTransformer->GetAffineTransformationSparseMatrix(affineMatrix, inVolumeSize, pEulerAffineParameters);
-  		m_AffineTransformer->GetAffineTransformationSparseMatrixT(affineMatrix, affineMatrixTranspose, inVolumeSize);
 
 
   		// Calculate the matrix/vector multiplication in order to get the forward projection (Ax)
@@ -689,21 +619,21 @@ namespace itk
   		VectorType forwardProjectedVectorOne(m_totalSize3D);
   		forwardProjectedVectorOne.fill(0.);
 
-  		m_MatrixProjector->CalculteMatrixVectorMultiplication(forwardProjectionMatrix, m_EstimatedVolumeVector, forwardProjectedVectorOne);
+  		m_MatrixProjector->CalculteMatrixVectorMultiplication(m_ForwardProjectionMatrix, m_EstimatedVolumeVector, forwardProjectedVectorOne);
 
 
   		// Calculate the matrix/vector multiplication in order to get the affine transformation (Rx)
   		VectorType affineTransformedVector(m_totalSize3D);
   		affineTransformedVector.fill(0.);
 
-		  m_AffineTransformer->CalculteMatrixVectorMultiplication(affineMatrix, m_EstimatedVolumeVector, affineTransformedVector);
+		  affineMatrix.Multiply(m_EstimatedVolumeVector, affineTransformedVector);
 
   		// Calculate the matrix/vector multiplication in order to get the forward projection (ARx)
   		// assert (!affineTransformedVector.is_zero());
   		VectorType forwardProjectedVectorTwo(m_totalSize3D);
   		forwardProjectedVectorTwo.fill(0.);
 			
-			m_MatrixProjector->CalculteMatrixVectorMultiplication(forwardProjectionMatrix, affineTransformedVector, forwardProjectedVectorTwo);
+			m_MatrixProjector->CalculteMatrixVectorMultiplication(m_ForwardProjectionMatrix, affineTransformedVector, forwardProjectedVectorTwo);
 
 
 			// Calculate (Ax - y_1) and (ARx - y_2)
@@ -723,15 +653,15 @@ namespace itk
 			inBackProjOne.fill(0.);
 			inBackProjTwo.fill(0.);
 
-			m_MatrixProjector->CalculteMatrixVectorMultiplication(backwardProjectionMatrix, m_inProjOneSub, inBackProjOne);
-			m_MatrixProjector->CalculteMatrixVectorMultiplication(backwardProjectionMatrix, m_inProjTwoSub, inBackProjTwo);
+			m_MatrixProjector->CalculteTransposeMatrixVectorMultiplication(m_ForwardProjectionMatrix, m_inProjOneSub, inBackProjOne);
+			m_MatrixProjector->CalculteTransposeMatrixVectorMultiplication(m_ForwardProjectionMatrix, m_inProjTwoSub, inBackProjTwo);
 
 			// Obtain the transpose of affine transformation matrix with the backprojection set two (R^T A^T (ARx - y_2))
 			// assert (!inBackProjOne.is_zero() && !inBackProjTwo.is_zero());
 			VectorType	inAffineTransposeBackProjTwo(m_totalSize3D);
 			inAffineTransposeBackProjTwo.fill(0.);
 			
-			m_AffineTransformer->CalculteMatrixVectorMultiplication(affineMatrixTranspose, inBackProjTwo, inAffineTransposeBackProjTwo);
+			affineMatrix.TransposeMultiply(inBackProjTwo, inAffineTransposeBackProjTwo);
 
 
 			// Update the derivative with respect to voxel values x by using (A^T (Ax - y_1) + R^T A^T (ARx - y_2))
@@ -0,0 +1,165 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#ifndef itkCompressedSparseRowMatrix_h
+#define itkCompressedSparseRowMatrix_h
+
+#include <itkMultiThreader.h>
+
+#include <vnl/vnl_vector.h>
+#include <vnl/vnl_sparse_matrix.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace itk
+{
+
+  /** \class CompressedSparseRowMatrix
+   * \brief Sparse matrix in compressed sparse row (CSR) form, with multi-threaded
+   * matrix/vector and transposed matrix/vector products.
+   *
+   * vnl_sparse_matrix stores each row as its own vector of (column, value) pairs,
+   * which for a projection matrix with one row per detector pixel, per projection,
+   * costs a heap allocation and a vector header per row. Here the column indices
+   * and values of all rows are held in two contiguous arrays, indexed by an array
+   * of row pointers of size rows+1.
+   *
+   * The transposed product A^T x is computed directly from the rows of A, so
+   * the transpose of a forward projection matrix never needs to be stored.
+   *
+   * The matrix can be built from several RowBlock objects, each holding
+   * a contiguous range of rows, so that the rows can be calculated in parallel.
+   */
+  template <class TScalarType = double>
+    class ITK_EXPORT CompressedSparseRowMatrix
+  {
+    public:
+      /** Standard class typedefs. */
+      typedef CompressedSparseRowMatrix                     Self;
+
+      /** Some convenient typedefs. */
+      typedef TScalarType                                   ValueType;
+      typedef unsigned int                                  ColumnIndexType;
+      typedef unsigned long int                             RowPointerType;
+      typedef vnl_vector<TScalarType>                       VectorType;
+      typedef vnl_sparse_matrix<TScalarType>                SparseMatrixType;
+
+      /** \class RowBlock
+       * \brief The non-zeros of a contiguous range of rows, which can be filled
+       * in independently of any other block, eg. on its own thread.
+       */
+      class RowBlock
+      {
+        public:
+          RowBlock() { this->SetFirstRow(0); }
+
+          /// Clear the block, and set the index of the first row it will hold.
+          void SetFirstRow(unsigned long int row);
+          /// Get the index of the first row in the block.
+          unsigned long int GetFirstRow() const { return m_FirstRow; }
+          /// Get the number of finished rows in the block.
+          unsigned long int GetNumberOfRows() const { return m_RowPointers.size() - 1; }
+
+          /// Set an element of the current row. As for vnl_sparse_matrix, setting the same column twice keeps the last value.
+          void AddEntry(ColumnIndexType column, TScalarType value) { m_Row.push_back(std::make_pair(column, value)); }
+          /// Finish the current row, and start the next.
+          void FinishRow();
+
+        private:
+          friend class CompressedSparseRowMatrix;
+
+          static bool IsLessThanColumn(const std::pair<ColumnIndexType, TScalarType> &a,
+                                       const std::pair<ColumnIndexType, TScalarType> &b) { return a.first < b.first; }
+
+          unsigned long int                                       m_FirstRow;
+          std::vector<RowPointerType>                             m_RowPointers;
+          std::vector<ColumnIndexType>                            m_Columns;
+          std::vector<TScalarType>                                m_Values;
+          std::vector< std::pair<ColumnIndexType, TScalarType> >  m_Row;
+      };
+
+      CompressedSparseRowMatrix();
+      CompressedSparseRowMatrix(unsigned long int rows, unsigned long int columns);
+
+      /// Set the size of the matrix, which leaves every element zero.
+      void SetSize(unsigned long int rows, unsigned long int columns);
+
+      unsigned long int GetNumberOfRows() const { return m_NumberOfRows; }
+      unsigned long int GetNumberOfColumns() const { return m_NumberOfColumns; }
+      RowPointerType GetNumberOfNonZeros() const { return m_RowPointers.back(); }
+
+      /// Set/Get the number of threads used for the products, defaulting to the ITK global default.
+      void SetNumberOfThreads(ThreadIdType numberOfThreads);
+      ThreadIdType GetNumberOfThreads() const { return m_NumberOfThreads; }
+
+      /**
+       * Set the rows of the matrix from blocks, which must be in row order and
+       * together cover every row. The blocks are emptied as they are copied, to
+       * limit the peak memory used.
+       */
+      void SetRowBlocks(std::vector<RowBlock> &blocks);
+
+      /// Set the matrix from a vnl_sparse_matrix, eg. from an existing matrix builder.
+      void SetSparseMatrix(SparseMatrixType &matrix);
+
+      /// Get an element, which is zero if it is not stored.
+      TScalarType GetValue(unsigned long int row, unsigned long int column) const;
+
+      /// Calculate y = A x.
+      void Multiply(const VectorType &x, VectorType &y) const;
+
+      /// Calculate y = A^T x, without forming A^T.
+      void TransposeMultiply(const VectorType &x, VectorType &y) const;
+
+    protected:
+
+      /// Thread data for Multiply() and TransposeMultiply().
+      struct ProductThreadStruct
+      {
+        const Self                            *Matrix;
+        const VectorType                      *Input;
+        VectorType                            *Output;
+        std::vector<unsigned long int>         RowBoundaries;
+        std::vector<VectorType>               *PartialOutputs;
+        std::vector<std::string>               ErrorMessages;
+      };
+
+      static ITK_THREAD_RETURN_TYPE MultiplyThreaderCallback(void *arg);
+      static ITK_THREAD_RETURN_TYPE TransposeMultiplyThreaderCallback(void *arg);
+      static ITK_THREAD_RETURN_TYPE SumPartialOutputsThreaderCallback(void *arg);
+
+      /// Split the rows into contiguous ranges with a similar number of non-zeros.
+      void SplitRows(ThreadIdType numberOfPieces, std::vector<unsigned long int> &rowBoundaries) const;
+
+      /// Run one of the callbacks, throwing if any of the threads failed.
+      void RunThreads(ITK_THREAD_RETURN_TYPE (*callback)(void *), ProductThreadStruct &str) const;
+
+      unsigned long int                       m_NumberOfRows;
+      unsigned long int                       m_NumberOfColumns;
+      ThreadIdType                            m_NumberOfThreads;
+
+      std::vector<RowPointerType>             m_RowPointers;
+      std::vector<ColumnIndexType>            m_Columns;
+      std::vector<TScalarType>                m_Values;
+  };
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkCompressedSparseRowMatrix.txx"
+#endif
+
+#endif
@@ -0,0 +1,485 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#ifndef __itkCompressedSparseRowMatrix_txx
+#define __itkCompressedSparseRowMatrix_txx
+
+#include "itkCompressedSparseRowMatrix.h"
+
+#include <itkMacro.h>
+
+#include <algorithm>
+
+namespace itk
+{
+
+  /* -----------------------------------------------------------------------
+     RowBlock::SetFirstRow()
+     ----------------------------------------------------------------------- */
+
+  template <class TScalarType>
+    void
+    CompressedSparseRowMatrix<TScalarType>::RowBlock
+    ::SetFirstRow(unsigned long int row)
+    {
+      m_FirstRow = row;
+      m_RowPointers.assign(1, 0);
+      m_Columns.clear();
+      m_Values.clear();
+      m_Row.clear();
+    }
+
+
+  /* -----------------------------------------------------------------------
+     RowBlock::FinishRow()
+     ----------------------------------------------------------------------- */
+
+  template <class TScalarType>
+    void
+    CompressedSparseRowMatrix<TScalarType>::RowBlock
+    ::FinishRow()
+    {
+      // Stable, so of several entries for the same column, the last one added is last.
+      std::stable_sort(m_Row.begin(), m_Row.end(), IsLessThanColumn);
+
+      for (unsigned long int i = 0; i < m_Row.size(); i++)
+      {
+        if (i + 1 < m_Row.size() && m_Row[i + 1].first == m_Row[i].first)
+        {
+          continue;
+        }
+        m_Columns.push_back(m_Row[i].first);
+        m_Values.push_back(m_Row[i].second);
+      }
+
+      m_RowPointers.push_back(m_Columns.size());
+      m_Row.clear();
+    }
+
+
+  /* -----------------------------------------------------------------------
+     Constructors
+     ----------------------------------------------------------------------- */
+
+  template <class TScalarType>
+    CompressedSparseRowMatrix<TScalarType>
+    ::CompressedSparseRowMatrix()
+    {
+      m_NumberOfThreads = MultiThreader::GetGlobalDefaultNumberOfThreads();
+      this->SetSize(0, 0);
+    }
+
+  template <class TScalarType>
+    CompressedSparseRowMatrix<TScalarType>
+    ::CompressedSparseRowMatrix(unsigned long int rows, unsigned long int columns)
+    {
+      m_NumberOfThreads = MultiThreader::GetGlobalDefaultNumberOfThreads();
+      this->SetSize(rows, columns);
+    }
+
+
+  /* -----------------------------------------------------------------------
+     SetSize()
+     ----------------------------------------------------------------------- */
+
+  template <class TScalarType>
+    void
+    CompressedSparseRowMatrix<TScalarType>
+    ::SetSize(unsigned long int rows, unsigned long int columns)
+    {
+      m_NumberOfRows = rows;
+      m_NumberOfColumns = columns;
+
+      m_RowPointers.assign(rows + 1, 0);
+      std::vector<ColumnIndexType>().swap(m_Columns);
+      std::vector<TScalarType>().swap(m_Values);
+    }
+
+
+  /* -----------------------------------------------------------------------
+     SetNumberOfThreads()
+     ----------------------------------------------------------------------- */
+
+  template <class TScalarType>
+    void
+    CompressedSparseRowMatrix<TScalarType>
+    ::SetNumberOfThreads(ThreadIdType numberOfThreads)
+    {
+      m_NumberOfThreads = std::max(std::min(numberOfThreads, (ThreadIdType)ITK_MAX_THREADS), (ThreadIdType)1);
+    }
+
+
+  /* -----------------------------------------------------------------------
+     SetRowBlocks()
+     ----------------------------------------------------------------------- */
+
+  template <class TScalarType>
+    void
+    CompressedSparseRowMatrix<TScalarType>
+    ::SetRowBlocks(std::vector<RowBlock> &blocks)
+    {
+      unsigned long int numberOfRows = 0;
+      RowPointerType numberOfNonZeros = 0;
+
+      for (unsigned int i = 0; i < blocks.size(); i++)
+      {
+        if (blocks[i].m_FirstRow != numberOfRows)
+        {
+          itkGenericExceptionMacro(<< "Row block " << i << " starts at row " << blocks[i].m_FirstRow
+                                   << ", but the previous block finished at row " << numberOfRows);
+        }
+        if (blocks[i].m_Row.size() > 0)
+        {
+          itkGenericExceptionMacro(<< "Row block " << i << " has an unfinished row");
+        }
+        numberOfRows += blocks[i].GetNumberOfRows();
+        numberOfNonZeros += blocks[i].m_Columns.size();
+      }
+
+      if (numberOfRows != m_NumberOfRows)
+      {
+        itkGenericExceptionMacro(<< "The row blocks hold " << numberOfRows << " rows, but the matrix has " << m_NumberOfRows);
+      }
+
+      m_RowPointers.resize(m_NumberOfRows + 1);
+      m_Columns.clear();
+      m_Values.clear();
+      m_Columns.reserve(numberOfNonZeros);
+      m_Values.reserve(numberOfNonZeros);
+
+      for (unsigned int i = 0; i < blocks.size(); i++)
+      {
+        RowBlock &block = blocks[i];
+
+        for (unsigned long int j = 0; j < block.m_Columns.size(); j++)
+        {
+          if (block.m_Columns[j] >= m_NumberOfColumns)
+          {
+            itkGenericExceptionMacro(<< "Column " << block.m_Columns[j] << " is outside a matrix with " << m_NumberOfColumns << " columns");
+          }
+        }
+
+        RowPointerType offset = m_Columns.size();
+        for (unsigned long int j = 0; j < block.GetNumberOfRows(); j++)
+        {
+          m_RowPointers[block.m_FirstRow + j] = offset + block.m_RowPointers[j];
+        }
+
+        m_Columns.insert(m_Columns.end(), block.m_Columns.begin(), block.m_Columns.end());
+        m_Values.insert(m_Values.end(), block.m_Values.begin(), block.m_Values.end());
+
+        std::vector<RowPointerType>(1, 0).swap(block.m_RowPointers);
+        std::vector<ColumnIndexType>().swap(block.m_Columns);
+        std::vector<TScalarType>().swap(block.m_Values);
+      }
+
+      m_RowPointers[m_NumberOfRows] = m_Columns.size();
+    }
+
+
+  /* -----------------------------------------------------------------------
+     SetSparseMatrix()
+     ----------------------------------------------------------------------- */
+
+  template <class TScalarType>
+    void
+    CompressedSparseRowMatrix<TScalarType>
+    ::SetSparseMatrix(SparseMatrixType &matrix)
+    {
+      this->SetSize(matrix.rows(), matrix.cols());
+
+      RowPointerType numberOfNonZeros = 0;
+      for (unsigned long int r = 0; r < m_NumberOfRows; r++)
+      {
+        numberOfNonZeros += matrix.get_row(r).size();
+      }
+
+      m_Columns.reserve(numberOfNonZeros);
+      m_Values.reserve(numberOfNonZeros);
+
+      // vnl_sparse_matrix keeps each row sorted by column.
+      for (unsigned long int r = 0; r < m_NumberOfRows; r++)
+      {
+        typename SparseMatrixType::row const &row = matrix.get_row(r);
+        for (unsigned long int i = 0; i < row.size(); i++)
+        {
+          m_Columns.push_back(row[i].first);
+          m_Values.push_back(row[i].second);
+        }
+        m_RowPointers[r + 1] = m_Columns.size();
+      }
+    }
+
+
+  /* -----------------------------------------------------------------------
+     GetValue()
+     ----------------------------------------------------------------------- */
+
+  template <class TScalarType>
+    TScalarType
+    CompressedSparseRowMatrix<TScalarType>
+    ::GetValue(unsigned long int row, unsigned long int column) const
+    {
+      if (row >= m_NumberOfRows || column >= m_NumberOfColumns)
+      {
+        itkGenericExceptionMacro(<< "Element (" << row << ", " << column << ") is outside a "
+                                 << m_NumberOfRows << "x" << m_NumberOfColumns << " matrix");
+      }
+
+      typename std::vector<ColumnIndexType>::const_iterator first = m_Columns.begin() + m_RowPointers[row];
+      typename std::vector<ColumnIndexType>::const_iterator last  = m_Columns.begin() + m_RowPointers[row + 1];
+      typename std::vector<ColumnIndexType>::const_iterator found = std::lower_bound(first, last, (ColumnIndexType)column);
+
+      if (found != last && *found == column)
+      {
+        return m_Values[found - m_Columns.begin()];
+      }
+      return 0;
+    }
+
+
+  /* -----------------------------------------------------------------------
+     SplitRows()
+     ----------------------------------------------------------------------- */
+
+  template <class TScalarType>
+    void
+    CompressedSparseRowMatrix<TScalarType>
+    ::SplitRows(ThreadIdType numberOfPieces, std::vector<unsigned long int> &rowBoundaries) const
+    {
+      // Rows of a projection matrix vary a lot in length, so balance the number of non-zeros, not rows.
+      rowBoundaries.resize(numberOfPieces + 1);
+      rowBoundaries[0] = 0;
+      rowBoundaries[numberOfPieces] = m_NumberOfRows;
+
+      for (ThreadIdType i = 1; i < numberOfPieces; i++)
+      {
+        RowPointerType target = (RowPointerType)((double)this->GetNumberOfNonZeros() * i / numberOfPieces);
+        rowBoundaries[i] = std::lower_bound(m_RowPointers.begin(), m_RowPointers.end() - 1, target) - m_RowPointers.begin();
+        rowBoundaries[i] = std::max(rowBoundaries[i], rowBoundaries[i - 1]);
+      }
+    }
+
+
+  /* -----------------------------------------------------------------------
+     RunThreads()
+     ----------------------------------------------------------------------- */
+
+  template <class TScalarType>
+    void
+    CompressedSparseRowMatrix<TScalarType>
+    ::RunThreads(ITK_THREAD_RETURN_TYPE (*callback)(void *), ProductThreadStruct &str) const
+    {
+      ThreadIdType numberOfThreads = str.RowBoundaries.size() - 1;
+      str.ErrorMessages.assign(numberOfThreads, std::string());
+
+      MultiThreader::Pointer threader = MultiThreader::New();
+      threader->SetNumberOfThreads(numberOfThreads);
+      threader->SetSingleMethod(callback, &str);
+      threader->SingleMethodExecute();
+
+      for (unsigned int i = 0; i < str.ErrorMessages.size(); i++)
+      {
+        if (str.ErrorMessages[i].size() > 0)
+        {
+          itkGenericExceptionMacro(<< "Failed to multiply the sparse matrix:" << str.ErrorMessages[i]);
+        }
+      }
+    }
+
+
+  /* -----------------------------------------------------------------------
+     Multiply()
+     ----------------------------------------------------------------------- */
+
+  template <class TScalarType>
+    ITK_THREAD_RETURN_TYPE
+    CompressedSparseRowMatrix<TScalarType>
+    ::MultiplyThreaderCallback(void *arg)
+    {
+      ThreadIdType threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+      ProductThreadStruct *str = (ProductThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+      try
+      {
+        const Self &matrix = *(str->Matrix);
+        const VectorType &x = *(str->Input);
+        VectorType &y = *(str->Output);
+
+        for (unsigned long int r = str->RowBoundaries[threadId]; r < str->RowBoundaries[threadId + 1]; r++)
+        {
+          TScalarType sum = 0;
+          for (RowPointerType i = matrix.m_RowPointers[r]; i < matrix.m_RowPointers[r + 1]; i++)
+          {
+            sum += matrix.m_Values[i] * x[matrix.m_Columns[i]];
+          }
+          y[r] = sum;
+        }
+      }
+      catch (std::exception& err)
+      {
+        str->ErrorMessages[threadId] = err.what();
+      }
+
+      return ITK_THREAD_RETURN_VALUE;
+    }
+
+  template <class TScalarType>
+    void
+    CompressedSparseRowMatrix<TScalarType>
+    ::Multiply(const VectorType &x, VectorType &y) const
+    {
+      if (x.size() != m_NumberOfColumns)
+      {
+        itkGenericExceptionMacro(<< "Can't multiply a " << m_NumberOfRows << "x" << m_NumberOfColumns
+                                 << " matrix by a vector of size " << x.size());
+      }
+
+      y.set_size(m_NumberOfRows);
+      if (m_NumberOfRows == 0)
+      {
+        return;
+      }
+
+      // Each row of y only depends on one row of A, so the result is the same on any number of threads.
+      ProductThreadStruct str;
+      str.Matrix = this;
+      str.Input = &x;
+      str.Output = &y;
+      str.PartialOutputs = 0;
+      this->SplitRows(std::min((unsigned long int)m_NumberOfThreads, m_NumberOfRows), str.RowBoundaries);
+
+      this->RunThreads(MultiplyThreaderCallback, str);
+    }
+
+
+  /* -----------------------------------------------------------------------
+     TransposeMultiply()
+     ----------------------------------------------------------------------- */
+
+  template <class TScalarType>
+    ITK_THREAD_RETURN_TYPE
+    CompressedSparseRowMatrix<TScalarType>
+    ::TransposeMultiplyThreaderCallback(void *arg)
+    {
+      ThreadIdType threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+      ProductThreadStruct *str = (ProductThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+      try
+      {
+        const Self &matrix = *(str->Matrix);
+        const VectorType &x = *(str->Input);
+
+        // Thread 0 scatters straight into the output, the others into their own partial output.
+        VectorType &y = (threadId == 0) ? *(str->Output) : (*(str->PartialOutputs))[threadId - 1];
+        y.set_size(matrix.m_NumberOfColumns);
+        y.fill(0);
+
+        for (unsigned long int r = str->RowBoundaries[threadId]; r < str->RowBoundaries[threadId + 1]; r++)
+        {
+          TScalarType xr = x[r];
+          if (xr == 0)
+          {
+            continue;
+          }
+          for (RowPointerType i = matrix.m_RowPointers[r]; i < matrix.m_RowPointers[r + 1]; i++)
+          {
+            y[matrix.m_Columns[i]] += matrix.m_Values[i] * xr;
+          }
+        }
+      }
+      catch (std::exception& err)
+      {
+        str->ErrorMessages[threadId] = err.what();
+      }
+
+      return ITK_THREAD_RETURN_VALUE;
+    }
+
+  template <class TScalarType>
+    ITK_THREAD_RETURN_TYPE
+    CompressedSparseRowMatrix<TScalarType>
+    ::SumPartialOutputsThreaderCallback(void *arg)
+    {
+      ThreadIdType threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+      ThreadIdType threadCount = ((MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+      ProductThreadStruct *str = (ProductThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+      try
+      {
+        VectorType &y = *(str->Output);
+        std::vector<VectorType> &partials = *(str->PartialOutputs);
+
+        unsigned long int firstColumn = (y.size() * threadId) / threadCount;
+        unsigned long int lastColumn  = (y.size() * (threadId + 1)) / threadCount;
+
+        // Summed in thread order, so the result does not depend on how the threads were scheduled.
+        for (unsigned int i = 0; i < partials.size(); i++)
+        {
+          for (unsigned long int c = firstColumn; c < lastColumn; c++)
+          {
+            y[c] += partials[i][c];
+          }
+        }
+      }
+      catch (std::exception& err)
+      {
+        str->ErrorMessages[threadId] = err.what();
+      }
+
+      return ITK_THREAD_RETURN_VALUE;
+    }
+
+  template <class TScalarType>
+    void
+    CompressedSparseRowMatrix<TScalarType>
+    ::TransposeMultiply(const VectorType &x, VectorType &y) const
+    {
+      if (x.size() != m_NumberOfRows)
+      {
+        itkGenericExceptionMacro(<< "Can't multiply the transpose of a " << m_NumberOfRows << "x" << m_NumberOfColumns
+                                 << " matrix by a vector of size " << x.size());
+      }
+
+      y.set_size(m_NumberOfColumns);
+      y.fill(0);
+      if (m_NumberOfRows == 0)
+      {
+        return;
+      }
+
+      // Rows of A are columns of A^T, so each thread scatters its rows into a vector of
+      // its own, and these are then summed. This needs one extra vector the size of the
+      // volume per thread, which is much less than the non-zeros of an explicit transpose.
+      ThreadIdType numberOfThreads = std::min((unsigned long int)m_NumberOfThreads, m_NumberOfRows);
+      std::vector<VectorType> partialOutputs(numberOfThreads - 1);
+
+      ProductThreadStruct str;
+      str.Matrix = this;
+      str.Input = &x;
+      str.Output = &y;
+      str.PartialOutputs = &partialOutputs;
+      this->SplitRows(numberOfThreads, str.RowBoundaries);
+
+      this->RunThreads(TransposeMultiplyThreaderCallback, str);
+
+      if (partialOutputs.size() > 0)
+      {
+        this->RunThreads(SumPartialOutputsThreaderCallback, str);
+      }
+    }
+
+} // end namespace itk
+
+#endif
@@ -17,6 +17,9 @@
 
 #include <itkEulerAffineTransform.h>
 #include <itkImage.h>
+#include <itkMultiThreader.h>
+
+#include "itkCompressedSparseRowMatrix.h"
 
 #include <vnl/vnl_math.h>
 #include <vnl/vnl_vector.h>
@@ -58,6 +61,14 @@ namespace itk
       typedef vnl_matrix<TScalarType>           					FullMatrixType;
       typedef vnl_vector<TScalarType>                   	VectorType;
 
+      /** A compressed sparse row matrix, whose rows can be calculated on several threads, and transposed without a copy */
+      typedef CompressedSparseRowMatrix<TScalarType>            CompressedSparseRowMatrixType;
+      typedef typename CompressedSparseRowMatrixType::RowBlock  RowBlockType;
+
+      /// Set/Get the number of threads used to calculate a compressed sparse row matrix.
+      itkSetClampMacro( NumberOfThreads, ThreadIdType, 1, ITK_MAX_THREADS );
+      itkGetMacro( NumberOfThreads, ThreadIdType );
+
       /** Set the affine transformation */
       itkSetObjectMacro( AffineTransform, EulerAffineTransformType );
       /** Get the affine transformation */
@@ -75,6 +86,9 @@ namespace itk
       /// Calculate and return the multiplication of the affine transformation matrix and image vector
       void CalculteMatrixVectorMultiplication(SparseMatrixType &R, VectorType const& inputImageVector, VectorType &outputImageVector);
 
+      /// Calculate the affine transformation matrix in compressed sparse row form, a block of slices per thread
+      void GetAffineTransformationSparseMatrix(CompressedSparseRowMatrixType &R, VolumeSizeType &inSize, EulerAffineTransformParametersType &parameters);
+
       /// Set the Finite Difference Method (FDM) difference value
       void SetFDMDifference(const double &diffVal) {m_FDMDiffValue = diffVal;}
 
@@ -100,6 +114,28 @@ namespace itk
       /// Flag indicating whether the object has been initialised
       bool 																						m_FlagInitialised;
 
+      /// The number of threads used for compressed sparse row matrices
+      ThreadIdType 																		m_NumberOfThreads;
+
+      /// Thread data for calculating the rows of a compressed sparse row affine transformation matrix
+      struct AffineTransformationThreadStruct
+      {
+        const Self                            *Transformer;
+        VolumeSizeType                         InSize;
+        FullMatrixType                         AffineCoreMatrix;
+        std::vector<RowBlockType>              Blocks;
+        std::vector<std::string>               ErrorMessages;
+      };
+
+      static ITK_THREAD_RETURN_TYPE AffineTransformationThreaderCallback(void *arg);
+
+      /** Get the non-zeros of the row of the affine transformation matrix for the voxel at (x, y, z),
+        * ie. the trilinear interpolation weights of the voxels around its transformed position.
+        * Returns the number of non-zeros, at most 8, which is zero if the voxel maps outside the volume. */
+      unsigned int GetAffineTransformationRow(const FullMatrixType &affineCoreMatrix, const VolumeSizeType &inSize,
+          unsigned long int xCoordin, unsigned long int yCoordin, unsigned long int zCoordin,
+          unsigned long int *columns, TScalarType *values) const;
+
       /** The affin transform core matrix and its inverse matrix */
       FullMatrixType																	m_affineCoreMatrix;
       // FullMatrixType																m_affineCoreMatrixInverse;
@@ -38,6 +38,7 @@ namespace itk
     {
       m_AffineTransform = EulerAffineTransformType::New();
       m_FlagInitialised = false;
+      m_NumberOfThreads = MultiThreader::GetGlobalDefaultNumberOfThreads();
     }
 
 
@@ -54,6 +55,124 @@ namespace itk
     }
 
 
+  /* -----------------------------------------------------------------------
+     GetAffineTransformationRow()
+     ----------------------------------------------------------------------- */
+
+  template <class TScalarType>
+    unsigned int
+    EulerAffineTransformMatrixAndItsVariations<TScalarType>
+    ::GetAffineTransformationRow(const FullMatrixType &affineCoreMatrix, const VolumeSizeType &inSize,
+        unsigned long int xCoordin, unsigned long int yCoordin, unsigned long int zCoordin,
+        unsigned long int *columns, TScalarType *values) const
+    {
+      const unsigned long int totalSize = inSize[0]*inSize[1]*inSize[2];
+
+      // The coordinates of the voxel, mapped by the core matrix, with homogeneous coordinates
+      const double outputCoordinate[4] = { (double) xCoordin, (double) yCoordin, (double) zCoordin, 1. };
+      double inputCoordinate[3];
+
+      for ( unsigned int i = 0; i < 3; i++ )
+      {
+        inputCoordinate[i] = 0.;
+        for ( unsigned int j = 0; j < 4; j++ )
+          inputCoordinate[i] += affineCoreMatrix(i, j)*outputCoordinate[j];
+      }
+
+      // Firstly, we need to exclude the voxels getting out-of-range after the affine transformation
+      if ( (inputCoordinate[0] < 0) || (inputCoordinate[1] < 0) || (inputCoordinate[2] < 0) ||
+           (inputCoordinate[0] > (inSize[0] - 1)) ||
+           (inputCoordinate[1] > (inSize[1] - 1)) ||
+           (inputCoordinate[2] > (inSize[2] - 1)) )
+        return 0;
+
+      double leftBottomXCoorinate = vcl_floor(inputCoordinate[0]);
+      double leftBottomYCoorinate = vcl_floor(inputCoordinate[1]);
+      double leftBottomZCoorinate = vcl_floor(inputCoordinate[2]);
+      unsigned long int intLeftBottomXCoorinate = (unsigned long int) leftBottomXCoorinate;
+      unsigned long int intLeftBottomYCoorinate = (unsigned long int) leftBottomYCoorinate;
+      unsigned long int intLeftBottomZCoorinate = (unsigned long int) leftBottomZCoorinate;
+
+      double xCoorCoef = (double) vcl_abs(inputCoordinate[0] - leftBottomXCoorinate);
+      double yCoorCoef = (double) vcl_abs(inputCoordinate[1] - leftBottomYCoorinate);
+      double zCoorCoef = (double) vcl_abs(inputCoordinate[2] - intLeftBottomZCoorinate);
+
+      unsigned long int colIndexNum1 = inSize[1]*inSize[0]*intLeftBottomZCoorinate + inSize[0]*intLeftBottomYCoorinate + intLeftBottomXCoorinate;
+      unsigned long int colIndexNum2 = inSize[1]*inSize[0]*intLeftBottomZCoorinate + inSize[0]*(intLeftBottomYCoorinate+1) + intLeftBottomXCoorinate;
+      unsigned long int colIndexNum3 = inSize[1]*inSize[0]*intLeftBottomZCoorinate + inSize[0]*intLeftBottomYCoorinate + (intLeftBottomXCoorinate+1);
+      unsigned long int colIndexNum4 = inSize[1]*inSize[0]*intLeftBottomZCoorinate + inSize[0]*(intLeftBottomYCoorinate+1) + (intLeftBottomXCoorinate+1);
+      unsigned long int colIndexNum5 = inSize[1]*inSize[0]*(intLeftBottomZCoorinate+1) + inSize[0]*intLeftBottomYCoorinate + intLeftBottomXCoorinate;
+      unsigned long int colIndexNum6 = inSize[1]*inSize[0]*(intLeftBottomZCoorinate+1) + inSize[0]*(intLeftBottomYCoorinate+1) + intLeftBottomXCoorinate;
+      unsigned long int colIndexNum7 = inSize[1]*inSize[0]*(intLeftBottomZCoorinate+1) + inSize[0]*intLeftBottomYCoorinate + (intLeftBottomXCoorinate+1);
+      unsigned long int colIndexNum8 = inSize[1]*inSize[0]*(intLeftBottomZCoorinate+1) + inSize[0]*(intLeftBottomYCoorinate+1) + (intLeftBottomXCoorinate+1);
+
+      if ( (colIndexNum1 >= totalSize) || (colIndexNum2 >= totalSize) ||
+           (colIndexNum3 >= totalSize) || (colIndexNum4 >= totalSize) ||
+           (colIndexNum5 >= totalSize) || (colIndexNum6 >= totalSize) ||
+           (colIndexNum7 >= totalSize) || (colIndexNum8 >= totalSize) )
+        return 0;
+
+      double xyCoef = xCoorCoef*yCoorCoef, xzCoef = xCoorCoef*zCoorCoef, yzCoef = yCoorCoef*zCoorCoef, xyzCoef = xCoorCoef*yCoorCoef*zCoorCoef;
+      unsigned int n = 0;
+
+      // Secondly, if the affine transformed voxel is overlapped on the left bottom index we have:
+      if ( (xCoorCoef == 0.0) && (yCoorCoef == 0.0) && (zCoorCoef == 0.0) )
+      {
+        columns[n] = colIndexNum1;  values[n++] = 1.0;
+      }
+      // Else, we have:
+      else if ( (xCoorCoef == 0.0) && (yCoorCoef == 0.0) && (zCoorCoef != 0.0) )
+      {
+        columns[n] = colIndexNum1;  values[n++] = 1. - zCoorCoef;
+        columns[n] = colIndexNum5;  values[n++] = zCoorCoef;
+      }
+      else if ( (xCoorCoef == 0.0) && (zCoorCoef == 0.0) && (yCoorCoef != 0) )
+      {
+        columns[n] = colIndexNum1;  values[n++] = 1. - yCoorCoef;
+        columns[n] = colIndexNum2;  values[n++] = yCoorCoef;
+      }
+      else if ( (yCoorCoef == 0.0) && (zCoorCoef == 0.0) && (xCoorCoef != 0.0) )
+      {
+        columns[n] = colIndexNum1;  values[n++] = 1. - xCoorCoef;
+        columns[n] = colIndexNum3;  values[n++] = xCoorCoef;
+      }
+      else if ( (xCoorCoef == 0.0) && (yCoorCoef != 0.0) && (zCoorCoef != 0.0) )
+      {
+        columns[n] = colIndexNum1;  values[n++] = 1. - yCoorCoef - zCoorCoef + yzCoef;
+        columns[n] = colIndexNum5;  values[n++] = zCoorCoef - yzCoef;
+        columns[n] = colIndexNum2;  values[n++] = yCoorCoef - yzCoef;
+        columns[n] = colIndexNum6;  values[n++] = yzCoef;
+      }
+      else if ( (yCoorCoef == 0.0) && (xCoorCoef != 0.0) && (zCoorCoef != 0.0) )
+      {
+        columns[n] = colIndexNum1;  values[n++] = 1. - xCoorCoef - zCoorCoef + xzCoef;
+        columns[n] = colIndexNum5;  values[n++] = zCoorCoef - xzCoef;
+        columns[n] = colIndexNum3;  values[n++] = xCoorCoef - xzCoef;
+        columns[n] = colIndexNum7;  values[n++] = xzCoef;
+      }
+      else if ( (zCoorCoef == 0.0) && (xCoorCoef != 0.0) && (yCoorCoef != 0.0) )
+      {
+        columns[n] = colIndexNum1;  values[n++] = 1. - xCoorCoef - yCoorCoef + xyCoef;
+        columns[n] = colIndexNum2;  values[n++] = yCoorCoef - xyCoef;
+        columns[n] = colIndexNum3;  values[n++] = xCoorCoef - xyCoef;
+        columns[n] = colIndexNum4;  values[n++] = xyCoef;
+      }
+      else
+      {
+        columns[n] = colIndexNum1;  values[n++] = 1. - xCoorCoef - yCoorCoef - zCoorCoef + xyCoef + xzCoef + yzCoef - xyzCoef;
+        columns[n] = colIndexNum2;  values[n++] = yCoorCoef - xyCoef - yzCoef + xyzCoef;
+        columns[n] = colIndexNum3;  values[n++] = xCoorCoef - xyCoef - xzCoef + xyzCoef;
+        columns[n] = colIndexNum4;  values[n++] = xyCoef - xyzCoef;
+        columns[n] = colIndexNum5;  values[n++] = zCoorCoef - xzCoef - yzCoef + xyzCoef;
+        columns[n] = colIndexNum6;  values[n++] = yzCoef - xyzCoef;
+        columns[n] = colIndexNum7;  values[n++] = xzCoef - xyzCoef;
+        columns[n] = colIndexNum8;  values[n++] = xyzCoef;
+      }
+
+      return n;
+    }
+
+
   /* -----------------------------------------------------------------------
      GetAffineTransformationSparseMatrix()
      ----------------------------------------------------------------------- */
@@ -68,23 +187,11 @@ namespace itk
 			// and the transformation parameters. It outputs the affine transformation matrix.
       EulerAffineTransformType::InputPointType center;
 			center.Fill(0.0);
-			// center.Fill(inSize[0]/2);
-      // center.SetElement(0, inSize[0]);
-			// center.SetElement(1, inSize[1]);
-			// center.SetElement(2, inSize[2]);
 
-			// 4x4 affine core matrix and its inverse with homogeneous coordinates
-			// In order to get the affine transformation matrix with bilinear interpolation easily,
-      // we need the inverse core matrix to calculate the entries of the full affine 
-			// transformation matrix. (Google 'inverse mapping')
+			// 4x4 affine core matrix with homogeneous coordinates, which maps each voxel of the
+			// output to the position in the input that it is interpolated from. (Google 'inverse mapping')
       Matrix<double, 4, 4> affineCoreMatrix;
-      // Matrix<double, 4, 4> affineCoreMatrixInverse;
-
       affineCoreMatrix.SetIdentity();
-      // affineCoreMatrixInverse.SetIdentity();
-
-      VectorType m_inputCoordinateVector(4);
-      VectorType m_outputCoordinateVector(4);
 
       m_AffineTransform->SetCenter(center);
       m_AffineTransform->SetParameters(parameters);
@@ -95,159 +202,121 @@ namespace itk
 
       affineCoreMatrix = this->m_AffineTransform->GetFullAffineMatrix();
       m_affineCoreMatrix = affineCoreMatrix.GetVnlMatrix();
-      // std::cerr << "The core affine transformation matrix is:" << std::endl << m_AffineTransform->GetFullAffineMatrix() << std::endl;
-
-      // m_AffineTransform->InvertTransformationMatrix();
-      // affineCoreMatrixInverse = m_AffineTransform->GetFullAffineMatrix();
-      // m_affineCoreMatrixInverse = affineCoreMatrixInverse.GetVnlMatrix();
-      // std::cerr << "The inverted core affine transformation matrix is:" << std::endl << m_AffineTransform->GetFullAffineMatrix() << std::endl;
-
-      std::ofstream invTransCoorVectorFile("invTransCoorVectorFile.txt");
-      std::ofstream originalCoorVectorFile("originalCoorVectorFile.txt");
-      std::ofstream coefFile("coefFile.txt");
-      // std::ofstream indexFile("indexFile.txt");
-      // indexFile << "The index is :" << std::endl;
-      // std::ofstream colIndexNumFile("colIndexNumFile.txt");
-      // colIndexNumFile << "The col index is :" << std::endl;
-			
-			// Get each entries of the full affine transformation matrix with bilinear interpolation
-      unsigned long int xCoordin = 0, yCoordin = 0, zCoordin = 0;
-      unsigned long int voxelNum = 0;
-      unsigned long int colIndexNum1 = 0, colIndexNum2 = 0, colIndexNum3 = 0, colIndexNum4 = 0; 
-			unsigned long int colIndexNum5 = 0, colIndexNum6 = 0, colIndexNum7 = 0, colIndexNum8 = 0;
-      double xCoorCoef = 0., yCoorCoef = 0., zCoorCoef = 0.;
-			double xyCoef = 0., xzCoef = 0., yzCoef = 0., xyzCoef = 0.;
-      double leftBottomXCoorinate = 0., leftBottomYCoorinate = 0., leftBottomZCoorinate = 0.;
-      unsigned long int intLeftBottomXCoorinate = 0, intLeftBottomYCoorinate = 0, intLeftBottomZCoorinate;
-      for ( zCoordin=0; zCoordin < inSize[2]; ++zCoordin )
-        for ( yCoordin=0; yCoordin < inSize[1]; ++yCoordin )
-          for ( xCoordin=0; xCoordin < inSize[0]; ++xCoordin ) 
+
+			// Get each entries of the full affine transformation matrix with trilinear interpolation
+      unsigned long int columns[8];
+      TScalarType values[8];
+
+      for ( unsigned long int zCoordin = 0; zCoordin < inSize[2]; ++zCoordin )
+        for ( unsigned long int yCoordin = 0; yCoordin < inSize[1]; ++yCoordin )
+          for ( unsigned long int xCoordin = 0; xCoordin < inSize[0]; ++xCoordin ) 
           {
-            voxelNum = xCoordin + inSize[0]*yCoordin + inSize[1]*inSize[0]*zCoordin;
-            // indexFile << voxelNum << std::endl;
-
-            m_outputCoordinateVector.put( 0, xCoordin );
-            m_outputCoordinateVector.put( 1, yCoordin );
-            m_outputCoordinateVector.put( 2, zCoordin );
-            m_outputCoordinateVector.put( 3, 1 );
-
-            originalCoorVectorFile << std::endl << "The original coordinates of voxel number " << voxelNum<< " are:" 
-             	<< std::endl << m_outputCoordinateVector[0] << " " << m_outputCoordinateVector[1] << " " 
-            	<< m_outputCoordinateVector[2] << " " << m_outputCoordinateVector[3] << std::endl;
-
-            // m_inputCoordinateVector = m_affineCoreMatrixInverse*m_outputCoordinateVector;
-						m_inputCoordinateVector = m_affineCoreMatrix*m_outputCoordinateVector;
-
-						// Firstly, we need to exclude the voxels getting out-of-range after the affine transformation
-            if ( (m_inputCoordinateVector[0] < 0) || (m_inputCoordinateVector[1] < 0) || (m_inputCoordinateVector[2] < 0) ||
-                 (m_inputCoordinateVector[0] > (inSize[0] - 1)) || 
-                 (m_inputCoordinateVector[1] > (inSize[1] - 1)) || 
-                 (m_inputCoordinateVector[2] > (inSize[2] - 1)) )
+            unsigned long int voxelNum = xCoordin + inSize[0]*yCoordin + inSize[1]*inSize[0]*zCoordin;
+            unsigned int n = this->GetAffineTransformationRow(m_affineCoreMatrix, inSize, xCoordin, yCoordin, zCoordin, columns, values);
+
+            for ( unsigned int i = 0; i < n; i++ )
+              R(voxelNum, columns[i]) = values[i];
+          }
+    }
+
+
+  /* -----------------------------------------------------------------------
+     AffineTransformationThreaderCallback()
+     ----------------------------------------------------------------------- */
+
+  template <class TScalarType>
+    ITK_THREAD_RETURN_TYPE
+    EulerAffineTransformMatrixAndItsVariations<TScalarType>
+    ::AffineTransformationThreaderCallback(void *arg)
+    {
+      ThreadIdType threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+      ThreadIdType threadCount = ((MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+      AffineTransformationThreadStruct *str = (AffineTransformationThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+      // Each thread calculates the rows of a contiguous range of slices into its own block
+      try
+      {
+        const VolumeSizeType &inSize = str->InSize;
+        RowBlockType &block = str->Blocks[threadId];
+
+        unsigned long int firstSlice = (inSize[2]*threadId)/threadCount;
+        unsigned long int lastSlice  = (inSize[2]*(threadId + 1))/threadCount;
+
+        unsigned long int columns[8];
+        TScalarType values[8];
+
+        block.SetFirstRow(firstSlice*inSize[1]*inSize[0]);
+
+        for ( unsigned long int zCoordin = firstSlice; zCoordin < lastSlice; ++zCoordin )
+          for ( unsigned long int yCoordin = 0; yCoordin < inSize[1]; ++yCoordin )
+            for ( unsigned long int xCoordin = 0; xCoordin < inSize[0]; ++xCoordin )
             {
-              m_inputCoordinateVector[0]=0;
-              m_inputCoordinateVector[1]=0;
-              m_inputCoordinateVector[2]=0;
+              unsigned int n = str->Transformer->GetAffineTransformationRow(str->AffineCoreMatrix, inSize, xCoordin, yCoordin, zCoordin, columns, values);
+
+              for ( unsigned int i = 0; i < n; i++ )
+                block.AddEntry(columns[i], values[i]);
+
+              block.FinishRow();
             }
-            else
-            {
-              invTransCoorVectorFile << std::endl << "The inverse transformed coordinates of voxel number " << voxelNum<< " are:" 
-                << std::endl << m_inputCoordinateVector[0] << " " << m_inputCoordinateVector[1] << " " 
-                << m_inputCoordinateVector[2] << " " << m_inputCoordinateVector[3] << std::endl;
-
-              leftBottomXCoorinate = vcl_floor(m_inputCoordinateVector[0]);
-              leftBottomYCoorinate = vcl_floor(m_inputCoordinateVector[1]);
-              leftBottomZCoorinate = vcl_floor(m_inputCoordinateVector[2]);
-              intLeftBottomXCoorinate = (unsigned long int) leftBottomXCoorinate;
-              intLeftBottomYCoorinate = (unsigned long int) leftBottomYCoorinate;
-              intLeftBottomZCoorinate = (unsigned long int) leftBottomZCoorinate;
-
-              xCoorCoef = (double) vcl_abs(m_inputCoordinateVector[0] - leftBottomXCoorinate);
-              yCoorCoef = (double) vcl_abs(m_inputCoordinateVector[1] - leftBottomYCoorinate);
-							zCoorCoef = (double) vcl_abs(m_inputCoordinateVector[2] - intLeftBottomZCoorinate);
-
-              coefFile << std::endl << "The coefs are: " << xCoorCoef << " and " << yCoorCoef << " and " << zCoorCoef << std::endl;
-
-              colIndexNum1 		= inSize[1]*inSize[0]*intLeftBottomZCoorinate + inSize[0]*intLeftBottomYCoorinate + intLeftBottomXCoorinate;
-              colIndexNum2 		= inSize[1]*inSize[0]*intLeftBottomZCoorinate + inSize[0]*(intLeftBottomYCoorinate+1) + intLeftBottomXCoorinate;
-              colIndexNum3 		= inSize[1]*inSize[0]*intLeftBottomZCoorinate + inSize[0]*intLeftBottomYCoorinate + (intLeftBottomXCoorinate+1);
-              colIndexNum4	 	= inSize[1]*inSize[0]*intLeftBottomZCoorinate + inSize[0]*(intLeftBottomYCoorinate+1) + (intLeftBottomXCoorinate+1);
-              colIndexNum5	 	= inSize[1]*inSize[0]*(intLeftBottomZCoorinate+1) + inSize[0]*intLeftBottomYCoorinate + intLeftBottomXCoorinate;
-              colIndexNum6	 	= inSize[1]*inSize[0]*(intLeftBottomZCoorinate+1) + inSize[0]*(intLeftBottomYCoorinate+1) + intLeftBottomXCoorinate;
-              colIndexNum7	 	= inSize[1]*inSize[0]*(intLeftBottomZCoorinate+1) + inSize[0]*intLeftBottomYCoorinate + (intLeftBottomXCoorinate+1);
-              colIndexNum8	 	= inSize[1]*inSize[0]*(intLeftBottomZCoorinate+1) + inSize[0]*(intLeftBottomYCoorinate+1) + (intLeftBottomXCoorinate+1);
-
-              if ( (colIndexNum1 < m_input3DImageTotalSize)  && (colIndexNum2 < m_input3DImageTotalSize) &&
-                   (colIndexNum3 < m_input3DImageTotalSize)  && (colIndexNum4 < m_input3DImageTotalSize) &&
-									 (colIndexNum5 < m_input3DImageTotalSize)  && (colIndexNum6 < m_input3DImageTotalSize) &&
-									 (colIndexNum7 < m_input3DImageTotalSize)  && (colIndexNum8 < m_input3DImageTotalSize) ) 
-              {
-                assert( (voxelNum < m_input3DImageTotalSize) && 
-												(colIndexNum1 < m_input3DImageTotalSize)  && (colIndexNum2 < m_input3DImageTotalSize) &&
-                   			(colIndexNum3 < m_input3DImageTotalSize)  && (colIndexNum4 < m_input3DImageTotalSize) &&
-									 			(colIndexNum5 < m_input3DImageTotalSize)  && (colIndexNum6 < m_input3DImageTotalSize) &&
-									 			(colIndexNum7 < m_input3DImageTotalSize)  && (colIndexNum8 < m_input3DImageTotalSize) );
-
-								xyCoef = xCoorCoef*yCoorCoef; xzCoef = xCoorCoef*zCoorCoef; yzCoef = yCoorCoef*zCoorCoef; xyzCoef = xCoorCoef*yCoorCoef*zCoorCoef;
-
-								// Secondly, if the affine transformed voxel is overlapped on the left bottom index we have:
-								if ( (xCoorCoef == 0.0) && (yCoorCoef == 0.0) && (zCoorCoef == 0.0) )
-                	R(voxelNum, colIndexNum1) 		= 1.0;
-								// Else, we have:
-								else if ( (xCoorCoef == 0.0) && (yCoorCoef == 0.0) && (zCoorCoef != 0.0) )
-								{
-                	R(voxelNum, colIndexNum1) 		= 1. - zCoorCoef;
-									R(voxelNum, colIndexNum5)  		= zCoorCoef;
-								}				
-								else if ( (xCoorCoef == 0.0) && (zCoorCoef == 0.0) && (yCoorCoef != 0) )
-								{
-                	R(voxelNum, colIndexNum1) 		= 1. - yCoorCoef;
-                	R(voxelNum, colIndexNum2) 		= yCoorCoef; 
-								}
-								else if ( (yCoorCoef == 0.0) && (zCoorCoef == 0.0) && (xCoorCoef != 0.0) )
-								{
-                	R(voxelNum, colIndexNum1) 		= 1. - xCoorCoef;
-                	R(voxelNum, colIndexNum3)			= xCoorCoef; 
-								}
-								else if ( (xCoorCoef == 0.0) && (yCoorCoef != 0.0) && (zCoorCoef != 0.0) )
-								{
-                	R(voxelNum, colIndexNum1) 		= 1. - yCoorCoef - zCoorCoef + yzCoef;
-                	R(voxelNum, colIndexNum5) 		= zCoorCoef - yzCoef; 
-                	R(voxelNum, colIndexNum2)			= yCoorCoef - yzCoef; 
-                	R(voxelNum, colIndexNum6) 		= yzCoef;
-								}
-								else if ( (yCoorCoef == 0.0) && (xCoorCoef != 0.0) && (zCoorCoef != 0.0) )
-								{
-                	R(voxelNum, colIndexNum1) 		= 1. - xCoorCoef - zCoorCoef + xzCoef;
-                	R(voxelNum, colIndexNum5) 		= zCoorCoef - xzCoef; 
-                	R(voxelNum, colIndexNum3)			= xCoorCoef - xzCoef;
-                	R(voxelNum, colIndexNum7) 		= xzCoef;
-								}
-								else if ( (zCoorCoef == 0.0) && (xCoorCoef != 0.0) && (yCoorCoef != 0.0) )
-								{
-                	R(voxelNum, colIndexNum1) 		= 1. - xCoorCoef - yCoorCoef + xyCoef;
-                	R(voxelNum, colIndexNum2) 		= yCoorCoef - xyCoef; 
-                	R(voxelNum, colIndexNum3)			= xCoorCoef - xyCoef;
-                	R(voxelNum, colIndexNum4) 		= xyCoef;
-								}
-								else if ( (zCoorCoef != 0.0) && (xCoorCoef != 0.0) && (yCoorCoef != 0.0) )
-								{
-                	R(voxelNum, colIndexNum1) 		= 1. - xCoorCoef - yCoorCoef - zCoorCoef + xyCoef + xzCoef + yzCoef - xyzCoef;
-                	R(voxelNum, colIndexNum2) 		= yCoorCoef - xyCoef - yzCoef + xyzCoef;
-                	R(voxelNum, colIndexNum3)			= xCoorCoef - xyCoef - xzCoef  + xyzCoef;
-                	R(voxelNum, colIndexNum4) 		= xyCoef - xyzCoef;
-                	R(voxelNum, colIndexNum5) 		= zCoorCoef - xzCoef - yzCoef + xyzCoef; 
-                	R(voxelNum, colIndexNum6) 		= yzCoef - xyzCoef;
-                	R(voxelNum, colIndexNum7) 		= xzCoef - xyzCoef;
-                	R(voxelNum, colIndexNum8) 		= xyzCoef;
-								}
-
-                // colIndexNumFile << colIndexNumOne << std::endl;		
-              }
-            } 
-          }
+      }
+      catch (std::exception& err)
+      {
+        str->ErrorMessages[threadId] = err.what();
+      }
+
+      return ITK_THREAD_RETURN_VALUE;
+    }
 
-      // pSparseAffineTransformMatrix = &R;
 
+  /* -----------------------------------------------------------------------
+     GetAffineTransformationSparseMatrix() - compressed sparse row
+     ----------------------------------------------------------------------- */
+
+  template <class TScalarType>
+    void
+    EulerAffineTransformMatrixAndItsVariations<TScalarType>
+    ::GetAffineTransformationSparseMatrix(CompressedSparseRowMatrixType &R, VolumeSizeType &inSize, EulerAffineTransformParametersType &parameters)
+    {
+      EulerAffineTransformType::InputPointType center;
+      center.Fill(0.0);
+
+      Matrix<double, 4, 4> affineCoreMatrix;
+
+      m_AffineTransform->SetCenter(center);
+      m_AffineTransform->SetParameters(parameters);
+
+      m_input3DImageTotalSize = inSize[0]*inSize[1]*inSize[2];
+
+      affineCoreMatrix = this->m_AffineTransform->GetFullAffineMatrix();
+      m_affineCoreMatrix = affineCoreMatrix.GetVnlMatrix();
+
+      AffineTransformationThreadStruct str;
+      str.Transformer = this;
+      str.InSize = inSize;
+      str.AffineCoreMatrix = m_affineCoreMatrix;
+
+      // Each row depends only on its own voxel, so the slices are shared between the threads,
+      // and the rows go straight into the blocks, without a vnl_sparse_matrix in between
+      ThreadIdType numberOfThreads = std::max(std::min((unsigned long int)m_NumberOfThreads, (unsigned long int)inSize[2]), 1UL);
+      str.Blocks.resize(numberOfThreads);
+      str.ErrorMessages.resize(numberOfThreads);
+
+      MultiThreader::Pointer threader = MultiThreader::New();
+      threader->SetNumberOfThreads(numberOfThreads);
+      threader->SetSingleMethod(AffineTransformationThreaderCallback, &str);
+      threader->SingleMethodExecute();
+
+      for (unsigned int i = 0; i < str.ErrorMessages.size(); i++)
+      {
+        if (str.ErrorMessages[i].size() > 0)
+        {
+          itkExceptionMacro(<< "Failed to calculate the affine transformation matrix:" << str.ErrorMessages[i]);
+        }
+      }
+
+      R.SetSize(m_input3DImageTotalSize, m_input3DImageTotalSize);
+      R.SetNumberOfThreads(m_NumberOfThreads);
+      R.SetRowBlocks(str.Blocks);
     }
 
   /* -----------------------------------------------------------------------
@@ -323,8 +392,8 @@ namespace itk
       m_input3DImageTotalSize = inSize[0]*inSize[1]*inSize[2];
 
       // Temporary sparse matrix to hold the plus and minus variations in order to use the Finite Difference Method (FDM)
-      SparseMatrixType RTempPlus(m_input3DImageTotalSize, m_input3DImageTotalSize);
-      SparseMatrixType RTempMinus(m_input3DImageTotalSize, m_input3DImageTotalSize);
+      CompressedSparseRowMatrixType RTempPlus;
+      CompressedSparseRowMatrixType RTempMinus;
 
       // Change one of the parameters
       EulerAffineTransformParametersType parametersTempPlus 	= parameters;
@@ -341,91 +410,13 @@ namespace itk
       this->GetAffineTransformationSparseMatrix(RTempPlus, inSize, parametersTempPlus);
       this->GetAffineTransformationSparseMatrix(RTempMinus, inSize, parametersTempMinus);
 
-/*
-			unsigned long int rowIndex = 0;
-  		unsigned long int colIndex = 0;
-			
-  		RTempPlus.reset();
-*/
-
-/*
- 			std::ofstream RTempPlusOriginalFullFile("RTempPlusOriginalFullFile.txt");
-  		RTempPlusOriginalFullFile << std::endl << "The entries of the affine matrix are: " << std::endl;
-
- 	 		for ( unsigned long int totalEntryIterRow = 0; totalEntryIterRow < RTempPlus.rows(); totalEntryIterRow++ )
-				for ( unsigned long int totalEntryIterCol = 0; totalEntryIterCol < RTempPlus.cols(); totalEntryIterCol++ )
-  				RTempPlusOriginalFullFile << std::endl << "Row " << totalEntryIterRow << " and column " << totalEntryIterCol 
-																		<< " is: " << RTempPlus(totalEntryIterRow, totalEntryIterCol) << std::endl;
-*/
-
-/*
-  		std::ofstream RTempPlusOriginalFile("RTempPlusOriginal.txt");
-  		RTempPlusOriginalFile << std::endl << "The non-zero entries of the affine matrix are: " << std::endl;
-
-  		rowIndex = 0;
-  		colIndex = 0;
-
- 	 		while ( RTempPlus.next() )
-  		{
-  			rowIndex = RTempPlus.getrow();
-  			colIndex = RTempPlus.getcolumn();
-
-  			if ( (rowIndex < RTempPlus.rows()) && (colIndex < RTempPlus.cols()) )	
-  			RTempPlusOriginalFile << std::endl << "Row " << rowIndex << " and column " << colIndex << " is: " << RTempPlus.value() << std::endl;
-  		}
-			
-			
-  		RTempMinus.reset();
-  		std::ofstream RTempMinusOriginalFile("RTempMinusOriginal.txt");
-  		RTempMinusOriginalFile << std::endl << "The non-zero entries of the affine matrix are: " << std::endl;
-
-  		rowIndex = 0;
-  		colIndex = 0;
-
- 	 		while ( RTempMinus.next() )
-  		{
-  			rowIndex = RTempMinus.getrow();
-  			colIndex = RTempMinus.getcolumn();
-
-  			if ( (rowIndex < RTempMinus.rows()) && (colIndex < RTempMinus.cols()) )	
-  			RTempMinusOriginalFile << std::endl << "Row " << rowIndex << " and column " << colIndex << " is: " << RTempMinus.value() << std::endl;
-  		}
-				
-
-      // Perform the FDM
-      RTempPlus.subtract(RTempMinus, RTempPlus);
-
-			
-  		RTempPlus.reset();
-  		std::ofstream RTempPlusFile("RTempPlus.txt");
-			RTempPlusFile << std::endl << "The matrix size is " << RTempPlus.rows() << " by " << RTempPlus.cols() << std::endl;
-  		RTempPlusFile << std::endl << "The non-zero entries of the affine matrix are: " << std::endl;
-
-  		rowIndex = 0;
-  		colIndex = 0;
-
- 	 		while ( RTempPlus.next() )
-  		{
-  			rowIndex = RTempPlus.getrow();
-  			colIndex = RTempPlus.getcolumn();
-
-  			if ( (rowIndex < RTempPlus.rows()) && (colIndex < RTempPlus.cols()) )	
-  			RTempPlusFile << std::endl << "Row " << rowIndex << " and column " << colIndex << " is: " << RTempPlus.value() << std::endl;
-  		}
-*/			
-
-      // RTempPlus 	/= (m_FDMDiffValue);
-      // RTempMinus 	/= (m_FDMDiffValue);
-
-      // RTempPlus -= (RTempMinus);
-
-      // Perform the FDM
-      SparseMatrixType RTempDifference(m_input3DImageTotalSize, m_input3DImageTotalSize);			
-			RTempPlus.subtract(RTempMinus, RTempDifference);
-
       try { 
+        // Perform the FDM, as (R+ x - R- x), rather than forming (R+ - R-)
         niftkitkInfoMacro(<< "Calculating the gradient.");
-        RTempDifference.mult(inputImageVector, outputGradVector);
+        VectorType outputGradVectorMinus;
+        RTempPlus.Multiply(inputImageVector, outputGradVector);
+        RTempMinus.Multiply(inputImageVector, outputGradVectorMinus);
+        outputGradVector -= outputGradVectorMinus;
         outputGradVector /= (2*m_FDMDiffValue);
         niftkitkInfoMacro(<< "Done");
 
@@ -16,7 +16,9 @@
 #define itkForwardAndBackwardProjectionMatrix_h
 
 #include "itkRay.h"
+#include "itkCompressedSparseRowMatrix.h"
 #include <itkImage.h>
+#include <itkMultiThreader.h>
 
 #include <vnl/vnl_math.h>
 #include <vnl/vnl_vector.h>
@@ -113,6 +115,14 @@ namespace itk
       typedef vnl_matrix<TScalarType>           								FullMatrixType;
       typedef vnl_vector<TScalarType>                   				VectorType;
 
+      /** A compressed sparse row matrix, which can be traced on several threads, and back projected without a transpose */
+      typedef CompressedSparseRowMatrix<TScalarType>            CompressedSparseRowMatrixType;
+      typedef typename CompressedSparseRowMatrixType::RowBlock  RowBlockType;
+
+      /// Set/Get the number of threads used to trace the rays of a compressed sparse row matrix, and to multiply it.
+      itkSetClampMacro( NumberOfThreads, ThreadIdType, 1, ITK_MAX_THREADS );
+      itkGetMacro( NumberOfThreads, ThreadIdType );
+
       /// Set the volume size
       void SetVolumeSize(const VolumeSizeType &r) {m_VolumeSize = r; m_FlagInitialised = false;}
 
@@ -131,6 +141,20 @@ namespace itk
       /// Calculate and return the multiplication of the affine transformation matrix and image vector
       void CalculteMatrixVectorMultiplication(SparseMatrixType &R, VectorType const &inputImageVector, VectorType &outputImageVector);
 
+      /// Calculate the forward projection matrix in compressed sparse row form, tracing the rays on several threads
+      void GetForwardProjectionSparseMatrix(CompressedSparseRowMatrixType &R, InputImageConstPointer inImage, OutputImagePointer outImage,
+          VolumeSizeType &inSize, OutputImageSizeType &outSize, const unsigned int &projNum);
+
+      /// Calculate the forward projection matrix in compressed sparse row form (Overloaded using non-const input image pointer)
+      void GetForwardProjectionSparseMatrix(CompressedSparseRowMatrixType &R, InputImagePointer inImage, OutputImagePointer outImage,
+          VolumeSizeType &inSize, OutputImageSizeType &outSize, const unsigned int &projNum);
+
+      /// Calculate the multiplication of the compressed sparse row matrix and image vector, ie. the forward projection
+      void CalculteMatrixVectorMultiplication(CompressedSparseRowMatrixType &R, VectorType const &inputImageVector, VectorType &outputImageVector);
+
+      /// Calculate the multiplication of the transpose of the compressed sparse row matrix and a vector, ie. the backward projection
+      void CalculteTransposeMatrixVectorMultiplication(CompressedSparseRowMatrixType &R, VectorType const &inputVector, VectorType &outputImageVector);
+
 
     protected:
       ForwardAndBackwardProjectionMatrix();
@@ -177,6 +201,29 @@ namespace itk
         LAST_DIRECTION
       } TraversalDirection;
 
+      /// Thread data for tracing the rows of a compressed sparse row forward projection matrix
+      struct ForwardProjectionThreadStruct
+      {
+        Self                                  *Projector;
+        InputImageConstPointer                 InImage;
+        OutputImagePointer                     OutImage;
+        VolumeSizeType                         InSize;
+        unsigned long int                      OutSizeTotal;
+        unsigned int                           ProjNum;
+        std::vector< Matrix<double, 4, 4> >    ProjectionMatrices;
+        std::vector<RowBlockType>              Blocks;
+        std::vector<std::string>               ErrorMessages;
+      };
+
+      static ITK_THREAD_RETURN_TYPE ForwardProjectionThreaderCallback(void *arg);
+
+      /// Trace the rays for rows [firstRow, lastRow) of the forward projection matrix into one block.
+      void TraceForwardProjectionRows(ForwardProjectionThreadStruct &str, RowBlockType &block,
+          unsigned long int firstRow, unsigned long int lastRow) const;
+
+      /// The number of threads used for compressed sparse row matrices
+      ThreadIdType m_NumberOfThreads;
+
       /** Create a sparse matrix to store the affine transformation matrix coefficients */
       // SparseMatrixType const* 												pSparseForwardProjMatrix;
 
@@ -39,6 +39,8 @@ namespace itk
       // Initialise the threshold above which intensities are integrated
       m_Threshold = 0.;
 
+      m_NumberOfThreads = MultiThreader::GetGlobalDefaultNumberOfThreads();
+
       // Set default values for the output image size
 
       m_OutputImageSize[0]  = 100;  // size along X
@@ -66,6 +68,7 @@ namespace itk
     ::PrintSelf(std::ostream& os, Indent indent) const
     {
       Superclass::PrintSelf(os,indent);
+      os << indent << "NumberOfThreads: " << m_NumberOfThreads << std::endl;
     }
 
 
@@ -473,6 +476,271 @@ namespace itk
 
         }
 
+      /* -----------------------------------------------------------------------
+         TraceForwardProjectionRows()
+         ----------------------------------------------------------------------- */
+
+      template <class TScalarType, class IntensityType>
+        void 
+        ForwardAndBackwardProjectionMatrix<TScalarType, IntensityType>
+        ::TraceForwardProjectionRows(ForwardProjectionThreadStruct &str, RowBlockType &block,
+            unsigned long int firstRow, unsigned long int lastRow) const
+        {
+          // This is the ray casting of GetForwardProjectionSparseMatrix(), for a range of rows,
+          // where row = iProjection*outSizeTotal + pixel2D.
+          const VolumeSizeType &inSize = str.InSize;
+          const unsigned long int inSizeTotal = inSize[0]*inSize[1]*inSize[2];
+
+          OutputImageRegionType outRegion = str.OutImage->GetLargestPossibleRegion();
+          OutputImageIndexType outIndex;
+          OutputImagePointType outPoint;
+
+          // Each thread has its own ray, as it holds the state of the traversal
+          Ray<InputImageType> ray;
+          ray.SetImage( str.InImage );
+
+          double integral = 0;
+          double y = 0., z = 0., yz = 0.;
+          const int* index;
+          unsigned long int yMatrix[8];
+
+          // This is used to normalise the projected intensities
+          double pointSpace = 0., normCoef = 0.;
+          InputImageSpacingType  inputImageSpacing  = str.InImage->GetSpacing();
+          OutputImageSpacingType outputImageSpacing = str.OutImage->GetSpacing();
+          const double inputSpacingTotal = inputImageSpacing[0]*inputImageSpacing[1]*inputImageSpacing[2];
+          const double outputSpacingTotal = outputImageSpacing[0]*outputImageSpacing[1];
+
+          unsigned int currentProjection = str.ProjNum;
+          block.SetFirstRow(firstRow);
+
+          for (unsigned long int row = firstRow; row < lastRow; row++)
+          {
+            unsigned int iProjection = row / str.OutSizeTotal;
+            unsigned long int pixel2D = row % str.OutSizeTotal;
+
+            if (iProjection != currentProjection)
+            {
+              ray.SetProjectionMatrix(str.ProjectionMatrices[iProjection]);
+              currentProjection = iProjection;
+            }
+
+            // Determine the coordinate of the output pixel, in the same order as an ImageRegionIterator
+            outIndex[0] = outRegion.GetIndex()[0] + pixel2D % outRegion.GetSize()[0];
+            outIndex[1] = outRegion.GetIndex()[1] + pixel2D / outRegion.GetSize()[0];
+            str.OutImage->TransformIndexToPhysicalPoint(outIndex, outPoint);
+
+            // Create a ray for this coordinate
+            ray.SetRay(outPoint);
+
+            integral = 0.;
+
+            while (ray.NextPoint()) {
+
+              ray.GetBilinearCoefficients(y, z);
+              index = ray.GetRayIntersectionVoxelIndex();
+
+              integral += ray.GetCurrentIntensity();
+
+              pointSpace = ray.GetRayPointSpacing();
+              normCoef = pointSpace*outputSpacingTotal / inputSpacingTotal;
+
+              yMatrix[0] = inSize[1]*inSize[0]*index[2] + inSize[0]*index[1] + index[0];
+              yMatrix[1] = inSize[1]*inSize[0]*index[2] + inSize[0]*(index[1]+1) + index[0];
+              yMatrix[2] = inSize[1]*inSize[0]*index[2] + inSize[0]*index[1] + (index[0]+1);
+              yMatrix[3] = inSize[1]*inSize[0]*index[2] + inSize[0]*(index[1]+1) + (index[0]+1);
+              yMatrix[4] = inSize[1]*inSize[0]*(index[2]+1) + inSize[0]*index[1] + index[0];
+              yMatrix[5] = inSize[1]*inSize[0]*(index[2]+1) + inSize[0]*(index[1]+1) + index[0];
+              yMatrix[6] = inSize[1]*inSize[0]*(index[2]+1) + inSize[0]*index[1] + (index[0]+1);
+              yMatrix[7] = inSize[1]*inSize[0]*(index[2]+1) + inSize[0]*(index[1]+1) + (index[0]+1);
+
+              yz = y*z;
+
+              unsigned int corner[4] = {0, 0, 0, 0};
+              switch( ray.GetTraversalDirection() )
+              {
+                case TRANSVERSE_IN_X:
+                  {
+                    corner[0] = 0; corner[1] = 4; corner[2] = 1; corner[3] = 5;
+                    break;
+                  }
+                case TRANSVERSE_IN_Y:
+                  {
+                    corner[0] = 0; corner[1] = 4; corner[2] = 2; corner[3] = 6;
+                    break;
+                  }
+                case TRANSVERSE_IN_Z:
+                  {
+                    corner[0] = 0; corner[1] = 1; corner[2] = 2; corner[3] = 3;
+                    break;
+                  }
+                default:
+                  continue;
+              }
+
+              double coefficient[4] = { (1. - y - z + yz)*normCoef, (z - yz)*normCoef, (y - yz)*normCoef, (yz)*normCoef };
+
+              for (unsigned int i = 0; i < 4; i++)
+              {
+                // There is no voxel beyond the edge of the volume
+                if (yMatrix[corner[i]] < inSizeTotal)
+                {
+                  block.AddEntry(static_cast<typename CompressedSparseRowMatrixType::ColumnIndexType>(yMatrix[corner[i]]), coefficient[i]);
+                }
+              }
+            }
+
+            block.FinishRow();
+
+            // As for the serial version, the output image holds the ray casting integration of the last projection
+            if (iProjection == str.ProjNum - 1)
+            {
+              str.OutImage->SetPixel(outIndex, static_cast<IntensityType>( integral ));
+            }
+          }
+        }
+
+
+      /* -----------------------------------------------------------------------
+         ForwardProjectionThreaderCallback()
+         ----------------------------------------------------------------------- */
+
+      template <class TScalarType, class IntensityType>
+        ITK_THREAD_RETURN_TYPE
+        ForwardAndBackwardProjectionMatrix<TScalarType, IntensityType>
+        ::ForwardProjectionThreaderCallback(void *arg)
+        {
+          ThreadIdType threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+          ThreadIdType threadCount = ((MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+          ForwardProjectionThreadStruct *str = (ForwardProjectionThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+          // Each thread traces a contiguous range of rows into its own block
+          try
+          {
+            unsigned long int numberOfRows = str->ProjNum*str->OutSizeTotal;
+            str->Projector->TraceForwardProjectionRows(*str, str->Blocks[threadId],
+                                                       (numberOfRows*threadId)/threadCount,
+                                                       (numberOfRows*(threadId + 1))/threadCount);
+          }
+          catch (std::exception& err)
+          {
+            str->ErrorMessages[threadId] = err.what();
+          }
+
+          return ITK_THREAD_RETURN_VALUE;
+        }
+
+
+      /* -----------------------------------------------------------------------
+         GetForwardProjectionSparseMatrix() - compressed sparse row
+         ----------------------------------------------------------------------- */
+
+      template <class TScalarType, class IntensityType>
+        void 
+        ForwardAndBackwardProjectionMatrix<TScalarType, IntensityType>
+        ::GetForwardProjectionSparseMatrix(CompressedSparseRowMatrixType &R, InputImageConstPointer inImage, OutputImagePointer outImage,
+            VolumeSizeType &inSize, OutputImageSizeType &outSize, const unsigned int &projNum) 
+        {
+          const unsigned long int outSizeTotal = outSize[0]*outSize[1];
+          const unsigned long int inSizeTotal  = inSize[0]*inSize[1]*inSize[2];
+          const unsigned long int numberOfRows = projNum*outSizeTotal;
+
+          if (outImage->GetLargestPossibleRegion().GetNumberOfPixels() != outSizeTotal)
+          {
+            itkExceptionMacro(<< "The output image has " << outImage->GetLargestPossibleRegion().GetNumberOfPixels()
+                              << " pixels, but the projection size is " << outSize);
+          }
+
+          ForwardProjectionThreadStruct str;
+          str.Projector = this;
+          str.InImage = inImage;
+          str.OutImage = outImage;
+          str.InSize = inSize;
+          str.OutSizeTotal = outSizeTotal;
+          str.ProjNum = projNum;
+
+          // The geometry is queried up front, on this thread
+          for (unsigned int iProjection = 0; iProjection < projNum; iProjection++)
+          {
+            this->SetPerspectiveTransform( m_ProjectionGeometry->GetPerspectiveTransform( iProjection ) );
+            this->SetAffineTransform( m_ProjectionGeometry->GetAffineTransform( iProjection ) );
+
+            Matrix<double, 4, 4> projMatrix = this->m_PerspectiveTransform->GetMatrix();
+            projMatrix *= this->m_AffineTransform->GetFullAffineMatrix();
+
+            str.ProjectionMatrices.push_back(projMatrix);
+          }
+
+          ThreadIdType numberOfThreads = std::max(std::min((unsigned long int)m_NumberOfThreads, numberOfRows), 1UL);
+          str.Blocks.resize(numberOfThreads);
+          str.ErrorMessages.resize(numberOfThreads);
+
+          niftkitkInfoMacro(<< "Tracing " << projNum << " forward projections on " << numberOfThreads << " threads.");
+
+          MultiThreader::Pointer threader = MultiThreader::New();
+          threader->SetNumberOfThreads(numberOfThreads);
+          threader->SetSingleMethod(ForwardProjectionThreaderCallback, &str);
+          threader->SingleMethodExecute();
+
+          for (unsigned int i = 0; i < str.ErrorMessages.size(); i++)
+          {
+            if (str.ErrorMessages[i].size() > 0)
+            {
+              itkExceptionMacro(<< "Failed to trace the forward projection matrix:" << str.ErrorMessages[i]);
+            }
+          }
+
+          R.SetSize(numberOfRows, inSizeTotal);
+          R.SetNumberOfThreads(m_NumberOfThreads);
+          R.SetRowBlocks(str.Blocks);
+
+          niftkitkDebugMacro(<< "Finished forward projection matrix, with " << R.GetNumberOfNonZeros() << " non-zeros.");
+        }
+
+
+      /* -----------------------------------------------------------------------
+         GetForwardProjectionSparseMatrix() - compressed sparse row
+         ----------------------------------------------------------------------- */
+
+      template <class TScalarType, class IntensityType>
+        void 
+        ForwardAndBackwardProjectionMatrix<TScalarType, IntensityType>
+        ::GetForwardProjectionSparseMatrix(CompressedSparseRowMatrixType &R, InputImagePointer inImage, OutputImagePointer outImage,
+            VolumeSizeType &inSize, OutputImageSizeType &outSize, const unsigned int &projNum) 
+        {
+          InputImageConstPointer constImage = inImage.GetPointer();
+          this->GetForwardProjectionSparseMatrix(R, constImage, outImage, inSize, outSize, projNum);
+        }
+
+
+      /* -----------------------------------------------------------------------
+         CalculteMatrixVectorMultiplication() - compressed sparse row
+         ----------------------------------------------------------------------- */
+
+      template <class TScalarType, class IntensityType>
+        void 
+        ForwardAndBackwardProjectionMatrix<TScalarType, IntensityType>
+        ::CalculteMatrixVectorMultiplication(CompressedSparseRowMatrixType &R, VectorType const& inputImageVector, VectorType &outputImageVector) 
+        {
+          niftkitkDebugMacro(<< "Calculating the multiplication of the projection matrix and image vector.");
+          R.Multiply(inputImageVector, outputImageVector);
+        }
+
+
+      /* -----------------------------------------------------------------------
+         CalculteTransposeMatrixVectorMultiplication() - compressed sparse row
+         ----------------------------------------------------------------------- */
+
+      template <class TScalarType, class IntensityType>
+        void 
+        ForwardAndBackwardProjectionMatrix<TScalarType, IntensityType>
+        ::CalculteTransposeMatrixVectorMultiplication(CompressedSparseRowMatrixType &R, VectorType const& inputVector, VectorType &outputImageVector) 
+        {
+          // This is the backward projection, without forming the transpose of R
+          niftkitkDebugMacro(<< "Calculating the multiplication of the transposed projection matrix and projection vector.");
+          R.TransposeMultiply(inputVector, outputImageVector);
+        }
+
     } // end namespace itk
 
 
@@ -0,0 +1,126 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#ifndef itkCityBlockDistanceImageFilter_h
+#define itkCityBlockDistanceImageFilter_h
+
+#include <itkImageToImageFilter.h>
+#include <itkImage.h>
+#include <itkMultiThreader.h>
+#include <vector>
+
+namespace itk
+{
+
+/**
+ * \class CityBlockDistanceImageFilter
+ * Computes the city block (L1) distance, in voxels, of each voxel to the nearest foreground voxel,
+ * or, if DistanceToBackground is on, to the nearest voxel that is not foreground, counting the
+ * voxels just outside the image as background.
+ *
+ * Distances larger than MaximumDistance are set to MaximumDistance, so the output only needs
+ * to hold values up to it. The distance is computed exactly, with a forward and a backward
+ * scan along each image axis in turn, the lines of each axis being shared between threads.
+ *
+ * Thresholding the distance at N gives the same mask as N dilations, or erosions, with
+ * a BinaryCrossStructuringElement of radius 1, in a single pass over the image.
+ */
+template <class TInputImage, class TOutputImage = Image<unsigned int, TInputImage::ImageDimension> >
+class ITK_EXPORT CityBlockDistanceImageFilter :
+  public ImageToImageFilter<TInputImage, TOutputImage>
+{
+public:
+  /**
+   * Basic house keeping.
+   */
+  typedef CityBlockDistanceImageFilter Self;
+  typedef ImageToImageFilter<TInputImage, TOutputImage> Superclass;
+  typedef SmartPointer<Self> Pointer;
+  typedef SmartPointer<const Self> ConstPointer;
+  itkNewMacro(Self);
+  itkTypeMacro(CityBlockDistanceImageFilter, ImageToImageFilter);
+  itkStaticConstMacro(ImageDimension, unsigned int, TInputImage::ImageDimension);
+
+  typedef typename TInputImage::PixelType InputPixelType;
+  typedef typename TOutputImage::PixelType OutputPixelType;
+  typedef typename TOutputImage::RegionType OutputImageRegionType;
+
+  /**
+   * Get/Set functions.
+   */
+  itkSetMacro(ForegroundValue, InputPixelType);
+  itkGetMacro(ForegroundValue, InputPixelType);
+  itkSetMacro(MaximumDistance, OutputPixelType);
+  itkGetMacro(MaximumDistance, OutputPixelType);
+  itkSetMacro(DistanceToBackground, bool);
+  itkGetMacro(DistanceToBackground, bool);
+  itkBooleanMacro(DistanceToBackground);
+
+protected:
+  /**
+   * Constructor.
+   */
+  CityBlockDistanceImageFilter();
+  /**
+   * Destructor.
+   */
+  virtual ~CityBlockDistanceImageFilter() {}
+  /**
+   * The distances depend on the whole image.
+   */
+  virtual void GenerateInputRequestedRegion();
+  virtual void EnlargeOutputRequestedRegion(DataObject *output);
+  /**
+   * Initialises the distances, then scans along each axis.
+   */
+  virtual void GenerateData();
+  void PrintSelf(std::ostream& os, Indent indent) const;
+
+private:
+  /**
+   * Prohibited copy and assingment.
+   */
+  CityBlockDistanceImageFilter(const Self&);
+  void operator=(const Self&);
+
+  /**
+   * The lines along Axis, starting in each of Regions, one region per thread.
+   */
+  struct ScanThreadStruct
+  {
+    Self*                              Filter;
+    TOutputImage*                      Output;
+    unsigned int                       Axis;
+    std::vector<OutputImageRegionType> Regions;
+  };
+
+  static ITK_THREAD_RETURN_TYPE ScanThreaderCallback(void *arg);
+
+  /**
+   * Scans forwards, then backwards, along the lines along axis that start in region.
+   */
+  void ScanLines(TOutputImage* output, unsigned int axis, const OutputImageRegionType& region);
+
+  InputPixelType  m_ForegroundValue;
+  OutputPixelType m_MaximumDistance;
+  bool            m_DistanceToBackground;
+};
+
+}
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkCityBlockDistanceImageFilter.txx"
+#endif
+
+#endif
@@ -0,0 +1,198 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#ifndef itkCityBlockDistanceImageFilter_txx
+#define itkCityBlockDistanceImageFilter_txx
+
+#include "itkCityBlockDistanceImageFilter.h"
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionConstIteratorWithIndex.h>
+#include <itkImageRegionIterator.h>
+#include <itkNumericTraits.h>
+#include <algorithm>
+
+namespace itk
+{
+
+template <class TInputImage, class TOutputImage>
+CityBlockDistanceImageFilter<TInputImage, TOutputImage>
+::CityBlockDistanceImageFilter()
+{
+  m_ForegroundValue = 1;
+  m_MaximumDistance = NumericTraits<OutputPixelType>::max();
+  m_DistanceToBackground = false;
+}
+
+template <class TInputImage, class TOutputImage>
+void
+CityBlockDistanceImageFilter<TInputImage, TOutputImage>
+::GenerateInputRequestedRegion()
+{
+  Superclass::GenerateInputRequestedRegion();
+
+  TInputImage* input = const_cast<TInputImage*>(this->GetInput());
+  if (input)
+  {
+    input->SetRequestedRegionToLargestPossibleRegion();
+  }
+}
+
+template <class TInputImage, class TOutputImage>
+void
+CityBlockDistanceImageFilter<TInputImage, TOutputImage>
+::EnlargeOutputRequestedRegion(DataObject *output)
+{
+  Superclass::EnlargeOutputRequestedRegion(output);
+  output->SetRequestedRegionToLargestPossibleRegion();
+}
+
+template <class TInputImage, class TOutputImage>
+void
+CityBlockDistanceImageFilter<TInputImage, TOutputImage>
+::GenerateData()
+{
+  const TInputImage* input = this->GetInput();
+  TOutputImage* output = this->GetOutput();
+
+  output->SetBufferedRegion(output->GetRequestedRegion());
+  output->Allocate();
+
+  OutputImageRegionType region = output->GetBufferedRegion();
+
+  // Zero on the voxels the distance is measured to, and as far as we care to go elsewhere.
+  ImageRegionConstIterator<TInputImage> inputIterator(input, region);
+  ImageRegionIterator<TOutputImage> outputIterator(output, region);
+  for (inputIterator.GoToBegin(), outputIterator.GoToBegin(); !inputIterator.IsAtEnd(); ++inputIterator, ++outputIterator)
+  {
+    bool isForeground = inputIterator.Get() == m_ForegroundValue;
+    outputIterator.Set(isForeground != m_DistanceToBackground ? 0 : m_MaximumDistance);
+  }
+
+  // The city block distance is the sum of the distances along each axis,
+  // so it is found exactly by taking the minimum along one axis at a time.
+  for (unsigned int axis = 0; axis < ImageDimension; axis++)
+  {
+    OutputImageRegionType lineStarts = region;
+    lineStarts.SetSize(axis, 1);
+
+    // Share the lines between threads by splitting their starts along the longest other axis.
+    unsigned int splitAxis = axis;
+    for (unsigned int i = 0; i < ImageDimension; i++)
+    {
+      if (i != axis && (splitAxis == axis || lineStarts.GetSize(i) > lineStarts.GetSize(splitAxis)))
+      {
+        splitAxis = i;
+      }
+    }
+
+    ScanThreadStruct str;
+    str.Filter = this;
+    str.Output = output;
+    str.Axis = axis;
+
+    SizeValueType numberOfRegions = 1;
+    if (splitAxis != axis)
+    {
+      numberOfRegions = std::min(static_cast<SizeValueType>(this->GetNumberOfThreads()), lineStarts.GetSize(splitAxis));
+    }
+
+    for (SizeValueType i = 0; i < numberOfRegions; i++)
+    {
+      OutputImageRegionType part = lineStarts;
+      if (splitAxis != axis)
+      {
+        SizeValueType begin = i * lineStarts.GetSize(splitAxis) / numberOfRegions;
+        SizeValueType end = (i + 1) * lineStarts.GetSize(splitAxis) / numberOfRegions;
+        part.SetIndex(splitAxis, lineStarts.GetIndex(splitAxis) + begin);
+        part.SetSize(splitAxis, end - begin);
+      }
+      str.Regions.push_back(part);
+    }
+
+    this->GetMultiThreader()->SetNumberOfThreads(numberOfRegions);
+    this->GetMultiThreader()->SetSingleMethod(this->ScanThreaderCallback, &str);
+    this->GetMultiThreader()->SingleMethodExecute();
+  }
+}
+
+template <class TInputImage, class TOutputImage>
+ITK_THREAD_RETURN_TYPE
+CityBlockDistanceImageFilter<TInputImage, TOutputImage>
+::ScanThreaderCallback(void *arg)
+{
+  ThreadIdType threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  ScanThreadStruct *str = (ScanThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  if (threadId < str->Regions.size())
+  {
+    str->Filter->ScanLines(str->Output, str->Axis, str->Regions[threadId]);
+  }
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template <class TInputImage, class TOutputImage>
+void
+CityBlockDistanceImageFilter<TInputImage, TOutputImage>
+::ScanLines(TOutputImage* output, unsigned int axis, const OutputImageRegionType& region)
+{
+  OutputPixelType* buffer = output->GetBufferPointer();
+  OffsetValueType stride = output->GetOffsetTable()[axis];
+  OffsetValueType length = output->GetBufferedRegion().GetSize(axis);
+
+  // Just outside the image is background, so it only counts when measuring the distance to background.
+  OutputPixelType outside = m_DistanceToBackground ? 0 : m_MaximumDistance;
+
+  ImageRegionConstIteratorWithIndex<TOutputImage> iterator(output, region);
+  for (iterator.GoToBegin(); !iterator.IsAtEnd(); ++iterator)
+  {
+    OutputPixelType* line = buffer + output->ComputeOffset(iterator.GetIndex());
+
+    OutputPixelType previous = outside;
+    for (OffsetValueType i = 0; i < length; i++)
+    {
+      OutputPixelType& value = line[i * stride];
+      if (previous < m_MaximumDistance && previous + 1 < value)
+      {
+        value = previous + 1;
+      }
+      previous = value;
+    }
+
+    previous = outside;
+    for (OffsetValueType i = length - 1; i >= 0; i--)
+    {
+      OutputPixelType& value = line[i * stride];
+      if (previous < m_MaximumDistance && previous + 1 < value)
+      {
+        value = previous + 1;
+      }
+      previous = value;
+    }
+  }
+}
+
+template <class TInputImage, class TOutputImage>
+void
+CityBlockDistanceImageFilter<TInputImage, TOutputImage>
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "ForegroundValue: " << static_cast<typename NumericTraits<InputPixelType>::PrintType>(m_ForegroundValue) << std::endl;
+  os << indent << "MaximumDistance: " << static_cast<typename NumericTraits<OutputPixelType>::PrintType>(m_MaximumDistance) << std::endl;
+  os << indent << "DistanceToBackground: " << m_DistanceToBackground << std::endl;
+}
+
+}
+
+#endif
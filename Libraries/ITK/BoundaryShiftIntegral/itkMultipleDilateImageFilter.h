@@ -45,6 +45,13 @@ public:
    */
   itkSetMacro(NumberOfDilations, unsigned int);
   itkGetMacro(NumberOfDilations, unsigned int);
+  /**
+   * If true, the default, the dilations are done in one pass, by thresholding the city block distance
+   * to the dilate value, which gives the same image as repeating a unit dilation with the cross structuring element.
+   */
+  itkSetMacro(UseDistanceMap, bool);
+  itkGetMacro(UseDistanceMap, bool);
+  itkBooleanMacro(UseDistanceMap);
   itkSetMacro(DilateValue, typename TImageType::PixelType); 
   itkGetMacro(DilateValue, typename TImageType::PixelType); 
 
@@ -57,10 +64,19 @@ protected:
    * Destructor. 
    */
   virtual ~MultipleDilateImageFilter() {}
+  /**
+   * The whole image is needed to find the distances.
+   */
+  virtual void GenerateInputRequestedRegion();
+  virtual void EnlargeOutputRequestedRegion(DataObject *output);
   /**
    * Dilate the image multiple times. 
    */
   void GenerateData();
+  /**
+   * Dilate the image in one pass, by thresholding the distance map.
+   */
+  void GenerateDataUsingDistanceMap();
   /**
    * A cross structuring element is used in the dilation.  
    */
@@ -95,6 +111,10 @@ protected:
    * The value in the image to ignore/erode.
    */
   typename TImageType::PixelType m_BackgroundValue;
+  /**
+   * Use a distance map rather than repeated dilations.
+   */
+  bool m_UseDistanceMap;
   
 private:
   /**
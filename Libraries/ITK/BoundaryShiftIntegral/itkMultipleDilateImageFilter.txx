@@ -16,6 +16,11 @@
 #define ITKMULTIPLEDILATEIMAGEFILTER_TXX_
 
 #include <itkImageDuplicator.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionIterator.h>
+#include <itkNumericTraits.h>
+#include "itkCityBlockDistanceImageFilter.h"
+#include <algorithm>
 
 namespace itk 
 {
@@ -32,6 +37,30 @@ MultipleDilateImageFilter<TImageType>
   this->m_DilateImageFilter->SetBoundaryToForeground(false);
   this->m_DilateValue = 1;
   this->m_BackgroundValue = 0;
+  this->m_UseDistanceMap = true;
+}
+
+template <class TImageType>
+void
+MultipleDilateImageFilter<TImageType>
+::GenerateInputRequestedRegion()
+{
+  Superclass::GenerateInputRequestedRegion();
+
+  TImageType* input = const_cast<TImageType*>(this->GetInput());
+  if (input)
+  {
+    input->SetRequestedRegionToLargestPossibleRegion();
+  }
+}
+
+template <class TImageType>
+void
+MultipleDilateImageFilter<TImageType>
+::EnlargeOutputRequestedRegion(DataObject *output)
+{
+  Superclass::EnlargeOutputRequestedRegion(output);
+  output->SetRequestedRegionToLargestPossibleRegion();
 }
 
 template <class TImageType>
@@ -39,6 +68,12 @@ void
 MultipleDilateImageFilter<TImageType>
 ::GenerateData()
 {
+  if (this->m_UseDistanceMap)
+  {
+    this->GenerateDataUsingDistanceMap();
+    return;
+  }
+
   this->m_DilateImageFilter->SetDilateValue(this->m_DilateValue);
   this->m_DilateImageFilter->SetBackgroundValue(this->m_BackgroundValue);
   
@@ -64,6 +99,46 @@ MultipleDilateImageFilter<TImageType>
   this->GraftOutput(this->m_DilatedImage);
 }
 
+template <class TImageType>
+void
+MultipleDilateImageFilter<TImageType>
+::GenerateDataUsingDistanceMap()
+{
+  typedef CityBlockDistanceImageFilter<TImageType> DistanceFilterType;
+  typedef typename DistanceFilterType::OutputImageType DistanceImageType;
+  typedef typename DistanceImageType::PixelType DistanceType;
+
+  const TImageType* input = this->GetInput();
+
+  // Each dilation with the cross adds the voxels one step further from the dilate value.
+  typename DistanceFilterType::Pointer distanceFilter = DistanceFilterType::New();
+  distanceFilter->SetInput(input);
+  distanceFilter->SetForegroundValue(this->m_DilateValue);
+  distanceFilter->SetMaximumDistance(static_cast<DistanceType>(std::min<unsigned long>(this->m_NumberOfDilations, NumericTraits<DistanceType>::max() - 1) + 1));
+  distanceFilter->SetNumberOfThreads(this->GetNumberOfThreads());
+  distanceFilter->Update();
+
+  this->AllocateOutputs();
+  TImageType* output = this->GetOutput();
+
+  ImageRegionConstIterator<TImageType> inputIterator(input, output->GetRequestedRegion());
+  ImageRegionConstIterator<DistanceImageType> distanceIterator(distanceFilter->GetOutput(), output->GetRequestedRegion());
+  ImageRegionIterator<TImageType> outputIterator(output, output->GetRequestedRegion());
+  for (inputIterator.GoToBegin(), distanceIterator.GoToBegin(), outputIterator.GoToBegin();
+       !outputIterator.IsAtEnd();
+       ++inputIterator, ++distanceIterator, ++outputIterator)
+  {
+    if (distanceIterator.Get() <= this->m_NumberOfDilations)
+    {
+      outputIterator.Set(this->m_DilateValue);
+    }
+    else
+    {
+      outputIterator.Set(inputIterator.Get());
+    }
+  }
+}
+
 
 }
 
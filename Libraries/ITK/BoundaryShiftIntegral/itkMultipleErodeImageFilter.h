@@ -44,6 +44,13 @@ public:
    */
   itkSetMacro(NumberOfErosions, unsigned int);
   itkGetMacro(NumberOfErosions, unsigned int);
+  /**
+   * If true, the default, the erosions are done in one pass, by thresholding the city block distance
+   * to the background, which gives the same image as repeating a unit erosion with the cross structuring element.
+   */
+  itkSetMacro(UseDistanceMap, bool);
+  itkGetMacro(UseDistanceMap, bool);
+  itkBooleanMacro(UseDistanceMap);
 
 protected:
   /**
@@ -54,10 +61,19 @@ protected:
    * Destructor. 
    */
   virtual ~MultipleErodeImageFilter() {}
+  /**
+   * The whole image is needed to find the distances.
+   */
+  virtual void GenerateInputRequestedRegion();
+  virtual void EnlargeOutputRequestedRegion(DataObject *output);
   /**
    * Erode the image multiple times. 
    */
   void GenerateData();
+  /**
+   * Erode the image in one pass, by thresholding the distance map.
+   */
+  void GenerateDataUsingDistanceMap();
   /**
    * A cross structuring element is used in the erosion.  
    */
@@ -92,6 +108,10 @@ protected:
    * The value in the image to ignore/erode.
    */
   typename TImageType::PixelType m_BackgroundValue;
+  /**
+   * Use a distance map rather than repeated erosions.
+   */
+  bool m_UseDistanceMap;
   
 private:
   /**
@@ -16,6 +16,11 @@
 #define ITKMULTIPLEERODEIMAGEFILTER_TXX_
 
 #include <itkImageDuplicator.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionIterator.h>
+#include <itkNumericTraits.h>
+#include "itkCityBlockDistanceImageFilter.h"
+#include <algorithm>
 
 namespace itk 
 {
@@ -32,6 +37,30 @@ MultipleErodeImageFilter<TImageType>
   this->m_ErodeImageFilter->SetBoundaryToForeground(false);
   this->m_ErodeValue = 1;
   this->m_BackgroundValue = 0;
+  this->m_UseDistanceMap = true;
+}
+
+template <class TImageType>
+void
+MultipleErodeImageFilter<TImageType>
+::GenerateInputRequestedRegion()
+{
+  Superclass::GenerateInputRequestedRegion();
+
+  TImageType* input = const_cast<TImageType*>(this->GetInput());
+  if (input)
+  {
+    input->SetRequestedRegionToLargestPossibleRegion();
+  }
+}
+
+template <class TImageType>
+void
+MultipleErodeImageFilter<TImageType>
+::EnlargeOutputRequestedRegion(DataObject *output)
+{
+  Superclass::EnlargeOutputRequestedRegion(output);
+  output->SetRequestedRegionToLargestPossibleRegion();
 }
 
 template <class TImageType>
@@ -39,6 +68,12 @@ void
 MultipleErodeImageFilter<TImageType>
 ::GenerateData()
 {
+  if (this->m_UseDistanceMap)
+  {
+    this->GenerateDataUsingDistanceMap();
+    return;
+  }
+
   this->m_ErodeImageFilter->SetErodeValue(this->m_ErodeValue);
   this->m_ErodeImageFilter->SetBackgroundValue(this->m_BackgroundValue);
   
@@ -64,6 +99,48 @@ MultipleErodeImageFilter<TImageType>
   this->GraftOutput(this->m_ErodedImage);
 }
 
+template <class TImageType>
+void
+MultipleErodeImageFilter<TImageType>
+::GenerateDataUsingDistanceMap()
+{
+  typedef CityBlockDistanceImageFilter<TImageType> DistanceFilterType;
+  typedef typename DistanceFilterType::OutputImageType DistanceImageType;
+  typedef typename DistanceImageType::PixelType DistanceType;
+
+  const TImageType* input = this->GetInput();
+
+  // Each erosion with the cross removes the voxels one step closer to the background,
+  // where the voxels just outside the image count as background.
+  typename DistanceFilterType::Pointer distanceFilter = DistanceFilterType::New();
+  distanceFilter->SetInput(input);
+  distanceFilter->SetForegroundValue(this->m_ErodeValue);
+  distanceFilter->DistanceToBackgroundOn();
+  distanceFilter->SetMaximumDistance(static_cast<DistanceType>(std::min<unsigned long>(this->m_NumberOfErosions, NumericTraits<DistanceType>::max() - 1) + 1));
+  distanceFilter->SetNumberOfThreads(this->GetNumberOfThreads());
+  distanceFilter->Update();
+
+  this->AllocateOutputs();
+  TImageType* output = this->GetOutput();
+
+  ImageRegionConstIterator<TImageType> inputIterator(input, output->GetRequestedRegion());
+  ImageRegionConstIterator<DistanceImageType> distanceIterator(distanceFilter->GetOutput(), output->GetRequestedRegion());
+  ImageRegionIterator<TImageType> outputIterator(output, output->GetRequestedRegion());
+  for (inputIterator.GoToBegin(), distanceIterator.GoToBegin(), outputIterator.GoToBegin();
+       !outputIterator.IsAtEnd();
+       ++inputIterator, ++distanceIterator, ++outputIterator)
+  {
+    if (inputIterator.Get() == this->m_ErodeValue && distanceIterator.Get() <= this->m_NumberOfErosions)
+    {
+      outputIterator.Set(this->m_BackgroundValue);
+    }
+    else
+    {
+      outputIterator.Set(inputIterator.Get());
+    }
+  }
+}
+
 }
 
 #endif /*ITKMULTIPLEERODEIMAGEFILTER_TXX_*/
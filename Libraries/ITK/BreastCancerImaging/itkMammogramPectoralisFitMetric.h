@@ -111,6 +111,14 @@ public:
   /// Set the minuimum pectoral area in mm^2
   void SetMinimumPectoralArea( double minPecArea ) { m_MinimumPectoralArea = minPecArea; }
 
+  /// Set the number of threads of the template distance transform, or 0 for the ITK default
+  itkSetMacro( NumberOfThreads, unsigned int );
+  itkGetConstMacro( NumberOfThreads, unsigned int );
+
+  /** Create a new metric with the same image, mask and settings but
+   * its own template, so that the two can be evaluated concurrently. */
+  Pointer Duplicate( void ) const;
+
   /** Get the template image. */
   itkGetObjectMacro( ImTemplate, TemplateImageType );
 
@@ -171,6 +179,8 @@ protected:
   double m_MinimumPectoralArea;
   double m_TemplatePixelAreaInMM;
 
+  unsigned int m_NumberOfThreads;
+
   InputImageRegionType   m_ImRegion;
   InputImageSpacingType  m_ImSpacing;
   InputImagePointType    m_ImOrigin;
@@ -39,6 +39,8 @@ MammogramPectoralisFitMetric<TInputImage>
   m_MinimumPectoralArea = 0.;
   m_TemplatePixelAreaInMM = 1.;
 
+  m_NumberOfThreads = 0;
+
   m_InputImage = 0;
   m_Mask = 0;
   m_ImTemplate = 0;
@@ -56,6 +58,37 @@ MammogramPectoralisFitMetric<TInputImage>
 }
 
 
+/* -----------------------------------------------------------------------
+   Duplicate()
+   ----------------------------------------------------------------------- */
+
+template <class TInputImage>
+typename MammogramPectoralisFitMetric<TInputImage>::Pointer
+MammogramPectoralisFitMetric<TInputImage>
+::Duplicate( void ) const
+{
+  Pointer metric = Self::New();
+
+  metric->SetDebug( this->GetDebug() );
+
+  metric->m_flgOptimiseSSD = m_flgOptimiseSSD;
+  metric->m_MinimumPectoralArea = m_MinimumPectoralArea;
+  metric->m_NumberOfThreads = m_NumberOfThreads;
+
+  if ( m_InputImage )
+  {
+    metric->SetInputImage( m_InputImage );
+  }
+
+  // The mask region has already been found so is copied rather than recomputed
+
+  metric->m_Mask = m_Mask;
+  metric->m_MaskRegion = m_MaskRegion;
+
+  return metric;
+}
+
+
 /* -----------------------------------------------------------------------
    SetInputImage()
    ----------------------------------------------------------------------- */
@@ -443,6 +476,11 @@ MammogramPectoralisFitMetric<TInputImage>
   distanceTransform->UseImageSpacingOn();
   distanceTransform->SquaredDistanceOff();
 
+  if ( m_NumberOfThreads )
+  {
+    distanceTransform->SetNumberOfThreads( m_NumberOfThreads );
+  }
+
   distanceTransform->UpdateLargestPossibleRegion();
 
   TemplateImagePointer imDistTrans = distanceTransform->GetOutput();
@@ -678,7 +716,6 @@ MammogramPectoralisFitMetric<TInputImage>
   }
     
 
-  double value;
   double nPixels, nPecPixels;
   double imMean, imStdDev;
   double tMean, tStdDev;
@@ -753,59 +790,62 @@ MammogramPectoralisFitMetric<TInputImage>
   IteratorConstType itPecRegion(   m_InputImage, templateRegion );
   TemplateIteratorType itTemplate( m_ImTemplate, templateRegion );
 
-  // Compute the mean image intensity for this region
-  
-  imMean = 0;
- 
+  // Compute the image mean, standard deviation and cross correlation
+  // in a single pass, from running sums of the intensities relative
+  // to the first one, which keeps the sums small
+
+  double imShift = 0.;
+
+  double nSummed = 0.;
+  double sumI = 0., sumII = 0., sumT = 0., sumIT = 0.;
+
+  double imValue, tValue;
+
   for ( itPecRegion.GoToBegin(), itTemplate.GoToBegin();
         ! itPecRegion.IsAtEnd();
         ++itPecRegion, ++itTemplate )
   {
     if ( (! itMask) || itMask->Get() )
     {
-      if ( itTemplate.Get() )
+      tValue = itTemplate.Get();
+
+      if ( tValue )
       {
-        imMean += itPecRegion.Get();
+        if ( nSummed == 0 )
+        {
+          imShift = static_cast<double>( itPecRegion.Get() );
+        }
+
+        imValue = static_cast<double>( itPecRegion.Get() ) - imShift;
+
+        nSummed++;
+        sumI  += imValue;
+        sumII += imValue*imValue;
+        sumT  += tValue;
+        sumIT += imValue*tValue;
       }
     }
-      
+
     if ( itMask )
     {
       ++(*itMask);
     }
   }
-    
-  imMean /= nPixels;
 
-  // Compute the standard deviation for this region
-
-  if ( m_Mask )
+  if ( itMask )
   {
-    itMask->GoToBegin();
+    delete itMask;
   }
 
-  imStdDev = 0;
-   
-  for ( itPecRegion.GoToBegin(), itTemplate.GoToBegin();
-        ! itPecRegion.IsAtEnd();
-        ++itPecRegion, ++itTemplate )
-  {
-    if ( (! itMask) || itMask->Get() )
-    {
-      if ( itTemplate.Get() )
-      {
-        value = static_cast<double>( itPecRegion.Get() ) - imMean;
-        imStdDev += value*value;
-      }
-    }
-      
-    if ( itMask )
-    {
-      ++(*itMask);
-    }
-  }
-    
-  if ( imStdDev == 0 )
+  // The mean is the sum of the intensities over nPixels, which may not
+  // be the number summed, nSummed, if there is a mask. Here it is
+  // relative to the shift, which cancels in the differences from it.
+
+  imMean = ( sumI + imShift*( nSummed - nPixels ) )/nPixels;
+
+  imStdDev = sumII - 2.*imMean*sumI + nSummed*imMean*imMean;
+
+  if ( imStdDev <= 0 )
   {
     if ( this->GetDebug() )
     {
@@ -817,40 +857,7 @@ MammogramPectoralisFitMetric<TInputImage>
     
   imStdDev = sqrt( imStdDev/nPixels );
 
-
-  // Compute the cross correlation
-
-  if ( m_Mask )
-  {
-    itMask->GoToBegin();
-  }
-
-  ncc = 0;
-
-  for ( itPecRegion.GoToBegin(), itTemplate.GoToBegin();
-        ! itPecRegion.IsAtEnd();
-        ++itPecRegion, ++itTemplate )
-  {
-    if ( (! itMask) || itMask->Get() )
-    {
-      if ( itTemplate.Get() )
-      {
-        ncc += 
-          ( static_cast<double>( itPecRegion.Get() ) - imMean )
-          *( static_cast<double>( itTemplate.Get() ) - tMean );
-      }
-    }
-
-    if ( itMask )
-    {
-      ++(*itMask);
-    }
-  }
-
-  if ( itMask )
-  {
-    delete itMask;
-  }
+  ncc = sumIT - tMean*sumI - imMean*sumT + nSummed*imMean*tMean;
 
   ncc /= nPixels*imStdDev*tStdDev;
 
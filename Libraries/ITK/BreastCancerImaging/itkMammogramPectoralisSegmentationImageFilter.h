@@ -23,6 +23,12 @@
 #include <itkImageLinearIteratorWithIndex.h>
 #include <itkMammogramLeftOrRightSideCalculator.h>
 #include <itkMammogramPectoralisFitMetric.h>
+#include <itkMultiThreader.h>
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace itk {
   
@@ -138,6 +144,16 @@ public:
     m_BreastSide = breastSide;
   }
 
+  /** Set the spacing, in pixels, of the first grid of pectoral intercepts
+   * searched, which is halved around the best ones until every pixel is
+   * reached. The default of 1 searches every intercept. */
+  void SetCoarseSearchStep( unsigned int step ) { m_CoarseSearchStep = step; }
+  unsigned int GetCoarseSearchStep( void ) { return m_CoarseSearchStep; }
+
+  /// Set the number of best pectoral intercepts that are refined at each finer spacing
+  void SetNumberOfSearchCandidates( unsigned int n ) { m_NumberOfSearchCandidates = n; }
+  unsigned int GetNumberOfSearchCandidates( void ) { return m_NumberOfSearchCandidates; }
+
   TemplateImagePointer GetTemplateImage( void ) { return m_Template; }
 
 protected:
@@ -151,6 +167,9 @@ protected:
 
   BreastSideType m_BreastSide;
 
+  unsigned int m_CoarseSearchStep;
+  unsigned int m_NumberOfSearchCandidates;
+
   InputImagePointer m_Image;
   MaskImagePointer m_Mask;
   TemplateImagePointer m_Template;
@@ -171,7 +190,8 @@ protected:
   // Override since the filter produces the entire dataset
   void EnlargeOutputRequestedRegion(DataObject *output);
 
-  // Run and exhaustive search over a region of interest
+  // Run a coarse to fine search over a region of interest, which is
+  // exhaustive if the coarse search step is 1
   void ExhaustiveSearch( InputImageIndexType pecInterceptStart, 
                          InputImageIndexType pecInterceptEnd, 
                          typename FitMetricType::Pointer &metric,
@@ -180,10 +200,32 @@ protected:
                          typename FitMetricType::ParametersType &bestParameters );
 
 
+  // The cost of each pectoral intercept searched, in (y, x) order
+  typedef std::map< std::pair< IndexValueType, IndexValueType >, double > InterceptCostMapType;
+
+  // Compute the costs of the intercepts, in parallel, adding them to the map
+  void ScoreIntercepts( const std::vector< InputImageIndexType > &intercepts,
+                        std::vector< typename FitMetricType::Pointer > &metrics,
+                        InputImagePointer &imPipelineConnector,
+                        InterceptCostMapType &costs );
+
+
 private:
 
   MammogramPectoralisSegmentationImageFilter(const Self&); //purposely not implemented
   void operator=(const Self&); //purposely not implemented
+
+  // The intercepts shared between threads, each with its own metric
+  struct SearchThreadStruct
+  {
+    std::vector< typename FitMetricType::Pointer > Metrics;
+    InputImagePointer                              Image;
+    std::vector< InputImageIndexType >             Intercepts;
+    std::vector< double >                          Costs;
+    std::vector< std::string >                     ErrorMessages;
+  };
+
+  static ITK_THREAD_RETURN_TYPE SearchThreaderCallback( void *arg );
 };
 
 } // end namespace itk
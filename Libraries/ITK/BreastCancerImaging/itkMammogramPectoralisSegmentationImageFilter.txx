@@ -21,7 +21,9 @@
 
 #include <vnl/vnl_double_2x2.h>
 
+#include <algorithm>
 #include <iomanip>
+#include <set>
 #include <itkUCLMacro.h>
 
 #include <itkCommand.h>
@@ -134,6 +136,9 @@ MammogramPectoralisSegmentationImageFilter<TInputImage,TOutputImage>
 
   m_BreastSide = LeftOrRightSideCalculatorType::UNKNOWN_BREAST_SIDE;
 
+  m_CoarseSearchStep = 1;
+  m_NumberOfSearchCandidates = 8;
+
   this->SetNumberOfRequiredInputs( 1 );
   this->SetNumberOfRequiredOutputs( 1 );
 
@@ -283,54 +288,157 @@ MammogramPectoralisSegmentationImageFilter<TInputImage,TOutputImage>
 {
   bool flgFirstIteration = true;
 
-  double cost = -1., bestCost = -1.;
+  double bestCost = -1.;
 
   InputImageIndexType pecIntercept;
   InputImagePointType pecInterceptInMM;
 
   metric->SetInputImage( imPipelineConnector );
 
-  for ( pecIntercept[1] = pecInterceptStart[1]; 
-        pecIntercept[1] < pecInterceptEnd[1]; 
-        pecIntercept[1]++ )
+  // Each thread needs its own metric, as the template is generated in it
+
+  unsigned int nThreads = this->GetNumberOfThreads();
+
+  if ( nThreads < 1 )
   {
+    nThreads = 1;
+  }
+
+  std::vector< typename FitMetricType::Pointer > metrics;
+  metrics.push_back( metric );
 
-    if ( m_flgVerbose && ( ! this->GetDebug() ) )
+  unsigned int nMetricThreads = metric->GetNumberOfThreads();
+
+  if ( nThreads > 1 )
+  {
+    metric->SetNumberOfThreads( 1 );
+
+    for ( unsigned int i=1; i<nThreads; i++ )
     {
-      std::cout << 100*( pecIntercept[1] - pecInterceptStart[1] ) 
-        / (pecInterceptEnd[1] - pecInterceptStart[1] ) << " ";
-      std::cout.flush();
+      metrics.push_back( metric->Duplicate() );
     }
+  }
+
+  // Score the intercepts on a coarse grid
+
+  IndexValueType step = ( m_CoarseSearchStep > 1 ) ? m_CoarseSearchStep : 1;
+
+  InterceptCostMapType costs;
+  std::vector< InputImageIndexType > intercepts;
 
+  for ( pecIntercept[1] = pecInterceptStart[1]; 
+        pecIntercept[1] < pecInterceptEnd[1]; 
+        pecIntercept[1] += step )
+  {
     for ( pecIntercept[0] = pecInterceptStart[0]; 
           ( pecIntercept[0] < pecInterceptEnd[0] ) 
             && ( pecIntercept[0] < pecIntercept[1] ); 
-          pecIntercept[0]++ )
+          pecIntercept[0] += step )
     {
-      imPipelineConnector->TransformIndexToPhysicalPoint( pecIntercept,
-                                                          pecInterceptInMM );
+      intercepts.push_back( pecIntercept );
+    }
+  }
+
+  if ( m_flgVerbose )
+  {
+    std::cout << "Searching " << intercepts.size() << " pectoral intercepts at a spacing of "
+              << step << " pixels" << std::endl;
+  }
 
-      // Compute the cost function
+  ScoreIntercepts( intercepts, metrics, imPipelineConnector, costs );
 
-      cost = metric->GetValueAtPecIntercept( pecInterceptInMM );
+  // Then halve the spacing around the best intercepts until every pixel is reached
 
-      if ( flgFirstIteration || ( cost > bestCost ) )
-      {
-        bestPecInterceptInMM = pecInterceptInMM;
-        bestCost = cost;
-        flgFirstIteration = false;
-      }
+  while ( step > 1 )
+  {
+    step /= 2;
 
-      if ( this->GetDebug() )
+    std::vector< std::pair< double, std::pair< IndexValueType, IndexValueType > > > ranked;
+
+    typename InterceptCostMapType::const_iterator itCost;
+
+    for ( itCost = costs.begin(); itCost != costs.end(); ++itCost )
+    {
+      ranked.push_back( std::make_pair( -itCost->second, itCost->first ) );
+    }
+
+    size_t nCandidates = std::min( ranked.size(), static_cast<size_t>( m_NumberOfSearchCandidates ) );
+
+    std::partial_sort( ranked.begin(), ranked.begin() + nCandidates, ranked.end() );
+
+    std::set< std::pair< IndexValueType, IndexValueType > > neighbours;
+
+    for ( size_t i=0; i<nCandidates; i++ )
+    {
+      for ( IndexValueType dy=-step; dy<=step; dy+=step )
       {
-        std::cout << "Pec intercept: " << std::setw(12) 
-                  << std::left << pecInterceptInMM << std::right
-                  << " Cost: " << std::setw(12) << cost 
-                  << " Best cost: " << std::setw(12) << bestCost 
-                  << ", " << std::setw(18) << std::left << bestPecInterceptInMM
-                  << std::right << std::endl;
+        for ( IndexValueType dx=-step; dx<=step; dx+=step )
+        {
+          pecIntercept[1] = ranked[i].second.first + dy;
+          pecIntercept[0] = ranked[i].second.second + dx;
+
+          if ( ( pecIntercept[1] >= pecInterceptStart[1] ) && ( pecIntercept[1] < pecInterceptEnd[1] ) &&
+               ( pecIntercept[0] >= pecInterceptStart[0] ) && ( pecIntercept[0] < pecInterceptEnd[0] ) &&
+               ( pecIntercept[0] < pecIntercept[1] ) &&
+               ( costs.find( std::make_pair( pecIntercept[1], pecIntercept[0] ) ) == costs.end() ) )
+          {
+            neighbours.insert( std::make_pair( pecIntercept[1], pecIntercept[0] ) );
+          }
+        }
       }
+    }
 
+    intercepts.clear();
+
+    typename std::set< std::pair< IndexValueType, IndexValueType > >::const_iterator itNeighbour;
+
+    for ( itNeighbour = neighbours.begin(); itNeighbour != neighbours.end(); ++itNeighbour )
+    {
+      pecIntercept[1] = itNeighbour->first;
+      pecIntercept[0] = itNeighbour->second;
+
+      intercepts.push_back( pecIntercept );
+    }
+
+    if ( m_flgVerbose )
+    {
+      std::cout << "Refining " << nCandidates << " pectoral intercepts with " 
+                << intercepts.size() << " more at a spacing of "
+                << step << " pixels" << std::endl;
+    }
+
+    ScoreIntercepts( intercepts, metrics, imPipelineConnector, costs );
+  }
+
+  metric->SetNumberOfThreads( nMetricThreads );
+
+  // The best intercept, taking the first in scan order if several are equal
+
+  typename InterceptCostMapType::const_iterator itCost;
+
+  for ( itCost = costs.begin(); itCost != costs.end(); ++itCost )
+  {
+    pecIntercept[1] = itCost->first.first;
+    pecIntercept[0] = itCost->first.second;
+
+    imPipelineConnector->TransformIndexToPhysicalPoint( pecIntercept,
+                                                        pecInterceptInMM );
+
+    if ( flgFirstIteration || ( itCost->second > bestCost ) )
+    {
+      bestPecInterceptInMM = pecInterceptInMM;
+      bestCost = itCost->second;
+      flgFirstIteration = false;
+    }
+
+    if ( this->GetDebug() )
+    {
+      std::cout << "Pec intercept: " << std::setw(12) 
+                << std::left << pecInterceptInMM << std::right
+                << " Cost: " << std::setw(12) << itCost->second 
+                << " Best cost: " << std::setw(12) << bestCost 
+                << ", " << std::setw(18) << std::left << bestPecInterceptInMM
+                << std::right << std::endl;
     }
   }
 
@@ -343,6 +451,92 @@ MammogramPectoralisSegmentationImageFilter<TInputImage,TOutputImage>
 }
 
 
+/* -----------------------------------------------------------------------
+   ScoreIntercepts()
+   ----------------------------------------------------------------------- */
+
+template <typename TInputImage, typename TOutputImage>
+void 
+MammogramPectoralisSegmentationImageFilter<TInputImage,TOutputImage>
+::ScoreIntercepts( const std::vector< InputImageIndexType > &intercepts,
+                   std::vector< typename FitMetricType::Pointer > &metrics,
+                   InputImagePointer &imPipelineConnector,
+                   InterceptCostMapType &costs )
+{
+  if ( intercepts.empty() )
+  {
+    return;
+  }
+
+  SearchThreadStruct str;
+
+  str.Metrics = metrics;
+  str.Image = imPipelineConnector;
+  str.Intercepts = intercepts;
+  str.Costs.resize( intercepts.size(), -1. );
+
+  unsigned int nThreads = std::min( metrics.size(), intercepts.size() );
+
+  str.ErrorMessages.resize( nThreads );
+
+  this->GetMultiThreader()->SetNumberOfThreads( nThreads );
+  this->GetMultiThreader()->SetSingleMethod( this->SearchThreaderCallback, &str );
+  this->GetMultiThreader()->SingleMethodExecute();
+
+  for ( unsigned int i=0; i<str.ErrorMessages.size(); i++ )
+  {
+    if ( ! str.ErrorMessages[i].empty() )
+    {
+      itkExceptionMacro( << "ScoreIntercepts(): Thread " << i << " failed: " << str.ErrorMessages[i] );
+    }
+  }
+
+  for ( size_t i=0; i<intercepts.size(); i++ )
+  {
+    costs[ std::make_pair( intercepts[i][1], intercepts[i][0] ) ] = str.Costs[i];
+  }
+}
+
+
+/* -----------------------------------------------------------------------
+   SearchThreaderCallback()
+   ----------------------------------------------------------------------- */
+
+template <typename TInputImage, typename TOutputImage>
+ITK_THREAD_RETURN_TYPE
+MammogramPectoralisSegmentationImageFilter<TInputImage,TOutputImage>
+::SearchThreaderCallback( void *arg )
+{
+  ThreadIdType threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  ThreadIdType threadCount = ((MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+  SearchThreadStruct *str = (SearchThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  InputImagePointType pecInterceptInMM;
+
+  try
+  {
+    // Interleave the intercepts as the cost grows with the size of the pectoral muscle
+
+    for ( size_t i=threadId; i<str->Intercepts.size(); i+=threadCount )
+    {
+      str->Image->TransformIndexToPhysicalPoint( str->Intercepts[i], pecInterceptInMM );
+
+      str->Costs[i] = str->Metrics[threadId]->GetValueAtPecIntercept( pecInterceptInMM );
+    }
+  }
+  catch ( ExceptionObject &e )
+  {
+    str->ErrorMessages[threadId] = e.GetDescription();
+  }
+  catch ( std::exception &e )
+  {
+    str->ErrorMessages[threadId] = e.what();
+  }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+
 /* -----------------------------------------------------------------------
    GenerateData()
    ----------------------------------------------------------------------- */
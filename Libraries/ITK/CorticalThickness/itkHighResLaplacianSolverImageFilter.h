@@ -33,6 +33,11 @@ namespace itk
  * The output is an image of voltage potentials, of the same size as the input.
  * In addition, we expose the internal list of pixels used in the high resolution
  * computations, so that subsequent pipeline steps can have access to them.
+ *
+ * The default solver updates the voxels in place, in map order. As for
+ * LaplacianSolverImageFilter, you can choose RED_BLACK_SOR or MULTIGRID,
+ * where the high resolution voxels are numbered into arrays, and solved
+ * on multiple threads. The JACOBI solver is not implemented here.
  * 
  * \ingroup ImageFeatureExtraction */
 template <class TInputImage, typename TScalarType=double>
@@ -97,7 +102,7 @@ protected:
   /** Standard Print Self. */
   virtual void PrintSelf(std::ostream&, Indent) const;
 
-  // The main filter method. Note, single threaded.
+  // The main filter method. Single threaded, unless the solver is RED_BLACK_SOR or MULTIGRID.
   virtual void GenerateData();
   
 private:
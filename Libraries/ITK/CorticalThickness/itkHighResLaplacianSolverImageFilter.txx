@@ -17,6 +17,7 @@
 
 #include "itkHighResLaplacianSolverImageFilter.h"
 #include <niftkConversionUtils.h>
+#include <algorithm>
 #include <cmath>
 
 namespace itk
@@ -572,56 +573,128 @@ HighResLaplacianSolverImageFilter<TInputImage, TScalarType>
   OutputPixelType currentFieldEnergy = 0;
   OutputPixelType previousFieldEnergy = 0;
   
-  this->SetCurrentIteration(0);
-  
-  while (this->GetCurrentIteration() < this->GetMaximumNumberOfIterations() 
-      && epsilonRatio >= this->GetEpsilonConvergenceThreshold())
+  if (this->GetSolver() == Superclass::RED_BLACK_SOR || this->GetSolver() == Superclass::MULTIGRID)
     {
-      currentFieldEnergy = 0;
-      
+      // Number the grey matter voxels, then the boundary voxels, each in map order,
+      // so a neighbour's node number can be found by searching the sorted map indexes.
+      typename Superclass::NodeArrayType unknownKeys;
+      typename Superclass::NodeArrayType boundaryKeys;
+      typename Superclass::VoltageArrayType boundaryVoltages;
+      std::vector<FiniteDifferenceVoxelType*> unknownVoxels;
+
       for (iterator = m_MapOfVoxels.begin(); iterator != m_MapOfVoxels.end(); iterator++)
         {
-          currentPixelValue = 0;
-          currentPixelEnergy = 0;
-          
-          if (!((*iterator).second)->GetBoundary())
+          fdVox = (*iterator).second;
+          if (fdVox->GetBoundary())
+            {
+              boundaryKeys.push_back((*iterator).first);
+              boundaryVoltages.push_back(fdVox->GetValue(0));
+            }
+          else
+            {
+              unknownKeys.push_back((*iterator).first);
+              unknownVoxels.push_back(fdVox);
+            }
+        }
+
+      unsigned long int numberOfUnknowns = unknownKeys.size();
+      unsigned long int unknown;
+      unsigned long int neighbourKey;
+      typename Superclass::NodeArrayType::iterator keyIterator;
+
+      typename Superclass::VoltageArrayType voltages(numberOfUnknowns + boundaryKeys.size());
+      typename Superclass::NodeArrayType neighbours(numberOfUnknowns * 2 * this->Dimension);
+      typename Superclass::GridIndexArrayType gridIndexes(numberOfUnknowns);
+
+      for (unknown = 0; unknown < numberOfUnknowns; unknown++)
+        {
+          fdVox = unknownVoxels[unknown];
+          voltages[unknown] = fdVox->GetValue(0);
+
+          for (dimensionIndex = 0; dimensionIndex < this->Dimension; dimensionIndex++)
             {
+              gridIndexes[unknown][dimensionIndex] = (long int)(fdVox->GetVoxelIndex()[dimensionIndex] + 0.5);
+
+              for (unsigned int i = 0; i < 2; i++)
+                {
+                  // The sanity check above guarantees the neighbour is in the map.
+                  neighbourKey = (i == 0) ? fdVox->GetMinus(dimensionIndex) : fdVox->GetPlus(dimensionIndex);
+                  unsigned long int &node = neighbours[2 * (unknown * this->Dimension + dimensionIndex) + i];
+
+                  keyIterator = std::lower_bound(unknownKeys.begin(), unknownKeys.end(), neighbourKey);
+                  if (keyIterator != unknownKeys.end() && *keyIterator == neighbourKey)
+                    {
+                      node = keyIterator - unknownKeys.begin();
+                    }
+                  else
+                    {
+                      node = numberOfUnknowns + (std::lower_bound(boundaryKeys.begin(), boundaryKeys.end(), neighbourKey) - boundaryKeys.begin());
+                    }
+                }
+            }
+        }
+      std::copy(boundaryVoltages.begin(), boundaryVoltages.end(), voltages.begin() + numberOfUnknowns);
+
+      this->SolveUsingRedBlackOrMultigrid(voltages, neighbours, gridIndexes, virtualSpacing);
+
+      for (unknown = 0; unknown < numberOfUnknowns; unknown++)
+        {
+          unknownVoxels[unknown]->SetValue(0, voltages[unknown]);
+        }
+    }
+  else
+    {
+      this->SetCurrentIteration(0);
+  
+      while (this->GetCurrentIteration() < this->GetMaximumNumberOfIterations() 
+          && epsilonRatio >= this->GetEpsilonConvergenceThreshold())
+        {
+          currentFieldEnergy = 0;
+      
+          for (iterator = m_MapOfVoxels.begin(); iterator != m_MapOfVoxels.end(); iterator++)
+            {
+              currentPixelValue = 0;
+              currentPixelEnergy = 0;
+          
+              if (!((*iterator).second)->GetBoundary())
+                {
               
-              for (dimensionIndex = 0; dimensionIndex < this->Dimension; dimensionIndex++)
-                {                  
-                  currentPixelValuePlus = m_MapOfVoxels[((*iterator).second)->GetPlus(dimensionIndex)]->GetValue(0);
-                  currentPixelValueMinus = m_MapOfVoxels[((*iterator).second)->GetMinus(dimensionIndex)]->GetValue(0);
+                  for (dimensionIndex = 0; dimensionIndex < this->Dimension; dimensionIndex++)
+                    {                  
+                      currentPixelValuePlus = m_MapOfVoxels[((*iterator).second)->GetPlus(dimensionIndex)]->GetValue(0);
+                      currentPixelValueMinus = m_MapOfVoxels[((*iterator).second)->GetMinus(dimensionIndex)]->GetValue(0);
                   
-                  currentPixelValue += (multipliers[dimensionIndex] * (currentPixelValuePlus + currentPixelValueMinus));
+                      currentPixelValue += (multipliers[dimensionIndex] * (currentPixelValuePlus + currentPixelValueMinus));
                   
-                  currentPixelEnergy += (((currentPixelValuePlus - currentPixelValueMinus)/virtualSpacing[dimensionIndex])
-                                        *((currentPixelValuePlus - currentPixelValueMinus)/virtualSpacing[dimensionIndex]));                  
-                }
+                      currentPixelEnergy += (((currentPixelValuePlus - currentPixelValueMinus)/virtualSpacing[dimensionIndex])
+                                            *((currentPixelValuePlus - currentPixelValueMinus)/virtualSpacing[dimensionIndex]));                  
+                    }
               
-              currentPixelValue /= denominator;
-              currentPixelEnergy = sqrt(currentPixelEnergy);
-              currentFieldEnergy += currentPixelEnergy;
+                  currentPixelValue /= denominator;
+                  currentPixelEnergy = sqrt(currentPixelEnergy);
+                  currentFieldEnergy += currentPixelEnergy;
 
-              indexOfCurrentVoxel = ((*iterator).second)->GetVoxelArrayIndex();
-              m_MapOfVoxels[indexOfCurrentVoxel]->SetValue(0, currentPixelValue); 
-            }          
-        }
-      if (this->GetCurrentIteration() != 0)
-        {
-          epsilonRatio = fabs((previousFieldEnergy - currentFieldEnergy) / previousFieldEnergy);  
-        }
+                  indexOfCurrentVoxel = ((*iterator).second)->GetVoxelArrayIndex();
+                  m_MapOfVoxels[indexOfCurrentVoxel]->SetValue(0, currentPixelValue); 
+                }          
+            }
+          if (this->GetCurrentIteration() != 0)
+            {
+              epsilonRatio = fabs((previousFieldEnergy - currentFieldEnergy) / previousFieldEnergy);  
+            }
 
-      niftkitkInfoMacro(<<"GenerateData():[" << this->GetCurrentIteration() \
-          << "] maxIterations=" << this->GetMaximumNumberOfIterations()  \
-          << ", currentFieldEnergy=" << currentFieldEnergy \
-          << ", previousFieldEnergy=" << previousFieldEnergy 
-          << ", epsilonRatio=" << epsilonRatio 
-          << ", epsilonTolerance=" << this->GetEpsilonConvergenceThreshold() \
-          );
-      previousFieldEnergy = currentFieldEnergy;
-      this->SetCurrentIteration(this->GetCurrentIteration() + 1);
+          niftkitkInfoMacro(<<"GenerateData():[" << this->GetCurrentIteration() \
+              << "] maxIterations=" << this->GetMaximumNumberOfIterations()  \
+              << ", currentFieldEnergy=" << currentFieldEnergy \
+              << ", previousFieldEnergy=" << previousFieldEnergy 
+              << ", epsilonRatio=" << epsilonRatio 
+              << ", epsilonTolerance=" << this->GetEpsilonConvergenceThreshold() \
+              );
+          previousFieldEnergy = currentFieldEnergy;
+          this->SetCurrentIteration(this->GetCurrentIteration() + 1);
+        }
     }
-    
+
   /**
    * Sanity check, that all values are:  lowVoltage <= val <= highVoltage.
    * Check all pointers for non-boundary are connected, as the next stage relies on this.
@@ -80,6 +80,10 @@ class ITK_EXPORT JonesThicknessFilter : public ImageToImageFilter<TImageType, TI
     itkSetMacro(LaplaceMaxIterations, unsigned long int);
     itkGetMacro(LaplaceMaxIterations, unsigned long int);
 
+    /** Set/Get the solver for Laplaces equation. Defaults to Gauss-Seidel. */
+    itkSetMacro(LaplaceSolver, typename LaplaceFilterType::SolverType);
+    itkGetMacro(LaplaceSolver, typename LaplaceFilterType::SolverType);
+
     /** Set/Get the white matter label. Defaults to 1. */
     itkSetMacro(WhiteMatterLabel, short int);
     itkGetMacro(WhiteMatterLabel, short int);
@@ -145,7 +149,7 @@ class ITK_EXPORT JonesThicknessFilter : public ImageToImageFilter<TImageType, TI
     TScalarType m_MinimumStepSize;
     TScalarType m_MaximumLength;
     TScalarType m_Sigma;
-    bool m_DontUseGaussSiedel;
+    typename LaplaceFilterType::SolverType m_LaplaceSolver;
     bool m_UseLabels;
     bool m_UseSmoothing;
     
@@ -41,7 +41,7 @@ JonesThicknessFilter<TImageType, TScalarType, NDimensions>
   m_MinimumStepSize = 0.1;
   m_MaximumLength = 10;
   m_Sigma = 0;
-  m_DontUseGaussSiedel = false;
+  m_LaplaceSolver = LaplaceFilterType::GAUSS_SEIDEL;
   m_UseLabels = false;
   m_UseSmoothing = false;
 
@@ -64,7 +64,7 @@ JonesThicknessFilter<TImageType, TScalarType, NDimensions>
   os << indent << "MinimumStepSize = " << m_MinimumStepSize << std::endl;
   os << indent << "MaximumLength = " << m_MaximumLength << std::endl;
   os << indent << "Sigma = " << m_Sigma << std::endl;
-  os << indent << "DontUseGaussSiedel = " << m_DontUseGaussSiedel << std::endl;
+  os << indent << "LaplaceSolver = " << m_LaplaceSolver << std::endl;
   os << indent << "UseLabels = " << m_UseLabels << std::endl;
   os << indent << "UseSmoothing = " << m_UseSmoothing << std::endl;
 }
@@ -120,7 +120,8 @@ JonesThicknessFilter<TImageType, TScalarType, NDimensions>
   m_LaplaceFilter->SetMaximumNumberOfIterations(m_LaplaceMaxIterations);
   m_LaplaceFilter->SetEpsilonConvergenceThreshold(m_LaplaceEpsionRatio);
   m_LaplaceFilter->SetLabelThresholds(m_GreyMatterLabel, m_WhiteMatterLabel, m_CSFMatterLabel); 
-  m_LaplaceFilter->SetUseGaussSeidel(!m_DontUseGaussSiedel);
+  m_LaplaceFilter->SetSolver(m_LaplaceSolver);
+  m_LaplaceFilter->SetNumberOfThreads(this->GetNumberOfThreads());
   m_LaplaceFilter->UpdateLargestPossibleRegion();
   
   m_NormalsFilter->SetInput(m_LaplaceFilter->GetOutput());
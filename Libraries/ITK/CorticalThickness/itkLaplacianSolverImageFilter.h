@@ -16,8 +16,12 @@
 #define itkLaplacianSolverImageFilter_h
 
 #include <itkImage.h>
+#include <itkMultiThreader.h>
 #include "itkBaseCTEFilter.h"
 
+#include <string>
+#include <vector>
+
 
 namespace itk
 {
@@ -35,6 +39,14 @@ namespace itk
  * in Diep et. al. ISBI 2007, it is generalised to anisotropic voxels.
  * So this implementation can do anisotropic voxels, using Than Dieps
  * generalization.
+ *
+ * As well as Jacobi and Gauss-Seidel, you can choose a red-black successive
+ * over-relaxation (SOR) solver, or a geometric multigrid solver, which both
+ * run on multiple threads. The boundary voltages and the convergence test
+ * on the field energy are the same for all solvers, except that for these
+ * two, the change in field energy must be below the threshold for two
+ * iterations in a row, and for multigrid, each iteration is a whole V-cycle.
+ * For these two solvers, the grey matter must not touch the edge of the image.
  * 
  * The output is an image of voltage potentials.
  * 
@@ -98,10 +110,39 @@ public:
   itkSetMacro(MaximumNumberOfIterations, unsigned long int );
   itkGetMacro(MaximumNumberOfIterations, unsigned long int );
 
-  /** Turns Gauss Siedel optimisation on or off. Default on.*/
-  itkSetMacro(UseGaussSeidel, bool);
-  itkGetMacro(UseGaussSeidel, bool);
-  
+  /** The method used to solve Laplaces equation. */
+  typedef enum {
+    JACOBI,
+    GAUSS_SEIDEL,
+    RED_BLACK_SOR,
+    MULTIGRID
+  } SolverType;
+
+  /** Set the solver. Default GAUSS_SEIDEL. */
+  itkSetMacro(Solver, SolverType);
+  itkGetMacro(Solver, SolverType);
+
+  /**
+   * Turns Gauss Siedel optimisation on or off. Default on. Turning it off selects JACOBI,
+   * and turning it on selects GAUSS_SEIDEL, unless RED_BLACK_SOR or MULTIGRID are already set.
+   */
+  void SetUseGaussSeidel(bool useGaussSeidel)
+    {
+      if (!useGaussSeidel)
+        {
+          this->SetSolver(JACOBI);
+        }
+      else if (m_Solver == JACOBI)
+        {
+          this->SetSolver(GAUSS_SEIDEL);
+        }
+    }
+  bool GetUseGaussSeidel() const { return m_Solver != JACOBI; }
+
+  /** Set the over-relaxation factor for RED_BLACK_SOR, which must be in [1, 2). Default 1.5. */
+  itkSetClampMacro(OverRelaxationFactor, OutputPixelType, 1, 1.99);
+  itkGetMacro(OverRelaxationFactor, OutputPixelType);
+
 protected:
   LaplacianSolverImageFilter();
   virtual ~LaplacianSolverImageFilter()  {}
@@ -109,9 +150,102 @@ protected:
   /** Standard Print Self. */
   virtual void PrintSelf(std::ostream&, Indent) const;
 
-  // The main filter method. Note, single threaded.
+  // The main filter method. Jacobi and Gauss-Seidel are single threaded.
   virtual void GenerateData();
-  
+
+  /** Node numbers, voltages and grid positions of the finite difference grid. */
+  typedef std::vector<unsigned long int>                      NodeArrayType;
+  typedef std::vector<OutputPixelType>                        VoltageArrayType;
+  typedef std::vector<InputImageIndexType>                    GridIndexArrayType;
+
+  /**
+   * Solves for the voltage of the unknown (grey matter) nodes using RED_BLACK_SOR
+   * or MULTIGRID, updating m_CurrentIteration, and logging the field energy as
+   * GenerateData() does. This is shared with HighResLaplacianSolverImageFilter,
+   * so it does not use images.
+   *
+   * \param voltages the voltage of each node. The first gridIndexes.size() nodes are
+   * the unknowns, and the rest are boundary nodes, which are held fixed.
+   * \param neighbours for each unknown, the node numbers of its neighbours, in the order
+   * -x, +x, -y, +y and so on. This is emptied, to save memory.
+   * \param gridIndexes the position of each unknown on the grid, used to colour the
+   * unknowns red or black, and to coarsen the grid for multigrid. This is emptied, to save memory.
+   * \param spacing the grid spacing.
+   */
+  void SolveUsingRedBlackOrMultigrid(VoltageArrayType &voltages,
+                                     NodeArrayType &neighbours,
+                                     GridIndexArrayType &gridIndexes,
+                                     const OutputImageSpacing &spacing);
+
+  /**
+   * One level of the multigrid hierarchy, where level zero is the finite difference
+   * grid itself. Each level solves A e = f, where (A e)_i = Diagonal_i e_i - sum_j Weights_ij e_j,
+   * over the neighbours j of unknown i. On level zero, e are the voltages and f is zero,
+   * and as the weights only depend on the direction, Weights holds one per neighbour,
+   * and Diagonal just one value. On coarser levels, e is the correction, and the last
+   * element of Solution is zero, and stands in for any neighbour outside the grey matter.
+   */
+  struct MultigridLevel
+  {
+    unsigned long int                NumberOfUnknowns;
+    NodeArrayType                    Neighbours;
+    VoltageArrayType                 Weights;
+    VoltageArrayType                 Diagonal;
+    VoltageArrayType                *Solution;
+    VoltageArrayType                 Correction;
+    VoltageArrayType                 RightHandSide;
+    VoltageArrayType                 Residual;
+    NodeArrayType                    Parents;
+    NodeArrayType                    Colours[2];
+    GridIndexArrayType               GridIndexes;
+  };
+
+  /** Operations run on several threads. */
+  typedef enum {
+    RELAX,
+    RESIDUAL,
+    PROLONG
+  } LevelOperationType;
+
+  /** Thread data for the operations on a level. */
+  struct LevelThreadStruct
+  {
+    MultigridLevel                  *Level;
+    MultigridLevel                  *CoarseLevel;
+    LevelOperationType               Operation;
+    unsigned int                     Colour;
+    OutputPixelType                  OverRelaxationFactor;
+    bool                             ComputeEnergy;
+    const OutputImageSpacing        *Spacing;
+    unsigned long int                ChunkSize;
+    VoltageArrayType                 ChunkEnergies;
+    std::vector<std::string>         ErrorMessages;
+  };
+
+  static ITK_THREAD_RETURN_TYPE LevelThreaderCallback(void *arg);
+
+  /** Run an operation over a level, on several threads. Returns the field energy if requested. For PROLONG, the factor scales the correction. */
+  OutputPixelType ThreadedLevelOperation(MultigridLevel &level,
+                                         MultigridLevel *coarseLevel,
+                                         LevelOperationType operation,
+                                         unsigned int colour,
+                                         OutputPixelType overRelaxationFactor,
+                                         bool computeEnergy,
+                                         const OutputImageSpacing &spacing);
+
+  /** Red-black sweeps over a level, returning the field energy of the last sweep on level zero. */
+  OutputPixelType RedBlackSweeps(MultigridLevel &level,
+                                 unsigned int numberOfSweeps,
+                                 OutputPixelType overRelaxationFactor,
+                                 bool computeEnergy,
+                                 const OutputImageSpacing &spacing);
+
+  /** Build the next coarser level, with the Galerkin coarse grid operator. */
+  void CoarsenLevel(MultigridLevel &fineLevel, MultigridLevel &coarseLevel);
+
+  /** One V-cycle, from the given level down, returning the field energy on level zero. */
+  OutputPixelType VCycle(std::vector<MultigridLevel> &levels, unsigned int levelNumber, const OutputImageSpacing &spacing);
+
 private:
   LaplacianSolverImageFilter(const Self&); //purposely not implemented
   void operator=(const Self&); //purposely not implemented
@@ -131,8 +265,11 @@ private:
   /** So we can keep track of current iteration. */
   unsigned long int m_CurrentIteration;
   
-  /** Use Gauss Siedel or not. Default on. */
-  bool m_UseGaussSeidel;
+  /** Which solver to use. Default GAUSS_SEIDEL. */
+  SolverType m_Solver;
+
+  /** The over-relaxation factor for RED_BLACK_SOR. Default 1.5. */
+  OutputPixelType m_OverRelaxationFactor;
   
 };
   
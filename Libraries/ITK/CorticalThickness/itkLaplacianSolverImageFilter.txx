@@ -20,6 +20,9 @@
 #include <itkImageRegionConstIteratorWithIndex.h>
 #include <itkImageRegionIterator.h>
 
+#include <algorithm>
+#include <map>
+
 namespace itk
 {
 template <typename TInputImage, typename TScalarType > 
@@ -30,9 +33,10 @@ LaplacianSolverImageFilter<TInputImage, TScalarType>
   m_HighVoltage = 10000;
   m_EpsilonConvergenceThreshold = 0.00001;
   m_MaximumNumberOfIterations = 200;
-  m_UseGaussSeidel = true;
+  m_Solver = GAUSS_SEIDEL;
+  m_OverRelaxationFactor = 1.5;
   m_CurrentIteration = 0;
-  niftkitkDebugMacro(<<"LaplacianSolverImageFilter():Constructed" << ", LowVoltage=" << m_LowVoltage << ", HighVoltage=" << m_HighVoltage << ", EpsilonConvergenceThreshold=" << m_EpsilonConvergenceThreshold << ", MaximumNumberOfIterations=" << m_MaximumNumberOfIterations << ", m_UseGaussSeidel=" << m_UseGaussSeidel << ", m_CurrentIteration" << m_CurrentIteration);
+  niftkitkDebugMacro(<<"LaplacianSolverImageFilter():Constructed" << ", LowVoltage=" << m_LowVoltage << ", HighVoltage=" << m_HighVoltage << ", EpsilonConvergenceThreshold=" << m_EpsilonConvergenceThreshold << ", MaximumNumberOfIterations=" << m_MaximumNumberOfIterations << ", m_Solver=" << m_Solver << ", m_OverRelaxationFactor=" << m_OverRelaxationFactor << ", m_CurrentIteration" << m_CurrentIteration);
 }
 
 template <typename TInputImage, typename TScalarType >
@@ -45,7 +49,8 @@ LaplacianSolverImageFilter<TInputImage, TScalarType>
   os << indent << "HighVoltage:" << m_HighVoltage << std::endl;
   os << indent << "EpsilonConvergenceThreshold:" << m_EpsilonConvergenceThreshold << std::endl;        
   os << indent << "MaximumNumberOfIterations:" << m_MaximumNumberOfIterations << std::endl;          
-  os << indent << "UseGaussSeidel:" << m_UseGaussSeidel << std::endl;
+  os << indent << "Solver:" << m_Solver << std::endl;
+  os << indent << "OverRelaxationFactor:" << m_OverRelaxationFactor << std::endl;
 }
 
 template <typename TInputImage, typename TScalarType > 
@@ -188,11 +193,85 @@ LaplacianSolverImageFilter<TInputImage, TScalarType>
     }
   denominator *= 2.0;
   niftkitkDebugMacro(<<"GenerateData():Denominator:" << denominator);
-  
+
+  if (m_Solver == RED_BLACK_SOR || m_Solver == MULTIGRID)
+    {
+      // Number the grey matter pixels in the order of listOfGreyMatterPixels, which
+      // is raster order, so a neighbour can be found by searching on its offset.
+      // The next two nodes are the white matter and the extra-cerebral boundaries.
+      unsigned long int lowVoltageNode = totalNumberOfPixels;
+      unsigned long int highVoltageNode = totalNumberOfPixels + 1;
+      typename InputImageType::RegionType region = inputImage->GetLargestPossibleRegion();
+
+      NodeArrayType greyMatterOffsets(totalNumberOfPixels);
+      for (pixelNumber = 0; pixelNumber < totalNumberOfPixels; pixelNumber++)
+        {
+          greyMatterOffsets[pixelNumber] = inputImage->ComputeOffset(listOfGreyMatterPixels[pixelNumber]);
+        }
+
+      VoltageArrayType voltages(totalNumberOfPixels + 2, meanVoltage);
+      voltages[lowVoltageNode] = m_LowVoltage;
+      voltages[highVoltageNode] = m_HighVoltage;
+
+      NodeArrayType neighbours(totalNumberOfPixels * 2 * this->Dimension);
+      GridIndexArrayType gridIndexes(totalNumberOfPixels);
+
+      for (pixelNumber = 0; pixelNumber < totalNumberOfPixels; pixelNumber++)
+        {
+          index = listOfGreyMatterPixels[pixelNumber];
+
+          for (dimensionIndex = 0; dimensionIndex < this->Dimension; dimensionIndex++)
+            {
+              gridIndexes[pixelNumber][dimensionIndex] = index[dimensionIndex] - region.GetIndex()[dimensionIndex];
+
+              for (i = 0; i < 2; i++)
+                {
+                  indexPlus = index;
+                  indexPlus[dimensionIndex] += (i == 0 ? -1 : 1);
+
+                  if (!region.IsInside(indexPlus))
+                    {
+                      itkExceptionMacro(<< "Grey matter pixel " << index << " is on the edge of the image, which is not supported by the red-black SOR or multigrid solvers");
+                    }
+
+                  tmp = inputImage->GetPixel(indexPlus);
+                  unsigned long int &node = neighbours[2 * (pixelNumber * this->Dimension + dimensionIndex) + i];
+
+                  if (tmp == this->m_ExtraCerebralMatterLabel)
+                    {
+                      node = highVoltageNode;
+                    }
+                  else if (tmp == this->m_WhiteMatterLabel)
+                    {
+                      node = lowVoltageNode;
+                    }
+                  else
+                    {
+                      node = std::lower_bound(greyMatterOffsets.begin(), greyMatterOffsets.end(), 
+                                              (unsigned long int)(inputImage->ComputeOffset(indexPlus))) - greyMatterOffsets.begin();
+                    }
+                }
+            }
+        }
+
+      this->SolveUsingRedBlackOrMultigrid(voltages, neighbours, gridIndexes, spacing);
+
+      for (pixelNumber = 0; pixelNumber < totalNumberOfPixels; pixelNumber++)
+        {
+          tmpOutput1->SetPixel(listOfGreyMatterPixels[pixelNumber], voltages[pixelNumber]);
+        }
+
+      niftkitkDebugMacro(<<"GenerateData():Grafting output from:" << tmpOutput1.GetPointer());
+      this->GraftOutput( tmpOutput1 );
+
+      niftkitkDebugMacro(<<"GenerateData():Finished");
+      return;
+    }
+
   while (m_CurrentIteration < m_MaximumNumberOfIterations && epsilonRatio >= m_EpsilonConvergenceThreshold)
     {
       // Sort out which image we are reading from / writing to.
-      if (m_UseGaussSeidel)
+      if (m_Solver == GAUSS_SEIDEL)
         {
             // Read and write to the same image.
             tmpImages[0] = tmpOutput1;
@@ -265,6 +344,433 @@ LaplacianSolverImageFilter<TInputImage, TScalarType>
   niftkitkDebugMacro(<<"GenerateData():Finished");
 }
 
+template <typename TInputImage, typename TScalarType >
+ITK_THREAD_RETURN_TYPE
+LaplacianSolverImageFilter<TInputImage, TScalarType>
+::LevelThreaderCallback(void *arg)
+{
+  ThreadIdType threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  ThreadIdType numberOfThreads = ((MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+  LevelThreadStruct *str = (LevelThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  try
+    {
+      MultigridLevel &level = *(str->Level);
+      VoltageArrayType &solution = *(level.Solution);
+
+      const unsigned int numberOfNeighbours = 2 * Self::Dimension;
+      const bool isGrid = (level.RightHandSide.size() == 0);
+      const OutputImageSpacing &spacing = *(str->Spacing);
+
+      const NodeArrayType &colour = level.Colours[str->Colour];
+      unsigned long int numberOfItems = (str->Operation == RELAX) ? colour.size() : level.NumberOfUnknowns;
+
+      OutputPixelType sum;
+      OutputPixelType value;
+      OutputPixelType difference;
+      OutputPixelType pixelEnergy;
+      OutputPixelType chunkEnergy;
+      unsigned long int chunk;
+      unsigned long int item;
+      unsigned long int unknown;
+      unsigned int j;
+      const unsigned long int *neighbours;
+
+      // Threads take every numberOfThreads'th chunk, and the energy is summed per chunk, 
+      // so the result does not depend on the number of threads.
+      for (chunk = threadId; chunk < str->ChunkEnergies.size(); chunk += numberOfThreads)
+        {
+          chunkEnergy = 0;
+
+          for (item = chunk * str->ChunkSize; item < std::min(numberOfItems, (chunk + 1) * str->ChunkSize); item++)
+            {
+              unknown = (str->Operation == RELAX) ? colour[item] : item;
+              neighbours = &(level.Neighbours[unknown * numberOfNeighbours]);
+
+              if (str->Operation == PROLONG)
+                {
+                  solution[unknown] += str->OverRelaxationFactor * str->CoarseLevel->Correction[level.Parents[unknown]];
+                  continue;
+                }
+
+              sum = isGrid ? 0 : level.RightHandSide[unknown];
+              for (j = 0; j < numberOfNeighbours; j++)
+                {
+                  sum += (isGrid ? level.Weights[j] : level.Weights[unknown * numberOfNeighbours + j]) * solution[neighbours[j]];
+                }
+
+              if (str->Operation == RESIDUAL)
+                {
+                  level.Residual[unknown] = sum - (isGrid ? level.Diagonal[0] : level.Diagonal[unknown]) * solution[unknown];
+                  continue;
+                }
+
+              value = sum / (isGrid ? level.Diagonal[0] : level.Diagonal[unknown]);
+
+              if (str->ComputeEnergy)
+                {
+                  pixelEnergy = 0;
+                  for (j = 0; j < Self::Dimension; j++)
+                    {
+                      difference = (solution[neighbours[2 * j + 1]] - solution[neighbours[2 * j]]) / spacing[j];
+                      pixelEnergy += difference * difference;
+                    }
+                  chunkEnergy += sqrt(pixelEnergy);
+                }
+
+              solution[unknown] += str->OverRelaxationFactor * (value - solution[unknown]);
+            }
+
+          str->ChunkEnergies[chunk] = chunkEnergy;
+        }
+    }
+  catch (std::exception& err)
+    {
+      str->ErrorMessages[threadId] = err.what();
+    }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template <typename TInputImage, typename TScalarType >
+typename LaplacianSolverImageFilter<TInputImage, TScalarType>::OutputPixelType
+LaplacianSolverImageFilter<TInputImage, TScalarType>
+::ThreadedLevelOperation(MultigridLevel &level,
+                         MultigridLevel *coarseLevel,
+                         LevelOperationType operation,
+                         unsigned int colour,
+                         OutputPixelType overRelaxationFactor,
+                         bool computeEnergy,
+                         const OutputImageSpacing &spacing)
+{
+  LevelThreadStruct str;
+  str.Level = &level;
+  str.CoarseLevel = coarseLevel;
+  str.Operation = operation;
+  str.Colour = colour;
+  str.OverRelaxationFactor = overRelaxationFactor;
+  str.ComputeEnergy = computeEnergy;
+  str.Spacing = &spacing;
+  str.ChunkSize = 4096;
+
+  unsigned long int numberOfItems = (operation == RELAX) ? level.Colours[colour].size() : level.NumberOfUnknowns;
+  unsigned long int numberOfChunks = (numberOfItems + str.ChunkSize - 1) / str.ChunkSize;
+  str.ChunkEnergies.assign(numberOfChunks, 0);
+
+  if (numberOfChunks == 0)
+    {
+      return 0;
+    }
+
+  ThreadIdType numberOfThreads = std::min((unsigned long int)(this->GetNumberOfThreads()), numberOfChunks);
+  str.ErrorMessages.assign(numberOfThreads, std::string());
+
+  MultiThreader::Pointer threader = MultiThreader::New();
+  threader->SetNumberOfThreads(numberOfThreads);
+  threader->SetSingleMethod(LevelThreaderCallback, &str);
+  threader->SingleMethodExecute();
+
+  for (unsigned int i = 0; i < str.ErrorMessages.size(); i++)
+    {
+      if (str.ErrorMessages[i].size() > 0)
+        {
+          itkExceptionMacro(<< "Failed to relax the Laplacian:" << str.ErrorMessages[i]);
+        }
+    }
+
+  OutputPixelType fieldEnergy = 0;
+  for (unsigned long int i = 0; i < numberOfChunks; i++)
+    {
+      fieldEnergy += str.ChunkEnergies[i];
+    }
+  return fieldEnergy;
+}
+
+template <typename TInputImage, typename TScalarType >
+typename LaplacianSolverImageFilter<TInputImage, TScalarType>::OutputPixelType
+LaplacianSolverImageFilter<TInputImage, TScalarType>
+::RedBlackSweeps(MultigridLevel &level,
+                 unsigned int numberOfSweeps,
+                 OutputPixelType overRelaxationFactor,
+                 bool computeEnergy,
+                 const OutputImageSpacing &spacing)
+{
+  OutputPixelType fieldEnergy = 0;
+
+  for (unsigned int sweep = 0; sweep < numberOfSweeps; sweep++)
+    {
+      bool isLastSweep = (sweep + 1 == numberOfSweeps);
+
+      // Red unknowns only have black neighbours, and vice versa, so each colour can be done on many threads.
+      fieldEnergy  = this->ThreadedLevelOperation(level, NULL, RELAX, 0, overRelaxationFactor, computeEnergy && isLastSweep, spacing);
+      fieldEnergy += this->ThreadedLevelOperation(level, NULL, RELAX, 1, overRelaxationFactor, computeEnergy && isLastSweep, spacing);
+    }
+  return fieldEnergy;
+}
+
+template <typename TInputImage, typename TScalarType >
+void
+LaplacianSolverImageFilter<TInputImage, TScalarType>
+::CoarsenLevel(MultigridLevel &fineLevel, MultigridLevel &coarseLevel)
+{
+  typedef std::map<InputImageIndexType, unsigned long int, Functor::IndexLexicographicCompare<TInputImage::ImageDimension> > CoarseNumberMapType;
+
+  const unsigned int numberOfNeighbours = 2 * this->Dimension;
+  const bool isGrid = (fineLevel.RightHandSide.size() == 0);
+
+  CoarseNumberMapType coarseNumbers;
+  typename CoarseNumberMapType::iterator iterator;
+  InputImageIndexType coarseIndex;
+  unsigned long int fineUnknown;
+  unsigned long int fineNeighbour;
+  unsigned long int coarseUnknown;
+  unsigned long int coarseNeighbour;
+  unsigned int dimensionIndex;
+  unsigned int j;
+
+  // Each coarse unknown is a 2x2(x2) block of the fine grid, containing at least one fine unknown.
+  coarseLevel.GridIndexes.clear();
+  fineLevel.Parents.resize(fineLevel.NumberOfUnknowns);
+
+  for (fineUnknown = 0; fineUnknown < fineLevel.NumberOfUnknowns; fineUnknown++)
+    {
+      for (dimensionIndex = 0; dimensionIndex < this->Dimension; dimensionIndex++)
+        {
+          long int fineIndex = fineLevel.GridIndexes[fineUnknown][dimensionIndex];
+          coarseIndex[dimensionIndex] = (fineIndex >= 0) ? fineIndex / 2 : (fineIndex - 1) / 2;
+        }
+
+      iterator = coarseNumbers.find(coarseIndex);
+      if (iterator == coarseNumbers.end())
+        {
+          coarseUnknown = coarseLevel.GridIndexes.size();
+          coarseNumbers.insert(std::make_pair(coarseIndex, coarseUnknown));
+          coarseLevel.GridIndexes.push_back(coarseIndex);
+        }
+      else
+        {
+          coarseUnknown = iterator->second;
+        }
+      fineLevel.Parents[fineUnknown] = coarseUnknown;
+    }
+
+  coarseLevel.NumberOfUnknowns = coarseLevel.GridIndexes.size();
+
+  // Galerkin coarse grid operator, P^T A P, where P copies each coarse unknown to its fine
+  // unknowns. Couplings inside a block add to the diagonal, and the rest to the coarse
+  // neighbour in the same direction. Unlike re-discretising on the coarse grid, this stays
+  // stable where the blocks only partly cover the grey matter.
+  coarseLevel.Neighbours.assign(coarseLevel.NumberOfUnknowns * numberOfNeighbours, coarseLevel.NumberOfUnknowns);
+  coarseLevel.Weights.assign(coarseLevel.NumberOfUnknowns * numberOfNeighbours, 0);
+  coarseLevel.Diagonal.assign(coarseLevel.NumberOfUnknowns, 0);
+
+  for (fineUnknown = 0; fineUnknown < fineLevel.NumberOfUnknowns; fineUnknown++)
+    {
+      coarseUnknown = fineLevel.Parents[fineUnknown];
+      coarseLevel.Diagonal[coarseUnknown] += (isGrid ? fineLevel.Diagonal[0] : fineLevel.Diagonal[fineUnknown]);
+
+      for (j = 0; j < numberOfNeighbours; j++)
+        {
+          // Boundary nodes are fixed, so only couple to the diagonal.
+          fineNeighbour = fineLevel.Neighbours[fineUnknown * numberOfNeighbours + j];
+          if (fineNeighbour >= fineLevel.NumberOfUnknowns)
+            {
+              continue;
+            }
+
+          OutputPixelType weight = isGrid ? fineLevel.Weights[j] : fineLevel.Weights[fineUnknown * numberOfNeighbours + j];
+          coarseNeighbour = fineLevel.Parents[fineNeighbour];
+
+          if (coarseNeighbour == coarseUnknown)
+            {
+              coarseLevel.Diagonal[coarseUnknown] -= weight;
+            }
+          else
+            {
+              coarseLevel.Neighbours[coarseUnknown * numberOfNeighbours + j] = coarseNeighbour;
+              coarseLevel.Weights[coarseUnknown * numberOfNeighbours + j] += weight;
+            }
+        }
+    }
+
+  coarseLevel.Colours[0].clear();
+  coarseLevel.Colours[1].clear();
+
+  for (coarseUnknown = 0; coarseUnknown < coarseLevel.NumberOfUnknowns; coarseUnknown++)
+    {
+      long int sumOfIndexes = 0;
+      for (dimensionIndex = 0; dimensionIndex < this->Dimension; dimensionIndex++)
+        {
+          sumOfIndexes += coarseLevel.GridIndexes[coarseUnknown][dimensionIndex];
+        }
+      coarseLevel.Colours[sumOfIndexes & 1].push_back(coarseUnknown);
+    }
+
+  coarseLevel.Correction.assign(coarseLevel.NumberOfUnknowns + 1, 0);
+  coarseLevel.RightHandSide.assign(coarseLevel.NumberOfUnknowns, 0);
+  coarseLevel.Residual.assign(coarseLevel.NumberOfUnknowns, 0);
+  coarseLevel.Solution = &(coarseLevel.Correction);
+  fineLevel.Residual.resize(fineLevel.NumberOfUnknowns);
+}
+
+template <typename TInputImage, typename TScalarType >
+typename LaplacianSolverImageFilter<TInputImage, TScalarType>::OutputPixelType
+LaplacianSolverImageFilter<TInputImage, TScalarType>
+::VCycle(std::vector<MultigridLevel> &levels, unsigned int levelNumber, const OutputImageSpacing &spacing)
+{
+  // Red-black Gauss-Seidel is the smoother, as over-relaxation damps the high frequencies less.
+  const unsigned int numberOfSmoothingSweeps = 2;
+  const unsigned int numberOfCoarsestSweeps = 50;
+
+  // Over-correcting speeds up convergence with the piecewise constant prolongation,
+  // and any factor below 2 still reduces the error.
+  const OutputPixelType overCorrectionFactor = 1.5;
+
+  MultigridLevel &level = levels[levelNumber];
+
+  if (levelNumber + 1 == levels.size())
+    {
+      return this->RedBlackSweeps(level, numberOfCoarsestSweeps, 1, levelNumber == 0, spacing);
+    }
+
+  MultigridLevel &coarseLevel = levels[levelNumber + 1];
+
+  this->RedBlackSweeps(level, numberOfSmoothingSweeps, 1, false, spacing);
+  this->ThreadedLevelOperation(level, NULL, RESIDUAL, 0, 1, false, spacing);
+
+  std::fill(coarseLevel.RightHandSide.begin(), coarseLevel.RightHandSide.end(), 0);
+  for (unsigned long int i = 0; i < level.NumberOfUnknowns; i++)
+    {
+      coarseLevel.RightHandSide[level.Parents[i]] += level.Residual[i];
+    }
+
+  std::fill(coarseLevel.Correction.begin(), coarseLevel.Correction.end(), 0);
+  this->VCycle(levels, levelNumber + 1, spacing);
+
+  this->ThreadedLevelOperation(level, &coarseLevel, PROLONG, 0, overCorrectionFactor, false, spacing);
+
+  return this->RedBlackSweeps(level, numberOfSmoothingSweeps, 1, levelNumber == 0, spacing);
+}
+
+template <typename TInputImage, typename TScalarType >
+void
+LaplacianSolverImageFilter<TInputImage, TScalarType>
+::SolveUsingRedBlackOrMultigrid(VoltageArrayType &voltages,
+                                NodeArrayType &neighbours,
+                                GridIndexArrayType &gridIndexes,
+                                const OutputImageSpacing &spacing)
+{
+  // Stop coarsening once the coarsest level can be solved quickly by sweeping.
+  const unsigned int maximumNumberOfLevels = 16;
+  const unsigned long int minimumNumberOfUnknownsToCoarsen = 1000;
+
+  const unsigned int numberOfNeighbours = 2 * this->Dimension;
+  unsigned long int numberOfUnknowns = gridIndexes.size();
+  unsigned long int unknown;
+  unsigned int dimensionIndex;
+  unsigned int dimensionIndexForAnisotropicScaleFactors;
+
+  if (neighbours.size() != numberOfUnknowns * numberOfNeighbours || voltages.size() < numberOfUnknowns)
+    {
+      itkExceptionMacro(<< "Expected " << numberOfUnknowns * numberOfNeighbours << " neighbours, and at least " 
+                        << numberOfUnknowns << " voltages, but got " << neighbours.size() << " and " << voltages.size());
+    }
+
+  // Reserve all the levels now, so they are never copied.
+  std::vector<MultigridLevel> levels;
+  levels.reserve(maximumNumberOfLevels);
+  levels.push_back(MultigridLevel());
+
+  MultigridLevel &grid = levels[0];
+  grid.NumberOfUnknowns = numberOfUnknowns;
+  grid.Neighbours.swap(neighbours);
+  grid.GridIndexes.swap(gridIndexes);
+  grid.Solution = &voltages;
+  grid.Weights.resize(numberOfNeighbours);
+  grid.Diagonal.assign(1, 0);
+
+  // Same anisotropic multipliers and denominator as GenerateData().
+  for (dimensionIndex = 0; dimensionIndex < this->Dimension; dimensionIndex++)
+    {
+      OutputPixelType multiplier = 1;
+
+      for (dimensionIndexForAnisotropicScaleFactors = 0; dimensionIndexForAnisotropicScaleFactors < this->Dimension; dimensionIndexForAnisotropicScaleFactors++)
+        {
+          if (dimensionIndexForAnisotropicScaleFactors != dimensionIndex)
+            {
+              multiplier *= (spacing[dimensionIndexForAnisotropicScaleFactors] * spacing[dimensionIndexForAnisotropicScaleFactors]);
+            }
+        }
+      grid.Weights[2 * dimensionIndex] = multiplier;
+      grid.Weights[2 * dimensionIndex + 1] = multiplier;
+      grid.Diagonal[0] += 2.0 * multiplier;
+    }
+
+  for (unknown = 0; unknown < numberOfUnknowns; unknown++)
+    {
+      long int sumOfIndexes = 0;
+      for (dimensionIndex = 0; dimensionIndex < this->Dimension; dimensionIndex++)
+        {
+          sumOfIndexes += grid.GridIndexes[unknown][dimensionIndex];
+        }
+      grid.Colours[sumOfIndexes & 1].push_back(unknown);
+    }
+
+  if (m_Solver == MULTIGRID)
+    {
+      while (levels.size() < maximumNumberOfLevels 
+          && levels.back().NumberOfUnknowns >= minimumNumberOfUnknownsToCoarsen)
+        {
+          levels.push_back(MultigridLevel());
+          this->CoarsenLevel(levels[levels.size() - 2], levels.back());
+
+          niftkitkDebugMacro(<<"SolveUsingRedBlackOrMultigrid():Level " << levels.size() - 1 << " has " << levels.back().NumberOfUnknowns << " unknowns");
+
+          if (levels.back().NumberOfUnknowns == levels[levels.size() - 2].NumberOfUnknowns)
+            {
+              levels.pop_back();
+              break;
+            }
+        }
+    }
+
+  niftkitkDebugMacro(<<"SolveUsingRedBlackOrMultigrid():Solving for " << numberOfUnknowns << " unknowns, with solver=" << m_Solver 
+      << ", levels=" << levels.size() << ", threads=" << this->GetNumberOfThreads());
+
+  OutputPixelType currentFieldEnergy = 0;
+  OutputPixelType previousFieldEnergy = 0;
+  OutputPixelType epsilonRatio = 1;
+
+  // Over-relaxation can make the field energy overshoot, and the ratio is briefly
+  // tiny where it turns back, so it must be below the threshold twice in a row.
+  unsigned int numberOfConvergedIterations = 0;
+
+  m_CurrentIteration = 0;
+
+  while (m_CurrentIteration < m_MaximumNumberOfIterations && numberOfConvergedIterations < 2)
+    {
+      if (m_Solver == MULTIGRID)
+        {
+          currentFieldEnergy = this->VCycle(levels, 0, spacing);
+        }
+      else
+        {
+          currentFieldEnergy = this->RedBlackSweeps(levels[0], 1, m_OverRelaxationFactor, true, spacing);
+        }
+
+      if (m_CurrentIteration != 0)
+        {
+          epsilonRatio = fabs((previousFieldEnergy - currentFieldEnergy) / previousFieldEnergy);  
+        }
+      numberOfConvergedIterations = (epsilonRatio < m_EpsilonConvergenceThreshold) ? numberOfConvergedIterations + 1 : 0;
+
+      niftkitkInfoMacro(<<"SolveUsingRedBlackOrMultigrid():[" << m_CurrentIteration << "] currentFieldEnergy=" << currentFieldEnergy << ", previousFieldEnergy=" << previousFieldEnergy << ", epsilonRatio=" << epsilonRatio << ", epsilonTolerance=" << m_EpsilonConvergenceThreshold);
+      previousFieldEnergy = currentFieldEnergy;
+
+      m_CurrentIteration++;
+    }
+}
+
 } // end namespace
 
 #endif // __itkImageRegistrationFilter_txx
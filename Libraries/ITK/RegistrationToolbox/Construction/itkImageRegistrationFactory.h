@@ -102,6 +102,15 @@ MetricTypeEnum
   CR              // Correlation Ratio
 };
 
+enum
+SamplingStrategyEnum
+{
+  ALL_VOXELS,       // Every fixed image voxel, the default.
+  RANDOM_VOXELS,    // A random subset of the fixed image voxels.
+  GRID_VOXELS,      // A regular grid of fixed image voxels, at a random offset.
+  GRADIENT_VOXELS   // A random subset, weighted by fixed image gradient magnitude.
+};
+
 enum
 TransformTypeEnum
 {
@@ -258,6 +267,12 @@ public:
 
   /** Create a Metric. */
   virtual typename MetricType::Pointer CreateMetric(MetricTypeEnum type);
+
+  /** Create a Metric, that only evaluates the given fraction of fixed image voxels. */
+  virtual typename MetricType::Pointer CreateMetric(MetricTypeEnum type, 
+                                                    SamplingStrategyEnum sampling, 
+                                                    double samplingFraction, 
+                                                    bool resampleEveryIteration);
         
   /** Create a transform. */
   virtual typename TransformType::Pointer CreateTransform(TransformTypeEnum type);
@@ -195,6 +195,40 @@ ImageRegistrationFactory<TInputImageType, Dimension, TScalarType>
   niftkitkDebugMacro(<<"CreateMetric(): Returning object: " << &metric);
   return metric;
 }
+
+template<typename TInputImageType, unsigned int Dimension, class TScalarType>
+typename ImageRegistrationFactory<TInputImageType, Dimension, TScalarType>::MetricType::Pointer
+ImageRegistrationFactory<TInputImageType, Dimension, TScalarType>
+::CreateMetric(MetricTypeEnum type, SamplingStrategyEnum sampling, double samplingFraction, bool resampleEveryIteration)
+{
+  typename MetricType::Pointer metric = this->CreateMetric(type);
+  
+  if (sampling == ALL_VOXELS)
+    {
+      metric->SetSamplingStrategy(MetricType::SAMPLING_ALL_VOXELS);
+    }
+  else if (sampling == RANDOM_VOXELS)
+    {
+      metric->SetSamplingStrategy(MetricType::SAMPLING_RANDOM);
+    }
+  else if (sampling == GRID_VOXELS)
+    {
+      metric->SetSamplingStrategy(MetricType::SAMPLING_REGULAR_GRID);
+    }
+  else if (sampling == GRADIENT_VOXELS)
+    {
+      metric->SetSamplingStrategy(MetricType::SAMPLING_GRADIENT_WEIGHTED);
+    }
+  else
+    {
+      itkExceptionMacro(<< "Unrecognised sampling strategy: " << sampling);
+    }
+  metric->SetSamplingFraction(samplingFraction);
+  metric->SetResampleEveryIteration(resampleEveryIteration);
+  
+  niftkitkDebugMacro(<<"CreateMetric(): Sampling strategy:" << sampling << ", fraction:" << samplingFraction << ", resampleEveryIteration:" << resampleEveryIteration);
+  return metric;
+}
   
 template<typename TInputImageType, unsigned int Dimension, class TScalarType>
 typename ImageRegistrationFactory<TInputImageType, Dimension, TScalarType>::TransformType::Pointer
@@ -94,6 +94,9 @@ class ITK_EXPORT SingleResolutionImageRegistrationBuilder : public Object
     /** Then create the metric. */
     typename MetricType::Pointer CreateMetric(MetricTypeEnum type);
 
+    /** Or create a metric that only evaluates a fraction of the fixed image voxels. */
+    typename MetricType::Pointer CreateMetric(MetricTypeEnum type, SamplingStrategyEnum sampling, double samplingFraction, bool resampleEveryIteration);
+
     /** Then create the transform. We pass the image in, to guide initialization. */
     typename TransformType::Pointer CreateTransform(TransformTypeEnum type, ImageConstPointer image);
     
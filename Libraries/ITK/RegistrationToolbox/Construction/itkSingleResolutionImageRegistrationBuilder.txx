@@ -99,6 +99,21 @@ SingleResolutionImageRegistrationBuilder<TImage, Dimension, TScalarType>
   return metric;
 }
 
+template < typename TImage, unsigned int Dimension, class TScalarType >
+typename SingleResolutionImageRegistrationBuilder<TImage, Dimension, TScalarType>::MetricType::Pointer
+SingleResolutionImageRegistrationBuilder<TImage, Dimension, TScalarType>
+::CreateMetric(MetricTypeEnum type, SamplingStrategyEnum sampling, double samplingFraction, bool resampleEveryIteration)
+{
+  typename MetricType::Pointer metric = m_ImageRegistrationFactory->CreateMetric(type, sampling, samplingFraction, resampleEveryIteration);
+  
+  m_ImageRegistrationMethod->SetMetric(metric);
+  m_MetricEnum = type;
+
+  niftkitkDebugMacro(<<"CreateMetric():Created a Metric:" << metric.GetPointer() << ", of type:" << m_MetricEnum << ", sampling:" << sampling);
+  
+  return metric;
+}
+
 /**
  * Create the transform.
  */
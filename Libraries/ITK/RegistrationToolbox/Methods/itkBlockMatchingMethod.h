@@ -29,6 +29,8 @@
 #include <itkImageToListSampleAdaptor.h>
 #include <itkGradientMagnitudeImageFilter.h>
 #include <itkMinimumMaximumImageCalculator.h>
+#include <itkMultiThreader.h>
+#include <vector>
 
 namespace itk
 {
@@ -60,6 +62,14 @@ namespace itk
  * 
  * For further details read Ourselin et. al. Image and Vision Computing 19 (2000) 25-31. 
  * 
+ * In step 2, the blocks are independent, so they are shared out between NumberOfThreads
+ * threads, each with its own copy of the metric and of the current fixed block. The result
+ * does not depend on the number of threads. If UseIntegralImages is on, and the metric is
+ * SSD or NCC, each candidate block is scored straight from the image buffers, rather than via
+ * the metric. Integral images of the transformed moving image give the moving block sums in
+ * constant time, but the cross term, the sum of fixed times moving, is still a loop over the
+ * block, so each candidate costs O(block size), with a much smaller constant than the metric.
+ * 
  * \sa MultiResolutionImageRegistrationWrapper
  * \sa ImageRegistrationFilter
  */
@@ -268,6 +278,17 @@ public:
   itkSetMacro(TransformedMovingImagePadValue, ImagePixelType);
   itkGetMacro(TransformedMovingImagePadValue, ImagePixelType);
   
+  /** Set/Get the number of threads used to match blocks. Default MultiThreader::GetGlobalDefaultNumberOfThreads(). */
+  itkSetClampMacro(NumberOfThreads, ThreadIdType, 1, ITK_MAX_THREADS);
+  itkGetMacro(NumberOfThreads, ThreadIdType);
+  
+  /** 
+   * If true, and the metric is SSD or NCC (without user set intensity bounds), score 
+   * candidate blocks using integral images, rather than calling the metric. Default false.
+   */
+  itkSetMacro(UseIntegralImages, bool);
+  itkGetMacro(UseIntegralImages, bool);
+  
 protected:
 
   BlockMatchingMethod();
@@ -312,6 +333,25 @@ protected:
   /** Multiplies the given point by the two sets of transforms, and returns the difference between the results. */
   virtual double CheckSinglePoint(ParametersType& previousParameters, ParametersType& currentParameters, ImageIndexType& index);
   
+  /** 
+   * For each fixed block index, finds the index of the best matching block in the 
+   * transformed moving image, searching bigOmega either side in steps of bigDeltaTwo.
+   */
+  virtual void MatchBlocks(
+    const std::vector<ImageIndexType>& fixedIndexes,
+    const ImageSizeType& bigN,
+    const ImageSizeType& bigOmega,
+    const ImageSizeType& bigDeltaTwo,
+    std::vector<ImageIndexType>& bestMovingIndexes);
+  
+  /** Converts the matched block indexes to points, and adds them to the containers, returning the number added. */
+  virtual unsigned long int AddPointCorrespondencies(
+    const std::vector<ImageIndexType>& fixedIndexes,
+    const std::vector<ImageIndexType>& bestMovingIndexes,
+    const ImageSizeType& bigN,
+    PointsContainerPointer& fixedPointContainer,
+    PointsContainerPointer& movingPointContainer);
+  
   /** Method to trim points. */
   virtual void TrimPoints(const TransformType* transform, 
       const PointsContainerType* fixedPoints,
@@ -408,6 +448,43 @@ protected:
   
   typedef std::priority_queue<ResidualHeapDataType> ResidualHeap;
   
+  /** Data passed to each thread by MatchBlocks(). */
+  struct MatchBlocksThreadStruct
+  {
+    BlockMatchingMethod                 *Method;
+    const std::vector<ImageIndexType>   *FixedIndexes;
+    std::vector<ImageIndexType>         *BestMovingIndexes;
+    ImageSizeType                        BigN;
+    ImageSizeType                        BigOmega;
+    ImageSizeType                        BigDeltaTwo;
+    bool                                 UseIntegralImages;
+    bool                                 IsNCC;
+    std::vector<OffsetValueType>         BlockOffsets;
+    std::vector<std::string>             ErrorMessages;
+  };
+  
+  /** Static function used as a "callback" by the MultiThreader. */
+  static ITK_THREAD_RETURN_TYPE MatchBlocksThreaderCallback( void *arg );
+  
+  /** Matches every numberOfThreads'th block, starting at threadId. */
+  void MatchBlocksOnThread(ThreadIdType threadId, ThreadIdType numberOfThreads, const MatchBlocksThreadStruct& data);
+  
+  /** Finds the best block by evaluating the metric belonging to threadId at each candidate. */
+  ImageIndexType MatchBlockUsingMetric(ThreadIdType threadId, const ImageIndexType& fixedIndex, const MatchBlocksThreadStruct& data);
+  
+  /** Finds the best block by computing SSD or NCC from the image buffers, looping over the block for
+   * the sum of fixed times moving, with the moving sums from the integral images. */
+  ImageIndexType MatchBlockFromImageBuffers(const ImageIndexType& fixedIndex, const MatchBlocksThreadStruct& data);
+  
+  /** Steps movingIndex to the next candidate block, returning false when they have all been visited. */
+  bool NextCandidateBlock(const ImageIndexType& fixedIndex, const MatchBlocksThreadStruct& data, ImageIndexType& movingIndex) const;
+  
+  /** Computes m_MovingIntegralImage and m_MovingSquaredIntegralImage from the transformed moving image. */
+  void ComputeIntegralImages();
+  
+  /** Sum over a block of size bigN starting at index, using one of the integral images. */
+  double SumOverBlock(const std::vector<double>& integralImage, const ImageIndexType& index, const ImageSizeType& bigN) const;
+  
 private:
   
   BlockMatchingMethod(const Self&); // purposely not implemented
@@ -473,6 +550,18 @@ private:
   ImagePixelType                               m_TransformedMovingImagePadValue;
   
   MinimumMaximumImageCalculatorPointer         m_MinMaxCalculator;
+  
+  ThreadIdType                                 m_NumberOfThreads;
+  
+  bool                                         m_UseIntegralImages;
+  
+  /** One metric, and one image to copy the fixed block into, per thread, as neither can be shared. */
+  std::vector<typename SimilarityMeasureType::Pointer> m_ThreadMetrics;
+  std::vector<typename ImageType::Pointer>     m_ThreadFixedBlocks;
+  
+  /** Integral images of the transformed moving image, and its square, one voxel larger on each axis. */
+  std::vector<double>                          m_MovingIntegralImage;
+  std::vector<double>                          m_MovingSquaredIntegralImage;
 };
 
 } // end namespace itk
@@ -17,7 +17,13 @@
 
 #include "itkBlockMatchingMethod.h"
 #include <itkImageFileWriter.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionConstIteratorWithIndex.h>
+#include <itkImageRegionIterator.h>
+#include <itkSSDImageToImageMetric.h>
+#include <itkNCCImageToImageMetric.h>
 #include <niftkConversionUtils.h>
+#include <limits>
 
 namespace itk
 {
@@ -61,6 +67,8 @@ BlockMatchingMethod<TImageType, TScalarType>
   m_WritePointSet = false;
   m_NoZero = false;
   m_TransformedMovingImagePadValue = 0;
+  m_NumberOfThreads = MultiThreader::GetGlobalDefaultNumberOfThreads();
+  m_UseIntegralImages = false;
   
   niftkitkDebugMacro(<<"BlockMatchingMethod():Constructed, with m_MaximumNumberOfIterationsRoundMainLoop=" << m_MaximumNumberOfIterationsRoundMainLoop \
     << ", m_BlockSize:" << m_BlockSize \
@@ -80,6 +88,8 @@ BlockMatchingMethod<TImageType, TScalarType>
     << ", m_WritePointSet=" << m_WritePointSet \
     << ", m_NoZero=" << m_NoZero \
     << ", m_TransformedMovingImagePadValue=" << m_TransformedMovingImagePadValue \
+    << ", m_NumberOfThreads=" << m_NumberOfThreads \
+    << ", m_UseIntegralImages=" << m_UseIntegralImages \
     );
 }
 
@@ -119,6 +129,8 @@ BlockMatchingMethod<TImageType, TScalarType>
   os << indent << "WritePointSet="<< m_WritePointSet << std::endl;
   os << indent << "NoZero="<< m_NoZero << std::endl;
   os << indent << "TransformedMovingImagePadValue="<< m_TransformedMovingImagePadValue << std::endl;
+  os << indent << "NumberOfThreads="<< m_NumberOfThreads << std::endl;
+  os << indent << "UseIntegralImages="<< m_UseIntegralImages << std::endl;
 }
 
 template < typename TImageType, class TScalarType >
@@ -445,7 +457,7 @@ BlockMatchingMethod<TImageType, TScalarType>
     PointsContainerPointer& movingPointContainer
     )
 {
-  unsigned int i, j, k, l;
+  unsigned int i, j;
 
   ImageRegionType fixedRegion;
   ImageRegionType movingRegion;
@@ -455,26 +467,6 @@ BlockMatchingMethod<TImageType, TScalarType>
   ImageIndexType  minMoving; minMoving.Fill(0);
   ImageIndexType  maxMoving; maxMoving.Fill(0);
   ImageIndexType  fixedIndex; fixedIndex.Fill(0);
-  ImageIndexType  movingIndex; movingIndex.Fill(0);
-  ImageIndexType  bestMovingIndex; bestMovingIndex.Fill(0);
-  
-  ContinuousIndex< TScalarType, TImageType::ImageDimension > fixedPointInVoxelCoordinates;
-  ContinuousIndex< TScalarType, TImageType::ImageDimension > movingPointInVoxelCoordinates;
-  PointType       fixedPointInMillimetreCoordinates;
-  PointType       movingPointInMillimetreCoordinates;
-  PointType       movingPointInMillimetresInOriginalMovingImage;
-      
-  double similarityMeasure;
-  double bestSimilarityMeasure;
-  
-  ParametersType dummyParametersContainingRegionSize(2*TImageType::ImageDimension + 1);
-  dummyParametersContainingRegionSize.SetElement(0, TImageType::ImageDimension);
-  for (i = 0; i < TImageType::ImageDimension; i++)
-    {
-      dummyParametersContainingRegionSize.SetElement(i+1, bigN[i]);  
-    }
-  
-  bool shouldBeMaximized = (static_cast<SimilarityMeasurePointer>(this->GetMetric()))->ShouldBeMaximized();
   
   for (i = 0; i < TImageType::ImageDimension; i++)
     {
@@ -565,9 +557,6 @@ BlockMatchingMethod<TImageType, TScalarType>
   
   // Step 2, make sure list is most variance -> least variance, and go through list
   // until we hit the threshold determined by m_PercentageOfPointsToKeep
-  // Also, we need to make sure we are working with the original fixed image, not a masked one.
-  m_FixedImageRegionFilter->SetInput(this->GetFixedImageCopy());
-  
   unsigned long int totalNumberOfFixedImagePoints = heap.size();
   unsigned long int numberOfFixedImagePointsThatWeWillUse = (unsigned long int)(totalNumberOfFixedImagePoints * (m_PercentageOfPointsToKeep/100.0));
   unsigned long int currentPoint = 0;
@@ -576,89 +565,19 @@ BlockMatchingMethod<TImageType, TScalarType>
   niftkitkDebugMacro(<<"GetPointCorrespondencies2D():Using " << totalNumberOfFixedImagePoints \
       << " x " << m_PercentageOfPointsToKeep << "% = " << numberOfFixedImagePointsThatWeWillUse << " points");
   
-  currentPoint = 0;
-  
+  std::vector<ImageIndexType> fixedIndexes;
   while(currentPoint < numberOfFixedImagePointsThatWeWillUse && currentPoint < totalNumberOfFixedImagePoints)
     {
-      fixedIndex = (heap.top()).GetIndex();
-      
+      fixedIndexes.push_back((heap.top()).GetIndex());
       heap.pop();
-
-      fixedRegion.SetIndex(fixedIndex);
-
-      m_FixedImageRegionFilter->SetRegionOfInterest(fixedRegion);
-      m_FixedImageRegionFilter->Update();
-
-      this->GetMetric()->SetFixedImageRegion( m_FixedImageRegionFilter->GetOutput()->GetBufferedRegion() );
-
-      bestMovingIndex = fixedIndex;
-
-      if (shouldBeMaximized)
-        {
-          bestSimilarityMeasure = std::numeric_limits<double>::min();  
-        }
-      else
-        {
-          bestSimilarityMeasure = std::numeric_limits<double>::max();  
-        }
-                                 
-      for (k = fixedIndex[0] - bigOmega[0]; k < fixedIndex[0] + bigOmega[0]; k += bigDeltaTwo[0])
-        {
-          for (l = fixedIndex[1] - bigOmega[1]; l < fixedIndex[1] + bigOmega[1]; l += bigDeltaTwo[1])
-            {
-            
-              movingIndex[0] = k;
-              movingIndex[1] = l;
-
-              dummyParametersContainingRegionSize.SetElement(3, k);
-              dummyParametersContainingRegionSize.SetElement(4, l);
-
-              similarityMeasure = this->GetMetric()->GetValue(dummyParametersContainingRegionSize);
-
-              if ((shouldBeMaximized && similarityMeasure > bestSimilarityMeasure)
-                || (!shouldBeMaximized && similarityMeasure < bestSimilarityMeasure)
-                )
-                {
-                  bestMovingIndex = movingIndex;
-                  bestSimilarityMeasure = similarityMeasure;
-                }
-            } // end for l
-        } // end for k
-      
-      // Now we add to list.
-      for (k = 0; k < TImageType::ImageDimension; k++)
-        {
-          fixedPointInVoxelCoordinates[k] = fixedIndex[k] + ((bigN[k]-1)/2.0);
-          movingPointInVoxelCoordinates[k] = bestMovingIndex[k] + ((bigN[k]-1)/2.0);
-        }
-
-      // Check if its zero displacement.
-      bool isZeroDisplacement = true;
-      for (k = 0; k < TImageType::ImageDimension; k++)
-        {
-          if (fixedPointInVoxelCoordinates[k] != movingPointInVoxelCoordinates[k])
-            {
-              isZeroDisplacement = false; 
-            }
-        }
-      
-      if (!(isZeroDisplacement && m_NoZero))
-        {
-          // For fixed point, we simply convert to millimetres.            
-          this->GetFixedImage()->TransformContinuousIndexToPhysicalPoint(fixedPointInVoxelCoordinates, fixedPointInMillimetreCoordinates);
-            
-          // transformed moving image has already been resampled by transform
-          // So we need to convert the voxel coordinate to the millimetre coordinate in original moving image
-          
-          this->GetFixedImage()->TransformContinuousIndexToPhysicalPoint(movingPointInVoxelCoordinates, movingPointInMillimetreCoordinates);
-          movingPointInMillimetresInOriginalMovingImage = this->GetTransform()->TransformPoint( movingPointInMillimetreCoordinates );
-
-          fixedPointContainer->InsertElement(actualPointNumberInContainer, fixedPointInMillimetreCoordinates);
-          movingPointContainer->InsertElement(actualPointNumberInContainer, movingPointInMillimetresInOriginalMovingImage);
-          actualPointNumberInContainer++;          
-        }
       currentPoint++;
-    }  
+    }
+  
+  // Then do the block matching for each of those points, on several threads.
+  std::vector<ImageIndexType> bestMovingIndexes;
+  this->MatchBlocks(fixedIndexes, bigN, bigOmega, bigDeltaTwo, bestMovingIndexes);
+  
+  actualPointNumberInContainer = this->AddPointCorrespondencies(fixedIndexes, bestMovingIndexes, bigN, fixedPointContainer, movingPointContainer);
 
   niftkitkDebugMacro(<<"GetPointCorrespondencies2D():Actually did " << actualPointNumberInContainer << " points");
   
@@ -682,7 +601,7 @@ BlockMatchingMethod<TImageType, TScalarType >
     )    
 {
   // TODO: Refactor the 2D and 3D version to remove code duplication.
-  unsigned int i, j, k, l, m, n;
+  unsigned int i, j, k;
 
   ImageRegionType fixedRegion;
   ImageRegionType movingRegion;
@@ -691,39 +610,13 @@ BlockMatchingMethod<TImageType, TScalarType >
   ImageIndexType  minMoving;
   ImageIndexType  maxMoving;
   ImageIndexType  fixedIndex;
-  ImageIndexType  movingIndex;
-  ImageIndexType  bestMovingIndex;
-  ImageIndexType  intermediateBestMovingIndex;
-  ContinuousIndex< TScalarType, TImageType::ImageDimension > fixedPointInVoxelCoordinates;
-  ContinuousIndex< TScalarType, TImageType::ImageDimension > movingPointInVoxelCoordinates;
-  PointType       fixedPointInMillimetreCoordinates;
-  PointType       movingPointInMillimetreCoordinates;
-  PointType       movingPointInMillimetresInOriginalMovingImage;
-      
-  double similarityMeasure;
-  double bestSimilarityMeasure;
-  bool canBeOptimized;
   
-  ParametersType dummyParametersContainingRegionSize(2*TImageType::ImageDimension + 1);
-  dummyParametersContainingRegionSize.SetElement(0, TImageType::ImageDimension);
-  for (i = 0; i < TImageType::ImageDimension; i++)
-    {
-      dummyParametersContainingRegionSize.SetElement(i+1, bigN[i]);  
-    }
-  
-  bool shouldBeMaximized = (static_cast<SimilarityMeasurePointer>(this->GetMetric()))->ShouldBeMaximized();
-  
-  canBeOptimized = true;
   for (i = 0; i < TImageType::ImageDimension; i++)
     {
       minFixed[i] = bigOmega[i];
       maxFixed[i] = size[i] - bigN[i] - bigOmega[i] - 1;
       minMoving[i] = minFixed[i] - bigOmega[i];
       maxMoving[i] = maxFixed[i] + bigOmega[i];
-      
-      if (bigN[i] != 4) canBeOptimized = false;
-      if (bigOmega[i] != 4) canBeOptimized = false;
-      if (bigDeltaTwo[i] != 1) canBeOptimized = false;
     }
 
   niftkitkDebugMacro(<<"GetPointCorrespondencies3D():minFixed=" << minFixed \
@@ -733,9 +626,7 @@ BlockMatchingMethod<TImageType, TScalarType >
     << ", bigN=" << bigN \
     << ", bigOmega=" << bigOmega \
     << ", bigDeltaOne=" << bigDeltaOne \
-    << ", bigDeltaTwo=" << bigDeltaTwo \
-    << ", canBeOptimized=" << canBeOptimized
-    );
+    << ", bigDeltaTwo=" << bigDeltaTwo);
 
   for (i = 0; i < TImageType::ImageDimension; i++)
     {
@@ -813,9 +704,6 @@ BlockMatchingMethod<TImageType, TScalarType >
   
   // Step 2, make sure list is most variance -> least variance, and go through list
   // until we hit the threshold determined by m_PercentageOfPointsToKeep
-  // Also, we need to make sure we are working with the original fixed image, not a masked one.
-  m_FixedImageRegionFilter->SetInput(this->GetFixedImageCopy());
-  
   unsigned long int totalNumberOfFixedImagePoints = heap.size();
   unsigned long int numberOfFixedImagePointsThatWeWillUse = (unsigned long int)(totalNumberOfFixedImagePoints * (m_PercentageOfPointsToKeep/100.0));
   unsigned long int currentPoint = 0;
@@ -824,165 +712,477 @@ BlockMatchingMethod<TImageType, TScalarType >
   niftkitkDebugMacro(<<"GetPointCorrespondencies3D():Using " << totalNumberOfFixedImagePoints \
       << " x " << m_PercentageOfPointsToKeep << "% = " << numberOfFixedImagePointsThatWeWillUse << " points");
   
-  currentPoint = 0;
-
+  std::vector<ImageIndexType> fixedIndexes;
   while(currentPoint < numberOfFixedImagePointsThatWeWillUse && currentPoint < totalNumberOfFixedImagePoints)
     {
-      fixedIndex = (heap.top()).GetIndex();    
-      
+      fixedIndexes.push_back((heap.top()).GetIndex());
       heap.pop();
+      currentPoint++;
+    }
+  
+  // Then do the block matching for each of those points, on several threads.
+  std::vector<ImageIndexType> bestMovingIndexes;
+  this->MatchBlocks(fixedIndexes, bigN, bigOmega, bigDeltaTwo, bestMovingIndexes);
+  
+  actualPointNumberInContainer = this->AddPointCorrespondencies(fixedIndexes, bestMovingIndexes, bigN, fixedPointContainer, movingPointContainer);
 
-      fixedRegion.SetIndex(fixedIndex);        
+  niftkitkDebugMacro(<<"GetPointCorrespondencies3D():Actually did " << actualPointNumberInContainer << " points");
 
-      m_FixedImageRegionFilter->SetRegionOfInterest(fixedRegion);
-      m_FixedImageRegionFilter->Update();
+  if (m_WritePointSet) 
+    {
+      this->WritePointSet(fixedPointContainer, movingPointContainer);
+    }
 
-      this->GetMetric()->SetFixedImageRegion( m_FixedImageRegionFilter->GetOutput()->GetBufferedRegion() );
+}
 
-      bestMovingIndex = fixedIndex;
+template < typename TImageType, class TScalarType  >
+void
+BlockMatchingMethod<TImageType, TScalarType >
+::MatchBlocks(
+    const std::vector<ImageIndexType>& fixedIndexes,
+    const ImageSizeType& bigN,
+    const ImageSizeType& bigOmega,
+    const ImageSizeType& bigDeltaTwo,
+    std::vector<ImageIndexType>& bestMovingIndexes)
+{
+  bestMovingIndexes.resize(fixedIndexes.size());
+  
+  if (fixedIndexes.size() == 0)
+    {
+      return;
+    }
+  
+  SimilarityMeasurePointer metric = static_cast<SimilarityMeasurePointer>(this->GetMetric());
+  bool isSSD = dynamic_cast< SSDImageToImageMetric<TImageType, TImageType>* >(metric) != NULL;
+  bool isNCC = dynamic_cast< NCCImageToImageMetric<TImageType, TImageType>* >(metric) != NULL;
+  
+  ThreadIdType numberOfThreads = m_NumberOfThreads;
+  if (fixedIndexes.size() < numberOfThreads)
+    {
+      numberOfThreads = fixedIndexes.size();
+    }
+  
+  MatchBlocksThreadStruct str;
+  str.Method = this;
+  str.FixedIndexes = &fixedIndexes;
+  str.BestMovingIndexes = &bestMovingIndexes;
+  str.BigN = bigN;
+  str.BigOmega = bigOmega;
+  str.BigDeltaTwo = bigDeltaTwo;
+  str.UseIntegralImages = m_UseIntegralImages && (isSSD || isNCC) && !metric->GetBoundsSetByUser();
+  str.IsNCC = isNCC;
+  str.ErrorMessages.resize(numberOfThreads);
+  
+  niftkitkDebugMacro(<<"MatchBlocks():Matching " << fixedIndexes.size() << " blocks, on " << numberOfThreads \
+      << " threads, UseIntegralImages=" << str.UseIntegralImages);
+  
+  if (str.UseIntegralImages)
+    {
+      this->ComputeIntegralImages();
+      
+      // Offset of each block voxel from the start of the block, in the transformed moving image buffer.
+      const TImageType* movingImage = m_MovingImageResampler->GetOutput();
+      ImageRegionType blockRegion;
+      blockRegion.SetIndex(movingImage->GetBufferedRegion().GetIndex());
+      blockRegion.SetSize(bigN);
       
-      if (shouldBeMaximized)
+      ImageRegionConstIteratorWithIndex<TImageType> blockIterator(movingImage, blockRegion);
+      OffsetValueType startOffset = movingImage->ComputeOffset(blockRegion.GetIndex());
+      for (blockIterator.GoToBegin(); !blockIterator.IsAtEnd(); ++blockIterator)
         {
-          bestSimilarityMeasure = std::numeric_limits<double>::min();  
+          str.BlockOffsets.push_back(movingImage->ComputeOffset(blockIterator.GetIndex()) - startOffset);
+        }
+    }
+  else
+    {
+      // Each thread gets its own copy of the metric, connected to its own fixed block.
+      // And we need to make sure we are working with the original fixed image, not a masked one.
+      m_ThreadMetrics.resize(numberOfThreads);
+      m_ThreadFixedBlocks.resize(numberOfThreads);
+      
+      ImageRegionType blockRegion;
+      blockRegion.SetSize(bigN);
+      
+      for (ThreadIdType i = 0; i < numberOfThreads; i++)
+        {
+          m_ThreadFixedBlocks[i] = TImageType::New();
+          m_ThreadFixedBlocks[i]->SetRegions(blockRegion);
+          m_ThreadFixedBlocks[i]->SetSpacing(this->GetFixedImageCopy()->GetSpacing());
+          m_ThreadFixedBlocks[i]->Allocate();
+          
+          m_ThreadMetrics[i] = metric->Clone();
+          m_ThreadMetrics[i]->SetTransform(this->GetTransform());
+          m_ThreadMetrics[i]->SetInterpolator(this->m_DummyInterpolator);
+          m_ThreadMetrics[i]->SetFixedImage(m_ThreadFixedBlocks[i]);
+          m_ThreadMetrics[i]->SetMovingImage(m_MovingImageResampler->GetOutput());
+          m_ThreadMetrics[i]->SetFixedImageRegion(blockRegion);
+        }
+    }
+  
+  MultiThreader::Pointer threader = MultiThreader::New();
+  threader->SetNumberOfThreads(numberOfThreads);
+  threader->SetSingleMethod(MatchBlocksThreaderCallback, &str);
+  threader->SingleMethodExecute();
+  
+  for (unsigned int i = 0; i < str.ErrorMessages.size(); i++)
+    {
+      if (str.ErrorMessages[i].size() > 0)
+        {
+          itkExceptionMacro(<< "Failed to match blocks:" << str.ErrorMessages[i]);
+        }
+    }
+}
+
+template < typename TImageType, class TScalarType  >
+ITK_THREAD_RETURN_TYPE
+BlockMatchingMethod<TImageType, TScalarType >
+::MatchBlocksThreaderCallback( void *arg )
+{
+  ThreadIdType threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  ThreadIdType threadCount = ((MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+  MatchBlocksThreadStruct *str = (MatchBlocksThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+  
+  try
+    {
+      str->Method->MatchBlocksOnThread(threadId, threadCount, *str);
+    }
+  catch (std::exception& err)
+    {
+      str->ErrorMessages[threadId] = err.what();
+    }
+  
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template < typename TImageType, class TScalarType  >
+void
+BlockMatchingMethod<TImageType, TScalarType >
+::MatchBlocksOnThread(ThreadIdType threadId, ThreadIdType numberOfThreads, const MatchBlocksThreadStruct& data)
+{
+  // Blocks are dealt out round robin. Each result goes in its own slot, 
+  // so the output is the same, whatever the number of threads.
+  for (unsigned long int i = threadId; i < data.FixedIndexes->size(); i += numberOfThreads)
+    {
+      if (data.UseIntegralImages)
+        {
+          (*data.BestMovingIndexes)[i] = this->MatchBlockFromImageBuffers((*data.FixedIndexes)[i], data);
         }
       else
         {
-          bestSimilarityMeasure = std::numeric_limits<double>::max();  
+          (*data.BestMovingIndexes)[i] = this->MatchBlockUsingMetric(threadId, (*data.FixedIndexes)[i], data);
         }
+    }
+}
 
-      // Experimental section, trying to avoid evaluating each position exhaustively.
-      // Alternatively we could do a mini-registration here.
-      if (false)
+template < typename TImageType, class TScalarType  >
+bool
+BlockMatchingMethod<TImageType, TScalarType >
+::NextCandidateBlock(const ImageIndexType& fixedIndex, const MatchBlocksThreadStruct& data, ImageIndexType& movingIndex) const
+{
+  // Same order as nested loops with the first axis outermost. 
+  for (int i = TImageType::ImageDimension - 1; i >= 0; i--)
+    {
+      movingIndex[i] += data.BigDeltaTwo[i];
+      if (movingIndex[i] < (long int)(fixedIndex[i] + data.BigOmega[i]))
         {
-          // Take steps of 4
-          for (l = fixedIndex[0] - 4; l <= (unsigned int)(fixedIndex[0] + 4); l += 4)
-            {
-              for (m = fixedIndex[1] - 4; m <= (unsigned int)(fixedIndex[1] + 4); m += 4)
-                {
-                  for (n = fixedIndex[2] - 4; n <= (unsigned int)(fixedIndex[2] + 4); n += 4)
-                    {
-            
-                      movingIndex[0] = l;
-                      movingIndex[1] = m;
-                      movingIndex[2] = n;
-
-                      dummyParametersContainingRegionSize.SetElement(4, l);
-                      dummyParametersContainingRegionSize.SetElement(5, m);
-                      dummyParametersContainingRegionSize.SetElement(6, n);
-                      
-                      similarityMeasure = this->GetMetric()->GetValue(dummyParametersContainingRegionSize);
-
-                      if ((shouldBeMaximized && similarityMeasure > bestSimilarityMeasure)
-                      || (!shouldBeMaximized && similarityMeasure < bestSimilarityMeasure)
-                      )
-                        {
-                          intermediateBestMovingIndex = movingIndex;
-                          bestSimilarityMeasure = similarityMeasure;                          
-                        }
-                    } // end for n
-                } // end for m
-            } // end for l          
-
-          bestMovingIndex = intermediateBestMovingIndex;
+          return true;
+        }
+      movingIndex[i] = fixedIndex[i] - data.BigOmega[i];
+    }
+  return false;
+}
+
+template < typename TImageType, class TScalarType  >
+typename BlockMatchingMethod<TImageType, TScalarType >::ImageIndexType
+BlockMatchingMethod<TImageType, TScalarType >
+::MatchBlockUsingMetric(ThreadIdType threadId, const ImageIndexType& fixedIndex, const MatchBlocksThreadStruct& data)
+{
+  SimilarityMeasureType* metric = m_ThreadMetrics[threadId];
+  TImageType* fixedBlock = m_ThreadFixedBlocks[threadId];
+  
+  // Copy the fixed block, rather than use a RegionOfInterestImageFilter, as the pipeline isn't thread safe.
+  ImageRegionType fixedRegion;
+  fixedRegion.SetIndex(fixedIndex);
+  fixedRegion.SetSize(data.BigN);
+  
+  ImageRegionConstIterator<TImageType> fixedIterator(this->GetFixedImageCopy(), fixedRegion);
+  ImageRegionIterator<TImageType> blockIterator(fixedBlock, fixedBlock->GetLargestPossibleRegion());
+  for (fixedIterator.GoToBegin(), blockIterator.GoToBegin(); !fixedIterator.IsAtEnd(); ++fixedIterator, ++blockIterator)
+    {
+      blockIterator.Set(fixedIterator.Get());
+    }
+  
+  ParametersType dummyParametersContainingRegionSize(2*TImageType::ImageDimension + 1);
+  dummyParametersContainingRegionSize.SetElement(0, TImageType::ImageDimension);
+  for (unsigned int i = 0; i < TImageType::ImageDimension; i++)
+    {
+      dummyParametersContainingRegionSize.SetElement(i+1, data.BigN[i]);  
+    }
+  
+  bool shouldBeMaximized = metric->ShouldBeMaximized();
+  double similarityMeasure;
+  double bestSimilarityMeasure;
+  
+  if (shouldBeMaximized)
+    {
+      bestSimilarityMeasure = std::numeric_limits<double>::min();  
+    }
+  else
+    {
+      bestSimilarityMeasure = std::numeric_limits<double>::max();  
+    }
+  
+  ImageIndexType bestMovingIndex = fixedIndex;
+  ImageIndexType movingIndex;
+  for (unsigned int i = 0; i < TImageType::ImageDimension; i++)
+    {
+      movingIndex[i] = fixedIndex[i] - data.BigOmega[i];
+    }
+  
+  do
+    {
+      for (unsigned int i = 0; i < TImageType::ImageDimension; i++)
+        {
+          dummyParametersContainingRegionSize.SetElement(TImageType::ImageDimension + 1 + i, movingIndex[i]);
+        }
+      
+      similarityMeasure = metric->GetValue(dummyParametersContainingRegionSize);
+      
+      if ((shouldBeMaximized && similarityMeasure > bestSimilarityMeasure)
+        || (!shouldBeMaximized && similarityMeasure < bestSimilarityMeasure)
+        )
+        {
+          bestMovingIndex = movingIndex;
+          bestSimilarityMeasure = similarityMeasure;
+        }
+    }
+  while (this->NextCandidateBlock(fixedIndex, data, movingIndex));
+  
+  return bestMovingIndex;
+}
+
+template < typename TImageType, class TScalarType  >
+typename BlockMatchingMethod<TImageType, TScalarType >::ImageIndexType
+BlockMatchingMethod<TImageType, TScalarType >
+::MatchBlockFromImageBuffers(const ImageIndexType& fixedIndex, const MatchBlocksThreadStruct& data)
+{
+  const TImageType* movingImage = m_MovingImageResampler->GetOutput();
+  const ImagePixelType* movingBuffer = movingImage->GetBufferPointer();
+  
+  // The fixed block, and its sums, are the same for every candidate.
+  ImageRegionType fixedRegion;
+  fixedRegion.SetIndex(fixedIndex);
+  fixedRegion.SetSize(data.BigN);
+  
+  std::vector<double> fixedValues;
+  fixedValues.reserve(data.BlockOffsets.size());
+  
+  double sf = 0;
+  double sff = 0;
+  
+  ImageRegionConstIterator<TImageType> fixedIterator(this->GetFixedImageCopy(), fixedRegion);
+  for (fixedIterator.GoToBegin(); !fixedIterator.IsAtEnd(); ++fixedIterator)
+    {
+      double value = fixedIterator.Get();
+      fixedValues.push_back(value);
+      sf += value;
+      sff += value * value;
+    }
+  
+  double n = fixedValues.size();
+  double fixedVariance = sff - (sf * sf / n);
+  
+  // Below this, a moving block variance from the integral image is just rounding error.
+  double tolerance = 64 * std::numeric_limits<double>::epsilon() * m_MovingSquaredIntegralImage.back();
+  
+  double similarityMeasure;
+  double bestSimilarityMeasure;
+  
+  if (data.IsNCC)
+    {
+      bestSimilarityMeasure = std::numeric_limits<double>::min();  
+    }
+  else
+    {
+      bestSimilarityMeasure = std::numeric_limits<double>::max();  
+    }
+  
+  ImageIndexType bestMovingIndex = fixedIndex;
+  ImageIndexType movingIndex;
+  for (unsigned int i = 0; i < TImageType::ImageDimension; i++)
+    {
+      movingIndex[i] = fixedIndex[i] - data.BigOmega[i];
+    }
+  
+  do
+    {
+      const ImagePixelType* movingBlock = movingBuffer + movingImage->ComputeOffset(movingIndex);
+      
+      // The one sum the integral images can't give, O(block size) for each candidate.
+      double sfm = 0;
+      for (unsigned long int i = 0; i < fixedValues.size(); i++)
+        {
+          sfm += fixedValues[i] * movingBlock[data.BlockOffsets[i]];
+        }
+      
+      double sm = this->SumOverBlock(m_MovingIntegralImage, movingIndex, data.BigN);
+      double smm = this->SumOverBlock(m_MovingSquaredIntegralImage, movingIndex, data.BigN);
+      
+      if (data.IsNCC)
+        {
+          // Same as NCCImageToImageMetric, which returns the square of the correlation coefficient.
+          double movingVariance = smm - (sm * sm / n);
+          double covariance = sfm - (sf * sm / n);
           
-          // Take steps of 2, starting at best index
-          for (l = bestMovingIndex[0] - 2; l <= (unsigned int)(bestMovingIndex[0] + 2); l += 2)
+          similarityMeasure = 0;
+          if (movingVariance > tolerance && fixedVariance > 0)
             {
-              for (m = bestMovingIndex[1] - 2; m <= (unsigned int)(bestMovingIndex[1] + 2); m += 2)
-                {
-                  for (n = bestMovingIndex[2] - 2; n <= (unsigned int)(bestMovingIndex[2] + 2); n += 2)
-                    {
-            
-                      movingIndex[0] = l;
-                      movingIndex[1] = m;
-                      movingIndex[2] = n;
-
-                      dummyParametersContainingRegionSize.SetElement(4, l);
-                      dummyParametersContainingRegionSize.SetElement(5, m);
-                      dummyParametersContainingRegionSize.SetElement(6, n);
-                      
-                      similarityMeasure = this->GetMetric()->GetValue(dummyParametersContainingRegionSize);
-
-                      if ((shouldBeMaximized && similarityMeasure > bestSimilarityMeasure)
-                      || (!shouldBeMaximized && similarityMeasure < bestSimilarityMeasure)
-                      )
-                        {
-                          intermediateBestMovingIndex = movingIndex;
-                          bestSimilarityMeasure = similarityMeasure;                          
-                        }
-                    } // end for n
-                } // end for m
-            } // end for l          
-
-          bestMovingIndex = intermediateBestMovingIndex;
+              similarityMeasure = covariance / vcl_sqrt(fixedVariance * movingVariance);
+              similarityMeasure *= similarityMeasure;
+            }
           
-          // Take steps of 1, starting at best index
-          for (l = bestMovingIndex[0] - 1; l <= (unsigned int)(bestMovingIndex[0] + 1); l += 1)
+          if (similarityMeasure > bestSimilarityMeasure)
             {
-              for (m = bestMovingIndex[1] - 1; m <= (unsigned int)(bestMovingIndex[1] + 1); m += 1)
-                {
-                  for (n = bestMovingIndex[2] - 1; n <= (unsigned int)(bestMovingIndex[2] + 1); n += 1)
-                    {
-            
-                      movingIndex[0] = l;
-                      movingIndex[1] = m;
-                      movingIndex[2] = n;
-
-                      dummyParametersContainingRegionSize.SetElement(4, l);
-                      dummyParametersContainingRegionSize.SetElement(5, m);
-                      dummyParametersContainingRegionSize.SetElement(6, n);
-                      
-                      similarityMeasure = this->GetMetric()->GetValue(dummyParametersContainingRegionSize);
-
-                      if ((shouldBeMaximized && similarityMeasure > bestSimilarityMeasure)
-                      || (!shouldBeMaximized && similarityMeasure < bestSimilarityMeasure)
-                      )
-                        {
-                          intermediateBestMovingIndex = movingIndex;
-                          bestSimilarityMeasure = similarityMeasure;
-                        }
-                    } // end for n
-                } // end for m
-            } // end for l          
-          
-          bestMovingIndex = intermediateBestMovingIndex;
+              bestMovingIndex = movingIndex;
+              bestSimilarityMeasure = similarityMeasure;
+            }
         }
       else
         {
-          for (l = fixedIndex[0] - bigOmega[0]; l < fixedIndex[0] + bigOmega[0]; l += bigDeltaTwo[0])
+          similarityMeasure = sff - 2 * sfm + smm;
+          
+          if (similarityMeasure < bestSimilarityMeasure)
             {
-              for (m = fixedIndex[1] - bigOmega[1]; m < fixedIndex[1] + bigOmega[1]; m += bigDeltaTwo[1])
-                {
-                  for (n = fixedIndex[2] - bigOmega[2]; n < fixedIndex[2] + bigOmega[2]; n += bigDeltaTwo[2])
-                    {
-            
-                      movingIndex[0] = l;
-                      movingIndex[1] = m;
-                      movingIndex[2] = n;
-
-                      dummyParametersContainingRegionSize.SetElement(4, l);
-                      dummyParametersContainingRegionSize.SetElement(5, m);
-                      dummyParametersContainingRegionSize.SetElement(6, n);
-                      
-                      similarityMeasure = this->GetMetric()->GetValue(dummyParametersContainingRegionSize);
-
-                      if ((shouldBeMaximized && similarityMeasure > bestSimilarityMeasure)
-                      || (!shouldBeMaximized && similarityMeasure < bestSimilarityMeasure)
-                      )
-                        {
-                          bestMovingIndex = movingIndex;
-                          bestSimilarityMeasure = similarityMeasure;
-                        }
-                    } // end for n
-                } // end for m
-            } // end for l          
+              bestMovingIndex = movingIndex;
+              bestSimilarityMeasure = similarityMeasure;
+            }
         }
+    }
+  while (this->NextCandidateBlock(fixedIndex, data, movingIndex));
+  
+  return bestMovingIndex;
+}
 
-      // Now we add to list.
-      for (l = 0; l < TImageType::ImageDimension; l++)
+template < typename TImageType, class TScalarType  >
+void
+BlockMatchingMethod<TImageType, TScalarType >
+::ComputeIntegralImages()
+{
+  const TImageType* movingImage = m_MovingImageResampler->GetOutput();
+  ImageRegionType region = movingImage->GetBufferedRegion();
+  ImageSizeType size = region.GetSize();
+  
+  // One voxel larger on each axis, so the first row/column/slice is zero.
+  unsigned long int stride[TImageType::ImageDimension];
+  unsigned long int numberOfVoxels = 1;
+  for (unsigned int i = 0; i < TImageType::ImageDimension; i++)
+    {
+      stride[i] = numberOfVoxels;
+      numberOfVoxels *= (size[i] + 1);
+    }
+  
+  m_MovingIntegralImage.assign(numberOfVoxels, 0);
+  m_MovingSquaredIntegralImage.assign(numberOfVoxels, 0);
+  
+  ImageRegionConstIteratorWithIndex<TImageType> movingIterator(movingImage, region);
+  for (movingIterator.GoToBegin(); !movingIterator.IsAtEnd(); ++movingIterator)
+    {
+      unsigned long int offset = 0;
+      for (unsigned int i = 0; i < TImageType::ImageDimension; i++)
         {
-          fixedPointInVoxelCoordinates[l] = fixedIndex[l] + ((bigN[l]-1)/2.0);
-          movingPointInVoxelCoordinates[l] = bestMovingIndex[l] + ((bigN[l]-1)/2.0);
+          offset += (movingIterator.GetIndex()[i] - region.GetIndex()[i] + 1) * stride[i];
+        }
+      double value = movingIterator.Get();
+      m_MovingIntegralImage[offset] = value;
+      m_MovingSquaredIntegralImage[offset] = value * value;
+    }
+  
+  // Then a cumulative sum along each axis in turn.
+  for (unsigned int i = 0; i < TImageType::ImageDimension; i++)
+    {
+      for (unsigned long int offset = 0; offset < numberOfVoxels; offset++)
+        {
+          if ((offset / stride[i]) % (size[i] + 1) != 0)
+            {
+              m_MovingIntegralImage[offset] += m_MovingIntegralImage[offset - stride[i]];
+              m_MovingSquaredIntegralImage[offset] += m_MovingSquaredIntegralImage[offset - stride[i]];
+            }
+        }
+    }
+}
+
+template < typename TImageType, class TScalarType  >
+double
+BlockMatchingMethod<TImageType, TScalarType >
+::SumOverBlock(const std::vector<double>& integralImage, const ImageIndexType& index, const ImageSizeType& bigN) const
+{
+  ImageRegionType region = m_MovingImageResampler->GetOutput()->GetBufferedRegion();
+  ImageSizeType size = region.GetSize();
+  
+  unsigned long int stride[TImageType::ImageDimension];
+  unsigned long int numberOfVoxels = 1;
+  for (unsigned int i = 0; i < TImageType::ImageDimension; i++)
+    {
+      stride[i] = numberOfVoxels;
+      numberOfVoxels *= (size[i] + 1);
+    }
+  
+  // Inclusion-exclusion over the 2^D corners of the block.
+  double sum = 0;
+  for (unsigned int corner = 0; corner < (1u << TImageType::ImageDimension); corner++)
+    {
+      unsigned long int offset = 0;
+      unsigned int numberOfLowerCorners = 0;
+      for (unsigned int i = 0; i < TImageType::ImageDimension; i++)
+        {
+          long int position = index[i] - region.GetIndex()[i];
+          if (corner & (1u << i))
+            {
+              position += bigN[i];
+            }
+          else
+            {
+              numberOfLowerCorners++;
+            }
+          offset += position * stride[i];
+        }
+      if (numberOfLowerCorners % 2 == 0)
+        {
+          sum += integralImage[offset];
+        }
+      else
+        {
+          sum -= integralImage[offset];
+        }
+    }
+  return sum;
+}
+
+template < typename TImageType, class TScalarType  >
+unsigned long int
+BlockMatchingMethod<TImageType, TScalarType >
+::AddPointCorrespondencies(
+    const std::vector<ImageIndexType>& fixedIndexes,
+    const std::vector<ImageIndexType>& bestMovingIndexes,
+    const ImageSizeType& bigN,
+    PointsContainerPointer& fixedPointContainer,
+    PointsContainerPointer& movingPointContainer)
+{
+  unsigned int k;
+  unsigned long int actualPointNumberInContainer = 0;
+  
+  ContinuousIndex< TScalarType, TImageType::ImageDimension > fixedPointInVoxelCoordinates;
+  ContinuousIndex< TScalarType, TImageType::ImageDimension > movingPointInVoxelCoordinates;
+  PointType       fixedPointInMillimetreCoordinates;
+  PointType       movingPointInMillimetreCoordinates;
+  PointType       movingPointInMillimetresInOriginalMovingImage;
+  
+  for (unsigned long int i = 0; i < fixedIndexes.size(); i++)
+    {
+      for (k = 0; k < TImageType::ImageDimension; k++)
+        {
+          fixedPointInVoxelCoordinates[k] = fixedIndexes[i][k] + ((bigN[k]-1)/2.0);
+          movingPointInVoxelCoordinates[k] = bestMovingIndexes[i][k] + ((bigN[k]-1)/2.0);
         }
 
       // Check if its zero displacement.
@@ -999,10 +1199,10 @@ BlockMatchingMethod<TImageType, TScalarType >
         {
           // For fixed point, we simply convert to millimetres.            
           this->GetFixedImage()->TransformContinuousIndexToPhysicalPoint(fixedPointInVoxelCoordinates, fixedPointInMillimetreCoordinates);
-        
+            
           // transformed moving image has already been resampled by transform
           // So we need to convert the voxel coordinate to the millimetre coordinate in original moving image
-      
+          
           this->GetFixedImage()->TransformContinuousIndexToPhysicalPoint(movingPointInVoxelCoordinates, movingPointInMillimetreCoordinates);
           movingPointInMillimetresInOriginalMovingImage = this->GetTransform()->TransformPoint( movingPointInMillimetreCoordinates );
 
@@ -1010,17 +1210,8 @@ BlockMatchingMethod<TImageType, TScalarType >
           movingPointContainer->InsertElement(actualPointNumberInContainer, movingPointInMillimetresInOriginalMovingImage);
           actualPointNumberInContainer++;          
         }
-      currentPoint++;
-  
-    } // end while
-
-  niftkitkDebugMacro(<<"GetPointCorrespondencies2D():Actually did " << actualPointNumberInContainer << " points");
-
-  if (m_WritePointSet) 
-    {
-      this->WritePointSet(fixedPointContainer, movingPointContainer);
     }
-
+  return actualPointNumberInContainer;
 }
 
 template < typename TImageType, class TScalarType  >
@@ -17,6 +17,7 @@
 
 #include "itkUCLHistogram.h"
 #include "itkFiniteDifferenceGradientSimilarityMeasure.h"
+#include <vector>
 
 namespace itk
 {
@@ -111,6 +112,9 @@ protected:
   HistogramSimilarityMeasure();
   virtual ~HistogramSimilarityMeasure() {};
 
+  /** Also copies the histogram size and Parzen filling flag. */
+  virtual LightObject::Pointer InternalClone() const;
+
   /** The histogram size. */
   HistogramSizeType m_HistogramSize;
 
@@ -137,6 +141,18 @@ protected:
    */
   void AggregateCostFunctionPair(FixedImagePixelType fixedValue, MovingImagePixelType movingValue);
   
+  /** We can fill one histogram per piece of the image on separate threads. */
+  bool HasPartialCostFunctions() const { return true; }
+
+  /** Sets each partial histogram to zero, with the same number of bins as m_Histogram. */
+  void ResetPartialCostFunctions(unsigned int numberOfPartials);
+
+  /** As AggregateCostFunctionPair, but into the partial histogram. */
+  void AggregatePartialCostFunctionPair(unsigned int partial, FixedImagePixelType fixedValue, MovingImagePixelType movingValue);
+
+  /** Adds each partial histogram into m_Histogram, in order. */
+  void CombinePartialCostFunctions();
+
   /** PrintSelf funtion */
   void PrintSelf(std::ostream& os, Indent indent) const;
 
@@ -177,6 +193,12 @@ private:
   /** Turn Parzen filling on/off. default off.*/
   bool m_UseParzenFilling;
   
+  /** Adds the frequency to the bin containing sample, if there is one. */
+  void IncreasePartialFrequencyOfMeasurement(unsigned int partial, const HistogramMeasurementVectorType& sample, HistogramFrequencyType frequency);
+  
+  /** One set of bins per piece of the image, indexed by histogram instance identifier. */
+  std::vector< std::vector<HistogramFrequencyType> > m_PartialHistograms;
+  
 };
 
 } // end namespace itk
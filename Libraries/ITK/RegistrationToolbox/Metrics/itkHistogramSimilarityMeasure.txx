@@ -42,6 +42,24 @@ void HistogramSimilarityMeasure<TFixedImage, TMovingImage>
   Superclass::Initialize();
 }
 
+template <class TFixedImage, class TMovingImage>
+LightObject::Pointer
+HistogramSimilarityMeasure<TFixedImage, TMovingImage>
+::InternalClone() const
+{
+  LightObject::Pointer loPtr = Superclass::InternalClone();
+  Self *rval = dynamic_cast<Self *>(loPtr.GetPointer());
+  if (rval == NULL)
+    {
+      itkExceptionMacro(<< "Downcast to type " << this->GetNameOfClass() << " failed.");
+    }
+
+  rval->m_HistogramSize = this->m_HistogramSize;
+  rval->m_UseParzenFilling = this->m_UseParzenFilling;
+
+  return loPtr;
+}
+
 template <class TFixedImage, class TMovingImage>
 void
 HistogramSimilarityMeasure<TFixedImage,TMovingImage>
@@ -143,6 +161,85 @@ HistogramSimilarityMeasure<TFixedImage,TMovingImage>
     }
 }
 
+template <class TFixedImage, class TMovingImage>
+void
+HistogramSimilarityMeasure<TFixedImage,TMovingImage>
+::ResetPartialCostFunctions(unsigned int numberOfPartials)
+{
+  // m_Histogram was initialised in ResetCostFunction().
+  m_PartialHistograms.resize(numberOfPartials);
+  for (unsigned int i = 0; i < numberOfPartials; i++)
+    {
+      m_PartialHistograms[i].assign(this->m_Histogram->Size(), 0);
+    }
+}
+
+template <class TFixedImage, class TMovingImage>
+void
+HistogramSimilarityMeasure<TFixedImage,TMovingImage>
+::IncreasePartialFrequencyOfMeasurement(unsigned int partial, const HistogramMeasurementVectorType& sample, HistogramFrequencyType frequency)
+{
+  // Same as m_Histogram->IncreaseFrequencyOfMeasurement(), but writes to the partial, so it's thread safe.
+  typename HistogramType::IndexType index(2);
+  if (this->m_Histogram->GetIndex(sample, index))
+    {
+      m_PartialHistograms[partial][this->m_Histogram->GetInstanceIdentifier(index)] += frequency;
+    }
+}
+
+template <class TFixedImage, class TMovingImage>
+void
+HistogramSimilarityMeasure<TFixedImage,TMovingImage>
+::AggregatePartialCostFunctionPair(unsigned int partial, FixedImagePixelType fixedValue, MovingImagePixelType movingValue)
+{
+  HistogramMeasurementVectorType sample(2);
+  sample[0] = fixedValue;
+  sample[1] = movingValue;
+
+  if (m_UseParzenFilling)
+    {
+      for(int t = (int)(fixedValue-2.0); t<(int)(fixedValue+3.0); t++)
+        {
+          if((int)(this->m_FixedLowerBound) <= t && t <= (int)(this->m_FixedUpperBound))
+            {
+              for(int r=(int)(movingValue-2.0); r<(int)(movingValue+3.0); r++)
+                {
+                  if((int)(this->m_MovingLowerBound) <= r && r <= (int)(this->m_MovingUpperBound))
+                    {
+                      sample[0] = t;
+                      sample[1] = r;
+                      HistogramFrequencyType coeff =  GetParzenValue((double)t-fixedValue)
+                                     *GetParzenValue((double)r-movingValue);
+                      this->IncreasePartialFrequencyOfMeasurement(partial, sample, coeff);
+                    }
+                }
+            }
+        }        
+    }
+  else
+    {
+      this->IncreasePartialFrequencyOfMeasurement(partial, sample, 1);
+    }
+}
+
+template <class TFixedImage, class TMovingImage>
+void
+HistogramSimilarityMeasure<TFixedImage,TMovingImage>
+::CombinePartialCostFunctions()
+{
+  for (unsigned long i = 0; i < this->m_Histogram->Size(); i++)
+    {
+      HistogramFrequencyType frequency = 0;
+      for (unsigned int j = 0; j < m_PartialHistograms.size(); j++)
+        {
+          frequency += m_PartialHistograms[j][i];
+        }
+      if (frequency != 0)
+        {
+          this->m_Histogram->IncreaseFrequency(i, frequency);
+        }
+    }
+}
 
 } // end namespace itk
 
@@ -16,6 +16,7 @@
 #define itkNCCImageToImageMetric_h
 
 #include "itkFiniteDifferenceGradientSimilarityMeasure.h"
+#include "itkPartialCostFunctionSums.h"
 
 namespace itk
 {
@@ -94,6 +95,55 @@ protected:
       m_sfm += (fixedValue*movingValue)*weight;
     }
   
+  /** We can sum up pieces of the image on separate threads. */
+  bool HasPartialCostFunctions() const { return true; }
+
+  void ResetPartialCostFunctions(unsigned int numberOfPartials)
+    {
+      m_PartialSums.Reset(numberOfPartials);
+    }
+
+  void AggregatePartialCostFunctionPair(
+      unsigned int partial,
+      FixedImagePixelType fixedValue, 
+      MovingImagePixelType movingValue)
+    {
+      PartialSums& sums = m_PartialSums[partial];
+      sums.m_numberCounted++;
+      sums.m_sf += fixedValue;
+      sums.m_sm += movingValue;
+      sums.m_sff += (fixedValue*fixedValue);
+      sums.m_smm += (movingValue*movingValue);
+      sums.m_sfm += (fixedValue*movingValue);
+    }
+
+  void AggregatePartialCostFunctionPairWithWeighting(
+      unsigned int partial,
+      FixedImagePixelType fixedValue, 
+      MovingImagePixelType movingValue, double weight)
+    {
+      PartialSums& sums = m_PartialSums[partial];
+      sums.m_numberCounted += weight;
+      sums.m_sf += fixedValue*weight;
+      sums.m_sm += movingValue*weight;
+      sums.m_sff += (fixedValue*fixedValue)*weight;
+      sums.m_smm += (movingValue*movingValue)*weight;
+      sums.m_sfm += (fixedValue*movingValue)*weight;
+    }
+
+  void CombinePartialCostFunctions()
+    {
+      for (unsigned int i = 0; i < m_PartialSums.Size(); i++)
+        {
+          m_numberCounted += m_PartialSums[i].m_numberCounted;
+          m_sf += m_PartialSums[i].m_sf;
+          m_sm += m_PartialSums[i].m_sm;
+          m_sff += m_PartialSums[i].m_sff;
+          m_smm += m_PartialSums[i].m_smm;
+          m_sfm += m_PartialSums[i].m_sfm;
+        }
+    }
+
   /**
    * In this method, we do any final aggregating.
    */
@@ -126,6 +176,17 @@ private:
   double m_sff;
   double m_smm;
   double m_sfm;
+
+  struct PartialSums
+  {
+    double m_numberCounted;
+    double m_sf;
+    double m_sm;
+    double m_sff;
+    double m_smm;
+    double m_sfm;
+  };
+  PartialCostFunctionSums<PartialSums> m_PartialSums;
 };
 
 } // end namespace itk
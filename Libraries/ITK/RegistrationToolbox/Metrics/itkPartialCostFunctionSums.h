@@ -0,0 +1,84 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#ifndef itkPartialCostFunctionSums_h
+#define itkPartialCostFunctionSums_h
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace itk
+{
+/**
+ * \class PartialCostFunctionSums
+ * \brief The partial accumulators of a similarity measure, one TSums per piece of the image.
+ *
+ * SimilarityMeasure sums each piece of the image on its own thread, so each TSums starts
+ * on its own cache line, and is padded to a whole number of them, so no two threads ever
+ * write to the same line. std::vector only aligns to TSums, so the storage is allocated
+ * with a line to spare, and the first TSums is offset to the first line boundary in it.
+ *
+ * TSums must be a plain struct of numbers, that Reset() value initialises to zero.
+ *
+ * \ingroup RegistrationMetrics
+ */
+template <class TSums>
+class PartialCostFunctionSums
+{
+public:
+
+  /** Assumed cache line size in bytes, which is right for current x86 and ARM processors. */
+  static const std::size_t CacheLineSize = 64;
+
+  PartialCostFunctionSums()
+  : m_NumberOfSums(0), m_Stride(0), m_First(0)
+  {
+  }
+
+  /** Makes numberOfSums zeroed sums, each on its own cache lines. */
+  void Reset(unsigned int numberOfSums)
+    {
+      m_Stride = ((sizeof(TSums) + CacheLineSize - 1) / CacheLineSize) * CacheLineSize;
+      m_Storage.assign(numberOfSums * m_Stride + CacheLineSize, 0);
+
+      std::size_t address = reinterpret_cast<std::size_t>(&m_Storage[0]);
+      m_First = &m_Storage[0] + (CacheLineSize - address % CacheLineSize) % CacheLineSize;
+      m_NumberOfSums = numberOfSums;
+
+      for (unsigned int i = 0; i < m_NumberOfSums; i++)
+        {
+          new (m_First + i * m_Stride) TSums();
+        }
+    }
+
+  unsigned int Size() const { return m_NumberOfSums; }
+
+  TSums& operator[](unsigned int i) { return *reinterpret_cast<TSums*>(m_First + i * m_Stride); }
+
+  const TSums& operator[](unsigned int i) const { return *reinterpret_cast<const TSums*>(m_First + i * m_Stride); }
+
+private:
+  PartialCostFunctionSums(const PartialCostFunctionSums&); // purposefully not implemented
+  void operator=(const PartialCostFunctionSums&);         // purposefully not implemented
+
+  unsigned int      m_NumberOfSums;
+  std::size_t       m_Stride;
+  std::vector<char> m_Storage;
+  char*             m_First;
+};
+
+} // end namespace itk
+
+#endif
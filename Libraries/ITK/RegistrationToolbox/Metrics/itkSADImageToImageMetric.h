@@ -16,6 +16,7 @@
 #define itkSADImageToImageMetric_h
 
 #include "itkFiniteDifferenceGradientSimilarityMeasure.h"
+#include "itkPartialCostFunctionSums.h"
 
 namespace itk
 {
@@ -73,6 +74,30 @@ protected:
     {
       return this->m_SAD;
     }
+
+  /** We can sum up pieces of the image on separate threads. */
+  bool HasPartialCostFunctions() const { return true; }
+
+  void ResetPartialCostFunctions(unsigned int numberOfPartials)
+    {
+      this->m_PartialSAD.Reset(numberOfPartials);
+    }
+
+  void AggregatePartialCostFunctionPair(
+      unsigned int partial,
+      FixedImagePixelType fixedValue, 
+      MovingImagePixelType movingValue)
+    {
+      this->m_PartialSAD[partial].m_Sum += fabs((double)(fixedValue - movingValue));
+    }
+
+  void CombinePartialCostFunctions()
+    {
+      for (unsigned int i = 0; i < this->m_PartialSAD.Size(); i++)
+        {
+          this->m_SAD += this->m_PartialSAD[i].m_Sum;
+        }
+    }
   
 private:
   SADImageToImageMetric(const Self&); // purposefully not implemented
@@ -80,6 +105,9 @@ private:
   
   /** The single variable we need to sum up the values. */
   double m_SAD;
+
+  struct PartialSum { double m_Sum; };
+  PartialCostFunctionSums<PartialSum> m_PartialSAD;
 };
 
 } // end namespace itk
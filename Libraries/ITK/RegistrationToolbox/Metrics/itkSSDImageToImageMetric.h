@@ -16,6 +16,7 @@
 #define itkSSDImageToImageMetric_h
 
 #include "itkFiniteDifferenceGradientSimilarityMeasure.h"
+#include "itkPartialCostFunctionSums.h"
 
 namespace itk
 {
@@ -74,12 +75,39 @@ protected:
       return this->m_SSD;
     }
 
+  /** We can sum up pieces of the image on separate threads. */
+  bool HasPartialCostFunctions() const { return true; }
+
+  void ResetPartialCostFunctions(unsigned int numberOfPartials)
+    {
+      this->m_PartialSSD.Reset(numberOfPartials);
+    }
+
+  void AggregatePartialCostFunctionPair(
+      unsigned int partial,
+      FixedImagePixelType fixedValue, 
+      MovingImagePixelType movingValue)
+    {
+      this->m_PartialSSD[partial].m_Sum += ((fixedValue - movingValue) * (fixedValue - movingValue));
+    }
+
+  void CombinePartialCostFunctions()
+    {
+      for (unsigned int i = 0; i < this->m_PartialSSD.Size(); i++)
+        {
+          this->m_SSD += this->m_PartialSSD[i].m_Sum;
+        }
+    }
+
 private:
   SSDImageToImageMetric(const Self&); // purposefully not implemented
   void operator=(const Self&);        // purposefully not implemented
   
   /** The single variable we need to sum up the values. */
   double m_SSD;
+
+  struct PartialSum { double m_Sum; };
+  PartialCostFunctionSums<PartialSum> m_PartialSSD;
 };
 
 } // end namespace itk
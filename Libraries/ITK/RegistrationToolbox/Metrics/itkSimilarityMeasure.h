@@ -24,6 +24,8 @@
 #include <itkLinearInterpolateImageFunction.h>
 #include <itkEulerAffineTransform.h>
 #include <itkImageMaskSpatialObject.h>
+#include <itkMultiThreader.h>
+#include <itkMersenneTwisterRandomVariateGenerator.h>
 
 namespace itk
 {
@@ -49,6 +51,20 @@ namespace itk
  * mechanism in the itkImageToImageMetricWithConstraint class.
  * 
  * Note that this class is NOT thread safe.
+ *
+ * If a derived class also implements the partial cost function methods
+ * (HasPartialCostFunctions(), ResetPartialCostFunctions(), AggregatePartialCostFunctionPair(),
+ * and CombinePartialCostFunctions()), and SetNumberOfPartialCostFunctions() is non-zero,
+ * the fixed image is split into that many pieces, each with its own partial accumulator,
+ * and the pieces are evaluated on several threads. The partials are combined in piece
+ * order before FinalizeCostFunction(), so the result does not depend on the number of threads.
+ *
+ * By default every fixed image voxel is used. SetSamplingStrategy() can instead choose a
+ * subset of SamplingFraction of the voxels, either at random, on a regular grid, or at random
+ * weighted by the fixed image gradient magnitude. The subset is drawn in Initialize(),
+ * so once per resolution level, or on every evaluation if ResampleEveryIteration is on.
+ * Only the sampled voxels of the transformed moving image are updated, so anything that needs
+ * all of it, should call GetValueUsingAllVoxels().
  * 
  * \ingroup RegistrationMetrics
  */
@@ -67,6 +83,12 @@ public:
   /** Run-time type information (and related methods). */
   itkTypeMacro(SimilarityMeasure, ImageToImageMetricWithConstraint);
 
+  /**
+   * Creates another measure of the same type, with the same settings and intensity bounds,
+   * but no images, transform or interpolator, e.g. so each thread can have its own.
+   */
+  itkCloneMacro(Self);
+
   /** Types transferred from the base class */
   typedef typename Superclass::TransformType                TransformType;
   typedef typename itk::UCLBaseTransform<double, 
@@ -103,6 +125,11 @@ public:
   static const int SYMMETRIC_METRIC_MID_WAY; 
   static const int SYMMETRIC_METRIC_BOTH_FIXED_AND_MOVING_TRANSFORM; 
   
+  static const int SAMPLING_ALL_VOXELS;
+  static const int SAMPLING_RANDOM;
+  static const int SAMPLING_REGULAR_GRID;
+  static const int SAMPLING_GRADIENT_WEIGHTED;
+  
   /** Initializes the metric. This is declared virtual in base class. */
   void Initialize() throw (ExceptionObject);
 
@@ -127,6 +154,9 @@ public:
   /** Get MovingUpperBound, highest intensity value to use in moving image. */
   itkGetConstMacro( MovingUpperBound, MovingImagePixelType );
 
+  /** Returns true if the bounds were set with SetIntensityBounds(), rather than computed from the images. */
+  itkGetConstMacro( BoundsSetByUser, bool );
+
   /**
    * Get the number of samples used in the most recent evaluation of the measure.
    */
@@ -257,6 +287,50 @@ public:
   itkSetMacro(IsResampleWholeImage, bool); 
   itkGetMacro(IsResampleWholeImage, bool); 
   
+  /**
+   * Set/Get the number of threads used by GetSimilarity(), if the derived class
+   * supports partial cost functions. Default MultiThreader::GetGlobalDefaultNumberOfThreads().
+   */
+  itkSetClampMacro(NumberOfThreads, ThreadIdType, 1, ITK_MAX_THREADS);
+  itkGetMacro(NumberOfThreads, ThreadIdType);
+  
+  /**
+   * Set/Get the number of pieces the fixed image is split into, each with its own
+   * partial accumulator. The value of the measure depends on this, but not on the
+   * number of threads. Zero uses the single threaded loop. Default 0.
+   */
+  itkSetMacro(NumberOfPartialCostFunctions, unsigned int);
+  itkGetMacro(NumberOfPartialCostFunctions, unsigned int);
+  
+  /**
+   * Set/Get which fixed image voxels are used, one of SAMPLING_ALL_VOXELS (the default),
+   * SAMPLING_RANDOM, SAMPLING_REGULAR_GRID or SAMPLING_GRADIENT_WEIGHTED.
+   * Not used for direct voxel comparison, or symmetric metrics.
+   */
+  itkSetMacro(SamplingStrategy, int);
+  itkGetConstMacro(SamplingStrategy, int);
+  
+  /** Set/Get the fraction of fixed image voxels to sample. Default 0.1. */
+  itkSetClampMacro(SamplingFraction, double, 0.0, 1.0);
+  itkGetMacro(SamplingFraction, double);
+  
+  /** Set/Get whether to draw new samples on every evaluation, rather than in Initialize(). Default false. */
+  itkSetMacro(ResampleEveryIteration, bool);
+  itkGetMacro(ResampleEveryIteration, bool);
+  
+  /** Set/Get the seed for the random sampling strategies, so runs are repeatable. Default 0. */
+  itkSetMacro(SamplingSeed, int);
+  itkGetMacro(SamplingSeed, int);
+  
+  /** Returns the number of fixed image voxels currently sampled, or zero if using all voxels. */
+  unsigned long GetNumberOfSampledVoxels() const { return m_SampledVoxels.size(); }
+  
+  /**
+   * Evaluates the measure on all voxels, whatever the sampling strategy, so that
+   * GetTransformedMovingImage() (and any histogram) is complete, e.g. for computing forces.
+   */
+  MeasureType GetValueUsingAllVoxels(const TransformParametersType& parameters) const;
+  
   /** 
    * Subclasses should implement this.
    * Simply return true if the cost function should be maximized (like Mutual Info.)
@@ -285,6 +359,9 @@ protected:
   virtual ~SimilarityMeasure() {};
   void PrintSelf(std::ostream& os, Indent indent) const;
 
+  /** Copies the settings, see Clone(). Subclasses with settings of their own should extend this. */
+  virtual LightObject::Pointer InternalClone() const;
+
   /**
    * itkImageToImageMetric implements GetValue, which calls this GetSimilarity,
    * which calls ResetAggregate, AggregatePair, AggregateTotal, which subclasses should override.
@@ -316,6 +393,37 @@ protected:
    */
   virtual MeasureType FinalizeCostFunction() = 0;
 
+  /**
+   * Derived classes return true if they implement the partial cost function methods below,
+   * in which case GetSimilarity() can evaluate the measure on several threads.
+   */
+  virtual bool HasPartialCostFunctions() const { return false; }
+
+  /**
+   * Called after ResetCostFunction(), to create and reset numberOfPartials partial accumulators.
+   */
+  virtual void ResetPartialCostFunctions(unsigned int numberOfPartials) {}
+
+  /**
+   * As AggregateCostFunctionPair(), but adds to partial accumulator number "partial".
+   * Called concurrently for different partials, so must only touch that accumulator.
+   */
+  virtual void AggregatePartialCostFunctionPair(unsigned int partial, FixedImagePixelType fixedValue, MovingImagePixelType movingValue) {
+    itkExceptionMacro(<<"AggregatePartialCostFunctionPair not implemented.");
+  }
+
+  /**
+   * As AggregateCostFunctionPairWithWeighting(), but adds to partial accumulator number "partial".
+   */
+  virtual void AggregatePartialCostFunctionPairWithWeighting(unsigned int partial, FixedImagePixelType fixedValue, MovingImagePixelType movingValue, double weight) {
+    itkExceptionMacro(<<"AggregatePartialCostFunctionPairWithWeighting not implemented.");
+  }
+
+  /**
+   * Adds the partial accumulators, in order, into the accumulator used by FinalizeCostFunction().
+   */
+  virtual void CombinePartialCostFunctions() {}
+
   /**
    * As we iterate through image, its easy to calculate a
    * transformed moving image as we go. This is essential for 
@@ -444,6 +552,73 @@ protected:
   */
   virtual void InitializeDistanceWeightings();
 
+  /**
+   * Chooses the fixed image voxels used by the sampling strategy, called from Initialize().
+   */
+  virtual void InitializeSampling();
+  
+  /**
+   * Draws a new set of fixed image voxels from the fixed image region into m_SampledVoxels,
+   * and puts the voxels of the last draw in the transformed moving image back to the pad value.
+   */
+  void DrawSampledVoxels() const;
+  
+  /** Returns the buffer offset of voxel number position of the fixed image region, x fastest. */
+  OffsetValueType GetFixedImageRegionOffset(unsigned long position) const;
+  
+  /** True if GetSimilarity() should only visit m_SampledVoxels. */
+  bool IsUsingSampledVoxels() const { return m_SamplingStrategy != SAMPLING_ALL_VOXELS && !m_UseAllVoxels; }
+
+  /**
+   * Evaluates the measure over the fixed image using the partial cost functions, on m_NumberOfThreads threads.
+   * The partials are combined, but not finalized.
+   */
+  void AggregatePartialCostFunctions(const typename TFixedImage::RegionType& fixedRegion) const;
+
+  /**
+   * Splits fixedRegion along its last dimension into at most num pieces, returning
+   * piece i as splitRegion. Returns the number of pieces actually used.
+   */
+  unsigned int SplitFixedRegion(const typename TFixedImage::RegionType& fixedRegion, unsigned int i, unsigned int num, typename TFixedImage::RegionType& splitRegion) const;
+
+  /**
+   * Aggregates one piece of the fixed image into partial accumulator number "partial",
+   * returning the number of samples used.
+   */
+  long int AggregatePartialCostFunction(unsigned int partial, const typename TFixedImage::RegionType& pieceRegion) const;
+
+  /**
+   * Aggregates m_SampledVoxels[first] up to, but not including, m_SampledVoxels[last] into partial
+   * accumulator number "partial", or into the cost function itself if partial is negative,
+   * returning the number of samples used.
+   */
+  long int AggregateSampledCostFunction(int partial, unsigned long first, unsigned long last) const;
+
+  /**
+   * Transforms one fixed image voxel, and if it is in the masks and bounds, aggregates it into
+   * partial accumulator number "partial", or the cost function itself if partial is negative.
+   * Returns the value for the transformed moving image, and sets isSample if it was aggregated.
+   */
+  MovingImagePixelType AggregateVoxel(int partial, 
+                                      const typename TFixedImage::IndexType& index, 
+                                      FixedImagePixelType fixedImageValue, 
+                                      FixedMaskType* fixedMask, 
+                                      MovingMaskType* movingMask, 
+                                      bool& isSample) const;
+
+  /** Static function used as a "callback" by the MultiThreader. */
+  static ITK_THREAD_RETURN_TYPE PartialCostFunctionThreaderCallback( void *arg );
+
+  /** Data passed to each thread by AggregatePartialCostFunctions(). */
+  struct PartialCostFunctionThreadStruct
+  {
+    const SimilarityMeasure           *Metric;
+    typename TFixedImage::RegionType   FixedRegion;
+    unsigned int                       NumberOfPieces;
+    std::vector<long int>              NumberOfSamples;
+    std::vector<std::string>           ErrorMessages;
+  };
+
 private:
   
   SimilarityMeasure(const Self&); // purposefully not implemented
@@ -510,6 +685,39 @@ private:
   
   /** So we can specify the transformed image pad value. Default 0. */
   MovingImagePixelType m_TransformedMovingImagePadValue;
+
+  /** Number of threads for evaluating partial cost functions. */
+  ThreadIdType m_NumberOfThreads;
+
+  /** Number of pieces the fixed image is split into, zero for the single threaded loop. */
+  unsigned int m_NumberOfPartialCostFunctions;
+
+  /** Which fixed image voxels to use. Default SAMPLING_ALL_VOXELS. */
+  int m_SamplingStrategy;
+
+  /** Fraction of fixed image voxels to sample. Default 0.1. */
+  double m_SamplingFraction;
+
+  /** Draw new samples on every evaluation. Default false. */
+  bool m_ResampleEveryIteration;
+
+  /** Seed for m_RandomGenerator. */
+  int m_SamplingSeed;
+
+  /** Set during GetValueUsingAllVoxels(). */
+  mutable bool m_UseAllVoxels;
+
+  /** Buffer offsets of the sampled fixed image voxels, in increasing order. */
+  mutable std::vector<OffsetValueType> m_SampledVoxels;
+
+  /** So the random sampling strategies are repeatable. */
+  Statistics::MersenneTwisterRandomVariateGenerator::Pointer m_RandomGenerator;
+
+  /** Running sum of the fixed image gradient magnitude over the fixed image region, for SAMPLING_GRADIENT_WEIGHTED. */
+  std::vector<double> m_CumulativeGradientMagnitude;
+  
+  /** True if every voxel of the transformed moving image not in m_SampledVoxels is at the pad value. */
+  mutable bool m_TransformedMovingImageIsPadded;
   
 };
 
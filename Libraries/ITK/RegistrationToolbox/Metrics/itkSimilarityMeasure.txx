@@ -18,7 +18,10 @@
 #include "itkSimilarityMeasure.h"
 #include <itkStatisticsImageFilter.h>
 #include <itkImageRegionConstIteratorWithIndex.h>
+#include <itkGradientMagnitudeImageFilter.h>
 #include <itkUCLMacro.h>
+#include <algorithm>
+#include <set>
 
 namespace itk
 {
@@ -31,6 +34,18 @@ const int SimilarityMeasure<TFixedImage,TMovingImage>::SYMMETRIC_METRIC_MID_WAY
 template <typename TFixedImage, typename TMovingImage> 
 const int SimilarityMeasure<TFixedImage,TMovingImage>::SYMMETRIC_METRIC_BOTH_FIXED_AND_MOVING_TRANSFORM = 3; 
 
+template <typename TFixedImage, typename TMovingImage> 
+const int SimilarityMeasure<TFixedImage,TMovingImage>::SAMPLING_ALL_VOXELS = 0; 
+
+template <typename TFixedImage, typename TMovingImage> 
+const int SimilarityMeasure<TFixedImage,TMovingImage>::SAMPLING_RANDOM = 1; 
+
+template <typename TFixedImage, typename TMovingImage> 
+const int SimilarityMeasure<TFixedImage,TMovingImage>::SAMPLING_REGULAR_GRID = 2; 
+
+template <typename TFixedImage, typename TMovingImage> 
+const int SimilarityMeasure<TFixedImage,TMovingImage>::SAMPLING_GRADIENT_WEIGHTED = 3; 
+
 /*
  * Constructor
  */
@@ -64,6 +79,15 @@ SimilarityMeasure<TFixedImage,TMovingImage>
   m_WeightingDistanceThreshold = 2.0; 
   m_InitialiseIntensityBoundsUsingMask = false; 
   m_IsResampleWholeImage = false; 
+  m_NumberOfThreads = MultiThreader::GetGlobalDefaultNumberOfThreads();
+  m_NumberOfPartialCostFunctions = 0;
+  m_SamplingStrategy = SAMPLING_ALL_VOXELS;
+  m_SamplingFraction = 0.1;
+  m_ResampleEveryIteration = false;
+  m_SamplingSeed = 0;
+  m_UseAllVoxels = false;
+  m_TransformedMovingImageIsPadded = false;
+  m_RandomGenerator = Statistics::MersenneTwisterRandomVariateGenerator::New();
   
   niftkitkDebugMacro("SimilarityMeasure():Constructed");
 }
@@ -89,6 +113,51 @@ SimilarityMeasure<TFixedImage, TMovingImage>
   os << indent << "TransformedMovingImageFileExt = " << this->m_TransformedMovingImageFileExt  << std::endl;  
   os << indent << "DirectVoxelComparison = " << this->m_DirectVoxelComparison  << std::endl;  
   os << indent << "TransformedMovingImagePadValue = " << this->m_TransformedMovingImagePadValue  << std::endl;
+  os << indent << "SamplingStrategy = " << this->m_SamplingStrategy  << std::endl;
+  os << indent << "SamplingFraction = " << this->m_SamplingFraction  << std::endl;
+  os << indent << "ResampleEveryIteration = " << this->m_ResampleEveryIteration  << std::endl;
+  os << indent << "NumberOfSampledVoxels = " << this->m_SampledVoxels.size()  << std::endl;
+}
+
+template <class TFixedImage, class TMovingImage>
+LightObject::Pointer
+SimilarityMeasure<TFixedImage, TMovingImage>
+::InternalClone() const
+{
+  LightObject::Pointer loPtr = Superclass::InternalClone();
+  Self *rval = dynamic_cast<Self *>(loPtr.GetPointer());
+  if (rval == NULL)
+    {
+      itkExceptionMacro(<< "Downcast to type " << this->GetNameOfClass() << " failed.");
+    }
+
+  rval->m_FixedLowerBound = this->m_FixedLowerBound;
+  rval->m_FixedUpperBound = this->m_FixedUpperBound;
+  rval->m_MovingLowerBound = this->m_MovingLowerBound;
+  rval->m_MovingUpperBound = this->m_MovingUpperBound;
+  rval->m_BoundsSetByUser = this->m_BoundsSetByUser;
+  rval->m_TwoSidedMetric = this->m_TwoSidedMetric;
+  rval->m_DirectVoxelComparison = this->m_DirectVoxelComparison;
+  rval->m_SymmetricMetric = this->m_SymmetricMetric;
+  rval->m_IsUpdateMatrix = this->m_IsUpdateMatrix;
+  rval->m_TransformedMovingImagePadValue = this->m_TransformedMovingImagePadValue;
+  rval->m_UseWeighting = this->m_UseWeighting;
+  rval->m_WeightingDistanceThreshold = this->m_WeightingDistanceThreshold;
+  rval->m_InitialiseIntensityBoundsUsingMask = this->m_InitialiseIntensityBoundsUsingMask;
+  rval->m_IsResampleWholeImage = this->m_IsResampleWholeImage;
+  rval->m_NumberOfThreads = this->m_NumberOfThreads;
+  rval->m_NumberOfPartialCostFunctions = this->m_NumberOfPartialCostFunctions;
+  rval->m_SamplingStrategy = this->m_SamplingStrategy;
+  rval->m_SamplingFraction = this->m_SamplingFraction;
+  rval->m_ResampleEveryIteration = this->m_ResampleEveryIteration;
+  rval->m_SamplingSeed = this->m_SamplingSeed;
+  rval->m_ComputeGradient = this->m_ComputeGradient;
+  rval->m_Constraint = this->m_Constraint;
+  rval->m_WeightingFactor = this->m_WeightingFactor;
+  rval->m_UseConstraintGradient = this->m_UseConstraintGradient;
+  rval->m_PrintOutMetricEvaluation = this->m_PrintOutMetricEvaluation;
+
+  return loPtr;
 }
 
 template <class TFixedImage, class TMovingImage>
@@ -256,6 +325,7 @@ void SimilarityMeasure<TFixedImage, TMovingImage>
   this->m_TransformedMovingImage->SetOrigin(this->m_FixedImage->GetOrigin());
   this->m_TransformedMovingImage->SetDirection(this->m_FixedImage->GetDirection());
   this->m_TransformedMovingImage->Allocate();  
+  m_TransformedMovingImageIsPadded = false;
   
   if (this->m_SymmetricMetric == SYMMETRIC_METRIC_MID_WAY)
   {
@@ -278,6 +348,207 @@ void SimilarityMeasure<TFixedImage, TMovingImage>
   }
 
   this->InitializeIntensityBounds();
+  
+  this->InitializeSampling();
+}
+
+template <class TFixedImage, class TMovingImage>
+void 
+SimilarityMeasure<TFixedImage, TMovingImage>
+::InitializeSampling()
+{
+  m_SampledVoxels.clear();
+  m_CumulativeGradientMagnitude.clear();
+  
+  if (m_SamplingStrategy == SAMPLING_ALL_VOXELS)
+    {
+      return;
+    }
+  
+  if (m_SamplingStrategy != SAMPLING_RANDOM 
+      && m_SamplingStrategy != SAMPLING_REGULAR_GRID 
+      && m_SamplingStrategy != SAMPLING_GRADIENT_WEIGHTED)
+    {
+      itkExceptionMacro(<< "Unrecognised sampling strategy:" << m_SamplingStrategy);
+    }
+  
+  if (m_SamplingFraction <= 0)
+    {
+      itkExceptionMacro(<< "Sampling fraction must be greater than zero.");
+    }
+  
+  if (m_SamplingStrategy == SAMPLING_GRADIENT_WEIGHTED)
+    {
+      typedef GradientMagnitudeImageFilter<TFixedImage, FloatImageType> GradientMagnitudeFilterType;
+      typename GradientMagnitudeFilterType::Pointer gradientFilter = GradientMagnitudeFilterType::New();
+      gradientFilter->SetInput(this->m_FixedImage);
+      gradientFilter->Update();
+      
+      // Summed once here, in the same order as the voxels of the fixed image region,
+      // so each draw only needs a binary search per sample.
+      ImageRegionConstIterator<FloatImageType> iterator(gradientFilter->GetOutput(), this->GetFixedImageRegion());
+      m_CumulativeGradientMagnitude.reserve(this->GetFixedImageRegion().GetNumberOfPixels());
+      double sum = 0;
+      for (iterator.GoToBegin(); !iterator.IsAtEnd(); ++iterator)
+        {
+          sum += iterator.Get();
+          m_CumulativeGradientMagnitude.push_back(sum);
+        }
+    }
+  
+  // Same seed at each level, so the whole registration is repeatable.
+  m_RandomGenerator->Initialize(m_SamplingSeed);
+  
+  this->DrawSampledVoxels();
+  
+  niftkitkDebugMacro("InitializeSampling():Strategy=" << m_SamplingStrategy << ", fraction=" << m_SamplingFraction << ", sampled " << m_SampledVoxels.size() << " voxels");
+}
+
+template <class TFixedImage, class TMovingImage>
+void 
+SimilarityMeasure<TFixedImage, TMovingImage>
+::DrawSampledVoxels() const
+{
+  const typename TFixedImage::RegionType& fixedRegion = this->GetFixedImageRegion();
+  unsigned long numberOfVoxels = fixedRegion.GetNumberOfPixels();
+  unsigned long numberOfSamples = (unsigned long)(numberOfVoxels * m_SamplingFraction + 0.5);
+  numberOfSamples = std::max(1ul, std::min(numberOfSamples, numberOfVoxels));
+  
+  // Voxels we don't visit are left at the pad value, rather than left over from the last draw.
+  // Once the whole image is padded, only the voxels of the last draw need putting back.
+  if (this->m_TransformedMovingImage.IsNotNull())
+    {
+      if (m_TransformedMovingImageIsPadded)
+        {
+          FixedImagePixelType* transformedMovingBuffer = this->m_TransformedMovingImage->GetBufferPointer();
+          for (unsigned long i = 0; i < m_SampledVoxels.size(); i++)
+            {
+              transformedMovingBuffer[m_SampledVoxels[i]] = (FixedImagePixelType)m_TransformedMovingImagePadValue;
+            }
+        }
+      else
+        {
+          this->m_TransformedMovingImage->FillBuffer(m_TransformedMovingImagePadValue);
+          m_TransformedMovingImageIsPadded = true;
+        }
+    }
+  
+  m_SampledVoxels.clear();
+  m_SampledVoxels.reserve(numberOfSamples);
+  
+  double sumOfGradientMagnitudes = m_CumulativeGradientMagnitude.empty() ? 0 : m_CumulativeGradientMagnitude.back();
+  
+  if (m_SamplingStrategy == SAMPLING_REGULAR_GRID)
+    {
+      // Same step along each axis, from a random start, so each draw moves the grid.
+      unsigned long step = (unsigned long)(pow(1.0/m_SamplingFraction, 1.0/(double)TFixedImage::ImageDimension) + 0.5);
+      step = std::max(1ul, step);
+      
+      typename TFixedImage::IndexType start;
+      typename TFixedImage::IndexType end;
+      unsigned long numberOfGridVoxels = 1;
+      for (unsigned int i = 0; i < TFixedImage::ImageDimension; i++)
+        {
+          unsigned long first = m_RandomGenerator->GetIntegerVariate(step - 1);
+          unsigned long numberAlongAxis = (first < fixedRegion.GetSize()[i] ? (fixedRegion.GetSize()[i] - 1 - first) / step + 1 : 0);
+          start[i] = fixedRegion.GetIndex()[i] + first;
+          end[i] = start[i] + numberAlongAxis * step;
+          numberOfGridVoxels *= numberAlongAxis;
+        }
+      
+      // Steps through the grid points themselves, x fastest, so the offsets increase.
+      typename TFixedImage::IndexType index = start;
+      for (unsigned long n = 0; n < numberOfGridVoxels; n++)
+        {
+          m_SampledVoxels.push_back(this->m_FixedImage->ComputeOffset(index));
+          for (unsigned int i = 0; i < TFixedImage::ImageDimension; i++)
+            {
+              index[i] += step;
+              if (index[i] < end[i])
+                {
+                  break;
+                }
+              index[i] = start[i];
+            }
+        }
+    }
+  else if (m_SamplingStrategy == SAMPLING_GRADIENT_WEIGHTED && sumOfGradientMagnitudes > 0)
+    {
+      // Systematic sampling along the cumulative gradient magnitude, from a random start,
+      // so each voxel is picked with probability proportional to gradient magnitude, up to one,
+      // and we get about numberOfSamples voxels, mostly near edges.
+      double spacing = sumOfGradientMagnitudes / numberOfSamples;
+      double next = m_RandomGenerator->GetVariateWithOpenUpperRange() * spacing;
+      std::vector<double>::const_iterator voxel = m_CumulativeGradientMagnitude.begin();
+      for (unsigned long n = 0; n < numberOfSamples; n++, next += spacing)
+        {
+          voxel = std::upper_bound(voxel, m_CumulativeGradientMagnitude.end(), next);
+          if (voxel == m_CumulativeGradientMagnitude.end())
+            {
+              break;
+            }
+          OffsetValueType offset = this->GetFixedImageRegionOffset(voxel - m_CumulativeGradientMagnitude.begin());
+          if (m_SampledVoxels.empty() || m_SampledVoxels.back() != offset)
+            {
+              m_SampledVoxels.push_back(offset);
+            }
+        }
+    }
+  else
+    {
+      // Floyd's algorithm, so exactly numberOfSamples voxels, drawn with one random number each.
+      // The set keeps them in order.
+      std::set<unsigned long> positions;
+      for (unsigned long j = numberOfVoxels - numberOfSamples; j < numberOfVoxels; j++)
+        {
+          if (!positions.insert(m_RandomGenerator->GetIntegerVariate(j)).second)
+            {
+              positions.insert(j);
+            }
+        }
+      for (std::set<unsigned long>::const_iterator position = positions.begin(); position != positions.end(); ++position)
+        {
+          m_SampledVoxels.push_back(this->GetFixedImageRegionOffset(*position));
+        }
+    }
+}
+
+template <class TFixedImage, class TMovingImage>
+OffsetValueType
+SimilarityMeasure<TFixedImage, TMovingImage>
+::GetFixedImageRegionOffset(unsigned long position) const
+{
+  const typename TFixedImage::RegionType& fixedRegion = this->GetFixedImageRegion();
+  
+  typename TFixedImage::IndexType index;
+  for (unsigned int i = 0; i < TFixedImage::ImageDimension; i++)
+    {
+      index[i] = fixedRegion.GetIndex()[i] + position % fixedRegion.GetSize()[i];
+      position /= fixedRegion.GetSize()[i];
+    }
+  return this->m_FixedImage->ComputeOffset(index);
+}
+
+template <class TFixedImage, class TMovingImage>
+typename SimilarityMeasure<TFixedImage,TMovingImage>::MeasureType 
+SimilarityMeasure<TFixedImage, TMovingImage>
+::GetValueUsingAllVoxels(const TransformParametersType& parameters) const
+{
+  MeasureType measure = NumericTraits< MeasureType >::Zero;
+  
+  m_UseAllVoxels = true;
+  try
+    {
+      measure = this->GetValue(parameters);
+    }
+  catch (...)
+    {
+      m_UseAllVoxels = false;
+      throw;
+    }
+  m_UseAllVoxels = false;
+  
+  return measure;
 }
 
 
@@ -371,6 +642,12 @@ typename SimilarityMeasure<TFixedImage,TMovingImage>::MeasureType
 SimilarityMeasure<TFixedImage, TMovingImage>
 ::GetSimilarity( const TransformParametersType & parameters ) const
 {
+  // Anything but the sampled loop below writes every voxel of the transformed moving image.
+  if (!this->IsUsingSampledVoxels() || this->m_SymmetricMetric != 0)
+    {
+      m_TransformedMovingImageIsPadded = false;
+    }
+
   if (this->m_SymmetricMetric == SYMMETRIC_METRIC_AVERAGE)
     {
       return const_cast< SimilarityMeasure<TFixedImage, TMovingImage>* >(this)->GetSymmetricSimilarity(parameters);  
@@ -479,6 +756,23 @@ SimilarityMeasure<TFixedImage, TMovingImage>
 
       this->m_Interpolator->SetInputImage(this->m_MovingImage);
 
+      if (this->IsUsingSampledVoxels() && m_ResampleEveryIteration)
+        {
+          this->DrawSampledVoxels();
+        }
+
+      if (this->HasPartialCostFunctions() && m_NumberOfPartialCostFunctions > 0)
+        {
+          // Same as the loop below, but split into pieces and run on several threads.
+          this->AggregatePartialCostFunctions(fixedRegion);
+        }
+      else if (this->IsUsingSampledVoxels())
+        {
+          // Same as the loop below, but only visiting the sampled voxels.
+          this->m_NumberOfFixedSamples = this->AggregateSampledCostFunction(-1, 0, m_SampledVoxels.size());
+        }
+      else
+        {
       fixedImageIterator.GoToBegin();
       transformedMovingImageIterator.GoToBegin();
 
@@ -569,6 +863,7 @@ SimilarityMeasure<TFixedImage, TMovingImage>
           ++transformedMovingImageIterator;
           
         } // end while
+        } // end if (HasPartialCostFunctions())
 
       // Now sum up the measure in derived class.
       measure = const_cast< SimilarityMeasure<TFixedImage, TMovingImage>* >(this)->FinalizeCostFunction();
@@ -683,6 +978,275 @@ SimilarityMeasure<TFixedImage, TMovingImage>
   return measure;
 }
 
+template <class TFixedImage, class TMovingImage> 
+unsigned int
+SimilarityMeasure<TFixedImage, TMovingImage>
+::SplitFixedRegion(const typename TFixedImage::RegionType& fixedRegion, unsigned int i, unsigned int num, typename TFixedImage::RegionType& splitRegion) const
+{
+  // Split along the last dimension, so each piece is contiguous in memory.
+  const unsigned int splitAxis = TFixedImage::ImageDimension - 1;
+  
+  typename TFixedImage::IndexType splitIndex = fixedRegion.GetIndex();
+  typename TFixedImage::SizeType splitSize = fixedRegion.GetSize();
+  
+  unsigned long range = splitSize[splitAxis];
+  unsigned int numberOfPieces = std::max(1u, std::min(num, (unsigned int)range));
+  
+  if (i < numberOfPieces)
+    {
+      unsigned long start = (range * i) / numberOfPieces;
+      unsigned long end = (range * (i + 1)) / numberOfPieces;
+      splitIndex[splitAxis] += start;
+      splitSize[splitAxis] = end - start;
+    }
+  
+  splitRegion.SetIndex(splitIndex);
+  splitRegion.SetSize(splitSize);
+  
+  return numberOfPieces;
+}
+
+template <class TFixedImage, class TMovingImage> 
+typename SimilarityMeasure<TFixedImage, TMovingImage>::MovingImagePixelType
+SimilarityMeasure<TFixedImage, TMovingImage>
+::AggregateVoxel(int partial, 
+                 const typename TFixedImage::IndexType& index, 
+                 FixedImagePixelType fixedImageValue, 
+                 FixedMaskType* fixedMask, 
+                 MovingMaskType* movingMask, 
+                 bool& isSample) const
+{
+  SimilarityMeasure<TFixedImage, TMovingImage>* self = const_cast< SimilarityMeasure<TFixedImage, TMovingImage>* >(this);
+  
+  typename TFixedImage::IndexType fixedMaskTransformedIndex; 
+  typename TMovingImage::IndexType movingMaskTransformedIndex; 
+  InputPointType inputPoint;
+  OutputPointType transformedPoint;
+  ContinuousIndex<double, TMovingImage::ImageDimension> movingImageTransformedIndex; 
+  
+  isSample = false;
+  
+  this->m_FixedImage->TransformIndexToPhysicalPoint( index, inputPoint );
+  
+  if(!this->m_FixedImageMask.IsNull() && 
+     (!fixedMask->GetImage()->TransformPhysicalPointToIndex(inputPoint, fixedMaskTransformedIndex) ||
+       fixedMask->GetImage()->GetPixel(fixedMaskTransformedIndex) == 0))
+    {
+      return m_TransformedMovingImagePadValue;
+    }
+  
+  transformedPoint = this->m_Transform->TransformPoint( inputPoint );
+  
+  if(!this->m_TwoSidedMetric && 
+     !this->m_MovingImageMask.IsNull() && 
+     (!movingMask->GetImage()->TransformPhysicalPointToIndex(transformedPoint, movingMaskTransformedIndex) || 
+       movingMask->GetImage()->GetPixel(movingMaskTransformedIndex) == 0))
+    {
+      return m_TransformedMovingImagePadValue;
+    }
+  
+  MovingImagePixelType movingValue = m_TransformedMovingImagePadValue;
+  
+  if( this->m_Interpolator->IsInsideBuffer( transformedPoint ) )
+    {
+      FixedImagePixelType fixedValue = fixedImageValue;
+      
+      if (!m_BoundsSetByUser || (fixedValue > this->m_FixedLowerBound && fixedValue <= this->m_FixedUpperBound))
+        {
+          this->m_MovingImage->TransformPhysicalPointToContinuousIndex(transformedPoint, movingImageTransformedIndex);
+          movingValue = (MovingImagePixelType)(this->m_Interpolator->EvaluateAtContinuousIndex(movingImageTransformedIndex));
+          
+          if (!m_BoundsSetByUser || (movingValue > this->m_MovingLowerBound && movingValue <= this->m_MovingUpperBound))
+            {
+              if (!m_UseWeighting)
+                {
+                  if (partial < 0)
+                    {
+                      self->AggregateCostFunctionPair(fixedValue, movingValue);
+                    }
+                  else
+                    {
+                      self->AggregatePartialCostFunctionPair(partial, fixedValue, movingValue);
+                    }
+                }
+              else
+                {
+                  double weight = std::min<double>(fabs(this->m_FixedDistanceMapInterpolator->EvaluateAtIndex(index)), 
+                                                   fabs(this->m_MovingDistanceMapInterpolator->EvaluateAtContinuousIndex(movingImageTransformedIndex))); 
+                  
+                  weight = std::min<double>(weight, m_WeightingDistanceThreshold)/m_WeightingDistanceThreshold; 
+                  
+                  if (partial < 0)
+                    {
+                      self->AggregateCostFunctionPairWithWeighting(fixedValue, movingValue, weight); 
+                    }
+                  else
+                    {
+                      self->AggregatePartialCostFunctionPairWithWeighting(partial, fixedValue, movingValue, weight); 
+                    }
+                }
+              isSample = true;
+            }
+        }
+    }
+  
+  return movingValue;
+}
+
+template <class TFixedImage, class TMovingImage> 
+long int
+SimilarityMeasure<TFixedImage, TMovingImage>
+::AggregatePartialCostFunction(unsigned int partial, const typename TFixedImage::RegionType& pieceRegion) const
+{
+  typedef itk::ImageRegionConstIteratorWithIndex<TFixedImage> IndexIteratorType;
+  typedef itk::ImageRegionIterator<TFixedImage> NonIndexIteratorType;
+  
+  IndexIteratorType fixedImageIterator(this->m_FixedImage, pieceRegion);
+  NonIndexIteratorType transformedMovingImageIterator(this->m_TransformedMovingImage, pieceRegion); 
+  
+  FixedMaskType* fixedMask = dynamic_cast<FixedMaskType*>(this->m_FixedImageMask.GetPointer()); 
+  MovingMaskType* movingMask = dynamic_cast<MovingMaskType*>(this->m_MovingImageMask.GetPointer()); 
+  
+  long int numberOfSamples = 0;
+  bool isSample = false;
+  
+  for (fixedImageIterator.GoToBegin(), transformedMovingImageIterator.GoToBegin();
+       !fixedImageIterator.IsAtEnd();
+       ++fixedImageIterator, ++transformedMovingImageIterator)
+    {
+      MovingImagePixelType movingValue = this->AggregateVoxel(partial, 
+                                                              fixedImageIterator.GetIndex(), 
+                                                              fixedImageIterator.Get(), 
+                                                              fixedMask, 
+                                                              movingMask, 
+                                                              isSample);
+      if (isSample)
+        {
+          numberOfSamples++;
+        }
+      transformedMovingImageIterator.Set((FixedImagePixelType)movingValue);
+    }
+  
+  return numberOfSamples;
+}
+
+template <class TFixedImage, class TMovingImage> 
+long int
+SimilarityMeasure<TFixedImage, TMovingImage>
+::AggregateSampledCostFunction(int partial, unsigned long first, unsigned long last) const
+{
+  FixedMaskType* fixedMask = dynamic_cast<FixedMaskType*>(this->m_FixedImageMask.GetPointer()); 
+  MovingMaskType* movingMask = dynamic_cast<MovingMaskType*>(this->m_MovingImageMask.GetPointer()); 
+  
+  const FixedImagePixelType* fixedBuffer = this->m_FixedImage->GetBufferPointer();
+  FixedImagePixelType* transformedMovingBuffer = this->m_TransformedMovingImage->GetBufferPointer();
+  
+  long int numberOfSamples = 0;
+  bool isSample = false;
+  
+  for (unsigned long i = first; i < last; i++)
+    {
+      OffsetValueType offset = m_SampledVoxels[i];
+      MovingImagePixelType movingValue = this->AggregateVoxel(partial, 
+                                                              this->m_FixedImage->ComputeIndex(offset), 
+                                                              fixedBuffer[offset], 
+                                                              fixedMask, 
+                                                              movingMask, 
+                                                              isSample);
+      if (isSample)
+        {
+          numberOfSamples++;
+        }
+      transformedMovingBuffer[offset] = (FixedImagePixelType)movingValue;
+    }
+  
+  return numberOfSamples;
+}
+
+template <class TFixedImage, class TMovingImage> 
+ITK_THREAD_RETURN_TYPE
+SimilarityMeasure<TFixedImage, TMovingImage>
+::PartialCostFunctionThreaderCallback( void *arg )
+{
+  ThreadIdType threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  ThreadIdType threadCount = ((MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+  PartialCostFunctionThreadStruct *str = (PartialCostFunctionThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+  
+  // Pieces are dealt out round robin. Each piece has its own partial, so it
+  // does not matter which thread evaluates it, or in which order.
+  try
+    {
+      typename TFixedImage::RegionType pieceRegion;
+      unsigned long numberOfSampledVoxels = str->Metric->m_SampledVoxels.size();
+      for (unsigned int i = threadId; i < str->NumberOfPieces; i += threadCount)
+        {
+          if (str->Metric->IsUsingSampledVoxels())
+            {
+              str->NumberOfSamples[i] = str->Metric->AggregateSampledCostFunction(i, 
+                                                                                  (numberOfSampledVoxels * i) / str->NumberOfPieces, 
+                                                                                  (numberOfSampledVoxels * (i + 1)) / str->NumberOfPieces);
+            }
+          else
+            {
+              str->Metric->SplitFixedRegion(str->FixedRegion, i, str->NumberOfPieces, pieceRegion);
+              str->NumberOfSamples[i] = str->Metric->AggregatePartialCostFunction(i, pieceRegion);
+            }
+        }
+    }
+  catch (std::exception& err)
+    {
+      str->ErrorMessages[threadId] = err.what();
+    }
+  
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template <class TFixedImage, class TMovingImage> 
+void
+SimilarityMeasure<TFixedImage, TMovingImage>
+::AggregatePartialCostFunctions(const typename TFixedImage::RegionType& fixedRegion) const
+{
+  SimilarityMeasure<TFixedImage, TMovingImage>* self = const_cast< SimilarityMeasure<TFixedImage, TMovingImage>* >(this);
+  
+  typename TFixedImage::RegionType pieceRegion;
+  unsigned int numberOfPieces = this->SplitFixedRegion(fixedRegion, 0, m_NumberOfPartialCostFunctions, pieceRegion);
+  if (this->IsUsingSampledVoxels())
+    {
+      numberOfPieces = m_NumberOfPartialCostFunctions;
+    }
+  ThreadIdType numberOfThreads = std::min(m_NumberOfThreads, (ThreadIdType)numberOfPieces);
+  
+  self->ResetPartialCostFunctions(numberOfPieces);
+  
+  PartialCostFunctionThreadStruct str;
+  str.Metric = this;
+  str.FixedRegion = fixedRegion;
+  str.NumberOfPieces = numberOfPieces;
+  str.NumberOfSamples.resize(numberOfPieces, 0);
+  str.ErrorMessages.resize(numberOfThreads);
+  
+  MultiThreader::Pointer threader = MultiThreader::New();
+  threader->SetNumberOfThreads(numberOfThreads);
+  threader->SetSingleMethod(PartialCostFunctionThreaderCallback, &str);
+  threader->SingleMethodExecute();
+  
+  for (unsigned int i = 0; i < str.ErrorMessages.size(); i++)
+    {
+      if (str.ErrorMessages[i].size() > 0)
+        {
+          itkExceptionMacro(<< "Failed to evaluate partial cost function:" << str.ErrorMessages[i]);
+        }
+    }
+  
+  // Combined in piece order, so the result is the same whatever the number of threads.
+  self->CombinePartialCostFunctions();
+  
+  for (unsigned int i = 0; i < numberOfPieces; i++)
+    {
+      this->m_NumberOfFixedSamples += str.NumberOfSamples[i];
+    }
+}
+
 template <class TFixedImage, class TMovingImage> 
 typename SimilarityMeasure<TFixedImage,TMovingImage>::MeasureType 
 SimilarityMeasure<TFixedImage, TMovingImage>
@@ -151,6 +151,13 @@ FFDGradientDescentOptimizer< TFixedImage, TMovingImage, TScalarType, TDeformatio
   // Set the current parameter/deformation. 
   transform->SetParameters(current);
 
+  // The forces need the whole transformed moving image, so if the metric
+  // is only sampling voxels, evaluate it on all of them at the current position.
+  if (this->m_ImageToImageMetric->GetSamplingStrategy() != Superclass::ImageToImageMetricType::SAMPLING_ALL_VOXELS)
+    {
+      this->m_ImageToImageMetric->GetValueUsingAllVoxels(current);
+    }
+
   niftkitkDebugMacro(<< "GetGradient():Fixed image at address=" << this->m_FixedImage \
       << ", size=" << this->m_FixedImage->GetLargestPossibleRegion().GetSize() \
       << ", spacing=" << this->m_FixedImage->GetSpacing() \
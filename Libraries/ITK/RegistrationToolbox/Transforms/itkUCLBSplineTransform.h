@@ -21,11 +21,14 @@
 #include <itkImageRegion.h>
 #include <itkVector.h>
 #include <itkArray2D.h>
+#include <itkMultiThreader.h>
 
 #include <itkContinuousIndex.h>
 #include <itkImageRegionIterator.h>
 #include <itkSingleValuedCostFunction.h>
 #include <itkScalarImageToNormalizedGradientVectorImageFilter.h>
+#include <string>
+#include <vector>
 
 namespace itk
 {
@@ -199,6 +202,22 @@ public:
   /** Declared virtual in base class, transform points*/
   virtual OutputPointType  TransformPoint(const InputPointType  &point ) const;
 
+  /**
+   * Set/Get the number of threads used to interpolate the deformation field
+   * from the grid. Default MultiThreader::GetGlobalDefaultNumberOfThreads().
+   */
+  itkSetClampMacro(NumberOfThreads, ThreadIdType, 1, ITK_MAX_THREADS);
+  itkGetMacro(NumberOfThreads, ThreadIdType);
+
+  /**
+   * Set/Get whether the deformation field is interpolated separably, one axis at
+   * a time, with slabs of the field on different threads. Otherwise the original,
+   * single threaded, 64 point per voxel loops are used. Default true.
+   */
+  itkSetMacro(UseThreadedInterpolation, bool);
+  itkGetMacro(UseThreadedInterpolation, bool);
+  itkBooleanMacro(UseThreadedInterpolation);
+
 protected:
 
   UCLBSplineTransform();
@@ -225,6 +244,29 @@ private:
   BendingEnergyImagePointer            m_BendingEnergyGrid;
   BendingEnergyDerivativeFilterPointer m_BendingEnergyDerivativeFilter;
   
+  /** Fills in the deformation field, threaded or not, according to UseThreadedInterpolation. */
+  void InterpolateDeformationField();
+
+  /** Fills in the deformation field for 2D or 3D, a slab of the last axis per thread. */
+  void InterpolateDeformationFieldThreaded();
+
+  /** Fills in slices [begin, end) of the last axis of the deformation field. */
+  void InterpolateDeformationFieldSlices(SizeValueType begin, SizeValueType end);
+
+  /** Rebuilds the per axis control points and weights, if the field or grid geometry has changed. */
+  void UpdateInterpolationTables();
+
+  /** Static function used as a "callback" by the MultiThreader. */
+  static ITK_THREAD_RETURN_TYPE InterpolateDeformationFieldThreaderCallback(void *arg);
+
+  /** Data passed to each thread by InterpolateDeformationFieldThreaded(). */
+  struct InterpolateDeformationFieldThreadStruct
+  {
+    Self                     *Transform;
+    SizeValueType             NumberOfSlices;
+    std::vector<std::string>  ErrorMessages;
+  };
+
   /** Fills in the deformation field for 2D. */
   void InterpolateDeformationField2D();
   
@@ -264,6 +306,26 @@ private:
   Array2D<TScalarType>    m_Lookup1stDerivative;
   Array2D<TScalarType>    m_Lookup2ndDerivative;
 
+  /** For threaded interpolation. */
+  ThreadIdType            m_NumberOfThreads;
+  bool                    m_UseThreadedInterpolation;
+
+  /**
+   * For each voxel along each axis of the field, the 4 control points it depends on
+   * along that axis, and their BSpline weights. Control points outside the grid are
+   * clamped to it, with a weight of zero, so the interpolation needs no bounds checks.
+   */
+  std::vector<IndexValueType>      m_InterpolationControlPoints[NDimensions];
+  std::vector<TDeformationScalar>  m_InterpolationWeights[NDimensions];
+
+  /** The field and grid geometry that the tables above were built for. */
+  DeformationFieldRegionType       m_InterpolationFieldRegion;
+  DeformationFieldSpacingType      m_InterpolationFieldSpacing;
+  DeformationFieldOriginType       m_InterpolationFieldOrigin;
+  GridSizeType                     m_InterpolationGridSize;
+  GridSpacingType                  m_InterpolationGridSpacing;
+  GridOriginType                   m_InterpolationGridOrigin;
+
   TScalarType B0(TScalarType u)  { return ((1-u)*(1-u)*(1-u))/6.0; } 
   TScalarType B1(TScalarType u)  { return (3*u*u*u - 6*u*u + 4)/6.0; }
   TScalarType B2(TScalarType u)  { return (-3*u*u*u + 3*u*u + 3*u + 1)/6.0; }
@@ -20,6 +20,7 @@
 #include <itkIdentityTransform.h>
 #include <vnl/algo/vnl_matrix_inverse.h>
 #include <niftkConversionUtils.h>
+#include <algorithm>
 #include <iostream>
 
 namespace itk
@@ -35,6 +36,9 @@ UCLBSplineTransform<TFixedImage, TScalarType,NDimensions, TDeformationScalar>
   this->m_BendingEnergyHasBeenUpdatedFlag = false;
   this->m_BendingEnergyDerivativeFilter = BendingEnergyDerivativeFilterType::New();
   
+  this->m_NumberOfThreads = MultiThreader::GetGlobalDefaultNumberOfThreads();
+  this->m_UseThreadedInterpolation = true;
+
   // Filling lookup table.
   
   m_Lookup.SetSize(s_LookupTableRows, s_LookupTableCols);
@@ -74,6 +78,8 @@ UCLBSplineTransform<TFixedImage, TScalarType,NDimensions, TDeformationScalar>
 {
   Superclass::PrintSelf(os,indent);  
   os << indent << "Grid of control points: " << std::endl << m_Grid << std::endl;
+  os << indent << "NumberOfThreads: " << m_NumberOfThreads << std::endl;
+  os << indent << "UseThreadedInterpolation: " << m_UseThreadedInterpolation << std::endl;
 }
 
 template <class TFixedImage, class TScalarType, unsigned int NDimensions, class TDeformationScalar>
@@ -259,18 +265,7 @@ UCLBSplineTransform<TFixedImage, TScalarType,NDimensions, TDeformationScalar>
   
   niftkitkDebugMacro(<< "SetParameters():Done marshalling into grid, now updating vector field");
 
-  if (NDimensions == 2)
-    {
-      this->InterpolateDeformationField2D();  
-    }
-  else if (NDimensions == 3)
-    {
-      this->InterpolateDeformationField3DMarc();  
-    } 
-  else 
-    {
-      itkExceptionMacro(<<"Wrong number of dimensions, this class only supports 2D or 3D transforms");
-    } 
+  this->InterpolateDeformationField();
 
   // Just forcing this to make sure if you ask for Jacobian, its up to date.
   this->m_DeformationField->Modified();
@@ -281,6 +276,308 @@ UCLBSplineTransform<TFixedImage, TScalarType,NDimensions, TDeformationScalar>
       << ", and grid size:" << this->m_Grid->GetLargestPossibleRegion().GetSize());        
 }
 
+template <class TFixedImage, class TScalarType, unsigned int NDimensions, class TDeformationScalar>
+void
+UCLBSplineTransform<TFixedImage, TScalarType, NDimensions, TDeformationScalar>
+::InterpolateDeformationField()
+{
+  if (NDimensions != 2 && NDimensions != 3)
+    {
+      itkExceptionMacro(<<"Wrong number of dimensions, this class only supports 2D or 3D transforms");
+    }
+
+  if (m_UseThreadedInterpolation)
+    {
+      this->InterpolateDeformationFieldThreaded();
+    }
+  else if (NDimensions == 2)
+    {
+      this->InterpolateDeformationField2D();
+    }
+  else
+    {
+      this->InterpolateDeformationField3DMarc();
+    }
+}
+
+template <class TFixedImage, class TScalarType, unsigned int NDimensions, class TDeformationScalar>
+void
+UCLBSplineTransform<TFixedImage, TScalarType, NDimensions, TDeformationScalar>
+::UpdateInterpolationTables()
+{
+  DeformationFieldRegionType  fieldRegion  = this->m_DeformationField->GetLargestPossibleRegion();
+  DeformationFieldSpacingType fieldSpacing = this->m_DeformationField->GetSpacing();
+  DeformationFieldOriginType  fieldOrigin  = this->m_DeformationField->GetOrigin();
+  GridSizeType                gridSize     = m_Grid->GetLargestPossibleRegion().GetSize();
+  GridSpacingType             gridSpacing  = m_Grid->GetSpacing();
+  GridOriginType              gridOrigin   = m_Grid->GetOrigin();
+
+  // The tables only depend on the geometry, so are normally built once per grid level.
+  if (!m_InterpolationWeights[0].empty()
+      && fieldRegion  == m_InterpolationFieldRegion
+      && fieldSpacing == m_InterpolationFieldSpacing
+      && fieldOrigin  == m_InterpolationFieldOrigin
+      && gridSize     == m_InterpolationGridSize
+      && gridSpacing  == m_InterpolationGridSpacing
+      && gridOrigin   == m_InterpolationGridOrigin)
+    {
+      return;
+    }
+
+  niftkitkDebugMacro(<< "UpdateInterpolationTables():Rebuilding for field region:" << fieldRegion << ", gridSize:" << gridSize);
+
+  for (unsigned int d = 0; d < NDimensions; d++)
+    {
+      SizeValueType fieldSize = fieldRegion.GetSize(d);
+
+      m_InterpolationControlPoints[d].resize(4 * fieldSize);
+      m_InterpolationWeights[d].resize(4 * fieldSize);
+
+      for (SizeValueType i = 0; i < fieldSize; i++)
+        {
+          IndexValueType     first = 0;
+          TDeformationScalar weights[4];
+
+          if (NDimensions == 2)
+            {
+              // As InterpolateDeformationField2D(), from the world coordinate, using the lookup table.
+              TScalarType        fieldPoint  = ((fieldRegion.GetIndex(d) + (IndexValueType)i) * fieldSpacing[d]) + fieldOrigin[d];
+              TDeformationScalar gridVoxel   = (fieldPoint - gridOrigin[d]) / gridSpacing[d];
+              IndexValueType     gridClosest = (int)floor(gridVoxel);
+              TScalarType        gridBasis   = gridVoxel - gridClosest;
+              int                rounded     = (int)niftk::Round(gridBasis*s_LookupTableSize);
+
+              first = gridClosest - 1;
+              for (unsigned int k = 0; k < 4; k++)
+                {
+                  weights[k] = this->m_Lookup[rounded][k];
+                }
+            }
+          else
+            {
+              // As InterpolateDeformationField3DMarc(), from the voxel index, with the grid spanning the field.
+              double gridVoxelSpacing = (float)fieldSize/(float)(gridSize[d]-1);
+              int pre = (int)((float)i/gridVoxelSpacing);
+              float basis = (float)i/gridVoxelSpacing-(float)pre;
+              if (basis < 0.0) basis = 0.0; //rounding error
+              float FF = basis*basis;
+              float FFF = FF*basis;
+              float MF = 1.0-basis;
+
+              first = pre - 1;
+              weights[0] = (MF)*(MF)*(MF)/6.0;
+              weights[1] = (3.0*FFF - 6.0*FF +4.0)/6.0;
+              weights[2] = (-3.0*FFF + 3.0*FF + 3.0*basis +1.0)/6.0;
+              weights[3] = FFF/6.0;
+            }
+
+          for (unsigned int k = 0; k < 4; k++)
+            {
+              IndexValueType controlPoint = first + k;
+
+              if (controlPoint < 0 || controlPoint >= (IndexValueType)gridSize[d])
+                {
+                  m_InterpolationControlPoints[d][4*i + k] = std::min(std::max(controlPoint, (IndexValueType)0), (IndexValueType)gridSize[d] - 1);
+                  m_InterpolationWeights[d][4*i + k] = 0;
+                }
+              else
+                {
+                  m_InterpolationControlPoints[d][4*i + k] = controlPoint;
+                  m_InterpolationWeights[d][4*i + k] = weights[k];
+                }
+            }
+        }
+    }
+
+  m_InterpolationFieldRegion  = fieldRegion;
+  m_InterpolationFieldSpacing = fieldSpacing;
+  m_InterpolationFieldOrigin  = fieldOrigin;
+  m_InterpolationGridSize     = gridSize;
+  m_InterpolationGridSpacing  = gridSpacing;
+  m_InterpolationGridOrigin   = gridOrigin;
+}
+
+template <class TFixedImage, class TScalarType, unsigned int NDimensions, class TDeformationScalar>
+void
+UCLBSplineTransform<TFixedImage, TScalarType, NDimensions, TDeformationScalar>
+::InterpolateDeformationFieldThreaded()
+{
+  this->UpdateInterpolationTables();
+
+  SizeValueType numberOfSlices = this->m_DeformationField->GetLargestPossibleRegion().GetSize(NDimensions - 1);
+  if (numberOfSlices == 0)
+    {
+      return;
+    }
+
+  ThreadIdType numberOfThreads = std::min(m_NumberOfThreads, (ThreadIdType)std::min(numberOfSlices, (SizeValueType)ITK_MAX_THREADS));
+
+  niftkitkDebugMacro(<< "InterpolateDeformationFieldThreaded():Started, slices:" << numberOfSlices << ", threads:" << numberOfThreads);
+
+  InterpolateDeformationFieldThreadStruct str;
+  str.Transform = this;
+  str.NumberOfSlices = numberOfSlices;
+  str.ErrorMessages.resize(numberOfThreads);
+
+  MultiThreader::Pointer threader = MultiThreader::New();
+  threader->SetNumberOfThreads(numberOfThreads);
+  threader->SetSingleMethod(InterpolateDeformationFieldThreaderCallback, &str);
+  threader->SingleMethodExecute();
+
+  for (unsigned int i = 0; i < str.ErrorMessages.size(); i++)
+    {
+      if (str.ErrorMessages[i].size() > 0)
+        {
+          itkExceptionMacro(<< "Failed to interpolate deformation field:" << str.ErrorMessages[i]);
+        }
+    }
+
+  niftkitkDebugMacro(<< "InterpolateDeformationFieldThreaded():Finished");
+}
+
+template <class TFixedImage, class TScalarType, unsigned int NDimensions, class TDeformationScalar>
+ITK_THREAD_RETURN_TYPE
+UCLBSplineTransform<TFixedImage, TScalarType, NDimensions, TDeformationScalar>
+::InterpolateDeformationFieldThreaderCallback(void *arg)
+{
+  ThreadIdType threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  ThreadIdType threadCount = ((MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+  InterpolateDeformationFieldThreadStruct *str = (InterpolateDeformationFieldThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  // Each thread fills a contiguous slab, so its writes stay in its own part of the field.
+  try
+    {
+      str->Transform->InterpolateDeformationFieldSlices((str->NumberOfSlices * threadId) / threadCount,
+                                                        (str->NumberOfSlices * (threadId + 1)) / threadCount);
+    }
+  catch (std::exception& err)
+    {
+      str->ErrorMessages[threadId] = err.what();
+    }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template <class TFixedImage, class TScalarType, unsigned int NDimensions, class TDeformationScalar>
+void
+UCLBSplineTransform<TFixedImage, TScalarType, NDimensions, TDeformationScalar>
+::InterpolateDeformationFieldSlices(SizeValueType begin, SizeValueType end)
+{
+  // The BSpline is separable, so rather than summing 4x4x4 control points for every
+  // voxel, each slice first sums 4 planes of the grid into one, each row of voxels
+  // sums 4 rows of that plane into one, and each voxel sums 4 control points of that
+  // row. The plane and row are small, and held one component at a time, so these
+  // sums are simple loops over contiguous memory.
+
+  const unsigned int          sliceAxis     = NDimensions - 1;
+  DeformationFieldSizeType    fieldSize     = this->m_DeformationField->GetLargestPossibleRegion().GetSize();
+  GridSizeType                gridSize      = m_Grid->GetLargestPossibleRegion().GetSize();
+  const GridPixelType        *grid          = m_Grid->GetBufferPointer();
+  DeformationFieldPixelType  *field         = this->m_DeformationField->GetBufferPointer();
+  SizeValueType               gridRowSize   = gridSize[0];
+  SizeValueType               gridPlaneSize = gridSize[0] * gridSize[1];
+
+  std::vector<TDeformationScalar> plane(NDimensions * gridPlaneSize, 0);
+  std::vector<TDeformationScalar> row(NDimensions * gridRowSize, 0);
+
+  if (NDimensions == 2)
+    {
+      // In 2D, the plane is the whole grid.
+      for (SizeValueType j = 0; j < gridPlaneSize; j++)
+        {
+          for (unsigned int d = 0; d < NDimensions; d++)
+            {
+              plane[d * gridPlaneSize + j] = grid[j][d];
+            }
+        }
+    }
+
+  const IndexValueType     *xControlPoints = &m_InterpolationControlPoints[0][0];
+  const TDeformationScalar *xWeights       = &m_InterpolationWeights[0][0];
+
+  for (SizeValueType slice = begin; slice < end; slice++)
+    {
+      SizeValueType yBegin = slice;
+      SizeValueType yEnd   = slice + 1;
+
+      if (NDimensions == 3)
+        {
+          yBegin = 0;
+          yEnd   = fieldSize[1];
+
+          const IndexValueType     *zControlPoints = &m_InterpolationControlPoints[sliceAxis][4 * slice];
+          const TDeformationScalar *zWeights       = &m_InterpolationWeights[sliceAxis][4 * slice];
+
+          std::fill(plane.begin(), plane.end(), 0);
+
+          for (unsigned int k = 0; k < 4; k++)
+            {
+              TDeformationScalar weight = zWeights[k];
+              if (weight == 0)
+                {
+                  continue;
+                }
+
+              const GridPixelType *gridPlane = grid + zControlPoints[k] * gridPlaneSize;
+
+              for (SizeValueType j = 0; j < gridPlaneSize; j++)
+                {
+                  for (unsigned int d = 0; d < NDimensions; d++)
+                    {
+                      plane[d * gridPlaneSize + j] += weight * gridPlane[j][d];
+                    }
+                }
+            }
+        }
+
+      for (SizeValueType y = yBegin; y < yEnd; y++)
+        {
+          const IndexValueType     *yControlPoints = &m_InterpolationControlPoints[1][4 * y];
+          const TDeformationScalar *yWeights       = &m_InterpolationWeights[1][4 * y];
+
+          std::fill(row.begin(), row.end(), 0);
+
+          for (unsigned int k = 0; k < 4; k++)
+            {
+              TDeformationScalar weight = yWeights[k];
+              if (weight == 0)
+                {
+                  continue;
+                }
+
+              for (unsigned int d = 0; d < NDimensions; d++)
+                {
+                  const TDeformationScalar *planeRow = &plane[d * gridPlaneSize + yControlPoints[k] * gridRowSize];
+                  TDeformationScalar       *rowValues = &row[d * gridRowSize];
+
+                  for (SizeValueType j = 0; j < gridRowSize; j++)
+                    {
+                      rowValues[j] += weight * planeRow[j];
+                    }
+                }
+            }
+
+          DeformationFieldPixelType *fieldRow = field + (NDimensions == 3 ? slice * fieldSize[1] + y : y) * fieldSize[0];
+
+          for (SizeValueType x = 0; x < fieldSize[0]; x++)
+            {
+              const IndexValueType     *controlPoints = xControlPoints + 4 * x;
+              const TDeformationScalar *weights       = xWeights + 4 * x;
+
+              for (unsigned int d = 0; d < NDimensions; d++)
+                {
+                  const TDeformationScalar *rowValues = &row[d * gridRowSize];
+
+                  fieldRow[x][d] = weights[0] * rowValues[controlPoints[0]]
+                                 + weights[1] * rowValues[controlPoints[1]]
+                                 + weights[2] * rowValues[controlPoints[2]]
+                                 + weights[3] * rowValues[controlPoints[3]];
+                }
+            }
+        }
+    }
+}
+
 template <class TFixedImage, class TScalarType, unsigned int NDimensions, class TDeformationScalar>
 void
 UCLBSplineTransform<TFixedImage, TScalarType, NDimensions, TDeformationScalar>
@@ -1460,18 +1757,7 @@ UCLBSplineTransform<TFixedImage, TScalarType,NDimensions, TDeformationScalar>
   Superclass::Initialize(image);
 
   // So, we need to take the existing parameters, and update the deformation field.
-  if (NDimensions == 2)
-    {
-      this->InterpolateDeformationField2D();  
-    }
-  else if (NDimensions == 3)
-    {
-      this->InterpolateDeformationField3DMarc();  
-    } 
-  else 
-    {
-      itkExceptionMacro(<<"Wrong number of dimensions, this class only supports 2D or 3D transforms");
-    } 
+  this->InterpolateDeformationField();
 
       niftkitkDebugMacro(<< "InterpolateNextGrid():AFTER min def=" << niftk::ConvertToString(this->ComputeMinDeformation()) \
           << ", max def=" << niftk::ConvertToString(this->ComputeMaxDeformation()) \
@@ -0,0 +1,114 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#include "itkMIDASImageUpdateHistory.h"
+
+#include <itkSimpleFastMutexLock.h>
+#include <itkMutexLockHolder.h>
+
+#include <list>
+#include <utility>
+
+namespace itk
+{
+
+namespace
+{
+  typedef std::list< std::pair<MIDASImageUpdateHistory::Entry*, std::size_t> > EntryListType;
+
+  SimpleFastMutexLock s_Mutex;
+  EntryListType s_Entries;
+  std::size_t s_MemoryInUse = 0;
+  std::size_t s_MemoryLimit = 512 * 1024 * 1024;
+}
+
+
+//-----------------------------------------------------------------------------
+void MIDASImageUpdateHistory::SetMemoryLimit(std::size_t bytes)
+{
+  MutexLockHolder<SimpleFastMutexLock> lock(s_Mutex);
+  s_MemoryLimit = bytes;
+  EvictOldestEntries();
+}
+
+
+//-----------------------------------------------------------------------------
+std::size_t MIDASImageUpdateHistory::GetMemoryLimit()
+{
+  MutexLockHolder<SimpleFastMutexLock> lock(s_Mutex);
+  return s_MemoryLimit;
+}
+
+
+//-----------------------------------------------------------------------------
+std::size_t MIDASImageUpdateHistory::GetMemoryInUse()
+{
+  MutexLockHolder<SimpleFastMutexLock> lock(s_Mutex);
+  return s_MemoryInUse;
+}
+
+
+//-----------------------------------------------------------------------------
+void MIDASImageUpdateHistory::AddEntry(Entry* entry, std::size_t bytes)
+{
+  MutexLockHolder<SimpleFastMutexLock> lock(s_Mutex);
+
+  for (EntryListType::iterator iter = s_Entries.begin(); iter != s_Entries.end(); ++iter)
+  {
+    if (iter->first == entry)
+    {
+      s_MemoryInUse -= iter->second;
+      s_Entries.erase(iter);
+      break;
+    }
+  }
+
+  s_Entries.push_back(std::make_pair(entry, bytes));
+  s_MemoryInUse += bytes;
+
+  EvictOldestEntries();
+}
+
+
+//-----------------------------------------------------------------------------
+void MIDASImageUpdateHistory::RemoveEntry(Entry* entry)
+{
+  MutexLockHolder<SimpleFastMutexLock> lock(s_Mutex);
+
+  for (EntryListType::iterator iter = s_Entries.begin(); iter != s_Entries.end(); ++iter)
+  {
+    if (iter->first == entry)
+    {
+      s_MemoryInUse -= iter->second;
+      s_Entries.erase(iter);
+      break;
+    }
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+void MIDASImageUpdateHistory::EvictOldestEntries()
+{
+  while (s_MemoryLimit > 0 && s_MemoryInUse > s_MemoryLimit && s_Entries.size() > 1)
+  {
+    Entry* oldestEntry = s_Entries.front().first;
+    s_MemoryInUse -= s_Entries.front().second;
+    s_Entries.pop_front();
+
+    oldestEntry->ReleaseUndoData();
+  }
+}
+
+}
@@ -0,0 +1,78 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#ifndef itkMIDASImageUpdateHistory_h
+#define itkMIDASImageUpdateHistory_h
+
+#include <niftkITKWin32ExportHeader.h>
+
+#include <cstddef>
+
+namespace itk
+{
+
+/**
+ * \class MIDASImageUpdateHistory
+ * \brief Keeps account of the memory used for undo/redo by the MIDAS image update
+ * processors, and when it goes over a limit, releases the undo data of the oldest.
+ *
+ * The MITK undo stack owns the operations, and with them the processors, so it can't be
+ * trimmed from here. Instead, each processor registers its undo data once it has been
+ * calculated, and if the total goes over the memory limit, the undo data of the processors
+ * that registered first is released, until the total is back under the limit. Undoing one
+ * of those operations then fails with an exception, rather than the workstation running
+ * out of memory. The newest entry is never released, even if it is over the limit on its own.
+ */
+class NIFTKITK_WINEXPORT MIDASImageUpdateHistory
+{
+
+public:
+
+  /**
+   * \class Entry
+   * \brief Interface for objects whose undo data is accounted for in the history.
+   */
+  class NIFTKITK_WINEXPORT Entry
+  {
+  public:
+    virtual ~Entry() {}
+
+    /** Called by the history to evict the undo data. Must not call back into the history. */
+    virtual void ReleaseUndoData() = 0;
+  };
+
+  /** Set the memory limit in bytes, which releases the oldest undo data if the total is now over it. Zero means no limit. Default 512MB. */
+  static void SetMemoryLimit(std::size_t bytes);
+  static std::size_t GetMemoryLimit();
+
+  /** Get the number of bytes of undo data currently registered. */
+  static std::size_t GetMemoryInUse();
+
+  /** Register, or re-register with a new size, the undo data of entry as the newest. */
+  static void AddEntry(Entry* entry, std::size_t bytes);
+
+  /** Unregister entry, eg. when it is destroyed, without calling ReleaseUndoData(). */
+  static void RemoveEntry(Entry* entry);
+
+private:
+
+  MIDASImageUpdateHistory(); // purposely not implemented
+
+  /** Releases the oldest entries, apart from the newest, until the total is within the limit. Call with the lock held. */
+  static void EvictOldestEntries();
+};
+
+}
+
+#endif
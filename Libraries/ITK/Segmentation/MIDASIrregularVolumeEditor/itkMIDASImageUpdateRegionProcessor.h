@@ -16,8 +16,11 @@
 #define itkMIDASImageUpdateRegionProcessor_h
 
 #include "itkMIDASImageUpdateProcessor.h"
+#include "itkMIDASImageUpdateHistory.h"
 #include <itkExtractImageFilter.h>
 #include <itkPasteImageFilter.h>
+#include <cstddef>
+#include <vector>
 
 namespace itk
 {
@@ -25,9 +28,18 @@ namespace itk
 /**
  * \class MIDASImageUpdateRegionProcessor
  * \brief Provides methods to do Undo/Redo within a specific Region.
+ *
+ * The update is calculated on a copy of the region, the first time Redo() is called.
+ * By default, only the voxels that the update changed are then kept, as runs of
+ * voxels along the first axis that change from one value to another. For binary
+ * segmentations, this is usually a tiny fraction of the two copies of the region
+ * that are otherwise kept for Undo/Redo. The undo data is registered with
+ * MIDASImageUpdateHistory, which may release it to keep within a memory limit.
  */
 template <class TPixel, unsigned int VImageDimension>
-class ITK_EXPORT MIDASImageUpdateRegionProcessor : public MIDASImageUpdateProcessor<TPixel, VImageDimension>
+class ITK_EXPORT MIDASImageUpdateRegionProcessor
+  : public MIDASImageUpdateProcessor<TPixel, VImageDimension>
+  , public MIDASImageUpdateHistory::Entry
 {
 
 public:
@@ -60,16 +72,29 @@ public:
   /** Overloaded method to provide simple acess via a std::vector, where we assume the length is 6 corresponding to the first 3 numbers indicating the starting index, and the next 3 numbers indicating the region size. */
   void SetDestinationRegionOfInterest(std::vector<int> &region);
 
-  /** This will copy the m_BeforeImage into the m_DestinationImage */
+  /** If true, only the changed voxels are kept for Undo/Redo, rather than copies of the whole region before and after. Set before the first Redo(). Default true. */
+  itkSetMacro(StoreDifferencesOnly, bool)
+  itkGetMacro(StoreDifferencesOnly, bool)
+
+  /** Returns the number of bytes held for Undo/Redo. */
+  std::size_t GetUndoDataSize() const;
+
+  /** Returns true if the undo data was released by MIDASImageUpdateHistory, after which Undo() and Redo() throw. */
+  bool GetUndoDataReleased() const { return m_UndoDataReleased; }
+
+  /** This will copy the m_BeforeImage, or the voxels before the update, into the m_DestinationImage */
   virtual void Undo() override;
 
-  /** This will copy the m_AfterImage into the m_DestinationImage. This method should also be called to execute the whole process first time round. */
+  /** This will copy the m_AfterImage, or the voxels after the update, into the m_DestinationImage. This method should also be called to execute the whole process first time round. */
   virtual void Redo() override;
 
+  /** Releases the undo data, after which Undo() and Redo() throw. Called by MIDASImageUpdateHistory. */
+  virtual void ReleaseUndoData() override;
+
 protected:
   MIDASImageUpdateRegionProcessor();
   void PrintSelf(std::ostream& os, Indent indent) const override;
-  virtual ~MIDASImageUpdateRegionProcessor() {}
+  virtual ~MIDASImageUpdateRegionProcessor();
 
   /** Returns the after image, so derived classes can apply an update. */
   itkGetObjectMacro(AfterImage, ImageType)
@@ -86,11 +111,31 @@ private:
 
   void CopyImageRegionToDestination(ImagePointer sourceImage);
 
+  /** A run of voxels along the first axis, that the update changed from Before to After. Offset is within m_DifferenceRegion. */
+  struct DifferenceRun
+  {
+    OffsetValueType Offset;
+    unsigned int    Length;
+    TPixel          Before;
+    TPixel          After;
+  };
+
+  /** Works out m_DifferenceRuns from m_BeforeImage and m_AfterImage. */
+  void CalculateDifferenceRuns();
+
+  /** Writes the Before or After value of each run into the destination image. */
+  void CopyDifferenceRunsToDestination(bool useAfterValues);
+
   bool         m_UpdateCalculated;
   RegionType   m_DestinationRegionOfInterest;
   ImagePointer m_BeforeImage;
   ImagePointer m_AfterImage;
 
+  bool                       m_StoreDifferencesOnly;
+  bool                       m_UndoDataReleased;
+  RegionType                 m_DifferenceRegion;
+  std::vector<DifferenceRun> m_DifferenceRuns;
+
 };
 
 }
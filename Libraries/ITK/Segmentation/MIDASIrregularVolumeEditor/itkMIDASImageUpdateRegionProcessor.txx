@@ -13,6 +13,8 @@
 =============================================================================*/
 
 #include "itkMIDASImageUpdateRegionProcessor.h"
+#include <itkImageRegionConstIterator.h>
+#include <algorithm>
 
 namespace itk
 {
@@ -23,6 +25,8 @@ MIDASImageUpdateRegionProcessor<TPixel, VImageDimension>
 : m_UpdateCalculated(false)
 , m_BeforeImage(0)
 , m_AfterImage(0)
+, m_StoreDifferencesOnly(true)
+, m_UndoDataReleased(false)
 {
   SizeType size;
   size.Fill(0);
@@ -38,6 +42,13 @@ MIDASImageUpdateRegionProcessor<TPixel, VImageDimension>
   m_AfterImage = ImageType::New();
 }
 
+template<class TPixel, unsigned int VImageDimension>
+MIDASImageUpdateRegionProcessor<TPixel, VImageDimension>
+::~MIDASImageUpdateRegionProcessor()
+{
+  MIDASImageUpdateHistory::RemoveEntry(this);
+}
+
 template<class TPixel, unsigned int VImageDimension>
 void
 MIDASImageUpdateRegionProcessor<TPixel, VImageDimension>
@@ -50,6 +61,125 @@ MIDASImageUpdateRegionProcessor<TPixel, VImageDimension>
   os << indent.GetNextIndent() << m_BeforeImage << std::endl;
   os << indent << "m_AfterImage=" << std::endl;
   os << indent.GetNextIndent() << m_AfterImage << std::endl;
+  os << indent << "m_StoreDifferencesOnly=" << m_StoreDifferencesOnly << std::endl;
+  os << indent << "m_UndoDataReleased=" << m_UndoDataReleased << std::endl;
+  os << indent << "m_DifferenceRuns.size()=" << m_DifferenceRuns.size() << std::endl;
+}
+
+template<class TPixel, unsigned int VImageDimension>
+std::size_t
+MIDASImageUpdateRegionProcessor<TPixel, VImageDimension>
+::GetUndoDataSize() const
+{
+  std::size_t size = m_DifferenceRuns.capacity() * sizeof(DifferenceRun);
+
+  if (m_BeforeImage.IsNotNull())
+  {
+    size += m_BeforeImage->GetBufferedRegion().GetNumberOfPixels() * sizeof(TPixel);
+  }
+  if (m_AfterImage.IsNotNull())
+  {
+    size += m_AfterImage->GetBufferedRegion().GetNumberOfPixels() * sizeof(TPixel);
+  }
+  return size;
+}
+
+template<class TPixel, unsigned int VImageDimension>
+void
+MIDASImageUpdateRegionProcessor<TPixel, VImageDimension>
+::ReleaseUndoData()
+{
+  m_BeforeImage = NULL;
+  m_AfterImage = NULL;
+  std::vector<DifferenceRun>().swap(m_DifferenceRuns);
+  m_UndoDataReleased = true;
+}
+
+template<class TPixel, unsigned int VImageDimension>
+void
+MIDASImageUpdateRegionProcessor<TPixel, VImageDimension>
+::CalculateDifferenceRuns()
+{
+  m_DifferenceRegion = m_BeforeImage->GetLargestPossibleRegion();
+  m_DifferenceRuns.clear();
+
+  const OffsetValueType rowLength = m_DifferenceRegion.GetSize()[0];
+
+  ImageRegionConstIterator<ImageType> beforeIterator(m_BeforeImage, m_DifferenceRegion);
+  ImageRegionConstIterator<ImageType> afterIterator(m_AfterImage, m_DifferenceRegion);
+
+  OffsetValueType offset = 0;
+  bool isInRun = false;
+
+  for (beforeIterator.GoToBegin(), afterIterator.GoToBegin(); !beforeIterator.IsAtEnd(); ++beforeIterator, ++afterIterator, ++offset)
+  {
+    // Runs don't go past the end of a row, so they are contiguous in the destination image too.
+    if (offset % rowLength == 0)
+    {
+      isInRun = false;
+    }
+
+    const TPixel before = beforeIterator.Get();
+    const TPixel after = afterIterator.Get();
+
+    if (before == after)
+    {
+      isInRun = false;
+    }
+    else if (isInRun && m_DifferenceRuns.back().Before == before && m_DifferenceRuns.back().After == after)
+    {
+      m_DifferenceRuns.back().Length++;
+    }
+    else
+    {
+      DifferenceRun run;
+      run.Offset = offset;
+      run.Length = 1;
+      run.Before = before;
+      run.After = after;
+      m_DifferenceRuns.push_back(run);
+      isInRun = true;
+    }
+  }
+
+  // Don't keep the spare capacity.
+  std::vector<DifferenceRun>(m_DifferenceRuns).swap(m_DifferenceRuns);
+
+  itkDebugMacro( << "ImageUpdateProcessor::Stored " << m_DifferenceRuns.size() << " runs of changed voxels, from region=\n" << m_DifferenceRegion);
+}
+
+template<class TPixel, unsigned int VImageDimension>
+void
+MIDASImageUpdateRegionProcessor<TPixel, VImageDimension>
+::CopyDifferenceRunsToDestination(bool useAfterValues)
+{
+  ImagePointer destinationImage = this->GetDestinationImage();
+
+  if (!destinationImage->GetBufferedRegion().IsInside(m_DifferenceRegion))
+  {
+    itkExceptionMacro(<< "Region of changed voxels=\n" << m_DifferenceRegion << ", is not inside destination region=\n" << destinationImage->GetBufferedRegion());
+  }
+
+  TPixel* destinationBuffer = destinationImage->GetBufferPointer();
+  const SizeType size = m_DifferenceRegion.GetSize();
+
+  for (std::size_t i = 0; i < m_DifferenceRuns.size(); i++)
+  {
+    const DifferenceRun& run = m_DifferenceRuns[i];
+
+    IndexType runIndex = m_DifferenceRegion.GetIndex();
+    OffsetValueType remainder = run.Offset;
+    for (unsigned int axis = 0; axis < VImageDimension; axis++)
+    {
+      runIndex[axis] += remainder % size[axis];
+      remainder /= size[axis];
+    }
+
+    TPixel* runStart = destinationBuffer + destinationImage->ComputeOffset(runIndex);
+    std::fill(runStart, runStart + run.Length, useAfterValues ? run.After : run.Before);
+  }
+
+  destinationImage->Modified();
 }
 
 template<class TPixel, unsigned int VImageDimension>
@@ -152,14 +282,38 @@ MIDASImageUpdateRegionProcessor<TPixel, VImageDimension>
 
     // Let derived classes make changes to the after image.
     this->ApplyUpdateToAfterImage();
-  }
 
-  itkDebugMacro( << "Copying m_AfterImage to m_DestinationImage - started");
+    itkDebugMacro( << "Copying m_AfterImage to m_DestinationImage - started");
+
+    this->CopyImageRegionToDestination(m_AfterImage);
+
+    itkDebugMacro( << "Copying m_AfterImage to m_DestinationImage - finished");
 
-  this->CopyImageRegionToDestination(m_AfterImage);
+    if (m_StoreDifferencesOnly)
+    {
+      this->CalculateDifferenceRuns();
+      m_BeforeImage = NULL;
+      m_AfterImage = NULL;
+    }
 
-  itkDebugMacro( << "Copying m_AfterImage to m_DestinationImage - finished");
-  m_UpdateCalculated = true;
+    m_UpdateCalculated = true;
+    MIDASImageUpdateHistory::AddEntry(this, this->GetUndoDataSize());
+    return;
+  }
+
+  if (m_UndoDataReleased)
+  {
+    itkExceptionMacro(<< "The undo data of this operation was released to stay within the memory limit, so it can't be redone");
+  }
+
+  if (m_StoreDifferencesOnly)
+  {
+    this->CopyDifferenceRunsToDestination(true);
+  }
+  else
+  {
+    this->CopyImageRegionToDestination(m_AfterImage);
+  }
 }
 
 template<class TPixel, unsigned int VImageDimension>
@@ -168,7 +322,20 @@ MIDASImageUpdateRegionProcessor<TPixel, VImageDimension>
 ::Undo()
 {
   Superclass::ValidateInputs();
-  this->CopyImageRegionToDestination(m_BeforeImage);
+
+  if (m_UndoDataReleased)
+  {
+    itkExceptionMacro(<< "The undo data of this operation was released to stay within the memory limit, so it can't be undone");
+  }
+
+  if (m_StoreDifferencesOnly && m_UpdateCalculated)
+  {
+    this->CopyDifferenceRunsToDestination(false);
+  }
+  else
+  {
+    this->CopyImageRegionToDestination(m_BeforeImage);
+  }
 }
 
 }
@@ -16,9 +16,12 @@
 #define itkMIDASRegionGrowingImageFilter_h
 
 #include <stack>
+#include <string>
+#include <vector>
 #include <cassert>
 #include <itkImage.h>
 #include <itkImageToImageFilter.h>
+#include <itkMultiThreader.h>
 #include <itkImageRegionConstIteratorWithIndex.h>
 #include <itkPolyLineParametricPath.h>
 #include <itkContinuousIndex.h>
@@ -29,6 +32,10 @@ namespace itk
 /**
  * \class MIDASRegionGrowingImageFilter
  * \brief Implements region growing limited by contours.
+ *
+ * In the propagation mask mode (see SetUsePropMaskMode), the region can optionally
+ * be grown a run of voxels at a time (see SetUseScanlineFill), which gives the same
+ * output as growing voxel by voxel, but is much faster on large volumes.
  */
 template <class TInputImage, class TOutputImage, class TPointSet>
 class ITK_EXPORT MIDASRegionGrowingImageFilter : public ImageToImageFilter<TInputImage, TOutputImage>
@@ -131,6 +138,19 @@ public:
   itkSetMacro(UsePropMaskMode, bool)
   itkGetConstMacro(UsePropMaskMode, bool)
 
+  /**
+   * \brief If true, and in the propagation mask mode, the region is grown by
+   * whole runs of voxels along an axis that is not masked, rather than voxel by voxel.
+   *
+   * The output is the same as without it. The input values are tested against
+   * the thresholds for all the voxels of the region of interest up front, with the
+   * slices split between threads. If every axis is masked to one direction, the
+   * filter falls back to growing voxel by voxel. Default false.
+   */
+  itkSetMacro(UseScanlineFill, bool)
+  itkGetConstMacro(UseScanlineFill, bool)
+  itkBooleanMacro(UseScanlineFill)
+
   /**
    * \brief Setting the "manual" contours means those that come from DrawTool or PolyTool.
    */
@@ -219,6 +239,24 @@ protected:
                   const typename OutputImageType::IndexType& nextImgIdx,
                   bool isFullyConnected);
 
+  /**
+   * \brief Returns true if region growing may go into a voxel with the given input value,
+   * as decided by the input value alone. The base class accepts every value.
+   */
+  virtual bool IsInputPixelAccepted(const InputPixelType& inputPixel) const
+  {
+    return true;
+  }
+
+  /**
+   * \brief Returns true if the segmentation contour image and the manual contour image,
+   * where they are set, allow growing from currentImgIdx into nextImgIdx.
+   */
+  bool IsAllowedByContours(
+                  const typename OutputImageType::IndexType& currentImgIdx,
+                  const typename OutputImageType::IndexType& nextImgIdx,
+                  bool isFullyConnected);
+
 private:
 
   MIDASRegionGrowingImageFilter(const Self&); // purposely not implemented
@@ -246,6 +284,40 @@ private:
                   const typename OutputImageType::IndexType& index2
                   );
 
+  /**
+   * \brief Grows the region from the voxels in r_stack, which must already be set
+   * in the output, a run of voxels along spanAxis at a time. Empties r_stack.
+   *
+   * The output is the same as for the voxel by voxel growing of the propagation mask
+   * mode, as both add every voxel that can be reached from the seeds.
+   */
+  void ScanlineFill(
+                  const OutputImageRegionType& outputRegion,
+                  int spanAxis,
+                  std::stack<typename OutputImageType::IndexType>& r_stack);
+
+  /**
+   * \brief Returns true if the voxel at nextImgIdx is not yet set, and can be grown
+   * into from currentImgIdx. The offsets are those of nextImgIdx in the output
+   * buffer and in m_AcceptedInputPixels.
+   */
+  bool IsScanlineGrowable(
+                  const typename OutputImageType::IndexType& currentImgIdx,
+                  const typename OutputImageType::IndexType& nextImgIdx,
+                  OffsetValueType nextOutputOffset,
+                  OffsetValueType nextRegionOffset,
+                  bool useContours);
+
+  /** \brief Thread data for testing the input values of the region of interest. */
+  struct AcceptedInputPixelsThreadStruct
+  {
+    Self*                                Filter;
+    OutputImageRegionType                Region;
+    std::vector<std::string>             ErrorMessages;
+  };
+
+  static ITK_THREAD_RETURN_TYPE AcceptedInputPixelsThreaderCallback(void *arg);
+
   OutputPixelType                        m_ForegroundValue;
   OutputPixelType                        m_BackgroundValue;
   typename PointSetType::ConstPointer    mspc_SeedPoints;
@@ -264,6 +336,10 @@ private:
   bool                                   m_EraseFullSlice;
   OutputImageIndexType                   m_PropMask;
   bool                                   m_UsePropMaskMode;
+  bool                                   m_UseScanlineFill;
+
+  /** \brief For ScanlineFill(), whether IsInputPixelAccepted() is true, for each voxel of the region of interest. */
+  std::vector<unsigned char>             m_AcceptedInputPixels;
 };
 
 #ifndef ITK_MANUAL_INSTANTIATION
@@ -25,7 +25,8 @@ MIDASRegionGrowingImageFilter<TInputImage, TOutputImage, TPointSet>::MIDASRegion
     m_SegmentationContourImageOutsideValue(2),
     m_ManualContourImageBorderValue(1),
     m_EraseFullSlice(false),
-    m_UsePropMaskMode(false)
+    m_UsePropMaskMode(false),
+    m_UseScanlineFill(false)
 {
   m_PropMask.Fill(0);
 }
@@ -119,12 +120,36 @@ void MIDASRegionGrowingImageFilter<TInputImage, TOutputImage, TPointSet>::Condit
     bool isFullyConnected
     )
 {
+  /// I.e. out of thresholds.
+  if (!this->IsInputPixelAccepted(this->GetInput()->GetPixel(nextImgIdx)))
+  {
+    return;
+  }
+
   /// I.e. not already set.
   if (this->GetOutput()->GetPixel(nextImgIdx) != m_BackgroundValue)
   {
     return;
   }
 
+  if (!this->IsAllowedByContours(currentImgIdx, nextImgIdx, isFullyConnected))
+  {
+    return;
+  }
+
+  r_stack.push(nextImgIdx);
+  this->GetOutput()->SetPixel(nextImgIdx, m_ForegroundValue);
+}
+
+
+//-----------------------------------------------------------------------------
+template<class TInputImage, class TOutputImage, class TPointSet>
+bool MIDASRegionGrowingImageFilter<TInputImage, TOutputImage, TPointSet>::IsAllowedByContours(
+    const typename OutputImageType::IndexType& currentImgIdx,
+    const typename OutputImageType::IndexType& nextImgIdx,
+    bool isFullyConnected
+    )
+{
   const OutputImageType* segmentationContourImage = this->GetSegmentationContourImage();
   if (segmentationContourImage)
   {
@@ -150,7 +175,7 @@ void MIDASRegionGrowingImageFilter<TInputImage, TOutputImage, TPointSet>::Condit
 
     if (!addVoxel)
     {
-      return;
+      return false;
     }
   }
 
@@ -168,12 +193,250 @@ void MIDASRegionGrowingImageFilter<TInputImage, TOutputImage, TPointSet>::Condit
 
     if (!addVoxel)
     {
-      return;
+      return false;
     }
   }
 
-  r_stack.push(nextImgIdx);
-  this->GetOutput()->SetPixel(nextImgIdx, m_ForegroundValue);
+  return true;
+}
+
+
+//-----------------------------------------------------------------------------
+template<class TInputImage, class TOutputImage, class TPointSet>
+ITK_THREAD_RETURN_TYPE MIDASRegionGrowingImageFilter<TInputImage, TOutputImage, TPointSet>
+::AcceptedInputPixelsThreaderCallback(void *arg)
+{
+  typedef typename OutputImageType::RegionType __RegionType;
+
+  ThreadIdType threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  ThreadIdType threadCount = ((MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+  AcceptedInputPixelsThreadStruct *str = (AcceptedInputPixelsThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  try
+  {
+    // Each thread takes a contiguous range of slices, along the last axis of the region,
+    // so its voxels are also contiguous in m_AcceptedInputPixels.
+    const int lastAxis = OutputImageType::ImageDimension - 1;
+    const typename __RegionType::SizeValueType numberOfSlices = str->Region.GetSize()[lastAxis];
+    const typename __RegionType::SizeValueType firstSlice = (numberOfSlices * threadId) / threadCount;
+    const typename __RegionType::SizeValueType endSlice = (numberOfSlices * (threadId + 1)) / threadCount;
+
+    if (endSlice > firstSlice)
+    {
+      __RegionType threadRegion = str->Region;
+      threadRegion.SetIndex(lastAxis, str->Region.GetIndex()[lastAxis] + firstSlice);
+      threadRegion.SetSize(lastAxis, endSlice - firstSlice);
+
+      std::vector<unsigned char>::iterator acceptedIterator = str->Filter->m_AcceptedInputPixels.begin()
+          + firstSlice * (str->Region.GetNumberOfPixels() / numberOfSlices);
+
+      itk::ImageRegionConstIterator<InputImageType> inputIterator(str->Filter->GetInput(), threadRegion);
+      for (inputIterator.GoToBegin(); !inputIterator.IsAtEnd(); ++inputIterator, ++acceptedIterator)
+      {
+        *acceptedIterator = str->Filter->IsInputPixelAccepted(inputIterator.Get()) ? 1 : 0;
+      }
+    }
+  }
+  catch (ExceptionObject &e)
+  {
+    str->ErrorMessages[threadId] = e.GetDescription();
+  }
+  catch (std::exception &e)
+  {
+    str->ErrorMessages[threadId] = e.what();
+  }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+
+//-----------------------------------------------------------------------------
+template<class TInputImage, class TOutputImage, class TPointSet>
+bool MIDASRegionGrowingImageFilter<TInputImage, TOutputImage, TPointSet>::IsScanlineGrowable(
+    const typename OutputImageType::IndexType& currentImgIdx,
+    const typename OutputImageType::IndexType& nextImgIdx,
+    OffsetValueType nextOutputOffset,
+    OffsetValueType nextRegionOffset,
+    bool useContours
+    )
+{
+  return m_AcceptedInputPixels[nextRegionOffset]
+      && this->GetOutput()->GetBufferPointer()[nextOutputOffset] == m_BackgroundValue
+      && (!useContours || this->IsAllowedByContours(currentImgIdx, nextImgIdx, true));
+}
+
+
+//-----------------------------------------------------------------------------
+template<class TInputImage, class TOutputImage, class TPointSet>
+void MIDASRegionGrowingImageFilter<TInputImage, TOutputImage, TPointSet>::ScanlineFill(
+    const OutputImageRegionType& outputRegion,
+    int spanAxis,
+    std::stack<typename OutputImageType::IndexType>& r_stack
+    )
+{
+  typedef typename OutputImageType::IndexType __IndexType;
+
+  const int dimension = OutputImageType::ImageDimension;
+
+  // Test the input values of the whole region up front, on several threads.
+  m_AcceptedInputPixels.assign(outputRegion.GetNumberOfPixels(), 0);
+
+  AcceptedInputPixelsThreadStruct str;
+  str.Filter = this;
+  str.Region = outputRegion;
+  str.ErrorMessages.resize(this->GetNumberOfThreads());
+
+  this->GetMultiThreader()->SetNumberOfThreads(this->GetNumberOfThreads());
+  this->GetMultiThreader()->SetSingleMethod(this->AcceptedInputPixelsThreaderCallback, &str);
+  this->GetMultiThreader()->SingleMethodExecute();
+
+  for (unsigned int i = 0; i < str.ErrorMessages.size(); i++)
+  {
+    if (!str.ErrorMessages[i].empty())
+    {
+      m_AcceptedInputPixels.clear();
+      itkExceptionMacro(<< "ScanlineFill():Thread " << i << " failed: " << str.ErrorMessages[i]);
+    }
+  }
+
+  // Strides of the output buffer, and of the region, along each axis.
+  OutputImageType* output = this->GetOutput();
+  OutputPixelType* outputBuffer = output->GetBufferPointer();
+  const OffsetValueType* outputOffsetTable = output->GetOffsetTable();
+
+  OffsetValueType regionOffsetTable[dimension];
+  regionOffsetTable[0] = 1;
+  for (int axis = 1; axis < dimension; axis++)
+  {
+    regionOffsetTable[axis] = regionOffsetTable[axis - 1] * outputRegion.GetSize()[axis - 1];
+  }
+
+  const __IndexType regionStart = outputRegion.GetIndex();
+  __IndexType regionEnd;
+  for (int axis = 0; axis < dimension; axis++)
+  {
+    regionEnd[axis] = regionStart[axis] + outputRegion.GetSize()[axis] - 1;
+  }
+
+  const bool useContours = this->GetSegmentationContourImage() || this->GetManualContourImage();
+  const OffsetValueType outputStride = outputOffsetTable[spanAxis];
+  const OffsetValueType regionStride = regionOffsetTable[spanAxis];
+
+  __IndexType currentImgIndex;
+  __IndexType nextImgIndex;
+  __IndexType previousImgIndex;
+
+  while (r_stack.size() > 0)
+  {
+    const __IndexType seedImgIndex = r_stack.top();
+    r_stack.pop();
+
+    const OffsetValueType seedOutputOffset = output->ComputeOffset(seedImgIndex);
+    assert(outputBuffer[seedOutputOffset] == m_ForegroundValue);
+
+    OffsetValueType seedRegionOffset = 0;
+    for (int axis = 0; axis < dimension; axis++)
+    {
+      seedRegionOffset += (seedImgIndex[axis] - regionStart[axis]) * regionOffsetTable[axis];
+    }
+
+    // Extend the run from the seed, in both directions along the span axis.
+    IndexValueType first = seedImgIndex[spanAxis];
+    currentImgIndex = seedImgIndex;
+    nextImgIndex = seedImgIndex;
+    while (first > regionStart[spanAxis])
+    {
+      currentImgIndex[spanAxis] = first;
+      nextImgIndex[spanAxis] = first - 1;
+
+      const OffsetValueType steps = seedImgIndex[spanAxis] - (first - 1);
+      if (!this->IsScanlineGrowable(currentImgIndex, nextImgIndex,
+                                    seedOutputOffset - steps * outputStride,
+                                    seedRegionOffset - steps * regionStride,
+                                    useContours))
+      {
+        break;
+      }
+      outputBuffer[seedOutputOffset - steps * outputStride] = m_ForegroundValue;
+      first--;
+    }
+
+    IndexValueType last = seedImgIndex[spanAxis];
+    while (last < regionEnd[spanAxis])
+    {
+      currentImgIndex[spanAxis] = last;
+      nextImgIndex[spanAxis] = last + 1;
+
+      const OffsetValueType steps = (last + 1) - seedImgIndex[spanAxis];
+      if (!this->IsScanlineGrowable(currentImgIndex, nextImgIndex,
+                                    seedOutputOffset + steps * outputStride,
+                                    seedRegionOffset + steps * regionStride,
+                                    useContours))
+      {
+        break;
+      }
+      outputBuffer[seedOutputOffset + steps * outputStride] = m_ForegroundValue;
+      last++;
+    }
+
+    // Then look at the neighbouring runs, along every other axis, in the directions allowed by the mask.
+    for (int axis = 0; axis < dimension; axis++)
+    {
+      if (axis == spanAxis)
+      {
+        continue;
+      }
+
+      for (int offsetDirection = -1; offsetDirection <= 1; offsetDirection += 2)
+      {
+        if (   (m_PropMask[axis] != 0 && m_PropMask[axis] != offsetDirection)
+            || (offsetDirection < 0 && seedImgIndex[axis] == regionStart[axis])
+            || (offsetDirection > 0 && seedImgIndex[axis] == regionEnd[axis])
+           )
+        {
+          continue;
+        }
+
+        // Only one voxel of a run of growable voxels needs to be pushed, as the rest
+        // will be reached along the span axis, as long as the contours allow that.
+        bool isPreviousPushed = false;
+
+        for (IndexValueType position = first; position <= last; position++)
+        {
+          const OffsetValueType steps = position - seedImgIndex[spanAxis];
+          const OffsetValueType nextOutputOffset = seedOutputOffset + steps * outputStride + offsetDirection * outputOffsetTable[axis];
+          const OffsetValueType nextRegionOffset = seedRegionOffset + steps * regionStride + offsetDirection * regionOffsetTable[axis];
+
+          currentImgIndex = seedImgIndex;
+          currentImgIndex[spanAxis] = position;
+          nextImgIndex = currentImgIndex;
+          nextImgIndex[axis] += offsetDirection;
+
+          if (this->IsScanlineGrowable(currentImgIndex, nextImgIndex, nextOutputOffset, nextRegionOffset, useContours))
+          {
+            if (isPreviousPushed
+                && (!useContours || this->IsAllowedByContours(previousImgIndex, nextImgIndex, true)))
+            {
+              // Reached from the previous voxel of the run.
+            }
+            else
+            {
+              outputBuffer[nextOutputOffset] = m_ForegroundValue;
+              r_stack.push(nextImgIndex);
+              isPreviousPushed = true;
+            }
+          }
+          else
+          {
+            isPreviousPushed = false;
+          }
+          previousImgIndex = nextImgIndex;
+        }
+      }
+    }
+  }
+
+  m_AcceptedInputPixels.clear();
 }
 
 
@@ -276,6 +539,24 @@ void MIDASRegionGrowingImageFilter<TInputImage, TOutputImage, TPointSet>::Genera
   int             axisIndex;
   int             offsetDirection;
   int             dimension = __ImageSizeType::GetSizeDimension();
+
+  // The scanline fill needs an axis along which growing is allowed both ways.
+  // It empties the stack, so the loop below has nothing left to do.
+  if (m_UsePropMaskMode && m_UseScanlineFill)
+  {
+    int spanAxis = -1;
+    for (axisIndex = 0; axisIndex < dimension && spanAxis < 0; axisIndex++)
+    {
+      if (m_PropMask[axisIndex] == 0)
+      {
+        spanAxis = axisIndex;
+      }
+    }
+    if (spanAxis >= 0)
+    {
+      this->ScanlineFill(outputRegion, spanAxis, nextPixelsStack);
+    }
+  }
   __RegionType    neighborhoodRegion;
   __IndexType     neighborhoodRegionStartingIndex;
   __ImageSizeType neighborhoodRegionSize;
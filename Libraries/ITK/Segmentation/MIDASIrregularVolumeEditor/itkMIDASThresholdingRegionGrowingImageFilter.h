@@ -82,17 +82,12 @@ private:
   void operator=(const Self&); // purposely not implemented
 
   /**
-   * \brief The main region growing logic is here, where we decide whether to add the nextImgIdx to a stack.
-   * \param[In] r_stack current stack of pixels under consideration, initialised by the available seeds.
-   * \param[In] currentImgIdx the current location being considered
-   * \param[In] nextImgIdx the next pixel
-   * \param[Out] true if the pixel should be added and false otherwise
+   * \brief Returns true if the input value is within the thresholds.
    */
-  virtual void ConditionalAddPixel(
-                  std::stack<typename OutputImageType::IndexType>& r_stack,
-                  const typename OutputImageType::IndexType& currentImgIdx,
-                  const typename OutputImageType::IndexType& nextImgIdx,
-                  bool isFullyConnected) override;
+  virtual bool IsInputPixelAccepted(const InputPixelType& inputPixel) const override
+  {
+    return inputPixel >= m_LowerThreshold && inputPixel <= m_UpperThreshold;
+  }
 
   InputPixelType                         m_LowerThreshold;
   InputPixelType                         m_UpperThreshold;
@@ -19,22 +19,3 @@ MIDASThresholdingRegionGrowingImageFilter<TInputImage, TOutputImage, TPointSet>:
     m_UpperThreshold(0)
 {
 }
-
-//-----------------------------------------------------------------------------
-template<class TInputImage, class TOutputImage, class TPointSet>
-void MIDASThresholdingRegionGrowingImageFilter<TInputImage, TOutputImage, TPointSet>::ConditionalAddPixel(
-    std::stack<typename OutputImageType::IndexType>& r_stack,
-    const typename OutputImageType::IndexType& currentImgIdx,
-    const typename OutputImageType::IndexType& nextImgIdx,
-    bool isFullyConnected
-    )
-{
-  /// I.e. out of thresholds.
-  InputPixelType inputImageNextPixel = this->GetInput()->GetPixel(nextImgIdx);
-  if (inputImageNextPixel < m_LowerThreshold || inputImageNextPixel > m_UpperThreshold)
-  {
-    return;
-  }
-
-  Superclass::ConditionalAddPixel(r_stack, currentImgIdx, nextImgIdx, isFullyConnected);
-}
@@ -33,4 +33,5 @@ void RegisterTests()
   REGISTER_TEST(GaussianCurvatureImageFilterTest);
   REGISTER_TEST(itkExcludeImageFilterTest);
   REGISTER_TEST(itkLargestConnectedComponentFilterTest);
+  REGISTER_TEST(itkMultiScaleVesselnessFilterTest);
 }
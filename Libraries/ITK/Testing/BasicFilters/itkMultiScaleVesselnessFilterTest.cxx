@@ -0,0 +1,199 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#if defined(_MSC_VER)
+#pragma warning ( disable : 4786 )
+#endif
+#include <iostream>
+#include <algorithm>
+#include <math.h>
+#include <vector>
+#include <itkImage.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <itkHessianRecursiveGaussianImageFilter.h>
+#include <itkHessian3DToVesselnessMeasureImageFilter.h>
+#include <itkMultiScaleVesselnessFilter.h>
+
+namespace
+{
+
+typedef float PixelType;
+typedef itk::Image<PixelType, 3> ImageType;
+typedef itk::MultiScaleVesselnessFilter<ImageType, ImageType> VesselnessFilterType;
+
+/** Creates a thin tube along x, and a thick one along y, with Gaussian profiles. */
+ImageType::Pointer CreateTubes()
+{
+  ImageType::SizeType size;
+  size[0] = 48;
+  size[1] = 40;
+  size[2] = 36;
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(size);
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> iterator(image, image->GetLargestPossibleRegion());
+  for (iterator.GoToBegin(); !iterator.IsAtEnd(); ++iterator)
+  {
+    ImageType::IndexType index = iterator.GetIndex();
+    double thinSquared = (index[1] - 12.0) * (index[1] - 12.0) + (index[2] - 12.0) * (index[2] - 12.0);
+    double thickSquared = (index[0] - 32.0) * (index[0] - 32.0) + (index[2] - 24.0) * (index[2] - 24.0);
+    iterator.Set(100 * exp(-thinSquared / 2.0) + 100 * exp(-thickSquared / (2.0 * 2.5 * 2.5)));
+  }
+  return image;
+}
+
+/** The maximum response over the scales, one whole image scale at a time. */
+ImageType::Pointer ComputeReference(ImageType::Pointer image, const std::vector<float>& scales)
+{
+  typedef itk::HessianRecursiveGaussianImageFilter<ImageType> HessianFilterType;
+  typedef itk::Hessian3DToVesselnessMeasureImageFilter<PixelType> VesselnessMeasureFilterType;
+
+  HessianFilterType::Pointer hessianFilter = HessianFilterType::New();
+  VesselnessMeasureFilterType::Pointer vesselnessFilter = VesselnessMeasureFilterType::New();
+  hessianFilter->SetInput(image);
+  hessianFilter->SetNormalizeAcrossScale(true);
+  vesselnessFilter->SetInput(hessianFilter->GetOutput());
+  vesselnessFilter->SetAlpha1(0.5);
+  vesselnessFilter->SetAlpha2(2.0);
+
+  ImageType::Pointer maxImage;
+  for (size_t s = 0; s < scales.size(); ++s)
+  {
+    hessianFilter->SetSigma(scales[s]);
+    vesselnessFilter->Update();
+
+    if (s == 0)
+    {
+      maxImage = ImageType::New();
+      maxImage->CopyInformation(vesselnessFilter->GetOutput());
+      maxImage->SetRegions(vesselnessFilter->GetOutput()->GetLargestPossibleRegion());
+      maxImage->Allocate();
+      maxImage->FillBuffer(-1e30);
+    }
+
+    itk::ImageRegionConstIterator<ImageType> vesselIterator(vesselnessFilter->GetOutput(), maxImage->GetLargestPossibleRegion());
+    itk::ImageRegionIterator<ImageType> maxIterator(maxImage, maxImage->GetLargestPossibleRegion());
+    for (vesselIterator.GoToBegin(), maxIterator.GoToBegin(); !vesselIterator.IsAtEnd(); ++vesselIterator, ++maxIterator)
+    {
+      maxIterator.Set(std::max(maxIterator.Get(), vesselIterator.Get()));
+    }
+  }
+  return maxImage;
+}
+
+/** Returns the largest absolute difference between two images of the same size. */
+double GetMaximumDifference(ImageType* a, ImageType* b)
+{
+  double maximum = 0;
+  itk::ImageRegionConstIterator<ImageType> aIterator(a, a->GetLargestPossibleRegion());
+  itk::ImageRegionConstIterator<ImageType> bIterator(b, b->GetLargestPossibleRegion());
+  for (aIterator.GoToBegin(), bIterator.GoToBegin(); !aIterator.IsAtEnd(); ++aIterator, ++bIterator)
+  {
+    maximum = std::max(maximum, fabs(static_cast<double>(aIterator.Get()) - bIterator.Get()));
+  }
+  return maximum;
+}
+
+/** Returns the largest value in an image. */
+double GetMaximum(ImageType* image)
+{
+  double maximum = 0;
+  itk::ImageRegionConstIterator<ImageType> iterator(image, image->GetLargestPossibleRegion());
+  for (iterator.GoToBegin(); !iterator.IsAtEnd(); ++iterator)
+  {
+    maximum = std::max(maximum, static_cast<double>(iterator.Get()));
+  }
+  return maximum;
+}
+
+VesselnessFilterType::Pointer RunFilter(ImageType::Pointer image, unsigned int brickSize, unsigned int numberOfThreads)
+{
+  VesselnessFilterType::Pointer filter = VesselnessFilterType::New();
+  filter->SetInput(image);
+  filter->SetBrickSize(brickSize);
+  filter->SetNumberOfThreads(numberOfThreads);
+  filter->Update();
+  return filter;
+}
+
+}
+
+/**
+ * Checks that filtering in bricks, on several threads, gives the same response as filtering the whole image.
+ */
+int itkMultiScaleVesselnessFilterTest(int argc, char * argv[])
+{
+  ImageType::Pointer image = CreateTubes();
+
+  // The default scales, 0.77 to 3.09375, with a spacing of 1.
+  std::vector<float> scales;
+  scales.push_back(0.77f);
+  scales.push_back(1.77f);
+  scales.push_back(2.77f);
+
+  ImageType::Pointer reference = ComputeReference(image, scales);
+  double maximum = GetMaximum(reference);
+  if (maximum <= 0)
+  {
+    std::cerr << "The reference response is empty." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  VesselnessFilterType::Pointer whole = RunFilter(image, 0, 2);
+  double wholeDifference = GetMaximumDifference(whole->GetOutput(), reference);
+  if (wholeDifference > 1e-5 * maximum)
+  {
+    std::cerr << "Whole image differs from the reference by " << wholeDifference << ", maximum " << maximum << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  VesselnessFilterType::Pointer bricks = RunFilter(image, 16, 3);
+  double bricksDifference = GetMaximumDifference(bricks->GetOutput(), reference);
+  if (bricksDifference > 1e-2 * maximum)
+  {
+    std::cerr << "Bricks differ from the reference by " << bricksDifference << ", maximum " << maximum << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  VesselnessFilterType::Pointer singleThreaded = RunFilter(image, 16, 1);
+  if (GetMaximumDifference(bricks->GetOutput(), singleThreaded->GetOutput()) != 0
+      || GetMaximumDifference(bricks->GetScaleOutput(), singleThreaded->GetScaleOutput()) != 0)
+  {
+    std::cerr << "Bricks on 3 threads differ from bricks on 1 thread." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  ImageType::IndexType thin;
+  thin[0] = 8;
+  thin[1] = 12;
+  thin[2] = 12;
+
+  ImageType::IndexType thick;
+  thick[0] = 32;
+  thick[1] = 30;
+  thick[2] = 24;
+
+  float thinScale = bricks->GetScaleOutput()->GetPixel(thin);
+  float thickScale = bricks->GetScaleOutput()->GetPixel(thick);
+  if (!(thinScale < thickScale))
+  {
+    std::cerr << "Expected the thin tube to have a smaller scale, thin=" << thinScale << ", thick=" << thickScale << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
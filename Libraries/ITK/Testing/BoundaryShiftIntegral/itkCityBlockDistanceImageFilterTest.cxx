@@ -0,0 +1,161 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#if defined(_MSC_VER)
+#pragma warning ( disable : 4786 )
+#endif
+
+#include <cstdlib>
+#include <iostream>
+#include <itkImage.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionIterator.h>
+#include <itkCityBlockDistanceImageFilter.h>
+#include <itkMultipleDilateImageFilter.h>
+#include <itkMultipleErodeImageFilter.h>
+
+namespace
+{
+
+typedef itk::Image<int, 3> ImageType;
+
+/** Returns true if two images have the same values. */
+bool AreEqual(ImageType* a, ImageType* b)
+{
+  itk::ImageRegionConstIterator<ImageType> aIterator(a, a->GetLargestPossibleRegion());
+  itk::ImageRegionConstIterator<ImageType> bIterator(b, b->GetLargestPossibleRegion());
+  for (aIterator.GoToBegin(), bIterator.GoToBegin(); !aIterator.IsAtEnd(); ++aIterator, ++bIterator)
+  {
+    if (aIterator.Get() != bIterator.Get())
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+}
+
+/**
+ * Tests the city block distance of a dot, and that erosions and dilations
+ * using the distance map give the same masks as repeated erosions and dilations.
+ */
+int itkCityBlockDistanceImageFilterTest(int, char* [])
+{
+  ImageType::SizeType size;
+  size[0] = 23;
+  size[1] = 17;
+  size[2] = 13;
+
+  ImageType::IndexType start;
+  start[0] = 3;
+  start[1] = -2;
+  start[2] = 0;
+
+  ImageType::RegionType region(start, size);
+
+  // Blobs of 1, with a few voxels of another value, touching the edges of the image.
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(region);
+  image->Allocate();
+
+  srand(7);
+  itk::ImageRegionIterator<ImageType> iterator(image, region);
+  for (iterator.GoToBegin(); !iterator.IsAtEnd(); ++iterator)
+  {
+    ImageType::IndexType index = iterator.GetIndex();
+    bool inBlob = (index[0] - 12) * (index[0] - 12) + (index[1] - 5) * (index[1] - 5) + (index[2] - 6) * (index[2] - 6) < 49
+        || (index[0] > 18 && index[1] < 4);
+    int value = inBlob ? 1 : 0;
+    if (rand() % 20 == 0)
+    {
+      value = rand() % 3;
+    }
+    iterator.Set(value);
+  }
+
+  // The distance to a single voxel is the sum of the distances along each axis.
+  typedef itk::CityBlockDistanceImageFilter<ImageType> DistanceFilterType;
+  ImageType::Pointer dot = ImageType::New();
+  dot->SetRegions(region);
+  dot->Allocate();
+  dot->FillBuffer(0);
+
+  ImageType::IndexType centre;
+  centre[0] = 10;
+  centre[1] = 4;
+  centre[2] = 7;
+  dot->SetPixel(centre, 1);
+
+  DistanceFilterType::Pointer distanceFilter = DistanceFilterType::New();
+  distanceFilter->SetInput(dot);
+  distanceFilter->SetNumberOfThreads(3);
+  distanceFilter->Update();
+
+  itk::ImageRegionConstIterator<DistanceFilterType::OutputImageType> distanceIterator(distanceFilter->GetOutput(), region);
+  for (distanceIterator.GoToBegin(); !distanceIterator.IsAtEnd(); ++distanceIterator)
+  {
+    ImageType::IndexType index = distanceIterator.GetIndex();
+    unsigned int expected = std::abs(index[0] - centre[0]) + std::abs(index[1] - centre[1]) + std::abs(index[2] - centre[2]);
+    if (distanceIterator.Get() != expected)
+    {
+      std::cerr << "index=" << index << ", expected distance " << expected << ", but was " << distanceIterator.Get() << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  typedef itk::MultipleErodeImageFilter<ImageType> MultipleErodeImageFilterType;
+  typedef itk::MultipleDilateImageFilter<ImageType> MultipleDilateImageFilterType;
+
+  for (unsigned int n = 0; n <= 6; n++)
+  {
+    MultipleErodeImageFilterType::Pointer repeatedErode = MultipleErodeImageFilterType::New();
+    repeatedErode->SetInput(image);
+    repeatedErode->SetNumberOfErosions(n);
+    repeatedErode->UseDistanceMapOff();
+    repeatedErode->Update();
+
+    MultipleErodeImageFilterType::Pointer distanceErode = MultipleErodeImageFilterType::New();
+    distanceErode->SetInput(image);
+    distanceErode->SetNumberOfErosions(n);
+    distanceErode->Update();
+
+    if (!AreEqual(repeatedErode->GetOutput(), distanceErode->GetOutput()))
+    {
+      std::cerr << "erosions=" << n << ", the distance map differs from repeated erosions." << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    MultipleDilateImageFilterType::Pointer repeatedDilate = MultipleDilateImageFilterType::New();
+    repeatedDilate->SetInput(image);
+    repeatedDilate->SetNumberOfDilations(n);
+    repeatedDilate->UseDistanceMapOff();
+    repeatedDilate->Update();
+
+    MultipleDilateImageFilterType::Pointer distanceDilate = MultipleDilateImageFilterType::New();
+    distanceDilate->SetInput(image);
+    distanceDilate->SetNumberOfDilations(n);
+    distanceDilate->Update();
+
+    if (!AreEqual(repeatedDilate->GetOutput(), distanceDilate->GetOutput()))
+    {
+      std::cerr << "dilations=" << n << ", the distance map differs from repeated dilations." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::cout << "Test PASSED !" << std::endl;
+
+  return EXIT_SUCCESS;
+}
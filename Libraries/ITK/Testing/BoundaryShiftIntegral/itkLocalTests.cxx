@@ -25,6 +25,7 @@ void RegisterTests()
   REGISTER_TEST(itkBinaryIntersectWithPaddingImageFilterTest);
   REGISTER_TEST(itkBinaryUnionWithPaddingImageFilterTest);
   REGISTER_TEST(itkMultipleDilateErodeImageFilterTest);
+  REGISTER_TEST(itkCityBlockDistanceImageFilterTest);
   REGISTER_TEST(itkIntensityNormalisationCalculatorTest);
   REGISTER_TEST(itkSimpleKMeansClusteringImageFilterTest);
   REGISTER_TEST(itkBoundaryShiftIntegralTest);
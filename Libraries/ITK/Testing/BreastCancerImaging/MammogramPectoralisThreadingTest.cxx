@@ -0,0 +1,280 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#if defined(_MSC_VER)
+#pragma warning ( disable : 4786 )
+#endif
+#include <iostream>
+#include <math.h>
+#include <itkImage.h>
+#include <itkImageRegionIterator.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkMammogramPectoralisFitMetric.h>
+#include <itkMammogramPectoralisSegmentationImageFilter.h>
+#include <vnl/vnl_random.h>
+
+typedef itk::Image<float, 2>                                             ImageType;
+typedef itk::Image<unsigned char, 2>                                     MaskImageType;
+typedef itk::MammogramPectoralisFitMetric<ImageType>                     FitMetricType;
+typedef itk::MammogramPectoralisSegmentationImageFilter<ImageType, MaskImageType> PectoralisFilterType;
+typedef FitMetricType::TemplateImageType                                 TemplateImageType;
+
+/**
+ * A synthetic left MLO mammogram, 2mm pixels, with the pectoral muscle in the
+ * top left corner, x/70 + y/140 < 1 in mm, brighter than the breast tissue,
+ * itself an ellipse on the chest wall, over a dark background.
+ */
+static ImageType::Pointer CreateMammogram()
+{
+  ImageType::SizeType size;
+  size[0] = 100;
+  size[1] = 125;
+  ImageType::RegionType region;
+  region.SetSize(size);
+  ImageType::SpacingType spacing;
+  spacing.Fill(2.0);
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(region);
+  image->SetSpacing(spacing);
+  image->Allocate();
+
+  vnl_random random(2718);
+
+  ImageType::PointType point;
+  itk::ImageRegionIteratorWithIndex<ImageType> iterator(image, region);
+  for (iterator.GoToBegin(); !iterator.IsAtEnd(); ++iterator)
+    {
+      image->TransformIndexToPhysicalPoint(iterator.GetIndex(), point);
+
+      double dx = point[0] / 170.;
+      double dy = (point[1] - 125.) / 115.;
+
+      double value = 10.;
+      if (point[0] / 70. + point[1] / 140. < 1.)
+        {
+          value = 180.;
+        }
+      else if (dx*dx + dy*dy < 1.)
+        {
+          value = 100.;
+        }
+      iterator.Set(value + random.normal() * 5.);
+    }
+
+  return image;
+}
+
+/**
+ * The NCC of the fit metric, with a mask, from separate passes for the
+ * image mean, standard deviation and correlation with the template.
+ */
+static double ReferenceNCC(const ImageType *image, const MaskImageType *mask, FitMetricType *metric,
+                           const FitMetricType::ParametersType &parameters)
+{
+  double tMean, tStdDev, nInside, nPixels;
+  TemplateImageType::RegionType templateRegion;
+
+  metric->ClearTemplate();
+  metric->GenerateTemplate(parameters, tMean, tStdDev, nInside, nPixels, templateRegion);
+
+  itk::ImageRegionConstIterator<ImageType>         itImage(image, templateRegion);
+  itk::ImageRegionConstIterator<TemplateImageType> itTemplate(metric->GetTemplate(), templateRegion);
+  itk::ImageRegionConstIterator<MaskImageType>     itMask(mask, templateRegion);
+
+  double imMean = 0.;
+  for (itImage.GoToBegin(), itTemplate.GoToBegin(), itMask.GoToBegin(); !itImage.IsAtEnd(); ++itImage, ++itTemplate, ++itMask)
+    {
+      if (itMask.Get() && itTemplate.Get())
+        {
+          imMean += itImage.Get();
+        }
+    }
+  imMean /= nPixels;
+
+  double imStdDev = 0.;
+  double ncc = 0.;
+  for (itImage.GoToBegin(), itTemplate.GoToBegin(), itMask.GoToBegin(); !itImage.IsAtEnd(); ++itImage, ++itTemplate, ++itMask)
+    {
+      if (itMask.Get() && itTemplate.Get())
+        {
+          imStdDev += (itImage.Get() - imMean) * (itImage.Get() - imMean);
+          ncc += (itImage.Get() - imMean) * (itTemplate.Get() - tMean);
+        }
+    }
+  imStdDev = sqrt(imStdDev / nPixels);
+
+  return ncc / (nPixels * imStdDev * tStdDev);
+}
+
+/** The metric duplicated for each thread must score intercepts as the original, and the masked NCC must match the reference. */
+static int TestFitMetric(ImageType *image)
+{
+  // A mask of the breast, with holes, so that fewer pixels are summed than lie in its bounding box.
+  MaskImageType::Pointer mask = MaskImageType::New();
+  mask->SetRegions(image->GetLargestPossibleRegion());
+  mask->SetSpacing(image->GetSpacing());
+  mask->Allocate();
+
+  itk::ImageRegionConstIterator<ImageType>      itImage(image, image->GetLargestPossibleRegion());
+  itk::ImageRegionIteratorWithIndex<MaskImageType> itMask(mask, mask->GetLargestPossibleRegion());
+  for (itImage.GoToBegin(), itMask.GoToBegin(); !itImage.IsAtEnd(); ++itImage, ++itMask)
+    {
+      MaskImageType::IndexType index = itMask.GetIndex();
+      itMask.Set((itImage.Get() > 50.) && ((index[0] + index[1]) % 7 != 0) ? 1 : 0);
+    }
+
+  FitMetricType::Pointer metric = FitMetricType::New();
+  metric->SetSSD(false);
+  metric->SetInputImage(image);
+  metric->SetMask(mask);
+
+  FitMetricType::Pointer duplicate = metric->Duplicate();
+
+  double intercepts[][2] = { { 70., 140. }, { 60., 150. }, { 80., 120. }, { 64., 170. } };
+
+  unsigned int nEvaluated = 0;
+  for (unsigned int i = 0; i < 4; i++)
+    {
+      ImageType::PointType intercept;
+      intercept[0] = intercepts[i][0];
+      intercept[1] = intercepts[i][1];
+
+      FitMetricType::ParametersType parameters;
+      parameters.SetSize(metric->GetNumberOfParameters());
+      metric->GetParameters(intercept, parameters);
+
+      double value = metric->GetValueAtPecIntercept(intercept);
+      double duplicateValue = duplicate->GetValueAtPecIntercept(intercept);
+
+      std::cout << "Intercept " << intercept << ": NCC=" << value << ", duplicate=" << duplicateValue << std::endl;
+
+      if (value != duplicateValue)
+        {
+          std::cerr << "The duplicated metric gives " << duplicateValue << " at " << intercept
+                    << ", but the original gives " << value << std::endl;
+          return EXIT_FAILURE;
+        }
+
+      // Intercepts rejected by the metric return -1.
+      if (value == -1.)
+        {
+          continue;
+        }
+
+      double expected = ReferenceNCC(image, mask, metric, parameters);
+      if (fabs(value - expected) > 1e-6 * std::max(1., fabs(expected)))
+        {
+          std::cerr << "The NCC at " << intercept << " is " << value << ", expected " << expected << std::endl;
+          return EXIT_FAILURE;
+        }
+      nEvaluated++;
+    }
+
+  if (nEvaluated == 0)
+    {
+      std::cerr << "Every intercept was rejected by the metric" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
+
+/** Searching every intercept on several threads must give the same segmentation as on one thread. */
+static int TestExhaustiveSearch(ImageType *image)
+{
+  itk::ThreadIdType threads[] = { 1, 4 };
+  MaskImageType::Pointer reference;
+
+  for (unsigned int t = 0; t < 2; t++)
+    {
+      PectoralisFilterType::Pointer filter = PectoralisFilterType::New();
+      filter->SetInput(image);
+      filter->SetBreastSide(PectoralisFilterType::LeftOrRightSideCalculatorType::LEFT_BREAST_SIDE);
+      filter->SetCoarseSearchStep(1);
+      filter->SetNumberOfThreads(threads[t]);
+      filter->Update();
+
+      MaskImageType::Pointer segmentation = filter->GetOutput();
+      segmentation->DisconnectPipeline();
+
+      unsigned long int nPectoral = 0;
+      itk::ImageRegionConstIterator<MaskImageType> itSegmentation(segmentation, segmentation->GetLargestPossibleRegion());
+      for (itSegmentation.GoToBegin(); !itSegmentation.IsAtEnd(); ++itSegmentation)
+        {
+          if (itSegmentation.Get())
+            {
+              nPectoral++;
+            }
+        }
+      std::cout << "Pectoral muscle found with " << threads[t] << " threads: " << nPectoral << " pixels" << std::endl;
+
+      if (nPectoral == 0)
+        {
+          std::cerr << "No pectoral muscle found with " << threads[t] << " threads" << std::endl;
+          return EXIT_FAILURE;
+        }
+
+      if (t == 0)
+        {
+          reference = segmentation;
+          continue;
+        }
+
+      itk::ImageRegionConstIterator<MaskImageType> itReference(reference, reference->GetLargestPossibleRegion());
+      for (itReference.GoToBegin(), itSegmentation.GoToBegin(); !itReference.IsAtEnd(); ++itReference, ++itSegmentation)
+        {
+          if (itReference.Get() != itSegmentation.Get())
+            {
+              std::cerr << "The segmentation with " << threads[t] << " threads differs from the one with "
+                        << threads[0] << " thread at " << itSegmentation.GetIndex() << std::endl;
+              return EXIT_FAILURE;
+            }
+        }
+    }
+
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Checks the pectoral muscle search of a synthetic mammogram: the metric
+ * duplicated for each search thread scores intercepts as the original,
+ * the masked NCC matches one computed in separate passes, and every
+ * intercept searched on several threads picks the same muscle as on one.
+ */
+int MammogramPectoralisThreadingTest(int argc, char * argv[])
+{
+  try
+    {
+      ImageType::Pointer image = CreateMammogram();
+
+      if (TestFitMetric(image) != EXIT_SUCCESS)
+        {
+          return EXIT_FAILURE;
+        }
+      if (TestExhaustiveSearch(image) != EXIT_SUCCESS)
+        {
+          return EXIT_FAILURE;
+        }
+    }
+  catch( itk::ExceptionObject & excep )
+    {
+    std::cerr << "Exception caught !" << std::endl;
+    std::cerr << excep << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
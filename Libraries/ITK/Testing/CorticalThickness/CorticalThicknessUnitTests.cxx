@@ -25,6 +25,7 @@ void RegisterTests()
   itk::NifTKImageIOFactory::Initialize();
 
   REGISTER_TEST(LaplacianSolverImageFilterTest);
+  REGISTER_TEST(LaplacianSolverComparisonTest);
   REGISTER_TEST(ScalarImageToNormalizedGradientVectorImageFilterTest);
   REGISTER_TEST(StreamlinesFilterTest);
   REGISTER_TEST(CorrectGMUsingPVMapTest);
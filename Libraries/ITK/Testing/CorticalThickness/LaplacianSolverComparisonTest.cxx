@@ -0,0 +1,178 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#if defined(_MSC_VER)
+#pragma warning ( disable : 4786 )
+#endif
+#include <iostream>
+#include <math.h>
+#include <itkImage.h>
+#include <itkImageRegionIterator.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkLaplacianSolverImageFilter.h>
+#include <niftkConversionUtils.h>
+
+template <unsigned int Dimension>
+int DoLaplacianSolverComparisonTest(int imageSize, double epsilon, unsigned long int maxIters, double tolerance)
+{
+  typedef itk::Image<double, Dimension>                    ImageType;
+  typedef itk::LaplacianSolverImageFilter<ImageType>       FilterType;
+  typedef itk::ImageRegionIterator<ImageType>              IteratorType;
+  typedef itk::ImageRegionConstIterator<ImageType>         ConstIteratorType;
+
+  const double greyMatterLabel = 2;
+  const double whiteMatterLabel = 1;
+  const double csfLabel = 0;
+  const double lowVoltage = 0;
+  const double highVoltage = 10000;
+
+  // A spherical shell of grey matter, with anisotropic voxels, not touching the edge of the image.
+  typename ImageType::SizeType size;
+  size.Fill(imageSize);
+  typename ImageType::RegionType region;
+  region.SetSize(size);
+  typename ImageType::SpacingType spacing;
+  spacing.Fill(1.0);
+  spacing[1] = 1.2;
+
+  typename ImageType::Pointer image = ImageType::New();
+  image->SetRegions(region);
+  image->SetSpacing(spacing);
+  image->Allocate();
+
+  IteratorType iterator(image, region);
+  for (iterator.GoToBegin(); !iterator.IsAtEnd(); ++iterator)
+    {
+      double radius = 0;
+      for (unsigned int d = 0; d < Dimension; d++)
+        {
+          double distance = (iterator.GetIndex()[d] - (imageSize - 1) / 2.0) * spacing[d];
+          radius += distance * distance;
+        }
+      radius = sqrt(radius);
+
+      if (radius < 0.15 * imageSize)
+        {
+          iterator.Set(whiteMatterLabel);
+        }
+      else if (radius < 0.4 * imageSize)
+        {
+          iterator.Set(greyMatterLabel);
+        }
+      else
+        {
+          iterator.Set(csfLabel);
+        }
+    }
+
+  typename FilterType::SolverType solvers[] = { FilterType::GAUSS_SEIDEL, FilterType::RED_BLACK_SOR, FilterType::MULTIGRID };
+  const char *names[] = { "Gauss-Seidel", "red-black SOR", "multigrid" };
+
+  typename ImageType::Pointer reference;
+
+  for (unsigned int s = 0; s < 3; s++)
+    {
+      typename FilterType::Pointer filter = FilterType::New();
+      filter->SetInput(image);
+      filter->SetLowVoltage(lowVoltage);
+      filter->SetHighVoltage(highVoltage);
+      filter->SetMaximumNumberOfIterations(maxIters);
+      filter->SetEpsilonConvergenceThreshold(epsilon);
+      filter->SetLabelThresholds(greyMatterLabel, whiteMatterLabel, csfLabel);
+      filter->SetSolver(solvers[s]);
+      filter->SetNumberOfThreads(4);
+      filter->Update();
+
+      std::cout << names[s] << " took " << filter->GetCurrentIteration() << " iterations" << std::endl;
+
+      if (filter->GetCurrentIteration() >= maxIters)
+        {
+          std::cerr << names[s] << " didn't converge in " << maxIters << " iterations" << std::endl;
+          return EXIT_FAILURE;
+        }
+
+      if (s == 0)
+        {
+          reference = filter->GetOutput();
+          reference->DisconnectPipeline();
+          continue;
+        }
+
+      // Compare the voltages over the grey matter, where they were solved for.
+      double maxDifference = 0;
+      ConstIteratorType labelIterator(image, region);
+      ConstIteratorType referenceIterator(reference, region);
+      ConstIteratorType outputIterator(filter->GetOutput(), region);
+      for (labelIterator.GoToBegin(), referenceIterator.GoToBegin(), outputIterator.GoToBegin();
+           !labelIterator.IsAtEnd();
+           ++labelIterator, ++referenceIterator, ++outputIterator)
+        {
+          if (labelIterator.Get() == greyMatterLabel)
+            {
+              maxDifference = std::max(maxDifference, fabs(outputIterator.Get() - referenceIterator.Get()));
+            }
+        }
+
+      std::cout << names[s] << " differs from " << names[0] << " by at most " << maxDifference << std::endl;
+
+      if (maxDifference > tolerance * (highVoltage - lowVoltage))
+        {
+          std::cerr << names[s] << " differs from " << names[0] << " by " << maxDifference
+                    << ", which is more than " << tolerance << " of the voltage range" << std::endl;
+          return EXIT_FAILURE;
+        }
+    }
+
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Checks that the red-black SOR and multigrid solvers of LaplacianSolverImageFilter
+ * give the same voltages as Gauss-Seidel, to within a tolerance, given as a fraction
+ * of the voltage range, on a synthetic shell of cortex.
+ */
+int LaplacianSolverComparisonTest(int argc, char * argv[])
+{
+  if( argc < 6)
+    {
+      std::cerr << "Usage   : LaplacianSolverComparisonTest dimension imageSize epsilon max tolerance" << std::endl;
+      return 1;
+    }
+  int dimension = niftk::ConvertToInt(argv[1]);
+  int imageSize = niftk::ConvertToInt(argv[2]);
+  double epsilon = niftk::ConvertToDouble(argv[3]);
+  unsigned long int maxIters = (unsigned long int) niftk::ConvertToInt(argv[4]);
+  double tolerance = niftk::ConvertToDouble(argv[5]);
+
+  try
+    {
+      if (dimension == 2)
+        {
+          return DoLaplacianSolverComparisonTest<2>(imageSize, epsilon, maxIters, tolerance);
+        }
+      else if (dimension == 3)
+        {
+          return DoLaplacianSolverComparisonTest<3>(imageSize, epsilon, maxIters, tolerance);
+        }
+    }
+  catch( itk::ExceptionObject & excep )
+    {
+      std::cerr << "Exception caught !" << std::endl;
+      std::cerr << excep << std::endl;
+      return EXIT_FAILURE;
+    }
+
+  std::cerr << "Unsupported dimension:" << dimension << std::endl;
+  return EXIT_FAILURE;
+}
@@ -0,0 +1,189 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#if defined(_MSC_VER)
+#pragma warning ( disable : 4786 )
+#endif
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include <itkImage.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkUCLBSplineTransform.h>
+#include <itkTimeProbe.h>
+#include <niftkConversionUtils.h>
+
+template <unsigned int Dimension>
+int DoBSplineInterpolationThreadingTest(int imageSize, double gridSpacing, int iterations)
+{
+  typedef itk::Image< unsigned char, Dimension >                         ImageType;
+  typedef itk::UCLBSplineTransform< ImageType, double, Dimension, float> TransformType;
+  typedef typename TransformType::DeformationFieldType                   DeformationFieldType;
+  typedef typename TransformType::ParametersType                         ParametersType;
+  typedef itk::ImageRegionConstIterator<DeformationFieldType>            FieldIteratorType;
+
+  // Only the geometry of the image matters.
+  typename ImageType::SizeType size;
+  size.Fill(imageSize);
+  typename ImageType::RegionType region;
+  region.SetSize(size);
+
+  typename ImageType::Pointer image = ImageType::New();
+  image->SetRegions(region);
+  image->Allocate();
+  image->FillBuffer(0);
+
+  typename TransformType::GridSpacingType spacing;
+  spacing.Fill(gridSpacing);
+
+  typename TransformType::Pointer transform = TransformType::New();
+  transform->Initialize(image.GetPointer(), spacing, 1);
+
+  // A smooth, but not separable, displacement at each control point.
+  ParametersType parameters = transform->GetParameters();
+  for (unsigned int i = 0; i < parameters.GetSize(); i++)
+    {
+      parameters[i] = 3.0 * sin(0.37 * i) * cos(0.11 * i);
+    }
+
+  // Original, single threaded loop.
+  transform->UseThreadedInterpolationOff();
+
+  itk::TimeProbe serialProbe;
+  for (int i = 0; i < iterations; i++)
+    {
+      serialProbe.Start();
+      transform->SetParameters(parameters);
+      serialProbe.Stop();
+    }
+
+  std::vector<float> serialField;
+  float maxDisplacement = 0;
+  FieldIteratorType serialIterator(transform->GetDeformationField(), transform->GetDeformationField()->GetLargestPossibleRegion());
+  for (serialIterator.GoToBegin(); !serialIterator.IsAtEnd(); ++serialIterator)
+    {
+      for (unsigned int d = 0; d < Dimension; d++)
+        {
+          serialField.push_back(serialIterator.Get()[d]);
+          maxDisplacement = std::max(maxDisplacement, (float)fabs(serialIterator.Get()[d]));
+        }
+    }
+  std::cout << "threads=serial, grid=" << transform->GetGrid()->GetLargestPossibleRegion().GetSize() << ", max displacement=" << maxDisplacement << ", time=" << serialProbe.GetMean() << "s" << std::endl;
+
+  if (maxDisplacement == 0)
+    {
+      std::cerr << "Expected a non-zero deformation field" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+  // Each voxel is computed the same way whatever the thread, so the field shouldn't change with the number of threads.
+  transform->UseThreadedInterpolationOn();
+
+  std::vector<float> firstField;
+  itk::ThreadIdType threads[] = { 1, 2, 4, 8 };
+  for (unsigned int t = 0; t < 4; t++)
+    {
+      transform->SetNumberOfThreads(threads[t]);
+
+      itk::TimeProbe probe;
+      for (int i = 0; i < iterations; i++)
+        {
+          probe.Start();
+          transform->SetParameters(parameters);
+          probe.Stop();
+        }
+      std::cout << "threads=" << threads[t] << ", time=" << probe.GetMean() << "s, speedup=" << serialProbe.GetMean() / probe.GetMean() << std::endl;
+
+      std::vector<float> field;
+      FieldIteratorType iterator(transform->GetDeformationField(), transform->GetDeformationField()->GetLargestPossibleRegion());
+      for (iterator.GoToBegin(); !iterator.IsAtEnd(); ++iterator)
+        {
+          for (unsigned int d = 0; d < Dimension; d++)
+            {
+              field.push_back(iterator.Get()[d]);
+            }
+        }
+
+      if (t == 0)
+        {
+          firstField = field;
+        }
+      else if (field != firstField)
+        {
+          std::cerr << "The field with " << threads[t] << " threads differs from the field with 1 thread" << std::endl;
+          return EXIT_FAILURE;
+        }
+
+      // The sums are done in a different order, so only equal to rounding.
+      for (unsigned int i = 0; i < field.size(); i++)
+        {
+          if (fabs(field[i] - serialField[i]) > 0.00001 * std::max(1.0f, maxDisplacement))
+            {
+              std::cerr << "Component " << i << " expected " << serialField[i] << ", actual=" << field[i] << std::endl;
+              return EXIT_FAILURE;
+            }
+        }
+    }
+
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Checks that the multi-threaded, separable, interpolation of the BSpline deformation
+ * field gives exactly the same field whatever the number of threads, and (to rounding)
+ * the same as the original single threaded loops. Also prints the time per SetParameters()
+ * call, as a benchmark.
+ */
+int BSplineInterpolationThreadingTest(int argc, char * argv[])
+{
+  if( argc < 4)
+    {
+    std::cerr << "Usage   : BSplineInterpolationThreadingTest dimension imageSize gridSpacing [iterations]" << std::endl;
+    return 1;
+    }
+  int dimension = niftk::ConvertToInt(argv[1]);
+  int imageSize = niftk::ConvertToInt(argv[2]);
+  double gridSpacing = niftk::ConvertToDouble(argv[3]);
+  int iterations = 1;
+  if (argc > 4)
+    {
+    iterations = niftk::ConvertToInt(argv[4]);
+    }
+  std::cerr << "Dimension:" << dimension << std::endl;
+  std::cerr << "Size:" << imageSize << std::endl;
+  std::cerr << "Grid spacing:" << gridSpacing << std::endl;
+  std::cerr << "Iterations:" << iterations << std::endl;
+
+  try
+    {
+      if (dimension == 2)
+        {
+          return DoBSplineInterpolationThreadingTest<2>(imageSize, gridSpacing, iterations);
+        }
+      else if (dimension == 3)
+        {
+          return DoBSplineInterpolationThreadingTest<3>(imageSize, gridSpacing, iterations);
+        }
+    }
+  catch( itk::ExceptionObject & excep )
+    {
+    std::cerr << "Exception caught !" << std::endl;
+    std::cerr << excep << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::cerr << "Unsupported dimension:" << dimension << std::endl;
+  return EXIT_FAILURE;
+}
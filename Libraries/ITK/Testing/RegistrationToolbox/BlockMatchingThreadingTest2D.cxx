@@ -0,0 +1,139 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#if defined(_MSC_VER)
+#pragma warning ( disable : 4786 )
+#endif
+#include <iostream>
+#include <math.h>
+#include <niftkConversionUtils.h>
+#include <itkImage.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <itkImageRegistrationFactory.h>
+#include <itkSingleResolutionImageRegistrationBuilder.h>
+#include <itkBlockMatchingMethod.h>
+#include <itkSimilarityMeasure.h>
+#include <itkAbsoluteManhattanDistancePointMetric.h>
+
+typedef float                                                                  BlockMatchingPixelType;
+typedef itk::Image< BlockMatchingPixelType, 2>                                 BlockMatchingImageType;
+typedef itk::BlockMatchingMethod<BlockMatchingImageType, double>               BlockMatchingType;
+typedef BlockMatchingType::ParametersType                                      BlockMatchingParametersType;
+
+/**
+ * Runs a rigid block matching registration of the given images, and returns the parameters.
+ */
+BlockMatchingParametersType RunBlockMatching(BlockMatchingImageType* fixedImage, 
+                                             BlockMatchingImageType* movingImage, 
+                                             int metricType, 
+                                             unsigned int numberOfThreads, 
+                                             bool useIntegralImages)
+{
+  typedef itk::SingleResolutionImageRegistrationBuilder<BlockMatchingImageType, 2, double> BuilderType;
+  typedef itk::MaskedImageRegistrationMethod<BlockMatchingImageType> ImageRegistrationMethodType;
+  typedef itk::SimilarityMeasure<BlockMatchingImageType, BlockMatchingImageType> SimilarityMeasureType;
+  typedef BlockMatchingType* BlockMatchingPointer;
+  typedef BlockMatchingType::PointSetType PointSetType;
+  typedef itk::AbsoluteManhattanDistancePointMetric<PointSetType, PointSetType> PointSetMetricType;  
+
+  BuilderType::Pointer builder = BuilderType::New();
+  builder->StartCreation((itk::SingleResRegistrationMethodTypeEnum)5);                             // Block matching
+  builder->CreateInterpolator((itk::InterpolationTypeEnum)2);                                      // Linear
+  SimilarityMeasureType::Pointer metric = builder->CreateMetric((itk::MetricTypeEnum)metricType);
+  builder->CreateTransform((itk::TransformTypeEnum)2, fixedImage);                                 // Rigid
+  builder->CreateOptimizer((itk::OptimizerTypeEnum)5);                                             // Powell
+  ImageRegistrationMethodType::Pointer method = builder->GetSingleResolutionImageRegistrationMethod();
+  BlockMatchingType::Pointer blockMatchingMethod = static_cast<BlockMatchingPointer>(method.GetPointer());
+  PointSetMetricType::Pointer pointMetric = PointSetMetricType::New();
+
+  BlockMatchingParametersType initialParameters(method->GetTransform()->GetNumberOfParameters());
+  initialParameters.Fill(0);
+
+  metric->SetWeightingFactor(0);  
+  metric->SetPrintOutMetricEvaluation(false);
+  
+  blockMatchingMethod->SetPointSetMetric(pointMetric);
+  blockMatchingMethod->SetFixedImage(fixedImage);
+  blockMatchingMethod->SetMovingImage(movingImage);
+  blockMatchingMethod->SetInitialTransformParameters(initialParameters);
+  blockMatchingMethod->SetBlockParameters(8, 6, 4, 1);
+  blockMatchingMethod->SetMinimumBlockSize(4);
+  blockMatchingMethod->SetEpsilon(0.1);
+  blockMatchingMethod->SetNumberOfThreads(numberOfThreads);
+  blockMatchingMethod->SetUseIntegralImages(useIntegralImages);
+  blockMatchingMethod->Update();
+
+  return method->GetLastTransformParameters();
+}
+
+/**
+ * Checks that block matching gives the same answer whatever the number of 
+ * threads, and that the integral image evaluator agrees with the metric.
+ */
+int BlockMatchingThreadingTest2D(int argc, char * argv[])
+{
+  if( argc < 3)
+    {
+      std::cerr << "Usage   : BlockMatchingThreadingTest2D metric tolerance" << std::endl;
+      return 1;
+    }
+
+  int metricType = niftk::ConvertToInt(argv[1]);
+  double tolerance = niftk::ConvertToDouble(argv[2]);
+
+  // Synthetic blobs, where the moving image is the fixed image shifted by (3, -2).
+  BlockMatchingImageType::SizeType size;
+  size.Fill(96);
+  BlockMatchingImageType::RegionType region;
+  region.SetSize(size);
+
+  BlockMatchingImageType::Pointer fixedImage = BlockMatchingImageType::New();
+  fixedImage->SetRegions(region);
+  fixedImage->Allocate();
+  BlockMatchingImageType::Pointer movingImage = BlockMatchingImageType::New();
+  movingImage->SetRegions(region);
+  movingImage->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<BlockMatchingImageType> fixedIterator(fixedImage, region);
+  itk::ImageRegionIteratorWithIndex<BlockMatchingImageType> movingIterator(movingImage, region);
+  for (fixedIterator.GoToBegin(), movingIterator.GoToBegin(); !fixedIterator.IsAtEnd(); ++fixedIterator, ++movingIterator)
+    {
+      double x = fixedIterator.GetIndex()[0];
+      double y = fixedIterator.GetIndex()[1];
+      fixedIterator.Set((BlockMatchingPixelType)(127.5 + 127.5 * sin(x / 5.0) * cos(y / 7.0)));
+      movingIterator.Set((BlockMatchingPixelType)(127.5 + 127.5 * sin((x - 3) / 5.0) * cos((y + 2) / 7.0)));
+    }
+
+  BlockMatchingParametersType serial = RunBlockMatching(fixedImage, movingImage, metricType, 1, false);
+  BlockMatchingParametersType threaded = RunBlockMatching(fixedImage, movingImage, metricType, 4, false);
+  BlockMatchingParametersType integral = RunBlockMatching(fixedImage, movingImage, metricType, 4, true);
+
+  std::cout << "serial=" << serial << ", threaded=" << threaded << ", integral=" << integral << std::endl;
+
+  for (unsigned int i = 0; i < serial.GetSize(); i++)
+    {
+      if (serial[i] != threaded[i])
+        {
+          std::cerr << "Expected the same parameters on 1 and 4 threads, but [" << i << "]:" << serial[i] << " != " << threaded[i] << std::endl;
+          return EXIT_FAILURE;
+        }
+      if (fabs(serial[i] - integral[i]) > tolerance)
+        {
+          std::cerr << "Expected integral images to give the same parameters, but [" << i << "]:" << serial[i] << " != " << integral[i] << std::endl;
+          return EXIT_FAILURE;
+        }
+    }
+
+  return EXIT_SUCCESS;
+}
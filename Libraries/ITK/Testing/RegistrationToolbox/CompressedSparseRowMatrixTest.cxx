@@ -0,0 +1,363 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#if defined(_MSC_VER)
+#pragma warning ( disable : 4786 )
+#endif
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include <itkImage.h>
+#include <itkCompressedSparseRowMatrix.h>
+#include <itkForwardAndBackwardProjectionMatrix.h>
+#include <itkEulerAffineTransformMatrixAndItsVariations.h>
+#include <itkIsocentricConeBeamRotationGeometry.h>
+#include <vnl/vnl_sparse_matrix.h>
+#include <vnl/vnl_vector.h>
+#include <vnl/vnl_random.h>
+
+typedef itk::CompressedSparseRowMatrix<double>   CSRMatrixType;
+typedef CSRMatrixType::RowBlock                  RowBlockType;
+typedef vnl_sparse_matrix<double>                SparseMatrixType;
+typedef vnl_vector<double>                       VectorType;
+
+static bool IsClose(const VectorType &expected, const VectorType &actual, const std::string &name)
+{
+  if (expected.size() != actual.size())
+    {
+      std::cerr << name << ": expected size " << expected.size() << ", actual=" << actual.size() << std::endl;
+      return false;
+    }
+  double tolerance = 1e-10 * std::max(1.0, expected.inf_norm());
+  for (unsigned int i = 0; i < expected.size(); i++)
+    {
+      if (fabs(expected[i] - actual[i]) > tolerance)
+        {
+          std::cerr << name << ": element " << i << " expected " << expected[i] << ", actual=" << actual[i] << std::endl;
+          return false;
+        }
+    }
+  return true;
+}
+
+/** Checks every stored element of the vnl matrix, and the number of non-zeros. */
+static bool IsSameMatrix(SparseMatrixType &expected, const CSRMatrixType &actual, const std::string &name)
+{
+  if (expected.rows() != actual.GetNumberOfRows() || expected.cols() != actual.GetNumberOfColumns())
+    {
+      std::cerr << name << ": expected " << expected.rows() << "x" << expected.cols()
+                << ", actual=" << actual.GetNumberOfRows() << "x" << actual.GetNumberOfColumns() << std::endl;
+      return false;
+    }
+
+  unsigned long int numberOfNonZeros = 0;
+  for (unsigned int r = 0; r < expected.rows(); r++)
+    {
+      SparseMatrixType::row &row = expected.get_row(r);
+      for (unsigned int i = 0; i < row.size(); i++)
+        {
+          if (fabs(row[i].second - actual.GetValue(r, row[i].first)) > 1e-12)
+            {
+              std::cerr << name << ": element (" << r << ", " << row[i].first << ") expected " << row[i].second
+                        << ", actual=" << actual.GetValue(r, row[i].first) << std::endl;
+              return false;
+            }
+        }
+      numberOfNonZeros += row.size();
+    }
+
+  if (numberOfNonZeros != actual.GetNumberOfNonZeros())
+    {
+      std::cerr << name << ": expected " << numberOfNonZeros << " non-zeros, actual=" << actual.GetNumberOfNonZeros() << std::endl;
+      return false;
+    }
+  return true;
+}
+
+/** A, then A^T, times a random vector must match vnl, on 1 or several threads. */
+static bool IsSameProducts(SparseMatrixType &expected, CSRMatrixType &actual, vnl_random &random, const std::string &name)
+{
+  VectorType x(expected.cols());
+  for (unsigned int i = 0; i < x.size(); i++)
+    {
+      x[i] = random.drand64(-1, 1);
+    }
+  VectorType p(expected.rows());
+  for (unsigned int i = 0; i < p.size(); i++)
+    {
+      p[i] = random.drand64(-1, 1);
+    }
+
+  VectorType expectedAx;
+  expected.mult(x, expectedAx);
+
+  // p^T A = (A^T p)^T
+  VectorType expectedATp;
+  expected.pre_mult(p, expectedATp);
+
+  itk::ThreadIdType threads[] = { 1, 2, 4, 7 };
+  for (unsigned int t = 0; t < 4; t++)
+    {
+      actual.SetNumberOfThreads(threads[t]);
+
+      VectorType Ax;
+      actual.Multiply(x, Ax);
+
+      VectorType ATp;
+      actual.TransposeMultiply(p, ATp);
+
+      if (!IsClose(expectedAx, Ax, name + ", A x")
+          || !IsClose(expectedATp, ATp, name + ", A^T x"))
+        {
+          std::cerr << "Failed with " << threads[t] << " threads" << std::endl;
+          return false;
+        }
+    }
+  return true;
+}
+
+/** A random matrix, with empty rows and columns, built from unevenly sized row blocks. */
+static int TestRandomMatrix()
+{
+  const unsigned int rows = 97;
+  const unsigned int columns = 61;
+
+  vnl_random random(1234);
+
+  SparseMatrixType expected(rows, columns);
+
+  unsigned int firstRows[] = { 0, 5, 6, 50, rows };
+  std::vector<RowBlockType> blocks(4);
+
+  for (unsigned int b = 0; b < blocks.size(); b++)
+    {
+      blocks[b].SetFirstRow(firstRows[b]);
+
+      for (unsigned int r = firstRows[b]; r < firstRows[b + 1]; r++)
+        {
+          if (r % 11 == 3)
+            {
+              blocks[b].FinishRow();
+              continue;
+            }
+
+          // Entries out of column order, and some columns set twice, where the last value wins.
+          unsigned int numberOfEntries = random.lrand32(0, 8);
+          for (unsigned int i = 0; i < numberOfEntries; i++)
+            {
+              unsigned int column = random.lrand32(0, columns - 2);
+              double value = random.drand64(-10, 10);
+
+              blocks[b].AddEntry(column, value);
+              expected(r, column) = value;
+            }
+          blocks[b].FinishRow();
+        }
+    }
+
+  CSRMatrixType fromBlocks(rows, columns);
+  fromBlocks.SetRowBlocks(blocks);
+
+  if (!IsSameMatrix(expected, fromBlocks, "Row blocks") || !IsSameProducts(expected, fromBlocks, random, "Row blocks"))
+    {
+      return EXIT_FAILURE;
+    }
+
+  CSRMatrixType fromSparse;
+  fromSparse.SetSparseMatrix(expected);
+
+  if (!IsSameMatrix(expected, fromSparse, "vnl_sparse_matrix") || !IsSameProducts(expected, fromSparse, random, "vnl_sparse_matrix"))
+    {
+      return EXIT_FAILURE;
+    }
+
+  std::cout << "Random " << rows << "x" << columns << " matrix with " << fromBlocks.GetNumberOfNonZeros() << " non-zeros passed" << std::endl;
+  return EXIT_SUCCESS;
+}
+
+/** The forward projection matrix traced into row blocks on several threads must match the single threaded vnl one. */
+static int TestForwardProjectionMatrix()
+{
+  typedef itk::ForwardAndBackwardProjectionMatrix<double, double>  MatrixProjectorType;
+  typedef itk::IsocentricConeBeamRotationGeometry<double>          GeometryType;
+  typedef MatrixProjectorType::InputImageType                      VolumeType;
+  typedef MatrixProjectorType::OutputImageType                     ProjectionType;
+
+  const unsigned int numberOfProjections = 3;
+
+  MatrixProjectorType::VolumeSizeType volumeSize;
+  volumeSize.Fill(8);
+  GeometryType::VolumeSpacingType volumeSpacing;
+  volumeSpacing.Fill(1.0);
+
+  MatrixProjectorType::OutputImageSizeType projectionSize;
+  projectionSize.Fill(12);
+  GeometryType::ProjectionSpacingType projectionSpacing;
+  projectionSpacing.Fill(1.5);
+
+  GeometryType::Pointer geometry = GeometryType::New();
+  geometry->SetNumberOfProjections(numberOfProjections);
+  geometry->SetFirstAngle(-20);
+  geometry->SetAngularRange(40);
+  geometry->SetFocalLength(100);
+  geometry->SetRotationAxis(itk::ISOCENTRIC_CONE_BEAM_ROTATION_IN_Y);
+  geometry->SetVolumeSize(volumeSize);
+  geometry->SetVolumeSpacing(volumeSpacing);
+  geometry->SetProjectionSize(projectionSize);
+  geometry->SetProjectionSpacing(projectionSpacing);
+
+  VolumeType::RegionType volumeRegion;
+  volumeRegion.SetSize(volumeSize);
+  VolumeType::Pointer volume = VolumeType::New();
+  volume->SetRegions(volumeRegion);
+  volume->SetSpacing(volumeSpacing);
+  volume->Allocate();
+  volume->FillBuffer(1.0);
+
+  ProjectionType::RegionType projectionRegion;
+  projectionRegion.SetSize(projectionSize);
+  ProjectionType::Pointer projection = ProjectionType::New();
+  projection->SetRegions(projectionRegion);
+  projection->SetSpacing(projectionSpacing);
+  projection->Allocate();
+  projection->FillBuffer(0.0);
+
+  MatrixProjectorType::Pointer projector = MatrixProjectorType::New();
+  projector->SetProjectionGeometry(geometry);
+
+  const unsigned long int rows = numberOfProjections * projectionSize[0] * projectionSize[1];
+  const unsigned long int columns = volumeSize[0] * volumeSize[1] * volumeSize[2];
+
+  SparseMatrixType expected(rows, columns);
+  projector->GetForwardProjectionSparseMatrix(expected, volume, projection, volumeSize, projectionSize, numberOfProjections);
+
+  vnl_random random(4321);
+
+  itk::ThreadIdType threads[] = { 1, 4 };
+  for (unsigned int t = 0; t < 2; t++)
+    {
+      projector->SetNumberOfThreads(threads[t]);
+
+      CSRMatrixType actual;
+      projector->GetForwardProjectionSparseMatrix(actual, volume, projection, volumeSize, projectionSize, numberOfProjections);
+
+      if (actual.GetNumberOfNonZeros() == 0)
+        {
+          std::cerr << "No rays intersected the volume with " << threads[t] << " threads" << std::endl;
+          return EXIT_FAILURE;
+        }
+      if (!IsSameMatrix(expected, actual, "Forward projection") || !IsSameProducts(expected, actual, random, "Forward projection"))
+        {
+          std::cerr << "Failed tracing with " << threads[t] << " threads" << std::endl;
+          return EXIT_FAILURE;
+        }
+      std::cout << "Forward projection matrix traced on " << threads[t] << " threads, with "
+                << actual.GetNumberOfNonZeros() << " non-zeros, passed" << std::endl;
+    }
+
+  return EXIT_SUCCESS;
+}
+
+/** The affine transformation matrix built into row blocks on several threads must match the vnl one. */
+static int TestAffineTransformationMatrix()
+{
+  typedef itk::EulerAffineTransformMatrixAndItsVariations<double>  AffineTransformerType;
+
+  AffineTransformerType::VolumeSizeType volumeSize;
+  volumeSize[0] = 9;
+  volumeSize[1] = 7;
+  volumeSize[2] = 6;
+
+  const unsigned long int totalSize = volumeSize[0] * volumeSize[1] * volumeSize[2];
+
+  // A translation, rotation, scaling and skew, so the voxels are interpolated, and some map outside the volume.
+  AffineTransformerType::EulerAffineTransformParametersType parameters(12);
+  parameters.Fill(0.);
+  parameters[0] = 1.3;
+  parameters[1] = -0.6;
+  parameters[2] = 0.4;
+  parameters[3] = 5.;
+  parameters[4] = -10.;
+  parameters[5] = 15.;
+  parameters[6] = 1.1;
+  parameters[7] = 0.9;
+  parameters[8] = 1.05;
+  parameters[9] = 0.02;
+  parameters[10] = -0.03;
+  parameters[11] = 0.01;
+
+  AffineTransformerType::Pointer transformer = AffineTransformerType::New();
+
+  SparseMatrixType expected(totalSize, totalSize);
+  transformer->GetAffineTransformationSparseMatrix(expected, volumeSize, parameters);
+
+  vnl_random random(2468);
+
+  itk::ThreadIdType threads[] = { 1, 4 };
+  for (unsigned int t = 0; t < 2; t++)
+    {
+      transformer->SetNumberOfThreads(threads[t]);
+
+      CSRMatrixType actual;
+      transformer->GetAffineTransformationSparseMatrix(actual, volumeSize, parameters);
+
+      if (actual.GetNumberOfNonZeros() == 0)
+        {
+          std::cerr << "No voxels mapped inside the volume with " << threads[t] << " threads" << std::endl;
+          return EXIT_FAILURE;
+        }
+      if (!IsSameMatrix(expected, actual, "Affine transformation") || !IsSameProducts(expected, actual, random, "Affine transformation"))
+        {
+          std::cerr << "Failed building with " << threads[t] << " threads" << std::endl;
+          return EXIT_FAILURE;
+        }
+      std::cout << "Affine transformation matrix built on " << threads[t] << " threads, with "
+                << actual.GetNumberOfNonZeros() << " non-zeros, passed" << std::endl;
+    }
+
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Checks the compressed sparse row matrix against vnl_sparse_matrix: built from
+ * row blocks or copied from vnl, and the forward projection and affine transformation
+ * matrices built into row blocks, with the products A x and A^T x on 1 and several threads.
+ */
+int CompressedSparseRowMatrixTest(int argc, char * argv[])
+{
+  try
+    {
+      if (TestRandomMatrix() != EXIT_SUCCESS)
+        {
+          return EXIT_FAILURE;
+        }
+      if (TestForwardProjectionMatrix() != EXIT_SUCCESS)
+        {
+          return EXIT_FAILURE;
+        }
+      if (TestAffineTransformationMatrix() != EXIT_SUCCESS)
+        {
+          return EXIT_FAILURE;
+        }
+    }
+  catch( itk::ExceptionObject & excep )
+    {
+    std::cerr << "Exception caught !" << std::endl;
+    std::cerr << excep << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
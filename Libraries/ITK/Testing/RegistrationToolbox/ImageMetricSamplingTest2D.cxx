@@ -0,0 +1,184 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#if defined(_MSC_VER)
+#pragma warning ( disable : 4786 )
+#endif
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <itkImage.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <itkTranslationTransform.h>
+#include <itkLinearInterpolateImageFunction.h>
+#include <itkImageRegistrationFactory.h>
+#include <itkSimilarityMeasure.h>
+#include <niftkConversionUtils.h>
+
+/**
+ * Checks that a metric evaluated on a subset of voxels has its optimum at the
+ * same translation as the metric evaluated on all voxels, and is close in value.
+ */
+int ImageMetricSamplingTest2D(int argc, char * argv[])
+{
+  if( argc < 6)
+    {
+    std::cerr << "Usage   : ImageMetricSamplingTest2D metric sampling fraction resampleEveryIteration tolerance" << std::endl;
+    return 1;
+    }
+  int metricType = niftk::ConvertToInt(argv[1]);
+  int sampling = niftk::ConvertToInt(argv[2]);
+  double fraction = niftk::ConvertToDouble(argv[3]);
+  bool resampleEveryIteration = niftk::ConvertToBool(argv[4]);
+  double tolerance = niftk::ConvertToDouble(argv[5]);
+
+  std::cerr << "Metric:" << metricType << std::endl;
+  std::cerr << "Sampling:" << sampling << std::endl;
+  std::cerr << "Fraction:" << fraction << std::endl;
+  std::cerr << "ResampleEveryIteration:" << resampleEveryIteration << std::endl;
+  std::cerr << "Tolerance:" << tolerance << std::endl;
+
+  const     unsigned int   Dimension = 2;
+  typedef   float          PixelType;
+  typedef itk::Image< PixelType, Dimension >   ImageType;
+
+  // Synthetic blobs, where the moving image is the fixed image shifted by (3, 0).
+  ImageType::SizeType size;
+  size.Fill(128);
+  ImageType::RegionType region;
+  region.SetSize(size);
+
+  ImageType::Pointer fixedImage = ImageType::New();
+  fixedImage->SetRegions(region);
+  fixedImage->Allocate();
+  ImageType::Pointer movingImage = ImageType::New();
+  movingImage->SetRegions(region);
+  movingImage->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> fixedIterator(fixedImage, region);
+  itk::ImageRegionIteratorWithIndex<ImageType> movingIterator(movingImage, region);
+  for (fixedIterator.GoToBegin(), movingIterator.GoToBegin(); !fixedIterator.IsAtEnd(); ++fixedIterator, ++movingIterator)
+    {
+      double x = fixedIterator.GetIndex()[0];
+      double y = fixedIterator.GetIndex()[1];
+      fixedIterator.Set((PixelType)(127.5 + 127.5 * sin(x / 9.0) * cos(y / 13.0)));
+      movingIterator.Set((PixelType)(127.5 + 127.5 * sin((x - 3) / 9.0) * cos(y / 13.0)));
+    }
+
+  typedef itk::TranslationTransform< double, Dimension >  TransformType;
+  TransformType::Pointer transform = TransformType::New();
+  transform->SetIdentity();
+
+  typedef itk::LinearInterpolateImageFunction<ImageType, double >  InterpolatorType;
+
+  typedef itk::ImageRegistrationFactory<ImageType, Dimension, double> ImageRegistrationFactoryType;
+  ImageRegistrationFactoryType::Pointer factory = ImageRegistrationFactoryType::New();
+
+  typedef itk::SimilarityMeasure<ImageType, ImageType > MetricType;
+
+  MetricType::Pointer fullMetric = factory->CreateMetric((itk::MetricTypeEnum)metricType);
+  MetricType::Pointer sampledMetric = factory->CreateMetric((itk::MetricTypeEnum)metricType, 
+                                                            (itk::SamplingStrategyEnum)sampling, 
+                                                            fraction, 
+                                                            resampleEveryIteration);
+
+  MetricType::Pointer metrics[2] = { fullMetric, sampledMetric };
+  for (unsigned int i = 0; i < 2; i++)
+    {
+      metrics[i]->SetTransform(transform);
+      metrics[i]->SetInterpolator(InterpolatorType::New());
+      metrics[i]->SetFixedImage(fixedImage);
+      metrics[i]->SetMovingImage(movingImage);
+      metrics[i]->SetIntensityBounds(0, 255, 0, 255);
+      try
+        {
+          metrics[i]->Initialize();
+        }
+      catch( itk::ExceptionObject & excep )
+        {
+        std::cerr << "Exception caught !" << std::endl;
+        std::cerr << excep << std::endl;
+        return EXIT_FAILURE;
+        }
+    }
+
+  unsigned long numberOfVoxels = region.GetNumberOfPixels();
+  std::cout << "Sampled " << sampledMetric->GetNumberOfSampledVoxels() << " of " << numberOfVoxels << " voxels." << std::endl;
+
+  if (sampledMetric->GetNumberOfSampledVoxels() == 0 
+      || sampledMetric->GetNumberOfSampledVoxels() > 2 * fraction * numberOfVoxels)
+    {
+      std::cerr << "Expected about " << fraction * numberOfVoxels << " samples, actual=" << sampledMetric->GetNumberOfSampledVoxels() << std::endl;
+      return EXIT_FAILURE;
+    }
+
+  MetricType::TransformParametersType displacement( Dimension );
+  displacement[1] = 0;
+
+  int bestFull = 0;
+  int bestSampled = 0;
+  double bestFullValue = 0;
+  double bestSampledValue = 0;
+
+  for (int tx = -2; tx <= 8; tx++)
+    {
+      displacement[0] = tx;
+
+      double fullValue = fullMetric->GetValue( displacement );
+      double sampledValue = sampledMetric->GetValue( displacement );
+
+      std::cout << "tx=" << tx << ", full=" << fullValue << ", sampled=" << sampledValue << std::endl;
+
+      if (tx == -2 
+          || (fullMetric->ShouldBeMaximized() && fullValue > bestFullValue) 
+          || (!fullMetric->ShouldBeMaximized() && fullValue < bestFullValue))
+        {
+          bestFull = tx;
+          bestFullValue = fullValue;
+        }
+      if (tx == -2 
+          || (sampledMetric->ShouldBeMaximized() && sampledValue > bestSampledValue) 
+          || (!sampledMetric->ShouldBeMaximized() && sampledValue < bestSampledValue))
+        {
+          bestSampled = tx;
+          bestSampledValue = sampledValue;
+        }
+
+      if (fabs(fullValue - sampledValue) > tolerance * std::max(1.0, fabs(fullValue)))
+        {
+          std::cerr << "At tx=" << tx << ", expected " << fullValue << ", but sampled=" << sampledValue << std::endl;
+          return EXIT_FAILURE;
+        }
+    }
+
+  if (bestFull != 3 || bestSampled != bestFull)
+    {
+      std::cerr << "Expected optimum at tx=3, full=" << bestFull << ", sampled=" << bestSampled << std::endl;
+      return EXIT_FAILURE;
+    }
+
+  // And on request, the sampled metric can still use every voxel.
+  displacement[0] = 1;
+  double fullValue = fullMetric->GetValue( displacement );
+  double allVoxelsValue = sampledMetric->GetValueUsingAllVoxels( displacement );
+  if (fabs(fullValue - allVoxelsValue) > 0.000001 * std::max(1.0, fabs(fullValue))
+      || sampledMetric->GetNumberOfFixedSamples() != fullMetric->GetNumberOfFixedSamples())
+    {
+      std::cerr << "Expected " << fullValue << ", using all voxels=" << allVoxelsValue << std::endl;
+      return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,169 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#if defined(_MSC_VER)
+#pragma warning ( disable : 4786 )
+#endif
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <itkImage.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <itkTranslationTransform.h>
+#include <itkLinearInterpolateImageFunction.h>
+#include <itkImageRegistrationFactory.h>
+#include <itkSimilarityMeasure.h>
+#include <itkTimeProbe.h>
+#include <niftkConversionUtils.h>
+
+/**
+ * Checks that evaluating a metric on several threads gives exactly the same
+ * value whatever the number of threads, and (to rounding) the same as the
+ * single threaded loop. Also prints the time per evaluation, as a benchmark.
+ */
+int ImageMetricThreadingTest2D(int argc, char * argv[])
+{
+  if( argc < 3)
+    {
+    std::cerr << "Usage   : ImageMetricThreadingTest2D metric imageSize [iterations]" << std::endl;
+    return 1;
+    }
+  int metricType = niftk::ConvertToInt(argv[1]);
+  int imageSize = niftk::ConvertToInt(argv[2]);
+  int iterations = 1;
+  if (argc > 3)
+    {
+    iterations = niftk::ConvertToInt(argv[3]);
+    }
+  std::cerr << "Metric:" << metricType << std::endl;
+  std::cerr << "Size:" << imageSize << std::endl;
+  std::cerr << "Iterations:" << iterations << std::endl;
+
+  const     unsigned int   Dimension = 2;
+  typedef   float          PixelType;
+  typedef itk::Image< PixelType, Dimension >   ImageType;
+
+  // Two smooth, slightly different, synthetic images, so we don't need test data.
+  ImageType::SizeType size;
+  size.Fill(imageSize);
+  ImageType::RegionType region;
+  region.SetSize(size);
+
+  ImageType::Pointer fixedImage = ImageType::New();
+  fixedImage->SetRegions(region);
+  fixedImage->Allocate();
+  ImageType::Pointer movingImage = ImageType::New();
+  movingImage->SetRegions(region);
+  movingImage->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> fixedIterator(fixedImage, region);
+  itk::ImageRegionIteratorWithIndex<ImageType> movingIterator(movingImage, region);
+  for (fixedIterator.GoToBegin(), movingIterator.GoToBegin(); !fixedIterator.IsAtEnd(); ++fixedIterator, ++movingIterator)
+    {
+      double x = fixedIterator.GetIndex()[0];
+      double y = fixedIterator.GetIndex()[1];
+      fixedIterator.Set((PixelType)(127.5 + 127.5 * sin(x / 7.0) * cos(y / 11.0)));
+      movingIterator.Set((PixelType)(127.5 + 127.5 * sin((x + 3) / 7.0) * cos((y - 2) / 11.0)));
+    }
+
+  typedef itk::TranslationTransform< double, Dimension >  TransformType;
+  TransformType::Pointer transform = TransformType::New();
+  transform->SetIdentity();
+
+  typedef itk::LinearInterpolateImageFunction<ImageType, double >  InterpolatorType;
+  InterpolatorType::Pointer interpolator = InterpolatorType::New();
+
+  typedef itk::ImageRegistrationFactory<ImageType, Dimension, double> ImageRegistrationFactoryType;
+  ImageRegistrationFactoryType::Pointer factory = ImageRegistrationFactoryType::New();
+
+  typedef itk::SimilarityMeasure<ImageType, ImageType > MetricType;
+  typedef MetricType* SimilarityPointer;
+  MetricType::Pointer metric = factory->CreateMetric((itk::MetricTypeEnum)metricType);
+
+  metric->SetTransform(transform);
+  metric->SetInterpolator(interpolator);
+  metric->SetFixedImage(fixedImage);
+  metric->SetMovingImage(movingImage);
+
+  SimilarityPointer similarity = dynamic_cast<SimilarityPointer>(metric.GetPointer());
+  similarity->SetIntensityBounds(0, 255, 0, 255);
+
+  try
+    {
+      metric->Initialize();
+    }
+  catch( itk::ExceptionObject & excep )
+    {
+    std::cerr << "Exception caught !" << std::endl;
+    std::cerr << excep << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  MetricType::TransformParametersType displacement( Dimension );
+  displacement[0] = 2.7;
+  displacement[1] = -1.3;
+
+  // Original, single threaded loop.
+  similarity->SetNumberOfPartialCostFunctions(0);
+
+  itk::TimeProbe serialProbe;
+  double serialValue = 0;
+  for (int i = 0; i < iterations; i++)
+    {
+      serialProbe.Start();
+      serialValue = similarity->GetValue( displacement );
+      serialProbe.Stop();
+    }
+  long int serialSamples = similarity->GetNumberOfFixedSamples();
+  std::cout << "threads=serial, value=" << serialValue << ", samples=" << serialSamples << ", time=" << serialProbe.GetMean() << "s" << std::endl;
+
+  // Same number of pieces each time, so the answer shouldn't change with the number of threads.
+  similarity->SetNumberOfPartialCostFunctions(16);
+
+  std::vector<double> values;
+  itk::ThreadIdType threads[] = { 1, 2, 4, 8 };
+  for (unsigned int t = 0; t < 4; t++)
+    {
+      similarity->SetNumberOfThreads(threads[t]);
+
+      itk::TimeProbe probe;
+      double value = 0;
+      for (int i = 0; i < iterations; i++)
+        {
+          probe.Start();
+          value = similarity->GetValue( displacement );
+          probe.Stop();
+        }
+      values.push_back(value);
+      std::cout << "threads=" << threads[t] << ", value=" << value << ", samples=" << similarity->GetNumberOfFixedSamples() << ", time=" << probe.GetMean() << "s, speedup=" << serialProbe.GetMean() / probe.GetMean() << std::endl;
+
+      if (similarity->GetNumberOfFixedSamples() != serialSamples)
+        {
+          std::cerr << "Expected samples=" << serialSamples << ", actual=" << similarity->GetNumberOfFixedSamples() << std::endl;
+          return EXIT_FAILURE;
+        }
+      if (value != values[0])
+        {
+          std::cerr << "Value with " << threads[t] << " threads=" << value << ", but with 1 thread=" << values[0] << std::endl;
+          return EXIT_FAILURE;
+        }
+      if (fabs(value - serialValue) > 0.000001 * std::max(1.0, fabs(serialValue)))
+        {
+          std::cerr << "Expected " << serialValue << ", actual=" << value << std::endl;
+          return EXIT_FAILURE;
+        }
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -32,10 +32,14 @@ void RegisterTests()
   REGISTER_TEST(EulerAffine3DTransformTest);
   REGISTER_TEST(EulerAffine3DJacobianTest);
   REGISTER_TEST(BSplineTransformTest);
+  REGISTER_TEST(BSplineInterpolationThreadingTest);
   
   // Metrics
   REGISTER_TEST(ImageMetricTest2D);
+  REGISTER_TEST(ImageMetricThreadingTest2D);
+  REGISTER_TEST(ImageMetricSamplingTest2D);
   REGISTER_TEST(MatrixLinearCombinationFunctionsTests); 
+  REGISTER_TEST(CompressedSparseRowMatrixTest);
 
   // Optimizers
   REGISTER_TEST(SquaredUCLSimplexTest);
@@ -44,6 +48,7 @@ void RegisterTests()
 
   // Block Matching
   REGISTER_TEST(SingleRes2DBlockMatchingTest);
+  REGISTER_TEST(BlockMatchingThreadingTest2D);
   
   // Deformable stuff.
   REGISTER_TEST(NMILocalHistogramDerivativeForceFilterTest);
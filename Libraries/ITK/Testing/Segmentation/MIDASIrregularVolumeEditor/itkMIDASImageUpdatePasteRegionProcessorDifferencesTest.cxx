@@ -0,0 +1,182 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#if defined(_MSC_VER)
+#pragma warning ( disable : 4786 )
+#endif
+#include <iostream>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkMIDASImageUpdatePasteRegionProcessor.h>
+#include <itkMIDASImageUpdateHistory.h>
+
+typedef itk::Image<unsigned char, 3>                             ImageType;
+typedef itk::MIDASImageUpdatePasteRegionProcessor<unsigned char, 3> ProcessorType;
+
+namespace
+{
+
+ImageType::Pointer CreateSphereImage(double centreX, double radius)
+{
+  ImageType::SizeType size;
+  size[0] = 40;
+  size[1] = 30;
+  size[2] = 20;
+  ImageType::IndexType index;
+  index.Fill(0);
+  ImageType::RegionType region;
+  region.SetSize(size);
+  region.SetIndex(index);
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(region);
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> iterator(image, region);
+  for (iterator.GoToBegin(); !iterator.IsAtEnd(); ++iterator)
+  {
+    index = iterator.GetIndex();
+    double x = index[0] - centreX;
+    double y = index[1] - 15.0;
+    double z = index[2] - 10.0;
+    iterator.Set(x * x + y * y + z * z < radius * radius ? 1 : 0);
+  }
+  return image;
+}
+
+bool AreImagesEqual(ImageType* a, ImageType* b)
+{
+  itk::ImageRegionConstIterator<ImageType> aIterator(a, a->GetLargestPossibleRegion());
+  itk::ImageRegionConstIterator<ImageType> bIterator(b, b->GetLargestPossibleRegion());
+  for (aIterator.GoToBegin(), bIterator.GoToBegin(); !aIterator.IsAtEnd(); ++aIterator, ++bIterator)
+  {
+    if (aIterator.Get() != bIterator.Get())
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+ProcessorType::Pointer CreateProcessor(ImageType* destinationImage, ImageType* sourceImage, bool storeDifferencesOnly)
+{
+  ImageType::RegionType regionOfInterest = destinationImage->GetLargestPossibleRegion();
+  ImageType::IndexType index = regionOfInterest.GetIndex();
+  ImageType::SizeType size = regionOfInterest.GetSize();
+  index[2] = 5;
+  size[2] = 10;
+  regionOfInterest.SetIndex(index);
+  regionOfInterest.SetSize(size);
+
+  ProcessorType::Pointer processor = ProcessorType::New();
+  processor->SetDestinationImage(destinationImage);
+  processor->SetDestinationRegionOfInterest(regionOfInterest);
+  processor->SetSourceImage(sourceImage);
+  processor->SetSourceRegionOfInterest(regionOfInterest);
+  processor->SetCopyBackground(false);
+  processor->SetStoreDifferencesOnly(storeDifferencesOnly);
+  return processor;
+}
+
+}
+
+/**
+ * Checks that keeping only the changed voxels for undo/redo gives the same images
+ * as keeping copies of the whole region, in much less memory, and that
+ * MIDASImageUpdateHistory releases the oldest undo data when over its limit.
+ */
+int itkMIDASImageUpdatePasteRegionProcessorDifferencesTest(int argc, char * argv[])
+{
+  ImageType::Pointer originalImage = CreateSphereImage(15.0, 8.0);
+  ImageType::Pointer sourceImage = CreateSphereImage(22.0, 8.0);
+
+  ImageType::Pointer denseImage = CreateSphereImage(15.0, 8.0);
+  ImageType::Pointer differencesImage = CreateSphereImage(15.0, 8.0);
+
+  ProcessorType::Pointer denseProcessor = CreateProcessor(denseImage, sourceImage, false);
+  ProcessorType::Pointer differencesProcessor = CreateProcessor(differencesImage, sourceImage, true);
+
+  for (int i = 0; i < 2; i++)
+  {
+    denseProcessor->Redo();
+    differencesProcessor->Redo();
+    if (!AreImagesEqual(denseProcessor->GetDestinationImage(), differencesProcessor->GetDestinationImage()))
+    {
+      std::cerr << "itkMIDASImageUpdatePasteRegionProcessorDifferencesTest: images differ after redo " << i << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (AreImagesEqual(differencesProcessor->GetDestinationImage(), originalImage))
+    {
+      std::cerr << "itkMIDASImageUpdatePasteRegionProcessorDifferencesTest: redo " << i << " did not change the image" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    denseProcessor->Undo();
+    differencesProcessor->Undo();
+    if (!AreImagesEqual(denseProcessor->GetDestinationImage(), originalImage)
+        || !AreImagesEqual(differencesProcessor->GetDestinationImage(), originalImage))
+    {
+      std::cerr << "itkMIDASImageUpdatePasteRegionProcessorDifferencesTest: images not restored after undo " << i << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::cout << "itkMIDASImageUpdatePasteRegionProcessorDifferencesTest: undo data, dense=" << denseProcessor->GetUndoDataSize()
+            << " bytes, differences only=" << differencesProcessor->GetUndoDataSize() << " bytes" << std::endl;
+
+  if (differencesProcessor->GetUndoDataSize() * 10 > denseProcessor->GetUndoDataSize())
+  {
+    std::cerr << "itkMIDASImageUpdatePasteRegionProcessorDifferencesTest: expected the differences to be less than a tenth of the dense undo data" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Now limit the memory to just over one operation, so the oldest gets released.
+  std::size_t originalLimit = itk::MIDASImageUpdateHistory::GetMemoryLimit();
+
+  ImageType::Pointer image = CreateSphereImage(15.0, 8.0);
+  ProcessorType::Pointer firstProcessor = CreateProcessor(image, sourceImage, true);
+  firstProcessor->Redo();
+  itk::MIDASImageUpdateHistory::SetMemoryLimit(firstProcessor->GetUndoDataSize() + 1);
+
+  ImageType::Pointer secondSourceImage = CreateSphereImage(30.0, 6.0);
+  ProcessorType::Pointer secondProcessor = CreateProcessor(firstProcessor->GetDestinationImage(), secondSourceImage, true);
+  secondProcessor->Redo();
+
+  itk::MIDASImageUpdateHistory::SetMemoryLimit(originalLimit);
+
+  if (!firstProcessor->GetUndoDataReleased() || secondProcessor->GetUndoDataReleased())
+  {
+    std::cerr << "itkMIDASImageUpdatePasteRegionProcessorDifferencesTest: expected only the oldest undo data to be released" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  secondProcessor->Undo();
+
+  bool caughtException = false;
+  try
+  {
+    firstProcessor->Undo();
+  }
+  catch (const itk::ExceptionObject& e)
+  {
+    caughtException = true;
+  }
+  if (!caughtException)
+  {
+    std::cerr << "itkMIDASImageUpdatePasteRegionProcessorDifferencesTest: expected undo of released operation to throw" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
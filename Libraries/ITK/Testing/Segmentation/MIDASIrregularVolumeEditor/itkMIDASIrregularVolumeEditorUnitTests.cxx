@@ -24,7 +24,9 @@ void RegisterTests()
   REGISTER_TEST(itkMIDASImageUpdateCopyRegionProcessorTest);
   REGISTER_TEST(itkMIDASImageUpdateClearRegionProcessorTest);
   REGISTER_TEST(itkMIDASImageUpdatePixelWiseSingleValueProcessorTest);
+  REGISTER_TEST(itkMIDASImageUpdatePasteRegionProcessorDifferencesTest);
   REGISTER_TEST(itkMIDASRegionGrowingImageFilterTest2);
+  REGISTER_TEST(itkMIDASRegionGrowingImageFilterScanlineTest);
   REGISTER_TEST(itkMIDASRegionOfInterestCalculatorTest);
   REGISTER_TEST(itkMIDASRegionOfInterestCalculatorBySlicesTest);
   REGISTER_TEST(itkMIDASRetainMarksNoThresholdingTest);
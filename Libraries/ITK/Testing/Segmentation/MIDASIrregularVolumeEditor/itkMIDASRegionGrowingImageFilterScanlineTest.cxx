@@ -0,0 +1,177 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#if defined(_MSC_VER)
+#pragma warning ( disable : 4786 )
+#endif
+#include <iostream>
+#include <itkImage.h>
+#include <itkPoint.h>
+#include <itkPointSet.h>
+#include <itkImageRegionIterator.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkMIDASThresholdingRegionGrowingImageFilter.h>
+#include "../itkMIDASSegmentationTestUtils.h"
+
+/**
+ * Checks that the scanline fill of itkMIDASRegionGrowingImageFilter gives exactly
+ * the same output as growing voxel by voxel, in the propagation mask mode, for
+ * propagating up and down each axis, with and without a segmentation contour image.
+ */
+int itkMIDASRegionGrowingImageFilterScanlineTest(int argc, char * argv[])
+{
+  typedef itk::Image<short, 3>              GreyScaleImageType;
+  typedef itk::Image<unsigned char, 3>      SegmentationImageType;
+  typedef itk::PointSet<double, 3>          PointSetType;
+  typedef SegmentationImageType::RegionType RegionType;
+  typedef SegmentationImageType::IndexType  IndexType;
+  typedef SegmentationImageType::PointType  PointType;
+  typedef SegmentationImageType::SizeType   SizeType;
+  typedef itk::MIDASThresholdingRegionGrowingImageFilter<GreyScaleImageType, SegmentationImageType, PointSetType> FilterType;
+
+  SizeType imageSize;
+  imageSize[0] = 24;
+  imageSize[1] = 20;
+  imageSize[2] = 16;
+
+  IndexType imageIndex;
+  imageIndex.Fill(0);
+
+  RegionType imageRegion;
+  imageRegion.SetSize(imageSize);
+  imageRegion.SetIndex(imageIndex);
+
+  // Grey image of irregular blobs, from a fixed pseudo-random sequence, so most
+  // runs of voxels within the thresholds are short, and growing has to turn corners.
+  GreyScaleImageType::Pointer greyImage = GreyScaleImageType::New();
+  greyImage->SetRegions(imageRegion);
+  greyImage->Allocate();
+
+  SegmentationImageType::Pointer contourImage = SegmentationImageType::New();
+  contourImage->SetRegions(imageRegion);
+  contourImage->Allocate();
+
+  unsigned long int random = 12345;
+  itk::ImageRegionIterator<GreyScaleImageType> greyIterator(greyImage, imageRegion);
+  itk::ImageRegionIterator<SegmentationImageType> contourIterator(contourImage, imageRegion);
+  for (greyIterator.GoToBegin(), contourIterator.GoToBegin(); !greyIterator.IsAtEnd(); ++greyIterator, ++contourIterator)
+  {
+    random = (random * 1103515245 + 12345) % 2147483648UL;
+    greyIterator.Set((random >> 8) % 10 < 7 ? 1 : 0);
+
+    random = (random * 1103515245 + 12345) % 2147483648UL;
+    contourIterator.Set((random >> 8) % 8 == 0 ? (random >> 12) % 3 : 0);
+  }
+
+  int numberOfComparisons = 0;
+
+  for (int useContours = 0; useContours < 2; useContours++)
+  {
+    for (int sliceAxis = 0; sliceAxis < 3; sliceAxis++)
+    {
+      for (int direction = -1; direction <= 1; direction += 2)
+      {
+        int sliceIndex = imageSize[sliceAxis] / 2;
+
+        // Same region as propagating up or down in the General Segmentor.
+        RegionType region = imageRegion;
+        SizeType regionSize = imageSize;
+        IndexType regionIndex = imageIndex;
+        if (direction == 1)
+        {
+          regionSize[sliceAxis] = imageSize[sliceAxis] - sliceIndex;
+          regionIndex[sliceAxis] = sliceIndex;
+        }
+        else
+        {
+          regionSize[sliceAxis] = sliceIndex + 1;
+          regionIndex[sliceAxis] = 0;
+        }
+        region.SetSize(regionSize);
+        region.SetIndex(regionIndex);
+
+        IndexType propagationMask;
+        propagationMask.Fill(0);
+        propagationMask[sliceAxis] = direction;
+
+        PointSetType::Pointer points = PointSetType::New();
+        for (int i = 0; i < 3; i++)
+        {
+          IndexType seedIndex;
+          seedIndex[0] = (5 + 7 * i) % imageSize[0];
+          seedIndex[1] = (3 + 5 * i) % imageSize[1];
+          seedIndex[2] = (2 + 4 * i) % imageSize[2];
+          seedIndex[sliceAxis] = sliceIndex;
+
+          PointType seedPoint;
+          greyImage->TransformIndexToPhysicalPoint(seedIndex, seedPoint);
+          points->GetPoints()->InsertElement(i, seedPoint);
+        }
+
+        SegmentationImageType::Pointer outputs[2];
+
+        for (int useScanlineFill = 0; useScanlineFill < 2; useScanlineFill++)
+        {
+          FilterType::Pointer filter = FilterType::New();
+          filter->SetInput(greyImage);
+          filter->SetLowerThreshold(1);
+          filter->SetUpperThreshold(1);
+          filter->SetForegroundValue(1);
+          filter->SetBackgroundValue(0);
+          filter->SetRegionOfInterest(region);
+          filter->SetUseRegionOfInterest(true);
+          filter->SetProjectSeedsIntoRegion(false);
+          filter->SetEraseFullSlice(false);
+          filter->SetPropMask(propagationMask);
+          filter->SetUsePropMaskMode(true);
+          filter->SetUseScanlineFill(useScanlineFill == 1);
+          filter->SetSeedPoints(*(points.GetPointer()));
+          if (useContours)
+          {
+            filter->SetSegmentationContourImage(contourImage);
+          }
+          filter->Update();
+
+          outputs[useScanlineFill] = filter->GetOutput();
+          outputs[useScanlineFill]->DisconnectPipeline();
+        }
+
+        unsigned long int numberOfVoxels = CountVoxelsAboveValue<unsigned char, 3>(0, outputs[0]);
+        if (numberOfVoxels == 0)
+        {
+          std::cerr << "itkMIDASRegionGrowingImageFilterScanlineTest: axis=" << sliceAxis << ", direction=" << direction
+                    << ", contours=" << useContours << ", expected some voxels to be grown, but got none" << std::endl;
+          return EXIT_FAILURE;
+        }
+
+        itk::ImageRegionConstIterator<SegmentationImageType> voxelIterator(outputs[0], imageRegion);
+        itk::ImageRegionConstIterator<SegmentationImageType> scanlineIterator(outputs[1], imageRegion);
+        for (voxelIterator.GoToBegin(), scanlineIterator.GoToBegin(); !voxelIterator.IsAtEnd(); ++voxelIterator, ++scanlineIterator)
+        {
+          if (voxelIterator.Get() != scanlineIterator.Get())
+          {
+            std::cerr << "itkMIDASRegionGrowingImageFilterScanlineTest: axis=" << sliceAxis << ", direction=" << direction
+                      << ", contours=" << useContours << ", outputs differ at " << voxelIterator.GetIndex()
+                      << ", voxel by voxel=" << (int)voxelIterator.Get() << ", scanline=" << (int)scanlineIterator.Get() << std::endl;
+            return EXIT_FAILURE;
+          }
+        }
+        numberOfComparisons++;
+      }
+    }
+  }
+
+  std::cout << "itkMIDASRegionGrowingImageFilterScanlineTest: " << numberOfComparisons << " comparisons passed" << std::endl;
+  return EXIT_SUCCESS;
+}
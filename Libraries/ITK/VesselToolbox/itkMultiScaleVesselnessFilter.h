@@ -20,12 +20,23 @@
 #include <itkHessianRecursiveGaussianImageFilter.h>
 #include <itkHessian3DToVesselnessMeasureImageFilter.h>
 #include <math.h>
+#include <string>
+#include <vector>
 
 namespace itk {
 
 /** \class MultiScaleVesselnessFilter
  * \brief Gives tha maximum filter response using Sato's filter
  * (Sato et al, MedIA 1998) per voxel, given a range of scales
+ *
+ * The second output, GetScaleOutput(), holds the scale that gave the maximum response.
+ *
+ * By default the whole image is filtered at one scale at a time. If BrickSize is set, the
+ * image is filtered in bricks of that many voxels along each axis, padded by 5 times the largest
+ * scale, so only the Hessian of a padded brick has to be held in memory, rather than that of the
+ * whole image. The scales of each brick are then shared between the threads, and the brick is cast
+ * to the output type once for all of them. The result is the same as for the whole image, apart
+ * from the (very small) tail of the Gaussian that is cut off at the padding.
  */
 template < class TInputImage, class TOutputImage >
 class ITK_EXPORT MultiScaleVesselnessFilter :
@@ -52,6 +63,7 @@ public:
   typedef typename Superclass::InputImagePointer      InputImagePointer;
   typedef typename Superclass::OutputImagePointer     OutputImagePointer;
   typedef typename Superclass::InputImageConstPointer InputImageConstPointer;
+  typedef typename Superclass::OutputImageRegionType  OutputImageRegionType;
   typedef typename InputImageType::SpacingType        SpacingType;
   typedef typename OutputImageType::PixelType         OutputPixelType;
 
@@ -73,11 +85,22 @@ public:
   itkSetMacro(MaxScale, float);
   itkSetMacro(ScaleMode, ScaleModeType);
 
+  /** Edge length of the bricks, in voxels, or 0 (the default) to filter the whole image at once. */
+  itkGetConstMacro(BrickSize, unsigned int);
+  itkSetMacro(BrickSize, unsigned int);
+
+  /** Returns the image of the scale that gave the maximum response at each voxel. */
+  OutputImageType* GetScaleOutput();
+
 protected:
   MultiScaleVesselnessFilter();
   ~MultiScaleVesselnessFilter() { };
   void PrintSelf(std::ostream&os, Indent indent) const;
 
+  /** The whole input is needed, and the whole output is generated. */
+  virtual void GenerateInputRequestedRegion();
+  virtual void EnlargeOutputRequestedRegion(DataObject *output);
+
   typedef itk::CastImageFilter< InputImageType, OutputImageType > CastFilterType;
   //typedef itk::CastImageFilter< VesselImageType, OutputImageType > CastOutFilterType;
   typedef itk::HessianRecursiveGaussianImageFilter< OutputImageType > HessianFilterType;
@@ -87,16 +110,43 @@ protected:
   /** Generate the output data. */
   virtual void GenerateData();
 
+  /** Fills all_scales from the scale range and mode, returning false if the mode is unknown. */
+  bool GenerateScales(std::vector<float>& all_scales) const;
+
+  /** Filters paddedRegion of the input at all the scales, on numberOfScaleThreads threads,
+   * and writes the maximum response, and its scale, to region of the outputs. */
+  void FilterBrick(const OutputImageRegionType& region,
+                   const OutputImageRegionType& paddedRegion,
+                   const std::vector<float>& all_scales,
+                   ThreadIdType numberOfScaleThreads);
+
 private:
   MultiScaleVesselnessFilter(const Self &); //purposely not implemented
   void operator=(const Self &);  //purposely not implemented
 
+  struct ScalesThreadStruct
+  {
+    Self*                                      Filter;
+    typename OutputImageType::Pointer          Brick;
+    OutputImageRegionType                      Region;
+    const std::vector<float>*                  Scales;
+    ThreadIdType                               NumberOfFilterThreads;
+    std::vector<std::vector<OutputPixelType> > MaxResponses;
+    std::vector<std::vector<unsigned int> >    MaxScaleIndices;
+    std::vector<std::string>                   ErrorMessages;
+  };
+
+  /** Each thread filters every n-th scale, and keeps its own maximum response, for the voxels of the region:
+   * the first thread in the outputs, with the scale index in place of the scale, and the others in buffers. */
+  static ITK_THREAD_RETURN_TYPE ScalesThreaderCallback(void *arg);
+
 
   float m_AlphaOne;
   float m_AlphaTwo;
   float   m_MinScale;
   float   m_MaxScale;
   ScaleModeType m_ScaleMode;
+  unsigned int  m_BrickSize;
 };
 
 }
@@ -5,6 +5,8 @@
 #include <itkImageRegionIterator.h>
 #include <itkMath.h>
 #include <itkImageRegionConstIterator.h>
+#include <itkMultiThreader.h>
+#include <algorithm>
 
 
 namespace itk {
@@ -17,17 +19,46 @@ MultiScaleVesselnessFilter<TInputImage, TOutputImage>::MultiScaleVesselnessFilte
   m_MinScale = 0.77;
   m_MaxScale = 3.09375;
   m_ScaleMode = LINEAR;
+  m_BrickSize = 0;
+
+  this->SetNumberOfRequiredOutputs(2);
+  this->SetNthOutput(1, this->MakeOutput(1));
 }
 
 template<class TInputImage, class TOutputImage>
-void MultiScaleVesselnessFilter<TInputImage, TOutputImage>::GenerateData()
+typename MultiScaleVesselnessFilter<TInputImage, TOutputImage>::OutputImageType*
+MultiScaleVesselnessFilter<TInputImage, TOutputImage>::GetScaleOutput()
+{
+  return static_cast<OutputImageType*>(this->ProcessObject::GetOutput(1));
+}
+
+template<class TInputImage, class TOutputImage>
+void MultiScaleVesselnessFilter<TInputImage, TOutputImage>::GenerateInputRequestedRegion()
+{
+  Superclass::GenerateInputRequestedRegion();
+
+  InputImagePointer input = const_cast<InputImageType*>(this->GetInput());
+  if (input.IsNotNull())
+  {
+    input->SetRequestedRegionToLargestPossibleRegion();
+  }
+}
+
+template<class TInputImage, class TOutputImage>
+void MultiScaleVesselnessFilter<TInputImage, TOutputImage>::EnlargeOutputRequestedRegion(DataObject *output)
+{
+  Superclass::EnlargeOutputRequestedRegion(output);
+  output->SetRequestedRegionToLargestPossibleRegion();
+}
+
+template<class TInputImage, class TOutputImage>
+bool MultiScaleVesselnessFilter<TInputImage, TOutputImage>::GenerateScales(std::vector<float>& all_scales) const
 {
-  //Scale generation
   SpacingType spacing = this->GetInput()->GetSpacing();
   float min_spacing = static_cast<float>(spacing[0]);
   unsigned int scales =floor((m_MaxScale-m_MinScale)/min_spacing +0.5f) + 1;
 
-  std::vector<float> all_scales(scales,0);
+  all_scales.assign(scales, 0);
   switch (m_ScaleMode)
   {
     case LINEAR:
@@ -47,51 +78,224 @@ void MultiScaleVesselnessFilter<TInputImage, TOutputImage>::GenerateData()
     }
     default:
     {
-      std::cerr << "Error: Unknown scale mode option for the vesselness filter" << std::endl;
-      return;
+      return false;
     }
   }
+  return true;
+}
+
+template<class TInputImage, class TOutputImage>
+void MultiScaleVesselnessFilter<TInputImage, TOutputImage>::GenerateData()
+{
+  //Scale generation
+  std::vector<float> all_scales;
+  if (!this->GenerateScales(all_scales))
+  {
+    std::cerr << "Error: Unknown scale mode option for the vesselness filter" << std::endl;
+    return;
+  }
+
+  this->AllocateOutputs();
+
+  OutputImageRegionType wholeRegion = this->GetOutput()->GetRequestedRegion();
+
+  if (m_BrickSize == 0)
+  {
+    // One scale at a time, each filter using all the threads, so that only one Hessian image is held.
+    this->FilterBrick(wholeRegion, wholeRegion, all_scales, 1);
+    return;
+  }
+
+  // Pad each brick by enough of the widest Gaussian that the response inside it is not affected by the cut.
+  float maxScale = *std::max_element(all_scales.begin(), all_scales.end());
+  SpacingType spacing = this->GetInput()->GetSpacing();
+
+  typename OutputImageRegionType::SizeType radius;
+  unsigned int numberOfBricks[ImageDimension];
+  unsigned int totalNumberOfBricks = 1;
+  for (unsigned int d = 0; d < ImageDimension; d++)
+  {
+    radius[d] = static_cast<typename OutputImageRegionType::SizeValueType>(ceil(5.0 * maxScale / spacing[d]));
+    numberOfBricks[d] = (wholeRegion.GetSize()[d] + m_BrickSize - 1) / m_BrickSize;
+    totalNumberOfBricks *= numberOfBricks[d];
+  }
 
-  // Filtering
-  typename CastFilterType::Pointer caster = CastFilterType::New();
-  typename HessianFilterType::Pointer hessianFilter = HessianFilterType::New();
-  typename VesselnessMeasureFilterType::Pointer vesselnessFilter =
-      VesselnessMeasureFilterType::New();
-  typename OutputImageType::Pointer vesselnessImage;
-
-  caster->SetInput( this->GetInput() );
-  hessianFilter->SetInput( caster->GetOutput() );
-  hessianFilter->SetNormalizeAcrossScale( true );
-  vesselnessFilter->SetInput( hessianFilter->GetOutput() );
-  vesselnessFilter->SetAlpha1( static_cast< double >(m_AlphaOne) );
-  vesselnessFilter->SetAlpha2( static_cast< double >(m_AlphaTwo) );
-  hessianFilter->SetSigma( static_cast< double >( all_scales[0] ) );
-  vesselnessFilter->Update();
-
-  typename OutputImageType::Pointer maxImage = vesselnessFilter->GetOutput();
-  maxImage->DisconnectPipeline();
-
-  typename itk::ImageRegionIterator<OutputImageType> outimageIterator(maxImage,
-                                                        maxImage->GetLargestPossibleRegion());
-
-  for (size_t s = 0; s < all_scales.size(); ++s) {
-    hessianFilter->SetSigma( static_cast< double >( all_scales[s] ) );
-    vesselnessFilter->Update();
-    vesselnessImage = vesselnessFilter->GetOutput();
-
-    typename itk::ImageRegionConstIterator<OutputImageType> vesselimageIterator(vesselnessImage,maxImage->GetLargestPossibleRegion());
-
-    vesselimageIterator.GoToBegin();
-    outimageIterator.GoToBegin();
-    while(!vesselimageIterator.IsAtEnd()) {
-      if (vesselimageIterator.Get() > outimageIterator.Get())
-        outimageIterator.Set( vesselimageIterator.Get() );
-      ++outimageIterator;
-      ++vesselimageIterator;
+  ThreadIdType numberOfScaleThreads = std::min(static_cast<ThreadIdType>(all_scales.size()), this->GetNumberOfThreads());
+
+  for (unsigned int b = 0; b < totalNumberOfBricks; ++b)
+  {
+    OutputImageRegionType region;
+    unsigned int remainder = b;
+    for (unsigned int d = 0; d < ImageDimension; d++)
+    {
+      unsigned int brickIndex = remainder % numberOfBricks[d];
+      remainder /= numberOfBricks[d];
+
+      region.SetIndex(d, wholeRegion.GetIndex()[d] + brickIndex * m_BrickSize);
+      region.SetSize(d, std::min(static_cast<typename OutputImageRegionType::SizeValueType>(m_BrickSize),
+                                 wholeRegion.GetSize()[d] - brickIndex * m_BrickSize));
     }
+
+    OutputImageRegionType paddedRegion = region;
+    paddedRegion.PadByRadius(radius);
+    paddedRegion.Crop(wholeRegion);
+
+    this->FilterBrick(region, paddedRegion, all_scales, numberOfScaleThreads);
+  }
+}
+
+template<class TInputImage, class TOutputImage>
+void MultiScaleVesselnessFilter<TInputImage, TOutputImage>::FilterBrick(
+    const OutputImageRegionType& region,
+    const OutputImageRegionType& paddedRegion,
+    const std::vector<float>& all_scales,
+    ThreadIdType numberOfScaleThreads)
+{
+  // Cast the brick once, for all the scales.
+  typename OutputImageType::Pointer brick = OutputImageType::New();
+  brick->CopyInformation(this->GetInput());
+  brick->SetRegions(paddedRegion);
+  brick->Allocate();
+
+  typename itk::ImageRegionConstIterator<InputImageType> inputIterator(this->GetInput(), paddedRegion);
+  typename itk::ImageRegionIterator<OutputImageType> brickIterator(brick, paddedRegion);
+  for (inputIterator.GoToBegin(), brickIterator.GoToBegin(); !inputIterator.IsAtEnd(); ++inputIterator, ++brickIterator)
+  {
+    brickIterator.Set(static_cast<OutputPixelType>(inputIterator.Get()));
+  }
+
+  ScalesThreadStruct str;
+  str.Filter = this;
+  str.Brick = brick;
+  str.Region = region;
+  str.Scales = &all_scales;
+  str.NumberOfFilterThreads = std::max(static_cast<ThreadIdType>(1), this->GetNumberOfThreads() / numberOfScaleThreads);
+  // The first thread keeps its maxima in the outputs, so only the other threads need buffers, and
+  // filtering the whole image on one thread needs no more memory than the outputs themselves.
+  str.MaxResponses.resize(numberOfScaleThreads);
+  str.MaxScaleIndices.resize(numberOfScaleThreads);
+  for (ThreadIdType t = 1; t < numberOfScaleThreads; t++)
+  {
+    str.MaxResponses[t].resize(region.GetNumberOfPixels());
+    str.MaxScaleIndices[t].resize(region.GetNumberOfPixels());
+  }
+  str.ErrorMessages.resize(numberOfScaleThreads);
+
+  this->GetMultiThreader()->SetNumberOfThreads(numberOfScaleThreads);
+  this->GetMultiThreader()->SetSingleMethod(this->ScalesThreaderCallback, &str);
+  this->GetMultiThreader()->SingleMethodExecute();
+
+  for (unsigned int i = 0; i < str.ErrorMessages.size(); i++)
+  {
+    if (!str.ErrorMessages[i].empty())
+    {
+      itkExceptionMacro(<< "FilterBrick():Thread " << i << " failed: " << str.ErrorMessages[i]);
+    }
+  }
+
+  // Take the maximum over the threads, choosing the smallest scale if two are equal,
+  // as a single thread going through the scales in order would. The scale output
+  // holds the first thread's scale indices until they are replaced by the scales.
+  typename itk::ImageRegionIterator<OutputImageType> outimageIterator(this->GetOutput(), region);
+  typename itk::ImageRegionIterator<OutputImageType> scaleimageIterator(this->GetScaleOutput(), region);
+
+  size_t i = 0;
+  for (outimageIterator.GoToBegin(), scaleimageIterator.GoToBegin(); !outimageIterator.IsAtEnd(); ++outimageIterator, ++scaleimageIterator, ++i)
+  {
+    OutputPixelType maxResponse = outimageIterator.Get();
+    unsigned int maxScaleIndex = static_cast<unsigned int>(scaleimageIterator.Get());
+
+    for (ThreadIdType t = 1; t < numberOfScaleThreads; t++)
+    {
+      if (str.MaxResponses[t][i] > maxResponse
+          || (str.MaxResponses[t][i] == maxResponse && str.MaxScaleIndices[t][i] < maxScaleIndex))
+      {
+        maxResponse = str.MaxResponses[t][i];
+        maxScaleIndex = str.MaxScaleIndices[t][i];
+      }
+    }
+
+    outimageIterator.Set(maxResponse);
+    scaleimageIterator.Set(static_cast<OutputPixelType>(all_scales[maxScaleIndex]));
+  }
+}
+
+template<class TInputImage, class TOutputImage>
+ITK_THREAD_RETURN_TYPE MultiScaleVesselnessFilter<TInputImage, TOutputImage>::ScalesThreaderCallback(void *arg)
+{
+  ThreadIdType threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  ThreadIdType threadCount = ((MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+  ScalesThreadStruct *str = (ScalesThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  try
+  {
+    // Each thread has its own view of the brick, so that the pipelines don't share any state.
+    typename OutputImageType::Pointer brick = OutputImageType::New();
+    brick->Graft(str->Brick);
+
+    typename HessianFilterType::Pointer hessianFilter = HessianFilterType::New();
+    typename VesselnessMeasureFilterType::Pointer vesselnessFilter =
+        VesselnessMeasureFilterType::New();
+
+    hessianFilter->SetInput( brick );
+    hessianFilter->SetNormalizeAcrossScale( true );
+    hessianFilter->SetNumberOfThreads( str->NumberOfFilterThreads );
+    hessianFilter->ReleaseDataFlagOn();
+    vesselnessFilter->SetInput( hessianFilter->GetOutput() );
+    vesselnessFilter->SetAlpha1( static_cast< double >(str->Filter->m_AlphaOne) );
+    vesselnessFilter->SetAlpha2( static_cast< double >(str->Filter->m_AlphaTwo) );
+    vesselnessFilter->SetNumberOfThreads( str->NumberOfFilterThreads );
+
+    std::vector<OutputPixelType>& maxResponses = str->MaxResponses[threadId];
+    std::vector<unsigned int>& maxScaleIndices = str->MaxScaleIndices[threadId];
+
+    for (unsigned int s = threadId; s < str->Scales->size(); s += threadCount)
+    {
+      hessianFilter->SetSigma( static_cast< double >( (*str->Scales)[s] ) );
+      vesselnessFilter->Update();
+
+      typename itk::ImageRegionConstIterator<OutputImageType> vesselimageIterator(vesselnessFilter->GetOutput(), str->Region);
+
+      if (threadId == 0)
+      {
+        // No other thread writes to the outputs until they have all finished.
+        typename itk::ImageRegionIterator<OutputImageType> outimageIterator(str->Filter->GetOutput(), str->Region);
+        typename itk::ImageRegionIterator<OutputImageType> scaleimageIterator(str->Filter->GetScaleOutput(), str->Region);
+
+        for (vesselimageIterator.GoToBegin(), outimageIterator.GoToBegin(), scaleimageIterator.GoToBegin();
+             !vesselimageIterator.IsAtEnd();
+             ++vesselimageIterator, ++outimageIterator, ++scaleimageIterator)
+        {
+          if (s == threadId || vesselimageIterator.Get() > outimageIterator.Get())
+          {
+            outimageIterator.Set(vesselimageIterator.Get());
+            scaleimageIterator.Set(static_cast<OutputPixelType>(s));
+          }
+        }
+        continue;
+      }
+
+      size_t i = 0;
+      for (vesselimageIterator.GoToBegin(); !vesselimageIterator.IsAtEnd(); ++vesselimageIterator, ++i)
+      {
+        if (s == threadId || vesselimageIterator.Get() > maxResponses[i])
+        {
+          maxResponses[i] = vesselimageIterator.Get();
+          maxScaleIndices[i] = s;
+        }
+      }
+    }
+  }
+  catch (ExceptionObject &e)
+  {
+    str->ErrorMessages[threadId] = e.GetDescription();
+  }
+  catch (std::exception &e)
+  {
+    str->ErrorMessages[threadId] = e.what();
   }
 
-  this->GraftOutput( maxImage );
+  return ITK_THREAD_RETURN_VALUE;
 }
 
 /* ---------------------------------------------------------------------
@@ -104,6 +308,7 @@ MultiScaleVesselnessFilter<TInputImage, TOutputImage>
 ::PrintSelf(std::ostream& os, Indent indent) const
 {
   Superclass::PrintSelf(os,indent);
+  os << indent << "BrickSize: " << m_BrickSize << std::endl;
 }
 
 }// end namespace
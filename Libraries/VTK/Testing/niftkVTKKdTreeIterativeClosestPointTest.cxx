@@ -0,0 +1,326 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#if defined(_MSC_VER)
+#pragma warning ( disable : 4786 )
+#endif
+
+#include <niftkVTKKdTreeIterativeClosestPoint.h>
+#include <niftkVTKPointKdTree.h>
+#include <niftkVTKFunctions.h>
+
+#include <algorithm>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <limits>
+#include <vtkMatrix4x4.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+/// Returns a rotation about a unit axis through the origin, followed by a translation.
+vtkSmartPointer<vtkMatrix4x4> CreateRigidMatrix(const double axis[3], double angle, const double translation[3])
+{
+  double s = std::sin(angle);
+  double c = 1 - std::cos(angle);
+  double rotation[3][3] = {
+    { 1 - c * (axis[1] * axis[1] + axis[2] * axis[2]), c * axis[0] * axis[1] - s * axis[2], c * axis[0] * axis[2] + s * axis[1] },
+    { c * axis[0] * axis[1] + s * axis[2], 1 - c * (axis[0] * axis[0] + axis[2] * axis[2]), c * axis[1] * axis[2] - s * axis[0] },
+    { c * axis[0] * axis[2] - s * axis[1], c * axis[1] * axis[2] + s * axis[0], 1 - c * (axis[0] * axis[0] + axis[1] * axis[1]) }
+  };
+
+  vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  matrix->Identity();
+  for (int r = 0; r < 3; r++)
+  {
+    for (int k = 0; k < 3; k++)
+    {
+      matrix->SetElement(r, k, rotation[r][k]);
+    }
+    matrix->SetElement(r, 3, translation[r]);
+  }
+  return matrix;
+}
+
+
+//-----------------------------------------------------------------------------
+/// Returns a copy of the points of polyData, moved by matrix, without any cells.
+vtkSmartPointer<vtkPolyData> TransformPoints(vtkPolyData& polyData, vtkMatrix4x4& matrix)
+{
+  vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+  double point[4];
+  double transformed[4];
+
+  for (vtkIdType i = 0; i < polyData.GetNumberOfPoints(); i++)
+  {
+    polyData.GetPoint(i, point);
+    point[3] = 1;
+    matrix.MultiplyPoint(point, transformed);
+    points->InsertNextPoint(transformed[0], transformed[1], transformed[2]);
+  }
+
+  vtkSmartPointer<vtkPolyData> result = vtkSmartPointer<vtkPolyData>::New();
+  result->SetPoints(points);
+  return result;
+}
+
+
+//-----------------------------------------------------------------------------
+double GetMaximumDifference(vtkMatrix4x4& a, vtkMatrix4x4& b)
+{
+  double maximum = 0;
+  for (int r = 0; r < 4; r++)
+  {
+    for (int c = 0; c < 4; c++)
+    {
+      maximum = std::max(maximum, std::abs(a.GetElement(r, c) - b.GetElement(r, c)));
+    }
+  }
+  return maximum;
+}
+
+
+//-----------------------------------------------------------------------------
+bool KdTreeMatchesBruteForceTest(vtkPolyData& sphere)
+{
+  niftk::VTKPointKdTree tree;
+  tree.Build(sphere.GetPoints());
+
+  if (tree.GetNumberOfPoints() != sphere.GetNumberOfPoints())
+  {
+    std::cerr << "KdTreeMatchesBruteForceTest: expected " << sphere.GetNumberOfPoints() << " points, actual=" << tree.GetNumberOfPoints() << std::endl;
+    return false;
+  }
+
+  double target[3];
+  for (int i = 0; i < 500; i++)
+  {
+    double query[3] = { 60 * std::sin(0.37 * i), 60 * std::cos(1.13 * i), 55 * std::sin(0.71 * i + 0.3) };
+
+    double expected = std::numeric_limits<double>::max();
+    for (vtkIdType j = 0; j < sphere.GetNumberOfPoints(); j++)
+    {
+      sphere.GetPoint(j, target);
+      double dx = target[0] - query[0];
+      double dy = target[1] - query[1];
+      double dz = target[2] - query[2];
+      expected = std::min(expected, dx * dx + dy * dy + dz * dz);
+    }
+
+    double actual = 0;
+    vtkIdType id = tree.FindClosestPoint(query, actual);
+    sphere.GetPoint(id, target);
+    double dx = target[0] - query[0];
+    double dy = target[1] - query[1];
+    double dz = target[2] - query[2];
+
+    if (actual != expected || dx * dx + dy * dy + dz * dz != actual)
+    {
+      std::cerr << "KdTreeMatchesBruteForceTest: query " << i << ", expected=" << expected << ", actual=" << actual << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+
+//-----------------------------------------------------------------------------
+bool RecoversTransformTest(vtkSmartPointer<vtkPolyData> sphere, bool pointToPlane, double scale)
+{
+  double axis[3] = { 0.48, 0.6, 0.64 };
+  double translation[3] = { 3 * scale, -2 * scale, 4 * scale };
+  vtkSmartPointer<vtkMatrix4x4> expected = CreateRigidMatrix(axis, 0.15 * scale, translation);
+  vtkSmartPointer<vtkMatrix4x4> inverse = vtkSmartPointer<vtkMatrix4x4>::New();
+  vtkMatrix4x4::Invert(expected, inverse);
+
+  niftk::VTKKdTreeIterativeClosestPoint icp;
+  icp.SetSource(TransformPoints(*sphere, *inverse));
+  icp.SetTarget(sphere);
+  icp.SetICPMaxLandmarks(2000);
+  icp.SetICPMaxIterations(200);
+  icp.SetPointToPlane(pointToPlane);
+  double residual = icp.Run();
+
+  vtkSmartPointer<vtkMatrix4x4> actual = icp.GetTransform();
+  double difference = GetMaximumDifference(*expected, *actual);
+
+  if (difference > 1e-3 || residual > 1e-3)
+  {
+    std::cerr << "RecoversTransformTest: pointToPlane=" << pointToPlane << ", scale=" << scale << ", difference=" << difference
+              << ", residual=" << residual << ", iterations=" << icp.GetNumberOfIterations() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+
+//-----------------------------------------------------------------------------
+bool SameForAnyNumberOfThreadsTest(vtkSmartPointer<vtkPolyData> sphere, bool pointToPlane)
+{
+  double axis[3] = { 0, 0.6, 0.8 };
+  double translation[3] = { -1, 5, 2 };
+  vtkSmartPointer<vtkMatrix4x4> transform = CreateRigidMatrix(axis, 0.1, translation);
+  vtkSmartPointer<vtkPolyData> source = TransformPoints(*sphere, *transform);
+
+  vtkSmartPointer<vtkMatrix4x4> results[2];
+  int numberOfThreads[2] = { 1, 4 };
+
+  for (int i = 0; i < 2; i++)
+  {
+    niftk::VTKKdTreeIterativeClosestPoint icp;
+    icp.SetSource(source);
+    icp.SetTarget(sphere);
+    icp.SetICPMaxLandmarks(3000);
+    icp.SetICPMaxIterations(20);
+    icp.SetTrimmedPercentage(90);
+    icp.SetPointToPlane(pointToPlane);
+    icp.SetNumberOfThreads(numberOfThreads[i]);
+    icp.Run();
+    results[i] = icp.GetTransform();
+  }
+
+  if (GetMaximumDifference(*results[0], *results[1]) != 0)
+  {
+    std::cerr << "SameForAnyNumberOfThreadsTest: pointToPlane=" << pointToPlane
+              << ", difference=" << GetMaximumDifference(*results[0], *results[1]) << std::endl;
+    return false;
+  }
+  return true;
+}
+
+
+//-----------------------------------------------------------------------------
+bool TrimmingIgnoresOutliersTest(vtkSmartPointer<vtkPolyData> sphere)
+{
+  double axis[3] = { 0.8, 0, 0.6 };
+  double translation[3] = { 2, 2, -3 };
+  vtkSmartPointer<vtkMatrix4x4> expected = CreateRigidMatrix(axis, 0.1, translation);
+  vtkSmartPointer<vtkMatrix4x4> inverse = vtkSmartPointer<vtkMatrix4x4>::New();
+  vtkMatrix4x4::Invert(expected, inverse);
+
+  // Push one point in ten well away from the surface.
+  vtkSmartPointer<vtkPolyData> source = TransformPoints(*sphere, *inverse);
+  double point[3];
+  for (vtkIdType i = 0; i < source->GetNumberOfPoints(); i += 10)
+  {
+    source->GetPoint(i, point);
+    source->GetPoints()->SetPoint(i, 1.5 * point[0], 1.5 * point[1], 1.5 * point[2]);
+  }
+
+  niftk::VTKKdTreeIterativeClosestPoint icp;
+  icp.SetSource(source);
+  icp.SetTarget(sphere);
+  icp.SetICPMaxLandmarks(source->GetNumberOfPoints());
+  icp.SetICPMaxIterations(200);
+  icp.SetTrimmedPercentage(85);
+  icp.SetPointToPlane(true);
+  icp.Run();
+
+  vtkSmartPointer<vtkMatrix4x4> actual = icp.GetTransform();
+  double difference = GetMaximumDifference(*expected, *actual);
+
+  if (difference > 1e-3)
+  {
+    std::cerr << "TrimmingIgnoresOutliersTest: difference=" << difference << std::endl;
+    return false;
+  }
+  return true;
+}
+
+
+//-----------------------------------------------------------------------------
+bool ResidualMatchesBruteForceTest(vtkSmartPointer<vtkPolyData> sphere)
+{
+  double axis[3] = { 1, 0, 0 };
+  double translation[3] = { 0.5, 0, 0 };
+  vtkSmartPointer<vtkMatrix4x4> transform = CreateRigidMatrix(axis, 0.05, translation);
+  vtkSmartPointer<vtkPolyData> source = TransformPoints(*sphere, *transform);
+
+  niftk::VTKKdTreeIterativeClosestPoint icp;
+  icp.SetSource(source);
+  icp.SetTarget(sphere);
+  icp.SetICPMaxLandmarks(source->GetNumberOfPoints());
+  icp.SetICPMaxIterations(2);
+  icp.Run();
+
+  vtkSmartPointer<vtkMatrix4x4> matrix = icp.GetTransform();
+  vtkSmartPointer<vtkPolyData> moved = TransformPoints(*source, *matrix);
+
+  double expected = 0;
+  double point[3];
+  double target[3];
+  for (vtkIdType i = 0; i < moved->GetNumberOfPoints(); i++)
+  {
+    moved->GetPoint(i, point);
+    double closest = std::numeric_limits<double>::max();
+    for (vtkIdType j = 0; j < sphere->GetNumberOfPoints(); j++)
+    {
+      sphere->GetPoint(j, target);
+      double dx = target[0] - point[0];
+      double dy = target[1] - point[1];
+      double dz = target[2] - point[2];
+      closest = std::min(closest, dx * dx + dy * dy + dz * dz);
+    }
+    expected += closest;
+  }
+  expected = std::sqrt(expected / moved->GetNumberOfPoints());
+
+  double actual = icp.GetRMSResidual(*source);
+  if (std::abs(expected - actual) > 1e-4 * expected || expected == 0)
+  {
+    std::cerr << "ResidualMatchesBruteForceTest: expected=" << expected << ", actual=" << actual << std::endl;
+    return false;
+  }
+  return true;
+}
+
+} // end anonymous namespace
+
+/**
+ * Checks the k-d tree closest points against a brute force search, and that
+ * niftk::VTKKdTreeIterativeClosestPoint recovers a known rigid transformation.
+ */
+int niftkVTKKdTreeIterativeClosestPointTest ( int argc, char * argv[] )
+{
+  if ( argc != 1 )
+  {
+    std::cerr << "Usage niftkVTKKdTreeIterativeClosestPointTest" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkSmartPointer<vtkPolyData> sphere = niftk::CreateBumpySphere(50, 120);
+
+  bool success = true;
+  success = success && KdTreeMatchesBruteForceTest(*sphere);
+  success = success && RecoversTransformTest(sphere, false, 0.1);
+  success = success && RecoversTransformTest(sphere, true, 0.3);
+  success = success && RecoversTransformTest(sphere, true, 1);
+  success = success && SameForAnyNumberOfThreadsTest(sphere, false);
+  success = success && SameForAnyNumberOfThreadsTest(sphere, true);
+  success = success && TrimmingIgnoresOutliersTest(sphere);
+  success = success && ResidualMatchesBruteForceTest(sphere);
+  if ( success )
+  {
+    return EXIT_SUCCESS;
+  }
+  else
+  {
+    return EXIT_FAILURE;
+  }
+}
@@ -0,0 +1,273 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#if defined(_MSC_VER)
+#pragma warning ( disable : 4786 )
+#endif
+
+#include <niftkVTKSurfaceDistance.h>
+#include <niftkVTKFunctions.h>
+
+#include <algorithm>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <vtkCellArray.h>
+#include <vtkCellLocator.h>
+#include <vtkDoubleArray.h>
+#include <vtkGenericCell.h>
+#include <vtkIdTypeArray.h>
+#include <vtkMath.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+/// Creates points scattered inside, on and outside the sphere, at radius*scale.
+vtkSmartPointer<vtkPoints> CreateQueryPoints(int numberOfPoints)
+{
+  vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+  for (int i = 0; i < numberOfPoints; i++)
+  {
+    double direction[3] = { std::sin(0.37 * i), std::cos(1.13 * i), std::sin(0.71 * i + 0.3) };
+    double length = std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+    double radius = 30 * (0.5 + 0.5 * std::sin(0.0123 * i) * std::sin(0.0123 * i)) + 2 * std::sin(0.9 * i);
+    points->InsertNextPoint(radius * direction[0] / length, radius * direction[1] / length, radius * direction[2] / length);
+  }
+  return points;
+}
+
+
+//-----------------------------------------------------------------------------
+bool MatchesCellLocatorTest(vtkPolyData* sphere, vtkPoints* points)
+{
+  niftk::VTKSurfaceDistance surfaceDistance;
+  surfaceDistance.SetTarget(sphere);
+
+  if (surfaceDistance.GetNumberOfTriangles() != sphere->GetNumberOfCells())
+  {
+    std::cerr << "MatchesCellLocatorTest: expected " << sphere->GetNumberOfCells() << " triangles, actual=" << surfaceDistance.GetNumberOfTriangles() << std::endl;
+    return false;
+  }
+
+  vtkSmartPointer<vtkDoubleArray> distances = vtkSmartPointer<vtkDoubleArray>::New();
+  vtkSmartPointer<vtkIdTypeArray> cellIds = vtkSmartPointer<vtkIdTypeArray>::New();
+  vtkSmartPointer<vtkPoints> closestPoints = vtkSmartPointer<vtkPoints>::New();
+  surfaceDistance.ComputeDistances(points, distances, cellIds, closestPoints);
+
+  vtkSmartPointer<vtkCellLocator> locator = vtkSmartPointer<vtkCellLocator>::New();
+  locator->SetDataSet(sphere);
+  locator->BuildLocator();
+
+  vtkSmartPointer<vtkGenericCell> cell = vtkSmartPointer<vtkGenericCell>::New();
+  double point[3];
+  double expectedPoint[3];
+  double actualPoint[3];
+  double cellPoint[3];
+  vtkIdType cellId;
+  int subId;
+  double distanceSquared;
+  double pcoords[3];
+  double weights[3];
+
+  for (vtkIdType i = 0; i < points->GetNumberOfPoints(); i++)
+  {
+    points->GetPoint(i, point);
+    locator->FindClosestPoint(point, expectedPoint, cell, cellId, subId, distanceSquared);
+    closestPoints->GetPoint(i, actualPoint);
+
+    double expected = std::sqrt(distanceSquared);
+    double actual = distances->GetValue(i);
+
+    // The closest cell may be any of those that share the closest point, but it must be at the same distance.
+    sphere->GetCell(cellIds->GetValue(i), cell);
+    double cellDistanceSquared = 0;
+    cell->EvaluatePosition(point, cellPoint, subId, pcoords, cellDistanceSquared, weights);
+
+    if (std::abs(expected - actual) > 1e-6
+        || std::abs(std::sqrt(cellDistanceSquared) - actual) > 1e-6
+        || std::sqrt(vtkMath::Distance2BetweenPoints(point, actualPoint)) - actual > 1e-6)
+    {
+      std::cerr << "MatchesCellLocatorTest: point " << i << ", expected=" << expected << ", actual=" << actual
+                << ", distance to cell=" << std::sqrt(cellDistanceSquared) << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+
+//-----------------------------------------------------------------------------
+bool SignedDistanceTest(vtkPolyData* sphere, vtkPoints* points)
+{
+  niftk::VTKSurfaceDistance surfaceDistance;
+  surfaceDistance.SetTarget(sphere);
+  surfaceDistance.SetSignedDistance(true);
+
+  vtkSmartPointer<vtkDoubleArray> distances = vtkSmartPointer<vtkDoubleArray>::New();
+  surfaceDistance.ComputeDistances(points, distances);
+
+  double point[3];
+  for (vtkIdType i = 0; i < points->GetNumberOfPoints(); i++)
+  {
+    points->GetPoint(i, point);
+    double radius = std::sqrt(point[0] * point[0] + point[1] * point[1] + point[2] * point[2]);
+
+    // The bumps are at most 2 from a radius of 20, so these are clearly inside or outside.
+    if ((radius < 17.5 && distances->GetValue(i) >= 0) || (radius > 22.5 && distances->GetValue(i) <= 0))
+    {
+      std::cerr << "SignedDistanceTest: point " << i << " at radius " << radius << " has distance " << distances->GetValue(i) << std::endl;
+      return false;
+    }
+  }
+
+  // The poles are vertices, so the sign there depends on the vertex pseudo-normals.
+  double inside[3] = { 0, 0, 19.5 };
+  double outside[3] = { 0.01, 0, 20.5 };
+  if (surfaceDistance.FindClosestPoint(inside) >= 0 || surfaceDistance.FindClosestPoint(outside) <= 0)
+  {
+    std::cerr << "SignedDistanceTest: wrong sign near the pole, inside=" << surfaceDistance.FindClosestPoint(inside)
+              << ", outside=" << surfaceDistance.FindClosestPoint(outside) << std::endl;
+    return false;
+  }
+  return true;
+}
+
+
+//-----------------------------------------------------------------------------
+bool SameForAnyNumberOfThreadsTest(vtkPolyData* sphere, vtkPoints* points)
+{
+  vtkSmartPointer<vtkDoubleArray> distances[2];
+  vtkSmartPointer<vtkIdTypeArray> cellIds[2];
+  int numberOfThreads[2] = { 1, 4 };
+
+  for (int i = 0; i < 2; i++)
+  {
+    niftk::VTKSurfaceDistance surfaceDistance;
+    surfaceDistance.SetTarget(sphere);
+    surfaceDistance.SetSignedDistance(true);
+    surfaceDistance.SetNumberOfThreads(numberOfThreads[i]);
+
+    distances[i] = vtkSmartPointer<vtkDoubleArray>::New();
+    cellIds[i] = vtkSmartPointer<vtkIdTypeArray>::New();
+    surfaceDistance.ComputeDistances(points, distances[i], cellIds[i]);
+  }
+
+  for (vtkIdType i = 0; i < points->GetNumberOfPoints(); i++)
+  {
+    if (distances[0]->GetValue(i) != distances[1]->GetValue(i) || cellIds[0]->GetValue(i) != cellIds[1]->GetValue(i))
+    {
+      std::cerr << "SameForAnyNumberOfThreadsTest: point " << i << " differs" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+
+//-----------------------------------------------------------------------------
+bool MixedCellsTest(vtkPolyData* sphere, vtkPoints* points)
+{
+  // The sphere, with a line above the north pole and a vertex to one side, which VTKSurfaceDistance ignores.
+  vtkSmartPointer<vtkPoints> targetPoints = vtkSmartPointer<vtkPoints>::New();
+  targetPoints->DeepCopy(sphere->GetPoints());
+  vtkIdType line[2] = { targetPoints->InsertNextPoint(0, 0, 30), targetPoints->InsertNextPoint(0, 0, 40) };
+  vtkIdType vertex = targetPoints->InsertNextPoint(40, 0, 0);
+
+  vtkSmartPointer<vtkCellArray> lines = vtkSmartPointer<vtkCellArray>::New();
+  lines->InsertNextCell(2, line);
+  vtkSmartPointer<vtkCellArray> verts = vtkSmartPointer<vtkCellArray>::New();
+  verts->InsertNextCell(1, &vertex);
+
+  vtkSmartPointer<vtkPolyData> target = vtkSmartPointer<vtkPolyData>::New();
+  target->SetPoints(targetPoints);
+  target->SetPolys(sphere->GetPolys());
+  target->SetLines(lines);
+  target->SetVerts(verts);
+
+  // Points closest to the line and the vertex, then the others.
+  vtkSmartPointer<vtkPoints> sourcePoints = vtkSmartPointer<vtkPoints>::New();
+  sourcePoints->InsertNextPoint(0, 1, 35);
+  sourcePoints->InsertNextPoint(41, 0, 0);
+  for (vtkIdType i = 0; i < points->GetNumberOfPoints(); i++)
+  {
+    sourcePoints->InsertNextPoint(points->GetPoint(i));
+  }
+  vtkSmartPointer<vtkPolyData> source = vtkSmartPointer<vtkPolyData>::New();
+  source->SetPoints(sourcePoints);
+
+  vtkSmartPointer<vtkDoubleArray> distances;
+  niftk::DistanceToSurface(source, target, distances);
+
+  vtkSmartPointer<vtkCellLocator> locator = vtkSmartPointer<vtkCellLocator>::New();
+  locator->SetDataSet(target);
+  locator->BuildLocator();
+
+  if (distances->GetNumberOfTuples() != sourcePoints->GetNumberOfPoints()
+      || std::abs(distances->GetValue(0) - 1) > 1e-6
+      || std::abs(distances->GetValue(1) - 1) > 1e-6)
+  {
+    std::cerr << "MixedCellsTest: expected the line and vertex at distance 1, actual="
+              << distances->GetValue(0) << " and " << distances->GetValue(1) << std::endl;
+    return false;
+  }
+
+  double point[3];
+  for (vtkIdType i = 0; i < sourcePoints->GetNumberOfPoints(); i++)
+  {
+    sourcePoints->GetPoint(i, point);
+    double expected = niftk::DistanceToSurface(point, locator);
+    if (std::abs(expected - distances->GetValue(i)) > 1e-6)
+    {
+      std::cerr << "MixedCellsTest: point " << i << ", expected=" << expected << ", actual=" << distances->GetValue(i) << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+} // end anonymous namespace
+
+/**
+ * Checks niftk::VTKSurfaceDistance against vtkCellLocator, and the sign of its distances,
+ * and that niftk::DistanceToSurface() still finds the vertices and lines of a target.
+ */
+int niftkVTKSurfaceDistanceTest ( int argc, char * argv[] )
+{
+  if ( argc != 1 )
+  {
+    std::cerr << "Usage niftkVTKSurfaceDistanceTest" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkSmartPointer<vtkPolyData> sphere = niftk::CreateBumpySphere(20, 50);
+  vtkSmartPointer<vtkPoints> points = CreateQueryPoints(5000);
+
+  bool success = true;
+  success = success && MatchesCellLocatorTest(sphere, points);
+  success = success && SignedDistanceTest(sphere, points);
+  success = success && SameForAnyNumberOfThreadsTest(sphere, points);
+  success = success && MixedCellsTest(sphere, points);
+  if ( success )
+  {
+    return EXIT_SUCCESS;
+  }
+  else
+  {
+    return EXIT_FAILURE;
+  }
+}
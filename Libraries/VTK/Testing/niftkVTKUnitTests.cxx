@@ -24,5 +24,7 @@ void RegisterTests()
   REGISTER_TEST(niftkVTKLoadSaveMatrix4x4Test);
   REGISTER_TEST(niftkVTKInterpolateMatrixTest);
   REGISTER_TEST(niftkVTKFunctionsTest);
+  REGISTER_TEST(niftkVTKKdTreeIterativeClosestPointTest);
+  REGISTER_TEST(niftkVTKSurfaceDistanceTest);
 }
 
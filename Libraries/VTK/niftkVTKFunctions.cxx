@@ -13,10 +13,13 @@
 =============================================================================*/
 
 #include <math.h>
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <niftkConversionUtils.h>
 #include <niftkMathsUtils.h>
 #include "niftkVTKFunctions.h"
+#include "niftkVTKSurfaceDistance.h"
 #include <vtkSmartPointer.h>
 #include <vtkTransformPolyDataFilter.h>
 #include <vtkBoxMuellerRandomSequence.h>
@@ -26,6 +29,7 @@
 #include <vtkUnsignedCharArray.h>
 #include <vtkPointData.h>
 #include <vtkGenericCell.h>
+#include <vtkSphereSource.h>
 #include <vtkVersion.h>
 #include <vtkMath.h>
 #include <sstream>
@@ -406,6 +410,35 @@ double NormalisedRNG (vtkRandomSequence* rng)
 }
 
 
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> CreateBumpySphere(double radius, int resolution)
+{
+  vtkSmartPointer<vtkSphereSource> source = vtkSmartPointer<vtkSphereSource>::New();
+  source->SetRadius(radius);
+  source->SetThetaResolution(resolution);
+  source->SetPhiResolution(std::max(3, 3 * resolution / 5));
+  source->Update();
+
+  vtkSmartPointer<vtkPolyData> sphere = vtkSmartPointer<vtkPolyData>::New();
+  sphere->DeepCopy(source->GetOutput());
+  sphere->GetPointData()->SetNormals(NULL);
+
+  // Scales each point along its radius, by a function of its polar angle, theta, and its
+  // azimuth, phi. Both terms are zero at theta = 0 and pi, so the poles don't move.
+  vtkPoints* points = sphere->GetPoints();
+  double point[3];
+  for (vtkIdType i = 0; i < points->GetNumberOfPoints(); i++)
+  {
+    points->GetPoint(i, point);
+    double theta = std::acos(std::max(-1.0, std::min(1.0, point[2] / radius)));
+    double phi = std::atan2(point[1], point[0]);
+    double scale = 1 + 0.06 * std::sin(3 * theta) * std::sin(4 * phi) + 0.04 * std::sin(theta) * std::cos(5 * theta + phi);
+    points->SetPoint(i, scale * point[0], scale * point[1], scale * point[2]);
+  }
+  return sphere;
+}
+
+
 //-----------------------------------------------------------------------------
 bool DistancesToColorMap ( vtkPolyData * source, vtkPolyData * target )
 {
@@ -511,6 +544,19 @@ void DistanceToSurface(vtkPolyData* source, vtkPolyData* target, vtkSmartPointer
   result->SetNumberOfComponents(1);
   result->SetName("Distances");
 
+  // Purely polygonal surfaces are searched in parallel. VTKSurfaceDistance ignores vertices
+  // and lines, so anything with them is searched with a vtkCellLocator, which includes them.
+  if (target->GetNumberOfVerts() == 0 && target->GetNumberOfLines() == 0 && source->GetPoints() != NULL)
+  {
+    niftk::VTKSurfaceDistance surfaceDistance;
+    surfaceDistance.SetTarget(target);
+    if (surfaceDistance.GetNumberOfTriangles() > 0)
+    {
+      surfaceDistance.ComputeDistances(source->GetPoints(), result);
+      return;
+    }
+  }
+
   vtkSmartPointer<vtkCellLocator> targetLocator = vtkSmartPointer<vtkCellLocator>::New();
   targetLocator->SetDataSet(target);
   targetLocator->BuildLocator();
@@ -151,6 +151,16 @@ extern "C++" NIFTKVTK_WINEXPORT vtkSmartPointer<vtkTransform> RigidTransformFrom
  * */
 extern "C++" NIFTKVTK_WINEXPORT double NormalisedRNG (vtkRandomSequence * rng);
 
+/**
+ * \brief Creates a closed, outward facing, triangulated sphere, centred on the origin, with
+ * bumps on it so that it has no rotational symmetry, for testing and benchmarking surface algorithms.
+ * The bumps are at most a tenth of the radius, and vanish at the poles, which stay at (0, 0, +/-radius).
+ * \param radius the radius of the sphere before the bumps are added
+ * \param resolution the number of points around the equator, giving about 0.6 * resolution * resolution points
+ * \return The sphere, without normals
+ */
+extern "C++" NIFTKVTK_WINEXPORT vtkSmartPointer<vtkPolyData> CreateBumpySphere(double radius, int resolution);
+
 /**
  * \brief Measures the euclidean distances between the points in two polydata, and sets the
  * \brief scalars in both polydata to a color map to show the differences, min distance red,
@@ -191,6 +201,8 @@ extern "C++" NIFTKVTK_WINEXPORT void DistanceToSurface (vtkPolyData * source, vt
  * \brief Calculates the euclidean distance (in 3D) between each point in the
  * source polydata and the closest point on the target polydata mesh.
  * The result distances are stored in the scalar values passed in.
+ * If the target has polygons, and no vertices or lines, it is searched on several threads with
+ * niftk::VTKSurfaceDistance, otherwise with a vtkCellLocator.
  * \param source,target the source and target polydata.
  */
 extern "C++" NIFTKVTK_WINEXPORT void DistanceToSurface(vtkPolyData* source, vtkPolyData* target, vtkSmartPointer<vtkDoubleArray>& result);
@@ -0,0 +1,694 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+
+#include "niftkVTKKdTreeIterativeClosestPoint.h"
+
+#include <vtkCellType.h>
+#include <vtkDataArray.h>
+#include <vtkIdList.h>
+#include <vtkLandmarkTransform.h>
+#include <vtkMath.h>
+#include <vtkMultiThreader.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkTransform.h>
+#include <vtkTransformPolyDataFilter.h>
+#include <vtkVersion.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+
+// Number of landmarks that each thread searches for in one go.
+const vtkIdType LandmarksPerBlock = 256;
+
+struct ClosestPointsThreadData
+{
+  const niftk::VTKPointKdTree* m_Tree;
+  const double*                m_Matrix;
+  const double*                m_Landmarks;
+  double*                      m_TransformedLandmarks;
+  vtkIdType*                   m_ClosestPointIds;
+  double*                      m_DistancesSquared;
+  vtkIdType                    m_NumberOfLandmarks;
+};
+
+
+//-----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE FindClosestPointsThreaderCallback(void *arg)
+{
+  vtkMultiThreader::ThreadInfo* info = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  const ClosestPointsThreadData* data = static_cast<const ClosestPointsThreadData*>(info->UserData);
+
+  const double* m = data->m_Matrix;
+  vtkIdType numberOfBlocks = (data->m_NumberOfLandmarks + LandmarksPerBlock - 1) / LandmarksPerBlock;
+
+  // Blocks are interleaved over threads, so each thread gets a similar mix of near and far landmarks.
+  for (vtkIdType block = info->ThreadID; block < numberOfBlocks; block += info->NumberOfThreads)
+  {
+    vtkIdType end = std::min(data->m_NumberOfLandmarks, (block + 1) * LandmarksPerBlock);
+
+    for (vtkIdType i = block * LandmarksPerBlock; i < end; i++)
+    {
+      const double* p = data->m_Landmarks + 3 * i;
+      double* q = data->m_TransformedLandmarks + 3 * i;
+
+      q[0] = m[0] * p[0] + m[1] * p[1] + m[ 2] * p[2] + m[ 3];
+      q[1] = m[4] * p[0] + m[5] * p[1] + m[ 6] * p[2] + m[ 7];
+      q[2] = m[8] * p[0] + m[9] * p[1] + m[10] * p[2] + m[11];
+
+      data->m_ClosestPointIds[i] = data->m_Tree->FindClosestPoint(q, data->m_DistancesSquared[i]);
+    }
+  }
+
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+} // end anonymous namespace
+
+namespace niftk
+{
+
+//-----------------------------------------------------------------------------
+VTKKdTreeIterativeClosestPoint::VTKKdTreeIterativeClosestPoint()
+: m_Source(NULL)
+, m_Target(NULL)
+, m_TransformMatrix(NULL)
+, m_TreeMTime(0)
+, m_ICPMaxLandmarks(50)
+, m_ICPMaxIterations(100)
+, m_TrimmedPercentage(100)
+, m_PointToPlane(false)
+, m_NumberOfThreads(vtkMultiThreader::GetGlobalDefaultNumberOfThreads())
+, m_ConvergenceTolerance(1e-6)
+, m_NumberOfIterations(0)
+{
+  m_TransformMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  m_TransformMatrix->Identity();
+}
+
+
+//-----------------------------------------------------------------------------
+VTKKdTreeIterativeClosestPoint::~VTKKdTreeIterativeClosestPoint()
+{
+}
+
+
+//-----------------------------------------------------------------------------
+void VTKKdTreeIterativeClosestPoint::SetICPMaxLandmarks(unsigned int maxLandMarks)
+{
+  if (maxLandMarks < 3)
+  {
+    throw std::runtime_error("SetICPMaxLandmarks: maxLandMarks must be >= 3.");
+  }
+  m_ICPMaxLandmarks = maxLandMarks;
+}
+
+
+//-----------------------------------------------------------------------------
+void VTKKdTreeIterativeClosestPoint::SetICPMaxIterations(unsigned int maxIterations)
+{
+  if (maxIterations < 1)
+  {
+    throw std::runtime_error("SetICPMaxIterations: maxIterations must be >= 1.");
+  }
+  m_ICPMaxIterations = maxIterations;
+}
+
+
+//-----------------------------------------------------------------------------
+void VTKKdTreeIterativeClosestPoint::SetTrimmedPercentage(unsigned int percentage)
+{
+  if (percentage > 100)
+  {
+    throw std::runtime_error("SetTrimmedPercentage: percentage must be <= 100.");
+  }
+  if (percentage == 0)
+  {
+    throw std::runtime_error("SetTrimmedPercentage: percentage must be >= 1.");
+  }
+  m_TrimmedPercentage = percentage;
+}
+
+
+//-----------------------------------------------------------------------------
+void VTKKdTreeIterativeClosestPoint::SetPointToPlane(bool pointToPlane)
+{
+  m_PointToPlane = pointToPlane;
+}
+
+
+//-----------------------------------------------------------------------------
+void VTKKdTreeIterativeClosestPoint::SetNumberOfThreads(int numberOfThreads)
+{
+  if (numberOfThreads < 1)
+  {
+    throw std::runtime_error("SetNumberOfThreads: numberOfThreads must be >= 1.");
+  }
+  m_NumberOfThreads = numberOfThreads;
+}
+
+
+//-----------------------------------------------------------------------------
+void VTKKdTreeIterativeClosestPoint::SetConvergenceTolerance(double tolerance)
+{
+  if (tolerance < 0)
+  {
+    throw std::runtime_error("SetConvergenceTolerance: tolerance must be >= 0.");
+  }
+  m_ConvergenceTolerance = tolerance;
+}
+
+
+//-----------------------------------------------------------------------------
+unsigned int VTKKdTreeIterativeClosestPoint::GetNumberOfIterations() const
+{
+  return m_NumberOfIterations;
+}
+
+
+//-----------------------------------------------------------------------------
+void VTKKdTreeIterativeClosestPoint::SetSource ( vtkSmartPointer<vtkPolyData>  source)
+{
+  m_Source = source;
+}
+
+
+//-----------------------------------------------------------------------------
+void VTKKdTreeIterativeClosestPoint::SetTarget ( vtkSmartPointer<vtkPolyData>  target)
+{
+  m_Target = target;
+  m_TreeMTime = 0;
+}
+
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkMatrix4x4> VTKKdTreeIterativeClosestPoint::GetTransform() const
+{
+  vtkSmartPointer<vtkMatrix4x4> result = vtkSmartPointer<vtkMatrix4x4>::New();
+  result->DeepCopy(m_TransformMatrix);
+
+  return result;
+}
+
+
+//-----------------------------------------------------------------------------
+void VTKKdTreeIterativeClosestPoint::UpdateTree()
+{
+  if (m_TreeMTime != 0 && m_TreeMTime == m_Target->GetMTime())
+  {
+    return;
+  }
+
+  m_Tree.Build(m_Target->GetPoints());
+  m_TargetNormals.clear();
+  m_TreeMTime = m_Target->GetMTime();
+}
+
+
+//-----------------------------------------------------------------------------
+void VTKKdTreeIterativeClosestPoint::UpdateTargetNormals()
+{
+  vtkIdType numberOfPoints = m_Target->GetNumberOfPoints();
+  if (m_TargetNormals.size() == static_cast<size_t>(3 * numberOfPoints))
+  {
+    return;
+  }
+
+  m_TargetNormals.assign(3 * numberOfPoints, 0);
+
+  vtkDataArray* normals = m_Target->GetPointData()->GetNormals();
+  if (normals != NULL && normals->GetNumberOfTuples() == numberOfPoints && normals->GetNumberOfComponents() == 3)
+  {
+    for (vtkIdType i = 0; i < numberOfPoints; i++)
+    {
+      normals->GetTuple(i, &m_TargetNormals[3 * i]);
+    }
+  }
+  else
+  {
+    // Sum the area weighted normals of the polygons around each point.
+    vtkSmartPointer<vtkIdList> pointIds = vtkSmartPointer<vtkIdList>::New();
+    double a[3];
+    double b[3];
+    double c[3];
+    double ab[3];
+    double ac[3];
+    double normal[3];
+
+    for (vtkIdType cellId = 0; cellId < m_Target->GetNumberOfCells(); cellId++)
+    {
+      int cellType = m_Target->GetCellType(cellId);
+      if (cellType != VTK_TRIANGLE && cellType != VTK_QUAD && cellType != VTK_POLYGON)
+      {
+        continue;
+      }
+
+      m_Target->GetCellPoints(cellId, pointIds);
+      m_Target->GetPoint(pointIds->GetId(0), a);
+
+      for (vtkIdType j = 1; j + 1 < pointIds->GetNumberOfIds(); j++)
+      {
+        m_Target->GetPoint(pointIds->GetId(j), b);
+        m_Target->GetPoint(pointIds->GetId(j + 1), c);
+        vtkMath::Subtract(b, a, ab);
+        vtkMath::Subtract(c, a, ac);
+        vtkMath::Cross(ab, ac, normal);
+
+        vtkIdType ids[3] = { pointIds->GetId(0), pointIds->GetId(j), pointIds->GetId(j + 1) };
+        for (int k = 0; k < 3; k++)
+        {
+          m_TargetNormals[3 * ids[k]    ] += normal[0];
+          m_TargetNormals[3 * ids[k] + 1] += normal[1];
+          m_TargetNormals[3 * ids[k] + 2] += normal[2];
+        }
+      }
+    }
+  }
+
+  bool hasNormals = false;
+  for (vtkIdType i = 0; i < numberOfPoints; i++)
+  {
+    if (vtkMath::Normalize(&m_TargetNormals[3 * i]) > 0)
+    {
+      hasNormals = true;
+    }
+  }
+
+  if (!hasNormals)
+  {
+    m_TargetNormals.clear();
+    throw std::runtime_error("VTKKdTreeIterativeClosestPoint::UpdateTargetNormals, point to plane ICP needs a target with normals or polygons.");
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+void VTKKdTreeIterativeClosestPoint::GetLandmarks(vtkPolyData& source, std::vector<double>& landmarks) const
+{
+  vtkIdType step = 1;
+  vtkIdType numberSourcePoints = source.GetNumberOfPoints();
+  if (numberSourcePoints > m_ICPMaxLandmarks)
+  {
+    step = numberSourcePoints / m_ICPMaxLandmarks;
+  }
+
+  landmarks.clear();
+  landmarks.reserve(3 * std::min(numberSourcePoints, static_cast<vtkIdType>(m_ICPMaxLandmarks)));
+
+  double sourcePoint[3];
+  vtkIdType numberOfPointsInserted = 0;
+  for (vtkIdType pointCounter = 0; pointCounter < numberSourcePoints
+       && numberOfPointsInserted < m_ICPMaxLandmarks; pointCounter += step)
+  {
+    source.GetPoint(pointCounter, sourcePoint);
+    landmarks.insert(landmarks.end(), sourcePoint, sourcePoint + 3);
+    numberOfPointsInserted++;
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+void VTKKdTreeIterativeClosestPoint::FindClosestPoints(const std::vector<double>& landmarks,
+                                                       const vtkMatrix4x4& matrix,
+                                                       std::vector<double>& transformedLandmarks,
+                                                       std::vector<vtkIdType>& closestPointIds,
+                                                       std::vector<double>& distancesSquared
+                                                      ) const
+{
+  vtkIdType numberOfLandmarks = landmarks.size() / 3;
+
+  transformedLandmarks.resize(landmarks.size());
+  closestPointIds.resize(numberOfLandmarks);
+  distancesSquared.resize(numberOfLandmarks);
+
+  if (numberOfLandmarks == 0)
+  {
+    return;
+  }
+
+  ClosestPointsThreadData data;
+  data.m_Tree = &m_Tree;
+  data.m_Matrix = &matrix.Element[0][0];
+  data.m_Landmarks = &landmarks[0];
+  data.m_TransformedLandmarks = &transformedLandmarks[0];
+  data.m_ClosestPointIds = &closestPointIds[0];
+  data.m_DistancesSquared = &distancesSquared[0];
+  data.m_NumberOfLandmarks = numberOfLandmarks;
+
+  vtkIdType numberOfBlocks = (numberOfLandmarks + LandmarksPerBlock - 1) / LandmarksPerBlock;
+  int numberOfThreads = static_cast<int>(std::min(static_cast<vtkIdType>(m_NumberOfThreads), numberOfBlocks));
+
+  vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+  threader->SetNumberOfThreads(numberOfThreads);
+  threader->SetSingleMethod(FindClosestPointsThreaderCallback, &data);
+  threader->SingleMethodExecute();
+}
+
+
+//-----------------------------------------------------------------------------
+/// Computes the rigid transformation that minimises the distance between corresponding points.
+static void ComputePointToPointUpdate(const std::vector<double>& points,
+                                      const std::vector<double>& targetPoints,
+                                      vtkMatrix4x4& update)
+{
+  vtkSmartPointer<vtkPoints> sourceLandmarks = vtkSmartPointer<vtkPoints>::New();
+  vtkSmartPointer<vtkPoints> targetLandmarks = vtkSmartPointer<vtkPoints>::New();
+
+  vtkIdType numberOfPoints = points.size() / 3;
+  sourceLandmarks->SetNumberOfPoints(numberOfPoints);
+  targetLandmarks->SetNumberOfPoints(numberOfPoints);
+
+  for (vtkIdType i = 0; i < numberOfPoints; i++)
+  {
+    sourceLandmarks->SetPoint(i, &points[3 * i]);
+    targetLandmarks->SetPoint(i, &targetPoints[3 * i]);
+  }
+
+  vtkSmartPointer<vtkLandmarkTransform> landmarkTransform = vtkSmartPointer<vtkLandmarkTransform>::New();
+  landmarkTransform->SetModeToRigidBody();
+  landmarkTransform->SetSourceLandmarks(sourceLandmarks);
+  landmarkTransform->SetTargetLandmarks(targetLandmarks);
+  landmarkTransform->Update();
+
+  update.DeepCopy(landmarkTransform->GetMatrix());
+}
+
+
+//-----------------------------------------------------------------------------
+/// Computes the small rigid transformation that minimises the distance between points and the
+/// tangent planes at the corresponding target points, linearised about the centroid of points.
+/// Returns false if the problem is degenerate, e.g. for a planar target.
+static bool ComputePointToPlaneUpdate(const std::vector<double>& points,
+                                      const std::vector<double>& targetPoints,
+                                      const std::vector<double>& targetNormals,
+                                      vtkMatrix4x4& update)
+{
+  vtkIdType numberOfPoints = points.size() / 3;
+  if (numberOfPoints < 6)
+  {
+    return false;
+  }
+
+  double centroid[3] = { 0, 0, 0 };
+  for (vtkIdType i = 0; i < numberOfPoints; i++)
+  {
+    centroid[0] += points[3 * i    ];
+    centroid[1] += points[3 * i + 1];
+    centroid[2] += points[3 * i + 2];
+  }
+  for (int j = 0; j < 3; j++)
+  {
+    centroid[j] /= numberOfPoints;
+  }
+
+  // Normal equations for the rotation vector w and translation t, minimising
+  // sum ((p - c) x n . w + n . t + (p - q) . n)^2
+  double ata[6][6];
+  double atb[6];
+  for (int r = 0; r < 6; r++)
+  {
+    atb[r] = 0;
+    for (int c = 0; c < 6; c++)
+    {
+      ata[r][c] = 0;
+    }
+  }
+
+  double p[3];
+  double pq[3];
+  double row[6];
+  for (vtkIdType i = 0; i < numberOfPoints; i++)
+  {
+    const double* n = &targetNormals[3 * i];
+    for (int j = 0; j < 3; j++)
+    {
+      p[j] = points[3 * i + j] - centroid[j];
+      pq[j] = points[3 * i + j] - targetPoints[3 * i + j];
+    }
+    vtkMath::Cross(p, n, row);
+    row[3] = n[0];
+    row[4] = n[1];
+    row[5] = n[2];
+
+    double b = -vtkMath::Dot(pq, n);
+    for (int r = 0; r < 6; r++)
+    {
+      atb[r] += row[r] * b;
+      for (int c = r; c < 6; c++)
+      {
+        ata[r][c] += row[r] * row[c];
+      }
+    }
+  }
+  for (int r = 0; r < 6; r++)
+  {
+    for (int c = 0; c < r; c++)
+    {
+      ata[r][c] = ata[c][r];
+    }
+  }
+
+  double* rows[6] = { ata[0], ata[1], ata[2], ata[3], ata[4], ata[5] };
+  if (vtkMath::SolveLinearSystem(rows, atb, 6) == 0)
+  {
+    return false;
+  }
+  for (int r = 0; r < 6; r++)
+  {
+    if (!(std::abs(atb[r]) < 1e100))
+    {
+      return false;
+    }
+  }
+
+  // Turn the rotation vector into an exact rotation, with Rodrigues' formula.
+  double w[3] = { atb[0], atb[1], atb[2] };
+  double angle = vtkMath::Normalize(w);
+  double s = std::sin(angle);
+  double c = 1 - std::cos(angle);
+  double rotation[3][3] = {
+    { 1 - c * (w[1] * w[1] + w[2] * w[2]),     c * w[0] * w[1] - s * w[2],           c * w[0] * w[2] + s * w[1] },
+    {     c * w[0] * w[1] + s * w[2],       1 - c * (w[0] * w[0] + w[2] * w[2]),     c * w[1] * w[2] - s * w[0] },
+    {     c * w[0] * w[2] - s * w[1],           c * w[1] * w[2] + s * w[0],       1 - c * (w[0] * w[0] + w[1] * w[1]) }
+  };
+
+  // x -> R (x - centroid) + centroid + t
+  update.Identity();
+  for (int r = 0; r < 3; r++)
+  {
+    double translation = centroid[r] + atb[3 + r];
+    for (int k = 0; k < 3; k++)
+    {
+      update.Element[r][k] = rotation[r][k];
+      translation -= rotation[r][k] * centroid[k];
+    }
+    update.Element[r][3] = translation;
+  }
+  return true;
+}
+
+
+//-----------------------------------------------------------------------------
+double VTKKdTreeIterativeClosestPoint::Run()
+{
+  if (m_Source == NULL)
+  {
+    throw std::runtime_error("VTKKdTreeIterativeClosestPoint::Run, source is NULL.");
+  }
+  if (m_Source->GetNumberOfPoints() < 3)
+  {
+    throw std::runtime_error("VTKKdTreeIterativeClosestPoint::Run, source has < 3 points.");
+  }
+  if (m_Target == NULL)
+  {
+    throw std::runtime_error("VTKKdTreeIterativeClosestPoint::Run, target is NULL.");
+  }
+  if (m_Target->GetNumberOfPoints() < 3)
+  {
+    throw std::runtime_error("VTKKdTreeIterativeClosestPoint::Run, target has < 3 points.");
+  }
+
+  this->UpdateTree();
+  if (m_PointToPlane)
+  {
+    this->UpdateTargetNormals();
+  }
+
+  std::vector<double> landmarks;
+  this->GetLandmarks(*m_Source, landmarks);
+  vtkIdType numberOfLandmarks = landmarks.size() / 3;
+
+  vtkIdType numberOfInliers = static_cast<vtkIdType>(std::ceil(numberOfLandmarks * m_TrimmedPercentage / 100.0));
+  numberOfInliers = std::max(static_cast<vtkIdType>(3), std::min(numberOfLandmarks, numberOfInliers));
+
+  std::vector<double> transformedLandmarks;
+  std::vector<vtkIdType> closestPointIds;
+  std::vector<double> distancesSquared;
+  std::vector<double> sortedDistancesSquared;
+  std::vector<double> inlierPoints;
+  std::vector<double> inlierTargetPoints;
+  std::vector<double> inlierTargetNormals;
+
+  vtkSmartPointer<vtkMatrix4x4> result = vtkSmartPointer<vtkMatrix4x4>::New();
+  vtkSmartPointer<vtkMatrix4x4> update = vtkSmartPointer<vtkMatrix4x4>::New();
+  result->Identity();
+
+  double previousRMS = 0;
+  m_NumberOfIterations = 0;
+
+  while (m_NumberOfIterations < m_ICPMaxIterations)
+  {
+    this->FindClosestPoints(landmarks, *result, transformedLandmarks, closestPointIds, distancesSquared);
+
+    // Only the closest numberOfInliers landmarks, in their original order, are used.
+    sortedDistancesSquared = distancesSquared;
+    std::nth_element(sortedDistancesSquared.begin(),
+                     sortedDistancesSquared.begin() + (numberOfInliers - 1),
+                     sortedDistancesSquared.end());
+    double threshold = sortedDistancesSquared[numberOfInliers - 1];
+
+    vtkIdType numberBelowThreshold = 0;
+    for (vtkIdType i = 0; i < numberOfLandmarks; i++)
+    {
+      if (distancesSquared[i] < threshold)
+      {
+        numberBelowThreshold++;
+      }
+    }
+    vtkIdType numberAtThreshold = numberOfInliers - numberBelowThreshold;
+
+    inlierPoints.clear();
+    inlierTargetPoints.clear();
+    inlierTargetNormals.clear();
+
+    double targetPoint[3];
+    double sumOfSquares = 0;
+    for (vtkIdType i = 0; i < numberOfLandmarks; i++)
+    {
+      if (distancesSquared[i] > threshold)
+      {
+        continue;
+      }
+      if (distancesSquared[i] == threshold)
+      {
+        if (numberAtThreshold == 0)
+        {
+          continue;
+        }
+        numberAtThreshold--;
+      }
+
+      m_Target->GetPoint(closestPointIds[i], targetPoint);
+      inlierPoints.insert(inlierPoints.end(), &transformedLandmarks[3 * i], &transformedLandmarks[3 * i] + 3);
+      inlierTargetPoints.insert(inlierTargetPoints.end(), targetPoint, targetPoint + 3);
+      if (m_PointToPlane)
+      {
+        inlierTargetNormals.insert(inlierTargetNormals.end(),
+                                   &m_TargetNormals[3 * closestPointIds[i]],
+                                   &m_TargetNormals[3 * closestPointIds[i]] + 3);
+      }
+      sumOfSquares += distancesSquared[i];
+    }
+
+    double rms = std::sqrt(sumOfSquares / numberOfInliers);
+    if (m_NumberOfIterations > 0 && std::abs(previousRMS - rms) < m_ConvergenceTolerance)
+    {
+      break;
+    }
+    previousRMS = rms;
+
+    if (!m_PointToPlane || !ComputePointToPlaneUpdate(inlierPoints, inlierTargetPoints, inlierTargetNormals, *update))
+    {
+      ComputePointToPointUpdate(inlierPoints, inlierTargetPoints, *update);
+    }
+
+    vtkMatrix4x4::Multiply4x4(update, result, result);
+    m_NumberOfIterations++;
+  }
+
+  m_TransformMatrix->DeepCopy(result);
+
+  return this->GetRMSResidual(*m_Source);
+}
+
+
+//-----------------------------------------------------------------------------
+double VTKKdTreeIterativeClosestPoint::GetRMSResidual(vtkPolyData& source) const
+{
+  if (m_Tree.GetNumberOfPoints() == 0)
+  {
+    throw std::runtime_error("VTKKdTreeIterativeClosestPoint::GetRMSResidual, there is no target, call Run() first.");
+  }
+
+  std::vector<double> landmarks;
+  std::vector<double> transformedLandmarks;
+  std::vector<vtkIdType> closestPointIds;
+  std::vector<double> distancesSquared;
+
+  this->GetLandmarks(source, landmarks);
+  this->FindClosestPoints(landmarks, *m_TransformMatrix, transformedLandmarks, closestPointIds, distancesSquared);
+
+  double residual = 0;
+  for (size_t i = 0; i < distancesSquared.size(); i++)
+  {
+    residual += distancesSquared[i];
+  }
+  if (distancesSquared.size() > 0)
+  {
+    residual /= static_cast<double>(distancesSquared.size());
+  }
+  residual = sqrt(residual);
+
+  std::cout << "Calculated residual=" << residual << ", from " << distancesSquared.size() << " points." << std::endl;
+
+  return residual;
+}
+
+
+//-----------------------------------------------------------------------------
+void VTKKdTreeIterativeClosestPoint::ApplyTransform(vtkPolyData * solution)
+{
+  if (m_Source == NULL)
+  {
+    throw std::runtime_error("VTKKdTreeIterativeClosestPoint::ApplyTransform, source is NULL.");
+  }
+  if (solution == NULL)
+  {
+    throw std::runtime_error("VTKKdTreeIterativeClosestPoint::ApplyTransform, solution vtkPolyData is NULL.");
+  }
+
+  // Clear all memory.
+  solution->Initialize();
+
+  vtkSmartPointer<vtkTransform> icpTransform = vtkSmartPointer<vtkTransform>::New();
+  icpTransform->SetMatrix(m_TransformMatrix);
+
+  vtkSmartPointer<vtkTransformPolyDataFilter> icpTransformFilter = vtkSmartPointer<vtkTransformPolyDataFilter>::New();
+#if VTK_MAJOR_VERSION <= 5
+  icpTransformFilter->SetInput(m_Source);
+#else
+  icpTransformFilter->SetInputData(m_Source);
+#endif
+  icpTransformFilter->SetOutput(solution);
+  icpTransformFilter->SetTransform(icpTransform);
+  icpTransformFilter->Update();
+}
+
+//-----------------------------------------------------------------------------
+} // end namespace
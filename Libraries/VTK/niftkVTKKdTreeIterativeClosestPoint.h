@@ -0,0 +1,156 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#ifndef niftkVTKKdTreeIterativeClosestPoint_h
+#define niftkVTKKdTreeIterativeClosestPoint_h
+
+#include "niftkVTKWin32ExportHeader.h"
+#include "niftkVTKPointKdTree.h"
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkMatrix4x4.h>
+#include <vector>
+
+namespace niftk {
+
+/**
+ * \class VTKKdTreeIterativeClosestPoint
+ * \brief Registers two vtkPolyData sets with a native, multi-threaded Iterative Closest Point (ICP).
+ *
+ * This has the same interface as VTKIterativeClosestPoint, but rather than running
+ * vtkIterativeClosestPointTransform over a vtkCellLocator, it matches each source
+ * landmark to the closest target point in a VTKPointKdTree. The tree is built once per
+ * target, and queried on several threads.
+ *
+ * Each iteration minimises either the point to point distance, or, if SetPointToPlane()
+ * is on, the distance to the tangent plane at the matched target point. Point to plane
+ * needs target normals, which are taken from the point data, or computed from the
+ * triangles of the target if there are none. It usually converges in far fewer iterations,
+ * and is not limited by the spacing of the target points.
+ *
+ * Trimming is done within each iteration: only the SetTrimmedPercentage() of landmarks
+ * that are closest to the target are used to update the transformation. So, unlike the
+ * Trimmed Least Squares of VTKIterativeClosestPoint, the registration is only run once.
+ *
+ * The result does not depend on the number of threads.
+ */
+class NIFTKVTK_WINEXPORT VTKKdTreeIterativeClosestPoint {
+
+public:
+
+  VTKKdTreeIterativeClosestPoint();
+  ~VTKKdTreeIterativeClosestPoint();
+
+  /**
+   * \brief Perform the Iterative Closest Point (ICP) registration of the source to the target.
+   * \return the RMS distance from the source landmarks to the closest target points.
+   */
+  double Run();
+
+  /**
+   * \brief Calculates the RMS distance from the landmarks of source to the closest target points, using the current transformation.
+   */
+  double GetRMSResidual(vtkPolyData &source) const;
+
+  /**
+   * \brief returns the transform to move the source to the target.
+   */
+  vtkSmartPointer<vtkMatrix4x4> GetTransform() const;
+
+  /**
+   * \brief Transform the source to the target, placing the result in solution.
+   */
+  void ApplyTransform(vtkPolyData *solution);
+
+  /**
+   * \brief Set the source poly data, of which only the points are used.
+   */
+  void SetSource(vtkSmartPointer<vtkPolyData>);
+
+  /**
+   * \brief Set the target polydata.
+   */
+  void SetTarget(vtkSmartPointer<vtkPolyData>);
+
+  /**
+   * \brief Set the maximum number of source points used as landmarks, default 50.
+   */
+  void SetICPMaxLandmarks(unsigned int);
+
+  /**
+   * \brief Set the maximum number of ICP iterations, default 100.
+   */
+  void SetICPMaxIterations(unsigned int);
+
+  /**
+   * \brief Set the percentage [1 - 100] of closest landmarks used at each iteration, default 100.
+   */
+  void SetTrimmedPercentage(unsigned int);
+
+  /**
+   * \brief Set whether to minimise the distance to the target tangent planes, default false.
+   */
+  void SetPointToPlane(bool);
+
+  /**
+   * \brief Set the number of threads used to find the closest points, default is the VTK default.
+   */
+  void SetNumberOfThreads(int);
+
+  /**
+   * \brief Stop iterating when the trimmed RMS distance changes by less than this, in millimetres, default 1e-6.
+   */
+  void SetConvergenceTolerance(double);
+
+  /**
+   * \brief Returns the number of iterations used by the last call to Run().
+   */
+  unsigned int GetNumberOfIterations() const;
+
+private:
+
+  VTKKdTreeIterativeClosestPoint(const VTKKdTreeIterativeClosestPoint&); // Purposefully not implemented.
+  VTKKdTreeIterativeClosestPoint& operator=(const VTKKdTreeIterativeClosestPoint&); // Purposefully not implemented.
+
+  vtkSmartPointer<vtkPolyData>    m_Source;
+  vtkSmartPointer<vtkPolyData>    m_Target;
+  vtkSmartPointer<vtkMatrix4x4>   m_TransformMatrix;
+  VTKPointKdTree                  m_Tree;
+  unsigned long long              m_TreeMTime;
+  std::vector<double>             m_TargetNormals;
+  unsigned int                    m_ICPMaxLandmarks;
+  unsigned int                    m_ICPMaxIterations;
+  unsigned int                    m_TrimmedPercentage;
+  bool                            m_PointToPlane;
+  int                             m_NumberOfThreads;
+  double                          m_ConvergenceTolerance;
+  unsigned int                    m_NumberOfIterations;
+
+  void UpdateTree();
+
+  void UpdateTargetNormals();
+
+  void GetLandmarks(vtkPolyData& source, std::vector<double>& landmarks) const;
+
+  void FindClosestPoints(const std::vector<double>& landmarks,
+                         const vtkMatrix4x4& matrix,
+                         std::vector<double>& transformedLandmarks,
+                         std::vector<vtkIdType>& closestPointIds,
+                         std::vector<double>& distancesSquared
+                        ) const;
+};
+
+} // end namespace
+
+#endif
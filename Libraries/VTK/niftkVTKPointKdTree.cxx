@@ -0,0 +1,222 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#include "niftkVTKPointKdTree.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+const vtkIdType MaximumPointsPerLeaf = 8;
+const int MaximumDepth = 128;
+}
+
+namespace niftk
+{
+
+//-----------------------------------------------------------------------------
+VTKPointKdTree::VTKPointKdTree()
+{
+}
+
+
+//-----------------------------------------------------------------------------
+VTKPointKdTree::~VTKPointKdTree()
+{
+}
+
+
+//-----------------------------------------------------------------------------
+vtkIdType VTKPointKdTree::GetNumberOfPoints() const
+{
+  return m_PointIds.size();
+}
+
+
+//-----------------------------------------------------------------------------
+void VTKPointKdTree::Build(vtkPoints *points)
+{
+  m_Nodes.clear();
+  m_Points.clear();
+  m_PointIds.clear();
+
+  if (points == NULL || points->GetNumberOfPoints() == 0)
+  {
+    return;
+  }
+
+  vtkIdType numberOfPoints = points->GetNumberOfPoints();
+
+  std::vector<double> copy(3 * numberOfPoints);
+  for (vtkIdType i = 0; i < numberOfPoints; i++)
+  {
+    points->GetPoint(i, &copy[3 * i]);
+  }
+
+  m_PointIds.resize(numberOfPoints);
+  for (vtkIdType i = 0; i < numberOfPoints; i++)
+  {
+    m_PointIds[i] = i;
+  }
+
+  m_Nodes.reserve(4 * (numberOfPoints / MaximumPointsPerLeaf + 1));
+  this->BuildNode(0, numberOfPoints, copy);
+
+  // Store the coordinates in tree order, so each leaf is contiguous.
+  m_Points.resize(3 * numberOfPoints);
+  for (vtkIdType i = 0; i < numberOfPoints; i++)
+  {
+    m_Points[3 * i    ] = copy[3 * m_PointIds[i]    ];
+    m_Points[3 * i + 1] = copy[3 * m_PointIds[i] + 1];
+    m_Points[3 * i + 2] = copy[3 * m_PointIds[i] + 2];
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+int VTKPointKdTree::BuildNode(vtkIdType begin, vtkIdType end, const std::vector<double>& points)
+{
+  int index = static_cast<int>(m_Nodes.size());
+
+  Node node;
+  node.m_Split = 0;
+  node.m_Axis = -1;
+  node.m_Left = -1;
+  node.m_Right = -1;
+  node.m_Begin = begin;
+  node.m_End = end;
+  m_Nodes.push_back(node);
+
+  if (end - begin <= MaximumPointsPerLeaf)
+  {
+    return index;
+  }
+
+  double minimum[3];
+  double maximum[3];
+  for (int axis = 0; axis < 3; axis++)
+  {
+    minimum[axis] = std::numeric_limits<double>::max();
+    maximum[axis] = -std::numeric_limits<double>::max();
+  }
+  for (vtkIdType i = begin; i < end; i++)
+  {
+    for (int axis = 0; axis < 3; axis++)
+    {
+      double value = points[3 * m_PointIds[i] + axis];
+      minimum[axis] = std::min(minimum[axis], value);
+      maximum[axis] = std::max(maximum[axis], value);
+    }
+  }
+
+  int axis = 0;
+  for (int a = 1; a < 3; a++)
+  {
+    if (maximum[a] - minimum[a] > maximum[axis] - minimum[axis])
+    {
+      axis = a;
+    }
+  }
+
+  if (maximum[axis] == minimum[axis])
+  {
+    // All the points are in the same place, so there is nothing to split.
+    return index;
+  }
+
+  vtkIdType middle = begin + (end - begin) / 2;
+  std::nth_element(m_PointIds.begin() + begin, m_PointIds.begin() + middle, m_PointIds.begin() + end,
+                   [&points, axis](const vtkIdType& a, const vtkIdType& b) { return points[3 * a + axis] < points[3 * b + axis]; });
+
+  double split = points[3 * m_PointIds[middle] + axis];
+  int left = this->BuildNode(begin, middle, points);
+  int right = this->BuildNode(middle, end, points);
+
+  m_Nodes[index].m_Split = split;
+  m_Nodes[index].m_Axis = axis;
+  m_Nodes[index].m_Left = left;
+  m_Nodes[index].m_Right = right;
+
+  return index;
+}
+
+
+//-----------------------------------------------------------------------------
+vtkIdType VTKPointKdTree::FindClosestPoint(const double point[3], double& distanceSquared) const
+{
+  vtkIdType closest = -1;
+  distanceSquared = std::numeric_limits<double>::max();
+
+  if (m_Nodes.empty())
+  {
+    return closest;
+  }
+
+  // Nodes still to visit, with a lower bound on the squared distance to any point in them.
+  int stackNodes[MaximumDepth];
+  double stackDistances[MaximumDepth];
+  int stackSize = 0;
+
+  stackNodes[stackSize] = 0;
+  stackDistances[stackSize] = 0;
+  stackSize++;
+
+  while (stackSize > 0)
+  {
+    stackSize--;
+    double nodeDistanceSquared = stackDistances[stackSize];
+    if (nodeDistanceSquared >= distanceSquared)
+    {
+      continue;
+    }
+
+    const Node& node = m_Nodes[stackNodes[stackSize]];
+
+    if (node.m_Axis < 0)
+    {
+      for (vtkIdType i = node.m_Begin; i < node.m_End; i++)
+      {
+        double dx = m_Points[3 * i    ] - point[0];
+        double dy = m_Points[3 * i + 1] - point[1];
+        double dz = m_Points[3 * i + 2] - point[2];
+        double d = dx * dx + dy * dy + dz * dz;
+        if (d < distanceSquared)
+        {
+          distanceSquared = d;
+          closest = i;
+        }
+      }
+      continue;
+    }
+
+    // Visit the side of the split that the point is on first, so the other side can often be skipped.
+    double difference = point[node.m_Axis] - node.m_Split;
+    int nearChild = difference < 0 ? node.m_Left : node.m_Right;
+    int farChild = difference < 0 ? node.m_Right : node.m_Left;
+
+    stackNodes[stackSize] = farChild;
+    stackDistances[stackSize] = std::max(nodeDistanceSquared, difference * difference);
+    stackSize++;
+
+    stackNodes[stackSize] = nearChild;
+    stackDistances[stackSize] = nodeDistanceSquared;
+    stackSize++;
+  }
+
+  return closest < 0 ? closest : m_PointIds[closest];
+}
+
+//-----------------------------------------------------------------------------
+} // end namespace
@@ -0,0 +1,77 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#ifndef niftkVTKPointKdTree_h
+#define niftkVTKPointKdTree_h
+
+#include "niftkVTKWin32ExportHeader.h"
+#include <vtkPoints.h>
+#include <vector>
+
+namespace niftk {
+
+/**
+ * \class VTKPointKdTree
+ * \brief A static k-d tree over a copy of a set of points, for fast closest point queries.
+ *
+ * The points are split at the median of their widest dimension, down to a few points
+ * per leaf, and stored in tree order in one contiguous array, so a query only touches
+ * a handful of cache lines. Once built, the tree is not modified by queries, so
+ * FindClosestPoint() can be called from any number of threads at once.
+ */
+class NIFTKVTK_WINEXPORT VTKPointKdTree {
+
+public:
+
+  VTKPointKdTree();
+  ~VTKPointKdTree();
+
+  /**
+   * \brief Builds the tree over a copy of points, replacing any previous tree.
+   */
+  void Build(vtkPoints *points);
+
+  /**
+   * \brief Returns the number of points in the tree.
+   */
+  vtkIdType GetNumberOfPoints() const;
+
+  /**
+   * \brief Finds the point closest to point.
+   * \return the id of the closest point in the points the tree was built from, or -1 if the tree is empty.
+   */
+  vtkIdType FindClosestPoint(const double point[3], double& distanceSquared) const;
+
+private:
+
+  struct Node
+  {
+    double    m_Split;
+    int       m_Axis;   // -1 for a leaf.
+    int       m_Left;
+    int       m_Right;
+    vtkIdType m_Begin;
+    vtkIdType m_End;
+  };
+
+  int BuildNode(vtkIdType begin, vtkIdType end, const std::vector<double>& points);
+
+  std::vector<Node>      m_Nodes;
+  std::vector<double>    m_Points;
+  std::vector<vtkIdType> m_PointIds;
+};
+
+} // end namespace
+
+#endif
@@ -0,0 +1,747 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+
+#include "niftkVTKSurfaceDistance.h"
+
+#include <vtkCellType.h>
+#include <vtkIdList.h>
+#include <vtkMath.h>
+#include <vtkMultiThreader.h>
+#include <vtkSmartPointer.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+
+const int MaximumTrianglesPerLeaf = 4;
+const int MaximumDepth = 128;
+
+// Number of points that each thread searches for in one go.
+const vtkIdType PointsPerBlock = 512;
+
+// The parts of a triangle that the closest point can be on.
+enum TriangleRegion
+{
+  VERTEX_0 = 0,
+  VERTEX_1,
+  VERTEX_2,
+  EDGE_01,
+  EDGE_12,
+  EDGE_20,
+  FACE
+};
+
+
+//-----------------------------------------------------------------------------
+/// Returns the squared distance from p to the closest point of an axis aligned box.
+inline double GetBoxDistanceSquared(const double p[3], const double bounds[6])
+{
+  double distanceSquared = 0;
+  for (int axis = 0; axis < 3; axis++)
+  {
+    double d = 0;
+    if (p[axis] < bounds[2 * axis])
+    {
+      d = bounds[2 * axis] - p[axis];
+    }
+    else if (p[axis] > bounds[2 * axis + 1])
+    {
+      d = p[axis] - bounds[2 * axis + 1];
+    }
+    distanceSquared += d * d;
+  }
+  return distanceSquared;
+}
+
+
+//-----------------------------------------------------------------------------
+/// Finds the closest point to p on the triangle abc, and which part of the triangle it is on,
+/// following Ericson, Real-Time Collision Detection, 2005, section 5.1.5.
+inline TriangleRegion GetClosestPointOnTriangle(const double p[3], const double a[3], const double b[3], const double c[3], double closest[3])
+{
+  double ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+  double ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+  double ap[3] = { p[0] - a[0], p[1] - a[1], p[2] - a[2] };
+
+  double d1 = vtkMath::Dot(ab, ap);
+  double d2 = vtkMath::Dot(ac, ap);
+  if (d1 <= 0 && d2 <= 0)
+  {
+    closest[0] = a[0]; closest[1] = a[1]; closest[2] = a[2];
+    return VERTEX_0;
+  }
+
+  double bp[3] = { p[0] - b[0], p[1] - b[1], p[2] - b[2] };
+  double d3 = vtkMath::Dot(ab, bp);
+  double d4 = vtkMath::Dot(ac, bp);
+  if (d3 >= 0 && d4 <= d3)
+  {
+    closest[0] = b[0]; closest[1] = b[1]; closest[2] = b[2];
+    return VERTEX_1;
+  }
+
+  double vc = d1 * d4 - d3 * d2;
+  if (vc <= 0 && d1 >= 0 && d3 <= 0)
+  {
+    double v = d1 / (d1 - d3);
+    closest[0] = a[0] + v * ab[0]; closest[1] = a[1] + v * ab[1]; closest[2] = a[2] + v * ab[2];
+    return EDGE_01;
+  }
+
+  double cp[3] = { p[0] - c[0], p[1] - c[1], p[2] - c[2] };
+  double d5 = vtkMath::Dot(ab, cp);
+  double d6 = vtkMath::Dot(ac, cp);
+  if (d6 >= 0 && d5 <= d6)
+  {
+    closest[0] = c[0]; closest[1] = c[1]; closest[2] = c[2];
+    return VERTEX_2;
+  }
+
+  double vb = d5 * d2 - d1 * d6;
+  if (vb <= 0 && d2 >= 0 && d6 <= 0)
+  {
+    double w = d2 / (d2 - d6);
+    closest[0] = a[0] + w * ac[0]; closest[1] = a[1] + w * ac[1]; closest[2] = a[2] + w * ac[2];
+    return EDGE_20;
+  }
+
+  double va = d3 * d6 - d5 * d4;
+  if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+  {
+    double w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+    closest[0] = b[0] + w * (c[0] - b[0]); closest[1] = b[1] + w * (c[1] - b[1]); closest[2] = b[2] + w * (c[2] - b[2]);
+    return EDGE_12;
+  }
+
+  double denominator = 1 / (va + vb + vc);
+  double v = vb * denominator;
+  double w = vc * denominator;
+  closest[0] = a[0] + ab[0] * v + ac[0] * w;
+  closest[1] = a[1] + ab[1] * v + ac[1] * w;
+  closest[2] = a[2] + ab[2] * v + ac[2] * w;
+  return FACE;
+}
+
+
+//-----------------------------------------------------------------------------
+/// Spreads the lowest 21 bits of x out, so that there are two zero bits between each of them.
+inline unsigned long long SpreadBits(unsigned long long x)
+{
+  x &= 0x1fffff;
+  x = (x | (x << 32)) & 0x1f00000000ffffULL;
+  x = (x | (x << 16)) & 0x1f0000ff0000ffULL;
+  x = (x | (x << 8))  & 0x100f00f00f00f00fULL;
+  x = (x | (x << 4))  & 0x10c30c30c30c30c3ULL;
+  x = (x | (x << 2))  & 0x1249249249249249ULL;
+  return x;
+}
+
+
+//-----------------------------------------------------------------------------
+/// Sorts the point ids along a Morton (Z-order) curve through the bounding box of the points,
+/// so that consecutive queries are close together, and mostly visit the same nodes of the tree.
+void SortAlongMortonCurve(vtkPoints* points, std::vector<vtkIdType>& order)
+{
+  vtkIdType numberOfPoints = points->GetNumberOfPoints();
+
+  double bounds[6];
+  points->GetBounds(bounds);
+
+  double scale[3];
+  for (int axis = 0; axis < 3; axis++)
+  {
+    double size = bounds[2 * axis + 1] - bounds[2 * axis];
+    scale[axis] = size > 0 ? 0x1fffff / size : 0;
+  }
+
+  std::vector<std::pair<unsigned long long, vtkIdType> > codes(numberOfPoints);
+  double point[3];
+  for (vtkIdType i = 0; i < numberOfPoints; i++)
+  {
+    points->GetPoint(i, point);
+
+    unsigned long long code = 0;
+    for (int axis = 0; axis < 3; axis++)
+    {
+      code |= SpreadBits(static_cast<unsigned long long>((point[axis] - bounds[2 * axis]) * scale[axis])) << axis;
+    }
+    codes[i] = std::make_pair(code, i);
+  }
+
+  std::sort(codes.begin(), codes.end());
+
+  order.resize(numberOfPoints);
+  for (vtkIdType i = 0; i < numberOfPoints; i++)
+  {
+    order[i] = codes[i].second;
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+struct ComputeDistancesThreadData
+{
+  const niftk::VTKSurfaceDistance* m_SurfaceDistance;
+  vtkPoints*                       m_Points;
+  const vtkIdType*                 m_Order;
+  double*                          m_Distances;
+  vtkIdType*                       m_ClosestCellIds;
+  double*                          m_ClosestPoints;
+  vtkIdType                        m_NumberOfPoints;
+};
+
+
+//-----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE ComputeDistancesThreaderCallback(void *arg)
+{
+  vtkMultiThreader::ThreadInfo* info = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  const ComputeDistancesThreadData* data = static_cast<const ComputeDistancesThreadData*>(info->UserData);
+
+  vtkIdType numberOfBlocks = (data->m_NumberOfPoints + PointsPerBlock - 1) / PointsPerBlock;
+
+  double point[3];
+  double closestPoint[3];
+  vtkIdType cellId;
+
+  for (vtkIdType block = info->ThreadID; block < numberOfBlocks; block += info->NumberOfThreads)
+  {
+    vtkIdType end = std::min(data->m_NumberOfPoints, (block + 1) * PointsPerBlock);
+
+    for (vtkIdType j = block * PointsPerBlock; j < end; j++)
+    {
+      vtkIdType i = data->m_Order[j];
+
+      data->m_Points->GetPoint(i, point);
+      data->m_Distances[i] = data->m_SurfaceDistance->FindClosestPoint(point, closestPoint, &cellId);
+
+      if (data->m_ClosestCellIds != NULL)
+      {
+        data->m_ClosestCellIds[i] = cellId;
+      }
+      if (data->m_ClosestPoints != NULL)
+      {
+        data->m_ClosestPoints[3 * i    ] = closestPoint[0];
+        data->m_ClosestPoints[3 * i + 1] = closestPoint[1];
+        data->m_ClosestPoints[3 * i + 2] = closestPoint[2];
+      }
+    }
+  }
+
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+} // end anonymous namespace
+
+namespace niftk
+{
+
+//-----------------------------------------------------------------------------
+VTKSurfaceDistance::VTKSurfaceDistance()
+: m_NumberOfThreads(vtkMultiThreader::GetGlobalDefaultNumberOfThreads())
+, m_SignedDistance(false)
+{
+}
+
+
+//-----------------------------------------------------------------------------
+VTKSurfaceDistance::~VTKSurfaceDistance()
+{
+}
+
+
+//-----------------------------------------------------------------------------
+void VTKSurfaceDistance::SetNumberOfThreads(int numberOfThreads)
+{
+  if (numberOfThreads < 1)
+  {
+    throw std::runtime_error("SetNumberOfThreads: numberOfThreads must be >= 1.");
+  }
+  m_NumberOfThreads = numberOfThreads;
+}
+
+
+//-----------------------------------------------------------------------------
+void VTKSurfaceDistance::SetSignedDistance(bool signedDistance)
+{
+  m_SignedDistance = signedDistance;
+}
+
+
+//-----------------------------------------------------------------------------
+vtkIdType VTKSurfaceDistance::GetNumberOfTriangles() const
+{
+  return m_CellIds.size();
+}
+
+
+//-----------------------------------------------------------------------------
+void VTKSurfaceDistance::SetTarget(vtkPolyData *target)
+{
+  m_Nodes.clear();
+  m_Vertices.clear();
+  m_VertexIds.clear();
+  m_CellIds.clear();
+  m_FaceNormals.clear();
+  m_EdgeNormals.clear();
+  m_VertexNormals.clear();
+
+  if (target == NULL || target->GetNumberOfPoints() == 0)
+  {
+    return;
+  }
+
+  // Split the polygons and strips into triangles, in cell order.
+  std::vector<vtkIdType> vertexIds;
+  std::vector<vtkIdType> cellIds;
+  vtkSmartPointer<vtkIdList> pointIds = vtkSmartPointer<vtkIdList>::New();
+
+  for (vtkIdType cellId = 0; cellId < target->GetNumberOfCells(); cellId++)
+  {
+    int cellType = target->GetCellType(cellId);
+    if (cellType != VTK_TRIANGLE && cellType != VTK_QUAD && cellType != VTK_POLYGON && cellType != VTK_TRIANGLE_STRIP)
+    {
+      continue;
+    }
+
+    target->GetCellPoints(cellId, pointIds);
+
+    for (vtkIdType j = 0; j + 2 < pointIds->GetNumberOfIds(); j++)
+    {
+      vtkIdType triangle[3];
+      if (cellType == VTK_TRIANGLE_STRIP)
+      {
+        // Every other triangle of a strip is the other way round.
+        triangle[0] = pointIds->GetId(j % 2 == 0 ? j : j + 1);
+        triangle[1] = pointIds->GetId(j % 2 == 0 ? j + 1 : j);
+        triangle[2] = pointIds->GetId(j + 2);
+      }
+      else
+      {
+        triangle[0] = pointIds->GetId(0);
+        triangle[1] = pointIds->GetId(j + 1);
+        triangle[2] = pointIds->GetId(j + 2);
+      }
+      vertexIds.insert(vertexIds.end(), triangle, triangle + 3);
+      cellIds.push_back(cellId);
+    }
+  }
+
+  // Work out the face normals, dropping degenerate triangles, which can never be strictly closest.
+  std::vector<double> vertices;
+  std::vector<double> faceNormals;
+  std::vector<vtkIdType> validVertexIds;
+  std::vector<vtkIdType> validCellIds;
+
+  double a[3];
+  double b[3];
+  double c[3];
+  double ab[3];
+  double ac[3];
+  double normal[3];
+
+  for (size_t t = 0; t < cellIds.size(); t++)
+  {
+    target->GetPoint(vertexIds[3 * t    ], a);
+    target->GetPoint(vertexIds[3 * t + 1], b);
+    target->GetPoint(vertexIds[3 * t + 2], c);
+    vtkMath::Subtract(b, a, ab);
+    vtkMath::Subtract(c, a, ac);
+    vtkMath::Cross(ab, ac, normal);
+    if (vtkMath::Normalize(normal) == 0)
+    {
+      continue;
+    }
+
+    vertices.insert(vertices.end(), a, a + 3);
+    vertices.insert(vertices.end(), b, b + 3);
+    vertices.insert(vertices.end(), c, c + 3);
+    faceNormals.insert(faceNormals.end(), normal, normal + 3);
+    validVertexIds.insert(validVertexIds.end(), &vertexIds[3 * t], &vertexIds[3 * t] + 3);
+    validCellIds.push_back(cellIds[t]);
+  }
+
+  int numberOfTriangles = static_cast<int>(validCellIds.size());
+  if (numberOfTriangles == 0)
+  {
+    return;
+  }
+
+  // Angle weighted pseudo-normals at the vertices, and the sum of the face normals on each edge.
+  m_VertexNormals.assign(3 * target->GetNumberOfPoints(), 0);
+  std::vector<double> edgeNormals(9 * numberOfTriangles, 0);
+  std::vector<std::pair<std::pair<vtkIdType, vtkIdType>, int> > edges(3 * numberOfTriangles);
+
+  for (int t = 0; t < numberOfTriangles; t++)
+  {
+    const double* n = &faceNormals[3 * t];
+    for (int k = 0; k < 3; k++)
+    {
+      const double* p = &vertices[9 * t + 3 * k];
+      const double* next = &vertices[9 * t + 3 * ((k + 1) % 3)];
+      const double* previous = &vertices[9 * t + 3 * ((k + 2) % 3)];
+      double e1[3];
+      double e2[3];
+      vtkMath::Subtract(next, p, e1);
+      vtkMath::Subtract(previous, p, e2);
+      vtkMath::Normalize(e1);
+      vtkMath::Normalize(e2);
+      double angle = std::acos(std::max(-1.0, std::min(1.0, vtkMath::Dot(e1, e2))));
+
+      vtkIdType id = validVertexIds[3 * t + k];
+      m_VertexNormals[3 * id    ] += angle * n[0];
+      m_VertexNormals[3 * id + 1] += angle * n[1];
+      m_VertexNormals[3 * id + 2] += angle * n[2];
+
+      vtkIdType from = validVertexIds[3 * t + k];
+      vtkIdType to = validVertexIds[3 * t + (k + 1) % 3];
+      edges[3 * t + k] = std::make_pair(std::make_pair(std::min(from, to), std::max(from, to)), 3 * t + k);
+    }
+  }
+
+  std::sort(edges.begin(), edges.end());
+  for (size_t first = 0; first < edges.size(); )
+  {
+    size_t last = first;
+    double sum[3] = { 0, 0, 0 };
+    while (last < edges.size() && edges[last].first == edges[first].first)
+    {
+      const double* n = &faceNormals[3 * (edges[last].second / 3)];
+      sum[0] += n[0];
+      sum[1] += n[1];
+      sum[2] += n[2];
+      last++;
+    }
+    for (size_t e = first; e < last; e++)
+    {
+      edgeNormals[3 * edges[e].second    ] = sum[0];
+      edgeNormals[3 * edges[e].second + 1] = sum[1];
+      edgeNormals[3 * edges[e].second + 2] = sum[2];
+    }
+    first = last;
+  }
+
+  // Build the hierarchy, then store the triangles in tree order, so each leaf is contiguous.
+  std::vector<BuildTriangle> buildTriangles(numberOfTriangles);
+  for (int t = 0; t < numberOfTriangles; t++)
+  {
+    BuildTriangle& triangle = buildTriangles[t];
+    for (int axis = 0; axis < 3; axis++)
+    {
+      double v0 = vertices[9 * t + axis];
+      double v1 = vertices[9 * t + 3 + axis];
+      double v2 = vertices[9 * t + 6 + axis];
+      triangle.m_Bounds[2 * axis] = std::min(v0, std::min(v1, v2));
+      triangle.m_Bounds[2 * axis + 1] = std::max(v0, std::max(v1, v2));
+      triangle.m_Centroid[axis] = (v0 + v1 + v2) / 3;
+    }
+    triangle.m_Index = t;
+  }
+
+  m_Nodes.reserve(2 * (numberOfTriangles / MaximumTrianglesPerLeaf + 1));
+  this->BuildNode(0, numberOfTriangles, buildTriangles);
+
+  m_Vertices.resize(9 * numberOfTriangles);
+  m_VertexIds.resize(3 * numberOfTriangles);
+  m_CellIds.resize(numberOfTriangles);
+  m_FaceNormals.resize(3 * numberOfTriangles);
+  m_EdgeNormals.resize(9 * numberOfTriangles);
+
+  for (int i = 0; i < numberOfTriangles; i++)
+  {
+    int t = buildTriangles[i].m_Index;
+    std::copy(&vertices[9 * t], &vertices[9 * t] + 9, &m_Vertices[9 * i]);
+    std::copy(&validVertexIds[3 * t], &validVertexIds[3 * t] + 3, &m_VertexIds[3 * i]);
+    std::copy(&faceNormals[3 * t], &faceNormals[3 * t] + 3, &m_FaceNormals[3 * i]);
+    std::copy(&edgeNormals[9 * t], &edgeNormals[9 * t] + 9, &m_EdgeNormals[9 * i]);
+    m_CellIds[i] = validCellIds[t];
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+int VTKSurfaceDistance::BuildNode(int begin, int end, std::vector<BuildTriangle>& triangles)
+{
+  int index = static_cast<int>(m_Nodes.size());
+
+  Node node;
+  node.m_Left = -1;
+  node.m_Right = -1;
+  node.m_Begin = begin;
+  node.m_End = end;
+
+  double centroidMinimum[3];
+  double centroidMaximum[3];
+  for (int axis = 0; axis < 3; axis++)
+  {
+    node.m_Bounds[2 * axis] = std::numeric_limits<double>::max();
+    node.m_Bounds[2 * axis + 1] = -std::numeric_limits<double>::max();
+    centroidMinimum[axis] = std::numeric_limits<double>::max();
+    centroidMaximum[axis] = -std::numeric_limits<double>::max();
+  }
+
+  for (int i = begin; i < end; i++)
+  {
+    const BuildTriangle& triangle = triangles[i];
+    for (int axis = 0; axis < 3; axis++)
+    {
+      node.m_Bounds[2 * axis] = std::min(node.m_Bounds[2 * axis], triangle.m_Bounds[2 * axis]);
+      node.m_Bounds[2 * axis + 1] = std::max(node.m_Bounds[2 * axis + 1], triangle.m_Bounds[2 * axis + 1]);
+      centroidMinimum[axis] = std::min(centroidMinimum[axis], triangle.m_Centroid[axis]);
+      centroidMaximum[axis] = std::max(centroidMaximum[axis], triangle.m_Centroid[axis]);
+    }
+  }
+  m_Nodes.push_back(node);
+
+  if (end - begin <= MaximumTrianglesPerLeaf)
+  {
+    return index;
+  }
+
+  int axis = 0;
+  for (int a = 1; a < 3; a++)
+  {
+    if (centroidMaximum[a] - centroidMinimum[a] > centroidMaximum[axis] - centroidMinimum[axis])
+    {
+      axis = a;
+    }
+  }
+
+  if (centroidMaximum[axis] == centroidMinimum[axis])
+  {
+    // All the triangles have the same centroid, so there is nothing to split.
+    return index;
+  }
+
+  int middle = begin + (end - begin) / 2;
+  std::nth_element(triangles.begin() + begin, triangles.begin() + middle, triangles.begin() + end,
+                   [axis](const BuildTriangle& a, const BuildTriangle& b) { return a.m_Centroid[axis] < b.m_Centroid[axis]; });
+
+  int left = this->BuildNode(begin, middle, triangles);
+  int right = this->BuildNode(middle, end, triangles);
+
+  m_Nodes[index].m_Left = left;
+  m_Nodes[index].m_Right = right;
+
+  return index;
+}
+
+
+//-----------------------------------------------------------------------------
+double VTKSurfaceDistance::FindClosestPoint(const double point[3], double *closestPoint, vtkIdType *cellId) const
+{
+  if (m_Nodes.empty())
+  {
+    throw std::runtime_error("VTKSurfaceDistance::FindClosestPoint, the target has no triangles.");
+  }
+
+  double bestDistanceSquared = std::numeric_limits<double>::max();
+  double bestPoint[3] = { 0, 0, 0 };
+  int bestTriangle = -1;
+  TriangleRegion bestRegion = FACE;
+
+  // Nodes still to visit, with the squared distance to their bounding box.
+  int stackNodes[MaximumDepth];
+  double stackDistances[MaximumDepth];
+  int stackSize = 0;
+
+  stackNodes[stackSize] = 0;
+  stackDistances[stackSize] = GetBoxDistanceSquared(point, m_Nodes[0].m_Bounds);
+  stackSize++;
+
+  double candidate[3];
+
+  while (stackSize > 0)
+  {
+    stackSize--;
+    if (stackDistances[stackSize] >= bestDistanceSquared)
+    {
+      continue;
+    }
+
+    const Node& node = m_Nodes[stackNodes[stackSize]];
+
+    if (node.m_Left < 0)
+    {
+      for (int t = node.m_Begin; t < node.m_End; t++)
+      {
+        const double* v = &m_Vertices[9 * t];
+        TriangleRegion region = GetClosestPointOnTriangle(point, v, v + 3, v + 6, candidate);
+        double d = vtkMath::Distance2BetweenPoints(point, candidate);
+        if (d < bestDistanceSquared)
+        {
+          bestDistanceSquared = d;
+          bestTriangle = t;
+          bestRegion = region;
+          bestPoint[0] = candidate[0];
+          bestPoint[1] = candidate[1];
+          bestPoint[2] = candidate[2];
+        }
+      }
+      continue;
+    }
+
+    // Visit the nearer child first, so the other can often be skipped.
+    double leftDistance = GetBoxDistanceSquared(point, m_Nodes[node.m_Left].m_Bounds);
+    double rightDistance = GetBoxDistanceSquared(point, m_Nodes[node.m_Right].m_Bounds);
+    int nearChild = node.m_Left;
+    int farChild = node.m_Right;
+    if (rightDistance < leftDistance)
+    {
+      std::swap(nearChild, farChild);
+      std::swap(leftDistance, rightDistance);
+    }
+
+    if (rightDistance < bestDistanceSquared)
+    {
+      stackNodes[stackSize] = farChild;
+      stackDistances[stackSize] = rightDistance;
+      stackSize++;
+    }
+    if (leftDistance < bestDistanceSquared)
+    {
+      stackNodes[stackSize] = nearChild;
+      stackDistances[stackSize] = leftDistance;
+      stackSize++;
+    }
+  }
+
+  if (closestPoint != NULL)
+  {
+    closestPoint[0] = bestPoint[0];
+    closestPoint[1] = bestPoint[1];
+    closestPoint[2] = bestPoint[2];
+  }
+  if (cellId != NULL)
+  {
+    *cellId = m_CellIds[bestTriangle];
+  }
+
+  double distance = std::sqrt(bestDistanceSquared);
+
+  if (m_SignedDistance)
+  {
+    const double* pseudoNormal = NULL;
+    switch (bestRegion)
+    {
+      case VERTEX_0:
+      case VERTEX_1:
+      case VERTEX_2:
+        pseudoNormal = &m_VertexNormals[3 * m_VertexIds[3 * bestTriangle + bestRegion]];
+        break;
+      case EDGE_01:
+      case EDGE_12:
+      case EDGE_20:
+        pseudoNormal = &m_EdgeNormals[9 * bestTriangle + 3 * (bestRegion - EDGE_01)];
+        break;
+      default:
+        pseudoNormal = &m_FaceNormals[3 * bestTriangle];
+        break;
+    }
+
+    double difference[3];
+    vtkMath::Subtract(point, bestPoint, difference);
+    if (vtkMath::Dot(difference, pseudoNormal) < 0)
+    {
+      distance = -distance;
+    }
+  }
+
+  return distance;
+}
+
+
+//-----------------------------------------------------------------------------
+void VTKSurfaceDistance::ComputeDistances(vtkPoints *points,
+                                          vtkDoubleArray *distances,
+                                          vtkIdTypeArray *closestCellIds,
+                                          vtkPoints *closestPoints
+                                         ) const
+{
+  if (points == NULL)
+  {
+    throw std::runtime_error("VTKSurfaceDistance::ComputeDistances, points is NULL.");
+  }
+  if (distances == NULL)
+  {
+    throw std::runtime_error("VTKSurfaceDistance::ComputeDistances, distances is NULL.");
+  }
+  if (m_Nodes.empty())
+  {
+    throw std::runtime_error("VTKSurfaceDistance::ComputeDistances, the target has no triangles.");
+  }
+
+  vtkIdType numberOfPoints = points->GetNumberOfPoints();
+
+  distances->SetNumberOfComponents(1);
+  distances->SetNumberOfTuples(numberOfPoints);
+
+  if (closestCellIds != NULL)
+  {
+    closestCellIds->SetNumberOfComponents(1);
+    closestCellIds->SetNumberOfTuples(numberOfPoints);
+  }
+
+  std::vector<double> closestCoordinates;
+  if (closestPoints != NULL)
+  {
+    closestCoordinates.resize(3 * numberOfPoints);
+  }
+
+  if (numberOfPoints == 0)
+  {
+    if (closestPoints != NULL)
+    {
+      closestPoints->SetNumberOfPoints(0);
+    }
+    return;
+  }
+
+  // Searching for nearby points one after the other keeps the same parts of the tree in the cache.
+  std::vector<vtkIdType> order;
+  SortAlongMortonCurve(points, order);
+
+  ComputeDistancesThreadData data;
+  data.m_SurfaceDistance = this;
+  data.m_Points = points;
+  data.m_Order = &order[0];
+  data.m_Distances = distances->GetPointer(0);
+  data.m_ClosestCellIds = closestCellIds != NULL ? closestCellIds->GetPointer(0) : NULL;
+  data.m_ClosestPoints = closestPoints != NULL ? &closestCoordinates[0] : NULL;
+  data.m_NumberOfPoints = numberOfPoints;
+
+  vtkIdType numberOfBlocks = (numberOfPoints + PointsPerBlock - 1) / PointsPerBlock;
+  int numberOfThreads = static_cast<int>(std::min(static_cast<vtkIdType>(m_NumberOfThreads), numberOfBlocks));
+
+  vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+  threader->SetNumberOfThreads(numberOfThreads);
+  threader->SetSingleMethod(ComputeDistancesThreaderCallback, &data);
+  threader->SingleMethodExecute();
+
+  if (closestPoints != NULL)
+  {
+    closestPoints->SetNumberOfPoints(numberOfPoints);
+    for (vtkIdType i = 0; i < numberOfPoints; i++)
+    {
+      closestPoints->SetPoint(i, &closestCoordinates[3 * i]);
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+} // end namespace
@@ -0,0 +1,133 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#ifndef niftkVTKSurfaceDistance_h
+#define niftkVTKSurfaceDistance_h
+
+#include "niftkVTKWin32ExportHeader.h"
+#include <vtkDoubleArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vector>
+
+namespace niftk {
+
+/**
+ * \class VTKSurfaceDistance
+ * \brief Computes the distances from many points to the closest point on a triangulated surface.
+ *
+ * SetTarget() splits the polygons and triangle strips of the target into triangles, and builds
+ * a bounding volume hierarchy over them, once. ComputeDistances() then finds the closest point
+ * on the surface for each of a set of points, on several threads, so it is much faster than
+ * querying a vtkCellLocator one point at a time. Vertices and lines of the target are ignored.
+ *
+ * If SetSignedDistance() is on, distances are positive on the side of the surface that its
+ * normals point to, and negative on the other side, using the angle weighted pseudo-normals
+ * of Baerentzen and Aanaes (IEEE TVCG 2005), which give the correct sign for any point, as long
+ * as the triangles are consistently oriented.
+ *
+ * Once built, queries do not modify the object, so the results do not depend on the number of threads.
+ */
+class NIFTKVTK_WINEXPORT VTKSurfaceDistance {
+
+public:
+
+  VTKSurfaceDistance();
+  ~VTKSurfaceDistance();
+
+  /**
+   * \brief Builds the hierarchy over a copy of the triangles of target, replacing any previous one.
+   */
+  void SetTarget(vtkPolyData *target);
+
+  /**
+   * \brief Returns the number of (non-degenerate) triangles in the target.
+   */
+  vtkIdType GetNumberOfTriangles() const;
+
+  /**
+   * \brief Set the number of threads used by ComputeDistances(), default is the VTK default.
+   */
+  void SetNumberOfThreads(int);
+
+  /**
+   * \brief Set whether distances are signed, default false.
+   */
+  void SetSignedDistance(bool);
+
+  /**
+   * \brief Finds the closest point on the target to point, throwing std::runtime_error if the target has no triangles.
+   * \param closestPoint if not NULL, is set to the closest point on the target.
+   * \param cellId if not NULL, is set to the id of the target cell that closestPoint is on.
+   * \return the distance from point to the target.
+   */
+  double FindClosestPoint(const double point[3], double *closestPoint = NULL, vtkIdType *cellId = NULL) const;
+
+  /**
+   * \brief Computes the distance from each of points to the target, in parallel,
+   * throwing std::runtime_error if the target has no triangles. The points are searched for in
+   * Morton order, so that nearby points share the same parts of the hierarchy in the cache.
+   * \param distances is resized to one value per point.
+   * \param closestCellIds if not NULL, is resized to hold the id of the closest target cell to each point.
+   * \param closestPoints if not NULL, is resized to hold the closest point on the target to each point.
+   */
+  void ComputeDistances(vtkPoints *points,
+                        vtkDoubleArray *distances,
+                        vtkIdTypeArray *closestCellIds = NULL,
+                        vtkPoints *closestPoints = NULL
+                       ) const;
+
+private:
+
+  VTKSurfaceDistance(const VTKSurfaceDistance&); // Purposefully not implemented.
+  VTKSurfaceDistance& operator=(const VTKSurfaceDistance&); // Purposefully not implemented.
+
+  struct Node
+  {
+    double m_Bounds[6];
+    int    m_Left;    // -1 for a leaf.
+    int    m_Right;
+    int    m_Begin;
+    int    m_End;
+  };
+
+  struct BuildTriangle
+  {
+    double m_Bounds[6];
+    double m_Centroid[3];
+    int    m_Index;
+  };
+
+  int BuildNode(int begin, int end, std::vector<BuildTriangle>& triangles);
+
+  std::vector<Node>      m_Nodes;
+
+  // Per triangle, in tree order.
+  std::vector<double>    m_Vertices;       // 9 coordinates.
+  std::vector<vtkIdType> m_VertexIds;      // 3 target point ids.
+  std::vector<vtkIdType> m_CellIds;
+  std::vector<double>    m_FaceNormals;    // 3 components.
+  std::vector<double>    m_EdgeNormals;    // 3 components for each of the edges 01, 12 and 20.
+
+  // Per target point.
+  std::vector<double>    m_VertexNormals;
+
+  int                    m_NumberOfThreads;
+  bool                   m_SignedDistance;
+};
+
+} // end namespace
+
+#endif
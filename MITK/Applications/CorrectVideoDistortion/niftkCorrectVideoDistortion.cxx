@@ -33,6 +33,12 @@ int main(int argc, char** argv)
     return EXIT_FAILURE;
   }
 
+  if (numberOfThreads < 0)
+  {
+    std::cerr << "The number of threads must not be negative." << std::endl;
+    return EXIT_FAILURE;
+  }
+
   if (input == output)
   {
     std::cerr << "Output filename is the same as the input ...  I'm giving up." << std::endl;
@@ -68,7 +74,8 @@ int main(int argc, char** argv)
         intrinsicRight,
         distortionRight,
         output,
-        writeInterleaved
+        writeInterleaved,
+        numberOfThreads
         );
   }
   else
@@ -0,0 +1,202 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+/*!
+ * \file niftkMeshSmootherBenchmark.cxx
+ * \page niftkMeshSmootherBenchmark
+ * \section niftkMeshSmootherBenchmarkSummary niftkMeshSmootherBenchmark times the mesh smoothing and normal computation of niftk::MeshSmoother on a large synthetic sphere, for an increasing number of threads.
+ */
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <itkMultiThreader.h>
+#include <itkTimeProbe.h>
+#include <niftkCommandLineParser.h>
+
+#include <mitkExceptionMacro.h>
+
+#include <niftkMeshSmoother.h>
+#include <niftkParallelCMC33.h>
+
+
+struct niftk::CommandLineArgumentDescription clArgList[] =
+{
+  {OPT_INT, "s", "int", "[256] Size of the grid that the sphere is extracted from, in each direction."},
+  {OPT_FLOAT, "bumps", "float", "[0.05] Amplitude of the bumps on the sphere, relative to its radius."},
+  {OPT_INT, "iter", "int", "[10] Number of Taubin smoothing steps."},
+  {OPT_INT, "m", "int", "[-1] Smoothing method either (0) Laplacian, (1) curvature normal, (2) inverse edge length, or (-1) all of them."},
+  {OPT_INT, "nt", "int", "[ITK default] Maximum number of threads. The timings are run for 1, 2, 4, ... threads up to this number."},
+  {OPT_DONE, NULL, NULL,
+    "Program to benchmark the mesh smoothing and normal computation on a large synthetic sphere.\n"
+  }
+};
+
+
+enum {
+  O_GRID_SIZE,
+
+  O_BUMPS,
+
+  O_ITERATIONS,
+
+  O_METHOD,
+
+  O_NUMBER_OF_THREADS
+};
+
+
+//-----------------------------------------------------------------------------
+/// Returns the largest distance between the corresponding vertices of two meshes.
+double GetMaximumDistance(const niftk::MeshData& a, const niftk::MeshData& b)
+{
+  double maximum = 0;
+
+  for (size_t i = 0; i < a.m_Vertices.size() && i < b.m_Vertices.size(); i++)
+  {
+    maximum = std::max(maximum, static_cast<double>(a.m_Vertices[i].GetCoords().Distance(b.m_Vertices[i].GetCoords())));
+  }
+  return maximum;
+}
+
+
+//-----------------------------------------------------------------------
+// main()
+// -------------------------------------------------------------------------
+
+int main( int argc, char *argv[] )
+{
+  int   gridSize = 256;
+  float bumps = 0.05f;
+  int   iterations = 10;
+  int   method = -1;
+  int   maxNumberOfThreads = itk::MultiThreader::GetGlobalDefaultNumberOfThreads();
+
+  niftk::CommandLineParser CommandLineOptions(argc, argv, clArgList, false);
+
+  CommandLineOptions.GetArgument(O_GRID_SIZE, gridSize);
+
+  CommandLineOptions.GetArgument(O_BUMPS, bumps);
+
+  CommandLineOptions.GetArgument(O_ITERATIONS, iterations);
+
+  CommandLineOptions.GetArgument(O_METHOD, method);
+
+  CommandLineOptions.GetArgument(O_NUMBER_OF_THREADS, maxNumberOfThreads);
+
+  if (gridSize < 3 || iterations < 0 || method < -1 || method > 2 || maxNumberOfThreads < 1)
+  {
+    std::cerr << "Invalid arguments." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  try
+  {
+    std::vector<niftk::real> data;
+    niftk::CreateBumpySphere(gridSize, bumps, data);
+
+    niftk::MeshData sphere;
+    niftk::ParallelCMC33 extractor(gridSize, gridSize, gridSize);
+    extractor.set_input_data(&data[0]);
+    extractor.set_output_data(&sphere);
+    extractor.run(0);
+
+    std::vector<niftk::real>().swap(data);
+
+    std::cout << "Sphere has " << sphere.m_Vertices.size() << " vertices and " << sphere.m_Triangles.size() << " triangles." << std::endl;
+
+    std::vector<int> threadCounts;
+    for (int t = 1; t < maxNumberOfThreads; t *= 2)
+    {
+      threadCounts.push_back(t);
+    }
+    threadCounts.push_back(maxNumberOfThreads);
+
+    const char *methodNames[] = { "Laplacian", "Curvature normal", "Inverse edge length" };
+
+    std::cout << std::setw(22) << "Method"
+              << std::setw(10) << "Threads"
+              << std::setw(16) << "Connectivity(s)"
+              << std::setw(12) << "Smooth(s)"
+              << std::setw(12) << "Normals(s)"
+              << std::setw(10) << "Speedup"
+              << std::setw(16) << "Max difference" << std::endl;
+
+    for (int m = 0; m < 3; m++)
+    {
+      if (method != -1 && method != m)
+      {
+        continue;
+      }
+
+      niftk::MeshData singleThreaded;
+      double singleThreadedTime = 0;
+
+      for (size_t t = 0; t < threadCounts.size(); t++)
+      {
+        niftk::MeshData mesh = sphere;
+
+        niftk::MeshSmoother smoother;
+        smoother.InitWithExternalData(&mesh);
+        smoother.SetSmoothingMethod(m);
+        smoother.SetNumberOfThreads(threadCounts[t]);
+
+        itk::TimeProbe connectivityProbe;
+        connectivityProbe.Start();
+        smoother.BuildConnectivity();
+        connectivityProbe.Stop();
+
+        itk::TimeProbe smoothingProbe;
+        smoothingProbe.Start();
+        smoother.TaubinSmooth(0.5f, -0.53f, iterations);
+        smoothingProbe.Stop();
+
+        itk::TimeProbe normalsProbe;
+        normalsProbe.Start();
+        smoother.GenerateVertexAndTriangleNormals();
+        normalsProbe.Stop();
+
+        double time = smoothingProbe.GetTotal() + normalsProbe.GetTotal();
+
+        if (t == 0)
+        {
+          singleThreaded = mesh;
+          singleThreadedTime = time;
+        }
+
+        std::cout << std::setw(22) << methodNames[m]
+                  << std::setw(10) << threadCounts[t]
+                  << std::setw(16) << connectivityProbe.GetTotal()
+                  << std::setw(12) << smoothingProbe.GetTotal()
+                  << std::setw(12) << normalsProbe.GetTotal()
+                  << std::setw(10) << (time > 0 ? singleThreadedTime / time : 0)
+                  << std::setw(16) << GetMaximumDistance(singleThreaded, mesh) << std::endl;
+      }
+    }
+  }
+  catch (mitk::Exception& e)
+  {
+    std::cerr << "Caught mitk::Exception: " << e.GetDescription() << std::endl;
+    return EXIT_FAILURE;
+  }
+  catch (std::exception& e)
+  {
+    std::cerr << "Caught std::exception: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
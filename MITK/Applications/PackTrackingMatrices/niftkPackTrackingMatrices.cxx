@@ -0,0 +1,114 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+/*!
+ * \file niftkPackTrackingMatrices.cxx
+ * \page niftkPackTrackingMatrices
+ * \section niftkPackTrackingMatricesSummary niftkPackTrackingMatrices packs a directory of <timestamp>.txt tracking matrices into a single, memory mappable file, that the tracking loaders read in preference to the text files.
+ */
+
+#include <iostream>
+#include <string>
+
+#include <QDirIterator>
+
+#include <niftkCommandLineParser.h>
+
+#include <mitkExceptionMacro.h>
+
+#include <niftkTrackingMatrixStore.h>
+
+
+struct niftk::CommandLineArgumentDescription clArgList[] =
+{
+  {OPT_STRING|OPT_REQ, "i", "directory", "Directory of <timestamp>.txt tracking matrices."},
+  {OPT_SWITCH, "r", NULL, "Also pack every sub-directory that contains tracking matrices."},
+  {OPT_DONE, NULL, NULL,
+    "Program to pack a directory of time stamped tracking matrices into a single file, "
+    "checking that it reads back exactly the same matrices. The text files are left as they are.\n"
+  }
+};
+
+
+enum {
+  O_INPUT_DIRECTORY,
+
+  O_RECURSIVE
+};
+
+
+//-----------------------------------------------------------------------------
+/// Packs a single directory, if it has any matrices in it.
+void PackDirectory(const std::string& directory)
+{
+  if (!niftk::TrackingMatrixStore::DirectoryContainsMatrixFiles(directory))
+  {
+    return;
+  }
+
+  size_t numberOfMatrices = niftk::TrackingMatrixStore::ConvertDirectory(directory);
+
+  std::cout << "Packed " << numberOfMatrices << " matrices into "
+            << niftk::TrackingMatrixStore::GetFileNameInDirectory(directory) << std::endl;
+}
+
+
+//-----------------------------------------------------------------------
+// main()
+// -------------------------------------------------------------------------
+
+int main( int argc, char *argv[] )
+{
+  std::string inputDirectory;
+  bool recursive = false;
+
+  niftk::CommandLineParser CommandLineOptions(argc, argv, clArgList, true);
+
+  CommandLineOptions.GetArgument(O_INPUT_DIRECTORY, inputDirectory);
+
+  CommandLineOptions.GetArgument(O_RECURSIVE, recursive);
+
+  try
+  {
+    if (!recursive && !niftk::TrackingMatrixStore::DirectoryContainsMatrixFiles(inputDirectory))
+    {
+      mitkThrow() << "Directory:" << inputDirectory << ", doesn't contain any tracking matrices.";
+    }
+
+    PackDirectory(inputDirectory);
+
+    if (recursive)
+    {
+      QDirIterator it(QString::fromStdString(inputDirectory),
+                      QDir::Dirs | QDir::NoDotAndDotDot,
+                      QDirIterator::Subdirectories);
+      while (it.hasNext())
+      {
+        PackDirectory(it.next().toStdString());
+      }
+    }
+  }
+  catch (mitk::Exception& e)
+  {
+    std::cerr << "Caught mitk::Exception: " << e.GetDescription() << std::endl;
+    return EXIT_FAILURE;
+  }
+  catch (std::exception& e)
+  {
+    std::cerr << "Caught std::exception: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,229 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+/*!
+ * \file niftkTimeStampMatchingBenchmark.cxx
+ * \page niftkTimeStampMatchingBenchmark
+ * \section niftkTimeStampMatchingBenchmarkSummary niftkTimeStampMatchingBenchmark times matching the video frames of a long, synthetic session to the nearest tracking time stamps, as mitk::VideoTrackerMatching does.
+ */
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <itkTimeProbe.h>
+#include <niftkCommandLineParser.h>
+
+#include <mitkExceptionMacro.h>
+
+#include <mitkTimeStampsContainer.h>
+
+
+struct niftk::CommandLineArgumentDescription clArgList[] =
+{
+  {OPT_INT, "frames", "int", "[1000000] Number of video frames, at 30 frames per second."},
+  {OPT_INT, "trackers", "int", "[2] Number of trackers, each at 60 samples per second, with 1% of samples dropped."},
+  {OPT_INT, "linear", "int", "[1000] Number of frames to time the linear scan on, which is then scaled up to all frames."},
+  {OPT_DONE, NULL, NULL,
+    "Program to benchmark matching video frames to tracking time stamps on a long synthetic session.\n"
+  }
+};
+
+
+enum {
+  O_NUMBER_OF_FRAMES,
+
+  O_NUMBER_OF_TRACKERS,
+
+  O_NUMBER_OF_LINEAR_FRAMES
+};
+
+
+//-----------------------------------------------------------------------------
+/// Returns evenly spaced time stamps, with up to 2ms of jitter, and dropping some of them.
+void CreateTimeStamps(mitk::TimeStampsContainer::TimeStamp start,
+                      mitk::TimeStampsContainer::TimeStamp interval,
+                      size_t numberOfTimeStamps,
+                      int dropPercentage,
+                      mitk::TimeStampsContainer& timeStamps)
+{
+  timeStamps.Clear();
+
+  for (size_t i = 0; i < numberOfTimeStamps; i++)
+  {
+    if (std::rand() % 100 < dropPercentage)
+    {
+      continue;
+    }
+    timeStamps.Insert(start + i * interval + std::rand() % 2000000);
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+/// Finds the array index of the nearest time stamp the way it used to be done, by looking
+/// up the bounding time stamps, and then scanning the list for the index of the nearest.
+std::vector<mitk::TimeStampsContainer::TimeStamp>::size_type GetNearestFrameNumberByScanning(
+    const mitk::TimeStampsContainer& timeStamps, const mitk::TimeStampsContainer::TimeStamp& timeStamp)
+{
+  mitk::TimeStampsContainer::TimeStamp nearest = timeStamps.GetNearestTimeStamp(timeStamp);
+
+  for (std::vector<mitk::TimeStampsContainer::TimeStamp>::size_type i = 0; i < timeStamps.GetSize(); i++)
+  {
+    if (timeStamps.GetTimeStamp(i) == nearest)
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+
+//-----------------------------------------------------------------------
+// main()
+// -------------------------------------------------------------------------
+
+int main( int argc, char *argv[] )
+{
+  int numberOfFrames = 1000000;
+  int numberOfTrackers = 2;
+  int numberOfLinearFrames = 1000;
+
+  niftk::CommandLineParser CommandLineOptions(argc, argv, clArgList, false);
+
+  CommandLineOptions.GetArgument(O_NUMBER_OF_FRAMES, numberOfFrames);
+
+  CommandLineOptions.GetArgument(O_NUMBER_OF_TRACKERS, numberOfTrackers);
+
+  CommandLineOptions.GetArgument(O_NUMBER_OF_LINEAR_FRAMES, numberOfLinearFrames);
+
+  if (numberOfFrames < 1 || numberOfTrackers < 1 || numberOfLinearFrames < 0)
+  {
+    std::cerr << "Invalid arguments." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (numberOfLinearFrames > numberOfFrames)
+  {
+    numberOfLinearFrames = numberOfFrames;
+  }
+
+  try
+  {
+    const mitk::TimeStampsContainer::TimeStamp start = 1421408023440156000ULL;
+
+    mitk::TimeStampsContainer video;
+    CreateTimeStamps(start, 33333333, numberOfFrames, 0, video);
+
+    std::vector<mitk::TimeStampsContainer::TimeStamp> videoTimeStamps(video.GetSize());
+    for (size_t i = 0; i < videoTimeStamps.size(); i++)
+    {
+      videoTimeStamps[i] = video.GetTimeStamp(i);
+    }
+
+    std::vector<mitk::TimeStampsContainer> trackers(numberOfTrackers);
+    for (int t = 0; t < numberOfTrackers; t++)
+    {
+      CreateTimeStamps(start + t * 3000000, 16666667, 2 * static_cast<size_t>(numberOfFrames), 1, trackers[t]);
+    }
+
+    std::cout << "Session has " << videoTimeStamps.size() << " video frames and " << numberOfTrackers
+              << " trackers with " << trackers[0].GetSize() << " samples each." << std::endl;
+
+    // Linear scan for the index, on a few frames, scaled up to all of them.
+    itk::TimeProbe linearProbe;
+    linearProbe.Start();
+    for (int t = 0; t < numberOfTrackers; t++)
+    {
+      for (int i = 0; i < numberOfLinearFrames; i++)
+      {
+        // Spread over the session, as the scan takes longer for later frames.
+        size_t frame = static_cast<size_t>(i) * (videoTimeStamps.size() / numberOfLinearFrames);
+        GetNearestFrameNumberByScanning(trackers[t], videoTimeStamps[frame]);
+      }
+    }
+    linearProbe.Stop();
+
+    // Search for each frame separately.
+    std::vector< std::vector<std::vector<mitk::TimeStampsContainer::TimeStamp>::size_type> > searchFrameNumbers(numberOfTrackers);
+    std::vector< std::vector<long long> > searchDeltas(numberOfTrackers);
+
+    itk::TimeProbe searchProbe;
+    searchProbe.Start();
+    for (int t = 0; t < numberOfTrackers; t++)
+    {
+      searchFrameNumbers[t].resize(videoTimeStamps.size());
+      searchDeltas[t].resize(videoTimeStamps.size());
+      for (size_t i = 0; i < videoTimeStamps.size(); i++)
+      {
+        searchFrameNumbers[t][i] = trackers[t].GetFrameNumber(trackers[t].GetNearestTimeStamp(videoTimeStamps[i], &searchDeltas[t][i]));
+      }
+    }
+    searchProbe.Stop();
+
+    // Match all the frames in one pass.
+    std::vector< std::vector<std::vector<mitk::TimeStampsContainer::TimeStamp>::size_type> > mergeFrameNumbers(numberOfTrackers);
+    std::vector< std::vector<long long> > mergeDeltas(numberOfTrackers);
+
+    itk::TimeProbe mergeProbe;
+    mergeProbe.Start();
+    for (int t = 0; t < numberOfTrackers; t++)
+    {
+      trackers[t].GetNearestFrameNumbers(videoTimeStamps, mergeFrameNumbers[t], mergeDeltas[t]);
+    }
+    mergeProbe.Stop();
+
+    bool same = true;
+    for (int t = 0; t < numberOfTrackers; t++)
+    {
+      same = same && searchFrameNumbers[t] == mergeFrameNumbers[t] && searchDeltas[t] == mergeDeltas[t];
+    }
+
+    double linearTime = numberOfLinearFrames > 0
+        ? linearProbe.GetTotal() * videoTimeStamps.size() / numberOfLinearFrames
+        : 0;
+
+    std::cout << std::setw(28) << "Method"
+              << std::setw(16) << "Time(s)"
+              << std::setw(20) << "Per lookup(ns)" << std::endl;
+    std::cout << std::setw(28) << "Linear scan (estimated)"
+              << std::setw(16) << linearTime
+              << std::setw(20) << linearTime * 1e9 / (videoTimeStamps.size() * numberOfTrackers) << std::endl;
+    std::cout << std::setw(28) << "Search per frame"
+              << std::setw(16) << searchProbe.GetTotal()
+              << std::setw(20) << searchProbe.GetTotal() * 1e9 / (videoTimeStamps.size() * numberOfTrackers) << std::endl;
+    std::cout << std::setw(28) << "Merge all frames"
+              << std::setw(16) << mergeProbe.GetTotal()
+              << std::setw(20) << mergeProbe.GetTotal() * 1e9 / (videoTimeStamps.size() * numberOfTrackers) << std::endl;
+    std::cout << "Search and merge give the same matches: " << (same ? "yes" : "NO") << std::endl;
+
+    if (!same)
+    {
+      return EXIT_FAILURE;
+    }
+  }
+  catch (mitk::Exception& e)
+  {
+    std::cerr << "Caught mitk::Exception: " << e.GetDescription() << std::endl;
+    return EXIT_FAILURE;
+  }
+  catch (std::exception& e)
+  {
+    std::cerr << "Caught std::exception: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -41,7 +41,6 @@ int main(int argc, char** argv)
 
   try
   {
-    niftk::MatrixTrackedImageData data = niftk::LoadImageAndTrackingDataFromDirectories(imageDirectory, matrixDirectory);
     vtkSmartPointer<vtkMatrix4x4> rigidMatrix = niftk::LoadVtkMatrix4x4FromFile(rigidMatrixFile);
     vtkSmartPointer<vtkMatrix4x4> scalingMatrix = niftk::LoadVtkMatrix4x4FromFile(scalingMatrixFile);
 
@@ -57,10 +56,27 @@ int main(int argc, char** argv)
     spacing[1] = voxelSize[1];
     spacing[2] = voxelSize[2];
 
-    mitk::Image::Pointer volume = niftk::DoUltrasoundReconstruction(data,          // input data
-                                                                    scaleFactors,  // from calibration
-                                                                    imageToSensor, // from calibration
-                                                                    spacing);      // command line arg
+    mitk::Image::Pointer volume;
+
+    if (streaming)
+    {
+      volume = niftk::DoStreamingUltrasoundReconstruction(imageDirectory,    // images loaded one at a time
+                                                          matrixDirectory,
+                                                          scaleFactors,      // from calibration
+                                                          imageToSensor,     // from calibration
+                                                          spacing,           // command line arg
+                                                          holeFillingRadius, // command line arg
+                                                          numberOfThreads);  // command line arg
+    }
+    else
+    {
+      niftk::MatrixTrackedImageData data = niftk::LoadImageAndTrackingDataFromDirectories(imageDirectory, matrixDirectory);
+
+      volume = niftk::DoUltrasoundReconstruction(data,          // input data
+                                                 scaleFactors,  // from calibration
+                                                 imageToSensor, // from calibration
+                                                 spacing);      // command line arg
+    }
 
     mitk::IOUtil::Save(volume, outputImage);
     returnStatus = EXIT_SUCCESS;
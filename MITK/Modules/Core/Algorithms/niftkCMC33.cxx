@@ -73,6 +73,13 @@ _originalMC(false),
   _x_verts ((int *)NULL),
   _y_verts ((int *)NULL),
   _z_verts ((int *)NULL),
+  _k_begin (0),
+  _k_end (-1),
+  _block_size (8),
+  _nblocks_x (0),
+  _nblocks_y (0),
+  _nblocks_z (0),
+  _block_active ((bool *)NULL),
   _nverts (0),
   _ntrigs (0),
   _Nverts (0),
@@ -102,12 +109,33 @@ void CMC33::run(real iso)
 {
   clock_t time = clock();
 
+  extract(iso);
+
+  printf("New Marching Cubes 33:ran in %lf secs.\n", (double) (clock() - time) / CLOCKS_PER_SEC);
+}
+//_____________________________________________________________________________
+
+
+
+//_____________________________________________________________________________
+// main algorithm, without timing
+void CMC33::extract(real iso)
+//-----------------------------------------------------------------------------
+{
+  compute_block_range(iso);
   compute_intersection_points(iso);
 
-  for(_k = 0; _k < _size_z-1; _k++)
+  for(_k = _k_begin; _k < _k_end; _k++)
     for(_j = 0; _j < _size_y-1; _j++)
       for(_i = 0; _i < _size_x-1; _i++)
       {
+        if(!is_block_active(_i, _j, _k))
+        {
+          // skip to the last cube of the block
+          _i = (_i / _block_size + 1) * _block_size - 1;
+          continue;
+        }
+
         _lut_entry = 0;
         for(int p = 0; p < 8; ++p)
         {
@@ -128,8 +156,6 @@ void CMC33::run(real iso)
   m_MeshDataExt->m_Triangles.resize(_ntrigs);
   m_MeshDataExt->m_VertexToTriangleIndices.resize(_nverts);
   m_MeshDataExt->m_VertexToVertexIndices.resize(_nverts);
-
-  printf("New Marching Cubes 33:ran in %lf secs.\n", (double) (clock() - time) / CLOCKS_PER_SEC);
 }
 //_____________________________________________________________________________
 
@@ -142,13 +168,20 @@ void CMC33::init_temps()
   if(!_ext_data)
     _data = new real [_size_x * _size_y * _size_z];
 
-  _x_verts = new int [_size_x * _size_y * _size_z];
-  _y_verts = new int [_size_x * _size_y * _size_z];
-  _z_verts = new int [_size_x * _size_y * _size_z];
+  if(_k_begin < 0)
+    _k_begin = 0;
 
-  memset(_x_verts, -1, _size_x * _size_y * _size_z * sizeof(int));
-  memset(_y_verts, -1, _size_x * _size_y * _size_z * sizeof(int));
-  memset(_z_verts, -1, _size_x * _size_y * _size_z * sizeof(int));
+  if(_k_end < 0 || _k_end > _size_z - 1)
+    _k_end = _size_z - 1;
+
+  // the vertex indices are only stored for the grid planes of the slab
+  _x_verts = new int [slab_size()];
+  _y_verts = new int [slab_size()];
+  _z_verts = new int [slab_size()];
+
+  memset(_x_verts, -1, slab_size() * sizeof(int));
+  memset(_y_verts, -1, slab_size() * sizeof(int));
+  memset(_z_verts, -1, slab_size() * sizeof(int));
 }
 //_____________________________________________________________________________
 
@@ -190,6 +223,7 @@ void CMC33::clean_temps()
   delete [] _x_verts;
   delete [] _y_verts;
   delete [] _z_verts;
+  delete [] _block_active;
 
   if(!_ext_data)
     _data = (real*)NULL;
@@ -197,6 +231,7 @@ void CMC33::clean_temps()
   _x_verts = (int*)NULL;
   _y_verts = (int*)NULL;
   _z_verts = (int*)NULL;
+  _block_active = (bool*)NULL;
 }
 //_____________________________________________________________________________
 
@@ -213,6 +248,9 @@ void CMC33::clean_all()
   _Nverts = _Ntrigs = 0;
 
   _size_x = _size_y = _size_z = -1;
+
+  _k_begin = 0;
+  _k_end = -1;
 }
 //_____________________________________________________________________________
 
@@ -229,9 +267,9 @@ void CMC33::restart()
 
   _nverts = _ntrigs = 0;
   _Nverts = _Ntrigs = ALLOC_SIZE;
-  memset(_x_verts, -1, _size_x * _size_y * _size_z * sizeof(int));
-  memset(_y_verts, -1, _size_x * _size_y * _size_z * sizeof(int));
-  memset(_z_verts, -1, _size_x * _size_y * _size_z * sizeof(int));
+  memset(_x_verts, -1, slab_size() * sizeof(int));
+  memset(_y_verts, -1, slab_size() * sizeof(int));
+  memset(_z_verts, -1, slab_size() * sizeof(int));
 }
 //_____________________________________________________________________________
 
@@ -241,10 +279,17 @@ void CMC33::restart()
 void CMC33::compute_intersection_points(real iso)
 //-----------------------------------------------------------------------------
 {
-  for(_k = 0; _k < _size_z; _k++)
+  for(_k = _k_begin; _k <= _k_end; _k++)
     for(_j = 0; _j < _size_y; _j++)
       for(_i = 0; _i < _size_x; _i++)
       {
+        if(!is_block_active(_i, _j, _k))
+        {
+          // skip to the last grid point of the block
+          _i = std::min((_i / _block_size + 1) * _block_size, _size_x) - 1;
+          continue;
+        }
+
         _cube[0] = get_data(_i, _j, _k) - iso;
         if(_i < _size_x - 1)
           _cube[1] = get_data(_i+1, _j , _k) - iso;
@@ -256,7 +301,7 @@ void CMC33::compute_intersection_points(real iso)
         else
           _cube[3] = _cube[0];
 
-        if(_k < _size_z - 1)
+        if(_k < _k_end)
           _cube[4] = get_data(_i , _j ,_k+1) - iso;
         else
           _cube[4] = _cube[0];
@@ -301,6 +346,79 @@ void CMC33::compute_intersection_points(real iso)
 
 
 
+//_____________________________________________________________________________
+// Compute which blocks of the slab the isosurface may cross
+void CMC33::compute_block_range(real iso)
+//-----------------------------------------------------------------------------
+{
+  delete [] _block_active;
+  _block_active = (bool*)NULL;
+
+  if(_block_size <= 0)
+    return;
+
+  // one block per _block_size cubes, with at least one block along each axis
+  _nblocks_x = std::max(1, (_size_x - 2) / _block_size + 1);
+  _nblocks_y = std::max(1, (_size_y - 2) / _block_size + 1);
+  _nblocks_z = std::max(1, (_k_end - _k_begin - 1) / _block_size + 1);
+
+  _block_active = new bool [_nblocks_x * _nblocks_y * _nblocks_z];
+
+  for(int bk = 0; bk < _nblocks_z; bk++)
+    for(int bj = 0; bj < _nblocks_y; bj++)
+      for(int bi = 0; bi < _nblocks_x; bi++)
+      {
+        // the grid points of the cubes of the block, including the far faces
+        int i0 = bi * _block_size;
+        int j0 = bj * _block_size;
+        int k0 = _k_begin + bk * _block_size;
+        int i1 = bi < _nblocks_x - 1 ? i0 + _block_size : _size_x - 1;
+        int j1 = bj < _nblocks_y - 1 ? j0 + _block_size : _size_y - 1;
+        int k1 = bk < _nblocks_z - 1 ? k0 + _block_size : _k_end;
+
+        real min_value = FLT_MAX;
+        real max_value = -FLT_MAX;
+
+        for(int k = k0; k <= k1; k++)
+          for(int j = j0; j <= j1; j++)
+            for(int i = i0; i <= i1; i++)
+            {
+              real value = get_data(i, j, k);
+              if(value < min_value)
+                min_value = value;
+              if(value > max_value)
+                max_value = value;
+            }
+
+        // values closer than FLT_EPSILON to the isovalue are counted as above it, as in run
+        bool all_above = min_value - iso > -FLT_EPSILON;
+        bool all_below = max_value - iso <= -FLT_EPSILON;
+
+        _block_active[bi + bj*_nblocks_x + bk*_nblocks_x*_nblocks_y] = !all_above && !all_below;
+      }
+}
+//_____________________________________________________________________________
+
+
+
+//_____________________________________________________________________________
+// Test if a grid point is in a block that the isosurface may cross
+bool CMC33::is_block_active(const int i, const int j, const int k) const
+//-----------------------------------------------------------------------------
+{
+  if(_block_active == NULL)
+    return true;
+
+  int bi = std::min(i / _block_size, _nblocks_x - 1);
+  int bj = std::min(j / _block_size, _nblocks_y - 1);
+  int bk = std::min((k - _k_begin) / _block_size, _nblocks_z - 1);
+
+  return _block_active[bi + bj*_nblocks_x + bk*_nblocks_x*_nblocks_y];
+}
+//_____________________________________________________________________________
+
+
+
 
 //_____________________________________________________________________________
 // Test a face
@@ -104,6 +104,36 @@ public :
   /**  accesses the height of the grid */
   inline const int size_z() const { return _size_z; }
 
+  /** accesses the first grid plane of the slab that is processed */
+  inline const int k_begin() const { return _k_begin; }
+  /** accesses the last grid plane of the slab that is processed */
+  inline const int k_end() const { return _k_end; }
+
+  /**
+  * accesses the vertex index on the lower horizontal edge of a specific cube, or -1 if there is none.
+  * Only valid after run, for a height within the slab.
+  * \param i abscisse of the cube
+  * \param j ordinate of the cube
+  * \param k height of the cube
+  */
+  inline int   get_x_vert( const int i, const int j, const int k ) const { return _x_verts[ i + j*_size_x + (k-_k_begin)*_size_x*_size_y]; }
+  /**
+  * accesses the vertex index on the lower longitudinal edge of a specific cube, or -1 if there is none.
+  * Only valid after run, for a height within the slab.
+  * \param i abscisse of the cube
+  * \param j ordinate of the cube
+  * \param k height of the cube
+  */
+  inline int   get_y_vert( const int i, const int j, const int k ) const { return _y_verts[ i + j*_size_x + (k-_k_begin)*_size_x*_size_y]; }
+  /**
+  * accesses the vertex index on the lower vertical edge of a specific cube, or -1 if there is none.
+  * Only valid after run, for a height within the slab.
+  * \param i abscisse of the cube
+  * \param j ordinate of the cube
+  * \param k height of the cube
+  */
+  inline int   get_z_vert( const int i, const int j, const int k ) const { return _z_verts[ i + j*_size_x + (k-_k_begin)*_size_x*_size_y]; }
+
   /**
   * changes the size of the grid
   * \param size_x width  of the grid
@@ -129,6 +159,22 @@ public :
   /** turns normal computing on / off */
   inline void enable_normal_computing(bool value) { _computeNormals = value; }
 
+  /**
+  * restricts the extraction to the cubes between two grid planes, so that several slabs
+  * of the same grid can be processed independently (must be called before init_all).
+  * The vertices on the plane k_end are also generated by a slab starting at k_end.
+  * \param k_begin first grid plane of the slab
+  * \param k_end   last grid plane of the slab, or -1 for the top of the grid
+  */
+  inline void set_slab( const int k_begin, const int k_end ) { _k_begin = k_begin;  _k_end = k_end; }
+
+  /**
+  * sets the width of the blocks of cubes whose minimum and maximum values are used to skip
+  * the regions of the grid that the isosurface does not cross, or 0 to visit every cube
+  * \param block_size the block width, in cubes
+  */
+  inline void set_block_size( const int block_size ) { _block_size = block_size; }
+
   // Data initialization
   /** inits temporary structures (must set sizes before call) : the grid and the vertex index per cube */
   void init_temps ();
@@ -150,6 +196,12 @@ public :
   */
   void run( real iso = (real)0.0 );
 
+  /**
+  * Same as run, but does not report the time taken : must be called after init_all
+  * \param iso isovalue
+  */
+  void extract( real iso = (real)0.0 );
+
 protected :
   /** tesselates one cube */
   void process_cube ()            ;
@@ -226,28 +278,6 @@ protected :
   */
   real get_z_grad( const int i, const int j, const int k ) const;
 
-  /**
-  * accesses the pre-computed vertex index on the lower horizontal edge of a specific cube
-  * \param i abscisse of the cube
-  * \param j ordinate of the cube
-  * \param k height of the cube
-  */
-  inline int   get_x_vert( const int i, const int j, const int k ) const { return _x_verts[ i + j*_size_x + k*_size_x*_size_y]; }
-  /**
-  * accesses the pre-computed vertex index on the lower longitudinal edge of a specific cube
-  * \param i abscisse of the cube
-  * \param j ordinate of the cube
-  * \param k height of the cube
-  */
-  inline int   get_y_vert( const int i, const int j, const int k ) const { return _y_verts[ i + j*_size_x + k*_size_x*_size_y]; }
-  /**
-  * accesses the pre-computed vertex index on the lower vertical edge of a specific cube
-  * \param i abscisse of the cube
-  * \param j ordinate of the cube
-  * \param k height of the cube
-  */
-  inline int   get_z_vert( const int i, const int j, const int k ) const { return _z_verts[ i + j*_size_x + k*_size_x*_size_y]; }
-
   /**
   * sets the pre-computed vertex index on the lower horizontal edge of a specific cube
   * \param val the index of the new vertex
@@ -255,7 +285,7 @@ protected :
   * \param j ordinate of the cube
   * \param k height of the cube
   */
-  inline void  set_x_vert( const int val, const int i, const int j, const int k ) { _x_verts[ i + j*_size_x + k*_size_x*_size_y] = val; }
+  inline void  set_x_vert( const int val, const int i, const int j, const int k ) { _x_verts[ i + j*_size_x + (k-_k_begin)*_size_x*_size_y] = val; }
   /**
   * sets the pre-computed vertex index on the lower longitudinal edge of a specific cube
   * \param val the index of the new vertex
@@ -263,7 +293,7 @@ protected :
   * \param j ordinate of the cube
   * \param k height of the cube
   */
-  inline void  set_y_vert( const int val, const int i, const int j, const int k ) { _y_verts[ i + j*_size_x + k*_size_x*_size_y] = val; }
+  inline void  set_y_vert( const int val, const int i, const int j, const int k ) { _y_verts[ i + j*_size_x + (k-_k_begin)*_size_x*_size_y] = val; }
   /**
   * sets the pre-computed vertex index on the lower vertical edge of a specific cube
   * \param val the index of the new vertex
@@ -271,11 +301,29 @@ protected :
   * \param j ordinate of the cube
   * \param k height of the cube
   */
-  inline void  set_z_vert( const int val, const int i, const int j, const int k ) { _z_verts[ i + j*_size_x + k*_size_x*_size_y] = val; }
+  inline void  set_z_vert( const int val, const int i, const int j, const int k ) { _z_verts[ i + j*_size_x + (k-_k_begin)*_size_x*_size_y] = val; }
 
   /** prints cube for debug */
   void    print_cube();
 
+  /** number of grid points in the slab, which is the size of the vertex index arrays */
+  inline int slab_size() const { return _size_x * _size_y * (_k_end - _k_begin + 1); }
+
+  /**
+  * computes the minimum and maximum value of each block of the slab, and marks the blocks the isosurface may cross
+  * \param iso isovalue
+  */
+  void compute_block_range( real iso );
+
+  /**
+  * tests if a grid point belongs to a block that the isosurface may cross. The grid point
+  * is in the block of the cube at the same position, or in the last block along each axis.
+  * \param i abscisse of the grid point
+  * \param j ordinate of the grid point
+  * \param k height of the grid point
+  */
+  bool is_block_active( const int i, const int j, const int k ) const;
+
   /** checks the size of the connectivity vectors and allocates more space if required */
   void resizeAndAllocateConnectivity(int index);
 
@@ -296,6 +344,15 @@ protected :
   int      *_y_verts   ;  /**< pre-computed vertex indices on the lower longitudinal edge of each cube */
   int      *_z_verts   ;  /**< pre-computed vertex indices on the lower vertical     edge of each cube */
 
+  int       _k_begin   ;  /**< first grid plane of the slab */
+  int       _k_end     ;  /**< last grid plane of the slab */
+
+  int       _block_size;  /**< width of the blocks of cubes that can be skipped, 0 for none */
+  int       _nblocks_x ;  /**< number of blocks along the width  of the grid */
+  int       _nblocks_y ;  /**< number of blocks along the depth  of the grid */
+  int       _nblocks_z ;  /**< number of blocks along the height of the slab */
+  bool     *_block_active; /**< selects the blocks that the isosurface may cross */
+
   int       _nverts    ;  /**< number of allocated vertices  in the vertex   buffer */
   int       _ntrigs    ;  /**< number of allocated triangles in the triangle buffer */
   int       _Nverts    ;  /**< allocated size of the vertex   buffer  - buffer might have fewer elements*/
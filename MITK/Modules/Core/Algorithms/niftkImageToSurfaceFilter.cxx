@@ -43,6 +43,7 @@
 #include <mitkProgressBar.h>
 #include <mitkGlobalInteraction.h>
 #include "niftkMeshSmoother.h"
+#include "niftkParallelCMC33.h"
 
 namespace niftk
 {
@@ -129,15 +130,13 @@ void ImageToSurfaceFilter::CMC33SurfaceExtraction(mitk::Image *inputImage, MeshD
   itk::Image<float, 3>::Pointer inputItkImage;
   mitk::CastToItkImage(inputImage, inputItkImage);
 
-  CMC33 * cmcExtractor = new CMC33(inputImage->GetDimension(0), inputImage->GetDimension(1), inputImage->GetDimension(2));
-  cmcExtractor->set_input_data(inputItkImage->GetBufferPointer());
-  cmcExtractor->set_output_data(meshData);
-  cmcExtractor->enable_normal_computing(false);
+  // The volume is split into slabs that are extracted on separate threads, then stitched together.
+  ParallelCMC33 cmcExtractor(inputImage->GetDimension(0), inputImage->GetDimension(1), inputImage->GetDimension(2));
+  cmcExtractor.set_input_data(inputItkImage->GetBufferPointer());
+  cmcExtractor.set_output_data(meshData);
+  cmcExtractor.enable_normal_computing(false);
 
-  cmcExtractor->init_all();
-  cmcExtractor->run(m_Threshold);
-
-  delete cmcExtractor;
+  cmcExtractor.run(m_Threshold);
 }
 
 void ImageToSurfaceFilter::MeshSmoothing(MeshData * mesh)
@@ -370,6 +369,10 @@ void ImageToSurfaceFilter::CreateSurface(mitk::Image *inputImage, mitk::Surface
     }
     break;
 
+    case GPUExtractor:
+      // There is no GPU implementation, so use the multi-threaded CPU one instead.
+      MITK_WARN << "niftk::ImageToSurfaceFilter: GPU surface extraction is not available, using the enhanced CPU extractor.";
+
     case EnhancedCPUExtractor:
     {
       // Create a new instance of meshdata
@@ -423,9 +426,6 @@ void ImageToSurfaceFilter::CreateSurface(mitk::Image *inputImage, mitk::Surface
     }
     break;
 
-    case GPUExtractor:
-    break;
-
     default:
     break;
   }
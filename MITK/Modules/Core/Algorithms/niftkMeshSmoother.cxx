@@ -14,8 +14,12 @@
 
 #include "niftkMeshSmoother.h"
 #include <algorithm>
+#include <cmath>
+#include <exception>
 #include <unordered_set>
 
+#include <mitkExceptionMacro.h>
+
 namespace std
 {
 
@@ -58,6 +62,17 @@ struct vec_equal : std::unary_function<BasicVertex, bool>
   }
 };
 
+// Returns true if the k-th vertex of a triangle is the same as an earlier one, so that
+// degenerate triangles are only counted once per vertex.
+inline bool IsRepeatedVertex(const int v[3], size_t k)
+{
+  for(size_t j = 0; j < k; j++)
+    if(v[j] == v[k])
+      return true;
+
+  return false;
+}
+
 
 
 
@@ -65,6 +80,8 @@ MeshSmoother::MeshSmoother()
 {
   m_SmoothingMethod = 0;
   m_FlipNormals     = false;
+  m_NumberOfThreads = itk::MultiThreader::GetGlobalDefaultNumberOfThreads();
+  m_ConnectivityIsValid = false;
   m_MeshDataExt = 0;
 }
 
@@ -75,6 +92,8 @@ MeshSmoother::~MeshSmoother()
 
 void MeshSmoother::InitWithExternalData(MeshData * data)
 {
+  m_ConnectivityIsValid = false;
+
   if (data != 0)
     m_MeshDataExt = data;
   else
@@ -88,6 +107,7 @@ void MeshSmoother::Clear(void)
 {
   m_VertexNormals.clear();
   m_TriangleNormals.clear();
+  m_ConnectivityIsValid = false;
 }
 
 bool MeshSmoother::LoadFromBinarySTL(const char *const file_name, const bool generate_normals, const size_t buffer_width)
@@ -268,169 +288,213 @@ bool MeshSmoother::LoadFromBinarySTL(const char *const file_name, const bool gen
   return true;
 }
 
-// This produces results that are practically identical to Meshlab
-void MeshSmoother::LaplaceSmooth(const float scale)
+void MeshSmoother::BuildConnectivity(void)
 {
-  std::vector<BasicVec3D> displacements(m_MeshDataExt->m_Vertices.size(), BasicVec3D(0, 0, 0));
-
-  // Get per-vertex displacement.
-  for(size_t i = 0; i < m_MeshDataExt->m_Vertices.size(); i++)
+  // Sanity check
+  if (m_MeshDataExt == 0)
   {
-    // Skip rogue vertices (which were probably made rogue during a previous
-    // attempt to fix mesh cracks).
-    if(0 ==  m_MeshDataExt->m_VertexToVertexIndices[i].size())
-      continue;
+    MITK_ERROR <<"Invalid data pointer, MeshSmoother wasn't initialized properly!";
+    return;
+  }
 
-    const float weight = 1.0f / static_cast<float>( m_MeshDataExt->m_VertexToVertexIndices[i].size());
+  const size_t numberOfVertices  = m_MeshDataExt->m_Vertices.size();
+  const size_t numberOfTriangles = m_MeshDataExt->m_Triangles.size();
 
-    for(size_t j = 0; j <  m_MeshDataExt->m_VertexToVertexIndices[i].size(); j++)
-    {
-      size_t neighbour_j =  m_MeshDataExt->m_VertexToVertexIndices[i][j];
-      displacements[i] += (m_MeshDataExt->m_Vertices[neighbour_j].GetCoords() - m_MeshDataExt->m_Vertices[i].GetCoords())*weight;
-    }
+  // Count the triangles of each vertex, then turn the counts into offsets.
+  m_VertexTriangleOffsets.assign(numberOfVertices + 1, 0);
+
+  for(size_t i = 0; i < numberOfTriangles; i++)
+  {
+    const BasicTriangle &tri = m_MeshDataExt->m_Triangles[i];
+    const int v[3] = {tri.GetVert1Index(), tri.GetVert2Index(), tri.GetVert3Index()};
+
+    for(size_t k = 0; k < 3; k++)
+      if(!IsRepeatedVertex(v, k))
+        m_VertexTriangleOffsets[v[k] + 1]++;
   }
 
-  // Apply per-vertex displacement.
-  for(size_t i = 0; i < m_MeshDataExt->m_Vertices.size(); i++)
-    m_MeshDataExt->m_Vertices[i].SetCoords(m_MeshDataExt->m_Vertices[i].GetCoords() + displacements[i]*scale);
-}
+  for(size_t i = 0; i < numberOfVertices; i++)
+    m_VertexTriangleOffsets[i + 1] += m_VertexTriangleOffsets[i];
 
-void MeshSmoother::TaubinSmooth(const float lambda, const float mu, const size_t steps)
-{
-  // Sanity check
-  if (m_MeshDataExt == 0)
+  m_VertexTriangles.resize(m_VertexTriangleOffsets[numberOfVertices]);
+  std::vector<size_t> nextTriangle(m_VertexTriangleOffsets.begin(), m_VertexTriangleOffsets.end() - 1);
+
+  for(size_t i = 0; i < numberOfTriangles; i++)
   {
-    MITK_ERROR <<"Invalid data pointer, MeshSmoother wasn't initialized properly!";
-    return;
+    const BasicTriangle &tri = m_MeshDataExt->m_Triangles[i];
+    const int v[3] = {tri.GetVert1Index(), tri.GetVert2Index(), tri.GetVert3Index()};
+
+    for(size_t k = 0; k < 3; k++)
+      if(!IsRepeatedVertex(v, k))
+        m_VertexTriangles[nextTriangle[v[k]]++] = i;
   }
 
-  switch (m_SmoothingMethod)
+  // The neighbours of a vertex are the other vertices of its triangles.
+  m_VertexNeighbourOffsets.assign(numberOfVertices + 1, 0);
+  m_VertexNeighbours.clear();
+  m_VertexNeighbours.reserve(m_VertexTriangles.size());
+
+  std::vector<size_t> neighbours;
+
+  for(size_t i = 0; i < numberOfVertices; i++)
   {
-    case 0:
-      for(size_t s = 0; s < steps; s++)
-      {
-        LaplaceSmooth(lambda);
-        LaplaceSmooth(mu);
-      }
-      break;
+    neighbours.clear();
 
-    case 1:
-      for(size_t s = 0; s < steps; s++)
-      {
-        CurvatureNormalSmooth(lambda);
-        CurvatureNormalSmooth(mu);
-      }
-      break;
+    for(size_t j = m_VertexTriangleOffsets[i]; j < m_VertexTriangleOffsets[i + 1]; j++)
+    {
+      const BasicTriangle &tri = m_MeshDataExt->m_Triangles[m_VertexTriangles[j]];
+      const int v[3] = {tri.GetVert1Index(), tri.GetVert2Index(), tri.GetVert3Index()};
 
-    case 2:
-      for(size_t s = 0; s < steps; s++)
-      {
-        InverseEdgeLengthSmooth(lambda);
-        InverseEdgeLengthSmooth(mu);
-      }
-      break;
+      for(size_t k = 0; k < 3; k++)
+        if(static_cast<size_t>(v[k]) != i)
+          neighbours.push_back(v[k]);
+    }
+
+    std::sort(neighbours.begin(), neighbours.end());
+    m_VertexNeighbours.insert(m_VertexNeighbours.end(), neighbours.begin(), std::unique(neighbours.begin(), neighbours.end()));
+    m_VertexNeighbourOffsets[i + 1] = m_VertexNeighbours.size();
   }
 
-  // Recalculate normals, if necessary.
-  //RegenerateVertexAndTriangleNormalsIfExists();
+  m_ConnectivityIsValid = true;
 }
 
-void MeshSmoother::InverseEdgeLengthSmooth(const float scale)
+ITK_THREAD_RETURN_TYPE MeshSmoother::KernelThreaderCallback(void *arg)
 {
-  std::vector<BasicVec3D> displacements(m_MeshDataExt->m_Vertices.size(), BasicVec3D(0, 0, 0));
+  itk::ThreadIdType threadId = ((itk::MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  itk::ThreadIdType threadCount = ((itk::MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+  KernelThreadStruct *str = (KernelThreadStruct *)(((itk::MultiThreader::ThreadInfoStruct *)(arg))->UserData);
 
-  // Get per-vertex displacement.
-  for(size_t i = 0; i < m_MeshDataExt->m_Vertices.size(); i++)
+  try
   {
-    // Skip rogue vertices (which were probably made rogue during a previous
-    // attempt to fix mesh cracks).
-    if(0 ==  m_MeshDataExt->m_VertexToVertexIndices[i].size())
-      continue;
-
-    std::vector<float> weights( m_MeshDataExt->m_VertexToVertexIndices[i].size(), 0.0f);
+    size_t begin = (str->Count * threadId) / threadCount;
+    size_t end = (str->Count * (threadId + 1)) / threadCount;
 
-    // Calculate weights based on inverse edge lengths.
-    for(size_t j = 0; j <  m_MeshDataExt->m_VertexToVertexIndices[i].size(); j++)
+    switch (str->Kernel)
     {
-      size_t neighbour_j =  m_MeshDataExt->m_VertexToVertexIndices[i][j];
-
-      float edge_length = m_MeshDataExt->m_Vertices[i].GetCoords().Distance(m_MeshDataExt->m_Vertices[neighbour_j].GetCoords());
+      case VertexNormalKernel:
+        str->Smoother->GenerateVertexNormals(begin, end);
+        break;
 
-      if(0 == edge_length)
-        edge_length = numeric_limits<float>::epsilon();
+      case TriangleNormalKernel:
+        str->Smoother->GenerateTriangleNormals(begin, end);
+        break;
 
-      weights[j] = 1.0f / edge_length;
+      default:
+        str->AngleErrors[threadId] = str->Smoother->SmoothVertices(str->Kernel, str->Scale, begin, end);
+        break;
     }
+  }
+  catch (std::exception& err)
+  {
+    str->ErrorMessages[threadId] = err.what();
+  }
 
-    // Normalize the weights so that they sum up to 1.
-    float s = 0;
+  return ITK_THREAD_RETURN_VALUE;
+}
 
-    for(size_t j = 0; j < weights.size(); j++)
-      s += weights[j];
+size_t MeshSmoother::RunKernel(KernelType kernel, float scale)
+{
+  KernelThreadStruct str;
+  str.Smoother = this;
+  str.Kernel = kernel;
+  str.Scale = scale;
+  str.Count = (kernel == TriangleNormalKernel) ? m_MeshDataExt->m_Triangles.size() : m_MeshDataExt->m_Vertices.size();
 
-    if(0 == s)
-      s = numeric_limits<float>::epsilon();
+  if(str.Count == 0)
+    return 0;
 
-    for(size_t j = 0; j < weights.size(); j++)
-      weights[j] /= s;
+  int numberOfThreads = static_cast<int>(std::min(static_cast<size_t>(std::max(m_NumberOfThreads, 1)), str.Count));
+  str.AngleErrors.assign(numberOfThreads, 0);
+  str.ErrorMessages.assign(numberOfThreads, std::string());
 
-    // Sum the displacements.
-    for(size_t j = 0; j < m_MeshDataExt->m_VertexToVertexIndices[i].size(); j++)
-    {
-      size_t neighbour_j = m_MeshDataExt->m_VertexToVertexIndices[i][j];
-      displacements[i] += (m_MeshDataExt->m_Vertices[neighbour_j].GetCoords() - m_MeshDataExt->m_Vertices[i].GetCoords())*weights[j];
-    }
+  itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+  threader->SetNumberOfThreads(numberOfThreads);
+  threader->SetSingleMethod(KernelThreaderCallback, &str);
+  threader->SingleMethodExecute();
+
+  size_t angleErrors = 0;
+
+  for(size_t i = 0; i < str.ErrorMessages.size(); i++)
+  {
+    if(str.ErrorMessages[i].size() > 0)
+      mitkThrow() << "MeshSmoother: failed on one of the threads: " << str.ErrorMessages[i];
+
+    angleErrors += str.AngleErrors[i];
   }
 
-  // Apply per-vertex displacement.
-  for(size_t i = 0; i < m_MeshDataExt->m_Vertices.size(); i++)
-    m_MeshDataExt->m_Vertices[i].SetCoords(m_MeshDataExt->m_Vertices[i].GetCoords() + displacements[i]*scale);
+  return angleErrors;
 }
 
-void MeshSmoother::CurvatureNormalSmooth(const float scale)
+size_t MeshSmoother::SmoothVertices(KernelType kernel, float scale, size_t begin, size_t end)
 {
-  std::vector<BasicVec3D> displacements(m_MeshDataExt->m_Vertices.size(), BasicVec3D(0, 0, 0));
+  const std::vector<BasicVec3D> &positions = m_CurrentPositions;
+  size_t angleErrors = 0;
 
-  // Get per-vertex displacement.
-  for(size_t i = 0; i < m_MeshDataExt->m_Vertices.size(); i++)
+  for(size_t i = begin; i < end; i++)
   {
-    if(0 == m_MeshDataExt->m_VertexToVertexIndices[i].size())
-      continue;
+    const size_t firstNeighbour = m_VertexNeighbourOffsets[i];
+    const size_t lastNeighbour  = m_VertexNeighbourOffsets[i + 1];
 
-    std::vector<float> weights(m_MeshDataExt->m_VertexToVertexIndices[i].size(), 0.0f);
+    // Skip rogue vertices (which were probably made rogue during a previous
+    // attempt to fix mesh cracks).
+    if(firstNeighbour == lastNeighbour)
+    {
+      m_NextPositions[i] = positions[i];
+      continue;
+    }
 
+    // The displacement is the weighted mean of the edge vectors, so the weights
+    // are summed up and divided out at the end.
+    BasicVec3D displacement(0, 0, 0);
+    float s = 0;
     size_t angle_error = 0;
 
-    // For each vertex pair (ie. each edge),
-    // calculate weight based on the two opposing angles (ie. curvature normal scheme).
-    for(size_t j = 0; j < m_MeshDataExt->m_VertexToVertexIndices[i].size(); j++)
+    for(size_t j = firstNeighbour; j < lastNeighbour; j++)
     {
-      size_t angle_count = 0;
-
-      size_t neighbour_j = m_MeshDataExt->m_VertexToVertexIndices[i][j];
+      const size_t neighbour_j = m_VertexNeighbours[j];
+      float weight = 0;
 
-      // Find out which two triangles are shared by the edge.
-      for(size_t k = 0; k < m_MeshDataExt->m_VertexToTriangleIndices[i].size(); k++)
+      switch(kernel)
       {
-        for(size_t l = 0; l < m_MeshDataExt->m_VertexToTriangleIndices[neighbour_j].size(); l++)
+        case LaplaceKernel:
         {
-          size_t tri0_index = m_MeshDataExt->m_VertexToTriangleIndices[i][k];
-          size_t tri1_index = m_MeshDataExt->m_VertexToTriangleIndices[neighbour_j][l];
+          weight = 1;
+        }
+        break;
 
-          // This will occur twice per edge.
-          if(tri0_index == tri1_index)
+        case InverseEdgeLengthKernel:
+        {
+          float edge_length = positions[i].Distance(positions[neighbour_j]);
+
+          if(0 == edge_length)
+            edge_length = numeric_limits<float>::epsilon();
+
+          weight = 1.0f / edge_length;
+        }
+        break;
+
+        case CurvatureNormalKernel:
+        {
+          size_t angle_count = 0;
+
+          // Calculate the weight based on the angles opposite to the edge in the two triangles
+          // that share it (ie. curvature normal scheme).
+          for(size_t k = m_VertexTriangleOffsets[i]; k < m_VertexTriangleOffsets[i + 1]; k++)
           {
+            const BasicTriangle &tri = m_MeshDataExt->m_Triangles[m_VertexTriangles[k]];
+            const int v[3] = {tri.GetVert1Index(), tri.GetVert2Index(), tri.GetVert3Index()};
+
+            if(static_cast<size_t>(v[0]) != neighbour_j && static_cast<size_t>(v[1]) != neighbour_j && static_cast<size_t>(v[2]) != neighbour_j)
+              continue;
+
             // Find the third vertex in this triangle (the vertex that doesn't belong to the edge).
             for(size_t m = 0; m < 3; m++)
             {
-              // This will occur once per triangle.
-              if(m_MeshDataExt->m_Triangles[tri0_index].GetVertIndex(m) != i && m_MeshDataExt->m_Triangles[tri0_index].GetVertIndex(m) != neighbour_j)
+              if(static_cast<size_t>(v[m]) != i && static_cast<size_t>(v[m]) != neighbour_j)
               {
-                size_t opp_vert_index = m_MeshDataExt->m_Triangles[tri0_index].GetVertIndex(m);
-
                 // Get the angle opposite of the edge.
-                BasicVec3D a = m_MeshDataExt->m_Vertices[i].GetCoords() - m_MeshDataExt->m_Vertices[opp_vert_index].GetCoords();
-                BasicVec3D b = m_MeshDataExt->m_Vertices[neighbour_j].GetCoords() - m_MeshDataExt->m_Vertices[opp_vert_index].GetCoords();
+                BasicVec3D a = positions[i] - positions[v[m]];
+                BasicVec3D b = positions[neighbour_j] - positions[v[m]];
                 a.Normalize();
                 b.Normalize();
 
@@ -450,60 +514,126 @@ void MeshSmoother::CurvatureNormalSmooth(const float scale)
                   slope = numeric_limits<float>::epsilon();
 
                 // Note: Some weights will be negative, due to obtuse triangles.
-                // You may wish to do weights[j] += fabsf(1.0f / slope); here.
-                weights[j] += 1.0f / slope;
+                // You may wish to do weight += fabsf(1.0f / slope); here.
+                weight += 1.0f / slope;
 
                 angle_count++;
 
                 break;
               }
             }
-
-            // Since we found a triangle match, we can skip to the first vertex's next triangle.
-            break;
           }
-        }
-      } // End of: Find out which two triangles are shared by the vertex pair.
 
-      if(angle_count != 2)
-        angle_error++;
+          if(angle_count != 2)
+            angle_error++;
+        }
+        break;
 
-    } // End of: For each vertex pair (ie. each edge).
+        default:
+        break;
+      }
 
-    if(angle_error != 0)
-    {
-      MITK_INFO << "Warning: Vertex " << i << " belongs to " << angle_error << " edges that do not belong to two triangles (" << m_MeshDataExt->m_VertexToVertexIndices[i].size() - angle_error << " edges were OK)." << std::endl;
-      MITK_INFO << "Your mesh probably has cracks or holes in it." << std::endl;
+      displacement += (positions[neighbour_j] - positions[i])*weight;
+      s += weight;
     }
 
-    // Normalize the weights so that they sum up to 1.
-    float s = 0;
-
-    // Note: Some weights will be negative, due to obtuse triangles.
-    // You may wish to do s += fabsf(weights[j]); here.
-    for(size_t j = 0; j < weights.size(); j++)
-      s += weights[j];
+    if(angle_error != 0)
+      angleErrors++;
 
     if(0 == s)
       s = numeric_limits<float>::epsilon();
 
-    for(size_t j = 0; j < weights.size(); j++)
-      weights[j] /= s;
+    m_NextPositions[i] = positions[i] + displacement*(scale / s);
+  }
+
+  return angleErrors;
+}
 
-    // Sum the displacements.
-    for(size_t j = 0; j < m_MeshDataExt->m_VertexToVertexIndices[i].size(); j++)
-    {
-      size_t neighbour_j = m_MeshDataExt->m_VertexToVertexIndices[i][j];
+void MeshSmoother::SmoothStep(KernelType kernel, const float scale)
+{
+  size_t angleErrors = RunKernel(kernel, scale);
 
-      displacements[i] += (m_MeshDataExt->m_Vertices[neighbour_j].GetCoords() - m_MeshDataExt->m_Vertices[i].GetCoords())*weights[j];
-    }
+  if(angleErrors != 0)
+  {
+    MITK_INFO << "Warning: " << angleErrors << " vertices belong to edges that do not belong to two triangles." << std::endl;
+    MITK_INFO << "Your mesh probably has cracks or holes in it." << std::endl;
   }
 
-  // To do: Find out why there are cases where displacement is much, much, much larger than all edge lengths put together.
+  m_CurrentPositions.swap(m_NextPositions);
+}
+
+// This produces results that are practically identical to Meshlab
+void MeshSmoother::LaplaceSmooth(const float scale)
+{
+  SmoothStep(LaplaceKernel, scale);
+}
+
+void MeshSmoother::TaubinSmooth(const float lambda, const float mu, const size_t steps)
+{
+  // Sanity check
+  if (m_MeshDataExt == 0)
+  {
+    MITK_ERROR <<"Invalid data pointer, MeshSmoother wasn't initialized properly!";
+    return;
+  }
+
+  if(!m_ConnectivityIsValid)
+    BuildConnectivity();
+
+  // The steps move the vertices between two position buffers, which are only
+  // copied from and back to the mesh once.
+  m_CurrentPositions.resize(m_MeshDataExt->m_Vertices.size());
+  m_NextPositions.resize(m_MeshDataExt->m_Vertices.size());
 
-  // Apply per-vertex displacement.
   for(size_t i = 0; i < m_MeshDataExt->m_Vertices.size(); i++)
-    m_MeshDataExt->m_Vertices[i].SetCoords(m_MeshDataExt->m_Vertices[i].GetCoords() + displacements[i]*scale);
+    m_CurrentPositions[i] = m_MeshDataExt->m_Vertices[i].GetCoords();
+
+  switch (m_SmoothingMethod)
+  {
+    case 0:
+      for(size_t s = 0; s < steps; s++)
+      {
+        LaplaceSmooth(lambda);
+        LaplaceSmooth(mu);
+      }
+      break;
+
+    case 1:
+      for(size_t s = 0; s < steps; s++)
+      {
+        CurvatureNormalSmooth(lambda);
+        CurvatureNormalSmooth(mu);
+      }
+      break;
+
+    case 2:
+      for(size_t s = 0; s < steps; s++)
+      {
+        InverseEdgeLengthSmooth(lambda);
+        InverseEdgeLengthSmooth(mu);
+      }
+      break;
+  }
+
+  for(size_t i = 0; i < m_MeshDataExt->m_Vertices.size(); i++)
+    m_MeshDataExt->m_Vertices[i].SetCoords(m_CurrentPositions[i]);
+
+  std::vector<BasicVec3D>().swap(m_CurrentPositions);
+  std::vector<BasicVec3D>().swap(m_NextPositions);
+
+  // Recalculate normals, if necessary.
+  //RegenerateVertexAndTriangleNormalsIfExists();
+}
+
+void MeshSmoother::InverseEdgeLengthSmooth(const float scale)
+{
+  SmoothStep(InverseEdgeLengthKernel, scale);
+}
+
+void MeshSmoother::CurvatureNormalSmooth(const float scale)
+{
+  // To do: Find out why there are cases where displacement is much, much, much larger than all edge lengths put together.
+  SmoothStep(CurvatureNormalKernel, scale);
 }
 
 void MeshSmoother::SetMaxExtent(float max_extent)
@@ -572,22 +702,31 @@ void MeshSmoother::GenerateVertexNormals(void)
   if(m_MeshDataExt->m_Triangles.size() == 0 || m_MeshDataExt->m_Vertices.size() == 0)
     return;
 
+  if(!m_ConnectivityIsValid)
+    BuildConnectivity();
+
   m_VertexNormals.clear();
   m_VertexNormals.resize(m_MeshDataExt->m_Vertices.size());
 
-  for(size_t i = 0; i < m_MeshDataExt->m_Triangles.size(); i++)
+  RunKernel(VertexNormalKernel);
+}
+
+void MeshSmoother::GenerateVertexNormals(size_t begin, size_t end)
+{
+  for(size_t i = begin; i < end; i++)
   {
-    BasicVec3D v0 = m_MeshDataExt->m_Vertices[m_MeshDataExt->m_Triangles[i].GetVert2Index()].GetCoords() - m_MeshDataExt->m_Vertices[m_MeshDataExt->m_Triangles[i].GetVert1Index()].GetCoords();
-    BasicVec3D v1 = m_MeshDataExt->m_Vertices[m_MeshDataExt->m_Triangles[i].GetVert3Index()].GetCoords() - m_MeshDataExt->m_Vertices[m_MeshDataExt->m_Triangles[i].GetVert1Index()].GetCoords();
-    BasicVec3D v2 = v0.Cross(v1);
+    // Sum the (area weighted) normals of the triangles of the vertex.
+    for(size_t j = m_VertexTriangleOffsets[i]; j < m_VertexTriangleOffsets[i + 1]; j++)
+    {
+      const BasicTriangle &tri = m_MeshDataExt->m_Triangles[m_VertexTriangles[j]];
 
-    m_VertexNormals[m_MeshDataExt->m_Triangles[i].GetVert1Index()] = m_VertexNormals[m_MeshDataExt->m_Triangles[i].GetVert1Index()] + v2;
-    m_VertexNormals[m_MeshDataExt->m_Triangles[i].GetVert2Index()] = m_VertexNormals[m_MeshDataExt->m_Triangles[i].GetVert2Index()] + v2;
-    m_VertexNormals[m_MeshDataExt->m_Triangles[i].GetVert3Index()] = m_VertexNormals[m_MeshDataExt->m_Triangles[i].GetVert3Index()] + v2;
-  }
+      BasicVec3D v0 = m_MeshDataExt->m_Vertices[tri.GetVert2Index()].GetCoords() - m_MeshDataExt->m_Vertices[tri.GetVert1Index()].GetCoords();
+      BasicVec3D v1 = m_MeshDataExt->m_Vertices[tri.GetVert3Index()].GetCoords() - m_MeshDataExt->m_Vertices[tri.GetVert1Index()].GetCoords();
+      BasicVec3D v2 = v0.Cross(v1);
+
+      m_VertexNormals[i] = m_VertexNormals[i] + v2;
+    }
 
-  for(size_t i = 0; i < m_VertexNormals.size(); i++)
-  {
     m_VertexNormals[i].Normalize();
 
     // Sometimes we must invert the normals
@@ -614,14 +753,18 @@ void MeshSmoother::GenerateTriangleNormals(void)
   m_TriangleNormals.clear();
   m_TriangleNormals.resize(m_MeshDataExt->m_Triangles.size());
 
-  for(size_t i = 0; i < m_MeshDataExt->m_Triangles.size(); i++)
+  RunKernel(TriangleNormalKernel);
+}
+
+void MeshSmoother::GenerateTriangleNormals(size_t begin, size_t end)
+{
+  for(size_t i = begin; i < end; i++)
   {
-    // Create a temporary triangle
-    BasicTriangle tmpTriangle(m_MeshDataExt->m_Triangles[i]);
+    BasicTriangle &tri = m_MeshDataExt->m_Triangles[i];
 
-    BasicVec3D vert1 = m_MeshDataExt->m_Vertices[m_MeshDataExt->m_Triangles[i].GetVert1Index()].GetCoords();
-    BasicVec3D vert2 = m_MeshDataExt->m_Vertices[m_MeshDataExt->m_Triangles[i].GetVert2Index()].GetCoords();
-    BasicVec3D vert3 = m_MeshDataExt->m_Vertices[m_MeshDataExt->m_Triangles[i].GetVert3Index()].GetCoords();
+    BasicVec3D vert1 = m_MeshDataExt->m_Vertices[tri.GetVert1Index()].GetCoords();
+    BasicVec3D vert2 = m_MeshDataExt->m_Vertices[tri.GetVert2Index()].GetCoords();
+    BasicVec3D vert3 = m_MeshDataExt->m_Vertices[tri.GetVert3Index()].GetCoords();
 
     BasicVec3D vec0 = vert2 - vert1;
     BasicVec3D vec1 = vert3 - vert1;
@@ -629,22 +772,20 @@ void MeshSmoother::GenerateTriangleNormals(void)
 
     if (m_FlipNormals)
     {
-      tmpTriangle.SetTriNormalX(m_MeshDataExt->m_Triangles[i].GetTriNormalX() - m_TriangleNormals[i].GetX());
-      tmpTriangle.SetTriNormalY(m_MeshDataExt->m_Triangles[i].GetTriNormalY() - m_TriangleNormals[i].GetY());
-      tmpTriangle.SetTriNormalZ(m_MeshDataExt->m_Triangles[i].GetTriNormalZ() - m_TriangleNormals[i].GetZ());
+      tri.SetTriNormalX(tri.GetTriNormalX() - m_TriangleNormals[i].GetX());
+      tri.SetTriNormalY(tri.GetTriNormalY() - m_TriangleNormals[i].GetY());
+      tri.SetTriNormalZ(tri.GetTriNormalZ() - m_TriangleNormals[i].GetZ());
     }
     else
     {
-      tmpTriangle.SetTriNormalX(m_TriangleNormals[i].GetX());
-      tmpTriangle.SetTriNormalY(m_TriangleNormals[i].GetY());
-      tmpTriangle.SetTriNormalZ(m_TriangleNormals[i].GetZ());
+      tri.SetTriNormalX(m_TriangleNormals[i].GetX());
+      tri.SetTriNormalY(m_TriangleNormals[i].GetY());
+      tri.SetTriNormalZ(m_TriangleNormals[i].GetZ());
     }
 
     // This is the "d" from the plane equation ax + by + cz + d = 0;
-    float dParam = -(tmpTriangle.GetTriNormal().Dot(vert1));
-    tmpTriangle.SetDParam(dParam);
-
-    m_MeshDataExt->m_Triangles.operator[](i) = tmpTriangle;
+    float dParam = -(tri.GetTriNormal().Dot(vert1));
+    tri.SetDParam(dParam);
   }
 }
 
@@ -857,6 +998,9 @@ bool MeshSmoother::MergeVertexPair(const size_t keeper, const size_t goner)
   if(keeper == goner)
     return true;
 
+  // The triangles are about to change.
+  m_ConnectivityIsValid = false;
+
   // Merge vertex to triangle data.
 
   // Add goner's vertex to triangle data to keeper's triangle to vertex data,
@@ -913,4 +1057,30 @@ bool MeshSmoother::MergeVertexPair(const size_t keeper, const size_t goner)
   return true;
 }
 
+
+void CreateBumpySphere(int size, real bumps, std::vector<real>& data)
+{
+  data.resize(static_cast<size_t>(size) * size * size);
+
+  double centre = (size - 1) / 2.0;
+  double radius = 0.4 * (size - 1);
+
+  for (int k = 0; k < size; k++)
+  {
+    for (int j = 0; j < size; j++)
+    {
+      for (int i = 0; i < size; i++)
+      {
+        double x = i - centre;
+        double y = j - centre;
+        double z = k - centre;
+        double r = std::sqrt(x * x + y * y + z * z);
+        double bump = bumps * radius * std::sin(0.9 * x) * std::sin(1.1 * y) * std::sin(0.7 * z);
+
+        data[i + size * (j + static_cast<size_t>(size) * k)] = static_cast<real>(radius + bump - r);
+      }
+    }
+  }
+}
+
 }
@@ -17,7 +17,10 @@
 
 #include <mitkLogMacros.h>
 
+#include <itkMultiThreader.h>
+
 #include <iostream>
+#include <string>
 #include <vector>
 #include "niftkBasicVertex.h"
 #include "niftkBasicTriangle.h"
@@ -142,6 +145,13 @@ public:
 * \class MeshSmoother
 * \brief This class implements various mesh smoothing algorithms and it can be used to
 * (re)compute surface and vertex normals of a BasicMesh structure.
+*
+* The smoothing and normal computations use their own vertex to vertex and vertex to triangle
+* connectivity, built from the triangles in compressed form (an array of offsets into one array
+* of indices per relation), rather than the per-vertex vectors of MeshData. It is built once and
+* kept until the triangles change. Both are run on several threads, each on a range of vertices
+* or triangles. The smoothing steps read the positions from one buffer and write them into
+* another, so that no vertex sees the new position of its neighbours within a step.
 */
 
 class NIFTKCORE_EXPORT MeshSmoother
@@ -185,7 +195,54 @@ public:
   /// \brief Get the flip normals flag
   inline bool GetFlipNormals(void) { return m_FlipNormals; }
 
+  /// \brief Set the number of threads used for smoothing and normal computation, defaulting to the ITK global default
+  inline void SetNumberOfThreads(int val) { m_NumberOfThreads = val; }
+  /// \brief Get the number of threads used for smoothing and normal computation
+  inline int GetNumberOfThreads(void) { return m_NumberOfThreads; }
+
+  /// \brief Builds the compressed vertex to vertex and vertex to triangle connectivity from the triangles.
+  /// The smoothing and normal methods call it when the triangles have changed since it was last built.
+  void BuildConnectivity(void);
+
 private:
+  /// \brief The per-vertex or per-triangle operations that are run on several threads
+  enum KernelType
+  {
+    LaplaceKernel,
+    InverseEdgeLengthKernel,
+    CurvatureNormalKernel,
+    VertexNormalKernel,
+    TriangleNormalKernel
+  };
+
+  /// \brief Thread data for RunKernel()
+  struct KernelThreadStruct
+  {
+    MeshSmoother             *Smoother;
+    KernelType                Kernel;
+    float                     Scale;
+    size_t                    Count;
+    std::vector<size_t>       AngleErrors;
+    std::vector<std::string>  ErrorMessages;
+  };
+
+  /// \brief Runs a kernel over a range of the vertices or triangles, depending on the thread
+  static ITK_THREAD_RETURN_TYPE KernelThreaderCallback(void *arg);
+
+  /// \brief Runs a kernel over all the vertices or triangles, on several threads
+  size_t RunKernel(KernelType kernel, float scale = 0);
+
+  /// \brief Moves the vertices in [begin, end) from the current positions to the next positions
+  /// \return The number of vertices with an edge that does not belong to two triangles (only counted by the curvature normal kernel)
+  size_t SmoothVertices(KernelType kernel, float scale, size_t begin, size_t end);
+  /// \brief Computes the normals of the vertices in [begin, end)
+  void GenerateVertexNormals(size_t begin, size_t end);
+  /// \brief Computes the normals of the triangles in [begin, end)
+  void GenerateTriangleNormals(size_t begin, size_t end);
+
+  /// \brief Runs one smoothing step with the given kernel, then swaps the position buffers
+  void SmoothStep(KernelType kernel, const float scale);
+
   /// \brief Implements "Laplacian" mesh smoothing algorithm
   void LaplaceSmooth(const float scale);
   /// \brief Implements "Curvature Normal" mesh smoothing algorithm
@@ -208,6 +265,16 @@ private:
 private:
   int  m_SmoothingMethod; // Stores which smoothing method to use
   bool m_FlipNormals;     // Flag to indicate wether we need to flip the normals
+  int  m_NumberOfThreads; // Number of threads for smoothing and normal computation
+
+  bool                      m_ConnectivityIsValid;   // true if the compressed connectivity matches the triangles
+  std::vector<size_t>       m_VertexNeighbourOffsets; // start of the neighbours of each vertex in m_VertexNeighbours, plus the end
+  std::vector<size_t>       m_VertexNeighbours;       // neighbours of all the vertices, sorted per vertex
+  std::vector<size_t>       m_VertexTriangleOffsets;  // start of the triangles of each vertex in m_VertexTriangles, plus the end
+  std::vector<size_t>       m_VertexTriangles;        // triangles of all the vertices, in triangle order per vertex
+
+  std::vector<BasicVec3D>   m_CurrentPositions;  // vertex positions read by a smoothing step
+  std::vector<BasicVec3D>   m_NextPositions;     // vertex positions written by a smoothing step
 
   std::vector<BasicVec3D>   m_VertexNormals;   // stores all vertex normals
   std::vector<BasicVec3D>   m_TriangleNormals; // stores all triangle normals
@@ -215,6 +282,14 @@ private:
   MeshData* m_MeshDataExt;  // pointer to the externally created container
 };
 
+/**
+* \brief Fills a size x size x size grid, x fastest, with a sphere with bumps on it, for testing and
+* benchmarking the extraction and smoothing of surfaces. The values are positive inside the sphere and
+* negative outside, so the sphere is the zero iso-surface. It is centred on the middle of the grid, with
+* radius 0.4 * (size - 1), and the bumps are at most bumps * radius.
+*/
+NIFTKCORE_EXPORT void CreateBumpySphere(int size, real bumps, std::vector<real>& data);
+
 }
 
 #endif
@@ -0,0 +1,241 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#include "niftkParallelCMC33.h"
+
+#include <algorithm>
+#include <exception>
+
+#include <mitkExceptionMacro.h>
+
+namespace niftk
+{
+
+//-----------------------------------------------------------------------------
+ParallelCMC33::ParallelCMC33(const int size_x, const int size_y, const int size_z)
+: _originalMC(false)
+, _computeNormals(false)
+, _size_x(size_x)
+, _size_y(size_y)
+, _size_z(size_z)
+, _data(NULL)
+, _block_size(8)
+, _number_of_threads(itk::MultiThreader::GetGlobalDefaultNumberOfThreads())
+, m_MeshDataExt(NULL)
+{
+}
+
+
+//-----------------------------------------------------------------------------
+ParallelCMC33::~ParallelCMC33()
+{
+}
+
+
+//-----------------------------------------------------------------------------
+void ParallelCMC33::run(real iso)
+{
+  if (m_MeshDataExt == NULL || _data == NULL)
+  {
+    mitkThrow() << "ParallelCMC33: the input and output data must be set before running.";
+  }
+
+  // Each slab has at least one layer of cubes.
+  int numberOfSlabs = std::max(1, std::min(_number_of_threads, _size_z - 1));
+
+  std::vector<CMC33 *> slabs(numberOfSlabs);
+  std::vector<MeshData> slabMeshes(numberOfSlabs);
+
+  for (int s = 0; s < numberOfSlabs; s++)
+  {
+    int k_begin = ((_size_z - 1) * s) / numberOfSlabs;
+    int k_end = ((_size_z - 1) * (s + 1)) / numberOfSlabs;
+
+    slabs[s] = new CMC33(_size_x, _size_y, _size_z);
+    slabs[s]->set_method(_originalMC);
+    slabs[s]->set_input_data(_data);
+    slabs[s]->set_output_data(numberOfSlabs == 1 ? m_MeshDataExt : &slabMeshes[s]);
+    slabs[s]->enable_normal_computing(_computeNormals);
+    slabs[s]->set_block_size(_block_size);
+    slabs[s]->set_slab(k_begin, k_end);
+  }
+
+  SlabThreadStruct str;
+  str.Iso = iso;
+  str.Slabs = &slabs;
+  str.ErrorMessages.assign(numberOfSlabs, std::string());
+
+  itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+  threader->SetNumberOfThreads(numberOfSlabs);
+  threader->SetSingleMethod(SlabThreaderCallback, &str);
+  threader->SingleMethodExecute();
+
+  std::string errorMessage;
+  for (unsigned int i = 0; i < str.ErrorMessages.size(); i++)
+  {
+    if (str.ErrorMessages[i].size() > 0)
+    {
+      errorMessage = str.ErrorMessages[i];
+      break;
+    }
+  }
+
+  if (errorMessage.empty() && numberOfSlabs > 1)
+  {
+    m_MeshDataExt->m_Vertices.clear();
+    m_MeshDataExt->m_Triangles.clear();
+    m_MeshDataExt->m_VertexToTriangleIndices.clear();
+    m_MeshDataExt->m_VertexToVertexIndices.clear();
+
+    std::vector<int> previousToOutput;
+    std::vector<int> slabToOutput;
+
+    for (int s = 0; s < numberOfSlabs; s++)
+    {
+      this->append_slab(s > 0 ? slabs[s - 1] : NULL, slabs[s], slabMeshes[s], previousToOutput, slabToOutput);
+      previousToOutput.swap(slabToOutput);
+
+      // The slab below is no longer needed.
+      if (s > 0)
+      {
+        delete slabs[s - 1];
+        slabs[s - 1] = NULL;
+        std::vector<BasicVertex>().swap(slabMeshes[s - 1].m_Vertices);
+        std::vector<BasicTriangle>().swap(slabMeshes[s - 1].m_Triangles);
+        std::vector< std::vector<size_t> >().swap(slabMeshes[s - 1].m_VertexToTriangleIndices);
+        std::vector< std::vector<size_t> >().swap(slabMeshes[s - 1].m_VertexToVertexIndices);
+      }
+    }
+  }
+
+  for (int s = 0; s < numberOfSlabs; s++)
+  {
+    delete slabs[s];
+  }
+
+  if (!errorMessage.empty())
+  {
+    mitkThrow() << "ParallelCMC33: failed to extract the isosurface: " << errorMessage;
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+ITK_THREAD_RETURN_TYPE ParallelCMC33::SlabThreaderCallback(void *arg)
+{
+  itk::ThreadIdType threadId = ((itk::MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  itk::ThreadIdType threadCount = ((itk::MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+  SlabThreadStruct *str = (SlabThreadStruct *)(((itk::MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  // The threader may run fewer threads than there are slabs.
+  for (unsigned int s = threadId; s < str->Slabs->size(); s += threadCount)
+  {
+    try
+    {
+      CMC33 *slab = (*(str->Slabs))[s];
+      slab->init_all();
+      slab->extract(str->Iso);
+    }
+    catch (std::exception& err)
+    {
+      str->ErrorMessages[s] = err.what();
+    }
+  }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+
+//-----------------------------------------------------------------------------
+void ParallelCMC33::append_slab(const CMC33 * previous, const CMC33 * slab, const MeshData & mesh,
+                                const std::vector<int> & previous_to_output, std::vector<int> & slab_to_output)
+{
+  MeshData & output = *m_MeshDataExt;
+
+  slab_to_output.assign(mesh.m_Vertices.size(), -1);
+
+  // The vertices on the first plane of the slab were also generated by the slab below.
+  if (previous != NULL)
+  {
+    int k = slab->k_begin();
+
+    for (int j = 0; j < _size_y; j++)
+    {
+      for (int i = 0; i < _size_x; i++)
+      {
+        int v = slab->get_x_vert(i, j, k);
+        int pv = previous->get_x_vert(i, j, k);
+        if (v != -1 && pv != -1)
+        {
+          slab_to_output[v] = previous_to_output[pv];
+        }
+
+        v = slab->get_y_vert(i, j, k);
+        pv = previous->get_y_vert(i, j, k);
+        if (v != -1 && pv != -1)
+        {
+          slab_to_output[v] = previous_to_output[pv];
+        }
+      }
+    }
+  }
+
+  for (size_t v = 0; v < mesh.m_Vertices.size(); v++)
+  {
+    if (slab_to_output[v] == -1)
+    {
+      slab_to_output[v] = static_cast<int>(output.m_Vertices.size());
+
+      output.m_Vertices.push_back(mesh.m_Vertices[v]);
+      output.m_Vertices.back().SetIndex(slab_to_output[v]);
+      output.m_VertexToTriangleIndices.push_back(std::vector<size_t>());
+      output.m_VertexToVertexIndices.push_back(std::vector<size_t>());
+    }
+  }
+
+  size_t firstTriangle = output.m_Triangles.size();
+
+  for (size_t t = 0; t < mesh.m_Triangles.size(); t++)
+  {
+    output.m_Triangles.push_back(mesh.m_Triangles[t]);
+
+    BasicTriangle &tri = output.m_Triangles.back();
+    tri.SetIndex(static_cast<int>(firstTriangle + t));
+    tri.SetVert1Index(slab_to_output[tri.GetVert1Index()]);
+    tri.SetVert2Index(slab_to_output[tri.GetVert2Index()]);
+    tri.SetVert3Index(slab_to_output[tri.GetVert3Index()]);
+  }
+
+  // The connectivity of the shared vertices is the union of that in both slabs.
+  for (size_t v = 0; v < mesh.m_Vertices.size(); v++)
+  {
+    std::vector<size_t> &triangles = output.m_VertexToTriangleIndices[slab_to_output[v]];
+    for (size_t t = 0; t < mesh.m_VertexToTriangleIndices[v].size(); t++)
+    {
+      triangles.push_back(firstTriangle + mesh.m_VertexToTriangleIndices[v][t]);
+    }
+
+    std::vector<size_t> &neighbours = output.m_VertexToVertexIndices[slab_to_output[v]];
+    for (size_t n = 0; n < mesh.m_VertexToVertexIndices[v].size(); n++)
+    {
+      size_t neighbour = slab_to_output[mesh.m_VertexToVertexIndices[v][n]];
+      if (std::find(neighbours.begin(), neighbours.end(), neighbour) == neighbours.end())
+      {
+        neighbours.push_back(neighbour);
+      }
+    }
+  }
+}
+
+}
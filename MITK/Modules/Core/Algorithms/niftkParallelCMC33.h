@@ -0,0 +1,117 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#ifndef niftkParallelCMC33_h
+#define niftkParallelCMC33_h
+
+#include "niftkCoreExports.h"
+
+#include <string>
+#include <vector>
+
+#include <itkMultiThreader.h>
+
+#include "niftkCMC33.h"
+
+namespace niftk
+{
+
+/**
+* \class ParallelCMC33
+* \brief Runs the CMC33 algorithm on several threads, by splitting the grid into slabs along its height.
+*
+* Each thread extracts the isosurface of one slab into its own mesh with its own CMC33 instance.
+* Neighbouring slabs share a grid plane, and the vertices on that plane are generated by both of
+* them from the same grid values, so they are identical. When the slab meshes are concatenated,
+* the vertices of the first plane of each slab are replaced by those of the slab below, so the
+* output mesh has no duplicate vertices and stays closed across the slab boundaries.
+*/
+class NIFTKCORE_EXPORT ParallelCMC33
+{
+public :
+  /**
+  * \brief constructor
+  * \param size_x width  of the grid
+  * \param size_y depth  of the grid
+  * \param size_z height of the grid
+  */
+  ParallelCMC33( const int size_x, const int size_y, const int size_z );
+  /** Destructor */
+  ~ParallelCMC33();
+
+  /** selects wether the algorithm will use the enhanced topologically controlled lookup table or the original MarchingCubes */
+  inline void set_method( const bool originalMC = false ) { _originalMC = originalMC; }
+
+  /** selects the data, allocated as a size_x*size_y*size_z vector running in x first, which is only read */
+  inline void set_input_data( real *data ) { _data = data; }
+
+  /** sets the mesh that the output is written to */
+  inline void set_output_data( MeshData * meshData ) { m_MeshDataExt = meshData; }
+
+  /** turns normal computing on / off */
+  inline void enable_normal_computing( bool value ) { _computeNormals = value; }
+
+  /** sets the width of the blocks of cubes that are skipped if the isosurface does not cross them, 0 for none */
+  inline void set_block_size( const int block_size ) { _block_size = block_size; }
+
+  /** sets the number of threads, and hence of slabs, defaulting to the ITK global default */
+  inline void set_number_of_threads( const int number_of_threads ) { _number_of_threads = number_of_threads; }
+  /** accesses the number of threads */
+  inline const int number_of_threads() const { return _number_of_threads; }
+
+  /**
+  * Extracts the isosurface into the output mesh, replacing its contents. Throws mitk::Exception if any of the threads failed.
+  * \param iso isovalue
+  */
+  void run( real iso = (real)0.0 );
+
+protected :
+
+  /** Thread data for run(). */
+  struct SlabThreadStruct
+  {
+    real                           Iso;
+    std::vector<CMC33 *>          *Slabs;
+    std::vector<std::string>       ErrorMessages;
+  };
+
+  /** Extracts the isosurface of the slabs assigned to one thread. */
+  static ITK_THREAD_RETURN_TYPE SlabThreaderCallback( void *arg );
+
+  /**
+  * Appends the mesh of a slab to the output, reusing the output vertices on the first plane of the slab
+  * \param previous           the extractor of the slab below, or NULL for the first slab
+  * \param slab               the extractor of the slab to append
+  * \param mesh               the mesh of the slab to append
+  * \param previous_to_output the output index of each vertex of the slab below
+  * \param slab_to_output     set to the output index of each vertex of the slab
+  */
+  void append_slab( const CMC33 * previous, const CMC33 * slab, const MeshData & mesh,
+                    const std::vector<int> & previous_to_output, std::vector<int> & slab_to_output );
+
+  bool        _originalMC;      /**< selects wether the algorithm will use the original MarchingCubes lookup table */
+  bool        _computeNormals;  /**< selects wether to compute normals or not */
+  int         _size_x;          /**< width  of the grid */
+  int         _size_y;          /**< depth  of the grid */
+  int         _size_z;          /**< height of the grid */
+  real       *_data;            /**< implicit function values sampled on the grid */
+  int         _block_size;      /**< width of the blocks of cubes that can be skipped */
+  int         _number_of_threads; /**< number of threads and slabs */
+
+  MeshData   *m_MeshDataExt;    /**< externally allocated data structure that receives the mesh */
+};
+
+}
+
+#endif
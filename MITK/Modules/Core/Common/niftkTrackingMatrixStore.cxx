@@ -0,0 +1,379 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#include "niftkTrackingMatrixStore.h"
+#include <mitkExceptionMacro.h>
+#include <mitkLogMacros.h>
+#include <QDir>
+#include <QFileInfo>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace niftk
+{
+
+const char* const TrackingMatrixStore::FileName = "TrackingMatrices.bin";
+
+namespace
+{
+
+const char         Magic[8] = { 'N', 'I', 'F', 'T', 'K', 'T', 'M', 'S' };
+const unsigned int Version = 1;
+
+/** Fixed size header at the start of the file, which is TrackingMatrixStore::HeaderSize bytes. */
+struct TrackingMatrixStoreHeader
+{
+  char               Magic[8];
+  unsigned int       Version;
+  unsigned int       HeaderSize;
+  unsigned long long NumberOfMatrices;
+  unsigned long long Reserved;
+};
+
+static_assert(sizeof(TrackingMatrixStoreHeader) == TrackingMatrixStore::HeaderSize,
+              "The tracking matrix store header must be packed into HeaderSize bytes.");
+
+
+//-----------------------------------------------------------------------------
+/// Returns true, and the time stamp, if fileName is <19 digits>.txt.
+bool ExtractTimeStamp(const QString& fileName, TrackingMatrixStore::TimeStampType& timeStamp)
+{
+  if (fileName.length() != 19 + 4 || !fileName.endsWith(".txt"))
+  {
+    return false;
+  }
+
+  QString middle = fileName.mid(0, 19);
+  for (int i = 0; i < middle.length(); i++)
+  {
+    if (!middle[i].isDigit())
+    {
+      return false;
+    }
+  }
+
+  bool ok = false;
+  timeStamp = middle.toULongLong(&ok);
+  return ok;
+}
+
+} // end anonymous namespace
+
+
+//-----------------------------------------------------------------------------
+std::string TrackingMatrixStore::GetFileNameInDirectory(const std::string& directory)
+{
+  return QDir(QString::fromStdString(directory)).filePath(FileName).toStdString();
+}
+
+
+//-----------------------------------------------------------------------------
+bool TrackingMatrixStore::IsInDirectory(const std::string& directory)
+{
+  return QFileInfo(QString::fromStdString(GetFileNameInDirectory(directory))).isFile();
+}
+
+
+//-----------------------------------------------------------------------------
+bool TrackingMatrixStore::DirectoryContainsMatrixFiles(const std::string& directory)
+{
+  QDir dir(QString::fromStdString(directory));
+  dir.setNameFilters(QStringList() << "*.txt");
+  dir.setFilter(QDir::Files | QDir::Readable | QDir::NoDotAndDotDot);
+
+  TimeStampType timeStamp;
+  for (QString file: dir.entryList())
+  {
+    if (ExtractTimeStamp(file, timeStamp))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+//-----------------------------------------------------------------------------
+void TrackingMatrixStore::Write(const std::string& fileName,
+                                const std::vector<TimeStampType>& timeStamps,
+                                const std::vector<double>& matrices)
+{
+  if (matrices.size() != 16 * timeStamps.size())
+  {
+    mitkThrow() << "TrackingMatrixStore: " << timeStamps.size() << " time stamps, but "
+                << matrices.size() << " matrix elements, instead of 16 per time stamp.";
+  }
+
+  std::vector<size_t> order(timeStamps.size());
+  for (size_t i = 0; i < order.size(); i++)
+  {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [&timeStamps](const size_t& a, const size_t& b) { return timeStamps[a] < timeStamps[b]; });
+
+  for (size_t i = 1; i < order.size(); i++)
+  {
+    if (timeStamps[order[i]] == timeStamps[order[i - 1]])
+    {
+      mitkThrow() << "TrackingMatrixStore: time stamp " << timeStamps[order[i]] << " is repeated.";
+    }
+  }
+
+  TrackingMatrixStoreHeader header;
+  std::memcpy(header.Magic, Magic, sizeof(Magic));
+  header.Version = Version;
+  header.HeaderSize = HeaderSize;
+  header.NumberOfMatrices = timeStamps.size();
+  header.Reserved = 0;
+
+  // Written next to the final file, and then renamed, so an interrupted conversion
+  // does not leave a truncated store that would be picked up instead of the text files.
+  QString temporaryFileName = QString::fromStdString(fileName) + ".part";
+
+  {
+    std::ofstream ofs(temporaryFileName.toStdString().c_str(), std::ios::binary | std::ios::out | std::ios::trunc);
+    if (!ofs.is_open())
+    {
+      mitkThrow() << "TrackingMatrixStore: failed to open " << temporaryFileName.toStdString() << " for writing.";
+    }
+
+    ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    for (size_t i = 0; i < order.size(); i++)
+    {
+      ofs.write(reinterpret_cast<const char*>(&timeStamps[order[i]]), sizeof(TimeStampType));
+    }
+    for (size_t i = 0; i < order.size(); i++)
+    {
+      ofs.write(reinterpret_cast<const char*>(&matrices[16 * order[i]]), 16 * sizeof(double));
+    }
+
+    ofs.close();
+    if (ofs.fail())
+    {
+      QFile::remove(temporaryFileName);
+      mitkThrow() << "TrackingMatrixStore: failed to write " << temporaryFileName.toStdString();
+    }
+  }
+
+  QFile::remove(QString::fromStdString(fileName));
+  if (!QFile::rename(temporaryFileName, QString::fromStdString(fileName)))
+  {
+    mitkThrow() << "TrackingMatrixStore: failed to rename " << temporaryFileName.toStdString() << " to " << fileName;
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+size_t TrackingMatrixStore::ConvertDirectory(const std::string& directory)
+{
+  QDir dir(QString::fromStdString(directory));
+  dir.setNameFilters(QStringList() << "*.txt");
+  dir.setFilter(QDir::Files | QDir::Readable | QDir::NoDotAndDotDot);
+
+  std::vector<TimeStampType> timeStamps;
+  std::vector<double> matrices;
+
+  TimeStampType timeStamp;
+  for (QString file: dir.entryList())
+  {
+    if (!ExtractTimeStamp(file, timeStamp))
+    {
+      continue;
+    }
+
+    // Parsed the same way as niftk::LoadMatrix4x4FromFile, so the values are identical.
+    std::string matrixFileName = dir.filePath(file).toStdString();
+    std::ifstream ifs(matrixFileName.c_str());
+    if (!ifs.is_open())
+    {
+      mitkThrow() << "TrackingMatrixStore: failed to open " << matrixFileName;
+    }
+
+    double elements[16];
+    for (int i = 0; i < 16; i++)
+    {
+      ifs >> elements[i];
+    }
+    if (ifs.fail())
+    {
+      mitkThrow() << "TrackingMatrixStore: failed to read 16 numbers from " << matrixFileName;
+    }
+
+    timeStamps.push_back(timeStamp);
+    matrices.insert(matrices.end(), elements, elements + 16);
+  }
+
+  if (timeStamps.empty())
+  {
+    mitkThrow() << "TrackingMatrixStore: no <timestamp>.txt tracking matrices in " << directory;
+  }
+
+  std::string fileName = GetFileNameInDirectory(directory);
+  Write(fileName, timeStamps, matrices);
+
+  // Check the round trip, element by element, so the text files can safely be archived.
+  TrackingMatrixStore store(fileName);
+  if (store.GetNumberOfMatrices() != timeStamps.size())
+  {
+    mitkThrow() << "TrackingMatrixStore: wrote " << timeStamps.size() << " matrices to " << fileName
+                << ", but read back " << store.GetNumberOfMatrices();
+  }
+
+  for (size_t i = 0; i < timeStamps.size(); i++)
+  {
+    size_t j = 0;
+    if (!store.FindTimeStamp(timeStamps[i], j)
+        || std::memcmp(store.GetMatrix(j), &matrices[16 * i], 16 * sizeof(double)) != 0)
+    {
+      mitkThrow() << "TrackingMatrixStore: matrix " << timeStamps[i] << " did not read back the same from " << fileName;
+    }
+  }
+
+  MITK_INFO << "TrackingMatrixStore: packed " << timeStamps.size() << " matrices into " << fileName;
+  return timeStamps.size();
+}
+
+
+//-----------------------------------------------------------------------------
+TrackingMatrixStore::TrackingMatrixStore(const std::string& fileName)
+: m_File(QString::fromStdString(fileName))
+, m_NumberOfMatrices(0)
+, m_Data(nullptr)
+, m_TimeStamps(nullptr)
+, m_Matrices(nullptr)
+{
+  if (!m_File.open(QIODevice::ReadOnly))
+  {
+    mitkThrow() << "Failed to open " << fileName << " for reading.";
+  }
+
+  TrackingMatrixStoreHeader header;
+  if (m_File.read(reinterpret_cast<char*>(&header), sizeof(header)) != static_cast<qint64>(sizeof(header)))
+  {
+    mitkThrow() << fileName << " is too short to be a tracking matrix store.";
+  }
+
+  if (std::memcmp(header.Magic, Magic, sizeof(Magic)) != 0)
+  {
+    mitkThrow() << fileName << " does not appear to be a tracking matrix store.";
+  }
+
+  if (header.Version != Version || header.HeaderSize != HeaderSize)
+  {
+    mitkThrow() << fileName << " is version " << header.Version << " of the tracking matrix store, "
+                << "with a header of " << header.HeaderSize << " bytes, but only version " << Version
+                << " is supported.";
+  }
+
+  const qint64 recordSize = sizeof(TimeStampType) + 16 * sizeof(double);
+  if (header.NumberOfMatrices > static_cast<unsigned long long>((m_File.size() - HeaderSize) / recordSize)
+      || m_File.size() != static_cast<qint64>(HeaderSize + header.NumberOfMatrices * recordSize))
+  {
+    mitkThrow() << fileName << " should hold " << header.NumberOfMatrices << " matrices, but is "
+                << m_File.size() << " bytes long.";
+  }
+
+  m_NumberOfMatrices = static_cast<size_t>(header.NumberOfMatrices);
+
+  if (m_NumberOfMatrices > 0)
+  {
+    // Pages are only read from disk as they are touched. The mapping is page aligned,
+    // and all the sections start at multiples of 8 bytes, so they can be used in place.
+    m_Data = m_File.map(0, m_File.size());
+    if (m_Data == nullptr)
+    {
+      mitkThrow() << "Failed to map " << fileName << ", due to:" << m_File.errorString().toStdString();
+    }
+
+    m_TimeStamps = reinterpret_cast<const TimeStampType*>(m_Data + HeaderSize);
+    m_Matrices = reinterpret_cast<const double*>(m_Data + HeaderSize + m_NumberOfMatrices * sizeof(TimeStampType));
+
+    for (size_t i = 1; i < m_NumberOfMatrices; i++)
+    {
+      if (m_TimeStamps[i] <= m_TimeStamps[i - 1])
+      {
+        mitkThrow() << fileName << " is not in strictly increasing time stamp order, at matrix " << i;
+      }
+    }
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+TrackingMatrixStore::~TrackingMatrixStore()
+{
+  if (m_Data != nullptr)
+  {
+    m_File.unmap(m_Data);
+  }
+  m_File.close();
+}
+
+
+//-----------------------------------------------------------------------------
+TrackingMatrixStore::TimeStampType TrackingMatrixStore::GetTimeStamp(const size_t& i) const
+{
+  if (i >= m_NumberOfMatrices)
+  {
+    mitkThrow() << "Matrix " << i << " is out of range, as " << this->GetFileName()
+                << " has " << m_NumberOfMatrices << " matrices.";
+  }
+  return m_TimeStamps[i];
+}
+
+
+//-----------------------------------------------------------------------------
+const double* TrackingMatrixStore::GetMatrix(const size_t& i) const
+{
+  if (i >= m_NumberOfMatrices)
+  {
+    mitkThrow() << "Matrix " << i << " is out of range, as " << this->GetFileName()
+                << " has " << m_NumberOfMatrices << " matrices.";
+  }
+  return m_Matrices + 16 * i;
+}
+
+
+//-----------------------------------------------------------------------------
+void TrackingMatrixStore::GetMatrix(const size_t& i, vtkMatrix4x4& matrix) const
+{
+  const double* elements = this->GetMatrix(i);
+  for (int r = 0; r < 4; r++)
+  {
+    for (int c = 0; c < 4; c++)
+    {
+      matrix.SetElement(r, c, elements[r * 4 + c]);
+    }
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+bool TrackingMatrixStore::FindTimeStamp(const TimeStampType& timeStamp, size_t& i) const
+{
+  const TimeStampType* end = m_TimeStamps + m_NumberOfMatrices;
+  const TimeStampType* found = std::lower_bound(m_TimeStamps, end, timeStamp);
+
+  if (m_NumberOfMatrices == 0 || found == end || *found != timeStamp)
+  {
+    return false;
+  }
+  i = found - m_TimeStamps;
+  return true;
+}
+
+} // end namespace
@@ -0,0 +1,148 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#ifndef niftkTrackingMatrixStore_h
+#define niftkTrackingMatrixStore_h
+
+#include "niftkCoreExports.h"
+
+#include <vtkMatrix4x4.h>
+
+#include <QFile>
+
+#include <string>
+#include <vector>
+
+namespace niftk
+{
+
+/**
+ * \class TrackingMatrixStore
+ * \brief Read-only, memory mapped view of a directory of time stamped tracking matrices,
+ * packed into a single binary file.
+ *
+ * Tracking data are normally saved as one plain text file per time stamp, named
+ * <verbatim>
+ * <19 digit time stamp>.txt
+ * </verbatim>
+ * each holding 4 rows of 4 numbers. ConvertDirectory() packs all of them into one file,
+ * called TrackingMatrixStore::FileName, in the same directory, so that they can be loaded
+ * without opening and parsing thousands of small files. The file is a 32 byte header of
+ * <verbatim>
+ * "NIFTKTMS" version headerSize numberOfMatrices reserved
+ * </verbatim>
+ * (8 characters, two 32 bit and two 64 bit unsigned integers), followed by the time stamps in
+ * increasing order, as 64 bit unsigned integers, followed by the matrices in the same order,
+ * as 16 doubles each, in row-major order. All values are in the byte order of the machine
+ * that wrote them, and are 8 byte aligned, so the file is used as it is mapped, and nothing
+ * is read from disk until it is asked for.
+ *
+ * The matrices are stored as the doubles that the text files are parsed into, so loading
+ * either layout gives exactly the same values.
+ *
+ * Note: All errors should thrown as mitk::Exception or sub-classes thereof.
+ */
+class NIFTKCORE_EXPORT TrackingMatrixStore
+{
+public:
+
+  typedef unsigned long long TimeStampType;
+
+  /**
+  * \brief Name of the packed file, within the directory of tracking matrices.
+  */
+  static const char* const FileName;
+
+  /**
+  * \brief Size in bytes of the header.
+  */
+  static const unsigned int HeaderSize = 32;
+
+  /**
+  * \brief Returns the name of the packed file in directory, whether it exists or not.
+  */
+  static std::string GetFileNameInDirectory(const std::string& directory);
+
+  /**
+  * \brief Returns true if directory contains a packed file.
+  */
+  static bool IsInDirectory(const std::string& directory);
+
+  /**
+  * \brief Returns true if directory contains any <timestamp>.txt tracking matrices.
+  */
+  static bool DirectoryContainsMatrixFiles(const std::string& directory);
+
+  /**
+  * \brief Writes time stamps and matrices, 16 doubles per time stamp in row-major order,
+  * to fileName, sorting them by time stamp. Throws mitk::Exception if a time stamp is
+  * repeated, or the file can't be written.
+  */
+  static void Write(const std::string& fileName,
+                    const std::vector<TimeStampType>& timeStamps,
+                    const std::vector<double>& matrices);
+
+  /**
+  * \brief Packs the <timestamp>.txt matrices in directory into GetFileNameInDirectory(directory),
+  * and checks that the packed file reads back the same values, throwing mitk::Exception if any
+  * file can't be parsed. The text files are left as they are.
+  * \return the number of matrices packed
+  */
+  static size_t ConvertDirectory(const std::string& directory);
+
+  /**
+  * \brief Opens and maps fileName, checking the header, throwing mitk::Exception if it is not valid.
+  */
+  TrackingMatrixStore(const std::string& fileName);
+  virtual ~TrackingMatrixStore();
+
+  std::string GetFileName() const { return m_File.fileName().toStdString(); }
+  size_t GetNumberOfMatrices() const { return m_NumberOfMatrices; }
+  bool IsEmpty() const { return m_NumberOfMatrices == 0; }
+
+  /**
+  * \brief Returns the time stamp of matrix i, in increasing time order.
+  */
+  TimeStampType GetTimeStamp(const size_t& i) const;
+
+  /**
+  * \brief Returns the 16 elements of matrix i, in row-major order, which are valid while this object exists.
+  */
+  const double* GetMatrix(const size_t& i) const;
+
+  /**
+  * \brief Copies matrix i into matrix.
+  */
+  void GetMatrix(const size_t& i, vtkMatrix4x4& matrix) const;
+
+  /**
+  * \brief Finds the matrix with exactly the given time stamp, returning false if there is none.
+  */
+  bool FindTimeStamp(const TimeStampType& timeStamp, size_t& i) const;
+
+private:
+
+  TrackingMatrixStore(const TrackingMatrixStore&); // Purposefully not implemented.
+  TrackingMatrixStore& operator=(const TrackingMatrixStore&); // Purposefully not implemented.
+
+  QFile                m_File;
+  size_t               m_NumberOfMatrices;
+  unsigned char*       m_Data;
+  const TimeStampType* m_TimeStamps;
+  const double*        m_Matrices;
+};
+
+} // end namespace
+
+#endif
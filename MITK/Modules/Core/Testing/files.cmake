@@ -17,6 +17,9 @@ set(MODULE_TESTS
   niftkITKRegionParametersDataNodePropertyTest.cxx
   niftkPointUtilsTest.cxx
   niftkMergePointCloudsTest.cxx
+  niftkParallelCMC33Test.cxx
+  niftkMeshSmootherTest.cxx
+  niftkTrackingMatrixStoreTest.cxx
 )
 
 set(MODULE_CUSTOM_TESTS
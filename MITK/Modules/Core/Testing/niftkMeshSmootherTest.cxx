@@ -0,0 +1,184 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <mitkTestingMacros.h>
+
+#include <niftkCMC33.h>
+#include <niftkMeshSmoother.h>
+
+
+namespace niftk
+{
+
+//-----------------------------------------------------------------------------
+/// Extracts a sphere of radius about 9 with bumps on it, with its centre at the origin.
+void ExtractBumpySphere(MeshData& mesh)
+{
+  int size = 24;
+  std::vector<real> data;
+  CreateBumpySphere(size, 0.07f, data);
+
+  CMC33 extractor(size, size, size);
+  extractor.set_input_data(&data[0]);
+  extractor.set_output_data(&mesh);
+  extractor.init_all();
+  extractor.run(0);
+
+  for (size_t v = 0; v < mesh.m_Vertices.size(); v++)
+  {
+    mesh.m_Vertices[v].SetCoords(mesh.m_Vertices[v].GetCoords() - BasicVec3D(11.5, 11.5, 11.5));
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+/// Returns the standard deviation of the distance of the vertices from the origin.
+double GetRadiusStandardDeviation(const MeshData& mesh)
+{
+  double sum = 0;
+  double sumOfSquares = 0;
+
+  for (size_t v = 0; v < mesh.m_Vertices.size(); v++)
+  {
+    BasicVec3D position = mesh.m_Vertices[v].GetCoords();
+    double r = position.Length();
+    sum += r;
+    sumOfSquares += r * r;
+  }
+
+  double mean = sum / mesh.m_Vertices.size();
+  return std::sqrt(std::max(0.0, sumOfSquares / mesh.m_Vertices.size() - mean * mean));
+}
+
+
+//-----------------------------------------------------------------------------
+/// One Laplacian step written directly from the per-vertex neighbour lists of the extractor.
+void LaplaceSmoothReference(MeshData& mesh, float scale)
+{
+  std::vector<BasicVec3D> positions(mesh.m_Vertices.size());
+
+  for (size_t i = 0; i < mesh.m_Vertices.size(); i++)
+  {
+    positions[i] = mesh.m_Vertices[i].GetCoords();
+
+    const std::vector<size_t>& neighbours = mesh.m_VertexToVertexIndices[i];
+    if (neighbours.size() == 0)
+    {
+      continue;
+    }
+
+    BasicVec3D displacement(0, 0, 0);
+    for (size_t j = 0; j < neighbours.size(); j++)
+    {
+      displacement += mesh.m_Vertices[neighbours[j]].GetCoords() - mesh.m_Vertices[i].GetCoords();
+    }
+    positions[i] = positions[i] + displacement * (scale / neighbours.size());
+  }
+
+  for (size_t i = 0; i < mesh.m_Vertices.size(); i++)
+  {
+    mesh.m_Vertices[i].SetCoords(positions[i]);
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+/// Returns the largest distance between the corresponding vertices, or vertex normals, of two meshes.
+double GetMaximumDifference(const MeshData& a, const MeshData& b, bool normals)
+{
+  double maximum = 0;
+
+  for (size_t i = 0; i < a.m_Vertices.size(); i++)
+  {
+    BasicVec3D pa = normals ? a.m_Vertices[i].GetNormal() : a.m_Vertices[i].GetCoords();
+    BasicVec3D pb = normals ? b.m_Vertices[i].GetNormal() : b.m_Vertices[i].GetCoords();
+    maximum = std::max(maximum, static_cast<double>(pa.Distance(pb)));
+  }
+  return maximum;
+}
+
+
+//-----------------------------------------------------------------------------
+void TestSameAsSingleThreaded(const MeshData& sphere, int method, int numberOfThreads)
+{
+  MeshData single = sphere;
+  MeshSmoother singleSmoother;
+  singleSmoother.InitWithExternalData(&single);
+  singleSmoother.SetSmoothingMethod(method);
+  singleSmoother.SetNumberOfThreads(1);
+  singleSmoother.TaubinSmooth(0.5f, -0.53f, 3);
+  singleSmoother.GenerateVertexAndTriangleNormals();
+
+  MeshData parallel = sphere;
+  MeshSmoother parallelSmoother;
+  parallelSmoother.InitWithExternalData(&parallel);
+  parallelSmoother.SetSmoothingMethod(method);
+  parallelSmoother.SetNumberOfThreads(numberOfThreads);
+  parallelSmoother.TaubinSmooth(0.5f, -0.53f, 3);
+  parallelSmoother.GenerateVertexAndTriangleNormals();
+
+  MITK_TEST_CONDITION(GetMaximumDifference(single, parallel, false) == 0,
+                      ".. Testing method " << method << " on " << numberOfThreads << " threads gives the same vertices as on 1 thread");
+  MITK_TEST_CONDITION(GetMaximumDifference(single, parallel, true) == 0,
+                      ".. Testing method " << method << " on " << numberOfThreads << " threads gives the same normals as on 1 thread");
+  MITK_TEST_CONDITION(GetRadiusStandardDeviation(parallel) < GetRadiusStandardDeviation(sphere),
+                      ".. Testing method " << method << " makes the sphere rounder, before=" << GetRadiusStandardDeviation(sphere) << ", after=" << GetRadiusStandardDeviation(parallel));
+}
+
+
+//-----------------------------------------------------------------------------
+void TestLaplaceSmoothMatchesReference(const MeshData& sphere)
+{
+  MeshData expected = sphere;
+  LaplaceSmoothReference(expected, 0.5f);
+  LaplaceSmoothReference(expected, -0.53f);
+
+  MeshData actual = sphere;
+  MeshSmoother smoother;
+  smoother.InitWithExternalData(&actual);
+  smoother.SetSmoothingMethod(0);
+  smoother.TaubinSmooth(0.5f, -0.53f, 1);
+
+  MITK_TEST_CONDITION(GetMaximumDifference(expected, actual, false) < 1e-4,
+                      ".. Testing one Laplacian Taubin step matches the reference, max difference=" << GetMaximumDifference(expected, actual, false));
+}
+
+}
+
+/**
+ * Checks that the smoothing and normal computation give the same results on any number of threads.
+ */
+int niftkMeshSmootherTest(int argc, char * argv[])
+{
+  // always start with this!
+  MITK_TEST_BEGIN("niftkMeshSmootherTest");
+
+  niftk::MeshData sphere;
+  niftk::ExtractBumpySphere(sphere);
+  MITK_TEST_CONDITION(sphere.m_Vertices.size() > 0, ".. Testing the sphere is not empty");
+
+  niftk::TestLaplaceSmoothMatchesReference(sphere);
+
+  for (int method = 0; method < 3; method++)
+  {
+    niftk::TestSameAsSingleThreaded(sphere, method, 3);
+    niftk::TestSameAsSingleThreaded(sphere, method, 8);
+  }
+
+  MITK_TEST_END();
+}
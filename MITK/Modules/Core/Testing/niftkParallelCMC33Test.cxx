@@ -0,0 +1,138 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#include <cmath>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <mitkTestingMacros.h>
+
+#include <niftkCMC33.h>
+#include <niftkParallelCMC33.h>
+
+
+namespace niftk
+{
+
+//-----------------------------------------------------------------------------
+/// Fills the grid with two overlapping spheres, which are negative outside and on the border of the grid.
+void CreateSpheres(int sizeX, int sizeY, int sizeZ, std::vector<real>& data)
+{
+  data.resize(sizeX * sizeY * sizeZ);
+
+  for (int k = 0; k < sizeZ; k++)
+  {
+    for (int j = 0; j < sizeY; j++)
+    {
+      for (int i = 0; i < sizeX; i++)
+      {
+        real first = 8.3 - std::sqrt((i - 12.0) * (i - 12.0) + (j - 13.0) * (j - 13.0) + (k - 11.0) * (k - 11.0));
+        real second = 5.6 - std::sqrt((i - 20.0) * (i - 20.0) + (j - 15.0) * (j - 15.0) + (k - 24.0) * (k - 24.0));
+        real value = std::max(first, second);
+
+        if (i == 0 || j == 0 || k == 0 || i == sizeX - 1 || j == sizeY - 1 || k == sizeZ - 1)
+        {
+          value = -1;
+        }
+
+        data[i + j * sizeX + k * sizeX * sizeY] = value;
+      }
+    }
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+/// Returns the number of edges that do not belong to exactly two triangles, which is 0 for a closed surface.
+int CountOpenEdges(const MeshData& mesh)
+{
+  std::map<std::pair<int, int>, int> edges;
+
+  for (size_t t = 0; t < mesh.m_Triangles.size(); t++)
+  {
+    int v[3] = { mesh.m_Triangles[t].GetVert1Index(), mesh.m_Triangles[t].GetVert2Index(), mesh.m_Triangles[t].GetVert3Index() };
+    for (int e = 0; e < 3; e++)
+    {
+      edges[std::make_pair(std::min(v[e], v[(e + 1) % 3]), std::max(v[e], v[(e + 1) % 3]))]++;
+    }
+  }
+
+  int openEdges = 0;
+  for (std::map<std::pair<int, int>, int>::const_iterator it = edges.begin(); it != edges.end(); ++it)
+  {
+    if (it->second != 2)
+    {
+      openEdges++;
+    }
+  }
+  return openEdges;
+}
+
+
+//-----------------------------------------------------------------------------
+void TestSameAsSingleThreaded(int numberOfThreads, int blockSize)
+{
+  int sizeX = 30;
+  int sizeY = 28;
+  int sizeZ = 35;
+
+  std::vector<real> data;
+  CreateSpheres(sizeX, sizeY, sizeZ, data);
+
+  MeshData singleMesh;
+  CMC33 single(sizeX, sizeY, sizeZ);
+  single.set_input_data(&data[0]);
+  single.set_output_data(&singleMesh);
+  single.set_block_size(0);
+  single.init_all();
+  single.run(0);
+
+  MeshData parallelMesh;
+  ParallelCMC33 parallel(sizeX, sizeY, sizeZ);
+  parallel.set_input_data(&data[0]);
+  parallel.set_output_data(&parallelMesh);
+  parallel.set_number_of_threads(numberOfThreads);
+  parallel.set_block_size(blockSize);
+  parallel.run(0);
+
+  MITK_TEST_CONDITION(singleMesh.m_Vertices.size() > 0, ".. Testing the single threaded mesh is not empty");
+  MITK_TEST_CONDITION(parallelMesh.m_Vertices.size() == singleMesh.m_Vertices.size(),
+                      ".. Testing " << numberOfThreads << " threads, block size " << blockSize << ", expected vertices=" << singleMesh.m_Vertices.size() << ", actual=" << parallelMesh.m_Vertices.size());
+  MITK_TEST_CONDITION(parallelMesh.m_Triangles.size() == singleMesh.m_Triangles.size(),
+                      ".. Testing " << numberOfThreads << " threads, block size " << blockSize << ", expected triangles=" << singleMesh.m_Triangles.size() << ", actual=" << parallelMesh.m_Triangles.size());
+  MITK_TEST_CONDITION(parallelMesh.m_VertexToTriangleIndices.size() == parallelMesh.m_Vertices.size(),
+                      ".. Testing " << numberOfThreads << " threads, block size " << blockSize << ", vertex to triangle lookup has one entry per vertex");
+  MITK_TEST_CONDITION(CountOpenEdges(singleMesh) == 0, ".. Testing the single threaded mesh is closed");
+  MITK_TEST_CONDITION(CountOpenEdges(parallelMesh) == 0, ".. Testing " << numberOfThreads << " threads, block size " << blockSize << ", the mesh is closed");
+}
+
+}
+
+/**
+ * Checks that splitting the grid into slabs, and skipping empty blocks, gives the same closed mesh as the single threaded CMC33.
+ */
+int niftkParallelCMC33Test(int argc, char * argv[])
+{
+  // always start with this!
+  MITK_TEST_BEGIN("niftkParallelCMC33Test");
+
+  niftk::TestSameAsSingleThreaded(1, 0);
+  niftk::TestSameAsSingleThreaded(1, 8);
+  niftk::TestSameAsSingleThreaded(3, 0);
+  niftk::TestSameAsSingleThreaded(4, 8);
+  niftk::TestSameAsSingleThreaded(7, 5);
+
+  MITK_TEST_END();
+}
@@ -0,0 +1,155 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <QDir>
+#include <QTemporaryDir>
+
+#include <mitkExceptionMacro.h>
+#include <mitkTestingMacros.h>
+#include <vtkSmartPointer.h>
+
+#include <niftkFileIOUtils.h>
+#include <niftkTrackingMatrixStore.h>
+
+
+namespace niftk
+{
+
+//-----------------------------------------------------------------------------
+/// Writes a few matrices with awkward values, out of time order, as <timestamp>.txt files.
+std::vector<TrackingMatrixStore::TimeStampType> CreateMatrixFiles(const QString& directory)
+{
+  std::vector<TrackingMatrixStore::TimeStampType> timeStamps;
+  timeStamps.push_back(1429793163701888500ULL);
+  timeStamps.push_back(1429793163651888500ULL);
+  timeStamps.push_back(1429793163751888500ULL);
+  timeStamps.push_back(1429793163601888500ULL);
+
+  for (size_t t = 0; t < timeStamps.size(); t++)
+  {
+    vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    for (int r = 0; r < 4; r++)
+    {
+      for (int c = 0; c < 4; c++)
+      {
+        matrix->SetElement(r, c, std::sin(1.0 + t + 0.37 * r + 0.11 * c) / 3.0 + (c == 3 ? 123.456789 * (r + 1) : 0));
+      }
+    }
+
+    std::ostringstream fileName;
+    fileName << timeStamps[t] << ".txt";
+    SaveVtkMatrix4x4ToFile(QDir(directory).filePath(QString::fromStdString(fileName.str())).toStdString(), *matrix);
+  }
+
+  // Not a tracking matrix, so it must not be packed.
+  SaveVtkMatrix4x4ToFile(QDir(directory).filePath("calib.txt").toStdString(), *vtkSmartPointer<vtkMatrix4x4>::New());
+
+  return timeStamps;
+}
+
+
+//-----------------------------------------------------------------------------
+void TestConvertDirectory()
+{
+  QTemporaryDir directory;
+  MITK_TEST_CONDITION_REQUIRED(directory.isValid(), ".. Testing the temporary directory was created");
+
+  std::vector<TrackingMatrixStore::TimeStampType> timeStamps = CreateMatrixFiles(directory.path());
+  std::string directoryName = directory.path().toStdString();
+
+  MITK_TEST_CONDITION(TrackingMatrixStore::DirectoryContainsMatrixFiles(directoryName), ".. Testing the matrix files are found");
+  MITK_TEST_CONDITION(!TrackingMatrixStore::IsInDirectory(directoryName), ".. Testing there is no store before converting");
+
+  size_t numberOfMatrices = TrackingMatrixStore::ConvertDirectory(directoryName);
+  MITK_TEST_CONDITION(numberOfMatrices == timeStamps.size(), ".. Testing " << timeStamps.size() << " matrices were packed, actual=" << numberOfMatrices);
+  MITK_TEST_CONDITION(TrackingMatrixStore::IsInDirectory(directoryName), ".. Testing the store exists after converting");
+
+  TrackingMatrixStore store(TrackingMatrixStore::GetFileNameInDirectory(directoryName));
+  MITK_TEST_CONDITION_REQUIRED(store.GetNumberOfMatrices() == timeStamps.size(), ".. Testing the store has " << timeStamps.size() << " matrices");
+
+  for (size_t i = 1; i < store.GetNumberOfMatrices(); i++)
+  {
+    MITK_TEST_CONDITION(store.GetTimeStamp(i - 1) < store.GetTimeStamp(i), ".. Testing time stamp " << i << " is in increasing order");
+  }
+
+  for (size_t t = 0; t < timeStamps.size(); t++)
+  {
+    size_t i = 0;
+    MITK_TEST_CONDITION_REQUIRED(store.FindTimeStamp(timeStamps[t], i), ".. Testing time stamp " << timeStamps[t] << " is found");
+
+    std::ostringstream fileName;
+    fileName << timeStamps[t] << ".txt";
+    vtkSmartPointer<vtkMatrix4x4> expected = LoadVtkMatrix4x4FromFile(QDir(directory.path()).filePath(QString::fromStdString(fileName.str())).toStdString());
+
+    vtkSmartPointer<vtkMatrix4x4> actual = vtkSmartPointer<vtkMatrix4x4>::New();
+    store.GetMatrix(i, *actual);
+
+    bool same = true;
+    for (int r = 0; r < 4; r++)
+    {
+      for (int c = 0; c < 4; c++)
+      {
+        same = same && expected->GetElement(r, c) == actual->GetElement(r, c) && store.GetMatrix(i)[4 * r + c] == actual->GetElement(r, c);
+      }
+    }
+    MITK_TEST_CONDITION(same, ".. Testing matrix " << timeStamps[t] << " is exactly the same as the text file");
+  }
+
+  size_t i = 0;
+  MITK_TEST_CONDITION(!store.FindTimeStamp(timeStamps[0] + 1, i), ".. Testing a missing time stamp is not found");
+}
+
+
+//-----------------------------------------------------------------------------
+void TestRepeatedTimeStampThrows()
+{
+  QTemporaryDir directory;
+  MITK_TEST_CONDITION_REQUIRED(directory.isValid(), ".. Testing the temporary directory was created");
+
+  std::vector<TrackingMatrixStore::TimeStampType> timeStamps(2, 1429793163701888500ULL);
+  std::vector<double> matrices(32, 1.0);
+
+  bool thrown = false;
+  try
+  {
+    TrackingMatrixStore::Write(QDir(directory.path()).filePath(TrackingMatrixStore::FileName).toStdString(), timeStamps, matrices);
+  }
+  catch (const mitk::Exception&)
+  {
+    thrown = true;
+  }
+  MITK_TEST_CONDITION(thrown, ".. Testing a repeated time stamp throws");
+  MITK_TEST_CONDITION(!TrackingMatrixStore::IsInDirectory(directory.path().toStdString()), ".. Testing nothing was written");
+}
+
+}
+
+/**
+ * Checks that packing a directory of tracking matrices reads back exactly the same matrices, in time order.
+ */
+int niftkTrackingMatrixStoreTest(int argc, char * argv[])
+{
+  // always start with this!
+  MITK_TEST_BEGIN("niftkTrackingMatrixStoreTest");
+
+  niftk::TestConvertDirectory();
+  niftk::TestRepeatedTimeStampThrows();
+
+  MITK_TEST_END();
+}
@@ -24,6 +24,7 @@ set(CPP_FILES
   Algorithms/niftkCMC33.cxx
   Algorithms/niftkImageToSurfaceFilter.cxx
   Algorithms/niftkMeshSmoother.cxx
+  Algorithms/niftkParallelCMC33.cxx
   Common/niftkCoreObjectFactory.cxx
   Common/niftkFileIOUtils.cxx
   Common/niftkImageUtils.cxx
@@ -33,6 +34,7 @@ set(CPP_FILES
   Common/niftkBinaryMaskUtils.cxx
   Common/niftkMITKMathsUtils.cxx
   Common/niftkPolyDataUtils.cxx
+  Common/niftkTrackingMatrixStore.cxx
   DataManagement/niftkAffineTransformParametersDataNodeProperty.cxx
   DataManagement/niftkAffineTransformDataNodeProperty.cxx
   DataManagement/niftkBasicMesh.cxx
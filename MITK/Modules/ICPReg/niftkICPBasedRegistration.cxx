@@ -14,6 +14,7 @@
 
 #include "niftkICPBasedRegistration.h"
 #include <niftkVTKIterativeClosestPoint.h>
+#include <niftkVTKKdTreeIterativeClosestPoint.h>
 #include <niftkPolyDataUtils.h>
 #include <mitkExceptionMacro.h>
 #include <limits>
@@ -27,6 +28,8 @@ ICPBasedRegistration::ICPBasedRegistration()
 , m_MaximumNumberOfLandmarkPointsToUse(ICPBasedRegistrationConstants::DEFAULT_MAX_POINTS)
 , m_TLSIterations(ICPBasedRegistrationConstants::DEFAULT_TLS_ITERATIONS)
 , m_TLSPercentage(ICPBasedRegistrationConstants::DEFAULT_TLS_PERCENTAGE)
+, m_UseKdTree(ICPBasedRegistrationConstants::DEFAULT_USE_KDTREE)
+, m_PointToPlane(ICPBasedRegistrationConstants::DEFAULT_POINT_TO_PLANE)
 {
 }
 
@@ -51,7 +54,7 @@ double ICPBasedRegistration::Update(const mitk::DataNode::Pointer& fixedNode,
   vtkSmartPointer<vtkPolyData> movingPoly = vtkSmartPointer<vtkPolyData>::New();
   niftk::NodeToPolyData(movingNode, *movingPoly, cameraNode, flipNormals);
 
-  return RunVTKICP(fixedPoly, movingPoly, transformMovingToFixed);
+  return RunICP(fixedPoly, movingPoly, transformMovingToFixed);
 }
 
 
@@ -84,7 +87,20 @@ double ICPBasedRegistration::Update(const std::vector<mitk::DataNode::Pointer>&
             << mergedFixedPolyData->GetNumberOfPoints() << ", "
             << mergedMovingPolyData->GetNumberOfPoints();
 
-  return RunVTKICP(mergedFixedPolyData, mergedMovingPolyData, transformMovingToFixed);
+  return RunICP(mergedFixedPolyData, mergedMovingPolyData, transformMovingToFixed);
+}
+
+
+//-----------------------------------------------------------------------------
+double ICPBasedRegistration::RunICP(vtkPolyData* fixedPoly,
+                                    vtkPolyData* movingPoly,
+                                    vtkMatrix4x4& transformMovingToFixed)
+{
+  if (m_UseKdTree)
+  {
+    return RunKdTreeICP(fixedPoly, movingPoly, transformMovingToFixed);
+  }
+  return RunVTKICP(fixedPoly, movingPoly, transformMovingToFixed);
 }
 
 
@@ -142,4 +158,60 @@ double ICPBasedRegistration::RunVTKICP(vtkPolyData* fixedPoly,
   return residual;
 }
 
+
+//-----------------------------------------------------------------------------
+double ICPBasedRegistration::RunKdTreeICP(vtkPolyData* fixedPoly,
+                                          vtkPolyData* movingPoly,
+                                          vtkMatrix4x4& transformMovingToFixed)
+{
+  if (fixedPoly == nullptr)
+  {
+    mitkThrow() << "In ICPBasedRegistration::RunKdTreeICP, fixedPoly is NULL";
+  }
+
+  if (movingPoly == nullptr)
+  {
+    mitkThrow() << "In ICPBasedRegistration::RunKdTreeICP, movingPoly is NULL";
+  }
+
+  double residual = std::numeric_limits<double>::max();
+
+  // Trimming is done within each iteration, so the TLS iterations only switch it on.
+  unsigned int trimmedPercentage = m_TLSIterations > 0 ? m_TLSPercentage : 100;
+
+  try
+  {
+    niftk::VTKKdTreeIterativeClosestPoint icp;
+    icp.SetICPMaxLandmarks(m_MaximumNumberOfLandmarkPointsToUse);
+    icp.SetICPMaxIterations(m_MaximumIterations);
+    icp.SetTrimmedPercentage(trimmedPercentage);
+    icp.SetPointToPlane(m_PointToPlane);
+    icp.SetSource(movingPoly);
+    icp.SetTarget(fixedPoly);
+
+    MITK_INFO << "Running k-d tree ICP with "
+              << fixedPoly->GetNumberOfPoints() << ", "
+              << movingPoly->GetNumberOfPoints()
+              << " points"
+              << ", maxLandMarks=" << m_MaximumNumberOfLandmarkPointsToUse
+              << ", maxIters=" << m_MaximumIterations
+              << ", trimmedPercentage=" << trimmedPercentage
+              << ", pointToPlane=" << m_PointToPlane
+              << std::endl;
+
+    residual = icp.Run();
+
+    MITK_INFO << "k-d tree ICP finished after " << icp.GetNumberOfIterations() << " iterations.";
+
+    vtkSmartPointer<vtkMatrix4x4> temp = icp.GetTransform();
+    transformMovingToFixed.DeepCopy(temp);
+  }
+  catch (const std::exception& e)
+  {
+    mitkThrow() << e.what();
+  }
+
+  return residual;
+}
+
 } // end namespace
@@ -32,11 +32,18 @@ static const int DEFAULT_MAX_ITERATIONS = 2000;
 static const int DEFAULT_MAX_POINTS = 8000;
 static const int DEFAULT_TLS_ITERATIONS = 0; // Zero means 'off'.
 static const int DEFAULT_TLS_PERCENTAGE = 50; // Should be (0-100].
+static const bool DEFAULT_USE_KDTREE = false;
+static const bool DEFAULT_POINT_TO_PLANE = false; // Only used with the k-d tree.
 }
 
 /**
 * \class ICPBasedRegistration
 * \brief Class to perform a surface based registration of two MITK Surfaces/PointSets, using VTKs ICP.
+*
+* If UseKdTree is on, niftk::VTKKdTreeIterativeClosestPoint is used instead, which matches the
+* moving points to the closest fixed points on several threads, and can optionally minimise the
+* point to plane distance. It trims the worst TLSPercentage of points at each iteration if
+* TLSIterations is non-zero, rather than re-running the whole registration.
 */
 class NIFTKICPREG_EXPORT ICPBasedRegistration : public itk::Object
 {
@@ -49,6 +56,8 @@ public:
   itkSetMacro(MaximumNumberOfLandmarkPointsToUse, int);
   itkSetMacro(TLSIterations, unsigned int);
   itkSetMacro(TLSPercentage, unsigned int);
+  itkSetMacro(UseKdTree, bool);
+  itkSetMacro(PointToPlane, bool);
 
   /**
   * \brief Runs ICP registration.
@@ -89,11 +98,21 @@ private:
   int          m_MaximumNumberOfLandmarkPointsToUse;
   unsigned int m_TLSIterations;
   unsigned int m_TLSPercentage;
+  bool         m_UseKdTree;
+  bool         m_PointToPlane;
+
+  double RunICP(vtkPolyData* fixedPoly,
+                vtkPolyData* movingPoly,
+                vtkMatrix4x4& transformMovingToFixed);
 
   double RunVTKICP(vtkPolyData* fixedPoly,
                    vtkPolyData* movingPoly,
                    vtkMatrix4x4& transformMovingToFixed);
 
+  double RunKdTreeICP(vtkPolyData* fixedPoly,
+                      vtkPolyData* movingPoly,
+                      vtkMatrix4x4& transformMovingToFixed);
+
 }; // end class
 
 } // end namespace
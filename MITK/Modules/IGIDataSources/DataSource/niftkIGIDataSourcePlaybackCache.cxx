@@ -0,0 +1,360 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#include "niftkIGIDataSourcePlaybackCache.h"
+#include <niftkIGIDataSourceBackgroundPrefetchThread.h>
+#include <mitkExceptionMacro.h>
+#include <mitkLogMacros.h>
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <cmath>
+
+namespace niftk
+{
+
+//-----------------------------------------------------------------------------
+IGIDataSourcePlaybackCache::IGIDataSourcePlaybackCache(niftk::IGIPlaybackLoadableDataSourceI* source,
+                                                       const std::string& bufferName,
+                                                       unsigned int numberOfItemsAhead,
+                                                       size_t maximumNumberOfBytes)
+: m_DataSource(source)
+, m_BufferName(bufferName)
+, m_NumberOfItemsAhead(numberOfItemsAhead)
+, m_MaximumNumberOfBytes(maximumNumberOfBytes)
+, m_Thread(nullptr)
+, m_NumberOfBytes(0)
+, m_IsLoading(false)
+, m_LoadingTimeStamp(0)
+, m_LastPosition(-1)
+, m_Direction(1)
+, m_StepSize(1)
+, m_NumberOfHits(0)
+, m_NumberOfMisses(0)
+, m_NumberOfEvictions(0)
+{
+  if (m_DataSource == nullptr)
+  {
+    mitkThrow() << "Invalid DataSource provided";
+  }
+  if (m_NumberOfItemsAhead < 1)
+  {
+    mitkThrow() << "Number of items to read ahead should be a number >= 1";
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+IGIDataSourcePlaybackCache::~IGIDataSourcePlaybackCache()
+{
+  this->Stop();
+}
+
+
+//-----------------------------------------------------------------------------
+void IGIDataSourcePlaybackCache::SetPlaybackIndex(const std::set<niftk::IGIDataSourceI::IGITimeType>& index)
+{
+  QMutexLocker locker(&m_Mutex);
+
+  m_PlaybackIndex.assign(index.begin(), index.end());
+  m_LastPosition = -1;
+  m_Direction = 1;
+  m_StepSize = 1;
+  this->InternalClear();
+}
+
+
+//-----------------------------------------------------------------------------
+void IGIDataSourcePlaybackCache::Start()
+{
+  if (m_Thread != nullptr)
+  {
+    return;
+  }
+
+  m_Thread = new niftk::IGIDataSourceBackgroundPrefetchThread(NULL, this);
+  m_Thread->SetInterval(5); // Prefetch() fills the cache, so this is just the idle polling rate.
+  m_Thread->start();
+  if (!m_Thread->isRunning())
+  {
+    delete m_Thread;
+    m_Thread = nullptr;
+    mitkThrow() << "Failed to start background prefetch thread";
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+void IGIDataSourcePlaybackCache::Stop()
+{
+  if (m_Thread != nullptr)
+  {
+    m_Thread->ForciblyStop();
+    delete m_Thread;
+    m_Thread = nullptr;
+  }
+
+  QMutexLocker locker(&m_Mutex);
+  this->InternalClear();
+}
+
+
+//-----------------------------------------------------------------------------
+void IGIDataSourcePlaybackCache::InternalClear()
+{
+  m_Cache.clear();
+  m_NumberOfBytes = 0;
+}
+
+
+//-----------------------------------------------------------------------------
+void IGIDataSourcePlaybackCache::UpdatePrediction(const niftk::IGIDataSourceI::IGITimeType& time)
+{
+  std::vector<niftk::IGIDataSourceI::IGITimeType>::const_iterator iter
+      = std::lower_bound(m_PlaybackIndex.begin(), m_PlaybackIndex.end(), time);
+
+  if (iter == m_PlaybackIndex.end() || *iter != time)
+  {
+    // Not a recorded item, so tells us nothing about where playback is going.
+    return;
+  }
+
+  long int position = static_cast<long int>(iter - m_PlaybackIndex.begin());
+  if (m_LastPosition >= 0 && position != m_LastPosition)
+  {
+    long int step = position - m_LastPosition;
+    m_Direction = step > 0 ? 1 : -1;
+
+    // Exponential moving average, so a single skipped frame doesn't make us jump ahead.
+    m_StepSize = std::max(1.0, 0.5 * m_StepSize + 0.5 * std::abs(static_cast<double>(step)));
+  }
+  m_LastPosition = position;
+}
+
+
+//-----------------------------------------------------------------------------
+std::vector<niftk::IGIDataSourceI::IGITimeType> IGIDataSourcePlaybackCache::GetPredictedTimeStamps() const
+{
+  std::vector<niftk::IGIDataSourceI::IGITimeType> predicted;
+  if (m_LastPosition < 0)
+  {
+    return predicted;
+  }
+
+  long int previous = m_LastPosition;
+  for (unsigned int i = 1; i <= m_NumberOfItemsAhead; i++)
+  {
+    long int position = m_LastPosition + m_Direction * static_cast<long int>(std::floor(i * m_StepSize + 0.5));
+    if (position < 0 || position >= static_cast<long int>(m_PlaybackIndex.size()))
+    {
+      break;
+    }
+    if (position != previous)
+    {
+      predicted.push_back(m_PlaybackIndex[position]);
+      previous = position;
+    }
+  }
+  return predicted;
+}
+
+
+//-----------------------------------------------------------------------------
+void IGIDataSourcePlaybackCache::Evict(const std::vector<niftk::IGIDataSourceI::IGITimeType>& predicted)
+{
+  std::set<niftk::IGIDataSourceI::IGITimeType> wanted(predicted.begin(), predicted.end());
+
+  CacheType::iterator iter = m_Cache.begin();
+  while (iter != m_Cache.end())
+  {
+    if (wanted.find(iter->first) == wanted.end())
+    {
+      m_NumberOfBytes -= iter->second.m_NumberOfBytes;
+      m_NumberOfEvictions++;
+      iter = m_Cache.erase(iter);
+    }
+    else
+    {
+      ++iter;
+    }
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+void IGIDataSourcePlaybackCache::Prefetch()
+{
+  while (true)
+  {
+    niftk::IGIDataSourceI::IGITimeType timeToLoad = 0;
+    {
+      QMutexLocker locker(&m_Mutex);
+
+      std::vector<niftk::IGIDataSourceI::IGITimeType> predicted = this->GetPredictedTimeStamps();
+      this->Evict(predicted);
+
+      if (m_NumberOfBytes >= m_MaximumNumberOfBytes)
+      {
+        return;
+      }
+
+      std::vector<niftk::IGIDataSourceI::IGITimeType>::const_iterator iter = predicted.begin();
+      while (iter != predicted.end() && m_Cache.find(*iter) != m_Cache.end())
+      {
+        ++iter;
+      }
+      if (iter == predicted.end())
+      {
+        return;
+      }
+
+      timeToLoad = *iter;
+      m_IsLoading = true;
+      m_LoadingTimeStamp = timeToLoad;
+    }
+
+    // Load without holding the lock, so the GUI thread can carry on taking items.
+    std::unique_ptr<niftk::IGIDataType> item;
+    size_t numberOfBytes = 0;
+    try
+    {
+      item = m_DataSource->LoadPlaybackItem(m_BufferName, timeToLoad, numberOfBytes);
+    }
+    catch (std::exception& e)
+    {
+      // Don't throw, as IGITimerBasedThread would stop prefetching altogether.
+      // An empty entry is cached, so TakeItem() retries on the GUI thread, and reports the error.
+      MITK_ERROR << "IGIDataSourcePlaybackCache(" << m_BufferName << "): Failed to load item at "
+                 << timeToLoad << ", due to:" << e.what();
+      numberOfBytes = 0;
+    }
+
+    QMutexLocker locker(&m_Mutex);
+    CacheEntry& entry = m_Cache[timeToLoad];
+    m_NumberOfBytes -= entry.m_NumberOfBytes;
+    entry.m_Item = std::move(item);
+    entry.m_NumberOfBytes = numberOfBytes;
+    m_NumberOfBytes += numberOfBytes;
+    m_IsLoading = false;
+    m_ItemLoaded.wakeAll();
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+std::unique_ptr<niftk::IGIDataType> IGIDataSourcePlaybackCache::TakeItem(
+    const niftk::IGIDataSourceI::IGITimeType& time)
+{
+  {
+    QMutexLocker locker(&m_Mutex);
+
+    this->UpdatePrediction(time);
+
+    // If the prefetcher is part way through loading it, waiting is quicker than starting again.
+    while (m_IsLoading && m_LoadingTimeStamp == time)
+    {
+      m_ItemLoaded.wait(&m_Mutex);
+    }
+
+    CacheType::iterator iter = m_Cache.find(time);
+    if (iter != m_Cache.end())
+    {
+      std::unique_ptr<niftk::IGIDataType> result = std::move(iter->second.m_Item);
+      m_NumberOfBytes -= iter->second.m_NumberOfBytes;
+      m_Cache.erase(iter);
+
+      if (result)
+      {
+        m_NumberOfHits++;
+        return result;
+      }
+    }
+    m_NumberOfMisses++;
+  }
+
+  size_t numberOfBytes = 0;
+  return m_DataSource->LoadPlaybackItem(m_BufferName, time, numberOfBytes);
+}
+
+
+//-----------------------------------------------------------------------------
+void IGIDataSourcePlaybackCache::ResetCounters()
+{
+  QMutexLocker locker(&m_Mutex);
+
+  m_NumberOfHits = 0;
+  m_NumberOfMisses = 0;
+  m_NumberOfEvictions = 0;
+}
+
+
+//-----------------------------------------------------------------------------
+unsigned int IGIDataSourcePlaybackCache::GetNumberOfItems() const
+{
+  QMutexLocker locker(&m_Mutex);
+
+  return m_Cache.size();
+}
+
+
+//-----------------------------------------------------------------------------
+size_t IGIDataSourcePlaybackCache::GetNumberOfBytes() const
+{
+  QMutexLocker locker(&m_Mutex);
+
+  return m_NumberOfBytes;
+}
+
+
+//-----------------------------------------------------------------------------
+unsigned long int IGIDataSourcePlaybackCache::GetNumberOfHits() const
+{
+  QMutexLocker locker(&m_Mutex);
+
+  return m_NumberOfHits;
+}
+
+
+//-----------------------------------------------------------------------------
+unsigned long int IGIDataSourcePlaybackCache::GetNumberOfMisses() const
+{
+  QMutexLocker locker(&m_Mutex);
+
+  return m_NumberOfMisses;
+}
+
+
+//-----------------------------------------------------------------------------
+unsigned long int IGIDataSourcePlaybackCache::GetNumberOfEvictions() const
+{
+  QMutexLocker locker(&m_Mutex);
+
+  return m_NumberOfEvictions;
+}
+
+
+//-----------------------------------------------------------------------------
+double IGIDataSourcePlaybackCache::GetHitRate() const
+{
+  QMutexLocker locker(&m_Mutex);
+
+  unsigned long int total = m_NumberOfHits + m_NumberOfMisses;
+  if (total == 0)
+  {
+    return 0;
+  }
+  return static_cast<double>(m_NumberOfHits) / static_cast<double>(total);
+}
+
+} // end namespace
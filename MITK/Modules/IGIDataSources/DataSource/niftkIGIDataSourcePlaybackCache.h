@@ -0,0 +1,172 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#ifndef niftkIGIDataSourcePlaybackCache_h
+#define niftkIGIDataSourcePlaybackCache_h
+
+#include <niftkIGIDataSourcesExports.h>
+#include <niftkIGIDataSourceI.h>
+#include <niftkIGIDataType.h>
+#include <niftkIGIPrefetchableDataSourceI.h>
+#include <niftkIGIPlaybackLoadableDataSourceI.h>
+
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace niftk
+{
+
+class IGIDataSourceBackgroundPrefetchThread;
+
+/**
+* \class IGIDataSourcePlaybackCache
+* \brief Read-ahead cache of recorded items for one buffer of a data source,
+* filled by a niftk::IGIDataSourceBackgroundPrefetchThread.
+*
+* During playback, the data source calls TakeItem() instead of loading from disk.
+* Each request updates a prediction of where playback is going next: the position
+* in the playback index, the direction (forwards or backwards) and the average
+* step size (i.e. playback speed relative to the recording rate). The prefetch
+* thread then loads the next GetNumberOfItemsAhead() predicted items, nearest first,
+* via niftk::IGIPlaybackLoadableDataSourceI::LoadPlaybackItem(), and evicts anything
+* that is no longer predicted, e.g. after a seek or change of direction.
+*
+* The total size of cached items is bounded by GetMaximumNumberOfBytes(),
+* (exceeded by at most one item), so high resolution video cannot exhaust memory.
+*
+* Note: This class MUST be kept thread-safe.
+*
+* Note: All errors should thrown as mitk::Exception or sub-classes thereof.
+*/
+class NIFTKIGIDATASOURCES_EXPORT IGIDataSourcePlaybackCache : public IGIPrefetchableDataSourceI
+{
+public:
+
+  IGIDataSourcePlaybackCache(niftk::IGIPlaybackLoadableDataSourceI* source,
+                             const std::string& bufferName,
+                             unsigned int numberOfItemsAhead,
+                             size_t maximumNumberOfBytes);
+  virtual ~IGIDataSourcePlaybackCache();
+
+  /**
+  * \brief Sets the time stamps of all recorded items, clearing the cache and prediction.
+  */
+  void SetPlaybackIndex(const std::set<niftk::IGIDataSourceI::IGITimeType>& index);
+
+  /**
+  * \brief Starts the prefetch thread.
+  */
+  void Start();
+
+  /**
+  * \brief Stops the prefetch thread and empties the cache.
+  */
+  void Stop();
+
+  /**
+  * \brief Returns the item recorded at exactly the given time, from the cache if possible,
+  * otherwise loading it on the calling thread. The item is removed from the cache.
+  */
+  std::unique_ptr<niftk::IGIDataType> TakeItem(const niftk::IGIDataSourceI::IGITimeType& time);
+
+  /**
+  * \brief Called by the prefetch thread, to load predicted items until the cache is full.
+  * \see IGIPrefetchableDataSourceI::Prefetch()
+  */
+  virtual void Prefetch() override;
+
+  /**
+  * \brief Resets the hit, miss and eviction counters, e.g. at the start of playback.
+  */
+  void ResetCounters();
+
+  const std::string& GetBufferName() const { return m_BufferName; }
+  unsigned int GetNumberOfItemsAhead() const { return m_NumberOfItemsAhead; }
+  size_t GetMaximumNumberOfBytes() const { return m_MaximumNumberOfBytes; }
+
+  unsigned int GetNumberOfItems() const;
+  size_t GetNumberOfBytes() const;
+  unsigned long int GetNumberOfHits() const;
+  unsigned long int GetNumberOfMisses() const;
+  unsigned long int GetNumberOfEvictions() const;
+
+  /**
+  * \brief Returns hits / (hits + misses), or zero if nothing has been requested.
+  */
+  double GetHitRate() const;
+
+protected:
+
+  IGIDataSourcePlaybackCache(const IGIDataSourcePlaybackCache&); // Purposefully not implemented.
+  IGIDataSourcePlaybackCache& operator=(const IGIDataSourcePlaybackCache&); // Purposefully not implemented.
+
+private:
+
+  struct CacheEntry
+  {
+    std::unique_ptr<niftk::IGIDataType> m_Item;
+    size_t                              m_NumberOfBytes;
+  };
+
+  typedef std::map<niftk::IGIDataSourceI::IGITimeType, CacheEntry> CacheType;
+
+  /**
+  * \brief Updates position, direction and step size. Must be called with m_Mutex held.
+  */
+  void UpdatePrediction(const niftk::IGIDataSourceI::IGITimeType& time);
+
+  /**
+  * \brief Returns predicted time stamps, nearest first. Must be called with m_Mutex held.
+  */
+  std::vector<niftk::IGIDataSourceI::IGITimeType> GetPredictedTimeStamps() const;
+
+  /**
+  * \brief Removes everything not in the predicted list. Must be called with m_Mutex held.
+  */
+  void Evict(const std::vector<niftk::IGIDataSourceI::IGITimeType>& predicted);
+
+  /**
+  * \brief Empties the cache. Must be called with m_Mutex held.
+  */
+  void InternalClear();
+
+  niftk::IGIPlaybackLoadableDataSourceI*             m_DataSource;
+  std::string                                        m_BufferName;
+  unsigned int                                       m_NumberOfItemsAhead;
+  size_t                                             m_MaximumNumberOfBytes;
+  mutable QMutex                                     m_Mutex;
+  QWaitCondition                                     m_ItemLoaded;
+  niftk::IGIDataSourceBackgroundPrefetchThread*      m_Thread;
+  std::vector<niftk::IGIDataSourceI::IGITimeType>    m_PlaybackIndex;
+  CacheType                                          m_Cache;
+  size_t                                             m_NumberOfBytes;
+  bool                                               m_IsLoading;
+  niftk::IGIDataSourceI::IGITimeType                 m_LoadingTimeStamp;
+  long int                                           m_LastPosition;
+  int                                                m_Direction;
+  double                                             m_StepSize;
+  unsigned long int                                  m_NumberOfHits;
+  unsigned long int                                  m_NumberOfMisses;
+  unsigned long int                                  m_NumberOfEvictions;
+};
+
+} // end namespace
+
+#endif
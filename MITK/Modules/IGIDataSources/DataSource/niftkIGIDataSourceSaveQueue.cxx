@@ -0,0 +1,264 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#include "niftkIGIDataSourceSaveQueue.h"
+#include <niftkIGIDataSourceBackgroundSaveThread.h>
+#include <mitkExceptionMacro.h>
+#include <mitkLogMacros.h>
+#include <QMutexLocker>
+
+namespace niftk
+{
+
+//-----------------------------------------------------------------------------
+IGIDataSourceSaveQueue::IGIDataSourceSaveQueue(niftk::IGIBufferedSaveableDataSourceI* source,
+                                               unsigned int maximumNumberOfItems,
+                                               unsigned int numberOfThreads,
+                                               unsigned int maximumWaitInMilliseconds)
+: m_DataSource(source)
+, m_MaximumNumberOfItems(maximumNumberOfItems)
+, m_NumberOfThreads(numberOfThreads)
+, m_MaximumWaitInMilliseconds(maximumWaitInMilliseconds)
+, m_IsStopping(false)
+, m_NumberInProgress(0)
+, m_NumberSaved(0)
+, m_NumberDropped(0)
+, m_NumberFailed(0)
+, m_LastQueuedTimeStamp(0)
+, m_LastSavedTimeStamp(0)
+{
+  if (m_DataSource == nullptr)
+  {
+    mitkThrow() << "Invalid DataSource provided";
+  }
+  if (m_MaximumNumberOfItems < 1)
+  {
+    mitkThrow() << "Queue size should be a number >= 1";
+  }
+  if (m_NumberOfThreads < 1)
+  {
+    mitkThrow() << "Number of save threads should be a number >= 1";
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+IGIDataSourceSaveQueue::~IGIDataSourceSaveQueue()
+{
+  this->Stop();
+}
+
+
+//-----------------------------------------------------------------------------
+void IGIDataSourceSaveQueue::Start()
+{
+  if (!m_Threads.empty())
+  {
+    return;
+  }
+
+  {
+    QMutexLocker locker(&m_Mutex);
+    m_IsStopping = false;
+  }
+
+  for (unsigned int i = 0; i < m_NumberOfThreads; i++)
+  {
+    niftk::IGIDataSourceBackgroundSaveThread* thread = new niftk::IGIDataSourceBackgroundSaveThread(NULL, this);
+    thread->SetInterval(5); // SaveBuffer() drains the queue, so this is just the idle polling rate.
+    thread->start();
+    if (!thread->isRunning())
+    {
+      delete thread;
+      mitkThrow() << "Failed to start background save thread";
+    }
+    m_Threads.push_back(thread);
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+void IGIDataSourceSaveQueue::Stop()
+{
+  if (m_Threads.empty())
+  {
+    return;
+  }
+
+  {
+    // Stop accepting items, so the flush below can't be overtaken by a producer.
+    QMutexLocker locker(&m_Mutex);
+    m_IsStopping = true;
+    m_ItemRemoved.wakeAll();
+  }
+
+  this->Flush();
+
+  for (size_t i = 0; i < m_Threads.size(); i++)
+  {
+    m_Threads[i]->ForciblyStop();
+    delete m_Threads[i];
+  }
+  m_Threads.clear();
+}
+
+
+//-----------------------------------------------------------------------------
+void IGIDataSourceSaveQueue::Flush()
+{
+  QMutexLocker locker(&m_Mutex);
+
+  while (!m_Threads.empty() && (!m_Queue.empty() || m_NumberInProgress > 0))
+  {
+    m_ItemRemoved.wait(&m_Mutex, 100);
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+bool IGIDataSourceSaveQueue::AddItem(const std::shared_ptr<niftk::IGIDataType>& item)
+{
+  QMutexLocker locker(&m_Mutex);
+
+  if (!m_IsStopping && m_Queue.size() >= m_MaximumNumberOfItems && m_MaximumWaitInMilliseconds > 0)
+  {
+    // Backpressure: make the producer wait, for a bounded time, for space in the queue.
+    m_ItemRemoved.wait(&m_Mutex, m_MaximumWaitInMilliseconds);
+  }
+
+  if (m_IsStopping || m_Queue.size() >= m_MaximumNumberOfItems)
+  {
+    m_NumberDropped++;
+    return false;
+  }
+
+  m_Queue.push_back(item);
+  m_LastQueuedTimeStamp = item->GetTimeStampInNanoSeconds();
+  return true;
+}
+
+
+//-----------------------------------------------------------------------------
+void IGIDataSourceSaveQueue::SaveBuffer()
+{
+  while (true)
+  {
+    std::shared_ptr<niftk::IGIDataType> item;
+    {
+      QMutexLocker locker(&m_Mutex);
+      if (m_Queue.empty())
+      {
+        return;
+      }
+      item = m_Queue.front();
+      m_Queue.pop_front();
+      m_NumberInProgress++;
+    }
+
+    bool saved = false;
+    try
+    {
+      m_DataSource->SaveItem(*item);
+      saved = true;
+    }
+    catch (std::exception& e)
+    {
+      // Don't throw, as IGITimerBasedThread would stop this worker altogether.
+      MITK_ERROR << "IGIDataSourceSaveQueue: Failed to save item at "
+                 << item->GetTimeStampInNanoSeconds() << ", due to:" << e.what();
+    }
+
+    QMutexLocker locker(&m_Mutex);
+    m_NumberInProgress--;
+    if (saved)
+    {
+      m_NumberSaved++;
+      if (item->GetTimeStampInNanoSeconds() > m_LastSavedTimeStamp)
+      {
+        m_LastSavedTimeStamp = item->GetTimeStampInNanoSeconds();
+      }
+    }
+    else
+    {
+      m_NumberFailed++;
+    }
+    m_ItemRemoved.wakeAll();
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+void IGIDataSourceSaveQueue::ResetCounters()
+{
+  QMutexLocker locker(&m_Mutex);
+
+  m_NumberSaved = 0;
+  m_NumberDropped = 0;
+  m_NumberFailed = 0;
+  m_LastQueuedTimeStamp = 0;
+  m_LastSavedTimeStamp = 0;
+}
+
+
+//-----------------------------------------------------------------------------
+unsigned int IGIDataSourceSaveQueue::GetNumberOfItemsWaiting() const
+{
+  QMutexLocker locker(&m_Mutex);
+
+  return m_Queue.size() + m_NumberInProgress;
+}
+
+
+//-----------------------------------------------------------------------------
+unsigned long int IGIDataSourceSaveQueue::GetNumberOfItemsSaved() const
+{
+  QMutexLocker locker(&m_Mutex);
+
+  return m_NumberSaved;
+}
+
+
+//-----------------------------------------------------------------------------
+unsigned long int IGIDataSourceSaveQueue::GetNumberOfItemsDropped() const
+{
+  QMutexLocker locker(&m_Mutex);
+
+  return m_NumberDropped;
+}
+
+
+//-----------------------------------------------------------------------------
+unsigned long int IGIDataSourceSaveQueue::GetNumberOfItemsFailed() const
+{
+  QMutexLocker locker(&m_Mutex);
+
+  return m_NumberFailed;
+}
+
+
+//-----------------------------------------------------------------------------
+unsigned int IGIDataSourceSaveQueue::GetLagInMilliseconds() const
+{
+  QMutexLocker locker(&m_Mutex);
+
+  if ((m_Queue.empty() && m_NumberInProgress == 0)
+      || m_LastSavedTimeStamp == 0
+      || m_LastQueuedTimeStamp < m_LastSavedTimeStamp)
+  {
+    return 0;
+  }
+  return (m_LastQueuedTimeStamp - m_LastSavedTimeStamp) / 1000000; // nanoseconds to milliseconds.
+}
+
+} // end namespace
@@ -0,0 +1,142 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#ifndef niftkIGIDataSourceSaveQueue_h
+#define niftkIGIDataSourceSaveQueue_h
+
+#include <niftkIGIDataSourcesExports.h>
+#include <niftkIGIDataSourceI.h>
+#include <niftkIGIDataType.h>
+#include <niftkIGISaveableDataSourceI.h>
+#include <niftkIGIBufferedSaveableDataSourceI.h>
+
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace niftk
+{
+
+class IGIDataSourceBackgroundSaveThread;
+
+/**
+* \class IGIDataSourceSaveQueue
+* \brief Bounded queue of niftk::IGIDataType waiting to be saved, drained by
+* a pool of niftk::IGIDataSourceBackgroundSaveThread workers.
+*
+* This decouples the grabbing thread from the speed of the disk and the image codec.
+* The grabbing thread calls AddItem(), and each worker repeatedly calls SaveBuffer(),
+* which hands items, one at a time, to IGIBufferedSaveableDataSourceI::SaveItem().
+* As there are several workers, items may be written out of order.
+*
+* If the queue is full, AddItem() blocks for up to GetMaximumWaitInMilliseconds()
+* to apply backpressure to the producer, and then drops the item, which is counted.
+* Once Stop() has been called, AddItem() drops every item, until Start() is called again.
+*
+* Items are shared with the data source's buffer, so must not be modified once queued.
+*
+* Note: This class MUST be kept thread-safe.
+*
+* Note: All errors should thrown as mitk::Exception or sub-classes thereof.
+*/
+class NIFTKIGIDATASOURCES_EXPORT IGIDataSourceSaveQueue : public IGISaveableDataSourceI
+{
+public:
+
+  IGIDataSourceSaveQueue(niftk::IGIBufferedSaveableDataSourceI* source,
+                         unsigned int maximumNumberOfItems,
+                         unsigned int numberOfThreads,
+                         unsigned int maximumWaitInMilliseconds);
+  virtual ~IGIDataSourceSaveQueue();
+
+  /**
+  * \brief Starts the worker threads.
+  */
+  void Start();
+
+  /**
+  * \brief Stops accepting items, waits for the queue to drain, then stops the worker threads.
+  */
+  void Stop();
+
+  /**
+  * \brief Blocks until every queued item has been saved (or failed).
+  */
+  void Flush();
+
+  /**
+  * \brief Queues an item for saving, returning false if it had to be dropped,
+  * because the queue is full or is stopping.
+  */
+  bool AddItem(const std::shared_ptr<niftk::IGIDataType>& item);
+
+  /**
+  * \brief Called by the worker threads, to save items until the queue is empty.
+  * \see IGISaveableDataSourceI::SaveBuffer()
+  */
+  virtual void SaveBuffer() override;
+
+  /**
+  * \brief Resets the saved, dropped and failed counters, e.g. at the start of recording.
+  */
+  void ResetCounters();
+
+  unsigned int GetMaximumNumberOfItems() const { return m_MaximumNumberOfItems; }
+  unsigned int GetNumberOfThreads() const { return m_NumberOfThreads; }
+  unsigned int GetMaximumWaitInMilliseconds() const { return m_MaximumWaitInMilliseconds; }
+
+  /**
+  * \brief Returns the number of items queued or currently being saved.
+  */
+  unsigned int GetNumberOfItemsWaiting() const;
+  unsigned long int GetNumberOfItemsSaved() const;
+  unsigned long int GetNumberOfItemsDropped() const;
+  unsigned long int GetNumberOfItemsFailed() const;
+
+  /**
+  * \brief Returns how far behind the savers are, i.e. the time between
+  * the most recently queued item and the most recently saved item.
+  */
+  unsigned int GetLagInMilliseconds() const;
+
+protected:
+
+  IGIDataSourceSaveQueue(const IGIDataSourceSaveQueue&); // Purposefully not implemented.
+  IGIDataSourceSaveQueue& operator=(const IGIDataSourceSaveQueue&); // Purposefully not implemented.
+
+private:
+
+  niftk::IGIBufferedSaveableDataSourceI*                      m_DataSource;
+  unsigned int                                                m_MaximumNumberOfItems;
+  unsigned int                                                m_NumberOfThreads;
+  unsigned int                                                m_MaximumWaitInMilliseconds;
+  mutable QMutex                                              m_Mutex;
+  QWaitCondition                                              m_ItemRemoved;
+  std::deque<std::shared_ptr<niftk::IGIDataType> >            m_Queue;
+  std::vector<niftk::IGIDataSourceBackgroundSaveThread*>      m_Threads;
+  bool                                                        m_IsStopping;
+  unsigned int                                                m_NumberInProgress;
+  unsigned long int                                           m_NumberSaved;
+  unsigned long int                                           m_NumberDropped;
+  unsigned long int                                           m_NumberFailed;
+  niftk::IGIDataSourceI::IGITimeType                          m_LastQueuedTimeStamp;
+  niftk::IGIDataSourceI::IGITimeType                          m_LastSavedTimeStamp;
+};
+
+} // end namespace
+
+#endif
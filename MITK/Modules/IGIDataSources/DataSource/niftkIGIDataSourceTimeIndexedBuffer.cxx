@@ -0,0 +1,320 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#include "niftkIGIDataSourceTimeIndexedBuffer.h"
+#include <mitkExceptionMacro.h>
+#include <itkMutexLockHolder.h>
+
+namespace niftk
+{
+
+//-----------------------------------------------------------------------------
+IGIDataSourceTimeIndexedBuffer::IGIDataSourceTimeIndexedBuffer(BufferType::size_type numberOfItems)
+: m_NumberOfItems(numberOfItems)
+, m_NumberOfSlots(numberOfItems + 1)
+, m_Head(0)
+, m_Tail(0)
+{
+  if (m_NumberOfItems < 1)
+  {
+    mitkThrow() << "Buffer size should be a number >= 1";
+  }
+
+  // One spare slot, so the writer never overwrites an item that readers may still be looking at.
+  m_Buffer.resize(m_NumberOfSlots);
+  m_TimeStamps.reset(new AtomicTimeType[m_NumberOfSlots]);
+  for (BufferType::size_type i = 0; i < m_NumberOfSlots; i++)
+  {
+    m_TimeStamps[i] = 0;
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+IGIDataSourceTimeIndexedBuffer::~IGIDataSourceTimeIndexedBuffer()
+{
+}
+
+
+//-----------------------------------------------------------------------------
+void IGIDataSourceTimeIndexedBuffer::GetRange(SequenceType& first, SequenceType& end) const
+{
+  end = m_Head.load();
+  first = m_Tail.load();
+
+  if (end > m_NumberOfItems && end - m_NumberOfItems > first)
+  {
+    first = end - m_NumberOfItems;
+  }
+  if (first > end)
+  {
+    first = end;
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+bool IGIDataSourceTimeIndexedBuffer::IsRangeStillValid(const SequenceType& first) const
+{
+  // The writer may be part way through writing item number m_Head,
+  // which lives in the same slot as item number (m_Head - m_NumberOfSlots).
+  return m_Tail.load() <= first && m_Head.load() < first + m_NumberOfSlots;
+}
+
+
+//-----------------------------------------------------------------------------
+niftk::IGIDataSourceI::IGITimeType IGIDataSourceTimeIndexedBuffer::GetTimeStamp(
+    const SequenceType& sequenceNumber) const
+{
+  return m_TimeStamps[sequenceNumber % m_NumberOfSlots].load();
+}
+
+
+//-----------------------------------------------------------------------------
+IGIDataSourceTimeIndexedBuffer::SequenceType IGIDataSourceTimeIndexedBuffer::UpperBound(
+    const SequenceType& first,
+    const SequenceType& end,
+    const niftk::IGIDataSourceI::IGITimeType& time) const
+{
+  SequenceType low = first;
+  SequenceType high = end;
+
+  while (low < high)
+  {
+    SequenceType middle = low + (high - low) / 2;
+    if (this->GetTimeStamp(middle) <= time)
+    {
+      low = middle + 1;
+    }
+    else
+    {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+
+//-----------------------------------------------------------------------------
+unsigned int IGIDataSourceTimeIndexedBuffer::GetBufferSize() const
+{
+  SequenceType first = 0;
+  SequenceType end = 0;
+  this->GetRange(first, end);
+
+  return static_cast<unsigned int>(end - first);
+}
+
+
+//-----------------------------------------------------------------------------
+void IGIDataSourceTimeIndexedBuffer::InternalCleanBuffer()
+{
+  SequenceType end = m_Head.load();
+
+  // Move the tail first, so that readers reject anything they find in the slots we are about to reset.
+  m_Tail.store(end);
+
+  for (BufferType::size_type i = 0; i < m_NumberOfSlots; i++)
+  {
+    std::shared_ptr<niftk::IGIDataType> empty;
+    std::atomic_store(&m_Buffer[i], empty);
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+void IGIDataSourceTimeIndexedBuffer::CleanBuffer()
+{
+  itk::MutexLockHolder<itk::FastMutexLock> lock(*m_Mutex);
+
+  this->InternalCleanBuffer();
+}
+
+
+//-----------------------------------------------------------------------------
+void IGIDataSourceTimeIndexedBuffer::AddToBuffer(std::unique_ptr<niftk::IGIDataType>& item)
+{
+  std::shared_ptr<niftk::IGIDataType> newItem(item.release());
+  this->AddToBuffer(newItem);
+}
+
+
+//-----------------------------------------------------------------------------
+void IGIDataSourceTimeIndexedBuffer::AddToBuffer(const std::shared_ptr<niftk::IGIDataType>& newItem)
+{
+  if (!newItem)
+  {
+    mitkThrow() << "Null item provided";
+  }
+
+  itk::MutexLockHolder<itk::FastMutexLock> lock(*m_Mutex);
+
+  niftk::IGIDataSourceI::IGITimeType timeStamp = newItem->GetTimeStampInNanoSeconds();
+
+  SequenceType head = m_Head.load();
+  if (head > m_Tail.load() && timeStamp < this->GetTimeStamp(head - 1))
+  {
+    // Time has gone backwards, e.g. during playback, so start again to keep the index sorted.
+    this->InternalCleanBuffer();
+  }
+
+  // Nobody can be reading this slot, as it is outside of the range returned by GetRange().
+  BufferType::size_type slot = head % m_NumberOfSlots;
+  m_TimeStamps[slot].store(timeStamp);
+  std::atomic_store(&m_Buffer[slot], newItem);
+
+  // Publish the new item.
+  m_Head.store(head + 1);
+}
+
+
+//-----------------------------------------------------------------------------
+niftk::IGIDataSourceI::IGITimeType IGIDataSourceTimeIndexedBuffer::GetFirstTimeStamp() const
+{
+  while (true)
+  {
+    SequenceType first = 0;
+    SequenceType end = 0;
+    this->GetRange(first, end);
+
+    if (first == end)
+    {
+      mitkThrow() << "Empty Buffer, so can't get first time stamp";
+    }
+
+    niftk::IGIDataSourceI::IGITimeType result = this->GetTimeStamp(first);
+    if (this->IsRangeStillValid(first))
+    {
+      return result;
+    }
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+niftk::IGIDataSourceI::IGITimeType IGIDataSourceTimeIndexedBuffer::GetLastTimeStamp() const
+{
+  while (true)
+  {
+    SequenceType first = 0;
+    SequenceType end = 0;
+    this->GetRange(first, end);
+
+    if (first == end)
+    {
+      mitkThrow() << "Empty Buffer, so can't get last time stamp";
+    }
+
+    niftk::IGIDataSourceI::IGITimeType result = this->GetTimeStamp(end - 1);
+    if (this->IsRangeStillValid(end - 1))
+    {
+      return result;
+    }
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+bool IGIDataSourceTimeIndexedBuffer::Contains(const niftk::IGIDataSourceI::IGITimeType& time) const
+{
+  while (true)
+  {
+    SequenceType first = 0;
+    SequenceType end = 0;
+    this->GetRange(first, end);
+
+    if (first == end)
+    {
+      return false;
+    }
+
+    SequenceType upper = this->UpperBound(first, end, time);
+    bool containsIt = upper != first && this->GetTimeStamp(upper - 1) == time;
+
+    if (this->IsRangeStillValid(first))
+    {
+      return containsIt;
+    }
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+std::shared_ptr<niftk::IGIDataType> IGIDataSourceTimeIndexedBuffer::FindItem(
+    const niftk::IGIDataSourceI::IGITimeType& time) const
+{
+  while (true)
+  {
+    SequenceType first = 0;
+    SequenceType end = 0;
+    this->GetRange(first, end);
+
+    if (first == end)
+    {
+      return std::shared_ptr<niftk::IGIDataType>();
+    }
+
+    // If first item in buffer is later than requested time,
+    // we don't have any data early enough, so abandon.
+    SequenceType upper = this->UpperBound(first, end, time);
+    if (upper == first)
+    {
+      if (this->IsRangeStillValid(first))
+      {
+        return std::shared_ptr<niftk::IGIDataType>();
+      }
+      continue;
+    }
+
+    // Take a reference, so the item stays alive even if the writer replaces it now.
+    SequenceType closest = upper - 1;
+    std::shared_ptr<niftk::IGIDataType> result
+        = std::atomic_load(&m_Buffer[closest % m_NumberOfSlots]);
+
+    if (this->IsRangeStillValid(first)
+        && result
+        && result->GetTimeStampInNanoSeconds() == this->GetTimeStamp(closest))
+    {
+      return result;
+    }
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+bool IGIDataSourceTimeIndexedBuffer::CopyOutItem(const niftk::IGIDataSourceI::IGITimeType& time,
+                                                 niftk::IGIDataType& item) const
+{
+  // m_Lag is a single word, only set from the GUI thread, so we read it without locking.
+  niftk::IGIDataSourceI::IGITimeType lag = m_Lag;
+
+  if (time < lag)
+  {
+    mitkThrow() << "The requested time " << time
+                << " is obviously too small, suggesting a programming bug." << std::endl;
+  }
+
+  niftk::IGIDataSourceI::IGITimeType effectiveTime = time - lag; // normally lag is zero.
+
+  std::shared_ptr<niftk::IGIDataType> closest = this->FindItem(effectiveTime);
+  if (!closest)
+  {
+    return false;
+  }
+
+  item.Clone(*closest);
+  return true;
+}
+
+} // end namespace
@@ -0,0 +1,158 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#ifndef niftkIGIDataSourceTimeIndexedBuffer_h
+#define niftkIGIDataSourceTimeIndexedBuffer_h
+
+#include <niftkIGIDataSourcesExports.h>
+#include "niftkIGIDataSourceBuffer.h"
+#include <niftkIGIDataSourceI.h>
+#include <niftkIGIDataType.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace niftk
+{
+
+/**
+* \class IGIDataSourceTimeIndexedBuffer
+* \brief Manages a fixed size buffer of niftk::IGIDataType, indexed by time stamp,
+* assuming niftk::IGIDataType items are inserted in time order.
+*
+* Items are stored in a circular array, alongside a parallel array of time stamps,
+* so Contains() and CopyOutItem() are a binary search, i.e. O(log n) rather
+* than the O(n) of IGIDataSourceLinearBuffer and IGIDataSourceRingBuffer.
+*
+* The buffer assumes a single writer (normally the grabbing thread) and many
+* readers (normally the GUI thread). The writer publishes each item with atomic
+* operations, and readers validate what they read, retrying if the writer
+* wrapped around underneath them. So readers never wait on m_Mutex, which
+* is only used to serialise AddToBuffer() and CleanBuffer().
+*
+* If an item arrives with a time stamp earlier than the last item,
+* (e.g. when scrubbing backwards during playback), the buffer is emptied
+* first, so that the time stamps are always sorted.
+*
+* Note: This class MUST be kept thread-safe.
+*
+* Note: All errors should thrown as mitk::Exception or sub-classes thereof.
+*/
+class NIFTKIGIDATASOURCES_EXPORT IGIDataSourceTimeIndexedBuffer : public IGIDataSourceBuffer
+{
+public:
+
+  typedef std::vector<std::shared_ptr<niftk::IGIDataType> > BufferType;
+  typedef std::atomic<niftk::IGIDataSourceI::IGITimeType> AtomicTimeType;
+
+  IGIDataSourceTimeIndexedBuffer(BufferType::size_type numberOfItems);
+  virtual ~IGIDataSourceTimeIndexedBuffer();
+
+  /**
+  * \see IGIDataSourceBuffer::GetBufferSize();
+  */
+  virtual unsigned int GetBufferSize() const override;
+
+  /**
+  * \see IGIDataSourceBuffer::CleanBuffer()
+  */
+  virtual void CleanBuffer() override;
+
+  /**
+  * \see IGIDataSourceBuffer::Contains()
+  */
+  virtual bool Contains(const niftk::IGIDataSourceI::IGITimeType& time) const override;
+
+  /**
+  * \see IGIDataSourceBuffer::AddToBuffer()
+  */
+  virtual void AddToBuffer(std::unique_ptr<niftk::IGIDataType>& item) override;
+
+  /**
+  * \brief Adds an item that may also be shared with another owner, e.g. niftk::IGIDataSourceSaveQueue.
+  *
+  * Items must not be modified once added, as readers may be copying them at any time.
+  */
+  void AddToBuffer(const std::shared_ptr<niftk::IGIDataType>& item);
+
+  /**
+  * \see IGIDataSourceBuffer::GetFirstTimeStamp()
+  */
+  virtual niftk::IGIDataSourceI::IGITimeType GetFirstTimeStamp() const override;
+
+  /**
+  * \see IGIDataSourceBuffer::GetLastTimeStamp()
+  */
+  virtual niftk::IGIDataSourceI::IGITimeType GetLastTimeStamp() const override;
+
+  /**
+  * \see IGIDataSourceBuffer::CopyOutItem()
+  */
+  virtual bool CopyOutItem(const niftk::IGIDataSourceI::IGITimeType& time,
+                           niftk::IGIDataType& item) const override;
+
+protected:
+
+  IGIDataSourceTimeIndexedBuffer& operator=(const IGIDataSourceTimeIndexedBuffer&); // Purposefully not implemented.
+  IGIDataSourceTimeIndexedBuffer(const IGIDataSourceTimeIndexedBuffer&); // Purposefully not implemented.
+
+private:
+
+  typedef unsigned long long SequenceType;
+
+  /**
+  * \brief Takes a consistent snapshot of the valid range of sequence numbers, [first, end).
+  */
+  void GetRange(SequenceType& first, SequenceType& end) const;
+
+  /**
+  * \brief Returns true if the slots from sequence number first onwards have not been
+  * overwritten or cleaned since the snapshot was taken by GetRange().
+  */
+  bool IsRangeStillValid(const SequenceType& first) const;
+
+  /**
+  * \brief Returns the sequence number of the first item with a time stamp strictly greater than time.
+  */
+  SequenceType UpperBound(const SequenceType& first,
+                          const SequenceType& end,
+                          const niftk::IGIDataSourceI::IGITimeType& time) const;
+
+  /**
+  * \brief Returns the time stamp stored for a given sequence number, which may be stale.
+  */
+  niftk::IGIDataSourceI::IGITimeType GetTimeStamp(const SequenceType& sequenceNumber) const;
+
+  /**
+  * \brief Returns the item at or most closely before time, or an empty pointer.
+  */
+  std::shared_ptr<niftk::IGIDataType> FindItem(const niftk::IGIDataSourceI::IGITimeType& time) const;
+
+  /**
+  * \brief Empties the buffer, and must be called with m_Mutex held.
+  */
+  void InternalCleanBuffer();
+
+  BufferType                        m_Buffer;
+  std::unique_ptr<AtomicTimeType[]> m_TimeStamps;
+  BufferType::size_type             m_NumberOfItems;
+  BufferType::size_type             m_NumberOfSlots;
+  std::atomic<SequenceType>         m_Head; // number of items ever added.
+  std::atomic<SequenceType>         m_Tail; // sequence number of first item after the last clean.
+};
+
+} // end namespace
+
+#endif
@@ -0,0 +1,227 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#include "niftkIGIDataSourceUpdateScheduler.h"
+#include <niftkIGIPreparableDataSourceI.h>
+#include <mitkExceptionMacro.h>
+#include <mitkLogMacros.h>
+
+#include <QElapsedTimer>
+#include <QRunnable>
+#include <QThread>
+
+#include <algorithm>
+#include <memory>
+
+namespace
+{
+
+/**
+* \brief Calls PrepareUpdate() for one source, recording how long it took, and any error.
+*/
+class PrepareUpdateTask : public QRunnable
+{
+public:
+
+  PrepareUpdateTask(niftk::IGIPreparableDataSourceI* source,
+                    const niftk::IGIDataSourceI::IGITimeType& time)
+  : m_Source(source)
+  , m_Time(time)
+  , m_ElapsedInMilliseconds(0)
+  , m_Failed(false)
+  {
+    this->setAutoDelete(false);
+  }
+
+  virtual void run() override
+  {
+    QElapsedTimer timer;
+    timer.start();
+
+    try
+    {
+      m_Source->PrepareUpdate(m_Time);
+    }
+    catch (std::exception& e)
+    {
+      m_Failed = true;
+      m_ErrorMessage = e.what();
+    }
+    catch (...)
+    {
+      m_Failed = true;
+      m_ErrorMessage = "Unknown error";
+    }
+
+    m_ElapsedInMilliseconds = timer.nsecsElapsed() / 1000000.0;
+  }
+
+  double GetElapsedInMilliseconds() const { return m_ElapsedInMilliseconds; }
+  bool GetFailed() const { return m_Failed; }
+  std::string GetErrorMessage() const { return m_ErrorMessage; }
+
+private:
+  niftk::IGIPreparableDataSourceI*   m_Source;
+  niftk::IGIDataSourceI::IGITimeType m_Time;
+  double                             m_ElapsedInMilliseconds;
+  bool                               m_Failed;
+  std::string                        m_ErrorMessage;
+};
+
+} // end namespace
+
+namespace niftk
+{
+
+//-----------------------------------------------------------------------------
+IGIDataSourceUpdateScheduler::IGIDataSourceUpdateScheduler(unsigned int numberOfThreads)
+: m_NumberOfThreads(0)
+{
+  this->SetNumberOfThreads(numberOfThreads);
+}
+
+
+//-----------------------------------------------------------------------------
+IGIDataSourceUpdateScheduler::~IGIDataSourceUpdateScheduler()
+{
+  m_ThreadPool.waitForDone();
+}
+
+
+//-----------------------------------------------------------------------------
+void IGIDataSourceUpdateScheduler::SetNumberOfThreads(unsigned int numberOfThreads)
+{
+  if (numberOfThreads == 0)
+  {
+    numberOfThreads = std::max(QThread::idealThreadCount(), 1);
+  }
+  m_NumberOfThreads = numberOfThreads;
+  m_ThreadPool.setMaxThreadCount(m_NumberOfThreads);
+}
+
+
+//-----------------------------------------------------------------------------
+unsigned int IGIDataSourceUpdateScheduler::GetNumberOfThreads() const
+{
+  return m_NumberOfThreads;
+}
+
+
+//-----------------------------------------------------------------------------
+std::vector<IGIDataSourceUpdateLatency> IGIDataSourceUpdateScheduler::GetLatencies() const
+{
+  return m_Latencies;
+}
+
+
+//-----------------------------------------------------------------------------
+int IGIDataSourceUpdateScheduler::GetSlowestSourceIndex() const
+{
+  int result = -1;
+  double slowest = -1;
+  for (int i = 0; i < m_Latencies.size(); i++)
+  {
+    double total = m_Latencies[i].m_PrepareInMilliseconds + m_Latencies[i].m_UpdateInMilliseconds;
+    if (total > slowest)
+    {
+      slowest = total;
+      result = i;
+    }
+  }
+  return result;
+}
+
+
+//-----------------------------------------------------------------------------
+std::vector<std::vector<IGIDataItemInfo> > IGIDataSourceUpdateScheduler::Update(
+    const QList<niftk::IGIDataSourceI::Pointer>& sources,
+    const niftk::IGIDataSourceI::IGITimeType& time)
+{
+  m_Latencies.clear();
+  m_Latencies.resize(sources.size());
+
+  // Phase 1: Prepare, in parallel, any source that can be prepared.
+  std::vector<std::unique_ptr<PrepareUpdateTask> > tasks(sources.size());
+  int numberOfTasks = 0;
+
+  for (int i = 0; i < sources.size(); i++)
+  {
+    niftk::IGIPreparableDataSourceI* preparable
+      = dynamic_cast<niftk::IGIPreparableDataSourceI*>(sources[i].GetPointer());
+
+    if (preparable != nullptr)
+    {
+      tasks[i].reset(new PrepareUpdateTask(preparable, time));
+      numberOfTasks++;
+    }
+  }
+
+  if (m_NumberOfThreads > 1 && numberOfTasks > 1)
+  {
+    for (int i = 0; i < tasks.size(); i++)
+    {
+      if (tasks[i])
+      {
+        m_ThreadPool.start(tasks[i].get());
+      }
+    }
+    m_ThreadPool.waitForDone();
+  }
+  else
+  {
+    for (int i = 0; i < tasks.size(); i++)
+    {
+      if (tasks[i])
+      {
+        tasks[i]->run();
+      }
+    }
+  }
+
+  // Phase 2: Update each source in turn on this thread, as this writes to mitk::DataStorage.
+  std::vector<std::vector<IGIDataItemInfo> > result(sources.size());
+  for (int i = 0; i < sources.size(); i++)
+  {
+    m_Latencies[i].m_Name = sources[i]->GetName();
+
+    if (tasks[i])
+    {
+      m_Latencies[i].m_PrepareInMilliseconds = tasks[i]->GetElapsedInMilliseconds();
+      if (tasks[i]->GetFailed())
+      {
+        MITK_ERROR << "IGIDataSourceUpdateScheduler: " << sources[i]->GetName().toStdString()
+                   << " failed to prepare for time " << time
+                   << ", due to " << tasks[i]->GetErrorMessage();
+      }
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    result[i] = sources[i]->Update(time);
+
+    m_Latencies[i].m_UpdateInMilliseconds = timer.nsecsElapsed() / 1000000.0;
+
+    unsigned int latency = static_cast<unsigned int>(m_Latencies[i].m_PrepareInMilliseconds
+                                                     + m_Latencies[i].m_UpdateInMilliseconds + 0.5);
+    for (int j = 0; j < result[i].size(); j++)
+    {
+      result[i][j].m_UpdateLatencyInMilliseconds = latency;
+    }
+  }
+
+  return result;
+}
+
+} // end namespace
@@ -0,0 +1,118 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#ifndef niftkIGIDataSourceUpdateScheduler_h
+#define niftkIGIDataSourceUpdateScheduler_h
+
+#include <niftkIGIDataSourcesExports.h>
+#include <niftkIGIDataSourceI.h>
+
+#include <QList>
+#include <QString>
+#include <QThreadPool>
+
+#include <vector>
+
+namespace niftk
+{
+
+/**
+* \class IGIDataSourceUpdateLatency
+* \brief Time taken by one data source during the last call to IGIDataSourceUpdateScheduler::Update().
+*/
+struct NIFTKIGIDATASOURCES_EXPORT IGIDataSourceUpdateLatency
+{
+  IGIDataSourceUpdateLatency()
+  : m_PrepareInMilliseconds(0)
+  , m_UpdateInMilliseconds(0)
+  {
+  }
+
+  QString m_Name;
+  double  m_PrepareInMilliseconds; // on the thread pool.
+  double  m_UpdateInMilliseconds;  // on the calling (GUI) thread.
+};
+
+
+/**
+* \class IGIDataSourceUpdateScheduler
+* \brief Updates a list of data sources, running the niftk::IGIPreparableDataSourceI::PrepareUpdate()
+* of each source in parallel on a thread pool, then calling IGIDataSourceI::Update() for each
+* source in turn on the calling thread.
+*
+* So, with several sources playing back, the time per tick is limited by the
+* slowest source's playback loading and buffer lookup, rather than the sum of them all,
+* while all mitk::DataStorage writes still happen on the GUI thread.
+*
+* Sources that do not implement niftk::IGIPreparableDataSourceI are just updated on the
+* calling thread. If a source throws from PrepareUpdate(), the error is logged
+* and Update() is still called, which will repeat the work (and throw if it must).
+*
+* The time taken by each source is available from GetLatencies(), and the
+* total is also returned in IGIDataItemInfo::m_UpdateLatencyInMilliseconds.
+*
+* Note: Update() should only be called from one thread, normally the GUI thread.
+*
+* Note: All errors should thrown as mitk::Exception or sub-classes thereof.
+*/
+class NIFTKIGIDATASOURCES_EXPORT IGIDataSourceUpdateScheduler
+{
+public:
+
+  /**
+  * \param numberOfThreads if zero, uses QThread::idealThreadCount().
+  */
+  IGIDataSourceUpdateScheduler(unsigned int numberOfThreads = 0);
+  virtual ~IGIDataSourceUpdateScheduler();
+
+  /**
+  * \brief Sets the maximum number of threads for PrepareUpdate(), or zero for QThread::idealThreadCount().
+  *
+  * A value of 1 prepares each source in turn on the calling thread.
+  */
+  void SetNumberOfThreads(unsigned int numberOfThreads);
+  unsigned int GetNumberOfThreads() const;
+
+  /**
+  * \brief Updates all sources to the given time, returning the info from each source, in order.
+  */
+  std::vector<std::vector<IGIDataItemInfo> > Update(const QList<niftk::IGIDataSourceI::Pointer>& sources,
+                                                    const niftk::IGIDataSourceI::IGITimeType& time);
+
+  /**
+  * \brief Returns the latency of each source from the last call to Update(), in order.
+  */
+  std::vector<IGIDataSourceUpdateLatency> GetLatencies() const;
+
+  /**
+  * \brief Returns the index of the source that took longest in the last call
+  * to Update(), i.e. the one limiting the frame rate, or -1 if there were no sources.
+  */
+  int GetSlowestSourceIndex() const;
+
+protected:
+
+  IGIDataSourceUpdateScheduler(const IGIDataSourceUpdateScheduler&); // Purposefully not implemented.
+  IGIDataSourceUpdateScheduler& operator=(const IGIDataSourceUpdateScheduler&); // Purposefully not implemented.
+
+private:
+
+  unsigned int                             m_NumberOfThreads;
+  QThreadPool                              m_ThreadPool;
+  std::vector<IGIDataSourceUpdateLatency>  m_Latencies;
+};
+
+} // end namespace
+
+#endif
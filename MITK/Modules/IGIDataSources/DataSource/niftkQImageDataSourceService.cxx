@@ -42,6 +42,10 @@ QImageDataSourceService::QImageDataSourceService(
 //-----------------------------------------------------------------------------
 QImageDataSourceService::~QImageDataSourceService()
 {
+  // Make sure queued frames are written while SaveImage() is still available,
+  // and that nothing is being read ahead while LoadImage() is still available.
+  this->StopRecording();
+  this->StopPlayback();
 }
 
 
@@ -66,8 +70,6 @@ void QImageDataSourceService::SaveImage(const std::string& filename,
   {
     mitkThrow() << "Failed to save QImageDataType to file:" << filename;
   }
-
-  data.SetIsSaved(true);
 }
 
 
@@ -86,6 +88,19 @@ std::unique_ptr<niftk::IGIDataType> QImageDataSourceService::LoadImage(const std
 }
 
 
+//-----------------------------------------------------------------------------
+size_t QImageDataSourceService::GetImageSizeInBytes(const niftk::IGIDataType& item) const
+{
+  const niftk::QImageDataType* dataType = dynamic_cast<const niftk::QImageDataType*>(&item);
+  if (dataType == nullptr || dataType->GetImage() == nullptr)
+  {
+    return 0;
+  }
+  const QImage* image = dataType->GetImage();
+  return static_cast<size_t>(image->width()) * image->height() * (image->depth() / 8);
+}
+
+
 //-----------------------------------------------------------------------------
 mitk::Image::Pointer QImageDataSourceService::RetrieveImage(const niftk::IGIDataSourceI::IGITimeType& requestedTime,
                                                             niftk::IGIDataSourceI::IGITimeType& actualTime,
@@ -68,6 +68,11 @@ protected:
    */
   virtual std::unique_ptr<niftk::IGIDataType> LoadImage(const std::string& filename) override;
 
+  /**
+   * \see niftk::SingleFrameDataSourceService::GetImageSizeInBytes().
+   */
+  virtual size_t GetImageSizeInBytes(const niftk::IGIDataType& item) const override;
+
 private:
 
   QImageDataSourceService(const QImageDataSourceService&); // deliberately not implemented
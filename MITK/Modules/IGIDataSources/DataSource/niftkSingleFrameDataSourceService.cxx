@@ -20,10 +20,33 @@
 #include <mitkImageWriteAccessor.h>
 #include <QDir>
 #include <QMutexLocker>
+#include <QThread>
+
+#include <algorithm>
 
 namespace niftk
 {
 
+//-----------------------------------------------------------------------------
+namespace
+{
+
+/**
+* \brief Encoding is CPU bound, so use a few cores, but leave some for grabbing and rendering.
+*/
+unsigned int GetDefaultNumberOfSaveThreads()
+{
+  int numberOfThreads = QThread::idealThreadCount() / 2;
+  return static_cast<unsigned int>(std::max(1, std::min(4, numberOfThreads)));
+}
+
+/**
+* \brief Upper limit on memory used for frames decoded ahead of the playback position.
+*/
+const size_t s_MaximumPlaybackCacheSizeInBytes = 512 * 1024 * 1024;
+
+} // end anonymous namespace
+
 //-----------------------------------------------------------------------------
 niftk::IGIDataSourceLocker SingleFrameDataSourceService::s_Lock;
 
@@ -43,6 +66,18 @@ SingleFrameDataSourceService::SingleFrameDataSourceService(
 , m_Buffer(bufferSize)
 , m_ApproxIntervalInMilliseconds(0)
 , m_FileExtension(".jpg") // faster than .png, but lossy.
+, m_SaveQueue(this,
+              std::max(1u, framesPerSecond * 2),  // i.e. allow saving to fall 2 seconds behind,
+              GetDefaultNumberOfSaveThreads(),
+              1000 / std::max(1u, framesPerSecond)) // and then block grabbing for up to 1 frame.
+, m_PlaybackCache(this,
+                  std::max(1u, framesPerSecond), // i.e. read ahead 1 second at normal speed.
+                  s_MaximumPlaybackCacheSizeInBytes)
+, m_LastFrameSizeInBytes(0)
+, m_IsPrepared(false)
+, m_PreparedTime(0)
+, m_PreparedActualTime(0)
+, m_PreparedNumberOfBytes(0)
 {
   this->SetStatus("Initialising");
 
@@ -168,12 +203,26 @@ void SingleFrameDataSourceService::StartPlayback(niftk::IGIDataSourceI::IGITimeT
   {
     assert(false);
   }
+
+  m_PlaybackCache.SetPlaybackIndex(m_PlaybackIndex);
+  m_PlaybackCache.ResetCounters();
+  m_PlaybackCache.Start();
 }
 
 
 //-----------------------------------------------------------------------------
 void SingleFrameDataSourceService::StopPlayback()
 {
+  m_PlaybackCache.Stop();
+
+  if (m_PlaybackCache.GetNumberOfHits() + m_PlaybackCache.GetNumberOfMisses() > 0)
+  {
+    MITK_INFO << "SingleFrameDataSourceService(" << this->GetName().toStdString()
+              << "): Playback cache hits=" << m_PlaybackCache.GetNumberOfHits()
+              << ", misses=" << m_PlaybackCache.GetNumberOfMisses()
+              << ", evictions=" << m_PlaybackCache.GetNumberOfEvictions();
+  }
+
   m_PlaybackIndex.clear();
   m_Buffer.CleanBuffer();
 
@@ -181,6 +230,34 @@ void SingleFrameDataSourceService::StopPlayback()
 }
 
 
+//-----------------------------------------------------------------------------
+void SingleFrameDataSourceService::StartRecording()
+{
+  m_SaveQueue.ResetCounters();
+  m_SaveQueue.Start();
+
+  IGIDataSource::StartRecording();
+}
+
+
+//-----------------------------------------------------------------------------
+void SingleFrameDataSourceService::StopRecording()
+{
+  IGIDataSource::StopRecording();
+
+  // Blocks until all queued frames are on disk.
+  m_SaveQueue.Stop();
+
+  if (m_SaveQueue.GetNumberOfItemsDropped() > 0 || m_SaveQueue.GetNumberOfItemsFailed() > 0)
+  {
+    MITK_WARN << "SingleFrameDataSourceService(" << this->GetName().toStdString()
+              << "): Saved " << m_SaveQueue.GetNumberOfItemsSaved()
+              << " frames, dropped " << m_SaveQueue.GetNumberOfItemsDropped()
+              << " and failed to save " << m_SaveQueue.GetNumberOfItemsFailed();
+  }
+}
+
+
 //-----------------------------------------------------------------------------
 void SingleFrameDataSourceService::PlaybackData(niftk::IGIDataSourceI::IGITimeType requestedTimeStamp)
 {
@@ -197,18 +274,12 @@ void SingleFrameDataSourceService::PlaybackData(niftk::IGIDataSourceI::IGITimeTy
   {
     if (!m_Buffer.Contains(*i))
     {
-      std::ostringstream  filename;
-      filename << this->GetPlaybackDirectory().toStdString() << '/' << (*i) << m_FileExtension.toStdString();
-
-      std::unique_ptr<niftk::IGIDataType> wrapper = this->LoadImage(filename.str());
+      std::unique_ptr<niftk::IGIDataType> wrapper = m_PlaybackCache.TakeItem(*i);
       if (!wrapper)
       {
-        mitkThrow() << "Failed to create wrapper for:" << filename.str();
+        mitkThrow() << "Failed to create wrapper for time:" << *i;
       }
-      wrapper->SetTimeStampInNanoSeconds(*i);
       wrapper->SetFrameId(m_FrameId++);
-      wrapper->SetDuration(this->GetTimeStampTolerance()); // nanoseconds
-      wrapper->SetShouldBeSaved(false);
       m_Buffer.AddToBuffer(wrapper);
     }
     this->SetStatus("Playing back");
@@ -216,6 +287,34 @@ void SingleFrameDataSourceService::PlaybackData(niftk::IGIDataSourceI::IGITimeTy
 }
 
 
+//-----------------------------------------------------------------------------
+std::unique_ptr<niftk::IGIDataType> SingleFrameDataSourceService::LoadPlaybackItem(
+    const std::string& /*bufferName*/,
+    const niftk::IGIDataSourceI::IGITimeType& time,
+    size_t& numberOfBytes)
+{
+  std::ostringstream  filename;
+  filename << this->GetPlaybackDirectory().toStdString() << '/' << time << m_FileExtension.toStdString();
+
+  std::unique_ptr<niftk::IGIDataType> wrapper = this->LoadImage(filename.str());
+  if (!wrapper)
+  {
+    mitkThrow() << "Failed to create wrapper for:" << filename.str();
+  }
+  wrapper->SetTimeStampInNanoSeconds(time);
+  wrapper->SetDuration(this->GetTimeStampTolerance()); // nanoseconds
+  wrapper->SetShouldBeSaved(false);
+
+  // Cost the frame by its decoded image, falling back to the size of the last one displayed.
+  numberOfBytes = this->GetImageSizeInBytes(*wrapper);
+  if (numberOfBytes == 0)
+  {
+    numberOfBytes = m_LastFrameSizeInBytes;
+  }
+  return wrapper;
+}
+
+
 //-----------------------------------------------------------------------------
 void SingleFrameDataSourceService::GrabData()
 {
@@ -231,17 +330,26 @@ void SingleFrameDataSourceService::GrabData()
   wrapper->SetDuration(this->GetTimeStampTolerance()); // nanoseconds
   wrapper->SetShouldBeSaved(this->GetIsRecording());
 
+  // The same item is shared between the save queue and the buffer, so no copy is made.
+  std::shared_ptr<niftk::IGIDataType> item(wrapper.release());
+
   if (this->GetIsRecording())
   {
-    this->SaveItem(*wrapper);
-    this->SetStatus("Saving");
+    if (m_SaveQueue.AddItem(item))
+    {
+      this->SetStatus("Saving");
+    }
+    else
+    {
+      this->SetStatus("Dropping");
+    }
   }
   else
   {
     this->SetStatus("Grabbing");
   }
 
-  m_Buffer.AddToBuffer(wrapper);
+  m_Buffer.AddToBuffer(item);
 }
 
 
@@ -254,8 +362,8 @@ void SingleFrameDataSourceService::SaveItem(niftk::IGIDataType& data)
   {
     QString fileName =  directoryPath + QDir::separator()
                         + tr("%1").arg(data.GetTimeStampInNanoSeconds()) + m_FileExtension;
+    // We don't call data.SetIsSaved(), as the item is shared read-only with m_Buffer.
     this->SaveImage(fileName.toStdString(), data);
-    data.SetIsSaved(true);
   }
   else
   {
@@ -264,6 +372,34 @@ void SingleFrameDataSourceService::SaveItem(niftk::IGIDataType& data)
 }
 
 
+//-----------------------------------------------------------------------------
+void SingleFrameDataSourceService::PrepareUpdate(const niftk::IGIDataSourceI::IGITimeType& time)
+{
+  m_IsPrepared = false;
+  m_PreparedImage = nullptr;
+  m_PreparedActualTime = 0;
+  m_PreparedNumberOfBytes = 0;
+
+  if (!this->GetShouldUpdate())
+  {
+    return;
+  }
+
+  if (this->GetIsPlayingBack())
+  {
+    this->PlaybackData(time);
+  }
+
+  if (m_Buffer.GetBufferSize() > 0 && m_Buffer.GetFirstTimeStamp() <= time)
+  {
+    m_PreparedImage = this->RetrieveImage(time, m_PreparedActualTime, m_PreparedNumberOfBytes);
+  }
+
+  m_PreparedTime = time;
+  m_IsPrepared = true;
+}
+
+
 //-----------------------------------------------------------------------------
 std::vector<IGIDataItemInfo> SingleFrameDataSourceService::Update(const niftk::IGIDataSourceI::IGITimeType& time)
 {
@@ -277,6 +413,9 @@ std::vector<IGIDataItemInfo> SingleFrameDataSourceService::Update(const niftk::I
   info.m_FramesPerSecond = m_Buffer.GetFrameRate();
   info.m_IsLate = true;
   info.m_LagInMilliseconds = 0;
+  info.m_NumberOfItemsWaitingToSave = m_SaveQueue.GetNumberOfItemsWaiting();
+  info.m_NumberOfDroppedItems = m_SaveQueue.GetNumberOfItemsDropped();
+  info.m_SaveLagInMilliseconds = m_SaveQueue.GetLagInMilliseconds();
   infos.push_back(info);
 
   // If we are not actually updating data, bail out.
@@ -285,9 +424,13 @@ std::vector<IGIDataItemInfo> SingleFrameDataSourceService::Update(const niftk::I
     return infos;
   }
 
+  // If PrepareUpdate() has already loaded and converted the image for this time, we reuse it.
+  bool isPrepared = m_IsPrepared && m_PreparedTime == time;
+  m_IsPrepared = false;
+
   // This loads playback-data into the buffers, so must
   // come before the check for empty buffer.
-  if (this->GetIsPlayingBack())
+  if (this->GetIsPlayingBack() && !isPrepared)
   {
     this->PlaybackData(time);
   }
@@ -316,7 +459,18 @@ std::vector<IGIDataItemInfo> SingleFrameDataSourceService::Update(const niftk::I
   niftk::IGIDataSourceI::IGITimeType actualTime;
   unsigned int numberOfBytes = 0;
 
-  mitk::Image::Pointer convertedImage = this->RetrieveImage(time, actualTime, numberOfBytes);
+  mitk::Image::Pointer convertedImage;
+  if (isPrepared)
+  {
+    convertedImage = m_PreparedImage;
+    actualTime = m_PreparedActualTime;
+    numberOfBytes = m_PreparedNumberOfBytes;
+    m_PreparedImage = nullptr;
+  }
+  else
+  {
+    convertedImage = this->RetrieveImage(time, actualTime, numberOfBytes);
+  }
   if (numberOfBytes == 0)
   {
     MITK_DEBUG << "Failed to find data for time " << time
@@ -324,6 +478,7 @@ std::vector<IGIDataItemInfo> SingleFrameDataSourceService::Update(const niftk::I
                << ", last=" << m_Buffer.GetLastTimeStamp() << std::endl;
     return infos;
   }
+  m_LastFrameSizeInBytes = numberOfBytes;
 
   mitk::Image::Pointer imageInNode = dynamic_cast<mitk::Image*>(node->GetData());
   if (!imageInNode.IsNull())
@@ -18,12 +18,18 @@
 #include <niftkIGIDataSource.h>
 #include <niftkIGIDataSourceLocker.h>
 #include <niftkIGILocalDataSourceI.h>
-#include <niftkIGIDataSourceRingBuffer.h>
+#include <niftkIGIBufferedSaveableDataSourceI.h>
+#include <niftkIGIPlaybackLoadableDataSourceI.h>
+#include <niftkIGIPreparableDataSourceI.h>
+#include <niftkIGIDataSourceTimeIndexedBuffer.h>
+#include <niftkIGIDataSourceSaveQueue.h>
+#include <niftkIGIDataSourcePlaybackCache.h>
 #include <mitkImage.h>
 
 #include <QObject>
 #include <QMutex>
 #include <QString>
+#include <atomic>
 #include <memory>
 
 namespace niftk
@@ -33,6 +39,15 @@ namespace niftk
 * \class SingleFrameDataSourceService
 * \brief Base class for simple data sources, that save frame by frame.
 * For example, we save each image frame as .jpg/.png rather than some video format like .h264.
+*
+* When recording, frames are encoded and written by a niftk::IGIDataSourceSaveQueue,
+* so the grabbing thread is not limited by the speed of the codec or disk.
+* The number of frames waiting, dropped and the save lag are reported via Update().
+*
+* During playback, frames are read ahead of the playback position by a
+* niftk::IGIDataSourcePlaybackCache, so decoding is not done on the GUI thread.
+* The buffer lookup and conversion to mitk::Image is done in PrepareUpdate(),
+* so that niftk::IGIDataSourceUpdateScheduler can run it off the GUI thread too.
 * \see OpenCVVideoDataSourceService
 * \see QtCameraVideoDataSourceService
 *
@@ -42,6 +57,9 @@ class NIFTKIGIDATASOURCES_EXPORT SingleFrameDataSourceService
     : public QObject
     , public IGIDataSource
     , public IGILocalDataSourceI
+    , public IGIBufferedSaveableDataSourceI
+    , public IGIPlaybackLoadableDataSourceI
+    , public IGIPreparableDataSourceI
 {
 
 public:
@@ -65,6 +83,16 @@ public:
   */
   virtual void StopPlayback() override;
 
+  /**
+  * \see IGIDataSourceI::StartRecording()
+  */
+  virtual void StartRecording() override;
+
+  /**
+  * \see IGIDataSourceI::StopRecording()
+  */
+  virtual void StopRecording() override;
+
   /**
   * \see IGIDataSourceI::PlaybackData()
   */
@@ -85,11 +113,31 @@ public:
   */
   virtual std::vector<IGIDataItemInfo> Update(const niftk::IGIDataSourceI::IGITimeType& time) override;
 
+  /**
+  * \brief Loads playback data and retrieves the image for the given time, ready for Update().
+  * \see niftk::IGIPreparableDataSourceI::PrepareUpdate()
+  */
+  virtual void PrepareUpdate(const niftk::IGIDataSourceI::IGITimeType& time) override;
+
   /**
   * \see niftk::IGILocalDataSourceI::GrabData()
   */
   virtual void GrabData() override;
 
+  /**
+  * \brief Saves a single item, called from the niftk::IGIDataSourceSaveQueue worker threads.
+  * \see niftk::IGIBufferedSaveableDataSourceI::SaveItem()
+  */
+  virtual void SaveItem(niftk::IGIDataType& item) override;
+
+  /**
+  * \brief Loads a single frame, called from the niftk::IGIDataSourcePlaybackCache prefetch thread.
+  * \see niftk::IGIPlaybackLoadableDataSourceI::LoadPlaybackItem()
+  */
+  virtual std::unique_ptr<niftk::IGIDataType> LoadPlaybackItem(const std::string& bufferName,
+                                                               const niftk::IGIDataSourceI::IGITimeType& time,
+                                                               size_t& numberOfBytes) override;
+
 protected:
 
   SingleFrameDataSourceService(QString deviceName,
@@ -121,6 +169,9 @@ protected:
 
   /**
    * \brief Derived classes must save the item to the given filename.
+   *
+   * Called on the save queue's worker threads, while the GUI thread may be reading the
+   * same item from the buffer, so implementations must not modify it, e.g. with SetIsSaved().
    */
   virtual void SaveImage(const std::string& filename, niftk::IGIDataType& item) = 0;
 
@@ -132,25 +183,41 @@ protected:
    */
   virtual std::unique_ptr<niftk::IGIDataType> LoadImage(const std::string& filename) = 0;
 
+  /**
+   * \brief Derived classes should return the size of the image held by an item returned from LoadImage().
+   *
+   * Used to cost prefetched playback frames, before any has been displayed.
+   * Returns 0 if unknown, in which case the size of the last frame displayed is used.
+   */
+  virtual size_t GetImageSizeInBytes(const niftk::IGIDataType& /*item*/) const { return 0; }
+
   int GetChannelNumber() const                              { return m_ChannelNumber;}
   int GetApproximateIntervalInMilliseconds() const          { return m_ApproxIntervalInMilliseconds; }
   void SetApproximateIntervalInMilliseconds(const int& ms);
 
   static niftk::IGIDataSourceLocker                         s_Lock;
-  niftk::IGIDataSourceRingBuffer                            m_Buffer;
+  niftk::IGIDataSourceTimeIndexedBuffer                     m_Buffer;
 
 private:
 
   SingleFrameDataSourceService(const SingleFrameDataSourceService&); // deliberately not implemented
   SingleFrameDataSourceService& operator=(const SingleFrameDataSourceService&); // deliberately not impl'd.
 
-  void SaveItem(niftk::IGIDataType& item);
-
   int                                          m_ChannelNumber;
   niftk::IGIDataSourceI::IGIIndexType          m_FrameId;
   std::set<niftk::IGIDataSourceI::IGITimeType> m_PlaybackIndex;
   int                                          m_ApproxIntervalInMilliseconds;
   QString                                      m_FileExtension;
+  niftk::IGIDataSourceSaveQueue                m_SaveQueue;
+  niftk::IGIDataSourcePlaybackCache            m_PlaybackCache;
+  std::atomic<unsigned int>                    m_LastFrameSizeInBytes;
+
+  // Written by PrepareUpdate(), and consumed by the following Update().
+  bool                                         m_IsPrepared;
+  niftk::IGIDataSourceI::IGITimeType           m_PreparedTime;
+  niftk::IGIDataSourceI::IGITimeType           m_PreparedActualTime;
+  unsigned int                                 m_PreparedNumberOfBytes;
+  mitk::Image::Pointer                         m_PreparedImage;
 
 }; // end class
 
@@ -52,12 +52,24 @@ struct NIFTKIGIDATASOURCES_EXPORT IGIDataItemInfo
     m_IsLate = false;
     m_LagInMilliseconds = 0;
     m_FramesPerSecond = 0;
+    m_NumberOfItemsWaitingToSave = 0;
+    m_NumberOfDroppedItems = 0;
+    m_SaveLagInMilliseconds = 0;
+    m_UpdateLatencyInMilliseconds = 0;
   }
 
   QString      m_Name;
   bool         m_IsLate;
   unsigned int m_LagInMilliseconds;
   float        m_FramesPerSecond;
+
+  // Only filled in by sources that save asynchronously, see niftk::IGIDataSourceSaveQueue.
+  unsigned int m_NumberOfItemsWaitingToSave;
+  unsigned int m_NumberOfDroppedItems;
+  unsigned int m_SaveLagInMilliseconds;
+
+  // Filled in by niftk::IGIDataSourceUpdateScheduler, time taken to prepare and update the source.
+  unsigned int m_UpdateLatencyInMilliseconds;
 };
 
 
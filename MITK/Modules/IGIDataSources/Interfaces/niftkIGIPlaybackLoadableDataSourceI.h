@@ -0,0 +1,62 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#ifndef niftkIGIPlaybackLoadableDataSourceI_h
+#define niftkIGIPlaybackLoadableDataSourceI_h
+
+#include "niftkIGIDataSourcesExports.h"
+#include <niftkIGIDataSourceI.h>
+#include <niftkIGIDataType.h>
+
+#include <memory>
+#include <string>
+
+namespace niftk
+{
+
+/**
+* \brief Abstract base class for data sources that can load a single recorded item,
+* so that loading can be done ahead of time by niftk::IGIDataSourcePlaybackCache.
+*
+* LoadPlaybackItem() is called from a background thread, so must not
+* touch the data source's buffers or the mitk::DataStorage.
+*
+* Note: All errors should thrown as mitk::Exception or sub-classes thereof.
+*/
+class NIFTKIGIDATASOURCES_EXPORT IGIPlaybackLoadableDataSourceI
+{
+public:
+
+  /**
+  * \brief Loads the item recorded for bufferName at exactly the given time.
+  * \param numberOfBytes output, approximate memory used by the item, or zero if unknown.
+  * \return the item, with its time stamp set, or an empty pointer if there is nothing to load.
+  */
+  virtual std::unique_ptr<niftk::IGIDataType> LoadPlaybackItem(const std::string& bufferName,
+                                                               const niftk::IGIDataSourceI::IGITimeType& time,
+                                                               size_t& numberOfBytes) = 0;
+
+protected:
+
+  IGIPlaybackLoadableDataSourceI() {} // Purposefully hidden.
+  virtual ~IGIPlaybackLoadableDataSourceI() {} // Purposefully hidden.
+
+  IGIPlaybackLoadableDataSourceI(const IGIPlaybackLoadableDataSourceI&); // Purposefully not implemented.
+  IGIPlaybackLoadableDataSourceI& operator=(const IGIPlaybackLoadableDataSourceI&); // Purposefully not implemented.
+
+};
+
+} // end namespace
+
+#endif
@@ -0,0 +1,46 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#ifndef niftkIGIPrefetchableDataSourceI_h
+#define niftkIGIPrefetchableDataSourceI_h
+
+#include "niftkIGIDataSourcesExports.h"
+
+namespace niftk
+{
+
+/**
+* \brief Abstract base class for things that can read ahead during playback.
+*
+* Note: All errors should thrown as mitk::Exception or sub-classes thereof.
+*/
+class NIFTKIGIDATASOURCES_EXPORT IGIPrefetchableDataSourceI
+{
+public:
+
+  virtual void Prefetch() = 0;
+
+protected:
+
+  IGIPrefetchableDataSourceI() {} // Purposefully hidden.
+  virtual ~IGIPrefetchableDataSourceI() {} // Purposefully hidden.
+
+  IGIPrefetchableDataSourceI(const IGIPrefetchableDataSourceI&); // Purposefully not implemented.
+  IGIPrefetchableDataSourceI& operator=(const IGIPrefetchableDataSourceI&); // Purposefully not implemented.
+
+};
+
+} // end namespace
+
+#endif
@@ -0,0 +1,57 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#ifndef niftkIGIPreparableDataSourceI_h
+#define niftkIGIPreparableDataSourceI_h
+
+#include "niftkIGIDataSourcesExports.h"
+#include <niftkIGIDataSourceI.h>
+
+namespace niftk
+{
+
+/**
+* \brief Abstract base class for data sources that can split IGIDataSourceI::Update()
+* into a thread-safe preparation step, and a step that writes to mitk::DataStorage.
+*
+* PrepareUpdate() is called by niftk::IGIDataSourceUpdateScheduler on a thread pool,
+* in parallel with other sources, and should do the expensive bits, such as loading
+* playback data and looking up and converting the item in the buffer.
+* It must not touch the mitk::DataStorage.
+*
+* IGIDataSourceI::Update() is then called, for the same time, on the GUI thread,
+* and should reuse whatever was prepared. If PrepareUpdate() was not called, or
+* was called for a different time, Update() must still work on its own.
+*
+* Note: All errors should thrown as mitk::Exception or sub-classes thereof.
+*/
+class NIFTKIGIDATASOURCES_EXPORT IGIPreparableDataSourceI
+{
+public:
+
+  virtual void PrepareUpdate(const niftk::IGIDataSourceI::IGITimeType& time) = 0;
+
+protected:
+
+  IGIPreparableDataSourceI() {} // Purposefully hidden.
+  virtual ~IGIPreparableDataSourceI() {} // Purposefully hidden.
+
+  IGIPreparableDataSourceI(const IGIPreparableDataSourceI&); // Purposefully not implemented.
+  IGIPreparableDataSourceI& operator=(const IGIPreparableDataSourceI&); // Purposefully not implemented.
+
+};
+
+} // end namespace
+
+#endif
@@ -15,6 +15,10 @@
 # tests with no extra command line parameter
 set(MODULE_TESTS
 #  niftkOpenCVDataSourceTest.cxx
+  niftkIGIDataSourceTimeIndexedBufferTest.cxx
+  niftkIGIDataSourceSaveQueueTest.cxx
+  niftkIGIDataSourcePlaybackCacheTest.cxx
+  niftkIGIDataSourceUpdateSchedulerTest.cxx
 )
 
 set(MODULE_CUSTOM_TESTS
@@ -0,0 +1,216 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#include <niftkIGIDataSourcePlaybackCache.h>
+#include <niftkIGIPlaybackLoadableDataSourceI.h>
+#include <niftkIGIDataType.h>
+#include <mitkTestingMacros.h>
+#include <mitkExceptionMacro.h>
+#include <mitkLogMacros.h>
+
+#include <QCoreApplication>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+
+#include <set>
+
+namespace
+{
+
+const niftk::IGIDataSourceI::IGITimeType s_Interval = 33333333; // 30 Hz, in nanoseconds.
+
+/**
+* \brief Pretends to be a slow decoder, counting how many items it was asked to load.
+*/
+class SlowLoadableSource : public niftk::IGIPlaybackLoadableDataSourceI
+{
+public:
+
+  SlowLoadableSource(unsigned long millisecondsPerItem, size_t bytesPerItem)
+  : m_MillisecondsPerItem(millisecondsPerItem)
+  , m_BytesPerItem(bytesPerItem)
+  , m_NumberOfLoads(0)
+  {
+  }
+
+  virtual std::unique_ptr<niftk::IGIDataType> LoadPlaybackItem(const std::string& /*bufferName*/,
+                                                               const niftk::IGIDataSourceI::IGITimeType& time,
+                                                               size_t& numberOfBytes) override
+  {
+    QThread::msleep(m_MillisecondsPerItem);
+
+    if (time % s_Interval != 0)
+    {
+      mitkThrow() << "No file for time " << time;
+    }
+
+    {
+      QMutexLocker locker(&m_Mutex);
+      m_NumberOfLoads++;
+    }
+
+    std::unique_ptr<niftk::IGIDataType> item(new niftk::IGIDataType());
+    item->SetTimeStampInNanoSeconds(time);
+    numberOfBytes = m_BytesPerItem;
+    return item;
+  }
+
+  unsigned int GetNumberOfLoads()
+  {
+    QMutexLocker locker(&m_Mutex);
+    return m_NumberOfLoads;
+  }
+
+private:
+  unsigned long m_MillisecondsPerItem;
+  size_t        m_BytesPerItem;
+  QMutex        m_Mutex;
+  unsigned int  m_NumberOfLoads;
+};
+
+
+//-----------------------------------------------------------------------------
+std::set<niftk::IGIDataSourceI::IGITimeType> CreateIndex(unsigned int numberOfItems)
+{
+  std::set<niftk::IGIDataSourceI::IGITimeType> index;
+  for (unsigned int i = 1; i <= numberOfItems; i++)
+  {
+    index.insert(i * s_Interval);
+  }
+  return index;
+}
+
+
+//-----------------------------------------------------------------------------
+unsigned int Play(niftk::IGIDataSourcePlaybackCache& cache,
+                  unsigned int first, unsigned int last, int step, unsigned long millisecondsPerFrame)
+{
+  unsigned int errors = 0;
+  for (int i = first; step > 0 ? i <= static_cast<int>(last) : i >= static_cast<int>(last); i += step)
+  {
+    std::unique_ptr<niftk::IGIDataType> item = cache.TakeItem(i * s_Interval);
+    if (!item || item->GetTimeStampInNanoSeconds() != i * s_Interval)
+    {
+      errors++;
+    }
+    QThread::msleep(millisecondsPerFrame);
+  }
+  return errors;
+}
+
+
+//-----------------------------------------------------------------------------
+void TestForwardsPlaybackHitsCache()
+{
+  SlowLoadableSource source(5, 1000);
+  niftk::IGIDataSourcePlaybackCache cache(&source, "test", 10, 1000000);
+  cache.SetPlaybackIndex(CreateIndex(100));
+  cache.Start();
+
+  // Playback is slower than loading, so after the first few, everything should come from the cache.
+  unsigned int errors = Play(cache, 1, 60, 1, 15);
+  cache.Stop();
+
+  MITK_TEST_CONDITION(errors == 0, "Forwards playback returned correct items, errors=" << errors);
+  MITK_TEST_CONDITION(cache.GetNumberOfHits() + cache.GetNumberOfMisses() == 60, "Counted every request.");
+  MITK_TEST_CONDITION(cache.GetHitRate() > 0.8, "Forwards hit rate=" << cache.GetHitRate());
+  MITK_TEST_CONDITION(cache.GetNumberOfItems() == 0, "Cache emptied by Stop().");
+
+  MITK_INFO << "Forwards: hits=" << cache.GetNumberOfHits()
+            << ", misses=" << cache.GetNumberOfMisses()
+            << ", evictions=" << cache.GetNumberOfEvictions()
+            << ", loads=" << source.GetNumberOfLoads();
+}
+
+
+//-----------------------------------------------------------------------------
+void TestBackwardsAndFastPlayback()
+{
+  SlowLoadableSource source(5, 1000);
+  niftk::IGIDataSourcePlaybackCache cache(&source, "test", 10, 1000000);
+  cache.SetPlaybackIndex(CreateIndex(200));
+  cache.Start();
+
+  unsigned int errors = Play(cache, 150, 100, -1, 15);
+  MITK_TEST_CONDITION(errors == 0, "Backwards playback returned correct items, errors=" << errors);
+  MITK_TEST_CONDITION(cache.GetHitRate() > 0.8, "Backwards hit rate=" << cache.GetHitRate());
+
+  // Fast forward, skipping frames, e.g. playing back at 3x speed.
+  cache.ResetCounters();
+  errors = Play(cache, 10, 190, 3, 15);
+  MITK_TEST_CONDITION(errors == 0, "Fast playback returned correct items, errors=" << errors);
+  MITK_TEST_CONDITION(cache.GetHitRate() > 0.8, "Fast hit rate=" << cache.GetHitRate());
+  MITK_TEST_CONDITION(cache.GetNumberOfEvictions() > 0, "Old backwards predictions evicted.");
+
+  cache.Stop();
+}
+
+
+//-----------------------------------------------------------------------------
+void TestMemoryIsBounded()
+{
+  SlowLoadableSource source(1, 1000);
+  niftk::IGIDataSourcePlaybackCache cache(&source, "test", 50, 5000);
+  cache.SetPlaybackIndex(CreateIndex(100));
+  cache.Start();
+
+  std::unique_ptr<niftk::IGIDataType> item = cache.TakeItem(1 * s_Interval);
+  QThread::msleep(200);
+
+  MITK_TEST_CONDITION(cache.GetNumberOfItems() <= 6, "At most one item over budget, items=" << cache.GetNumberOfItems());
+  MITK_TEST_CONDITION(cache.GetNumberOfBytes() <= 6000, "Bytes bounded, bytes=" << cache.GetNumberOfBytes());
+  MITK_TEST_CONDITION(cache.GetNumberOfItems() >= 5, "Cache was filled, items=" << cache.GetNumberOfItems());
+
+  cache.Stop();
+}
+
+
+//-----------------------------------------------------------------------------
+void TestLoadFailure()
+{
+  SlowLoadableSource source(1, 1000);
+  niftk::IGIDataSourcePlaybackCache cache(&source, "test", 5, 1000000);
+  cache.Start();
+
+  bool thrown = false;
+  try
+  {
+    cache.TakeItem(s_Interval + 1);
+  }
+  catch (const mitk::Exception&)
+  {
+    thrown = true;
+  }
+  MITK_TEST_CONDITION(thrown, "Failure to load is reported on the requesting thread.");
+  cache.Stop();
+}
+
+} // end namespace
+
+
+//-----------------------------------------------------------------------------
+int niftkIGIDataSourcePlaybackCacheTest(int argc, char* argv[])
+{
+  MITK_TEST_BEGIN("niftkIGIDataSourcePlaybackCacheTest");
+
+  QCoreApplication app(argc, argv);
+
+  TestForwardsPlaybackHitsCache();
+  TestBackwardsAndFastPlayback();
+  TestMemoryIsBounded();
+  TestLoadFailure();
+
+  MITK_TEST_END();
+}
@@ -0,0 +1,168 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#include <niftkIGIDataSourceSaveQueue.h>
+#include <niftkIGIBufferedSaveableDataSourceI.h>
+#include <niftkIGIDataType.h>
+#include <mitkTestingMacros.h>
+#include <mitkExceptionMacro.h>
+
+#include <QCoreApplication>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+
+#include <set>
+
+namespace
+{
+
+/**
+* \brief Pretends to be a slow encoder, remembering what it was asked to save.
+*/
+class SlowSaveableSource : public niftk::IGIBufferedSaveableDataSourceI
+{
+public:
+
+  SlowSaveableSource(unsigned long millisecondsPerItem)
+  : m_MillisecondsPerItem(millisecondsPerItem)
+  {
+  }
+
+  virtual void SaveItem(niftk::IGIDataType& item) override
+  {
+    QThread::msleep(m_MillisecondsPerItem);
+
+    if (item.GetFrameId() == 13)
+    {
+      mitkThrow() << "Unlucky frame";
+    }
+
+    QMutexLocker locker(&m_Mutex);
+    m_Saved.insert(item.GetTimeStampInNanoSeconds());
+  }
+
+  std::set<niftk::IGIDataSourceI::IGITimeType> GetSaved()
+  {
+    QMutexLocker locker(&m_Mutex);
+    return m_Saved;
+  }
+
+private:
+  unsigned long                                m_MillisecondsPerItem;
+  QMutex                                       m_Mutex;
+  std::set<niftk::IGIDataSourceI::IGITimeType> m_Saved;
+};
+
+
+//-----------------------------------------------------------------------------
+std::shared_ptr<niftk::IGIDataType> CreateItem(unsigned int i)
+{
+  std::shared_ptr<niftk::IGIDataType> item(new niftk::IGIDataType());
+  item->SetTimeStampInNanoSeconds((i + 1) * 1000000);
+  item->SetFrameId(i);
+  return item;
+}
+
+
+//-----------------------------------------------------------------------------
+void TestAllItemsSaved()
+{
+  SlowSaveableSource source(2);
+  niftk::IGIDataSourceSaveQueue queue(&source, 100, 4, 1000);
+  queue.Start();
+
+  for (unsigned int i = 0; i < 50; i++)
+  {
+    MITK_TEST_CONDITION(queue.AddItem(CreateItem(i)), "Queued item " << i);
+  }
+
+  queue.Stop();
+
+  MITK_TEST_CONDITION(queue.GetNumberOfItemsWaiting() == 0, "Queue drained, waiting=" << queue.GetNumberOfItemsWaiting());
+  MITK_TEST_CONDITION(queue.GetNumberOfItemsSaved() == 49, "Saved 49, actual=" << queue.GetNumberOfItemsSaved());
+  MITK_TEST_CONDITION(queue.GetNumberOfItemsFailed() == 1, "Failed 1, actual=" << queue.GetNumberOfItemsFailed());
+  MITK_TEST_CONDITION(queue.GetNumberOfItemsDropped() == 0, "Dropped 0, actual=" << queue.GetNumberOfItemsDropped());
+  MITK_TEST_CONDITION(source.GetSaved().size() == 49, "Source saw 49 distinct items.");
+}
+
+
+//-----------------------------------------------------------------------------
+void TestDropsWhenFull()
+{
+  SlowSaveableSource source(50);
+  niftk::IGIDataSourceSaveQueue queue(&source, 2, 1, 1);
+  queue.Start();
+
+  unsigned int numberAccepted = 0;
+  for (unsigned int i = 0; i < 20; i++)
+  {
+    if (queue.AddItem(CreateItem(i + 100)))
+    {
+      numberAccepted++;
+    }
+  }
+
+  MITK_TEST_CONDITION(queue.GetNumberOfItemsDropped() > 0, "Items dropped when full, dropped=" << queue.GetNumberOfItemsDropped());
+  MITK_TEST_CONDITION(queue.GetNumberOfItemsDropped() + numberAccepted == 20, "Every item accepted or dropped.");
+
+  queue.Flush();
+  MITK_TEST_CONDITION(queue.GetNumberOfItemsSaved() == numberAccepted, "All accepted items saved.");
+
+  queue.ResetCounters();
+  MITK_TEST_CONDITION(queue.GetNumberOfItemsDropped() == 0, "Counters reset.");
+}
+
+
+//-----------------------------------------------------------------------------
+void TestDropsWhenStopped()
+{
+  SlowSaveableSource source(1);
+  niftk::IGIDataSourceSaveQueue queue(&source, 100, 2, 1000);
+  queue.Start();
+
+  for (unsigned int i = 0; i < 10; i++)
+  {
+    queue.AddItem(CreateItem(i + 200));
+  }
+  queue.Stop();
+
+  // Nothing would ever save it, so it mustn't sit in the queue.
+  MITK_TEST_CONDITION(!queue.AddItem(CreateItem(300)), "Item rejected after Stop().");
+  MITK_TEST_CONDITION(queue.GetNumberOfItemsWaiting() == 0, "Nothing left waiting, waiting=" << queue.GetNumberOfItemsWaiting());
+  MITK_TEST_CONDITION(queue.GetNumberOfItemsDropped() == 1, "Rejected item counted as dropped, dropped=" << queue.GetNumberOfItemsDropped());
+  MITK_TEST_CONDITION(queue.GetNumberOfItemsSaved() == 10, "Items queued before Stop() saved, saved=" << queue.GetNumberOfItemsSaved());
+
+  queue.Start();
+  MITK_TEST_CONDITION(queue.AddItem(CreateItem(301)), "Items accepted again after Start().");
+  queue.Stop();
+  MITK_TEST_CONDITION(queue.GetNumberOfItemsSaved() == 11, "Saved after restart, saved=" << queue.GetNumberOfItemsSaved());
+}
+
+} // end namespace
+
+
+//-----------------------------------------------------------------------------
+int niftkIGIDataSourceSaveQueueTest(int argc, char* argv[])
+{
+  MITK_TEST_BEGIN("niftkIGIDataSourceSaveQueueTest");
+
+  QCoreApplication app(argc, argv);
+
+  TestAllItemsSaved();
+  TestDropsWhenFull();
+  TestDropsWhenStopped();
+
+  MITK_TEST_END();
+}
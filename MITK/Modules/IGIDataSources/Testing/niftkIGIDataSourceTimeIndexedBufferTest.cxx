@@ -0,0 +1,227 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#include <niftkIGIDataSourceTimeIndexedBuffer.h>
+#include <niftkIGIDataSourceLinearBuffer.h>
+#include <niftkIGIDataSourceRingBuffer.h>
+#include <niftkIGIDataType.h>
+#include <mitkTestingMacros.h>
+#include <mitkLogMacros.h>
+#include <igtlTimeStamp.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+
+namespace
+{
+
+const niftk::IGIDataSourceI::IGITimeType s_Interval = 16666666; // 60 Hz, in nanoseconds.
+
+//-----------------------------------------------------------------------------
+void FillBuffer(niftk::IGIDataSourceBuffer& buffer, unsigned int numberOfItems)
+{
+  for (unsigned int i = 1; i <= numberOfItems; i++)
+  {
+    std::unique_ptr<niftk::IGIDataType> item(new niftk::IGIDataType());
+    item->SetTimeStampInNanoSeconds(i * s_Interval);
+    item->SetFrameId(i);
+    buffer.AddToBuffer(item);
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+void TestAgainstLinearBuffer()
+{
+  const unsigned int numberOfItems = 100;
+
+  niftk::IGIDataSourceLinearBuffer linear(numberOfItems);
+  niftk::IGIDataSourceTimeIndexedBuffer indexed(numberOfItems);
+
+  MITK_TEST_CONDITION(indexed.GetBufferSize() == 0, "Buffer is initially empty.");
+  MITK_TEST_CONDITION(!indexed.Contains(s_Interval), "Empty buffer contains nothing.");
+
+  FillBuffer(linear, numberOfItems);
+  FillBuffer(indexed, numberOfItems);
+
+  MITK_TEST_CONDITION(indexed.GetBufferSize() == numberOfItems, "Buffer size is " << indexed.GetBufferSize());
+  MITK_TEST_CONDITION(indexed.GetFirstTimeStamp() == linear.GetFirstTimeStamp(), "First time stamps match.");
+  MITK_TEST_CONDITION(indexed.GetLastTimeStamp() == linear.GetLastTimeStamp(), "Last time stamps match.");
+
+  niftk::IGIDataType expected;
+  niftk::IGIDataType actual;
+
+  unsigned int mismatches = 0;
+  for (niftk::IGIDataSourceI::IGITimeType t = 0; t < (numberOfItems + 2) * s_Interval; t += s_Interval / 3)
+  {
+    bool expectedFound = linear.CopyOutItem(t, expected);
+    bool actualFound = indexed.CopyOutItem(t, actual);
+
+    if (expectedFound != actualFound
+        || (expectedFound && expected.GetFrameId() != actual.GetFrameId())
+        || linear.Contains(t) != indexed.Contains(t)
+       )
+    {
+      mismatches++;
+    }
+  }
+  MITK_TEST_CONDITION(mismatches == 0, "CopyOutItem() and Contains() match linear buffer, mismatches=" << mismatches);
+}
+
+
+//-----------------------------------------------------------------------------
+void TestWrapAroundAndClean()
+{
+  niftk::IGIDataSourceTimeIndexedBuffer indexed(10);
+  FillBuffer(indexed, 25);
+
+  MITK_TEST_CONDITION(indexed.GetBufferSize() == 10, "Buffer size is capped at 10.");
+  MITK_TEST_CONDITION(indexed.GetFirstTimeStamp() == 16 * s_Interval, "First item is number 16.");
+  MITK_TEST_CONDITION(indexed.GetLastTimeStamp() == 25 * s_Interval, "Last item is number 25.");
+  MITK_TEST_CONDITION(!indexed.Contains(15 * s_Interval), "Item 15 has been overwritten.");
+  MITK_TEST_CONDITION(indexed.Contains(16 * s_Interval), "Item 16 is still available.");
+
+  niftk::IGIDataType item;
+  MITK_TEST_CONDITION(!indexed.CopyOutItem(15 * s_Interval, item), "Nothing before first item.");
+
+  // Time going backwards restarts the buffer.
+  std::unique_ptr<niftk::IGIDataType> early(new niftk::IGIDataType());
+  early->SetTimeStampInNanoSeconds(3 * s_Interval);
+  indexed.AddToBuffer(early);
+  MITK_TEST_CONDITION(indexed.GetBufferSize() == 1, "Buffer restarted when time went backwards.");
+  MITK_TEST_CONDITION(indexed.GetFirstTimeStamp() == 3 * s_Interval, "First item is now number 3.");
+
+  indexed.CleanBuffer();
+  MITK_TEST_CONDITION(indexed.GetBufferSize() == 0, "Buffer is empty after clean.");
+  MITK_TEST_CONDITION(!indexed.CopyOutItem(30 * s_Interval, item), "Nothing to copy out after clean.");
+}
+
+
+//-----------------------------------------------------------------------------
+void TestConcurrentReaders()
+{
+  const unsigned int numberOfItems = 64;
+  const unsigned int numberToWrite = 200000;
+
+  niftk::IGIDataSourceTimeIndexedBuffer indexed(numberOfItems);
+  std::atomic<bool> finished(false);
+  std::atomic<unsigned int> errors(0);
+
+  std::thread writer([&]() {
+    FillBuffer(indexed, numberToWrite);
+    finished = true;
+  });
+
+  std::vector<std::thread> readers;
+  for (int r = 0; r < 3; r++)
+  {
+    readers.push_back(std::thread([&]() {
+      niftk::IGIDataType item;
+      while (!finished)
+      {
+        if (indexed.GetBufferSize() == 0)
+        {
+          continue;
+        }
+        niftk::IGIDataSourceI::IGITimeType last = indexed.GetLastTimeStamp();
+        if (indexed.CopyOutItem(last, item))
+        {
+          // Items are always at or before the requested time,
+          // and never older than the buffer could possibly hold.
+          if (item.GetTimeStampInNanoSeconds() > last
+              || item.GetTimeStampInNanoSeconds() != item.GetFrameId() * s_Interval
+              || item.GetFrameId() + numberOfItems + 1 < last / s_Interval)
+          {
+            errors++;
+          }
+        }
+      }
+    }));
+  }
+
+  writer.join();
+  for (size_t r = 0; r < readers.size(); r++)
+  {
+    readers[r].join();
+  }
+  MITK_TEST_CONDITION(errors == 0, "Concurrent readers saw consistent data, errors=" << errors);
+  MITK_TEST_CONDITION(indexed.GetLastTimeStamp() == numberToWrite * s_Interval, "Writer finished.");
+}
+
+
+//-----------------------------------------------------------------------------
+double TimeLookups(niftk::IGIDataSourceBuffer& buffer, unsigned int numberOfItems, unsigned int numberOfLookups)
+{
+  FillBuffer(buffer, numberOfItems);
+
+  igtl::TimeStamp::Pointer timer = igtl::TimeStamp::New();
+  niftk::IGIDataType item;
+
+  timer->GetTime();
+  niftk::IGIDataSourceI::IGITimeType start = timer->GetTimeStampInNanoseconds();
+
+  for (unsigned int i = 0; i < numberOfLookups; i++)
+  {
+    // Mimic the GUI tick: mostly asking for recent data.
+    niftk::IGIDataSourceI::IGITimeType t = (numberOfItems - (i % numberOfItems)) * s_Interval + s_Interval / 2;
+    buffer.Contains(t);
+    buffer.CopyOutItem(t, item);
+  }
+
+  timer->GetTime();
+  niftk::IGIDataSourceI::IGITimeType end = timer->GetTimeStampInNanoseconds();
+
+  return static_cast<double>(end - start) / static_cast<double>(numberOfLookups);
+}
+
+
+//-----------------------------------------------------------------------------
+void BenchmarkBuffers()
+{
+  const unsigned int numberOfLookups = 20000;
+  unsigned int depths[] = {60, 600, 6000};
+
+  for (unsigned int d = 0; d < 3; d++)
+  {
+    niftk::IGIDataSourceLinearBuffer linear(depths[d]);
+    niftk::IGIDataSourceRingBuffer ring(depths[d]);
+    niftk::IGIDataSourceTimeIndexedBuffer indexed(depths[d]);
+
+    double linearTime = TimeLookups(linear, depths[d], numberOfLookups);
+    double ringTime = TimeLookups(ring, depths[d], numberOfLookups);
+    double indexedTime = TimeLookups(indexed, depths[d], numberOfLookups);
+
+    MITK_INFO << "Buffer depth " << depths[d]
+              << ": ns per lookup, linear=" << linearTime
+              << ", ring=" << ringTime
+              << ", time-indexed=" << indexedTime;
+  }
+}
+
+} // end namespace
+
+
+//-----------------------------------------------------------------------------
+int niftkIGIDataSourceTimeIndexedBufferTest(int /*argc*/, char* /*argv*/[])
+{
+  MITK_TEST_BEGIN("niftkIGIDataSourceTimeIndexedBufferTest");
+
+  TestAgainstLinearBuffer();
+  TestWrapAroundAndClean();
+  TestConcurrentReaders();
+  BenchmarkBuffers();
+
+  MITK_TEST_END();
+}
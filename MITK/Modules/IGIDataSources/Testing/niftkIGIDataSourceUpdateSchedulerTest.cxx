@@ -0,0 +1,233 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#include <niftkIGIDataSourceUpdateScheduler.h>
+#include <niftkIGIPreparableDataSourceI.h>
+#include <mitkTestingMacros.h>
+#include <mitkExceptionMacro.h>
+#include <mitkLogMacros.h>
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QThread>
+
+namespace
+{
+
+/**
+* \brief Pretends to be a source that is slow to load and look up data,
+* recording which thread each step was called on.
+*/
+class SlowPreparableSource : public niftk::IGIDataSourceI, public niftk::IGIPreparableDataSourceI
+{
+public:
+
+  mitkClassMacroItkParent(SlowPreparableSource, niftk::IGIDataSourceI)
+  itkFactorylessNewMacro(Self)
+
+  void SetName(const QString& name) { m_Name = name; }
+  void SetMillisecondsToPrepare(unsigned long ms) { m_MillisecondsToPrepare = ms; }
+  void SetShouldFailToPrepare(bool shouldFail) { m_ShouldFailToPrepare = shouldFail; }
+
+  virtual void PrepareUpdate(const niftk::IGIDataSourceI::IGITimeType& time) override
+  {
+    m_PrepareThread = QThread::currentThread();
+    QThread::msleep(m_MillisecondsToPrepare);
+    if (m_ShouldFailToPrepare)
+    {
+      mitkThrow() << "Failed to prepare " << m_Name.toStdString();
+    }
+    m_PreparedTime = time;
+  }
+
+  virtual std::vector<niftk::IGIDataItemInfo> Update(const niftk::IGIDataSourceI::IGITimeType& time) override
+  {
+    m_UpdateThread = QThread::currentThread();
+    m_UpdateWasPrepared = (m_PreparedTime == time);
+
+    std::vector<niftk::IGIDataItemInfo> infos;
+    niftk::IGIDataItemInfo info;
+    info.m_Name = m_Name;
+    infos.push_back(info);
+    return infos;
+  }
+
+  QThread* GetPrepareThread() const { return m_PrepareThread; }
+  QThread* GetUpdateThread() const { return m_UpdateThread; }
+  bool GetUpdateWasPrepared() const { return m_UpdateWasPrepared; }
+
+  virtual QString GetName() const override { return m_Name; }
+  virtual QString GetFactoryName() const override { return "Test"; }
+  virtual QString GetStatus() const override { return "Test"; }
+  virtual QString GetDescription() const override { return "Test"; }
+  virtual void StartPlayback(niftk::IGIDataSourceI::IGITimeType, niftk::IGIDataSourceI::IGITimeType) override {}
+  virtual void StopPlayback() override {}
+  virtual void PlaybackData(niftk::IGIDataSourceI::IGITimeType) override {}
+  virtual void SetRecordingLocation(const QString&) override {}
+  virtual QString GetRecordingLocation() const override { return ""; }
+  virtual void SetPlaybackSourceName(const QString&) override {}
+  virtual QString GetPlaybackSourceName() const override { return ""; }
+  virtual void StartRecording() override {}
+  virtual void StopRecording() override {}
+  virtual void SetShouldUpdate(bool) override {}
+  virtual bool GetShouldUpdate() const override { return true; }
+  virtual bool ProbeRecordedData(niftk::IGIDataSourceI::IGITimeType*, niftk::IGIDataSourceI::IGITimeType*) override
+  {
+    return false;
+  }
+  virtual void SetProperties(const niftk::IGIDataSourceProperties&) override {}
+  virtual niftk::IGIDataSourceProperties GetProperties() const override { return niftk::IGIDataSourceProperties(); }
+
+protected:
+
+  SlowPreparableSource()
+  : m_MillisecondsToPrepare(0)
+  , m_ShouldFailToPrepare(false)
+  , m_PreparedTime(0)
+  , m_PrepareThread(nullptr)
+  , m_UpdateThread(nullptr)
+  , m_UpdateWasPrepared(false)
+  {
+  }
+  virtual ~SlowPreparableSource() {}
+
+private:
+  QString                            m_Name;
+  unsigned long                      m_MillisecondsToPrepare;
+  bool                               m_ShouldFailToPrepare;
+  niftk::IGIDataSourceI::IGITimeType m_PreparedTime;
+  QThread*                           m_PrepareThread;
+  QThread*                           m_UpdateThread;
+  bool                               m_UpdateWasPrepared;
+};
+
+
+//-----------------------------------------------------------------------------
+QList<niftk::IGIDataSourceI::Pointer> CreateSources(unsigned int numberOfSources, unsigned long millisecondsToPrepare)
+{
+  QList<niftk::IGIDataSourceI::Pointer> sources;
+  for (unsigned int i = 0; i < numberOfSources; i++)
+  {
+    SlowPreparableSource::Pointer source = SlowPreparableSource::New();
+    source->SetName(QString("Source-%1").arg(i));
+    source->SetMillisecondsToPrepare(millisecondsToPrepare * (i + 1));
+    sources.push_back(source.GetPointer());
+  }
+  return sources;
+}
+
+
+//-----------------------------------------------------------------------------
+double TimeUpdate(niftk::IGIDataSourceUpdateScheduler& scheduler,
+                  const QList<niftk::IGIDataSourceI::Pointer>& sources,
+                  unsigned int numberOfTicks)
+{
+  QElapsedTimer timer;
+  timer.start();
+  for (unsigned int i = 1; i <= numberOfTicks; i++)
+  {
+    scheduler.Update(sources, i);
+  }
+  return timer.nsecsElapsed() / 1000000.0 / numberOfTicks;
+}
+
+
+//-----------------------------------------------------------------------------
+void TestUpdateIsOnCallingThread()
+{
+  QList<niftk::IGIDataSourceI::Pointer> sources = CreateSources(4, 5);
+  niftk::IGIDataSourceUpdateScheduler scheduler(4);
+
+  std::vector<std::vector<niftk::IGIDataItemInfo> > infos = scheduler.Update(sources, 1);
+
+  MITK_TEST_CONDITION(infos.size() == sources.size(), "One list of infos per source.");
+  for (int i = 0; i < sources.size(); i++)
+  {
+    SlowPreparableSource* source = dynamic_cast<SlowPreparableSource*>(sources[i].GetPointer());
+    MITK_TEST_CONDITION(infos[i].size() == 1 && infos[i][0].m_Name == source->GetName(), "Infos in source order.");
+    MITK_TEST_CONDITION(source->GetUpdateThread() == QThread::currentThread(), "Update() on calling thread.");
+    MITK_TEST_CONDITION(source->GetPrepareThread() != QThread::currentThread(), "PrepareUpdate() on thread pool.");
+    MITK_TEST_CONDITION(source->GetUpdateWasPrepared(), "Update() followed PrepareUpdate() for the same time.");
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+void TestLatencyIsReported()
+{
+  QList<niftk::IGIDataSourceI::Pointer> sources = CreateSources(3, 10);
+  niftk::IGIDataSourceUpdateScheduler scheduler(3);
+
+  std::vector<std::vector<niftk::IGIDataItemInfo> > infos = scheduler.Update(sources, 1);
+  std::vector<niftk::IGIDataSourceUpdateLatency> latencies = scheduler.GetLatencies();
+
+  MITK_TEST_CONDITION(latencies.size() == 3, "One latency per source.");
+  MITK_TEST_CONDITION(latencies[2].m_PrepareInMilliseconds >= 25, "Slow source measured, ms="
+                      << latencies[2].m_PrepareInMilliseconds);
+  MITK_TEST_CONDITION(infos[2][0].m_UpdateLatencyInMilliseconds >= 25, "Latency copied to item info.");
+  MITK_TEST_CONDITION(scheduler.GetSlowestSourceIndex() == 2, "Slowest source identified, index="
+                      << scheduler.GetSlowestSourceIndex());
+}
+
+
+//-----------------------------------------------------------------------------
+void TestFailedPrepareStillUpdates()
+{
+  QList<niftk::IGIDataSourceI::Pointer> sources = CreateSources(2, 1);
+  SlowPreparableSource* failing = dynamic_cast<SlowPreparableSource*>(sources[0].GetPointer());
+  failing->SetShouldFailToPrepare(true);
+
+  niftk::IGIDataSourceUpdateScheduler scheduler(2);
+  std::vector<std::vector<niftk::IGIDataItemInfo> > infos = scheduler.Update(sources, 1);
+
+  MITK_TEST_CONDITION(infos.size() == 2 && infos[0].size() == 1, "Failing source was still updated.");
+  MITK_TEST_CONDITION(!failing->GetUpdateWasPrepared(), "Failing source updated without preparation.");
+}
+
+
+//-----------------------------------------------------------------------------
+void TestParallelIsFaster()
+{
+  // Two video sources, ultrasound, and three trackers, with made up costs.
+  QList<niftk::IGIDataSourceI::Pointer> sources = CreateSources(6, 3);
+
+  niftk::IGIDataSourceUpdateScheduler serial(1);
+  double serialTime = TimeUpdate(serial, sources, 10);
+
+  niftk::IGIDataSourceUpdateScheduler parallel(6);
+  double parallelTime = TimeUpdate(parallel, sources, 10);
+
+  MITK_INFO << "Update of 6 sources: serial=" << serialTime << "ms, parallel=" << parallelTime << "ms per tick.";
+
+  // Serial is the sum, 3+6+...+18=63ms, parallel is limited by the slowest, 18ms.
+  MITK_TEST_CONDITION(parallelTime < serialTime * 0.75, "Parallel update is faster.");
+}
+
+} // end namespace
+
+
+//-----------------------------------------------------------------------------
+int niftkIGIDataSourceUpdateSchedulerTest(int argc, char* argv[])
+{
+  MITK_TEST_BEGIN("niftkIGIDataSourceUpdateSchedulerTest");
+
+  QCoreApplication app(argc, argv);
+
+  TestUpdateIsOnCallingThread();
+  TestLatencyIsReported();
+  TestFailedPrepareStillUpdates();
+  TestParallelIsFaster();
+
+  MITK_TEST_END();
+}
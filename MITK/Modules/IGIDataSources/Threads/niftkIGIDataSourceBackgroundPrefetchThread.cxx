@@ -0,0 +1,40 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#include "niftkIGIDataSourceBackgroundPrefetchThread.h"
+
+namespace niftk
+{
+
+//-----------------------------------------------------------------------------
+IGIDataSourceBackgroundPrefetchThread::IGIDataSourceBackgroundPrefetchThread(QObject *parent, IGIPrefetchableDataSourceI *source)
+: IGITimerBasedThread(parent)
+, m_Source(source)
+{
+}
+
+
+//-----------------------------------------------------------------------------
+IGIDataSourceBackgroundPrefetchThread::~IGIDataSourceBackgroundPrefetchThread()
+{
+}
+
+
+//-----------------------------------------------------------------------------
+void IGIDataSourceBackgroundPrefetchThread::OnTimeoutImpl()
+{
+  m_Source->Prefetch();
+}
+
+} // end namespace
@@ -0,0 +1,46 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#ifndef niftkIGIDataSourceBackgroundPrefetchThread_h
+#define niftkIGIDataSourceBackgroundPrefetchThread_h
+
+#include "niftkIGIDataSourcesExports.h"
+#include "niftkIGITimerBasedThread.h"
+#include <niftkIGIPrefetchableDataSourceI.h>
+
+namespace niftk
+{
+
+/**
+* \class IGIDataSourceBackgroundPrefetchThread
+* \brief Thread class, based on IGITimerBasedThread to simply call "Prefetch".
+*/
+class NIFTKIGIDATASOURCES_EXPORT IGIDataSourceBackgroundPrefetchThread : public IGITimerBasedThread
+{
+public:
+  IGIDataSourceBackgroundPrefetchThread(QObject *parent, IGIPrefetchableDataSourceI *source);
+  virtual ~IGIDataSourceBackgroundPrefetchThread();
+
+  /**
+  * \see IGITimerBasedThread::OnTimeoutImpl()
+  */
+  virtual void OnTimeoutImpl() override;
+
+private:
+  IGIPrefetchableDataSourceI *m_Source;
+};
+
+} // end namespace
+
+#endif
@@ -17,6 +17,9 @@ set(H_FILES
   Interfaces/niftkIGILocalDataSourceI.h
   Interfaces/niftkIGISaveableDataSourceI.h
   Interfaces/niftkIGIBufferedSaveableDataSourceI.h
+  Interfaces/niftkIGIPrefetchableDataSourceI.h
+  Interfaces/niftkIGIPlaybackLoadableDataSourceI.h
+  Interfaces/niftkIGIPreparableDataSourceI.h
 )
 
 set(CPP_FILES
@@ -30,12 +33,17 @@ set(CPP_FILES
   DataSource/niftkIGIDataSourceBuffer.cxx
   DataSource/niftkIGIDataSourceRingBuffer.cxx
   DataSource/niftkIGIDataSourceLinearBuffer.cxx
+  DataSource/niftkIGIDataSourceTimeIndexedBuffer.cxx
   DataSource/niftkIGIDataSourceWaitingBuffer.cxx
+  DataSource/niftkIGIDataSourceSaveQueue.cxx
+  DataSource/niftkIGIDataSourcePlaybackCache.cxx
+  DataSource/niftkIGIDataSourceUpdateScheduler.cxx
   DataSource/niftkSingleFrameDataSourceService.cxx
   DataSource/niftkQImageDataSourceService.cxx
   Threads/niftkIGITimerBasedThread.cxx
   Threads/niftkIGIDataSourceGrabbingThread.cxx
   Threads/niftkIGIDataSourceBackgroundSaveThread.cxx
+  Threads/niftkIGIDataSourceBackgroundPrefetchThread.cxx
   Threads/niftkIGIDataSourceBackgroundDeleteThread.cxx
   Dialogs/niftkIGIInitialisationDialog.cxx
   Dialogs/niftkIGIConfigurationDialog.cxx
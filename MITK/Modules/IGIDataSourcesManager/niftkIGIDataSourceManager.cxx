@@ -225,6 +225,28 @@ int IGIDataSourceManager::GetFramesPerSecond() const
 }
 
 
+//-----------------------------------------------------------------------------
+void IGIDataSourceManager::SetNumberOfUpdateThreads(unsigned int numberOfThreads)
+{
+  QMutexLocker locker(&m_Lock);
+  m_UpdateScheduler.SetNumberOfThreads(numberOfThreads);
+}
+
+
+//-----------------------------------------------------------------------------
+std::vector<IGIDataSourceUpdateLatency> IGIDataSourceManager::GetUpdateLatencies() const
+{
+  return m_UpdateScheduler.GetLatencies();
+}
+
+
+//-----------------------------------------------------------------------------
+int IGIDataSourceManager::GetSlowestSourceIndex() const
+{
+  return m_UpdateScheduler.GetSlowestSourceIndex();
+}
+
+
 //-----------------------------------------------------------------------------
 void IGIDataSourceManager::WriteDescriptorFile(QString absolutePath)
 {
@@ -866,11 +888,14 @@ void IGIDataSourceManager::OnUpdateGui()
 
   niftk::IGIDataSourceI::IGITimeType currentTime = m_CurrentTime;
 
+  // Sources are prepared in parallel, but write to DataStorage here, on the GUI thread.
+  std::vector<std::vector<IGIDataItemInfo> > allDataItemInfos = m_UpdateScheduler.Update(m_Sources, currentTime);
+
   QList< QList<IGIDataItemInfo> > dataSourceInfos;
-  for (int i = 0; i < m_Sources.size(); i++)
+  for (int i = 0; i < allDataItemInfos.size(); i++)
   {
     QList<IGIDataItemInfo> qListDataItemInfos;
-    std::vector<IGIDataItemInfo> dataItemInfos = m_Sources[i]->Update(currentTime);
+    std::vector<IGIDataItemInfo>& dataItemInfos = allDataItemInfos[i];
     for (int j = 0; j < dataItemInfos.size(); j++)
     {
       qListDataItemInfos.push_back(dataItemInfos[j]);
@@ -19,6 +19,7 @@
 #include <niftkIGIDataSourceFactoryServiceI.h>
 #include <niftkIGIDataSourceI.h>
 #include <niftkIGIDataType.h>
+#include <niftkIGIDataSourceUpdateScheduler.h>
 
 #include <usServiceReference.h>
 #include <usModuleContext.h>
@@ -121,6 +122,23 @@ public:
   */
   int GetFramesPerSecond() const;
 
+  /**
+  * \brief Sets the number of threads used to prepare sources in parallel on each update,
+  * where zero means QThread::idealThreadCount(), and 1 updates each source in turn.
+  */
+  void SetNumberOfUpdateThreads(unsigned int numberOfThreads);
+
+  /**
+  * \brief Returns the time each source took during the last update, in the same order as the sources.
+  */
+  std::vector<IGIDataSourceUpdateLatency> GetUpdateLatencies() const;
+
+  /**
+  * \brief Returns the row number of the source that took longest during the
+  * last update, i.e. the one that limits the frame rate, or -1 if there are no sources.
+  */
+  int GetSlowestSourceIndex() const;
+
   /**
   * \brief Retrieves the name of all the available data source factory names.
   *
@@ -373,6 +391,7 @@ private:
   QMap<QString, niftk::IGIDataSourceFactoryServiceI*>              m_LegacyNameToFactoriesMap;
   QMutex                                                           m_Lock;
   QTimer                                                          *m_GuiUpdateTimer;
+  niftk::IGIDataSourceUpdateScheduler                              m_UpdateScheduler;
   int                                                              m_FrameRate;
   QString                                                          m_DirectoryPrefix;
   QString                                                          m_PlaybackPrefix;
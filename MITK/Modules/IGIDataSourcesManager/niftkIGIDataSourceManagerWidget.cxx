@@ -328,6 +328,7 @@ void IGIDataSourceManagerWidget::OnUpdateFinishedDataSources(
 
     QString framesPerSecondString("");
     QString lagInMillisecondsString("");
+    QString saveStatusString("");
 
     niftk::IGIDataSourceI::Pointer source = m_Manager->GetSource(r);
     QTableWidgetItem *item1 = new QTableWidgetItem(source->GetStatus());
@@ -369,8 +370,24 @@ void IGIDataSourceManagerWidget::OnUpdateFinishedDataSources(
           framesPerSecondString.append(QString(":"));
           lagInMillisecondsString.append(QString(":"));
         }
+
+        if (infoForOneRow[i].m_NumberOfItemsWaitingToSave > 0 || infoForOneRow[i].m_NumberOfDroppedItems > 0)
+        {
+          saveStatusString.append(QString("%1: waiting to save=%2, dropped=%3, save lag=%4ms\n")
+                                  .arg(infoForOneRow[i].m_Name)
+                                  .arg(infoForOneRow[i].m_NumberOfItemsWaitingToSave)
+                                  .arg(infoForOneRow[i].m_NumberOfDroppedItems)
+                                  .arg(infoForOneRow[i].m_SaveLagInMilliseconds));
+        }
       }
+      saveStatusString.append(QString("update took %1ms").arg(infoForOneRow[0].m_UpdateLatencyInMilliseconds));
+      if (r == m_Manager->GetSlowestSourceIndex())
+      {
+        saveStatusString.append(QString(" (slowest source)"));
+      }
+
       item1->setIcon(QIcon(QPixmap::fromImage(iconAsImage)));
+      item1->setToolTip(saveStatusString.trimmed());
     }
 
     m_TableWidget->setItem(r, 1, item1);
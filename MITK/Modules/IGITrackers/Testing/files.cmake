@@ -18,5 +18,6 @@ set(MODULE_TESTS
 
 set(MODULE_CUSTOM_TESTS
   niftkIGISingleFileBackendTest.cxx
+  niftkIGISingleFileRecordingTest.cxx
 )
 
@@ -0,0 +1,283 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#include <niftkIGISingleFileRecording.h>
+#include <niftkIGISingleFileBackend.h>
+#include <niftkFileHelper.h>
+#include <mitkTestingMacros.h>
+#include <mitkLogMacros.h>
+#include <mitkExceptionMacro.h>
+#include <mitkStandaloneDataStorage.h>
+#include <igtlTimeStamp.h>
+#include <QDir>
+#include <fstream>
+#include <map>
+
+namespace
+{
+
+const unsigned int s_HeaderSize = 256;
+
+//-----------------------------------------------------------------------------
+void WriteRecord(std::ofstream& ofs, niftk::IGIDataSourceI::IGITimeType time, double value)
+{
+  // Same layout as IGISingleFileBackend::SaveItem().
+  ofs.write(reinterpret_cast<char*>(&time), sizeof(time));
+  for (int i = 0; i < 7; i++)
+  {
+    double v = value + i;
+    ofs.write(reinterpret_cast<char*>(&v), sizeof(v));
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+std::map<niftk::IGIDataSourceI::IGITimeType, double> WriteFile(const std::string& fileName,
+                                                              const std::vector<niftk::IGIDataSourceI::IGITimeType>& times,
+                                                              bool addTruncatedRecord)
+{
+  std::map<niftk::IGIDataSourceI::IGITimeType, double> expected;
+
+  std::ofstream ofs(fileName, std::ios::binary | std::ios::out);
+  ofs << niftk::GetTQRDFileHeader(s_HeaderSize);
+  for (size_t i = 0; i < times.size(); i++)
+  {
+    WriteRecord(ofs, times[i], static_cast<double>(i));
+    expected.insert(std::make_pair(times[i], static_cast<double>(i)));
+  }
+  if (addTruncatedRecord)
+  {
+    niftk::IGIDataSourceI::IGITimeType time = 1;
+    ofs.write(reinterpret_cast<char*>(&time), sizeof(time));
+  }
+  return expected;
+}
+
+
+//-----------------------------------------------------------------------------
+unsigned int CompareLookups(niftk::IGISingleFileRecording& recording,
+                            const std::map<niftk::IGIDataSourceI::IGITimeType, double>& expected)
+{
+  unsigned int errors = 0;
+  niftk::IGIDataSourceI::IGITimeType first = expected.begin()->first;
+  niftk::IGIDataSourceI::IGITimeType last = expected.rbegin()->first;
+
+  for (niftk::IGIDataSourceI::IGITimeType t = 0; t < last + 100; t += 7)
+  {
+    // This is what IGISingleFileBackend used to do, with the whole file parsed into a std::map.
+    std::map<niftk::IGIDataSourceI::IGITimeType, double>::const_iterator iter = expected.upper_bound(t);
+    if (iter != expected.begin())
+    {
+      --iter;
+    }
+
+    size_t i = 0;
+    niftk::IGIDataSourceI::IGITimeType time = 0;
+    mitk::Point4D rotation;
+    mitk::Vector3D translation;
+
+    if (!recording.FindClosestRecord(t, i))
+    {
+      errors++;
+      continue;
+    }
+    recording.GetRecord(i, time, rotation, translation);
+
+    if (time != iter->first
+        || rotation[0] != iter->second
+        || rotation[3] != iter->second + 3
+        || translation[2] != iter->second + 6
+        || (t >= first && time > t)
+        )
+    {
+      errors++;
+    }
+  }
+  return errors;
+}
+
+
+//-----------------------------------------------------------------------------
+void TestSortedFile(const std::string& directory)
+{
+  std::vector<niftk::IGIDataSourceI::IGITimeType> times;
+  for (unsigned int i = 0; i < 1000; i++)
+  {
+    times.push_back(1000 + i * 50);
+  }
+  std::string fileName = directory + "/sorted.tqrt";
+  std::map<niftk::IGIDataSourceI::IGITimeType, double> expected = WriteFile(fileName, times, true);
+
+  niftk::IGISingleFileRecording recording(QString::fromStdString(fileName), s_HeaderSize);
+  MITK_TEST_CONDITION(recording.GetNumberOfRecords() == 1000, "Truncated record ignored, records="
+                      << recording.GetNumberOfRecords());
+  MITK_TEST_CONDITION(recording.GetFirstTimeStamp() == 1000, "First time stamp=" << recording.GetFirstTimeStamp());
+  MITK_TEST_CONDITION(recording.GetLastTimeStamp() == 1000 + 999 * 50, "Last time stamp=" << recording.GetLastTimeStamp());
+
+  unsigned int errors = CompareLookups(recording, expected);
+  MITK_TEST_CONDITION(errors == 0, "Sorted lookups match std::map, errors=" << errors);
+}
+
+
+//-----------------------------------------------------------------------------
+void TestUnsortedFile(const std::string& directory)
+{
+  // Neither the first nor the last record holds the earliest or latest time stamp.
+  std::vector<niftk::IGIDataSourceI::IGITimeType> times;
+  for (unsigned int i = 0; i < 500; i++)
+  {
+    times.push_back(1000 + ((i * 37 + 11) % 500) * 20);
+  }
+  std::string unsortedDirectory = directory + "/unsorted";
+  QDir().mkpath(QString::fromStdString(unsortedDirectory));
+  std::string fileName = unsortedDirectory + "/unsorted.tqrt";
+  std::map<niftk::IGIDataSourceI::IGITimeType, double> expected = WriteFile(fileName, times, false);
+
+  {
+    niftk::IGISingleFileRecording recording(QString::fromStdString(fileName), s_HeaderSize);
+    MITK_TEST_CONDITION(recording.GetTimeStamp(0) != 1000 && recording.GetTimeStamp(499) != 1000 + 499 * 20,
+                        "Unsorted file doesn't start and end with the earliest and latest time stamps.");
+    MITK_TEST_CONDITION(recording.GetFirstTimeStamp() == times.front(), "Unsorted first time stamp=" << recording.GetFirstTimeStamp());
+    MITK_TEST_CONDITION(recording.GetLastTimeStamp() == times.back(), "Unsorted last time stamp=" << recording.GetLastTimeStamp());
+
+    unsigned int errors = CompareLookups(recording, expected);
+    MITK_TEST_CONDITION(errors == 0, "Unsorted lookups match std::map, errors=" << errors);
+  }
+
+  // The backend only reads the first and last records, so doesn't scan the whole file to probe it.
+  mitk::StandaloneDataStorage::Pointer dataStorage = mitk::StandaloneDataStorage::New();
+  niftk::IGISingleFileBackend::Pointer backend = niftk::IGISingleFileBackend::New("unsorted", dataStorage.GetPointer());
+
+  niftk::IGIDataSourceI::IGITimeType first = 0;
+  niftk::IGIDataSourceI::IGITimeType last = 0;
+  bool found = backend->ProbeRecordedData(QString::fromStdString(unsortedDirectory), &first, &last);
+
+  MITK_TEST_CONDITION(found, "Probed unsorted recording.");
+  MITK_TEST_CONDITION(first == times.front(), "Unsorted probed first=" << first);
+  MITK_TEST_CONDITION(last == times.back(), "Unsorted probed last=" << last);
+}
+
+
+//-----------------------------------------------------------------------------
+void TestEmptyAndInvalidFiles(const std::string& directory)
+{
+  std::vector<niftk::IGIDataSourceI::IGITimeType> times;
+  std::string fileName = directory + "/empty.tqrt";
+  WriteFile(fileName, times, false);
+
+  niftk::IGISingleFileRecording recording(QString::fromStdString(fileName), s_HeaderSize);
+  size_t i = 0;
+  MITK_TEST_CONDITION(recording.IsEmpty(), "Header only file is empty.");
+  MITK_TEST_CONDITION(!recording.FindClosestRecord(100, i), "Nothing found in empty file.");
+
+  fileName = directory + "/invalid.tqrt";
+  {
+    std::ofstream ofs(fileName, std::ios::binary | std::ios::out);
+    for (unsigned int j = 0; j < 2 * s_HeaderSize; j++)
+    {
+      ofs << 'x';
+    }
+  }
+
+  bool thrown = false;
+  try
+  {
+    niftk::IGISingleFileRecording invalid(QString::fromStdString(fileName), s_HeaderSize);
+  }
+  catch (const mitk::Exception&)
+  {
+    thrown = true;
+  }
+  MITK_TEST_CONDITION(thrown, "Invalid header throws mitk::Exception.");
+}
+
+
+//-----------------------------------------------------------------------------
+void TestBackendRoundTrip(const std::string& directory)
+{
+  mitk::StandaloneDataStorage::Pointer dataStorage = mitk::StandaloneDataStorage::New();
+  niftk::IGISingleFileBackend::Pointer backend = niftk::IGISingleFileBackend::New("roundtrip", dataStorage.GetPointer());
+  backend->SetExpectedFramesPerSecond(60);
+
+  const unsigned int numberOfFrames = 200000; // about 1 hour at 60 fps.
+
+  std::map<std::string, std::pair<mitk::Point4D, mitk::Vector3D> > data;
+  mitk::Point4D rotation;
+  rotation[0] = 0; rotation[1] = 0; rotation[2] = 0; rotation[3] = 1;
+  mitk::Vector3D translation;
+  translation[0] = 1; translation[1] = 2; translation[2] = 3;
+  data.insert(std::make_pair(std::string("pointer"), std::make_pair(rotation, translation)));
+
+  QString recordingDirectory = QString::fromStdString(directory + "/recording");
+  for (unsigned int i = 1; i <= numberOfFrames; i++)
+  {
+    data["pointer"].second[0] = i;
+    backend->AddData(recordingDirectory, true, 10, i * 1000, data);
+  }
+  backend->StopRecording();
+
+  igtl::TimeStamp::Pointer timer = igtl::TimeStamp::New();
+  timer->GetTime();
+  niftk::IGIDataSourceI::IGITimeType start = timer->GetTimeStampInNanoseconds();
+
+  niftk::IGIDataSourceI::IGITimeType first = 0;
+  niftk::IGIDataSourceI::IGITimeType last = 0;
+  bool found = backend->ProbeRecordedData(recordingDirectory, &first, &last);
+
+  timer->GetTime();
+  niftk::IGIDataSourceI::IGITimeType probed = timer->GetTimeStampInNanoseconds();
+
+  backend->StartPlayback(recordingDirectory, first, last);
+
+  timer->GetTime();
+  niftk::IGIDataSourceI::IGITimeType indexed = timer->GetTimeStampInNanoseconds();
+
+  MITK_TEST_CONDITION(found, "Probed recording.");
+  MITK_TEST_CONDITION(first == 1000, "First=" << first);
+  MITK_TEST_CONDITION(last == numberOfFrames * 1000, "Last=" << last);
+
+  for (unsigned int i = 1; i <= numberOfFrames; i += 997)
+  {
+    backend->PlaybackData(10, i * 1000 + 500);
+  }
+
+  timer->GetTime();
+  niftk::IGIDataSourceI::IGITimeType played = timer->GetTimeStampInNanoseconds();
+
+  MITK_INFO << "Recording of " << numberOfFrames << " frames: probe=" << (probed - start) / 1000 << "us"
+            << ", start playback=" << (indexed - probed) / 1000 << "us"
+            << ", " << numberOfFrames / 997 + 1 << " seeks=" << (played - indexed) / 1000 << "us";
+
+  backend->StopPlayback();
+}
+
+} // end namespace
+
+
+//-----------------------------------------------------------------------------
+int niftkIGISingleFileRecordingTest(int argc, char* argv[])
+{
+  MITK_TEST_BEGIN("niftkIGISingleFileRecordingTest");
+
+  std::string uid = niftk::CreateUniqueString(6, time(NULL));
+  std::string directory = std::string(argv[1]) + "recording" + uid;
+  QDir().mkpath(QString::fromStdString(directory));
+
+  TestSortedFile(directory);
+  TestUnsortedFile(directory);
+  TestEmptyAndInvalidFiles(directory);
+  TestBackendRoundTrip(directory);
+
+  MITK_TEST_END();
+}
@@ -17,5 +17,6 @@ set(CPP_FILES
   niftkIGITrackerBackend.cxx
   niftkIGIMatrixPerFileBackend.cxx
   niftkIGISingleFileBackend.cxx
+  niftkIGISingleFileRecording.cxx
   niftkIGITrackerDataSourceService.cxx
 )
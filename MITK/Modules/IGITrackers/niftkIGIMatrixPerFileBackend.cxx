@@ -16,6 +16,9 @@
 #include <niftkIGIDataSourceUtils.h>
 #include <niftkFileIOUtils.h>
 #include <niftkMITKMathsUtils.h>
+#include <QDir>
+#include <algorithm>
+#include <limits>
 
 namespace niftk
 {
@@ -59,8 +62,8 @@ void IGIMatrixPerFileBackend::AddData(const QString& directoryName,
 
     if (m_Buffers.find(toolName) == m_Buffers.end())
     {
-      std::unique_ptr<niftk::IGIDataSourceRingBuffer> newBuffer(
-            new niftk::IGIDataSourceRingBuffer(this->GetExpectedFramesPerSecond() * 2));
+      std::unique_ptr<niftk::IGIDataSourceTimeIndexedBuffer> newBuffer(
+            new niftk::IGIDataSourceTimeIndexedBuffer(this->GetExpectedFramesPerSecond() * 2));
       newBuffer->SetLagInMilliseconds(m_Lag);
       m_Buffers.insert(std::make_pair(toolName, std::move(newBuffer)));
     }
@@ -114,13 +117,38 @@ void IGIMatrixPerFileBackend::PlaybackData(const niftk::IGIDataSourceI::IGITimeT
     {
       if (m_Buffers.find(bufferNameAsStdString) == m_Buffers.end())
       {
-        std::unique_ptr<niftk::IGIDataSourceRingBuffer> newBuffer(
-              new niftk::IGIDataSourceRingBuffer(this->GetExpectedFramesPerSecond() * 2));
+        std::unique_ptr<niftk::IGIDataSourceTimeIndexedBuffer> newBuffer(
+              new niftk::IGIDataSourceTimeIndexedBuffer(this->GetExpectedFramesPerSecond() * 2));
         newBuffer->SetLagInMilliseconds(m_Lag);
         m_Buffers.insert(std::make_pair(bufferNameAsStdString, std::move(newBuffer)));
       }
 
-      if (m_Buffers.find(bufferNameAsStdString) != m_Buffers.end())
+      if (m_Buffers.find(bufferNameAsStdString) != m_Buffers.end() && m_PlaybackStores.contains(bufferName))
+      {
+        const niftk::TrackingMatrixStore& store = *(m_PlaybackStores[bufferName]);
+
+        size_t index = 0;
+        if (store.FindTimeStamp(*i, index))
+        {
+          vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+          store.GetMatrix(index, *matrix);
+
+          mitk::Point4D rotation;
+          mitk::Vector3D translation;
+          niftk::ConvertMatrixToRotationAndTranslation(*matrix, rotation, translation);
+
+          niftk::IGITrackerDataType *trackerData = new niftk::IGITrackerDataType();
+          trackerData->SetTimeStampInNanoSeconds(*i);
+          trackerData->SetTransform(rotation, translation);
+          trackerData->SetFrameId(m_FrameId++);
+          trackerData->SetDuration(duration);
+          trackerData->SetShouldBeSaved(false);
+
+          std::unique_ptr<niftk::IGIDataType> wrapper(trackerData);
+          m_Buffers[bufferNameAsStdString]->AddToBuffer(wrapper);
+        }
+      }
+      else if (m_Buffers.find(bufferNameAsStdString) != m_Buffers.end())
       {
         std::ostringstream  filename;
         filename << m_PlaybackDirectory.toStdString()
@@ -173,6 +201,7 @@ void IGIMatrixPerFileBackend::PlaybackData(const niftk::IGIDataSourceI::IGITimeT
 void IGIMatrixPerFileBackend::StopPlayback()
 {
   m_PlaybackIndex.clear();
+  m_PlaybackStores.clear();
   m_Buffers.clear();
 }
 
@@ -182,7 +211,70 @@ bool IGIMatrixPerFileBackend::ProbeRecordedData(const QString& directoryName,
                                                 niftk::IGIDataSourceI::IGITimeType* firstTimeStampInStore,
                                                 niftk::IGIDataSourceI::IGITimeType* lastTimeStampInStore)
 {
-  return niftk::ProbeRecordedData(directoryName, QString(".txt"), firstTimeStampInStore, lastTimeStampInStore);
+  QStringList toolsWithStores = this->GetToolsWithStores(directoryName);
+  if (toolsWithStores.isEmpty())
+  {
+    return niftk::ProbeRecordedData(directoryName, QString(".txt"), firstTimeStampInStore, lastTimeStampInStore);
+  }
+
+  niftk::IGIDataSourceI::IGITimeType firstTimeStampFound = std::numeric_limits<niftk::IGIDataSourceI::IGITimeType>::max();
+  niftk::IGIDataSourceI::IGITimeType lastTimeStampFound = std::numeric_limits<niftk::IGIDataSourceI::IGITimeType>::min();
+
+  // The stores are sorted, so only their first and last time stamps are read.
+  QDir recordingDir(directoryName);
+  for (QString toolName: toolsWithStores)
+  {
+    niftk::TrackingMatrixStore store(niftk::TrackingMatrixStore::GetFileNameInDirectory(recordingDir.filePath(toolName).toStdString()));
+    if (!store.IsEmpty())
+    {
+      firstTimeStampFound = std::min(firstTimeStampFound, store.GetTimeStamp(0));
+      lastTimeStampFound = std::max(lastTimeStampFound, store.GetTimeStamp(store.GetNumberOfMatrices() - 1));
+    }
+  }
+
+  // Tools without a store are probed from their files, as before.
+  niftk::IGIDataSourceI::IGITimeType firstTimeStampInFiles = 0;
+  niftk::IGIDataSourceI::IGITimeType lastTimeStampInFiles = 0;
+  try
+  {
+    if (niftk::ProbeRecordedData(directoryName, QString(".txt"), &firstTimeStampInFiles, &lastTimeStampInFiles))
+    {
+      firstTimeStampFound = std::min(firstTimeStampFound, firstTimeStampInFiles);
+      lastTimeStampFound = std::max(lastTimeStampFound, lastTimeStampInFiles);
+    }
+  }
+  catch (mitk::Exception&)
+  {
+  }
+
+  if (firstTimeStampInStore)
+  {
+    *firstTimeStampInStore = firstTimeStampFound;
+  }
+  if (lastTimeStampInStore)
+  {
+    *lastTimeStampInStore = lastTimeStampFound;
+  }
+  return firstTimeStampFound != std::numeric_limits<niftk::IGIDataSourceI::IGITimeType>::max();
+}
+
+
+//-----------------------------------------------------------------------------
+QStringList IGIMatrixPerFileBackend::GetToolsWithStores(const QString& directoryName) const
+{
+  QStringList toolsWithStores;
+
+  QDir recordingDir(directoryName);
+  recordingDir.setFilter(QDir::Dirs | QDir::Readable | QDir::NoDotAndDotDot);
+
+  for (QString toolName: recordingDir.entryList())
+  {
+    if (niftk::TrackingMatrixStore::IsInDirectory(recordingDir.filePath(toolName).toStdString()))
+    {
+      toolsWithStores << toolName;
+    }
+  }
+  return toolsWithStores;
 }
 
 
@@ -193,7 +285,48 @@ IGIMatrixPerFileBackend::GetPlaybackIndex(const QString& directoryName)
   QMap<QString, std::set<niftk::IGIDataSourceI::IGITimeType> > bufferToTimeStamp;
   QMap<QString, QHash<niftk::IGIDataSourceI::IGITimeType, QStringList> > bufferToTimeStampToFileNames;
 
-  niftk::GetPlaybackIndex(directoryName, QString(".txt"), bufferToTimeStamp, bufferToTimeStampToFileNames);
+  m_PlaybackStores.clear();
+
+  QStringList toolsWithStores = this->GetToolsWithStores(directoryName);
+  QDir recordingDir(directoryName);
+
+  for (QString toolName: toolsWithStores)
+  {
+    std::shared_ptr<niftk::TrackingMatrixStore> store(
+      new niftk::TrackingMatrixStore(niftk::TrackingMatrixStore::GetFileNameInDirectory(recordingDir.filePath(toolName).toStdString())));
+
+    std::set<niftk::IGIDataSourceI::IGITimeType> timeStamps;
+    for (size_t i = 0; i < store->GetNumberOfMatrices(); i++)
+    {
+      timeStamps.insert(timeStamps.end(), store->GetTimeStamp(i));
+    }
+
+    m_PlaybackStores.insert(toolName, store);
+    bufferToTimeStamp.insert(toolName, timeStamps);
+  }
+
+  // Any other tools are still one file per matrix. If they all have stores, there may be none.
+  QMap<QString, std::set<niftk::IGIDataSourceI::IGITimeType> > perFileBufferToTimeStamp;
+  try
+  {
+    niftk::GetPlaybackIndex(directoryName, QString(".txt"), perFileBufferToTimeStamp, bufferToTimeStampToFileNames);
+  }
+  catch (mitk::Exception&)
+  {
+    if (toolsWithStores.isEmpty())
+    {
+      throw;
+    }
+  }
+
+  QMap<QString, std::set<niftk::IGIDataSourceI::IGITimeType> >::iterator iter;
+  for (iter = perFileBufferToTimeStamp.begin(); iter != perFileBufferToTimeStamp.end(); ++iter)
+  {
+    if (!m_PlaybackStores.contains(iter.key()))
+    {
+      bufferToTimeStamp.insert(iter.key(), iter.value());
+    }
+  }
   return bufferToTimeStamp;
 }
 
@@ -17,13 +17,18 @@
 
 #include <niftkIGITrackersExports.h>
 #include "niftkIGITrackerBackend.h"
+#include <niftkTrackingMatrixStore.h>
 #include <QSet>
+#include <memory>
 
 namespace niftk
 {
 /**
  * \class IGIMatrixPerFileBackend
  * \brief Tracker backend that saves each transformation as a 4x4 matrix, each in a separate file.
+ *
+ * For playback, a tool directory can instead hold a niftk::TrackingMatrixStore, packed from
+ * those files, which is then used in preference to them.
  */
 class NIFTKIGITRACKERS_EXPORT IGIMatrixPerFileBackend : public niftk::IGITrackerBackend
 {
@@ -81,12 +86,17 @@ protected:
 private:
 
   // This loads all the timestamps and filenames into memory!
+  // Tools that have a packed store are mapped into m_PlaybackStores instead.
   QMap<QString, std::set<niftk::IGIDataSourceI::IGITimeType> > GetPlaybackIndex(const QString& directory);
 
+  // Returns the names of the tool directories in directoryName that have a packed store.
+  QStringList GetToolsWithStores(const QString& directoryName) const;
+
   void SaveItem(const QString& directoryName,
                 const std::unique_ptr<niftk::IGIDataType>& item);
 
   QMap<QString, std::set<niftk::IGIDataSourceI::IGITimeType> > m_PlaybackIndex;
+  QMap<QString, std::shared_ptr<niftk::TrackingMatrixStore> >  m_PlaybackStores;
 
 private:
 
@@ -58,8 +58,8 @@ void IGISingleFileBackend::AddData(const QString& directoryName,
 
     if (m_Buffers.find(toolName) == m_Buffers.end())
     {
-      std::unique_ptr<niftk::IGIDataSourceRingBuffer> newBuffer(
-            new niftk::IGIDataSourceRingBuffer(this->GetExpectedFramesPerSecond() * 2));
+      std::unique_ptr<niftk::IGIDataSourceTimeIndexedBuffer> newBuffer(
+            new niftk::IGIDataSourceTimeIndexedBuffer(this->GetExpectedFramesPerSecond() * 2));
       newBuffer->SetLagInMilliseconds(m_Lag);
       m_Buffers.insert(std::make_pair(toolName, std::move(newBuffer)));
     }
@@ -101,30 +101,26 @@ void IGISingleFileBackend::PlaybackData(const niftk::IGIDataSourceI::IGITimeType
   {
     std::string bufferName = (*playbackIter).first;
 
-    PlaybackTransformType::const_iterator i =
-      m_PlaybackIndex[bufferName].upper_bound(requestedTimeStamp);
-
-    if (i != m_PlaybackIndex[bufferName].begin())
-    {
-      --i;
-    }
-    if (i != m_PlaybackIndex[bufferName].end())
+    size_t i = 0;
+    if ((*playbackIter).second->FindClosestRecord(requestedTimeStamp, i))
     {
       if (m_Buffers.find(bufferName) == m_Buffers.end())
       {
-        std::unique_ptr<niftk::IGIDataSourceRingBuffer> newBuffer(
-              new niftk::IGIDataSourceRingBuffer(this->GetExpectedFramesPerSecond() * 2));
+        std::unique_ptr<niftk::IGIDataSourceTimeIndexedBuffer> newBuffer(
+              new niftk::IGIDataSourceTimeIndexedBuffer(this->GetExpectedFramesPerSecond() * 2));
         newBuffer->SetLagInMilliseconds(m_Lag);
         m_Buffers.insert(std::make_pair(bufferName, std::move(newBuffer)));
       }
 
-      if (m_Buffers.find(bufferName) != m_Buffers.end())
+      if (!m_Buffers[bufferName]->Contains((*playbackIter).second->GetTimeStamp(i)))
       {
-          mitk::Point4D rotation = (*i).second.first;
-          mitk::Vector3D translation = (*i).second.second;
+          niftk::IGIDataSourceI::IGITimeType timeStamp = 0;
+          mitk::Point4D rotation;
+          mitk::Vector3D translation;
+          (*playbackIter).second->GetRecord(i, timeStamp, rotation, translation);
 
           niftk::IGITrackerDataType *trackerData = new niftk::IGITrackerDataType();
-          trackerData->SetTimeStampInNanoSeconds((*i).first);
+          trackerData->SetTimeStampInNanoSeconds(timeStamp);
           trackerData->SetTransform(rotation, translation);
           trackerData->SetFrameId(m_FrameId++);
           trackerData->SetDuration(duration);
@@ -149,43 +145,6 @@ void IGISingleFileBackend::StopPlayback()
 }
 
 
-//-----------------------------------------------------------------------------
-IGISingleFileBackend::PlaybackTransformType
-IGISingleFileBackend::ParseFile(const QString& fileName)
-{
-  PlaybackTransformType result;
-  std::ifstream ifs(fileName.toStdString(), std::ios::binary | std::ios::in);
-  if (ifs.is_open())
-  {
-    try
-    {
-      niftk::CheckTQRDFileHeader(ifs, m_FileHeaderSize);
-    }
-    catch ( std::exception& e )
-    {
-      mitkThrow() << fileName.toStdString() << " does not appear to be a valid tracking data file : " << e.what();
-    }
-    niftk::IGIDataSourceI::IGITimeType time;
-    std::pair<mitk::Point4D, mitk::Vector3D> transform;
-    while (ifs.good())
-    {
-      ifs.read(reinterpret_cast<char*>(&time), sizeof(niftk::IGIDataSourceI::IGITimeType));
-      ifs.read(reinterpret_cast<char*>(&transform.first[0]), sizeof(transform.first[0]));
-      ifs.read(reinterpret_cast<char*>(&transform.first[1]), sizeof(transform.first[1]));
-      ifs.read(reinterpret_cast<char*>(&transform.first[2]), sizeof(transform.first[2]));
-      ifs.read(reinterpret_cast<char*>(&transform.first[3]), sizeof(transform.first[3]));
-      ifs.read(reinterpret_cast<char*>(&transform.second[0]), sizeof(transform.second[0]));
-      ifs.read(reinterpret_cast<char*>(&transform.second[1]), sizeof(transform.second[1]));
-      ifs.read(reinterpret_cast<char*>(&transform.second[2]), sizeof(transform.second[2]));
-      if (ifs.good())
-      {
-        result.insert(std::move(std::make_pair(time, transform)));
-      }
-    }
-  }
-  return std::move(result);
-}
-
 //-----------------------------------------------------------------------------
 bool IGISingleFileBackend::ProbeRecordedData(const QString& directoryName,
                                              niftk::IGIDataSourceI::IGITimeType* firstTimeStampInStore,
@@ -206,23 +165,16 @@ bool IGISingleFileBackend::ProbeRecordedData(const QString& directoryName,
   for (int i = 0; i < files.size(); i++)
   {
     std::string fileName = files[i];
-    PlaybackTransformType map = this->ParseFile(QString::fromStdString(fileName));
-    if (!map.empty())
+    niftk::IGISingleFileRecording recording(QString::fromStdString(fileName), m_FileHeaderSize);
+    if (!recording.IsEmpty())
     {
-      niftk::IGIDataSourceI::IGITimeType firstTimeStamp = (*map.begin()).first;
+      // Just the first and last records, so probing doesn't depend on the length of the recording.
+      niftk::IGIDataSourceI::IGITimeType firstTimeStamp = recording.GetFirstTimeStamp();
       if (firstTimeStamp < firstTimeStampFound)
       {
         firstTimeStampFound = firstTimeStamp;
       }
-      niftk::IGIDataSourceI::IGITimeType lastTimeStamp;
-      if (map.size() > 1)
-      {
-        lastTimeStamp = (*map.rbegin()).first;
-      }
-      else
-      {
-        lastTimeStamp = (*map.begin()).first;
-      }
+      niftk::IGIDataSourceI::IGITimeType lastTimeStamp = recording.GetLastTimeStamp();
       if (lastTimeStamp > lastTimeStampFound)
       {
         lastTimeStampFound = lastTimeStamp;
@@ -336,15 +288,13 @@ IGISingleFileBackend::GetPlaybackIndex(const QString& directoryName)
     std::string fileName = files[i];
     std::string base = niftk::Basename(fileName);
 
-    PlaybackTransformType map = this->ParseFile(QString::fromStdString(fileName));
-    if (map.size() > 0)
+    std::unique_ptr<niftk::IGISingleFileRecording> recording(
+          new niftk::IGISingleFileRecording(QString::fromStdString(fileName), m_FileHeaderSize));
+    if (!recording->IsEmpty())
     {
-      MITK_INFO << "IGISingleFileBackend: Loaded " << fileName << ", with " << map.size() << " transforms";
-      playbackIndex.insert(std::move(std::make_pair(base,
-                                                    std::move(map)
-                                                   )
-                                     )
-                           );
+      MITK_INFO << "IGISingleFileBackend: Mapped " << fileName << ", with "
+                << recording->GetNumberOfRecords() << " transforms";
+      playbackIndex.insert(std::make_pair(base, std::move(recording)));
     }
   }
 
@@ -17,7 +17,8 @@
 
 #include <niftkIGITrackersExports.h>
 #include "niftkIGITrackerBackend.h"
-#include <niftkIGIDataSourceRingBuffer.h>
+#include "niftkIGISingleFileRecording.h"
+#include <niftkIGIDataSourceTimeIndexedBuffer.h>
 #include <iostream>
 
 namespace niftk
@@ -30,6 +31,9 @@ namespace niftk
  * timestamp q1 q2 q3 q4 t1 t2 t3 t4
  * </verbatim>
  * and each tool goes in a separate folder, just like in niftk::IGIMatrixPerFileBackend.
+ *
+ * For playback, each file is memory mapped by niftk::IGISingleFileRecording,
+ * so probing and indexing don't need to parse every record.
  */
 class NIFTKIGITRACKERS_EXPORT IGISingleFileBackend : public niftk::IGITrackerBackend
 {
@@ -49,7 +53,7 @@ public:
 
   /**
   * \see  IGIDataSourceI::StartPlayback()
-  * \brief Pre-loads all timestamps and filenames.
+  * \brief Maps all the .tqrt files in directoryName.
   */
   virtual void StartPlayback(const QString& directoryName,
                              const niftk::IGIDataSourceI::IGITimeType& firstTimeStamp,
@@ -70,7 +74,8 @@ public:
 
   /**
   * \see IGIDataSourceI::ProbeRecordedData()
-  * \brief Scans directoryName to determine the min and max timestamp.
+  * \brief Scans directoryName to determine the min and max timestamp,
+  * by reading only the first and last record of each file, as they are written in time order.
   */
   virtual bool ProbeRecordedData(const QString& directoryName,
                                  niftk::IGIDataSourceI::IGITimeType* firstTimeStampInStore,
@@ -88,14 +93,10 @@ protected:
 
 private:
 
-  typedef std::map<niftk::IGIDataSourceI::IGITimeType,
-                   std::pair<mitk::Point4D, mitk::Vector3D> // quaternion, translation
-                  > PlaybackTransformType;
-  typedef std::map<std::string, PlaybackTransformType> PlaybackIndexType;
+  typedef std::map<std::string, std::unique_ptr<niftk::IGISingleFileRecording> > PlaybackIndexType;
 
-  // This loads all the timestamps and transformations into memory!
+  // This maps all the files, but doesn't read the transformations until they are needed.
   PlaybackIndexType GetPlaybackIndex(const QString& directory);
-  PlaybackTransformType ParseFile(const QString& fileName);
 
   void SaveItem(const QString& directoryName,
                 const std::unique_ptr<niftk::IGIDataType>& item);
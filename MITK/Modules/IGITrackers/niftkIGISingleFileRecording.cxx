@@ -0,0 +1,216 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#include "niftkIGISingleFileRecording.h"
+#include <niftkFileHelper.h>
+#include <mitkExceptionMacro.h>
+#include <mitkLogMacros.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace niftk
+{
+
+//-----------------------------------------------------------------------------
+IGISingleFileRecording::IGISingleFileRecording(const QString& fileName, const unsigned int& headerSize)
+: m_File(fileName)
+, m_HeaderSize(headerSize)
+, m_NumberOfRecords(0)
+, m_Records(nullptr)
+, m_OrderChecked(false)
+{
+  {
+    // The header is small, and XML, so just check it the same way as before.
+    std::ifstream ifs(fileName.toStdString(), std::ios::binary | std::ios::in);
+    if (!ifs.is_open())
+    {
+      mitkThrow() << "Failed to open " << fileName.toStdString();
+    }
+    try
+    {
+      niftk::CheckTQRDFileHeader(ifs, m_HeaderSize);
+    }
+    catch ( std::exception& e )
+    {
+      mitkThrow() << fileName.toStdString() << " does not appear to be a valid tracking data file : " << e.what();
+    }
+  }
+
+  if (!m_File.open(QIODevice::ReadOnly))
+  {
+    mitkThrow() << "Failed to open " << fileName.toStdString() << " for reading.";
+  }
+
+  qint64 fileSize = m_File.size();
+  if (fileSize > static_cast<qint64>(m_HeaderSize))
+  {
+    m_NumberOfRecords = static_cast<size_t>(fileSize - m_HeaderSize) / RecordSize;
+  }
+
+  if (m_NumberOfRecords > 0)
+  {
+    // Pages are only read from disk as they are touched.
+    m_Records = m_File.map(m_HeaderSize, m_NumberOfRecords * RecordSize);
+    if (m_Records == nullptr)
+    {
+      mitkThrow() << "Failed to map " << fileName.toStdString() << ", due to:" << m_File.errorString().toStdString();
+    }
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+IGISingleFileRecording::~IGISingleFileRecording()
+{
+  if (m_Records != nullptr)
+  {
+    m_File.unmap(const_cast<unsigned char*>(m_Records));
+  }
+  m_File.close();
+}
+
+
+//-----------------------------------------------------------------------------
+const unsigned char* IGISingleFileRecording::GetRecordPointer(const size_t& i) const
+{
+  if (i >= m_NumberOfRecords)
+  {
+    mitkThrow() << "Record " << i << " is out of range, as " << m_File.fileName().toStdString()
+                << " has " << m_NumberOfRecords << " records.";
+  }
+  return m_Records + i * RecordSize;
+}
+
+
+//-----------------------------------------------------------------------------
+niftk::IGIDataSourceI::IGITimeType IGISingleFileRecording::GetTimeStamp(const size_t& i) const
+{
+  // memcpy, as the mapped data is only guaranteed to be byte aligned.
+  niftk::IGIDataSourceI::IGITimeType timeStamp;
+  std::memcpy(&timeStamp, this->GetRecordPointer(i), sizeof(timeStamp));
+  return timeStamp;
+}
+
+
+//-----------------------------------------------------------------------------
+niftk::IGIDataSourceI::IGITimeType IGISingleFileRecording::GetFirstTimeStamp() const
+{
+  if (m_NumberOfRecords == 0)
+  {
+    mitkThrow() << "Empty file, so can't get first time stamp.";
+  }
+  return this->GetTimeStamp(0);
+}
+
+
+//-----------------------------------------------------------------------------
+niftk::IGIDataSourceI::IGITimeType IGISingleFileRecording::GetLastTimeStamp() const
+{
+  if (m_NumberOfRecords == 0)
+  {
+    mitkThrow() << "Empty file, so can't get last time stamp.";
+  }
+  return this->GetTimeStamp(m_NumberOfRecords - 1);
+}
+
+
+//-----------------------------------------------------------------------------
+void IGISingleFileRecording::GetRecord(const size_t& i,
+                                       niftk::IGIDataSourceI::IGITimeType& timeStamp,
+                                       mitk::Point4D& rotation,
+                                       mitk::Vector3D& translation) const
+{
+  const unsigned char* record = this->GetRecordPointer(i);
+
+  double values[7];
+  std::memcpy(&timeStamp, record, sizeof(timeStamp));
+  std::memcpy(values, record + sizeof(timeStamp), sizeof(values));
+
+  for (int j = 0; j < 4; j++)
+  {
+    rotation[j] = values[j];
+  }
+  for (int j = 0; j < 3; j++)
+  {
+    translation[j] = values[4 + j];
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+void IGISingleFileRecording::CheckOrder()
+{
+  m_OrderChecked = true;
+
+  for (size_t i = 1; i < m_NumberOfRecords; i++)
+  {
+    if (this->GetTimeStamp(i) < this->GetTimeStamp(i - 1))
+    {
+      MITK_WARN << "IGISingleFileRecording: " << m_File.fileName().toStdString()
+                << " is not in time order, so sorting " << m_NumberOfRecords << " time stamps.";
+
+      m_SortedOrder.resize(m_NumberOfRecords);
+      for (size_t j = 0; j < m_NumberOfRecords; j++)
+      {
+        m_SortedOrder[j] = j;
+      }
+      std::stable_sort(m_SortedOrder.begin(), m_SortedOrder.end(),
+                       [this](const size_t& a, const size_t& b) { return this->GetTimeStamp(a) < this->GetTimeStamp(b); });
+      return;
+    }
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+bool IGISingleFileRecording::FindClosestRecord(const niftk::IGIDataSourceI::IGITimeType& requestedTimeStamp,
+                                               size_t& i)
+{
+  if (m_NumberOfRecords == 0)
+  {
+    return false;
+  }
+
+  if (!m_OrderChecked)
+  {
+    this->CheckOrder();
+  }
+
+  // Binary search for the first record later than requestedTimeStamp, i.e. std::upper_bound.
+  size_t low = 0;
+  size_t high = m_NumberOfRecords;
+  while (low < high)
+  {
+    size_t middle = low + (high - low) / 2;
+    size_t record = m_SortedOrder.empty() ? middle : m_SortedOrder[middle];
+    if (this->GetTimeStamp(record) <= requestedTimeStamp)
+    {
+      low = middle + 1;
+    }
+    else
+    {
+      high = middle;
+    }
+  }
+
+  if (low > 0)
+  {
+    --low;
+  }
+  i = m_SortedOrder.empty() ? low : m_SortedOrder[low];
+  return true;
+}
+
+} // end namespace
@@ -0,0 +1,115 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#ifndef niftkIGISingleFileRecording_h
+#define niftkIGISingleFileRecording_h
+
+#include <niftkIGITrackersExports.h>
+#include <niftkIGIDataSourceI.h>
+#include <mitkPoint.h>
+#include <mitkVector.h>
+#include <QFile>
+#include <QString>
+#include <vector>
+
+namespace niftk
+{
+
+/**
+ * \class IGISingleFileRecording
+ * \brief Read-only, memory mapped view of a .tqrt file written by niftk::IGISingleFileBackend.
+ *
+ * The file is a fixed size header, followed by fixed size records of
+ * <verbatim>
+ * timestamp q1 q2 q3 q4 t1 t2 t3
+ * </verbatim>
+ * (one 64 bit unsigned integer, then 7 doubles), so record i is found by arithmetic,
+ * and nothing is parsed until it is asked for. The number of records is available in
+ * constant time, and lookups are a binary search over the mapped time stamps.
+ *
+ * Records are normally in time order, as they are appended as they are grabbed.
+ * If they are not, the first lookup builds a sorted index, so lookups are still correct.
+ * The first and last time stamps are always read from the first and last records,
+ * so opening a file to probe its time range doesn't touch the rest of it.
+ * A truncated final record, e.g. if the application crashed while recording, is ignored.
+ *
+ * Note: All errors should thrown as mitk::Exception or sub-classes thereof.
+ */
+class NIFTKIGITRACKERS_EXPORT IGISingleFileRecording
+{
+public:
+
+  /**
+  * \brief Size in bytes of each record.
+  */
+  static const size_t RecordSize = sizeof(niftk::IGIDataSourceI::IGITimeType) + 7 * sizeof(double);
+
+  /**
+  * \brief Opens and maps fileName, checking the header, throwing mitk::Exception if it is not valid.
+  */
+  IGISingleFileRecording(const QString& fileName, const unsigned int& headerSize);
+  virtual ~IGISingleFileRecording();
+
+  QString GetFileName() const { return m_File.fileName(); }
+  size_t GetNumberOfRecords() const { return m_NumberOfRecords; }
+  bool IsEmpty() const { return m_NumberOfRecords == 0; }
+
+  /**
+  * \brief Returns the time stamp of the first record, which must exist.
+  */
+  niftk::IGIDataSourceI::IGITimeType GetFirstTimeStamp() const;
+
+  /**
+  * \brief Returns the time stamp of the last record, which must exist.
+  */
+  niftk::IGIDataSourceI::IGITimeType GetLastTimeStamp() const;
+
+  /**
+  * \brief Returns the time stamp of record i, in file order.
+  */
+  niftk::IGIDataSourceI::IGITimeType GetTimeStamp(const size_t& i) const;
+
+  /**
+  * \brief Reads record i, in file order.
+  */
+  void GetRecord(const size_t& i,
+                 niftk::IGIDataSourceI::IGITimeType& timeStamp,
+                 mitk::Point4D& rotation,
+                 mitk::Vector3D& translation) const;
+
+  /**
+  * \brief Finds the record with the largest time stamp <= requestedTimeStamp,
+  * or the earliest record if they are all later. Returns false if the file is empty.
+  */
+  bool FindClosestRecord(const niftk::IGIDataSourceI::IGITimeType& requestedTimeStamp, size_t& i);
+
+private:
+
+  IGISingleFileRecording(const IGISingleFileRecording&); // Purposefully not implemented.
+  IGISingleFileRecording& operator=(const IGISingleFileRecording&); // Purposefully not implemented.
+
+  const unsigned char* GetRecordPointer(const size_t& i) const;
+  void CheckOrder();
+
+  QFile                m_File;
+  unsigned int         m_HeaderSize;
+  size_t               m_NumberOfRecords;
+  const unsigned char* m_Records;
+  bool                 m_OrderChecked;
+  std::vector<size_t>  m_SortedOrder; // only used if the file is out of time order.
+};
+
+} // end namespace
+
+#endif
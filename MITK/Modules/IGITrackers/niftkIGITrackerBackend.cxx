@@ -134,7 +134,7 @@ std::vector<IGIDataItemInfo> IGITrackerBackend::Update(const niftk::IGIDataSourc
     return infos;
   }
 
-  std::map<std::string, std::unique_ptr<niftk::IGIDataSourceRingBuffer> >::iterator iter;
+  std::map<std::string, std::unique_ptr<niftk::IGIDataSourceTimeIndexedBuffer> >::iterator iter;
   for (iter = m_Buffers.begin(); iter != m_Buffers.end(); ++iter)
   {
     std::string bufferName = iter->first;
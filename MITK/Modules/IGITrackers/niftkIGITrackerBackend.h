@@ -18,7 +18,7 @@
 #include <niftkIGITrackersExports.h>
 #include <niftkIGIDataSourceI.h>
 #include <niftkIGITrackerDataType.h>
-#include <niftkIGIDataSourceRingBuffer.h>
+#include <niftkIGIDataSourceTimeIndexedBuffer.h>
 #include <itkObject.h>
 #include <itkObjectFactory.h>
 #include <mitkDataStorage.h>
@@ -119,7 +119,7 @@ protected:
   std::set<mitk::DataNode::Pointer>  m_DataNodes;
   std::map<std::string,
            std::unique_ptr<
-             niftk::IGIDataSourceRingBuffer>
+             niftk::IGIDataSourceTimeIndexedBuffer>
           >                          m_Buffers;
   QString                            m_PlaybackDirectory;
 
@@ -33,6 +33,8 @@ IGITrackerDataSourceService::IGITrackerDataSourceService(
                 dataStorage)
 , m_Tracker(nullptr)
 , m_BackEnd(nullptr)
+, m_IsPrepared(false)
+, m_PreparedTime(0)
 {
   this->SetStatus("Initialising");
 
@@ -138,13 +140,31 @@ void IGITrackerDataSourceService::GrabData()
 
 
 //-----------------------------------------------------------------------------
-std::vector<IGIDataItemInfo> IGITrackerDataSourceService::Update(const niftk::IGIDataSourceI::IGITimeType& time)
+void IGITrackerDataSourceService::PrepareUpdate(const niftk::IGIDataSourceI::IGITimeType& time)
 {
+  m_IsPrepared = false;
+
   if (this->GetIsPlayingBack())
   {
     this->PlaybackData(time);
   }
 
+  m_PreparedTime = time;
+  m_IsPrepared = true;
+}
+
+
+//-----------------------------------------------------------------------------
+std::vector<IGIDataItemInfo> IGITrackerDataSourceService::Update(const niftk::IGIDataSourceI::IGITimeType& time)
+{
+  bool isPrepared = m_IsPrepared && m_PreparedTime == time;
+  m_IsPrepared = false;
+
+  if (this->GetIsPlayingBack() && !isPrepared)
+  {
+    this->PlaybackData(time);
+  }
+
   std::vector<IGIDataItemInfo> infos = m_BackEnd->Update(time);
   return infos;
 }
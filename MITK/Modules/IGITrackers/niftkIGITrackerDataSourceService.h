@@ -18,6 +18,7 @@
 #include <niftkIGIDataSource.h>
 #include <niftkIGIDataSourceLocker.h>
 #include <niftkIGILocalDataSourceI.h>
+#include <niftkIGIPreparableDataSourceI.h>
 #include <niftkIGITrackerBackend.h>
 #include <niftkIGITracker.h>
 
@@ -38,6 +39,7 @@ namespace niftk
 class NIFTKIGITRACKERS_EXPORT IGITrackerDataSourceService : public QObject
                                                           , public IGIDataSource
                                                           , public IGILocalDataSourceI
+                                                          , public IGIPreparableDataSourceI
 {
 
 public:
@@ -66,6 +68,12 @@ public:
   */
   virtual std::vector<IGIDataItemInfo> Update(const niftk::IGIDataSourceI::IGITimeType& time) override;
 
+  /**
+  * \brief Loads playback data for the given time, so Update() only has to write to DataStorage.
+  * \see niftk::IGIPreparableDataSourceI::PrepareUpdate()
+  */
+  virtual void PrepareUpdate(const niftk::IGIDataSourceI::IGITimeType& time) override;
+
   /**
   * \see niftk::IGILocalDataSourceI::GrabData()
   */
@@ -113,6 +121,9 @@ private:
   IGITrackerDataSourceService(const IGITrackerDataSourceService&); // deliberately not implemented
   IGITrackerDataSourceService& operator=(const IGITrackerDataSourceService&); // deliberately not implemented
 
+  bool                                m_IsPrepared;
+  niftk::IGIDataSourceI::IGITimeType  m_PreparedTime;
+
 }; // end class
 
 } // end namespace
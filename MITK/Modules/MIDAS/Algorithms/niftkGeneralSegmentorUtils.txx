@@ -739,6 +739,7 @@ void ITKPropagateUpOrDown(
   regionGrowingFilter->SetUseRegionOfInterest(true);
   regionGrowingFilter->SetPropMask(propagationMask);
   regionGrowingFilter->SetUsePropMaskMode(true);
+  regionGrowingFilter->SetUseScanlineFill(true);
   regionGrowingFilter->SetProjectSeedsIntoRegion(false);
   regionGrowingFilter->SetEraseFullSlice(false);
   regionGrowingFilter->SetForegroundValue(1);
@@ -34,6 +34,22 @@
 namespace niftk
 {
 
+//-----------------------------------------------------------------------------
+namespace
+{
+
+/**
+* \brief Network sources are assumed to be about 20 fps (see constructor), so read ahead 1 second.
+*/
+const unsigned int s_NumberOfItemsToReadAhead = 20;
+
+/**
+* \brief Upper limit on memory used per device for messages loaded ahead of the playback position.
+*/
+const size_t s_MaximumPlaybackCacheSizeInBytes = 256 * 1024 * 1024;
+
+} // end anonymous namespace
+
 //-----------------------------------------------------------------------------
 NiftyLinkDataSourceService::NiftyLinkDataSourceService(
   QString name,
@@ -48,6 +64,8 @@ NiftyLinkDataSourceService::NiftyLinkDataSourceService(
 , m_FrameId(0)
 , m_BackgroundDeleteThread(NULL)
 , m_Lag(0)
+, m_IsPrepared(false)
+, m_PreparedTime(0)
 {
   qRegisterMetaType<niftk::NiftyLinkMessageContainer::Pointer>("niftk::NiftyLinkMessageContainer::Pointer");
 
@@ -98,6 +116,9 @@ NiftyLinkDataSourceService::NiftyLinkDataSourceService(
 //-----------------------------------------------------------------------------
 NiftyLinkDataSourceService::~NiftyLinkDataSourceService()
 {
+  // Stop prefetching, while the playback indexes still exist.
+  m_PlaybackCaches.clear();
+
   m_BackgroundDeleteThread->ForciblyStop();
   delete m_BackgroundDeleteThread;
 
@@ -188,8 +209,23 @@ void NiftyLinkDataSourceService::StartPlayback(niftk::IGIDataSourceI::IGITimeTyp
 
   m_Buffers.clear();
 
+  m_PlaybackCaches.clear();
+
   QString path = this->GetPlaybackDirectory();
   niftk::GetPlaybackIndex(path, QString(""), m_PlaybackIndex, m_PlaybackFiles);
+
+  QMap<QString, std::set<niftk::IGIDataSourceI::IGITimeType> >::const_iterator iter;
+  for (iter = m_PlaybackIndex.constBegin(); iter != m_PlaybackIndex.constEnd(); ++iter)
+  {
+    std::unique_ptr<niftk::IGIDataSourcePlaybackCache> cache(
+          new niftk::IGIDataSourcePlaybackCache(this,
+                                                iter.key().toStdString(),
+                                                s_NumberOfItemsToReadAhead,
+                                                s_MaximumPlaybackCacheSizeInBytes));
+    cache->SetPlaybackIndex(iter.value());
+    cache->Start();
+    m_PlaybackCaches.insert(std::make_pair(iter.key().toStdString(), std::move(cache)));
+  }
 }
 
 
@@ -198,7 +234,21 @@ void NiftyLinkDataSourceService::StopPlayback()
 {
   QMutexLocker locker(&m_Lock);
 
+  std::map<std::string, std::unique_ptr<niftk::IGIDataSourcePlaybackCache> >::const_iterator iter;
+  for (iter = m_PlaybackCaches.begin(); iter != m_PlaybackCaches.end(); ++iter)
+  {
+    iter->second->Stop();
+
+    MITK_INFO << "NiftyLinkDataSourceService(" << this->GetName().toStdString()
+              << "): Playback cache for " << iter->first
+              << ", hits=" << iter->second->GetNumberOfHits()
+              << ", misses=" << iter->second->GetNumberOfMisses()
+              << ", evictions=" << iter->second->GetNumberOfEvictions();
+  }
+  m_PlaybackCaches.clear();
+
   m_PlaybackIndex.clear();
+  m_PlaybackFiles.clear();
   m_Buffers.clear();
 
   IGIDataSource::StopPlayback();
@@ -239,27 +289,28 @@ void NiftyLinkDataSourceService::PlaybackData(niftk::IGIDataSourceI::IGITimeType
 
       niftk::IGIDataSourceI::IGITimeType requestedTime = *iter;
 
-      QStringList listOfRelevantFiles = m_PlaybackFiles[bufferName].value(requestedTime);
-      if (!listOfRelevantFiles.isEmpty())
+      if (!m_Buffers[bufferNameAsStdString]->Contains(requestedTime))
       {
-        if (m_Buffers[bufferNameAsStdString]->Contains(requestedTime))
+        std::unique_ptr<niftk::IGIDataType> wrapper;
+
+        std::map<std::string, std::unique_ptr<niftk::IGIDataSourcePlaybackCache> >::iterator cacheIter
+            = m_PlaybackCaches.find(bufferNameAsStdString);
+        if (cacheIter != m_PlaybackCaches.end())
+        {
+          wrapper = cacheIter->second->TakeItem(requestedTime);
+        }
+        else
         {
-          // Apart from String messages, we would only expect 1 message type from each device.
+          size_t numberOfBytes = 0;
+          wrapper = this->LoadPlaybackItem(bufferNameAsStdString, requestedTime, numberOfBytes);
+        }
 
-          this->LoadTrackingData(requestedTime, listOfRelevantFiles); // Removes processed filenames as a side effect.
-          this->LoadImage(requestedTime, listOfRelevantFiles);        // Removes processed filenames as a side effect.
+        if (wrapper)
+        {
+          wrapper->SetFrameId(m_FrameId++);
 
-          // listOfRelevantFiles should be empty at this point.
-          // However, there may be junk on disk that we are picking up.
-          // So, print out a filename, so at least developers may notice.
-          if (!listOfRelevantFiles.isEmpty())
-          {
-            for (int i = 0; i < listOfRelevantFiles.size(); i++)
-            {
-              MITK_INFO << "NiftyLinkDataSourceService::PlaybackData: Ignoring "
-                        << listOfRelevantFiles[i].toStdString();
-            }
-          }
+          // Buffer itself should be threadsafe, so I'm not locking anything here.
+          m_Buffers[bufferNameAsStdString]->AddToBuffer(wrapper);
         }
       }
     }
@@ -268,6 +319,46 @@ void NiftyLinkDataSourceService::PlaybackData(niftk::IGIDataSourceI::IGITimeType
 }
 
 
+//-----------------------------------------------------------------------------
+std::unique_ptr<niftk::IGIDataType> NiftyLinkDataSourceService::LoadPlaybackItem(
+    const std::string& bufferName,
+    const niftk::IGIDataSourceI::IGITimeType& time,
+    size_t& numberOfBytes)
+{
+  numberOfBytes = 0;
+
+  // Only read access, as the indexes are not modified while any cache is running.
+  QStringList listOfRelevantFiles = m_PlaybackFiles.value(QString::fromStdString(bufferName)).value(time);
+  if (listOfRelevantFiles.isEmpty())
+  {
+    return std::unique_ptr<niftk::IGIDataType>();
+  }
+
+  // Apart from String messages, we would only expect 1 message type from each device.
+  std::unique_ptr<niftk::IGIDataType> wrapper =
+    this->LoadTrackingData(time, listOfRelevantFiles, numberOfBytes); // Removes processed filenames as a side effect.
+
+  if (!wrapper)
+  {
+    wrapper = this->LoadImage(time, listOfRelevantFiles, numberOfBytes); // Removes processed filenames as a side effect.
+  }
+
+  // listOfRelevantFiles should be empty at this point.
+  // However, there may be junk on disk that we are picking up.
+  // So, print out a filename, so at least developers may notice.
+  if (!listOfRelevantFiles.isEmpty())
+  {
+    for (int i = 0; i < listOfRelevantFiles.size(); i++)
+    {
+      MITK_INFO << "NiftyLinkDataSourceService::LoadPlaybackItem: Ignoring "
+                << listOfRelevantFiles[i].toStdString();
+    }
+  }
+
+  return wrapper;
+}
+
+
 //-----------------------------------------------------------------------------
 QString NiftyLinkDataSourceService::GetDirectoryNamePart(const QString& fullPathName, int indexFromEnd)
 {
@@ -284,11 +375,14 @@ QString NiftyLinkDataSourceService::GetDirectoryNamePart(const QString& fullPath
 
 
 //-----------------------------------------------------------------------------
-void NiftyLinkDataSourceService::LoadImage(const niftk::IGIDataSourceI::IGITimeType& time, QStringList& listOfFileNames)
+std::unique_ptr<niftk::IGIDataType> NiftyLinkDataSourceService::LoadImage(
+    const niftk::IGIDataSourceI::IGITimeType& time, QStringList& listOfFileNames, size_t& numberOfBytes)
 {
+  std::unique_ptr<niftk::IGIDataType> result;
+
   if (listOfFileNames.isEmpty())
   {
-    return;
+    return result;
   }
 
   igtl::ImageMessage::Pointer msg = igtl::ImageMessage::New();
@@ -409,13 +503,13 @@ void NiftyLinkDataSourceService::LoadImage(const niftk::IGIDataSourceI::IGITimeT
         container->SetSenderHostName("localhost");
 
         std::unique_ptr<niftk::IGIDataType> wrapper(new niftk::NiftyLinkDataType(container));
-        wrapper->SetFrameId(m_FrameId++);
         wrapper->SetTimeStampInNanoSeconds(time);
         wrapper->SetDuration(this->GetTimeStampTolerance()); // nanoseconds
         wrapper->SetShouldBeSaved(false);
 
-        // Buffer itself should be threadsafe, so I'm not locking anything here.
-        m_Buffers[std::string(msg->GetDeviceName())]->AddToBuffer(wrapper);
+        // Frame id is set by the caller, when the item is added to the buffer.
+        numberOfBytes = msg->GetImageSize();
+        result = std::move(wrapper);
       }
       catch (mitk::Exception& e)
       {
@@ -434,16 +528,19 @@ void NiftyLinkDataSourceService::LoadImage(const niftk::IGIDataSourceI::IGITimeT
       ++iter;
     }
   }
+  return result;
 }
 
 
 //-----------------------------------------------------------------------------
-void NiftyLinkDataSourceService::LoadTrackingData(
-    const niftk::IGIDataSourceI::IGITimeType& time, QStringList& listOfFileNames)
+std::unique_ptr<niftk::IGIDataType> NiftyLinkDataSourceService::LoadTrackingData(
+    const niftk::IGIDataSourceI::IGITimeType& time, QStringList& listOfFileNames, size_t& numberOfBytes)
 {
+  std::unique_ptr<niftk::IGIDataType> result;
+
   if (listOfFileNames.isEmpty())
   {
-    return;
+    return result;
   }
 
   igtl::TrackingDataMessage::Pointer msg = igtl::TrackingDataMessage::New();
@@ -500,14 +597,15 @@ void NiftyLinkDataSourceService::LoadTrackingData(
     container->SetSenderHostName("localhost");
 
     std::unique_ptr<niftk::IGIDataType> wrapper(new niftk::NiftyLinkDataType(container));
-    wrapper->SetFrameId(m_FrameId++);
     wrapper->SetTimeStampInNanoSeconds(time);
     wrapper->SetDuration(this->GetTimeStampTolerance()); // nanoseconds
     wrapper->SetShouldBeSaved(false);
 
-    // Buffer itself should be threadsafe, so I'm not locking anything here.
-    m_Buffers[std::string(msg->GetDeviceName())]->AddToBuffer(wrapper);
+    // Frame id is set by the caller, when the item is added to the buffer.
+    numberOfBytes = msg->GetNumberOfTrackingDataElements() * sizeof(igtl::Matrix4x4);
+    result = std::move(wrapper);
   }
+  return result;
 }
 
 
@@ -729,14 +827,32 @@ void NiftyLinkDataSourceService::SaveTrackingData(niftk::NiftyLinkDataType& data
 }
 
 
+//-----------------------------------------------------------------------------
+void NiftyLinkDataSourceService::PrepareUpdate(const niftk::IGIDataSourceI::IGITimeType& time)
+{
+  m_IsPrepared = false;
+
+  if (this->GetIsPlayingBack())
+  {
+    this->PlaybackData(time);
+  }
+
+  m_PreparedTime = time;
+  m_IsPrepared = true;
+}
+
+
 //-----------------------------------------------------------------------------
 std::vector<IGIDataItemInfo> NiftyLinkDataSourceService::Update(const niftk::IGIDataSourceI::IGITimeType& time)
 {
   std::vector<IGIDataItemInfo> infos;
 
+  bool isPrepared = m_IsPrepared && m_PreparedTime == time;
+  m_IsPrepared = false;
+
   // This loads playback-data into the buffers, so must
   // come before the check for empty buffer.
-  if (this->GetIsPlayingBack())
+  if (this->GetIsPlayingBack() && !isPrepared)
   {
     this->PlaybackData(time);
   }
@@ -23,6 +23,9 @@
 #include <niftkIGIBufferedSaveableDataSourceI.h>
 #include <niftkIGISaveableDataSourceI.h>
 #include <niftkIGIDataSourceBackgroundSaveThread.h>
+#include <niftkIGIPlaybackLoadableDataSourceI.h>
+#include <niftkIGIPreparableDataSourceI.h>
+#include <niftkIGIDataSourcePlaybackCache.h>
 #include <NiftyLinkMessageContainer.h>
 
 #include <igtlTrackingDataMessage.h>
@@ -58,6 +61,9 @@ namespace niftk
 * NiftyLinkServerDataSourceService, and multiple clients try to connect,
 * then each client should be setting a unique device name on their messages.
 *
+* During playback, each device has a niftk::IGIDataSourcePlaybackCache,
+* so that files are loaded ahead of the playback position, in a background thread.
+*
 * Note: All errors should thrown as mitk::Exception or sub-classes thereof.
 */
 class NiftyLinkDataSourceService
@@ -66,6 +72,8 @@ class NiftyLinkDataSourceService
     , public IGISaveableDataSourceI
     , public IGIBufferedSaveableDataSourceI
     , public IGICleanableDataSourceI
+    , public IGIPlaybackLoadableDataSourceI
+    , public IGIPreparableDataSourceI
 {
 
   Q_OBJECT
@@ -95,6 +103,12 @@ public:
   */
   virtual std::vector<IGIDataItemInfo> Update(const niftk::IGIDataSourceI::IGITimeType& time) override;
 
+  /**
+  * \brief Loads playback data for the given time, so Update() only has to write to DataStorage.
+  * \see niftk::IGIPreparableDataSourceI::PrepareUpdate()
+  */
+  virtual void PrepareUpdate(const niftk::IGIDataSourceI::IGITimeType& time) override;
+
   /**
   * \see niftk::IGIDataSource::SaveItem()
   */
@@ -130,6 +144,15 @@ public:
   */
   virtual IGIDataSourceProperties GetProperties() const override;
 
+  /**
+  * \brief Loads the message(s) recorded for one device at one time,
+  * called from the niftk::IGIDataSourcePlaybackCache prefetch thread.
+  * \see niftk::IGIPlaybackLoadableDataSourceI::LoadPlaybackItem()
+  */
+  virtual std::unique_ptr<niftk::IGIDataType> LoadPlaybackItem(const std::string& bufferName,
+                                                               const niftk::IGIDataSourceI::IGITimeType& time,
+                                                               size_t& numberOfBytes) override;
+
 protected:
 
   NiftyLinkDataSourceService(QString name,
@@ -156,7 +179,9 @@ private:
                                                    igtl::TrackingDataMessage*);
 
   void SaveTrackingData(niftk::NiftyLinkDataType&, igtl::TrackingDataMessage*);
-  void LoadTrackingData(const niftk::IGIDataSourceI::IGITimeType& actualTime, QStringList& listOfFileNames);
+  std::unique_ptr<niftk::IGIDataType> LoadTrackingData(const niftk::IGIDataSourceI::IGITimeType& actualTime,
+                                                       QStringList& listOfFileNames,
+                                                       size_t& numberOfBytes);
 
   std::vector<IGIDataItemInfo> ReceiveImage(std::string bufferName,
                                             niftk::IGIDataSourceI::IGITimeType timeRequested,
@@ -164,7 +189,9 @@ private:
                                             igtl::ImageMessage*);
 
   void SaveImage(niftk::NiftyLinkDataType&, igtl::ImageMessage*);
-  void LoadImage(const niftk::IGIDataSourceI::IGITimeType& actualTime, QStringList& listOfFileNames);
+  std::unique_ptr<niftk::IGIDataType> LoadImage(const niftk::IGIDataSourceI::IGITimeType& actualTime,
+                                                QStringList& listOfFileNames,
+                                                size_t& numberOfBytes);
 
   std::vector<IGIDataItemInfo> ReceiveString(igtl::StringMessage*);
 
@@ -181,6 +208,9 @@ private:
   QMap<QString, std::set<niftk::IGIDataSourceI::IGITimeType> >               m_PlaybackIndex;
   QMap<QString, QHash<niftk::IGIDataSourceI::IGITimeType, QStringList> >     m_PlaybackFiles;
 
+  // One read-ahead cache per playback index, key is device name. Must be stopped before indexes are changed.
+  std::map<std::string, std::unique_ptr<niftk::IGIDataSourcePlaybackCache> > m_PlaybackCaches;
+
   // In contrast say to the OpenCV source, we store multiple buffers, key is device name.
   std::map<std::string, std::unique_ptr<niftk::IGIDataSourceWaitingBuffer> > m_Buffers;
 
@@ -191,6 +221,10 @@ private:
   // As of #5183, we support .nii, jpg and .png.
   QString                                                                    m_FileExtension;
 
+  // Set by PrepareUpdate(), so the following Update() does not load playback data again.
+  bool                                                                       m_IsPrepared;
+  niftk::IGIDataSourceI::IGITimeType                                         m_PreparedTime;
+
 }; // end class
 
 } // end namespace
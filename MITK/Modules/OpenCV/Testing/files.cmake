@@ -31,6 +31,7 @@ set(MODULE_CUSTOM_TESTS
   mitkIdealStereoCalibrationTest.cxx
   mitkUndistortionLoopTest.cxx
   mitkProjectCameraRaysTest.cxx
+  mitkStereoVideoProcessorPipelineTest.cxx
 )
 
 if(OPENCV_WITH_NONFREE)
@@ -0,0 +1,258 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#if defined(_MSC_VER)
+#pragma warning ( disable : 4786 )
+#endif
+
+#include <mitkTestingMacros.h>
+#include <mitkLogMacros.h>
+#include <mitkStereoOneTimePointVideoProcessorTemplateMethod.h>
+#include <mitkStereoTwoTimePointVideoProcessorTemplateMethod.h>
+#include <cv.h>
+#include <highgui.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+const int          s_Width = 32;
+const int          s_Height = 24;
+const unsigned int s_NumberOfFrames = 14;
+
+//-----------------------------------------------------------------------------
+void ReleaseFrames(std::vector<IplImage*>& frames)
+{
+  for (unsigned int i = 0; i < frames.size(); i++)
+  {
+    cvReleaseImage(&frames[i]);
+  }
+  frames.clear();
+}
+
+
+//-----------------------------------------------------------------------------
+/**
+ * \brief Averages and subtracts the left and right images, and keeps
+ * the outputs, rather than writing them, so they can be compared.
+ */
+class TestOneTimePointProcessor : public mitk::StereoOneTimePointVideoProcessorTemplateMethod
+{
+public:
+
+  mitkClassMacro(TestOneTimePointProcessor, mitk::StereoOneTimePointVideoProcessorTemplateMethod)
+  mitkNewMacro3Param(TestOneTimePointProcessor, const bool&, CvCapture*, CvVideoWriter*)
+
+  const std::vector<IplImage*>& GetFrames() const { return m_Frames; }
+
+protected:
+
+  TestOneTimePointProcessor(const bool& writeInterleaved, CvCapture *capture, CvVideoWriter *writer)
+  : mitk::StereoOneTimePointVideoProcessorTemplateMethod(writeInterleaved, capture, writer)
+  {
+  }
+
+  ~TestOneTimePointProcessor()
+  {
+    ReleaseFrames(m_Frames);
+  }
+
+  virtual void DoProcessing(const IplImage &leftInput, const IplImage &rightInput, IplImage &leftOutput, IplImage &rightOutput) override
+  {
+    cvAddWeighted(&leftInput, 0.5, &rightInput, 0.5, 0, &leftOutput);
+    cvSub(&rightInput, &leftInput, &rightOutput);
+  }
+
+  virtual void WriteOutput(IplImage &leftOutput, IplImage &rightOutput) override
+  {
+    m_Frames.push_back(cvCloneImage(&leftOutput));
+    m_Frames.push_back(cvCloneImage(&rightOutput));
+  }
+
+private:
+
+  std::vector<IplImage*> m_Frames;
+};
+
+
+//-----------------------------------------------------------------------------
+/**
+ * \brief Takes the difference between the two time points of each
+ * side, and keeps the outputs, rather than writing them.
+ */
+class TestTwoTimePointProcessor : public mitk::StereoTwoTimePointVideoProcessorTemplateMethod
+{
+public:
+
+  mitkClassMacro(TestTwoTimePointProcessor, mitk::StereoTwoTimePointVideoProcessorTemplateMethod)
+  mitkNewMacro3Param(TestTwoTimePointProcessor, const bool&, CvCapture*, CvVideoWriter*)
+
+  const std::vector<IplImage*>& GetFrames() const { return m_Frames; }
+
+protected:
+
+  TestTwoTimePointProcessor(const bool& writeInterleaved, CvCapture *capture, CvVideoWriter *writer)
+  : mitk::StereoTwoTimePointVideoProcessorTemplateMethod(writeInterleaved, capture, writer)
+  {
+  }
+
+  ~TestTwoTimePointProcessor()
+  {
+    ReleaseFrames(m_Frames);
+  }
+
+  virtual void DoProcessing(
+      const IplImage &leftT1,
+      const IplImage &rightT1,
+      const IplImage &leftT2,
+      const IplImage &rightT2,
+      IplImage &leftOutput,
+      IplImage &rightOutput) override
+  {
+    cvAbsDiff(&leftT2, &leftT1, &leftOutput);
+    cvAbsDiff(&rightT2, &rightT1, &rightOutput);
+  }
+
+  virtual void WriteOutput(IplImage &leftOutput, IplImage &rightOutput) override
+  {
+    m_Frames.push_back(cvCloneImage(&leftOutput));
+    m_Frames.push_back(cvCloneImage(&rightOutput));
+  }
+
+private:
+
+  std::vector<IplImage*> m_Frames;
+};
+
+
+//-----------------------------------------------------------------------------
+/**
+ * \brief Writes a sequence of losslessly compressed frames, each different, that OpenCV can capture from.
+ */
+std::string WriteSyntheticFrames(const std::string& directory)
+{
+  std::string pattern = directory + "/mitkStereoVideoProcessorPipelineTest%03d.png";
+
+  IplImage *image = cvCreateImage(cvSize(s_Width, s_Height), IPL_DEPTH_8U, 3);
+  for (unsigned int i = 0; i < s_NumberOfFrames; i++)
+  {
+    for (int y = 0; y < s_Height; y++)
+    {
+      unsigned char *row = reinterpret_cast<unsigned char*>(image->imageData + y * image->widthStep);
+      for (int x = 0; x < s_Width; x++)
+      {
+        for (int c = 0; c < 3; c++)
+        {
+          row[3 * x + c] = static_cast<unsigned char>((7 * x + 13 * y + 29 * i + 50 * c) % 256);
+        }
+      }
+    }
+
+    char fileName[1024];
+    sprintf(fileName, pattern.c_str(), i);
+    cvSaveImage(fileName, image);
+  }
+  cvReleaseImage(&image);
+
+  return pattern;
+}
+
+
+//-----------------------------------------------------------------------------
+/**
+ * \brief Runs a new processor, reading the synthetic frames, with the given number of processing threads.
+ */
+template <typename TProcessor>
+typename TProcessor::Pointer RunProcessor(const std::string& inputPattern, const std::string& directory, unsigned int numberOfThreads)
+{
+  CvCapture *capture = cvCreateFileCapture(inputPattern.c_str());
+  MITK_TEST_CONDITION_REQUIRED(capture != NULL, "Checking the synthetic frames can be captured from " << inputPattern);
+
+  // Never written to, as the processors keep their outputs, but the processors need one.
+  std::string outputPattern = directory + "/mitkStereoVideoProcessorPipelineTestOutput%03d.png";
+  CvVideoWriter *writer = cvCreateVideoWriter(outputPattern.c_str(), 0, 0, cvSize(s_Width, s_Height));
+  MITK_TEST_CONDITION_REQUIRED(writer != NULL, "Checking a video writer can be created for " << outputPattern);
+
+  typename TProcessor::Pointer processor = TProcessor::New(true, capture, writer);
+  processor->Initialize();
+  processor->SetNumberOfProcessingThreads(numberOfThreads);
+  processor->Run();
+
+  return processor;
+}
+
+
+//-----------------------------------------------------------------------------
+bool AreSameFrames(const std::vector<IplImage*>& expected, const std::vector<IplImage*>& actual)
+{
+  if (expected.size() != actual.size())
+  {
+    MITK_ERROR << "Expected " << expected.size() << " frames, actual=" << actual.size();
+    return false;
+  }
+  for (unsigned int i = 0; i < expected.size(); i++)
+  {
+    if (cvNorm(expected[i], actual[i], CV_L1) != 0)
+    {
+      MITK_ERROR << "Frame " << i << " differs";
+      return false;
+    }
+  }
+  return true;
+}
+
+
+//-----------------------------------------------------------------------------
+template <typename TProcessor>
+void TestPipelineMatchesRun(const std::string& inputPattern, const std::string& directory, unsigned int expectedNumberOfFrames)
+{
+  typename TProcessor::Pointer sequential = RunProcessor<TProcessor>(inputPattern, directory, 0);
+  MITK_TEST_CONDITION_REQUIRED(sequential->GetFrames().size() == expectedNumberOfFrames,
+                               "Checking Run() writes " << expectedNumberOfFrames << " frames, actual=" << sequential->GetFrames().size());
+
+  unsigned int threads[] = { 1, 4 };
+  for (unsigned int t = 0; t < 2; t++)
+  {
+    typename TProcessor::Pointer pipelined = RunProcessor<TProcessor>(inputPattern, directory, threads[t]);
+    MITK_TEST_CONDITION(AreSameFrames(sequential->GetFrames(), pipelined->GetFrames()),
+                        "Checking the frames processed on " << threads[t] << " threads are the same as from Run()");
+  }
+}
+
+} // end namespace
+
+
+/**
+ * \file Checks that the stereo video processors give exactly the same frames, in the same order,
+ * whether processing on the calling thread, or in the pipeline on several threads at once.
+ */
+int mitkStereoVideoProcessorPipelineTest(int argc, char * argv[])
+{
+  // always start with this!
+  MITK_TEST_BEGIN("mitkStereoVideoProcessorPipelineTest");
+
+  MITK_TEST_CONDITION_REQUIRED(argc > 1, "Checking a directory for the synthetic frames was given");
+  std::string directory = argv[1];
+
+  std::string inputPattern = WriteSyntheticFrames(directory);
+
+  // Initialize() drops 2 frames. The one time point processor writes each pair of the
+  // rest, and the two time point processor every pair after the first.
+  TestPipelineMatchesRun<TestOneTimePointProcessor>(inputPattern, directory, s_NumberOfFrames - 2);
+  TestPipelineMatchesRun<TestTwoTimePointProcessor>(inputPattern, directory, s_NumberOfFrames - 4);
+
+  MITK_TEST_END();
+}
@@ -15,10 +15,47 @@
 #include "mitkBaseVideoProcessor.h"
 
 #include <mitkOpenCVFileIOUtils.h>
+#include <itkTimeProbe.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <stdexcept>
 
 namespace mitk
 {
 
+//-----------------------------------------------------------------------------
+/**
+ * \brief Queues of items between the stages of BaseVideoProcessor::RunPipeline(), all guarded by m_Mutex.
+ */
+struct BaseVideoProcessor::PipelineState
+{
+  BaseVideoProcessor*                    m_Processor;
+  unsigned int                           m_NumberOfInputs;
+  unsigned int                           m_NumberOfSharedInputs;
+
+  std::vector<PipelineItem>              m_Items;
+  std::vector<IplImage*>                 m_SharedInputs;
+
+  std::mutex                             m_Mutex;
+  std::condition_variable                m_Condition;
+  std::vector<PipelineItem*>             m_FreeItems;
+  std::deque<PipelineItem*>              m_DecodedItems;
+  std::map<unsigned long, PipelineItem*> m_ProcessedItems;
+  unsigned long                          m_NumberOfDecodedItems;
+  unsigned long                          m_NumberOfWrittenItems;
+  bool                                   m_IsDecodingFinished;
+  std::string                            m_ErrorMessage;
+
+  itk::TimeProbe                         m_DecodeProbe;
+  std::vector<itk::TimeProbe>            m_ProcessProbes;
+  itk::TimeProbe                         m_EncodeProbe;
+};
+
+
 //-----------------------------------------------------------------------------
 BaseVideoProcessor::~BaseVideoProcessor()
 {
@@ -34,6 +71,7 @@ BaseVideoProcessor::BaseVideoProcessor(CvCapture *capture, CvVideoWriter *writer
 , m_Writer(writer)
 , m_InputFileName("")
 , m_OutputFileName("")
+, m_NumberOfProcessingThreads(0)
 {
   // For this constructor, we are assuming capture and writer are valid objects,
   // created outside this class and injected in, so bail out early if not true.
@@ -57,6 +95,7 @@ BaseVideoProcessor::BaseVideoProcessor(const std::string& inputFile, const std::
 , m_Writer(NULL)
 , m_InputFileName(inputFile)
 , m_OutputFileName(outputFile)
+, m_NumberOfProcessingThreads(0)
 {
   // For this constructor, we are assuming inputFile and outputFile are valid strings,
   // but at this stage, we are not checking if the files are valid, just that the strings are non-empty.
@@ -161,4 +200,285 @@ CvVideoWriter* BaseVideoProcessor::GetWriter() const
   return m_Writer;
 }
 
+
+//-----------------------------------------------------------------------------
+void BaseVideoProcessor::ProcessPipelineItem(PipelineItem& item)
+{
+  throw std::logic_error("This video processor does not support pipelined processing.");
+}
+
+
+//-----------------------------------------------------------------------------
+void BaseVideoProcessor::WritePipelineItem(PipelineItem& item)
+{
+  throw std::logic_error("This video processor does not support pipelined processing.");
+}
+
+
+//-----------------------------------------------------------------------------
+void BaseVideoProcessor::RunPipeline(unsigned int numberOfInputs, unsigned int numberOfSharedInputs, unsigned int numberOfOutputs)
+{
+  if (numberOfInputs == 0 || numberOfSharedInputs >= numberOfInputs)
+  {
+    throw std::logic_error("Each item must grab at least one new frame.");
+  }
+
+  itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+  threader->SetNumberOfThreads(std::max(m_NumberOfProcessingThreads, 1u) + 2);
+  if (threader->GetNumberOfThreads() < 3)
+  {
+    throw std::logic_error("Pipelined processing needs at least 3 threads.");
+  }
+  unsigned int numberOfWorkers = threader->GetNumberOfThreads() - 2;
+
+  // Enough items for every worker to have one, while another is decoded and another is encoded.
+  IplImage *image = this->GetCurrentImage();
+
+  PipelineState state;
+  state.m_Processor = this;
+  state.m_NumberOfInputs = numberOfInputs;
+  state.m_NumberOfSharedInputs = numberOfSharedInputs;
+  state.m_Items.resize(2 * numberOfWorkers + 2);
+  for (unsigned int i = 0; i < state.m_Items.size(); i++)
+  {
+    for (unsigned int j = 0; j < numberOfInputs; j++)
+    {
+      state.m_Items[i].m_Inputs.push_back(cvCloneImage(image));
+    }
+    for (unsigned int j = 0; j < numberOfOutputs; j++)
+    {
+      state.m_Items[i].m_Outputs.push_back(cvCloneImage(image));
+    }
+    state.m_Items[i].m_SequenceNumber = 0;
+    state.m_FreeItems.push_back(&state.m_Items[i]);
+  }
+  for (unsigned int j = 0; j < numberOfSharedInputs; j++)
+  {
+    state.m_SharedInputs.push_back(cvCloneImage(image));
+  }
+  state.m_NumberOfDecodedItems = 0;
+  state.m_NumberOfWrittenItems = 0;
+  state.m_IsDecodingFinished = false;
+  state.m_ProcessProbes.resize(numberOfWorkers);
+
+  itk::TimeProbe totalProbe;
+  totalProbe.Start();
+
+  threader->SetSingleMethod(PipelineThreaderCallback, &state);
+  threader->SingleMethodExecute();
+
+  totalProbe.Stop();
+
+  for (unsigned int i = 0; i < state.m_Items.size(); i++)
+  {
+    for (unsigned int j = 0; j < state.m_Items[i].m_Inputs.size(); j++)
+    {
+      cvReleaseImage(&state.m_Items[i].m_Inputs[j]);
+    }
+    for (unsigned int j = 0; j < state.m_Items[i].m_Outputs.size(); j++)
+    {
+      cvReleaseImage(&state.m_Items[i].m_Outputs[j]);
+    }
+  }
+  for (unsigned int j = 0; j < state.m_SharedInputs.size(); j++)
+  {
+    cvReleaseImage(&state.m_SharedInputs[j]);
+  }
+
+  if (!state.m_ErrorMessage.empty())
+  {
+    throw std::logic_error(state.m_ErrorMessage);
+  }
+
+  // The throughput of each stage, if it had the time to itself, so the slowest stage is the one to speed up.
+  double processingTime = 0;
+  for (unsigned int i = 0; i < state.m_ProcessProbes.size(); i++)
+  {
+    processingTime += state.m_ProcessProbes[i].GetTotal();
+  }
+
+  double items = static_cast<double>(state.m_NumberOfWrittenItems);
+  std::cout << "Pipeline wrote " << state.m_NumberOfWrittenItems << " items in " << totalProbe.GetTotal() << "s"
+            << ", " << (totalProbe.GetTotal() > 0 ? items / totalProbe.GetTotal() : 0) << " items/s" << std::endl;
+  std::cout << "  decode:     " << (state.m_DecodeProbe.GetTotal() > 0 ? items / state.m_DecodeProbe.GetTotal() : 0) << " items/s on 1 thread" << std::endl;
+  std::cout << "  processing: " << (processingTime > 0 ? items * numberOfWorkers / processingTime : 0) << " items/s on " << numberOfWorkers << " threads" << std::endl;
+  std::cout << "  encode:     " << (state.m_EncodeProbe.GetTotal() > 0 ? items / state.m_EncodeProbe.GetTotal() : 0) << " items/s on 1 thread" << std::endl;
+}
+
+
+//-----------------------------------------------------------------------------
+ITK_THREAD_RETURN_TYPE BaseVideoProcessor::PipelineThreaderCallback(void *arg)
+{
+  itk::ThreadIdType threadId = ((itk::MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  PipelineState *state = (PipelineState *)(((itk::MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  try
+  {
+    if (threadId == 0)
+    {
+      state->m_Processor->DecodePipelineItems(*state);
+    }
+    else if (threadId == 1)
+    {
+      state->m_Processor->EncodePipelineItems(*state);
+    }
+    else
+    {
+      state->m_Processor->ProcessPipelineItems(*state, threadId - 2);
+    }
+  }
+  catch (std::exception& e)
+  {
+    std::lock_guard<std::mutex> lock(state->m_Mutex);
+    if (state->m_ErrorMessage.empty())
+    {
+      state->m_ErrorMessage = e.what();
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(state->m_Mutex);
+  if (threadId == 0)
+  {
+    state->m_IsDecodingFinished = true;
+  }
+  state->m_Condition.notify_all();
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+
+//-----------------------------------------------------------------------------
+void BaseVideoProcessor::DecodePipelineItems(PipelineState& state)
+{
+  bool hasPreviousItem = false;
+
+  while (true)
+  {
+    PipelineItem *item = NULL;
+    {
+      std::unique_lock<std::mutex> lock(state.m_Mutex);
+      state.m_Condition.wait(lock, [&state]() { return !state.m_FreeItems.empty() || !state.m_ErrorMessage.empty(); });
+      if (!state.m_ErrorMessage.empty())
+      {
+        return;
+      }
+      item = state.m_FreeItems.back();
+      state.m_FreeItems.pop_back();
+    }
+
+    state.m_DecodeProbe.Start();
+
+    unsigned int firstNewInput = 0;
+    if (hasPreviousItem)
+    {
+      for (unsigned int i = 0; i < state.m_NumberOfSharedInputs; i++)
+      {
+        cvCopy(state.m_SharedInputs[i], item->m_Inputs[i]);
+      }
+      firstNewInput = state.m_NumberOfSharedInputs;
+    }
+
+    // This will return NULL at end of file, and an incomplete item is dropped, as in Run().
+    bool isComplete = true;
+    for (unsigned int i = firstNewInput; i < state.m_NumberOfInputs && isComplete; i++)
+    {
+      IplImage *image = this->GrabNewImage();
+      if (image == NULL)
+      {
+        isComplete = false;
+      }
+      else
+      {
+        cvCopy(image, item->m_Inputs[i]);
+      }
+    }
+
+    if (isComplete)
+    {
+      for (unsigned int i = 0; i < state.m_NumberOfSharedInputs; i++)
+      {
+        cvCopy(item->m_Inputs[state.m_NumberOfInputs - state.m_NumberOfSharedInputs + i], state.m_SharedInputs[i]);
+      }
+    }
+
+    state.m_DecodeProbe.Stop();
+
+    std::lock_guard<std::mutex> lock(state.m_Mutex);
+    if (!isComplete)
+    {
+      state.m_FreeItems.push_back(item);
+      return;
+    }
+    item->m_SequenceNumber = state.m_NumberOfDecodedItems++;
+    state.m_DecodedItems.push_back(item);
+    state.m_Condition.notify_all();
+
+    hasPreviousItem = true;
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+void BaseVideoProcessor::ProcessPipelineItems(PipelineState& state, unsigned int worker)
+{
+  while (true)
+  {
+    PipelineItem *item = NULL;
+    {
+      std::unique_lock<std::mutex> lock(state.m_Mutex);
+      state.m_Condition.wait(lock, [&state]() {
+        return !state.m_DecodedItems.empty() || state.m_IsDecodingFinished || !state.m_ErrorMessage.empty();
+      });
+      if (!state.m_ErrorMessage.empty() || state.m_DecodedItems.empty())
+      {
+        return;
+      }
+      item = state.m_DecodedItems.front();
+      state.m_DecodedItems.pop_front();
+    }
+
+    state.m_ProcessProbes[worker].Start();
+    this->ProcessPipelineItem(*item);
+    state.m_ProcessProbes[worker].Stop();
+
+    std::lock_guard<std::mutex> lock(state.m_Mutex);
+    state.m_ProcessedItems[item->m_SequenceNumber] = item;
+    state.m_Condition.notify_all();
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+void BaseVideoProcessor::EncodePipelineItems(PipelineState& state)
+{
+  while (true)
+  {
+    PipelineItem *item = NULL;
+    {
+      std::unique_lock<std::mutex> lock(state.m_Mutex);
+      state.m_Condition.wait(lock, [&state]() {
+        return !state.m_ErrorMessage.empty()
+            || state.m_ProcessedItems.count(state.m_NumberOfWrittenItems) > 0
+            || (state.m_IsDecodingFinished && state.m_NumberOfWrittenItems == state.m_NumberOfDecodedItems);
+      });
+      std::map<unsigned long, PipelineItem*>::iterator next = state.m_ProcessedItems.find(state.m_NumberOfWrittenItems);
+      if (!state.m_ErrorMessage.empty() || next == state.m_ProcessedItems.end())
+      {
+        return;
+      }
+      item = next->second;
+      state.m_ProcessedItems.erase(next);
+    }
+
+    state.m_EncodeProbe.Start();
+    this->WritePipelineItem(*item);
+    state.m_EncodeProbe.Stop();
+
+    std::lock_guard<std::mutex> lock(state.m_Mutex);
+    state.m_FreeItems.push_back(item);
+    state.m_NumberOfWrittenItems++;
+    state.m_Condition.notify_all();
+  }
+}
+
 } // end namespace
@@ -21,6 +21,8 @@
 #include <highgui.h>
 #include <cstdlib>
 #include <iostream>
+#include <vector>
+#include <itkMultiThreader.h>
 #include <itkObject.h>
 #include <itkObjectFactory.h>
 #include <mitkCommon.h>
@@ -51,8 +53,26 @@ public:
    */
   virtual void Run() = 0;
 
+  /**
+   * \brief Sets the number of threads that derived classes that support RunPipeline() use for processing.
+   * The default, 0, decodes, processes and encodes each frame in turn, on the calling thread.
+   */
+  itkSetMacro(NumberOfProcessingThreads, unsigned int);
+  itkGetConstMacro(NumberOfProcessingThreads, unsigned int);
+
 protected:
 
+  /**
+   * \brief A group of consecutive grabbed frames, and the images they are processed into,
+   * which is passed between the stages of RunPipeline(), and then recycled.
+   */
+  struct PipelineItem
+  {
+    std::vector<IplImage*> m_Inputs;
+    std::vector<IplImage*> m_Outputs;
+    unsigned long          m_SequenceNumber;
+  };
+
   ~BaseVideoProcessor();
   BaseVideoProcessor(CvCapture *capture = NULL, CvVideoWriter *writer = NULL);
   BaseVideoProcessor(const std::string& inputFile, const std::string& outputFile);
@@ -82,13 +102,44 @@ protected:
    */
   CvVideoWriter* GetWriter() const;
 
+  /**
+   * \brief Runs decoding, processing and encoding on separate threads, until the capture device runs out of frames.
+   *
+   * One thread grabs numberOfInputs consecutive frames into each item, the first numberOfSharedInputs
+   * of which are the last frames of the previous item, for processing that looks at more than one time point.
+   * GetNumberOfProcessingThreads() threads call ProcessPipelineItem() on different items at the same time,
+   * and another thread calls WritePipelineItem() on them in the order that they were grabbed. The items are
+   * allocated once, as copies of the current image, and recycled. At the end, the throughput of each stage
+   * is written to std::cout. Throws std::logic_error if any stage failed.
+   */
+  void RunPipeline(unsigned int numberOfInputs, unsigned int numberOfSharedInputs, unsigned int numberOfOutputs);
+
+  /**
+   * \brief Processes the inputs of item into its outputs. Called on several threads at once, on different items.
+   */
+  virtual void ProcessPipelineItem(PipelineItem& item);
+
+  /**
+   * \brief Writes the outputs of item. Called on one thread, in the order that the items were grabbed.
+   */
+  virtual void WritePipelineItem(PipelineItem& item);
+
 private:
 
+  struct PipelineState;
+
+  static ITK_THREAD_RETURN_TYPE PipelineThreaderCallback(void *arg);
+
+  void DecodePipelineItems(PipelineState& state);
+  void ProcessPipelineItems(PipelineState& state, unsigned int worker);
+  void EncodePipelineItems(PipelineState& state);
+
   IplImage      *m_GrabbedImage;
   CvCapture     *m_Capture;
   CvVideoWriter *m_Writer;
   std::string    m_InputFileName;
   std::string    m_OutputFileName;
+  unsigned int   m_NumberOfProcessingThreads;
 }; // end class
 
 } // end namespace
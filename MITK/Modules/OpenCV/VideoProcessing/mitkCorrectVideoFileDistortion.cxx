@@ -41,7 +41,8 @@ bool CorrectVideoFileDistortion::Correct(
     const std::string& inputIntrinsicsFileNameRight,
     const std::string& inputDistortionCoefficientsFileNameRight,
     const std::string& outputImageFileName,
-    bool writeInterleaved
+    bool writeInterleaved,
+    unsigned int numberOfProcessingThreads
     )
 {
   bool isSuccessful = false;
@@ -75,6 +76,7 @@ bool CorrectVideoFileDistortion::Correct(
 
     StereoDistortionCorrectionVideoProcessor::Pointer processor = StereoDistortionCorrectionVideoProcessor::New(writeInterleaved, inputImageFileName, outputImageFileName);
     processor->SetMatrices(*intrinsicLeft, *distortionLeft, *intrinsicRight, *distortionRight);
+    processor->SetNumberOfProcessingThreads(numberOfProcessingThreads);
     processor->Initialize();
     processor->Run();
 
@@ -35,6 +35,10 @@ public:
   mitkClassMacroItkParent(CorrectVideoFileDistortion, itk::Object)
   itkNewMacro(CorrectVideoFileDistortion)
 
+  /**
+   * \brief Corrects the video, using numberOfProcessingThreads threads for the undistortion,
+   * while frames are decoded and encoded on others, or if 0, all in turn on the calling thread.
+   */
   bool Correct(
       const std::string& inputImageFileName,
       const std::string& inputIntrinsicsFileNameLeft,
@@ -42,7 +46,8 @@ public:
       const std::string& inputIntrinsicsFileNameRight,
       const std::string& inputDistortionCoefficientsFileNameRight,
       const std::string& outputImageFileName,
-      bool writeInterleaved
+      bool writeInterleaved,
+      unsigned int numberOfProcessingThreads = 0
       );
 
 protected:
@@ -69,6 +69,12 @@ void StereoOneTimePointVideoProcessorTemplateMethod::Initialize()
 //-----------------------------------------------------------------------------
 void StereoOneTimePointVideoProcessorTemplateMethod::Run()
 {
+  if (this->GetNumberOfProcessingThreads() > 0)
+  {
+    this->RunPipeline(2, 0, 2);
+    return;
+  }
+
   IplImage *image = NULL;
 
   while((image = this->GrabNewImage()) != NULL)
@@ -94,4 +100,16 @@ void StereoOneTimePointVideoProcessorTemplateMethod::Run()
   }
 }
 
+
+//-----------------------------------------------------------------------------
+void StereoOneTimePointVideoProcessorTemplateMethod::ProcessPipelineItem(PipelineItem& item)
+{
+  this->DoProcessing(
+      *item.m_Inputs[0],
+      *item.m_Inputs[1],
+      *item.m_Outputs[0],
+      *item.m_Outputs[1]
+      );
+}
+
 } // end namespace
@@ -38,7 +38,7 @@ public:
   virtual void Initialize() override;
 
   /**
-   * \brief BaseVideoProcessor::Run()
+   * \brief BaseVideoProcessor::Run(), which uses BaseVideoProcessor::RunPipeline() if GetNumberOfProcessingThreads() is not 0.
    */
   virtual void Run() override;
 
@@ -53,9 +53,15 @@ protected:
 
   /**
    * \brief Derived classes override this method to do their processing.
+   * If GetNumberOfProcessingThreads() is not 0, it is called on several threads at once, on different images.
    */
   virtual void DoProcessing(const IplImage &leftInput, const IplImage &rightInput, IplImage &leftOutput, IplImage &rightOutput) = 0;
 
+  /**
+   * \brief Calls DoProcessing() on the inputs of item, \see BaseVideoProcessor::RunPipeline().
+   */
+  virtual void ProcessPipelineItem(PipelineItem& item) override;
+
 private:
 
   IplImage      *m_LeftInput;
@@ -77,6 +77,12 @@ void StereoTwoTimePointVideoProcessorTemplateMethod::Initialize()
 //-----------------------------------------------------------------------------
 void StereoTwoTimePointVideoProcessorTemplateMethod::Run()
 {
+  if (this->GetNumberOfProcessingThreads() > 0)
+  {
+    this->RunPipeline(4, 2, 2);
+    return;
+  }
+
   IplImage *image = NULL;
 
   image = this->GrabNewImage();
@@ -131,4 +137,18 @@ void StereoTwoTimePointVideoProcessorTemplateMethod::Run()
   }
 }
 
+
+//-----------------------------------------------------------------------------
+void StereoTwoTimePointVideoProcessorTemplateMethod::ProcessPipelineItem(PipelineItem& item)
+{
+  this->DoProcessing(
+      *item.m_Inputs[0],
+      *item.m_Inputs[1],
+      *item.m_Inputs[2],
+      *item.m_Inputs[3],
+      *item.m_Outputs[0],
+      *item.m_Outputs[1]
+      );
+}
+
 } // end namespace
@@ -38,7 +38,7 @@ public:
   virtual void Initialize() override;
 
   /**
-   * \brief BaseVideoProcessor::Run()
+   * \brief BaseVideoProcessor::Run(), which uses BaseVideoProcessor::RunPipeline() if GetNumberOfProcessingThreads() is not 0.
    */
   virtual void Run() override;
 
@@ -53,6 +53,7 @@ protected:
 
   /**
    * \brief Derived classes override this method to do their processing.
+   * If GetNumberOfProcessingThreads() is not 0, it is called on several threads at once, on different images.
    */
   virtual void DoProcessing(
       const IplImage &leftT1,
@@ -62,6 +63,11 @@ protected:
       IplImage &leftOutput,
       IplImage &rightOutput) = 0;
 
+  /**
+   * \brief Calls DoProcessing() on the inputs of item, \see BaseVideoProcessor::RunPipeline().
+   */
+  virtual void ProcessPipelineItem(PipelineItem& item) override;
+
 private:
 
   IplImage      *m_LeftT1;
@@ -111,4 +111,11 @@ void StereoVideoProcessorTemplateMethod::WriteOutput(IplImage &leftOutput, IplIm
 }
 
 
+//-----------------------------------------------------------------------------
+void StereoVideoProcessorTemplateMethod::WritePipelineItem(PipelineItem& item)
+{
+  this->WriteOutput(*item.m_Outputs[0], *item.m_Outputs[1]);
+}
+
+
 } // end namespace
@@ -60,6 +60,11 @@ protected:
    */
   virtual void WriteOutput(IplImage &leftOutput, IplImage &rightOutput);
 
+  /**
+   * \brief Writes the first two outputs of item as a stereo pair, \see BaseVideoProcessor::RunPipeline().
+   */
+  virtual void WritePipelineItem(PipelineItem& item) override;
+
 private:
 
   bool           m_WriteInterleaved;
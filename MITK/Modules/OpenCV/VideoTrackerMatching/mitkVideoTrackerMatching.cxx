@@ -126,13 +126,9 @@ void VideoTrackerMatching::ProcessFrameMapFile ()
   unsigned int channel;
   unsigned long long timeStamp;
   unsigned int linenumber = 0;
-  cv::Mat trackingMatrix ( 4, 4, CV_64FC1 );
 
   m_FrameNumbers.clear();
-  for ( unsigned int i = 0 ; i < m_TrackingMatricesAndTimeStamps.size() ; i ++ )
-  {
-    m_TimingErrors[i].clear();
-  }
+  m_VideoTimeStamps.Clear();
   while ( std::getline(fin,line) )
   {
     if ( line[0] != '#' )
@@ -143,23 +139,6 @@ void VideoTrackerMatching::ProcessFrameMapFile ()
       {
         m_FrameNumbers.push_back(frameNumber);
         m_VideoTimeStamps.Insert(timeStamp);
-        
-        for ( unsigned int i = 0 ; i < m_TrackingMatricesAndTimeStamps.size() ; i ++ )
-        {
-          long long timingError;
-          if ( m_VideoLeadsTracking[i] )
-          {
-            m_TrackingMatricesAndTimeStamps[i].GetNearestTimeStamp(
-                timeStamp + m_VideoLag[i], &timingError);
-          }
-          else
-          {
-            m_TrackingMatricesAndTimeStamps[i].GetNearestTimeStamp(
-                timeStamp - m_VideoLag[i], &timingError);
-          }
-          
-          m_TimingErrors[i].push_back(timingError);
-        }
 
         if ( frameNumber != linenumber++ )
         {
@@ -177,6 +156,26 @@ void VideoTrackerMatching::ProcessFrameMapFile ()
       }
     }
   }
+
+  // Match all the video frames to each tracker in one pass, rather than searching for each frame.
+  std::vector<TimeStampsContainer::TimeStamp> targetTimeStamps(m_VideoTimeStamps.GetSize());
+  std::vector<std::vector<TimeStampsContainer::TimeStamp>::size_type> trackingFrameNumbers;
+
+  for ( unsigned int i = 0 ; i < m_TrackingMatricesAndTimeStamps.size() ; i ++ )
+  {
+    for ( unsigned int j = 0 ; j < targetTimeStamps.size() ; j ++ )
+    {
+      if ( m_VideoLeadsTracking[i] )
+      {
+        targetTimeStamps[j] = m_VideoTimeStamps.GetTimeStamp(j) + m_VideoLag[i];
+      }
+      else
+      {
+        targetTimeStamps[j] = m_VideoTimeStamps.GetTimeStamp(j) - m_VideoLag[i];
+      }
+    }
+    m_TrackingMatricesAndTimeStamps[i].GetNearestFrameNumbers(targetTimeStamps, trackingFrameNumbers, m_TimingErrors[i]);
+  }
     
   MITK_INFO << "Read " << linenumber << " lines from " << m_FrameMap;
 }
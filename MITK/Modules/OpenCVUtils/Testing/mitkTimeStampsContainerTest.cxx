@@ -20,6 +20,8 @@
 #include <mitkTestingMacros.h>
 #include <mitkLogMacros.h>
 #include <mitkTimeStampsContainer.h>
+#include <cstdlib>
+#include <vector>
 
 /**
  * \file Test harness for mitk::TimeStampsContainer.
@@ -132,6 +134,60 @@ int mitkTimeStampsContainerTest(int argc, char * argv[])
   result = timeStamps.GetNearestTimeStamp(1421408026430455200 , &delta);
   MITK_TEST_CONDITION (result == 1421408023440156000, "GetNearestTimeStamp() Middle of shortened list, expecting result==1421408023440156000, and got:" << result);
 
+  // Test GetFrameNumber() and GetBoundingFrameNumbers() on a longer list, which is long enough to be interpolation searched.
+  std::vector<mitk::TimeStampsContainer::TimeStamp>::size_type beforeIndex = 0;
+  std::vector<mitk::TimeStampsContainer::TimeStamp>::size_type afterIndex = 0;
+  timeStamps.Clear();
+  isValid = timeStamps.GetBoundingFrameNumbers(1, beforeIndex, afterIndex, proportion);
+  MITK_TEST_CONDITION (!isValid && beforeIndex == -1 && afterIndex == -1, "GetBoundingFrameNumbers(): Empty list, expecting isValid==false, before==-1, after==-1, and got:" << isValid << ", " << beforeIndex << ", " << afterIndex);
+  for (unsigned long long i = 0; i < 100; i++)
+  {
+    // Unevenly spaced, with a big gap in the middle.
+    timeStamps.Insert(1421408023440156000 + i * 33000000 + (i % 7) * 1000000 + (i >= 50 ? 5000000000 : 0));
+  }
+  bool allFound = true;
+  for (std::vector<mitk::TimeStampsContainer::TimeStamp>::size_type i = 0; i < timeStamps.GetSize(); i++)
+  {
+    allFound = allFound && timeStamps.GetFrameNumber(timeStamps.GetTimeStamp(i)) == i;
+    allFound = allFound && timeStamps.GetFrameNumber(timeStamps.GetTimeStamp(i) + 1) == -1;
+  }
+  MITK_TEST_CONDITION (allFound, "GetFrameNumber(): Finds every item in a list of 100, and nothing in between");
+  isValid = timeStamps.GetBoundingFrameNumbers(timeStamps.GetTimeStamp(49) + 1000, beforeIndex, afterIndex, proportion);
+  MITK_TEST_CONDITION (isValid && beforeIndex == 49 && afterIndex == 50, "GetBoundingFrameNumbers(): Across the gap, expecting before==49, after==50, and got:" << beforeIndex << ", " << afterIndex);
+  isValid = timeStamps.GetBoundingFrameNumbers(timeStamps.GetTimeStamp(99) + 1, beforeIndex, afterIndex, proportion);
+  MITK_TEST_CONDITION (!isValid && beforeIndex == 99 && afterIndex == -1, "GetBoundingFrameNumbers(): Off top end of list, expecting before==99, after==-1, and got:" << beforeIndex << ", " << afterIndex);
+  isValid = timeStamps.GetBoundingFrameNumbers(timeStamps.GetTimeStamp(0) - 1, beforeIndex, afterIndex, proportion);
+  MITK_TEST_CONDITION (!isValid && beforeIndex == -1 && afterIndex == 0, "GetBoundingFrameNumbers(): Off bottom end of list, expecting before==-1, after==0, and got:" << beforeIndex << ", " << afterIndex);
+
+  // Test GetNearestFrameNumbers() gives the same as GetNearestTimeStamp(), for increasing and shuffled inputs.
+  std::vector<mitk::TimeStampsContainer::TimeStamp> inputs;
+  for (unsigned long long i = 0; i < 500; i++)
+  {
+    inputs.push_back(timeStamps.GetTimeStamp(0) - 100000000 + i * 17000000 + std::rand() % 1000000);
+  }
+  inputs.push_back(timeStamps.GetTimeStamp(10));
+  inputs.push_back(timeStamps.GetTimeStamp(3));
+  inputs.push_back((timeStamps.GetTimeStamp(20) + timeStamps.GetTimeStamp(21)) / 2);
+  std::vector<std::vector<mitk::TimeStampsContainer::TimeStamp>::size_type> frameNumbers;
+  std::vector<long long> deltas;
+  timeStamps.GetNearestFrameNumbers(inputs, frameNumbers, deltas);
+  bool allSame = frameNumbers.size() == inputs.size() && deltas.size() == inputs.size();
+  for (std::vector<mitk::TimeStampsContainer::TimeStamp>::size_type i = 0; allSame && i < inputs.size(); i++)
+  {
+    result = timeStamps.GetNearestTimeStamp(inputs[i], &delta);
+    allSame = timeStamps.GetTimeStamp(frameNumbers[i]) == result && deltas[i] == delta;
+  }
+  MITK_TEST_CONDITION (allSame, "GetNearestFrameNumbers(): Same as GetNearestTimeStamp() for each of " << inputs.size() << " inputs");
+
+  // Test GetFrameNumber() still works on an unsorted list.
+  timeStamps.Clear();
+  timeStamps.Insert(30);
+  timeStamps.Insert(10);
+  timeStamps.Insert(20);
+  MITK_TEST_CONDITION (timeStamps.GetFrameNumber(10) == 1, "GetFrameNumber(): Unsorted list, expecting 1, and got:" << timeStamps.GetFrameNumber(10));
+  timeStamps.Sort();
+  MITK_TEST_CONDITION (timeStamps.GetFrameNumber(10) == 0, "GetFrameNumber(): Sorted list, expecting 0, and got:" << timeStamps.GetFrameNumber(10));
+
   MITK_TEST_END();
 }
 
@@ -26,6 +26,7 @@
 #include <mitkTimeStampsContainer.h>
 #include <mitkIOUtil.h>
 #include <niftkFileHelper.h>
+#include <niftkTrackingMatrixStore.h>
 #include <boost/math/special_functions/fpclassify.hpp>
 
 namespace mitk {
@@ -33,6 +34,11 @@ namespace mitk {
 //---------------------------------------------------------------------------
 bool CheckIfDirectoryContainsTrackingMatrices(const std::string& directory)
 {
+  if (niftk::TrackingMatrixStore::IsInDirectory(directory))
+  {
+    return true;
+  }
+
   boost::regex timeStampFilter ( "([0-9]{19})(.txt)");
   boost::filesystem::directory_iterator endItr;
 
@@ -80,6 +86,16 @@ mitk::TimeStampsContainer FindTrackingTimeStamps(std::string directory)
   boost::regex timeStampFilter ( "([0-9]{19})(.txt)");
   TimeStampsContainer returnStamps;
 
+  if (niftk::TrackingMatrixStore::IsInDirectory(directory))
+  {
+    niftk::TrackingMatrixStore store(niftk::TrackingMatrixStore::GetFileNameInDirectory(directory));
+    for (size_t i = 0; i < store.GetNumberOfMatrices(); i++)
+    {
+      returnStamps.Insert(store.GetTimeStamp(i));
+    }
+    return returnStamps;
+  }
+
   for ( boost::filesystem::directory_iterator it(directory);it != endItr ; ++it)
   {
     if ( boost::filesystem::is_regular_file (it->status()) )
@@ -409,6 +425,23 @@ std::vector< std::pair<unsigned long long, cv::Point3d> > LoadTimeStampedTransla
 {
   std::vector< std::pair<unsigned long long, cv::Point3d> > timeStampedTranslations;
 
+  if (niftk::TrackingMatrixStore::IsInDirectory(directory))
+  {
+    niftk::TrackingMatrixStore store(niftk::TrackingMatrixStore::GetFileNameInDirectory(directory));
+    for (size_t i = 0; i < store.GetNumberOfMatrices(); i++)
+    {
+      const double* matrix = store.GetMatrix(i);
+
+      cv::Point3d translation;
+      translation.x = matrix[3];
+      translation.y = matrix[7];
+      translation.z = matrix[11];
+
+      timeStampedTranslations.push_back(std::pair<unsigned long long, cv::Point3d>(store.GetTimeStamp(i), translation));
+    }
+    return timeStampedTranslations;
+  }
+
   std::vector<std::string> trackingFiles = niftk::GetFilesInDirectory(directory);
   std::sort(trackingFiles.begin(), trackingFiles.end());
 
@@ -27,7 +27,8 @@
 namespace mitk {
 
 /**
- * \brief Iterates through a directory to see if it contains any files that have a timestamp as a name, and end in .txt
+ * \brief Iterates through a directory to see if it contains any files that have a timestamp as a name, and end in .txt,
+ * or a niftk::TrackingMatrixStore file.
  */
 extern "C++" NIFTKOPENCVUTILS_EXPORT bool CheckIfDirectoryContainsTrackingMatrices(const std::string& directory);
 
@@ -107,7 +108,8 @@ extern "C++" NIFTKOPENCVUTILS_EXPORT unsigned long long ExtractTimeStampOrThrow(
 extern "C++" NIFTKOPENCVUTILS_EXPORT std::vector< std::pair<unsigned long long, cv::Point3d> > LoadTimeStampedPoints(const std::string& directory);
 
 /**
- * \brief Loads points from a directory, where each point is in a separate file, and the filename is a timestamp.
+ * \brief Loads the translations of tracking matrices from a directory, where each matrix is in a separate file,
+ * and the filename is a timestamp, or from the niftk::TrackingMatrixStore file in the directory, if there is one.
  */
 extern "C++" NIFTKOPENCVUTILS_EXPORT std::vector< std::pair<unsigned long long, cv::Point3d> > LoadTimeStampedTranslations(const std::string& directory);
 
@@ -21,10 +21,20 @@
 
 namespace mitk {
 
+//---------------------------------------------------------------------------
+TimeStampsContainer::TimeStampsContainer()
+: m_IsSorted(true)
+{
+}
+
 
 //---------------------------------------------------------------------------
 void TimeStampsContainer::Insert(const TimeStamp& timeStamp)
 {
+  if (!m_TimeStamps.empty() && timeStamp < m_TimeStamps.back())
+  {
+    m_IsSorted = false;
+  }
   m_TimeStamps.push_back(timeStamp);
 }
 
@@ -56,6 +66,7 @@ TimeStampsContainer::TimeStamp TimeStampsContainer::GetTimeStamp(std::vector<Tim
 void TimeStampsContainer::Sort()
 {
   std::sort(m_TimeStamps.begin(), m_TimeStamps.end());
+  m_IsSorted = true;
 }
 
 
@@ -63,6 +74,7 @@ void TimeStampsContainer::Sort()
 void TimeStampsContainer::Clear()
 {
   m_TimeStamps.clear();
+  m_IsSorted = true;
 }
 
 
@@ -73,19 +85,70 @@ std::vector<TimeStampsContainer::TimeStamp>::size_type TimeStampsContainer::GetS
 }
 
 
+//---------------------------------------------------------------------------
+std::vector<TimeStampsContainer::TimeStamp>::size_type TimeStampsContainer::LowerBound(const TimeStamp& timeStamp) const
+{
+  // Tracking and video time stamps are close to evenly spaced, so a few steps of interpolation
+  // search usually land right next to the answer. The bisection that finishes the search
+  // keeps it O(log n) if they are not.
+  std::vector<TimeStamp>::size_type low = 0;
+  std::vector<TimeStamp>::size_type high = m_TimeStamps.size();
+
+  for (int step = 0; step < 4 && high - low > 8; step++)
+  {
+    TimeStamp first = m_TimeStamps[low];
+    TimeStamp last = m_TimeStamps[high - 1];
+
+    if (timeStamp <= first)
+    {
+      return low;
+    }
+    if (timeStamp > last)
+    {
+      return high;
+    }
+
+    // The answer is in (low, high - 1], and so is the guess.
+    double fraction = static_cast<double>(timeStamp - first) / static_cast<double>(last - first);
+    std::vector<TimeStamp>::size_type guess = low + static_cast<std::vector<TimeStamp>::size_type>(fraction * (high - 1 - low));
+
+    if (m_TimeStamps[guess] < timeStamp)
+    {
+      low = guess + 1;
+    }
+    else
+    {
+      high = guess + 1;
+    }
+  }
+
+  return std::lower_bound(m_TimeStamps.begin() + low, m_TimeStamps.begin() + high, timeStamp) - m_TimeStamps.begin();
+}
+
+
 //---------------------------------------------------------------------------
 std::vector<TimeStampsContainer::TimeStamp>::size_type TimeStampsContainer::GetFrameNumber(const TimeStamp& timeStamp) const
 {
   std::vector<TimeStampsContainer::TimeStamp>::size_type result = -1;
   std::vector<TimeStampsContainer::TimeStamp>::size_type i;
 
-  for (i = 0; i < m_TimeStamps.size(); i++)
+  if (!m_IsSorted)
   {
-    if (m_TimeStamps[i] == timeStamp)
+    for (i = 0; i < m_TimeStamps.size(); i++)
     {
-      result = i;
-      break;
+      if (m_TimeStamps[i] == timeStamp)
+      {
+        result = i;
+        break;
+      }
     }
+    return result;
+  }
+
+  i = this->LowerBound(timeStamp);
+  if (i < m_TimeStamps.size() && m_TimeStamps[i] == timeStamp)
+  {
+    result = i;
   }
 
   return result;
@@ -93,15 +156,15 @@ std::vector<TimeStampsContainer::TimeStamp>::size_type TimeStampsContainer::GetF
 
 
 //---------------------------------------------------------------------------
-bool TimeStampsContainer::GetBoundingTimeStamps(const TimeStamp& input,
-                                                     TimeStamp& before,
-                                                     TimeStamp& after,
-                                                     double& proportion
-                                                    ) const
+bool TimeStampsContainer::GetBoundingFrameNumbers(const TimeStamp& input,
+                                                  std::vector<TimeStampsContainer::TimeStamp>::size_type& before,
+                                                  std::vector<TimeStampsContainer::TimeStamp>::size_type& after,
+                                                  double& proportion
+                                                 ) const
 {
   bool isValid = false;
-  before = 0;             // So that even if user fails to check return code,
-  after = 0;              // they will notice a lack of timestamps.
+  before = -1;
+  after = -1;
   proportion = 0;
 
   if (m_TimeStamps.size() == 0)
@@ -109,51 +172,52 @@ bool TimeStampsContainer::GetBoundingTimeStamps(const TimeStamp& input,
     return isValid;
   }
 
-  if (input < *(m_TimeStamps.begin()))
+  std::vector<TimeStampsContainer::TimeStamp>::size_type i = this->LowerBound(input);
+
+  if (i == m_TimeStamps.size())
   {
-    after = *(m_TimeStamps.begin());
+    before = i - 1;
     return isValid;
   }
 
-  if (input == *(m_TimeStamps.begin()))
+  if (m_TimeStamps[i] == input)
   {
-    before = input;
-    after = input;
-    proportion = 0;
+    before = i;
+    after = i;
     isValid = true;
     return isValid;
   }
 
-  // This assumes that the value tested for is within the range.
-  std::vector<unsigned long long>::const_iterator iter = std::lower_bound (m_TimeStamps.begin() , m_TimeStamps.end(), input);
-
-  if (iter == m_TimeStamps.end())
+  if (i == 0)
   {
-    --iter;
-    before = *iter;
+    after = i;
     return isValid;
   }
 
-  if (iter == m_TimeStamps.begin())
-  {
-    after = *iter;
-    return isValid;
-  }
+  before = i - 1;
+  after = i;
+  proportion = static_cast<double>(input - m_TimeStamps[before])/static_cast<double>(m_TimeStamps[after] - m_TimeStamps[before]);
+  isValid = true;
 
-  if (*iter == input)
-  {
-    before = input;
-    after = input;
-    proportion = 0;
-    isValid = true;
-    return isValid;
-  }
+  return isValid;
+}
 
-  after = *iter;
-  --iter;
-  before = *iter;
-  proportion = static_cast<double>(input - before)/static_cast<double>(after-before);
-  isValid = true;
+
+//---------------------------------------------------------------------------
+bool TimeStampsContainer::GetBoundingTimeStamps(const TimeStamp& input,
+                                                     TimeStamp& before,
+                                                     TimeStamp& after,
+                                                     double& proportion
+                                                    ) const
+{
+  std::vector<TimeStampsContainer::TimeStamp>::size_type beforeIndex;
+  std::vector<TimeStampsContainer::TimeStamp>::size_type afterIndex;
+
+  bool isValid = this->GetBoundingFrameNumbers(input, beforeIndex, afterIndex, proportion);
+
+  // So that even if user fails to check return code, they will notice a lack of timestamps.
+  before = beforeIndex < m_TimeStamps.size() ? m_TimeStamps[beforeIndex] : 0;
+  after = afterIndex < m_TimeStamps.size() ? m_TimeStamps[afterIndex] : 0;
 
   return isValid;
 }
@@ -238,4 +302,57 @@ unsigned long long TimeStampsContainer::GetNearestTimeStamp (const TimeStamp& ti
   return result;
 }
 
+
+//---------------------------------------------------------------------------
+void TimeStampsContainer::GetNearestFrameNumbers(const std::vector<TimeStamp>& timeStamps,
+                                                 std::vector<std::vector<TimeStampsContainer::TimeStamp>::size_type>& frameNumbers,
+                                                 std::vector<long long>& deltas
+                                                ) const
+{
+  frameNumbers.assign(timeStamps.size(), -1);
+  deltas.assign(timeStamps.size(), 0);
+
+  if (m_TimeStamps.size() == 0)
+  {
+    return;
+  }
+
+  // i is the first timestamp in the list that is not before the current input.
+  std::vector<TimeStampsContainer::TimeStamp>::size_type i = 0;
+
+  for (std::vector<TimeStamp>::size_type j = 0; j < timeStamps.size(); j++)
+  {
+    const TimeStamp& timeStamp = timeStamps[j];
+
+    if (j > 0 && timeStamp < timeStamps[j - 1])
+    {
+      i = this->LowerBound(timeStamp);
+    }
+    else
+    {
+      while (i < m_TimeStamps.size() && m_TimeStamps[i] < timeStamp)
+      {
+        i++;
+      }
+    }
+
+    std::vector<TimeStampsContainer::TimeStamp>::size_type nearest = i;
+    if (i == m_TimeStamps.size())
+    {
+      nearest = i - 1;
+    }
+    else if (i > 0 && m_TimeStamps[i] != timeStamp)
+    {
+      // Ties go to the earlier timestamp, as in GetNearestTimeStamp().
+      if (timeStamp - m_TimeStamps[i - 1] <= m_TimeStamps[i] - timeStamp)
+      {
+        nearest = i - 1;
+      }
+    }
+
+    frameNumbers[j] = nearest;
+    deltas[j] = timeStamp - m_TimeStamps[nearest];
+  }
+}
+
 } // end namespace
@@ -25,6 +25,9 @@ namespace mitk
  * \class TimeStampsContainer
  * \brief Helper class that contains a vector of timestamps, that are assumed to be strictly increasing.
  *
+ * All lookups search the contiguous, sorted vector, so take O(log n) time. If time stamps
+ * are inserted out of order, call Sort() before looking them up.
+ *
  * See also mitkTimeStampsContainerTest.cxx.
  */
 class NIFTKOPENCVUTILS_EXPORT TimeStampsContainer
@@ -33,6 +36,8 @@ public:
 
   typedef unsigned long long TimeStamp;
 
+  TimeStampsContainer();
+
   /**
    * \brief Empties the list.
    */
@@ -68,9 +73,22 @@ public:
    * \brief Given a timeStamp in nanoseconds, will search the list for the corresponding array index, returning -1 if not found.
    * \param[in] timeStamp in nano-seconds since Unix Epoch (UTC).
    * \return vector index number or -1 if not found.
+   *
+   * This is a binary search, unless time stamps have been inserted out of order and
+   * not sorted since, in which case the list is scanned.
    */
   std::vector<TimeStampsContainer::TimeStamp>::size_type GetFrameNumber(const TimeStamp& timeStamp) const;
 
+  /**
+   * \brief As GetBoundingTimeStamps(), but returns the array indexes of the timestamps
+   * before and after the given point, or -1 where GetBoundingTimeStamps() returns 0.
+   */
+  bool GetBoundingFrameNumbers(const TimeStamp& timeStamp,
+                               std::vector<TimeStampsContainer::TimeStamp>::size_type& before,
+                               std::vector<TimeStampsContainer::TimeStamp>::size_type& after,
+                               double& proportion
+                              ) const;
+
   /**
    * \brief Retrieves the timestamps before and after a given point.
    *
@@ -105,9 +123,31 @@ public:
    */
   TimeStamp GetNearestTimeStamp (const TimeStamp& timeStamp , long long * delta = NULL ) const;
 
+  /**
+   * \brief Finds the nearest timestamp to each of a vector of timestamps, in one pass.
+   *
+   * \param[in] timeStamps in nano-seconds since Unix Epoch (UTC), normally increasing.
+   * \param[out] frameNumbers the array index of the nearest timestamp to each input, or -1 if the list is empty.
+   * \param[out] deltas the number of nanoseconds between each input and its nearest timestamp, as for GetNearestTimeStamp().
+   *
+   * The result is the same as calling GetNearestTimeStamp() for each input, but if the inputs are
+   * increasing, both lists are walked together, taking O(n + m) time instead of O(n log m).
+   * An input that is earlier than the one before it is searched for again.
+   */
+  void GetNearestFrameNumbers(const std::vector<TimeStamp>& timeStamps,
+                              std::vector<std::vector<TimeStampsContainer::TimeStamp>::size_type>& frameNumbers,
+                              std::vector<long long>& deltas
+                             ) const;
+
 private:
 
+  /**
+   * \brief Returns the index of the first timestamp that is not before the given one, or the size of the list.
+   */
+  std::vector<TimeStamp>::size_type LowerBound(const TimeStamp& timeStamp) const;
+
   std::vector<TimeStamp> m_TimeStamps;
+  bool                   m_IsSorted;
 
 };
 
@@ -18,6 +18,7 @@
 #include <mitkOpenCVFileIOUtils.h>
 #include <mitkOpenCVMaths.h>
 #include <mitkExceptionMacro.h>
+#include <niftkTrackingMatrixStore.h>
 #include <boost/filesystem.hpp>
 #include <boost/regex.hpp>
 #include <boost/lexical_cast.hpp>
@@ -39,6 +40,20 @@ int TrackingAndTimeStampsContainer::LoadFromDirectory(const std::string& dirName
 {
   int loadFailures = 0;
 
+  // A packed store is used in preference to the individual files, which it was made from.
+  if (niftk::TrackingMatrixStore::IsInDirectory(dirName))
+  {
+    niftk::TrackingMatrixStore store(niftk::TrackingMatrixStore::GetFileNameInDirectory(dirName));
+
+    for (size_t i = 0; i < store.GetNumberOfMatrices(); i++)
+    {
+      const double* elements = store.GetMatrix(i);
+      m_TimeStamps.Insert(store.GetTimeStamp(i));
+      m_TrackingMatrices.push_back(cv::Matx44d(elements));
+    }
+    return loadFailures;
+  }
+
   if (!CheckIfDirectoryContainsTrackingMatrices(dirName))
   {
     std::ostringstream errorMessage;
@@ -188,11 +203,17 @@ TimeStampsContainer::TimeStamp TrackingAndTimeStampsContainer::GetNearestTimeSta
   return m_TimeStamps.GetNearestTimeStamp(timeStamp, delta);
 }
 
+//-----------------------------------------------------------------------------
+void TrackingAndTimeStampsContainer::GetNearestFrameNumbers(const std::vector<TimeStampsContainer::TimeStamp>& timeStamps,
+                                                            std::vector<std::vector<TimeStampsContainer::TimeStamp>::size_type>& frameNumbers,
+                                                            std::vector<long long>& deltas) const
+{
+  m_TimeStamps.GetNearestFrameNumbers(timeStamps, frameNumbers, deltas);
+}
+
 //-----------------------------------------------------------------------------
 cv::Matx44d TrackingAndTimeStampsContainer::InterpolateMatrix(const TimeStampsContainer::TimeStamp& timeStamp, long long& minError, bool& inBounds)
 {
-  TimeStampsContainer::TimeStamp before;
-  TimeStampsContainer::TimeStamp after;
   double proportion = 0;
   inBounds=false;
     
@@ -205,19 +226,16 @@ cv::Matx44d TrackingAndTimeStampsContainer::InterpolateMatrix(const TimeStampsCo
     mitkThrow() << "TrackingAndTimeStampsContainer::InterpolateMatrix There are no tracking matrices set";
   }
 
-  if (m_TimeStamps.GetBoundingTimeStamps(timeStamp, before, after, proportion))
+  if (m_TimeStamps.GetBoundingFrameNumbers(timeStamp, indexBefore, indexAfter, proportion))
   {
-    indexBefore = this->GetFrameNumber(before);
-    indexAfter = this->GetFrameNumber(after);
-
     mitk::InterpolateTransformationMatrix(m_TrackingMatrices[indexBefore], m_TrackingMatrices[indexAfter], proportion, interpolatedMatrix);
     if ( proportion > 0.5 )
     {
-      minError = timeStamp - after;
+      minError = timeStamp - m_TimeStamps.GetTimeStamp(indexAfter);
     }
     else
     {
-      minError = timeStamp - before;
+      minError = timeStamp - m_TimeStamps.GetTimeStamp(indexBefore);
     }
     inBounds = true;
     return interpolatedMatrix;
@@ -225,16 +243,14 @@ cv::Matx44d TrackingAndTimeStampsContainer::InterpolateMatrix(const TimeStampsCo
   else
   {
     inBounds=false;
-    if ( before == 0 ) 
+    if ( indexBefore >= m_TrackingMatrices.size() ) 
     {
-      minError = timeStamp - after;
-      indexAfter = this->GetFrameNumber(after);
+      minError = timeStamp - m_TimeStamps.GetTimeStamp(indexAfter);
       return m_TrackingMatrices[indexAfter];
     }
     else
     {
-      minError = timeStamp - before;
-      indexBefore = this->GetFrameNumber(before);
+      minError = timeStamp - m_TimeStamps.GetTimeStamp(indexBefore);
       return m_TrackingMatrices[indexBefore];
     }
   }
@@ -243,8 +259,6 @@ cv::Matx44d TrackingAndTimeStampsContainer::InterpolateMatrix(const TimeStampsCo
 //-----------------------------------------------------------------------------
 cv::Matx44d TrackingAndTimeStampsContainer::GetNearestMatrix(const TimeStampsContainer::TimeStamp& timeStamp, long long& error, bool& inBounds)
 {
-  TimeStampsContainer::TimeStamp before;
-  TimeStampsContainer::TimeStamp after;
   double proportion = 0;
   inBounds=false;
     
@@ -256,36 +270,32 @@ cv::Matx44d TrackingAndTimeStampsContainer::GetNearestMatrix(const TimeStampsCon
     mitkThrow() << "TrackingAndTimeStampsContainer::GetNearestMatrix There are no tracking matrices set";
   }
 
-  if (m_TimeStamps.GetBoundingTimeStamps(timeStamp, before, after, proportion))
+  if (m_TimeStamps.GetBoundingFrameNumbers(timeStamp, indexBefore, indexAfter, proportion))
   {
     inBounds = true;
-    indexBefore = this->GetFrameNumber(before);
-    indexAfter = this->GetFrameNumber(after);
 
     if ( proportion > 0.5 )
     {
-      error = timeStamp - after;
+      error = timeStamp - m_TimeStamps.GetTimeStamp(indexAfter);
       return m_TrackingMatrices[indexAfter];
     }
     else
     {
-      error = timeStamp - before;
+      error = timeStamp - m_TimeStamps.GetTimeStamp(indexBefore);
       return m_TrackingMatrices[indexBefore];
     }
   }
   else
   {
     inBounds=false;
-    if ( before == 0 ) 
+    if ( indexBefore >= m_TrackingMatrices.size() ) 
     {
-      error = timeStamp - after;
-      indexAfter = this->GetFrameNumber(after);
+      error = timeStamp - m_TimeStamps.GetTimeStamp(indexAfter);
       return m_TrackingMatrices[indexAfter];
     }
     else
     {
-      error = timeStamp - before;
-      indexBefore = this->GetFrameNumber(before);
+      error = timeStamp - m_TimeStamps.GetTimeStamp(indexBefore);
       return m_TrackingMatrices[indexBefore];
     }
   }
@@ -39,7 +39,8 @@ public:
   void Clear();
 
   /**
-   * \brief Loads tracking data from directory.
+   * \brief Loads tracking data from directory, either from one <timestamp>.txt file per matrix,
+   * or from the niftk::TrackingMatrixStore file in the directory, if there is one.
    * \return The number of matrix files that failed on read
    */
   int LoadFromDirectory(const std::string& dirName, const bool& haltOnMatrixReadFail);
@@ -81,6 +82,13 @@ public:
    */
   TimeStampsContainer::TimeStamp GetNearestTimeStamp(const TimeStampsContainer::TimeStamp& timeStamp, long long *delta = NULL ) const;
 
+  /**
+   * \see mitk::TimeStampsContainer::GetNearestFrameNumbers()
+   */
+  void GetNearestFrameNumbers(const std::vector<TimeStampsContainer::TimeStamp>& timeStamps,
+                              std::vector<std::vector<TimeStampsContainer::TimeStamp>::size_type>& frameNumbers,
+                              std::vector<long long>& deltas) const;
+
   /**
    * \brief Extracts a matrix for the given time-stamp, by interpolating.
    * \param the desired time stamp and a holder to return the timing error.
@@ -78,6 +78,11 @@ OpenCVVideoDataSourceService::OpenCVVideoDataSourceService(
 //-----------------------------------------------------------------------------
 OpenCVVideoDataSourceService::~OpenCVVideoDataSourceService()
 {
+  // Make sure queued frames are written while SaveImage() is still available,
+  // and that nothing is being read ahead while LoadImage() is still available.
+  this->StopRecording();
+  this->StopPlayback();
+
   if (m_VideoSource->IsCapturingEnabled())
   {
     m_VideoSource->StopCapturing();
@@ -144,8 +149,6 @@ void OpenCVVideoDataSourceService::SaveImage(const std::string& filename,
   {
     mitkThrow() << "Failed to save OpenCVVideoDataType to file:" << filename;
   }
-
-  data.SetIsSaved(true);
 }
 
 
@@ -162,6 +165,19 @@ std::unique_ptr<niftk::IGIDataType> OpenCVVideoDataSourceService::LoadImage(cons
 }
 
 
+//-----------------------------------------------------------------------------
+size_t OpenCVVideoDataSourceService::GetImageSizeInBytes(const niftk::IGIDataType& item) const
+{
+  const niftk::OpenCVVideoDataType* dataType = dynamic_cast<const niftk::OpenCVVideoDataType*>(&item);
+  if (dataType == nullptr || dataType->GetImage() == nullptr)
+  {
+    return 0;
+  }
+  const IplImage* image = dataType->GetImage();
+  return static_cast<size_t>(image->width) * image->height * image->nChannels * ((image->depth & 255) / 8);
+}
+
+
 //-----------------------------------------------------------------------------
 mitk::Image::Pointer OpenCVVideoDataSourceService::RetrieveImage(
     const niftk::IGIDataSourceI::IGITimeType& requestedTime,
@@ -78,6 +78,11 @@ QtCameraVideoDataSourceService::QtCameraVideoDataSourceService(
 //-----------------------------------------------------------------------------
 QtCameraVideoDataSourceService::~QtCameraVideoDataSourceService()
 {
+  // Make sure queued frames are written while SaveImage() is still available,
+  // and that nothing is being read ahead while LoadImage() is still available.
+  this->StopRecording();
+  this->StopPlayback();
+
   if (m_Camera != nullptr)
   {
     m_Camera->stop();
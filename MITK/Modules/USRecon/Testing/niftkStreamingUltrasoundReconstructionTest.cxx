@@ -0,0 +1,178 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#include <cmath>
+
+#include <niftkUltrasoundProcessing.h>
+#include <mitkTestingMacros.h>
+#include <mitkImageToItk.h>
+#include <itkImage.h>
+#include <itkImageRegionConstIterator.h>
+#include <vtkSmartPointer.h>
+#include <vtkMatrix4x4.h>
+
+namespace niftk
+{
+
+typedef itk::Image<unsigned char, 3> ImageType;
+
+//-----------------------------------------------------------------------------
+/// Creates a sweep of frames with a pattern on them, tilting a little about x as they move along z.
+MatrixTrackedImageData CreateSweep(int numberOfFrames)
+{
+  MatrixTrackedImageData data;
+
+  for (int num = 0; num < numberOfFrames; num++)
+  {
+    ImageType::SizeType size;
+    size[0] = 64;
+    size[1] = 48;
+    size[2] = 1;
+
+    ImageType::RegionType region;
+    region.SetSize(size);
+
+    ImageType::Pointer frame = ImageType::New();
+    frame->SetRegions(region);
+    frame->Allocate();
+
+    unsigned char* pixels = frame->GetBufferPointer();
+    for (unsigned int j = 0; j < size[1]; j++)
+    {
+      for (unsigned int i = 0; i < size[0]; i++)
+      {
+        // Leave a black border, which is ignored by the reconstruction.
+        bool isBorder = i < 4 || j < 4;
+        pixels[i + j * size[0]] = isBorder ? 0 : static_cast<unsigned char>(1 + (i * 7 + j * 3 + num * 5) % 250);
+      }
+    }
+
+    mitk::Image::Pointer image = mitk::Image::New();
+    image->InitializeByItk(frame.GetPointer());
+    image->SetVolume(frame->GetBufferPointer());
+
+    double angle = 0.02 * num;
+
+    vtkSmartPointer<vtkMatrix4x4> tracking = vtkSmartPointer<vtkMatrix4x4>::New();
+    tracking->Identity();
+    tracking->SetElement(1, 1, std::cos(angle));
+    tracking->SetElement(1, 2, -std::sin(angle));
+    tracking->SetElement(2, 1, std::sin(angle));
+    tracking->SetElement(2, 2, std::cos(angle));
+    tracking->SetElement(0, 3, 0.1 * num);
+    tracking->SetElement(2, 3, 0.4 * num);
+
+    data.push_back(MatrixTrackedImage(image, tracking));
+  }
+
+  return data;
+}
+
+
+//-----------------------------------------------------------------------------
+/// Returns the fraction of voxels that differ, or 1 if the volumes are not the same size.
+double GetFractionOfDifferentVoxels(const mitk::Image::Pointer& a, const mitk::Image::Pointer& b)
+{
+  ImageType::Pointer itkA = mitk::ImageToItkImage<unsigned char, 3>(a);
+  ImageType::Pointer itkB = mitk::ImageToItkImage<unsigned char, 3>(b);
+
+  if (itkA->GetLargestPossibleRegion().GetSize() != itkB->GetLargestPossibleRegion().GetSize())
+  {
+    return 1;
+  }
+
+  itk::ImageRegionConstIterator<ImageType> iterA(itkA, itkA->GetLargestPossibleRegion());
+  itk::ImageRegionConstIterator<ImageType> iterB(itkB, itkB->GetLargestPossibleRegion());
+
+  double different = 0;
+  double total = 0;
+
+  for (iterA.GoToBegin(), iterB.GoToBegin(); !iterA.IsAtEnd(); ++iterA, ++iterB)
+  {
+    if (iterA.Get() != iterB.Get())
+    {
+      different++;
+    }
+    total++;
+  }
+
+  return different / total;
+}
+
+
+//-----------------------------------------------------------------------------
+/// Returns the number of voxels that are zero.
+unsigned long CountEmptyVoxels(const mitk::Image::Pointer& image)
+{
+  ImageType::Pointer itkImage = mitk::ImageToItkImage<unsigned char, 3>(image);
+  itk::ImageRegionConstIterator<ImageType> iter(itkImage, itkImage->GetLargestPossibleRegion());
+
+  unsigned long count = 0;
+  for (iter.GoToBegin(); !iter.IsAtEnd(); ++iter)
+  {
+    if (iter.Get() == 0)
+    {
+      count++;
+    }
+  }
+  return count;
+}
+
+}
+
+/**
+ * Checks that the streaming reconstruction gives the same volume as the original one,
+ * and the same volume on any number of threads.
+ */
+int niftkStreamingUltrasoundReconstructionTest(int argc, char * argv[])
+{
+  // Always start with this, with name of function.
+  MITK_TEST_BEGIN("niftkStreamingUltrasoundReconstructionTest");
+
+  niftk::MatrixTrackedImageData data = niftk::CreateSweep(40);
+
+  mitk::Point2D scaleFactors;
+  scaleFactors[0] = 0.25;
+  scaleFactors[1] = 0.3;
+
+  niftk::RotationTranslation imageToSensor;
+  imageToSensor.first[0] = 1; // Identity quaternion, w first.
+  imageToSensor.first[1] = 0;
+  imageToSensor.first[2] = 0;
+  imageToSensor.first[3] = 0;
+  imageToSensor.second[0] = 1;
+  imageToSensor.second[1] = 2;
+  imageToSensor.second[2] = 3;
+
+  mitk::Vector3D spacing;
+  spacing[0] = 0.5;
+  spacing[1] = 0.5;
+  spacing[2] = 0.5;
+
+  mitk::Image::Pointer expected = niftk::DoUltrasoundReconstruction(data, scaleFactors, imageToSensor, spacing);
+  mitk::Image::Pointer single = niftk::DoStreamingUltrasoundReconstruction(data, scaleFactors, imageToSensor, spacing, 0, 1);
+  mitk::Image::Pointer parallel = niftk::DoStreamingUltrasoundReconstruction(data, scaleFactors, imageToSensor, spacing, 0, 4);
+
+  MITK_TEST_CONDITION(niftk::GetFractionOfDifferentVoxels(expected, single) < 0.01,
+                      ".. Testing the streaming reconstruction matches the original, fraction different=" << niftk::GetFractionOfDifferentVoxels(expected, single));
+  MITK_TEST_CONDITION(niftk::GetFractionOfDifferentVoxels(single, parallel) == 0,
+                      ".. Testing the streaming reconstruction gives the same volume on 1 and 4 threads");
+
+  mitk::Image::Pointer filled = niftk::DoStreamingUltrasoundReconstruction(data, scaleFactors, imageToSensor, spacing, 1, 4);
+
+  MITK_TEST_CONDITION(niftk::CountEmptyVoxels(filled) < niftk::CountEmptyVoxels(single),
+                      ".. Testing hole filling leaves fewer empty voxels, before=" << niftk::CountEmptyVoxels(single) << ", after=" << niftk::CountEmptyVoxels(filled));
+
+  MITK_TEST_END();
+}
@@ -25,6 +25,7 @@
 #include <itkImageRegionConstIteratorWithIndex.h>
 #include <itkImageRegionIterator.h>
 #include <itkCastImageFilter.h>
+#include <itkMultiThreader.h>
 #include <vtkSmartPointer.h>
 #include <vtkMatrix4x4.h>
 #include <vtkMath.h>
@@ -1149,10 +1150,12 @@ QuaternionTrackedPointData LoadPointAndTrackingDataFromDirectories(const std::st
 }
 
 
-//-----------------------------------------------------------------------------
-MatrixTrackedImageData LoadImageAndTrackingDataFromDirectories(const std::string& imageDir,
-                                                         const std::string& trackingDir
-                                                         )
+/**
+* Lists the image and tracking files in 2 directories, and pairs them up.
+*/
+std::vector<std::pair<std::string, std::string>> PairImageAndTrackingFiles(const std::string& imageDir,
+                                                                           const std::string& trackingDir
+                                                                           )
 {
   std::vector<std::string> imageFiles = niftk::GetFilesInDirectory(imageDir);
   std::vector<std::string> trackingFiles = niftk::GetFilesInDirectory(trackingDir);
@@ -1199,79 +1202,743 @@ MatrixTrackedImageData LoadImageAndTrackingDataFromDirectories(const std::string
     pairedFiles = PairTimeStampedDataFiles(imageFiles, trackingFiles);
   }
 
+  return pairedFiles;
+}
+
+
+/**
+* Loads one ultrasound image, as a 3D grey scale image with 1 slice.
+*/
+mitk::Image::Pointer LoadUltrasoundImage(const std::string& fileName)
+{
+  std::size_t found = fileName.find_last_of(".");
+  std::string ext = fileName.substr(found + 1);
+
+  mitk::Image::Pointer convertedImage = nullptr;
+
+  if (( ext == "png") || ( ext == "jpg" ))
+  {
+    // Use OpenCV/niftk routines.
+    // This creates a 3D image directly, and works with grey-scale and RGB.
+    cv::Mat tmp = cv::imread(fileName);
+
+    if (tmp.channels() == 3) // If it's a colour image, convert to grey scale
+    {
+      cv::Mat greyImage;
+      cv::cvtColor(tmp, greyImage, CV_BGR2GRAY); // If you load the image with OpenCV it will be BGR
+      convertedImage = niftk::CreateMitkImage(&greyImage);
+    }
+    else
+    {
+      convertedImage = niftk::CreateMitkImage(&tmp);
+    }
+  }
+  else
+  {
+    // Load one image file using mitk::IOUtil.
+    // This will load in as 2D, and hence requires the MITK filter to convert to 3D.
+    // The filter is not reused, as it would hand back the same output image each time.
+    mitk::Image::Pointer tmpImage = mitk::IOUtil::LoadImage(fileName);
+    mitk::Convert2Dto3DImageFilter::Pointer filter = mitk::Convert2Dto3DImageFilter::New();
+    filter->SetInput(tmpImage);
+    filter->Update();
+    convertedImage = filter->GetOutput();
+  }
+
+  return convertedImage;
+}
+
+
+/**
+* Loads one tracking matrix, converting it from quaternions if necessary.
+*/
+vtkSmartPointer<vtkMatrix4x4> LoadTrackingMatrix(const std::string& fileName)
+{
+  vtkSmartPointer<vtkMatrix4x4> trackingMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+
+  std::size_t found = fileName.find_last_of(".");
+  std::string ext = fileName.substr(found + 1);
+
+  if (( ext == "txt") || ( ext == "4x4"))
+  {
+    trackingMatrix = niftk::LoadVtkMatrix4x4FromFile(fileName);
+  }
+  else
+    if ( ext == "pos") // For Oxford tracking data, in quaternions
+    {
+      mitk::Point4D rotation;
+      mitk::Vector3D translation;
+
+      LoadOxfordQuaternionTrackingFile(fileName, rotation, translation);
+
+      // Convert to matrix
+      niftk::ConvertRotationAndTranslationToMatrix(rotation, translation, *trackingMatrix);
+    }
+    else
+    {
+      std::ostringstream errorMessage;
+      errorMessage << "Unknown tracking data type in " << fileName << std::endl;
+      mitkThrow() << errorMessage.str();
+    }
+
+  return trackingMatrix;
+}
+
+
+//-----------------------------------------------------------------------------
+MatrixTrackedImageData LoadImageAndTrackingDataFromDirectories(const std::string& imageDir,
+                                                         const std::string& trackingDir
+                                                         )
+{
+  std::vector<std::pair<std::string, std::string>> pairedFiles = PairImageAndTrackingFiles(imageDir, trackingDir);
+
   MatrixTrackedImageData outputData;
-  mitk::Convert2Dto3DImageFilter::Pointer filter = mitk::Convert2Dto3DImageFilter::New();
 
   // Load all images using mitk::IOUtil, assuming there is enough memory
   // Also load tracking data, and if in quaternion form, convert to matrices
   for (int i = 0; i < pairedFiles.size(); i++)
   {
-    found = pairedFiles[i].first.find_last_of(".");
-    ext = pairedFiles[i].first.substr(found + 1);
+    mitk::Image::Pointer convertedImage = LoadUltrasoundImage(pairedFiles[i].first);
+    vtkSmartPointer<vtkMatrix4x4> trackingMatrix = LoadTrackingMatrix(pairedFiles[i].second);
+
+    MatrixTrackedImage aTrackedImage(convertedImage, trackingMatrix);
+    outputData.push_back(aTrackedImage);
+  }
+
+  // This will incur a copy, but you won't copy images, you will copy smart pointers.
+  return outputData;
+}
+
 
-    mitk::Image::Pointer convertedImage = nullptr;
+/**
+* \brief Source of tracked frames for the streaming reconstruction. The tracking matrices
+* of all frames are needed up front to size the volume, but only one image at a time.
+*/
+class TrackedImageSource
+{
+public:
+  virtual ~TrackedImageSource() {}
+  virtual unsigned int GetNumberOfFrames() const = 0;
+  virtual vtkSmartPointer<vtkMatrix4x4> GetTrackingMatrix(unsigned int num) = 0;
+  virtual mitk::Image::Pointer GetImage(unsigned int num) = 0;
+};
 
-    if (( ext == "png") || ( ext == "jpg" ))
+
+/**
+* \brief Reads the images from disk as they are needed.
+*/
+class DirectoryTrackedImageSource : public TrackedImageSource
+{
+public:
+
+  DirectoryTrackedImageSource(const std::string& imageDir, const std::string& trackingDir)
+  : m_PairedFiles(PairImageAndTrackingFiles(imageDir, trackingDir))
+  {
+    // The tracking data are tiny, so they are all loaded at once.
+    for (unsigned int i = 0; i < m_PairedFiles.size(); i++)
     {
-      // Use OpenCV/niftk routines.
-      // This creates a 3D image directly, and works with grey-scale and RGB.
-      cv::Mat tmp = cv::imread(pairedFiles[i].first);
-      
-      if (tmp.channels() == 3) // If it's a colour image, convert to grey scale
+      m_TrackingMatrices.push_back(LoadTrackingMatrix(m_PairedFiles[i].second));
+    }
+  }
+
+  virtual unsigned int GetNumberOfFrames() const override
+  {
+    return m_PairedFiles.size();
+  }
+
+  virtual vtkSmartPointer<vtkMatrix4x4> GetTrackingMatrix(unsigned int num) override
+  {
+    return m_TrackingMatrices[num];
+  }
+
+  virtual mitk::Image::Pointer GetImage(unsigned int num) override
+  {
+    return LoadUltrasoundImage(m_PairedFiles[num].first);
+  }
+
+private:
+
+  std::vector<std::pair<std::string, std::string>> m_PairedFiles;
+  std::vector<vtkSmartPointer<vtkMatrix4x4>>       m_TrackingMatrices;
+};
+
+
+/**
+* \brief Hands out frames that are already in memory.
+*/
+class MemoryTrackedImageSource : public TrackedImageSource
+{
+public:
+
+  MemoryTrackedImageSource(const niftk::MatrixTrackedImageData& data)
+  : m_Data(data)
+  {
+  }
+
+  virtual unsigned int GetNumberOfFrames() const override
+  {
+    return m_Data.size();
+  }
+
+  virtual vtkSmartPointer<vtkMatrix4x4> GetTrackingMatrix(unsigned int num) override
+  {
+    return m_Data[num].second;
+  }
+
+  virtual mitk::Image::Pointer GetImage(unsigned int num) override
+  {
+    return m_Data[num].first;
+  }
+
+private:
+
+  const niftk::MatrixTrackedImageData& m_Data;
+};
+
+
+/**
+* \brief One frame ready to be inserted into the volume, with the position of its pixels
+* in continuous voxel indices of the output volume.
+*/
+struct CompoundingFrame
+{
+  InputImageType::Pointer  Image;      // Keeps the pixels alive.
+  const InputPixelType    *Pixels;
+  long int                 Size[2];
+  double                   Origin[3];  // Voxel index of pixel (0, 0).
+  double                   StepX[3];   // Change in voxel index from one pixel to the next in x.
+  double                   StepY[3];   // Change in voxel index from one pixel to the next in y.
+};
+
+
+/**
+* \brief Thread data for the streaming reconstruction.
+*
+* The volume is split into slabs of a few slices along one axis, and each thread owns
+* every n-th slab, so no two threads write the same voxel of the accumulator.
+*/
+struct CompoundingThreadStruct
+{
+  long int                              Size[3];           // Volume size in voxels.
+  int                                   SlabAxis;          // Axis that the volume is split along.
+  long int                              SlabThickness;     // Number of slices in a slab.
+  int                                   HoleFillingRadius;
+  const std::vector<CompoundingFrame>  *Frames;
+  std::vector<float>                   *Sums;              // Sum of the pixels inserted into each voxel.
+  std::vector<unsigned short>          *Counts;            // Number of pixels inserted into each voxel.
+  ResultImageType::PixelType           *Output;
+  std::vector<std::string>              ErrorMessages;
+};
+
+
+/**
+* \brief Rounds a continuous index to the nearest voxel, the same way as ITK.
+*/
+inline long int RoundToVoxel(double index)
+{
+  return static_cast<long int>(std::floor(index + 0.5));
+}
+
+
+/**
+* \brief Inserts the pixels of a batch of frames that fall into the slabs of one thread.
+* As the voxel index is linear along each row of a frame, the range of pixels that can
+* fall into a slab is worked out for each row, rather than each thread visiting every pixel.
+*/
+ITK_THREAD_RETURN_TYPE CompoundFramesThreaderCallback(void *arg)
+{
+  itk::ThreadIdType threadId = ((itk::MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  itk::ThreadIdType threadCount = ((itk::MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+  CompoundingThreadStruct *str = (CompoundingThreadStruct *)(((itk::MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  try
+  {
+    const int axis = str->SlabAxis;
+    const long int lastSlab = (str->Size[axis] - 1) / str->SlabThickness;
+    const long int maxCount = std::numeric_limits<unsigned short>::max();
+
+    for (unsigned int num = 0; num < str->Frames->size(); num++)
+    {
+      const CompoundingFrame& frame = (*str->Frames)[num];
+
+      for (long int j = 0; j < frame.Size[1]; j++)
       {
-        cv::Mat greyImage;
-        cv::cvtColor(tmp, greyImage, CV_BGR2GRAY); // If you load the image with OpenCV it will be BGR
-        convertedImage = niftk::CreateMitkImage(&greyImage);
+        double rowOrigin[3];
+        for (int d = 0; d < 3; d++)
+        {
+          rowOrigin[d] = frame.Origin[d] + static_cast<double>(j) * frame.StepY[d];
+        }
+
+        // The pixels at the ends of the row are the furthest apart along the slab axis.
+        long int firstSlice = RoundToVoxel(rowOrigin[axis]);
+        long int lastSlice = RoundToVoxel(rowOrigin[axis] + static_cast<double>(frame.Size[0] - 1) * frame.StepX[axis]);
+
+        if (firstSlice > lastSlice)
+        {
+          std::swap(firstSlice, lastSlice);
+        }
+
+        if (lastSlice < 0 || firstSlice >= str->Size[axis])
+        {
+          continue;
+        }
+
+        long int firstSlab = std::max(0L, firstSlice) / str->SlabThickness;
+        long int endSlab = std::min(lastSlab, lastSlice / str->SlabThickness) + 1;
+
+        // The first slab of this thread, at or after firstSlab.
+        long int slab = firstSlab + (threadId + threadCount - firstSlab % threadCount) % threadCount;
+
+        for (; slab < endSlab; slab += threadCount)
+        {
+          long int beginSlice = slab * str->SlabThickness;
+          long int endSlice = std::min(beginSlice + str->SlabThickness, str->Size[axis]);
+
+          // Range of pixels that can round into the slab. It is widened by a pixel, as the
+          // slice of each pixel is checked anyway, so that rounding cannot drop any.
+          long int beginPixel = 0;
+          long int endPixel = frame.Size[0];
+
+          if (std::fabs(frame.StepX[axis]) > TINY_NUMBER)
+          {
+            double a = (beginSlice - 0.5 - rowOrigin[axis]) / frame.StepX[axis];
+            double b = (endSlice - 0.5 - rowOrigin[axis]) / frame.StepX[axis];
+
+            beginPixel = std::max(beginPixel, static_cast<long int>(std::floor(std::min(a, b))) - 1);
+            endPixel = std::min(endPixel, static_cast<long int>(std::ceil(std::max(a, b))) + 2);
+          }
+
+          const InputPixelType *row = frame.Pixels + j * frame.Size[0];
+
+          for (long int i = beginPixel; i < endPixel; i++)
+          {
+            InputPixelType pixelValue = row[i];
+            if (pixelValue == 0)
+            {
+              continue; // Ignore black areas
+            }
+
+            long int idx[3];
+            for (int d = 0; d < 3; d++)
+            {
+              idx[d] = RoundToVoxel(rowOrigin[d] + static_cast<double>(i) * frame.StepX[d]);
+            }
+
+            if (   idx[axis] < beginSlice || idx[axis] >= endSlice
+                || idx[0] < 0 || idx[0] >= str->Size[0]
+                || idx[1] < 0 || idx[1] >= str->Size[1]
+                || idx[2] < 0 || idx[2] >= str->Size[2]
+               )
+            {
+              continue;
+            }
+
+            std::size_t voxel = idx[0] + str->Size[0] * (idx[1] + str->Size[1] * static_cast<std::size_t>(idx[2]));
+
+            // A saturated voxel keeps the mean of the samples it already has.
+            if ((*str->Counts)[voxel] < maxCount)
+            {
+              (*str->Sums)[voxel] += pixelValue;
+              (*str->Counts)[voxel]++;
+            }
+          }
+        }
       }
-      else
+    }
+  }
+  catch (std::exception& err)
+  {
+    str->ErrorMessages[threadId] = err.what();
+  }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+
+/**
+* \brief Divides the sums by the counts for a range of slices of the volume, and optionally
+* fills the voxels that no pixel was inserted into from their neighbourhood.
+*/
+ITK_THREAD_RETURN_TYPE FinishVolumeThreaderCallback(void *arg)
+{
+  itk::ThreadIdType threadId = ((itk::MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  itk::ThreadIdType threadCount = ((itk::MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+  CompoundingThreadStruct *str = (CompoundingThreadStruct *)(((itk::MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  try
+  {
+    const long int *size = str->Size;
+    const long int radius = str->HoleFillingRadius;
+    const float *sums = &(*str->Sums)[0];
+    const unsigned short *counts = &(*str->Counts)[0];
+
+    long int beginZ = (size[2] * threadId) / threadCount;
+    long int endZ = (size[2] * (threadId + 1)) / threadCount;
+
+    for (long int z = beginZ; z < endZ; z++)
+    {
+      for (long int y = 0; y < size[1]; y++)
       {
-        convertedImage = niftk::CreateMitkImage(&tmp);
+        for (long int x = 0; x < size[0]; x++)
+        {
+          std::size_t voxel = x + size[0] * (y + size[1] * static_cast<std::size_t>(z));
+
+          double totalValue = sums[voxel];
+          double totalWeight = counts[voxel];
+
+          if (totalWeight == 0 && radius > 0)
+          {
+            for (long int nz = std::max(0L, z - radius); nz <= std::min(size[2] - 1, z + radius); nz++)
+            {
+              for (long int ny = std::max(0L, y - radius); ny <= std::min(size[1] - 1, y + radius); ny++)
+              {
+                std::size_t neighbour = size[0] * (ny + size[1] * static_cast<std::size_t>(nz));
+
+                for (long int nx = std::max(0L, x - radius); nx <= std::min(size[0] - 1, x + radius); nx++)
+                {
+                  totalValue += sums[neighbour + nx];
+                  totalWeight += counts[neighbour + nx];
+                }
+              }
+            }
+          }
+
+          str->Output[voxel] = 0;
+
+          if (totalValue > TINY_NUMBER && totalWeight > TINY_NUMBER)
+          {
+            str->Output[voxel] = static_cast<ResultImageType::PixelType>(totalValue / totalWeight);
+          }
+        }
       }
     }
-    else
+  }
+  catch (std::exception& err)
+  {
+    str->ErrorMessages[threadId] = err.what();
+  }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+
+/**
+* \brief Runs one of the callbacks, and throws if any of the threads failed.
+*/
+void RunCompoundingThreads(itk::MultiThreader* threader,
+                           ITK_THREAD_RETURN_TYPE (*callback)(void *),
+                           CompoundingThreadStruct& str
+                           )
+{
+  str.ErrorMessages.assign(threader->GetNumberOfThreads(), std::string());
+
+  threader->SetSingleMethod(callback, &str);
+  threader->SingleMethodExecute();
+
+  for (unsigned int i = 0; i < str.ErrorMessages.size(); i++)
+  {
+    if (str.ErrorMessages[i].size() > 0)
     {
-      // Load one image file using mitk::IOUtil.
-      // This will load in as 2D, and hence requires the MITK filter to convert to 3D.
-      mitk::Image::Pointer tmpImage = mitk::IOUtil::LoadImage(pairedFiles[i].first);
-      filter->SetInput(tmpImage);
-      filter->Update();
-      convertedImage = filter->GetOutput();
+      mitkThrow() << "Ultrasound reconstruction failed on one of the threads: " << str.ErrorMessages[i];
     }
+  }
+}
 
-    // Load one tracking file
-    vtkSmartPointer<vtkMatrix4x4> trackingMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
 
-    found = pairedFiles[i].second.find_last_of(".");
-    ext = pairedFiles[i].second.substr(found + 1);
+/**
+* \brief Checks that a frame can be reconstructed.
+*/
+void CheckUltrasoundImage(const mitk::Image::Pointer& image, unsigned int num)
+{
+  if (image.IsNull())
+  {
+    mitkThrow() << "Ultrasound image " << num << " is NULL?!?!?";
+  }
+  if (image->GetPixelType() != mitk::MakeScalarPixelType<unsigned char>())
+  {
+    mitkThrow() << "Ultrasound images should be unsigned char.";
+  }
+  if (image->GetPixelType().GetNumberOfComponents() != 1)
+  {
+    mitkThrow() << "Ultrasound images should have 1 component (i.e. greyscale not RGB)";
+  }
+  if (image->GetDimension() != 3)
+  {
+    mitkThrow() << "Ultrasound images should be 3D.";
+  }
+  if (image->GetDimensions()[2] != 1)
+  {
+    mitkThrow() << "Ultrasound images should be 3D, with 1 slice.";
+  }
+}
 
-    if (( ext == "txt") || ( ext == "4x4"))
+
+/**
+* \brief The streaming reconstruction, for frames from any source.
+*/
+mitk::Image::Pointer DoStreamingUltrasoundReconstruction(TrackedImageSource& source,
+                                                         const mitk::Point2D& pixelScaleFactors,
+                                                         const niftk::RotationTranslation& imageToSensorTransform,
+                                                         const mitk::Vector3D& voxelSpacing,
+                                                         const int holeFillingRadius,
+                                                         const int numberOfThreads
+                                                         )
+{
+  // Number of frames that are loaded before inserting them into the volume together.
+  const unsigned int framesPerBatch = 16;
+
+  // Number of slices in each slab of the volume that is owned by one thread.
+  const long int slabThickness = 4;
+
+  unsigned int numberOfFrames = source.GetNumberOfFrames();
+
+  MITK_INFO << "DoStreamingUltrasoundReconstruction: Doing Ultrasound Reconstruction with "
+            << numberOfFrames << " samples.";
+
+  if (numberOfFrames == 0)
+  {
+    mitkThrow() << "No reconstruction data provided.";
+  }
+
+  if (voxelSpacing[0] <= 0 || voxelSpacing[1] <= 0 || voxelSpacing[2] <= 0)
+  {
+    mitkThrow() << "Voxel spacing should be positive.";
+  }
+
+  vtkSmartPointer<vtkMatrix4x4> scalingMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  scalingMatrix->Identity();
+  scalingMatrix->SetElement(0, 0, pixelScaleFactors[0]);
+  scalingMatrix->SetElement(1, 1, pixelScaleFactors[1]);
+
+  vtkSmartPointer<vtkMatrix4x4> imageToSensorMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  niftk::ConvertRotationAndTranslationToMatrix(imageToSensorTransform.first,
+                                               imageToSensorTransform.second,
+                                               *imageToSensorMatrix
+                                               );
+
+  vtkSmartPointer<vtkMatrix4x4> pixelToSensorMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  vtkMatrix4x4::Multiply4x4(imageToSensorMatrix, scalingMatrix, pixelToSensorMatrix);
+
+  vtkSmartPointer<vtkMatrix4x4> indexToWorld = vtkSmartPointer<vtkMatrix4x4>::New();
+
+  // All the frames must have the size of the first, so that the volume can be sized
+  // from the tracking data alone, before any other image is loaded.
+  mitk::Image::Pointer firstImage = source.GetImage(0);
+  CheckUltrasoundImage(firstImage, 0);
+
+  long int frameSize[2];
+  frameSize[0] = firstImage->GetDimensions()[0];
+  frameSize[1] = firstImage->GetDimensions()[1];
+
+  // Calculate size of bounding box, in millimetres, from the corners of all the frames.
+  mitk::Point3D minCornerInMillimetres;
+  mitk::Point3D maxCornerInMillimetres;
+
+  for (int j = 0; j < 3; j++)
+  {
+    minCornerInMillimetres[j] = std::numeric_limits<double>::max();
+    maxCornerInMillimetres[j] = -1 * std::numeric_limits<double>::max();
+  }
+
+  for (unsigned int num = 0; num < numberOfFrames; num++)
+  {
+    vtkMatrix4x4::Multiply4x4(source.GetTrackingMatrix(num), pixelToSensorMatrix, indexToWorld);
+
+    for (int i = 0; i < 4; i++)
     {
-      trackingMatrix = niftk::LoadVtkMatrix4x4FromFile(pairedFiles[i].second);
-    }
-    else
-      if ( ext == "pos") // For Oxford tracking data, in quaternions
-      {
-        mitk::Point4D rotation;
-        mitk::Vector3D translation;
+      double corner[4] = { (i % 2) * static_cast<double>(frameSize[0]), (i / 2) * static_cast<double>(frameSize[1]), 0, 1 };
+      double cornerInMillimetres[4];
 
-        LoadOxfordQuaternionTrackingFile(pairedFiles[i].second, rotation, translation);
+      indexToWorld->MultiplyPoint(corner, cornerInMillimetres);
 
-        // Convert to matrix
-        niftk::ConvertRotationAndTranslationToMatrix(rotation, translation, *trackingMatrix);
+      for (int j = 0; j < 3; j++)
+      {
+        minCornerInMillimetres[j] = std::min(minCornerInMillimetres[j], cornerInMillimetres[j]);
+        maxCornerInMillimetres[j] = std::max(maxCornerInMillimetres[j], cornerInMillimetres[j]);
       }
-      else
+    }
+  }
+
+  mitk::Point3D origin;
+  long int size[3];
+
+  for (int j = 0; j < 3; j++)
+  {
+    origin[j] = minCornerInMillimetres[j] - (0.5 * voxelSpacing[j]); // Origin position in millimetres.
+    size[j] = static_cast<long int>((maxCornerInMillimetres[j] - minCornerInMillimetres[j]) / voxelSpacing[j]) + 2; // Number of voxels.
+  }
+
+  std::size_t numberOfVoxels = size[0] * size[1] * static_cast<std::size_t>(size[2]);
+
+  MITK_INFO << "DoStreamingUltrasoundReconstruction creating a volume of ("
+            << size[0] << ", " << size[1] << ", " << size[2] << "), "
+            << "with resolution "
+            << voxelSpacing[0] << "x" << voxelSpacing[1] << "x" << voxelSpacing[2]
+            << "mm, and an accumulator of "
+            << (numberOfVoxels * (sizeof(float) + sizeof(unsigned short))) / (1024 * 1024)
+            << "MB." << std::endl;
+
+  std::vector<float> sums(numberOfVoxels, 0);
+  std::vector<unsigned short> counts(numberOfVoxels, 0);
+
+  itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+  threader->SetNumberOfThreads(numberOfThreads > 0 ? numberOfThreads : itk::MultiThreader::GetGlobalDefaultNumberOfThreads());
+
+  std::vector<CompoundingFrame> frames;
+
+  CompoundingThreadStruct str;
+  str.SlabAxis = 2;
+  str.SlabThickness = slabThickness;
+  str.HoleFillingRadius = holeFillingRadius;
+  str.Frames = &frames;
+  str.Sums = &sums;
+  str.Counts = &counts;
+  str.Output = nullptr;
+
+  for (int j = 0; j < 3; j++)
+  {
+    str.Size[j] = size[j];
+  }
+
+  // Insert the frames a batch at a time, so only a few images are in memory at once.
+  for (unsigned int num = 0; num < numberOfFrames; num++)
+  {
+    mitk::Image::Pointer image2D = firstImage;
+    firstImage = nullptr;
+
+    if (num > 0)
+    {
+      image2D = source.GetImage(num);
+      CheckUltrasoundImage(image2D, num);
+    }
+
+    if (image2D->GetDimensions()[0] != frameSize[0] || image2D->GetDimensions()[1] != frameSize[1])
+    {
+      mitkThrow() << "Ultrasound image " << num << " is not the same size as the first image.";
+    }
+
+    vtkMatrix4x4::Multiply4x4(source.GetTrackingMatrix(num), pixelToSensorMatrix, indexToWorld);
+
+    CompoundingFrame frame;
+    frame.Image = mitk::ImageToItkImage< InputPixelType, dim >(image2D);
+    frame.Pixels = frame.Image->GetBufferPointer();
+    frame.Size[0] = frameSize[0];
+    frame.Size[1] = frameSize[1];
+
+    for (int j = 0; j < 3; j++)
+    {
+      frame.Origin[j] = (indexToWorld->GetElement(j, 3) - origin[j]) / voxelSpacing[j];
+      frame.StepX[j] = indexToWorld->GetElement(j, 0) / voxelSpacing[j];
+      frame.StepY[j] = indexToWorld->GetElement(j, 1) / voxelSpacing[j];
+    }
+
+    // Split the volume along the axis that the first frame covers the most voxels of,
+    // so that the pixels of each frame are spread over as many slabs as possible.
+    if (num == 0)
+    {
+      double maxExtent = -1;
+
+      for (int j = 0; j < 3; j++)
       {
-        std::ostringstream errorMessage;
-        errorMessage << "Unknown tracking data type in " << pairedFiles[i].second << std::endl;
-        mitkThrow() << errorMessage.str();
+        double extent = std::fabs(frame.StepX[j]) * frameSize[0] + std::fabs(frame.StepY[j]) * frameSize[1];
+        if (extent > maxExtent)
+        {
+          maxExtent = extent;
+          str.SlabAxis = j;
+        }
       }
+    }
 
-    MatrixTrackedImage aTrackedImage(convertedImage, trackingMatrix);
-    outputData.push_back(aTrackedImage);
+    frames.push_back(frame);
+
+    if (frames.size() == framesPerBatch || num == numberOfFrames - 1)
+    {
+      RunCompoundingThreads(threader, CompoundFramesThreaderCallback, str);
+      frames.clear();
+
+      MITK_INFO << "Slices up to " << num << " reconstructed";
+    }
   }
 
-  // This will incur a copy, but you won't copy images, you will copy smart pointers.
-  return outputData;
+  ResultImageType::SizeType resultSize;
+  ResultImageType::SpacingType resultSpacing;
+  ResultImageType::PointType resultOrigin;
+
+  for (int j = 0; j < 3; j++)
+  {
+    resultSize[j] = size[j];
+    resultSpacing[j] = voxelSpacing[j];
+    resultOrigin[j] = origin[j];
+  }
+
+  ResultImageType::IndexType resultStart;
+  resultStart.Fill(0);
+
+  ResultImageType::RegionType resultRegion;
+  resultRegion.SetSize(resultSize);
+  resultRegion.SetIndex(resultStart);
+
+  ResultImageType::Pointer itk3D = ResultImageType::New();
+  itk3D->SetRegions(resultRegion);
+  itk3D->SetSpacing(resultSpacing);
+  itk3D->SetOrigin(resultOrigin);
+  itk3D->Allocate();
+
+  // Do averaging, and hole filling.
+  str.Output = itk3D->GetBufferPointer();
+  RunCompoundingThreads(threader, FinishVolumeThreaderCallback, str);
+
+  std::vector<float>().swap(sums);
+  std::vector<unsigned short>().swap(counts);
+
+  mitk::Image::Pointer resultImage = mitk::Image::New();
+  resultImage->InitializeByItk(itk3D.GetPointer());
+  resultImage->SetVolume(itk3D->GetBufferPointer());
+
+  return resultImage;
+}
+
+
+//-----------------------------------------------------------------------------
+mitk::Image::Pointer DoStreamingUltrasoundReconstruction(const std::string& imageDir,
+                                                         const std::string& trackingDir,
+                                                         const mitk::Point2D& pixelScaleFactors,
+                                                         const niftk::RotationTranslation& imageToSensorTransform,
+                                                         const mitk::Vector3D& voxelSpacing,
+                                                         const int holeFillingRadius,
+                                                         const int numberOfThreads
+                                                         )
+{
+  DirectoryTrackedImageSource source(imageDir, trackingDir);
+
+  return DoStreamingUltrasoundReconstruction(source,
+                                             pixelScaleFactors,
+                                             imageToSensorTransform,
+                                             voxelSpacing,
+                                             holeFillingRadius,
+                                             numberOfThreads
+                                             );
+}
+
+
+//-----------------------------------------------------------------------------
+mitk::Image::Pointer DoStreamingUltrasoundReconstruction(const niftk::MatrixTrackedImageData& data,
+                                                         const mitk::Point2D& pixelScaleFactors,
+                                                         const niftk::RotationTranslation& imageToSensorTransform,
+                                                         const mitk::Vector3D& voxelSpacing,
+                                                         const int holeFillingRadius,
+                                                         const int numberOfThreads
+                                                         )
+{
+  MemoryTrackedImageSource source(data);
+
+  return DoStreamingUltrasoundReconstruction(source,
+                                             pixelScaleFactors,
+                                             imageToSensorTransform,
+                                             voxelSpacing,
+                                             holeFillingRadius,
+                                             numberOfThreads
+                                             );
 }
 
 } // end namespace
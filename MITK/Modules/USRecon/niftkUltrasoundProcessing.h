@@ -117,6 +117,42 @@ NIFTKUSRECON_EXPORT mitk::Image::Pointer DoUltrasoundReconstruction(const niftk:
                                                                     const mitk::Vector3D& voxelSpacing
                                                                    );
 
+
+/**
+* \brief Streaming version of DoUltrasoundReconstruction, for sweeps too long to hold in memory.
+*
+* The tracking data are all loaded first, to size the volume, and then the images are loaded
+* and inserted a few at a time, so only a handful of frames are ever in memory. All images in
+* the sweep must have the same size. Instead of two double volumes, the running sum and the
+* number of samples of each voxel are kept as a float and a 16 bit count. The frames are inserted
+* on several threads, each thread owning a set of slabs of the output volume, so no two threads
+* write the same voxel.
+* \param holeFillingRadius if greater than zero, each voxel that no pixel was inserted into is set
+* to the mean of the samples within this many voxels of it, if there are any.
+* \param numberOfThreads number of threads, or zero for the ITK default.
+*/
+NIFTKUSRECON_EXPORT mitk::Image::Pointer DoStreamingUltrasoundReconstruction(const std::string& imageDir,
+                                                                             const std::string& trackingDir,
+                                                                             const mitk::Point2D& pixelScaleFactors,
+                                                                             const RotationTranslation& imageToSensorTransform,
+                                                                             const mitk::Vector3D& voxelSpacing,
+                                                                             const int holeFillingRadius = 0,
+                                                                             const int numberOfThreads = 0
+                                                                            );
+
+
+/**
+* \brief As above, for frames that are already in memory, eg. grabbed in the GUI.
+* They still benefit from the compact accumulator, the threading and the hole filling.
+*/
+NIFTKUSRECON_EXPORT mitk::Image::Pointer DoStreamingUltrasoundReconstruction(const niftk::MatrixTrackedImageData& data,
+                                                                             const mitk::Point2D& pixelScaleFactors,
+                                                                             const RotationTranslation& imageToSensorTransform,
+                                                                             const mitk::Vector3D& voxelSpacing,
+                                                                             const int holeFillingRadius = 0,
+                                                                             const int numberOfThreads = 0
+                                                                            );
+
 } // end namespace
 
 #endif
@@ -32,6 +32,7 @@ USReconGUI::USReconGUI(QWidget* parent)
   this->connect(m_SaveMatchedDataPushButton, SIGNAL(pressed()), SIGNAL(OnSaveDataPressed()));
   this->connect(m_CalibrationRunPushButton, SIGNAL(pressed()), SIGNAL(OnCalibratePressed()));
   this->connect(m_ReconstructVolumePushButton, SIGNAL(pressed()), SIGNAL(OnReconstructPressed()));
+  this->connect(m_ReconstructFromDiskPushButton, SIGNAL(pressed()), SIGNAL(OnReconstructFromDiskPressed()));
   this->SetEnableButtons(true);
 }
 
@@ -67,6 +68,7 @@ void USReconGUI::SetEnableButtons(bool isEnabled)
   m_SaveMatchedDataPushButton->setEnabled(isEnabled);
   m_CalibrationRunPushButton->setEnabled(isEnabled);
   m_ReconstructVolumePushButton->setEnabled(isEnabled);
+  m_ReconstructFromDiskPushButton->setEnabled(isEnabled);
 }
 
 
@@ -125,4 +127,11 @@ int USReconGUI::GetBallSize() const
   return m_BallSize->value();
 }
 
+
+//-----------------------------------------------------------------------------
+int USReconGUI::GetHoleFillingRadius() const
+{
+  return m_HoleFillingRadius->value();
+}
+
 } // end namespace
@@ -47,6 +47,7 @@ public:
   mitk::DataNode::Pointer GetImageNode() const;
   mitk::DataNode::Pointer GetTrackingNode() const;
   int GetBallSize() const;
+  int GetHoleFillingRadius() const;
 
 signals:
 
@@ -57,6 +58,7 @@ signals:
   void OnSaveDataPressed();
   void OnCalibratePressed();
   void OnReconstructPressed();
+  void OnReconstructFromDiskPressed();
 
 private:
 
@@ -17,6 +17,7 @@
 #include <niftkCoordinateAxesData.h>
 #include <Internal/niftkUSReconGUI.h>
 #include <mitkIOUtil.h>
+#include <mitkExceptionMacro.h>
 #include <niftkFileHelper.h>
 #include <niftkMITKMathsUtils.h>
 #include <vtkSmartPointer.h>
@@ -46,6 +47,9 @@ public:
   USReconGUI*                       m_GUI;
   QString                           m_PreviousDirName;
   QString                           m_RecordingDirName;
+  QString                           m_ImageDirName;
+  QString                           m_TrackingDirName;
+  bool                              m_ReconstructFromDisk;
   bool                              m_IsRecording;
   int                               m_ReconstructedId;
   mitk::DataNode::Pointer           m_CurrentImage;
@@ -61,10 +65,11 @@ public:
 USReconControllerPrivate::USReconControllerPrivate(USReconController* usreconController)
 : q_ptr(usreconController)
 , m_GUI(nullptr)
-, m_Lock(QMutex::Recursive)
 , m_RecordingDirName("")
+, m_ReconstructFromDisk(false)
 , m_IsRecording(false)
 , m_ReconstructedId(0)
+, m_Lock(QMutex::Recursive)
 {
   Q_Q(USReconController);
 }
@@ -119,6 +124,7 @@ void USReconController::SetupGUI(QWidget* parent)
   connect(d->m_GUI, SIGNAL(OnSaveDataPressed()), this, SLOT(OnSaveDataPressed()));
   connect(d->m_GUI, SIGNAL(OnCalibratePressed()), this, SLOT(OnCalibratePressed()));
   connect(d->m_GUI, SIGNAL(OnReconstructPressed()), this, SLOT(OnReconstructPressed()));
+  connect(d->m_GUI, SIGNAL(OnReconstructFromDiskPressed()), this, SLOT(OnReconstructFromDiskPressed()));
   connect(&d->m_BackgroundProcessWatcher, SIGNAL(finished()), this, SLOT(OnBackgroundProcessFinished()));
 }
 
@@ -335,6 +341,44 @@ void USReconController::OnCalibratePressed()
 //-----------------------------------------------------------------------------
 void USReconController::OnReconstructPressed()
 {
+  Q_D(USReconController);
+
+  d->m_ReconstructFromDisk = false;
+  this->DoReconstruction();
+}
+
+
+//-----------------------------------------------------------------------------
+void USReconController::OnReconstructFromDiskPressed()
+{
+  Q_D(USReconController);
+
+  QString previous = d->m_PreviousDirName;
+  if (previous.isEmpty())
+  {
+    previous = d->m_RecordingDirName;
+  }
+
+  QString imageDirName = QFileDialog::getExistingDirectory(d->m_GUI->GetParent(),
+      tr("Image directory"), previous);
+
+  if (imageDirName.isEmpty())
+  {
+    return;
+  }
+
+  QString trackingDirName = QFileDialog::getExistingDirectory(d->m_GUI->GetParent(),
+      tr("Tracking directory"), imageDirName);
+
+  if (trackingDirName.isEmpty())
+  {
+    return;
+  }
+
+  d->m_PreviousDirName = imageDirName;
+  d->m_ImageDirName = imageDirName;
+  d->m_TrackingDirName = trackingDirName;
+  d->m_ReconstructFromDisk = true;
   this->DoReconstruction();
 }
 
@@ -382,11 +426,37 @@ void USReconController::DoReconstructionInBackground()
   voxelSpacing[1] = 0.3;
   voxelSpacing[2] = 0.3;
 
-  mitk::Image::Pointer newImage = niftk::DoUltrasoundReconstruction(d->m_TrackedImages,
-                                                                    scaleFactors,
-                                                                    imageToSensorTransform,
-                                                                    voxelSpacing
-                                                                   );
+  mitk::Image::Pointer newImage;
+
+  try
+  {
+    // Images from disk are loaded one at a time, so they are never all in memory.
+    if (d->m_ReconstructFromDisk)
+    {
+      newImage = niftk::DoStreamingUltrasoundReconstruction(d->m_ImageDirName.toStdString(),
+                                                            d->m_TrackingDirName.toStdString(),
+                                                            scaleFactors,
+                                                            imageToSensorTransform,
+                                                            voxelSpacing,
+                                                            d->m_GUI->GetHoleFillingRadius()
+                                                           );
+    }
+    else
+    {
+      newImage = niftk::DoStreamingUltrasoundReconstruction(d->m_TrackedImages,
+                                                            scaleFactors,
+                                                            imageToSensorTransform,
+                                                            voxelSpacing,
+                                                            d->m_GUI->GetHoleFillingRadius()
+                                                           );
+    }
+  }
+  catch (mitk::Exception& e)
+  {
+    MITK_ERROR << "Ultrasound Reconstruction failed: " << e.GetDescription();
+    return;
+  }
+
   if (newImage.IsNotNull())
   {
     std::ostringstream imageName;
@@ -61,6 +61,7 @@ public slots:
   void OnSaveDataPressed();
   void OnCalibratePressed();
   void OnReconstructPressed();
+  void OnReconstructFromDiskPressed();
 
 protected:
 
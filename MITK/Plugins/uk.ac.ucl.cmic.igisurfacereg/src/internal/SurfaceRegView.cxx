@@ -42,6 +42,8 @@ const QString SurfaceRegView::VIEW_ID = "uk.ac.ucl.cmic.igisurfacereg";
 SurfaceRegView::SurfaceRegView()
 : m_Controls(NULL)
 , m_Matrix(NULL)
+, m_UseKdTree(niftk::ICPBasedRegistrationConstants::DEFAULT_USE_KDTREE)
+, m_PointToPlane(niftk::ICPBasedRegistrationConstants::DEFAULT_POINT_TO_PLANE)
 {
   m_Matrix = vtkMatrix4x4::New();
   m_Matrix->Identity();
@@ -265,6 +267,10 @@ void SurfaceRegView::RetrievePreferenceValues()
         niftk::ICPBasedRegistrationConstants::DEFAULT_TLS_ITERATIONS);
     m_TLSPercentage = prefs->GetInt(SurfaceRegViewPreferencePage::TLS_PERCENTAGE,
         niftk::ICPBasedRegistrationConstants::DEFAULT_TLS_PERCENTAGE);
+    m_UseKdTree = prefs->GetBool(SurfaceRegViewPreferencePage::USE_KDTREE,
+        niftk::ICPBasedRegistrationConstants::DEFAULT_USE_KDTREE);
+    m_PointToPlane = prefs->GetBool(SurfaceRegViewPreferencePage::POINT_TO_PLANE,
+        niftk::ICPBasedRegistrationConstants::DEFAULT_POINT_TO_PLANE);
   }
 }
 
@@ -303,6 +309,8 @@ void SurfaceRegView::OnCalculateButtonPressed()
   registration->SetMaximumIterations(m_MaxIterations);
   registration->SetTLSIterations(m_TLSITerations);
   registration->SetTLSPercentage(m_TLSPercentage);
+  registration->SetUseKdTree(m_UseKdTree);
+  registration->SetPointToPlane(m_PointToPlane);
   if (m_Controls->m_HiddenSurfaceRemovalGroupBox->isChecked())
   {
     registration->Update(fixednode,
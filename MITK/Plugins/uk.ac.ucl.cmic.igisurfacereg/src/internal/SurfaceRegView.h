@@ -102,6 +102,8 @@ private:
   int m_MaxPoints;
   unsigned int m_TLSITerations;
   unsigned int m_TLSPercentage;
+  bool m_UseKdTree;
+  bool m_PointToPlane;
 
   QFuture<float>           m_BackgroundProcess;
   QFutureWatcher<float>    m_BackgroundProcessWatcher;
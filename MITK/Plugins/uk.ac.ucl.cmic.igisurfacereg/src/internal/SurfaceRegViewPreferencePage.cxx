@@ -31,6 +31,8 @@ const QString SurfaceRegViewPreferencePage::MAXIMUM_NUMBER_OF_ITERATIONS("maximu
 const QString SurfaceRegViewPreferencePage::MAXIMUM_NUMBER_OF_POINTS("maximum number of points");
 const QString SurfaceRegViewPreferencePage::TLS_ITERATIONS("Trimmed Least Squares iterations (zero is OFF)");
 const QString SurfaceRegViewPreferencePage::TLS_PERCENTAGE("Trimmed Least Squares percentage");
+const QString SurfaceRegViewPreferencePage::USE_KDTREE("use k-d tree ICP");
+const QString SurfaceRegViewPreferencePage::POINT_TO_PLANE("point to plane ICP");
 
 //-----------------------------------------------------------------------------
 SurfaceRegViewPreferencePage::SurfaceRegViewPreferencePage()
@@ -39,6 +41,8 @@ SurfaceRegViewPreferencePage::SurfaceRegViewPreferencePage()
 , m_MaximumPoints(0)
 , m_TLSIterations(0)
 , m_TLSPercentage(0)
+, m_UseKdTree(0)
+, m_PointToPlane(0)
 , m_Initializing(false)
 , m_SurfaceRegViewPreferencesNode(0)
 {
@@ -94,10 +98,15 @@ void SurfaceRegViewPreferencePage::CreateQtControl(QWidget* parent)
   m_TLSPercentage->setMinimum (1);
   m_TLSPercentage->setMaximum (100);
 
+  m_UseKdTree = new QCheckBox();
+  m_PointToPlane = new QCheckBox();
+
   formLayout->addRow("Maximum number of ICP iterations", m_MaximumIterations);
   formLayout->addRow("Maximum number of points to use in ICP", m_MaximumPoints);
   formLayout->addRow(TLS_ITERATIONS, m_TLSIterations);
   formLayout->addRow(TLS_PERCENTAGE, m_TLSPercentage);
+  formLayout->addRow("Use multi-threaded k-d tree ICP", m_UseKdTree);
+  formLayout->addRow("Point to plane (k-d tree ICP only)", m_PointToPlane);
 
   m_MainControl->setLayout(formLayout);
   this->Update();
@@ -120,6 +129,8 @@ bool SurfaceRegViewPreferencePage::PerformOk()
   m_SurfaceRegViewPreferencesNode->PutInt(SurfaceRegViewPreferencePage::MAXIMUM_NUMBER_OF_POINTS, m_MaximumPoints->value());
   m_SurfaceRegViewPreferencesNode->PutInt(SurfaceRegViewPreferencePage::TLS_ITERATIONS, m_TLSIterations->value());
   m_SurfaceRegViewPreferencesNode->PutInt(SurfaceRegViewPreferencePage::TLS_PERCENTAGE, m_TLSPercentage->value());
+  m_SurfaceRegViewPreferencesNode->PutBool(SurfaceRegViewPreferencePage::USE_KDTREE, m_UseKdTree->isChecked());
+  m_SurfaceRegViewPreferencesNode->PutBool(SurfaceRegViewPreferencePage::POINT_TO_PLANE, m_PointToPlane->isChecked());
 
   return true;
 }
@@ -143,5 +154,9 @@ void SurfaceRegViewPreferencePage::Update()
         niftk::ICPBasedRegistrationConstants::DEFAULT_TLS_ITERATIONS));
   m_TLSPercentage->setValue(m_SurfaceRegViewPreferencesNode->GetInt(SurfaceRegViewPreferencePage::TLS_PERCENTAGE,
         niftk::ICPBasedRegistrationConstants::DEFAULT_TLS_PERCENTAGE));
+  m_UseKdTree->setChecked(m_SurfaceRegViewPreferencesNode->GetBool(SurfaceRegViewPreferencePage::USE_KDTREE,
+        niftk::ICPBasedRegistrationConstants::DEFAULT_USE_KDTREE));
+  m_PointToPlane->setChecked(m_SurfaceRegViewPreferencesNode->GetBool(SurfaceRegViewPreferencePage::POINT_TO_PLANE,
+        niftk::ICPBasedRegistrationConstants::DEFAULT_POINT_TO_PLANE));
 
 }
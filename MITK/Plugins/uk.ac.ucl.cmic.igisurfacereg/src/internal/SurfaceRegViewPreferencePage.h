@@ -55,6 +55,16 @@ public:
    */
   static const QString TLS_PERCENTAGE;
 
+  /**
+   * \brief Stores the name of the preference node that contains whether to use the multi-threaded k-d tree ICP.
+   */
+  static const QString USE_KDTREE;
+
+  /**
+   * \brief Stores the name of the preference node that contains whether to minimise the point to plane distance.
+   */
+  static const QString POINT_TO_PLANE;
+
   SurfaceRegViewPreferencePage();
   SurfaceRegViewPreferencePage(const SurfaceRegViewPreferencePage& other);
   ~SurfaceRegViewPreferencePage();
@@ -89,6 +99,8 @@ private:
   QSpinBox       *m_MaximumPoints;
   QSpinBox       *m_TLSIterations;
   QSpinBox       *m_TLSPercentage;
+  QCheckBox      *m_UseKdTree;
+  QCheckBox      *m_PointToPlane;
   bool            m_Initializing;
 
   berry::IPreferences::Pointer m_SurfaceRegViewPreferencesNode;